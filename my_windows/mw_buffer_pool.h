@@ -0,0 +1,483 @@
+#pragma once
+#ifdef _WIN32
+#    include "mw_memory.h"
+#    include "mw_process.h"
+#    include "mw_system.h"
+#    include "mw_thread.h"
+#    include <MSWSock.h>
+#else
+#    include "mw_platform.h"
+#    include <sys/mman.h>
+#endif
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace mw::net {
+
+class buffer_pool;
+class buffer_ref;
+
+namespace buffer_detail {
+
+    struct pool_slab;
+
+    /// <summary>
+    /// 一个缓冲区块的描述符，块的数据本身在slab中，描述符单独存放，这样数据可以完整地按页对齐
+    /// </summary>
+    struct alignas(MEMORY_ALLOCATION_ALIGNMENT) pool_chunk
+    {
+        /// <summary>空闲链表项，必须是第一个成员</summary>
+        SLIST_ENTRY entry;
+        char* data = nullptr;
+        buffer_pool* pool = nullptr;
+        pool_slab* slab = nullptr;
+        std::atomic<LONG> refs { 0 };
+        DWORD size = 0;
+    };
+
+    /// <summary>
+    /// 一次从系统分配的连续内存，包含多个块
+    /// </summary>
+    struct pool_slab
+    {
+        char* base = nullptr;
+        size_t size = 0;
+        /// <summary>块数，最后一个slab可能因为max_chunks而较少</summary>
+        size_t chunk_count = 0;
+#ifdef _WIN32
+        RIO_BUFFERID rio_id = RIO_INVALID_BUFFERID;
+#endif
+        std::unique_ptr<pool_chunk[]> chunks;
+    };
+
+} // namespace buffer_detail
+
+/// <summary>
+/// buffer_pool的统计信息
+/// </summary>
+struct buffer_pool_stats
+{
+    /// <summary>每个块的字节数</summary>
+    size_t chunk_size = 0;
+    /// <summary>已经从系统分配的块总数</summary>
+    size_t total_chunks = 0;
+    /// <summary>正在使用(引用计数不为0)的块数</summary>
+    size_t chunks_in_use = 0;
+    /// <summary>向系统申请内存的次数，稳定状态下它不应该再增长</summary>
+    ULONGLONG slab_allocations = 0;
+    /// <summary>acquire成功的次数</summary>
+    ULONGLONG acquired = 0;
+    /// <summary>因为达到max_chunks或内存不足而失败的acquire次数</summary>
+    ULONGLONG failed = 0;
+};
+
+/// <summary>
+/// 指向一个缓冲区块的引用计数句柄，复制句柄只增加引用计数而不复制数据，最后一个句柄被销毁时块回到它的池中
+/// </summary>
+/// <remarks>
+/// 块的数据和有效字节数(size)被所有引用它的句柄共享，只有当use_count为1时修改数据才是安全的
+/// </remarks>
+class buffer_ref
+{
+    friend class buffer_pool;
+
+public:
+    buffer_ref() = default;
+    buffer_ref(const buffer_ref& other)
+        : chunk(other.chunk)
+    {
+        if (chunk)
+            chunk->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+    buffer_ref(buffer_ref&& other) noexcept
+        : chunk(other.chunk)
+    {
+        other.chunk = nullptr;
+    }
+    buffer_ref& operator=(const buffer_ref& other)
+    {
+        if (this != &other)
+        {
+            buffer_ref temp(other);
+            std::swap(chunk, temp.chunk);
+        }
+        return *this;
+    }
+    buffer_ref& operator=(buffer_ref&& other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+            chunk = other.chunk;
+            other.chunk = nullptr;
+        }
+        return *this;
+    }
+    ~buffer_ref() { reset(); }
+
+public:
+    /// <summary>
+    /// 释放该句柄对块的引用
+    /// </summary>
+    inline void reset();
+
+    /// <summary>块的数据，按页对齐</summary>
+    char* data() const { return chunk->data; }
+    /// <summary>块中有效数据的字节数</summary>
+    size_t size() const { return chunk->size; }
+    /// <summary>设置块中有效数据的字节数，不能超过capacity</summary>
+    void set_size(size_t size) { chunk->size = static_cast<DWORD>(size); }
+    /// <summary>块的容量，即池的块大小</summary>
+    inline size_t capacity() const;
+    /// <summary>引用该块的句柄数量</summary>
+    LONG use_count() const { return chunk ? chunk->refs.load(std::memory_order_acquire) : 0; }
+
+    /// <summary>
+    /// 获取块中指定范围的WSABUF，可以直接用于WSARecv或WSASend(其他平台上由tcp_server转换为iovec)
+    /// </summary>
+    /// <param name="offset">范围的起始偏移</param>
+    /// <param name="length">范围的字节数</param>
+    WSABUF to_wsabuf(size_t offset, size_t length) const
+    {
+        return { static_cast<ULONG>(length), chunk->data + offset };
+    }
+
+    explicit operator bool() const { return chunk != nullptr; }
+
+private:
+    explicit buffer_ref(buffer_detail::pool_chunk* chunk)
+        : chunk(chunk)
+    {
+    }
+
+    buffer_detail::pool_chunk* chunk = nullptr;
+};
+
+/// <summary>
+/// 固定大小，按页对齐，带引用计数的套接字缓冲区池
+/// </summary>
+/// <remarks>
+/// 块从以slab为单位向系统申请的内存中切分，slab只在池被销毁时才归还系统，所以稳定状态下acquire和块的释放都不会分配内存。
+/// 每个处理器有自己的无锁空闲链表(SLIST)，块被释放时优先放回当前处理器的链表，超过per_core_cache时放回共享链表，
+/// acquire依次尝试当前处理器的链表，共享链表，其他处理器的链表，最后才分配新的slab。
+///
+/// 块的数据可以直接投递给WSARecv/WSASend，并且可以在不复制的情况下在连接之间传递(见tcp_connection::send)。
+/// 若系统支持Registered I/O，可以调用enable_registered_io把所有slab注册为RIO缓冲区，之后用registered_buffer获取块对应的RIO_BUF。
+/// 其他平台上slab由mmap分配，空闲链表是mw_platform.h中用互斥量实现的替代，没有Registered I/O。
+///
+/// 池必须在所有buffer_ref被销毁之后才能销毁
+/// </remarks>
+class buffer_pool
+{
+public:
+    buffer_pool(const buffer_pool&) = delete;
+    buffer_pool(buffer_pool&&) = delete;
+    buffer_pool& operator=(const buffer_pool&) = delete;
+    buffer_pool& operator=(buffer_pool&&) = delete;
+
+public:
+    /// <summary>
+    /// 创建缓冲区池，此时不分配任何块
+    /// </summary>
+    /// <param name="chunk_size">每个块的字节数，向上取整到页面大小的倍数</param>
+    /// <param name="chunks_per_slab">每次向系统申请的块数</param>
+    /// <param name="max_chunks">[opt]块总数的上限，达到上限后acquire返回空句柄，0表示不限制</param>
+    /// <param name="per_core_cache">每个处理器的空闲链表最多缓存的块数</param>
+    explicit buffer_pool(size_t chunk_size = 16 * 1024, size_t chunks_per_slab = 64, size_t max_chunks = 0, USHORT per_core_cache = 256)
+        : chunks_per_slab(chunks_per_slab ? chunks_per_slab : 1)
+        , max_chunks(max_chunks)
+        , per_core_cache(per_core_cache)
+    {
+#ifdef _WIN32
+        SYSTEM_INFO system_info = { 0 };
+        mw::get_system_info(system_info);
+        size_t page_size = system_info.dwPageSize;
+        core_count = system_info.dwNumberOfProcessors;
+#else
+        auto page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        // GetCurrentProcessorNumber返回的是处理器编号，按配置的处理器数而不是在线的处理器数取模
+        core_count = static_cast<DWORD>(sysconf(_SC_NPROCESSORS_CONF));
+#endif
+        this->chunk_size = (chunk_size + page_size - 1) / page_size * page_size;
+        if (!this->chunk_size)
+            this->chunk_size = page_size;
+
+        if (!core_count)
+            core_count = 1;
+        core_lists.reset(new SLIST_HEADER[core_count]);
+        for (DWORD i = 0; i < core_count; i++)
+            InitializeSListHead(&core_lists[i]);
+        InitializeSListHead(&shared_list);
+    }
+
+    ~buffer_pool()
+    {
+        for (auto& slab : slabs)
+        {
+#ifdef _WIN32
+            if (slab->rio_id != RIO_INVALID_BUFFERID)
+                rio.RIODeregisterBuffer(slab->rio_id);
+            mw::virtual_free(mw::get_current_process(), slab->base);
+#else
+            munmap(slab->base, slab->size);
+#endif
+        }
+    }
+
+    /// <summary>
+    /// 从池中获取一个块，块的有效字节数为0，引用计数为1
+    /// </summary>
+    /// <returns>若达到max_chunks或内存不足，返回空句柄</returns>
+    buffer_ref acquire()
+    {
+        auto chunk = pop_free();
+        if (!chunk)
+            chunk = grow();
+        if (!chunk)
+        {
+            failed.fetch_add(1, std::memory_order_relaxed);
+            return buffer_ref();
+        }
+        chunk->size = 0;
+        chunk->refs.store(1, std::memory_order_relaxed);
+        in_use.fetch_add(1, std::memory_order_relaxed);
+        acquired.fetch_add(1, std::memory_order_relaxed);
+        return buffer_ref(chunk);
+    }
+
+    /// <summary>
+    /// 预先分配块，使之后的acquire不需要再向系统申请内存
+    /// </summary>
+    /// <param name="count">至少要拥有的块总数</param>
+    /// <returns>若分配失败，返回false</returns>
+    bool reserve(size_t count)
+    {
+        bool succeeded = true;
+        std::lock_guard<std::mutex> guard(grow_lock);
+        while (total_chunks.load(std::memory_order_relaxed) < count)
+        {
+            auto slab = allocate_slab();
+            if (!slab)
+            {
+                succeeded = false;
+                break;
+            }
+            for (size_t i = 0; i < slab->chunk_count; i++)
+                InterlockedPushEntrySList(&shared_list, &slab->chunks[i].entry);
+        }
+        return succeeded;
+    }
+
+#ifdef _WIN32
+
+    /// <summary>
+    /// 使用Registered I/O注册池中所有已经分配和以后分配的slab
+    /// </summary>
+    /// <remarks>
+    /// 应在开始I/O之前调用。若系统不支持RIO(Windows 8之前)，返回false，池仍然可以正常用于普通的重叠I/O
+    /// </remarks>
+    /// <param name="socket">任意一个已经创建的套接字，用于获取RIO函数表</param>
+    /// <returns>操作是否成功</returns>
+    bool enable_registered_io(SOCKET socket)
+    {
+        std::lock_guard<std::mutex> guard(grow_lock);
+        if (rio_enabled)
+            return true;
+
+        GUID function_table_id = WSAID_MULTIPLE_RIO;
+        RIO_EXTENSION_FUNCTION_TABLE table = { 0 };
+        table.cbSize = sizeof(table);
+        DWORD bytes = 0;
+        if (WSAIoctl(socket, SIO_GET_MULTIPLE_EXTENSION_FUNCTION_POINTER, &function_table_id, sizeof(function_table_id),
+                &table, sizeof(table), &bytes, nullptr, nullptr)
+            == SOCKET_ERROR)
+        {
+            GET_ERROR_MSG_OUTPUT_SOCKET();
+            return false;
+        }
+        rio = table;
+        rio_enabled = true;
+        for (auto& slab : slabs)
+            register_slab(slab.get());
+        return true;
+    }
+
+    /// <summary>
+    /// 获取块中指定范围对应的RIO_BUF，用于RIOReceive和RIOSend
+    /// </summary>
+    /// <param name="buffer">池中的块</param>
+    /// <param name="offset">范围的起始偏移</param>
+    /// <param name="length">范围的字节数</param>
+    /// <param name="result">[out]对应的RIO_BUF</param>
+    /// <returns>若没有启用Registered I/O或该块所在的slab注册失败，返回false</returns>
+    bool registered_buffer(const buffer_ref& buffer, size_t offset, size_t length, RIO_BUF& result) const
+    {
+        auto slab = buffer.chunk->slab;
+        if (slab->rio_id == RIO_INVALID_BUFFERID)
+            return false;
+        result.BufferId = slab->rio_id;
+        result.Offset = static_cast<ULONG>(buffer.chunk->data - slab->base + offset);
+        result.Length = static_cast<ULONG>(length);
+        return true;
+    }
+#endif
+
+    /// <summary>
+    /// 获取统计信息
+    /// </summary>
+    buffer_pool_stats stats() const
+    {
+        buffer_pool_stats result;
+        result.chunk_size = chunk_size;
+        result.total_chunks = total_chunks.load(std::memory_order_relaxed);
+        result.chunks_in_use = in_use.load(std::memory_order_relaxed);
+        result.slab_allocations = slab_allocations.load(std::memory_order_relaxed);
+        result.acquired = acquired.load(std::memory_order_relaxed);
+        result.failed = failed.load(std::memory_order_relaxed);
+        return result;
+    }
+
+    size_t get_chunk_size() const { return chunk_size; }
+    /// <summary>块总数的上限，0表示不限制</summary>
+    size_t get_max_chunks() const { return max_chunks; }
+    bool is_registered_io_enabled() const { return rio_enabled; }
+
+private:
+    friend class buffer_ref;
+
+    /// <summary>
+    /// 块的引用计数变为0时调用，把块放回当前处理器的空闲链表
+    /// </summary>
+    void release(buffer_detail::pool_chunk* chunk)
+    {
+        in_use.fetch_sub(1, std::memory_order_relaxed);
+        auto list = &core_lists[GetCurrentProcessorNumber() % core_count];
+        if (QueryDepthSList(list) >= per_core_cache)
+            list = &shared_list;
+        InterlockedPushEntrySList(list, &chunk->entry);
+    }
+
+    buffer_detail::pool_chunk* pop_free()
+    {
+        auto current = GetCurrentProcessorNumber() % core_count;
+        auto entry = InterlockedPopEntrySList(&core_lists[current]);
+        if (!entry)
+            entry = InterlockedPopEntrySList(&shared_list);
+        for (DWORD i = 1; !entry && i < core_count; i++)
+            entry = InterlockedPopEntrySList(&core_lists[(current + i) % core_count]);
+        return reinterpret_cast<buffer_detail::pool_chunk*>(entry);
+    }
+
+    buffer_detail::pool_chunk* grow()
+    {
+        std::lock_guard<std::mutex> guard(grow_lock);
+        // 等待锁期间其他线程可能已经分配了新的slab或释放了块
+        buffer_detail::pool_chunk* chunk = reinterpret_cast<buffer_detail::pool_chunk*>(InterlockedPopEntrySList(&shared_list));
+        if (!chunk)
+        {
+            if (auto slab = allocate_slab())
+            {
+                // 第一个块直接返回，其余的放入共享链表
+                for (size_t i = 1; i < slab->chunk_count; i++)
+                    InterlockedPushEntrySList(&shared_list, &slab->chunks[i].entry);
+                chunk = &slab->chunks[0];
+            }
+        }
+        return chunk;
+    }
+
+    /// <summary>
+    /// 分配一个新的slab，调用者需要持有grow_lock
+    /// </summary>
+    buffer_detail::pool_slab* allocate_slab()
+    {
+        auto count = chunks_per_slab;
+        if (max_chunks)
+        {
+            auto total = total_chunks.load(std::memory_order_relaxed);
+            if (total >= max_chunks)
+                return nullptr;
+            if (count > max_chunks - total)
+                count = max_chunks - total;
+        }
+
+        auto size = count * chunk_size;
+#ifdef _WIN32
+        auto base = static_cast<char*>(mw::virtual_alloc(mw::get_current_process(), size, nullptr, MEM_RESERVE | MEM_COMMIT));
+        if (!base)
+            return nullptr;
+#else
+        auto base = static_cast<char*>(mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+        if (base == MAP_FAILED)
+            return nullptr;
+#endif
+
+        auto slab = std::make_unique<buffer_detail::pool_slab>();
+        slab->base = base;
+        slab->size = size;
+        slab->chunk_count = count;
+        slab->chunks.reset(new buffer_detail::pool_chunk[count]);
+        for (size_t i = 0; i < count; i++)
+        {
+            auto& chunk = slab->chunks[i];
+            chunk.data = base + i * chunk_size;
+            chunk.pool = this;
+            chunk.slab = slab.get();
+        }
+#ifdef _WIN32
+        if (rio_enabled)
+            register_slab(slab.get());
+#endif
+
+        slab_allocations.fetch_add(1, std::memory_order_relaxed);
+        total_chunks.fetch_add(count, std::memory_order_relaxed);
+        slabs.push_back(std::move(slab));
+        return slabs.back().get();
+    }
+
+#ifdef _WIN32
+    void register_slab(buffer_detail::pool_slab* slab)
+    {
+        slab->rio_id = rio.RIORegisterBuffer(slab->base, static_cast<DWORD>(slab->size));
+    }
+#endif
+
+    size_t chunk_size;
+    size_t chunks_per_slab;
+    size_t max_chunks;
+    USHORT per_core_cache;
+
+    DWORD core_count;
+    std::unique_ptr<SLIST_HEADER[]> core_lists;
+    SLIST_HEADER shared_list;
+
+    /// <summary>保护slabs和RIO注册，只在分配新slab时使用</summary>
+    std::mutex grow_lock;
+    std::vector<std::unique_ptr<buffer_detail::pool_slab>> slabs;
+#ifdef _WIN32
+    RIO_EXTENSION_FUNCTION_TABLE rio = { 0 };
+#endif
+    bool rio_enabled = false;
+
+    std::atomic<size_t> total_chunks { 0 };
+    std::atomic<size_t> in_use { 0 };
+    std::atomic<ULONGLONG> slab_allocations { 0 };
+    std::atomic<ULONGLONG> acquired { 0 };
+    std::atomic<ULONGLONG> failed { 0 };
+};
+
+inline void buffer_ref::reset()
+{
+    if (chunk && chunk->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        chunk->pool->release(chunk);
+    chunk = nullptr;
+}
+
+inline size_t buffer_ref::capacity() const
+{
+    return chunk->pool->get_chunk_size();
+}
+
+} // namespace mw::net
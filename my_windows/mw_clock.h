@@ -0,0 +1,394 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ratio>
+#include <thread>
+#include <utility>
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#    define MW_CLOCK_TSC
+#    if defined(_MSC_VER)
+#        include <intrin.h>
+#    else
+#        include <cpuid.h>
+#        include <x86intrin.h>
+#    endif
+#endif
+#ifndef _WIN32
+#    include <time.h>
+#endif
+
+namespace mw {
+namespace clock {
+
+    /// <summary>
+    /// 以100纳秒为单位的时长，与FILETIME和线程池计时器的单位相同
+    /// </summary>
+    using hundred_ns = std::chrono::duration<std::int64_t, std::ratio<1, 10000000>>;
+
+    /// <summary>
+    /// FILETIME的起点(1601-01-01)到Unix纪元(1970-01-01)的100纳秒数
+    /// </summary>
+    constexpr std::uint64_t file_time_unix_epoch = 116444736000000000ULL;
+
+    namespace detail {
+        /// <summary>
+        /// 计算value * numerator / denominator，先除后乘，在value很大时不会溢出
+        /// </summary>
+        constexpr std::uint64_t scale(std::uint64_t value, std::uint64_t numerator, std::uint64_t denominator)
+        {
+            return value / denominator * numerator + value % denominator * numerator / denominator;
+        }
+
+        inline std::uint64_t query_frequency()
+        {
+#ifdef _WIN32
+            LARGE_INTEGER frequency;
+            QueryPerformanceFrequency(&frequency);
+            return static_cast<std::uint64_t>(frequency.QuadPart);
+#else
+            return 1000000000ULL;
+#endif
+        }
+    } // namespace detail
+
+    /// <summary>
+    /// 单调时钟每秒的计数，程序运行期间不变，第一次调用时查询
+    /// </summary>
+    inline std::uint64_t ticks_per_second()
+    {
+        static const std::uint64_t frequency = detail::query_frequency();
+        return frequency;
+    }
+
+    /// <summary>
+    /// 单调时钟的当前计数(Windows上为QueryPerformanceCounter，其他平台上为CLOCK_MONOTONIC的纳秒数)
+    /// </summary>
+    inline std::uint64_t now_ticks() noexcept
+    {
+#ifdef _WIN32
+        LARGE_INTEGER counter;
+        QueryPerformanceCounter(&counter);
+        return static_cast<std::uint64_t>(counter.QuadPart);
+#else
+        timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return static_cast<std::uint64_t>(now.tv_sec) * 1000000000ULL + static_cast<std::uint64_t>(now.tv_nsec);
+#endif
+    }
+
+    /// <summary>
+    /// 将单调时钟的计数转换为纳秒
+    /// </summary>
+    inline std::uint64_t ticks_to_ns(std::uint64_t ticks)
+    {
+        // 常见的频率(Windows上的10MHz，Linux上的1GHz)整除10^9，只需要一次乘法
+        static const std::uint64_t multiplier = 1000000000ULL % ticks_per_second() == 0 ? 1000000000ULL / ticks_per_second() : 0;
+        return multiplier ? ticks * multiplier : detail::scale(ticks, 1000000000ULL, ticks_per_second());
+    }
+
+    /// <summary>
+    /// 单调时钟的当前纳秒数，起点不确定，只用于计算时间间隔
+    /// </summary>
+    inline std::uint64_t now_ns() { return ticks_to_ns(now_ticks()); }
+
+    /// <summary>
+    /// 高精度单调时钟，满足std::chrono的Clock要求，分辨率通常小于1微秒。
+    /// get_system_time(GetTickCount64)的分辨率约为15毫秒，只适合计算超时，测量耗时应该使用它或tsc_clock
+    /// </summary>
+    struct monotonic_clock
+    {
+        using rep = std::int64_t;
+        using period = std::nano;
+        using duration = std::chrono::nanoseconds;
+        using time_point = std::chrono::time_point<monotonic_clock>;
+        static constexpr bool is_steady = true;
+
+        static time_point now() { return time_point(duration(static_cast<rep>(now_ns()))); }
+    };
+
+    /// <summary>
+    /// 读取时间戳计数器(TSC)，没有TSC的平台上返回单调时钟的计数。它不是串行化指令，测量很短的代码时可能与相邻的指令重排
+    /// </summary>
+    inline std::uint64_t read_tsc() noexcept
+    {
+#ifdef MW_CLOCK_TSC
+        return __rdtsc();
+#else
+        return now_ticks();
+#endif
+    }
+
+    /// <summary>
+    /// 使用时间戳计数器的快速单调时钟，满足std::chrono的Clock要求，读取一次只需要十几个时钟周期
+    /// </summary>
+    /// <remarks>
+    /// 第一次调用now()时检查处理器是否支持不变的TSC(CPUID 0x80000007的EDX第8位，频率不随节能状态变化，各个核心同步)，
+    /// 支持时用monotonic_clock校准约10毫秒，得到每个TSC计数的纳秒数，之后的now()只读取TSC并做一次浮点乘法；
+    /// 不支持时(旧处理器，非x86平台，某些虚拟机)now()退化为monotonic_clock::now()。
+    /// 两个时钟的起点相同，可以互相比较，但是TSC的频率误差会随时间累积，长时间(数小时)的间隔应该使用monotonic_clock
+    /// </remarks>
+    struct tsc_clock
+    {
+        using rep = std::int64_t;
+        using period = std::nano;
+        using duration = std::chrono::nanoseconds;
+        using time_point = std::chrono::time_point<tsc_clock>;
+        static constexpr bool is_steady = true;
+
+        static time_point now() { return from_raw(raw_now()); }
+
+        /// <summary>
+        /// 读取未转换的计数(TSC可用时为TSC，否则为纳秒数)，用from_raw转换，适合先记录计数，之后再批量转换的热路径
+        /// </summary>
+        static std::uint64_t raw_now() { return calibration().invariant ? read_tsc() : now_ns(); }
+
+        /// <summary>
+        /// 将raw_now的返回值转换为时间点
+        /// </summary>
+        static time_point from_raw(std::uint64_t raw)
+        {
+            auto& state = calibration();
+            if (!state.invariant)
+                return time_point(duration(static_cast<rep>(raw)));
+            // 其他核心上读到的TSC可能略小于校准时的值，所以按有符号数计算
+            auto elapsed = static_cast<double>(static_cast<std::int64_t>(raw - state.base_tsc)) * state.ns_per_tick;
+            return time_point(duration(static_cast<rep>(state.base_ns) + static_cast<rep>(elapsed)));
+        }
+
+        /// <summary>
+        /// 是否使用了TSC，为false时now()与monotonic_clock相同
+        /// </summary>
+        static bool available() { return calibration().invariant; }
+
+        /// <summary>
+        /// 校准得到的TSC频率(每秒的计数)，不可用时返回0
+        /// </summary>
+        static double frequency()
+        {
+            auto& state = calibration();
+            return state.invariant ? 1e9 / state.ns_per_tick : 0.0;
+        }
+
+        /// <summary>
+        /// 在程序启动时调用，避免第一次测量包含校准的时间
+        /// </summary>
+        static void calibrate() { calibration(); }
+
+    private:
+        struct calibration_state
+        {
+            bool invariant = false;
+            std::uint64_t base_tsc = 0;
+            std::uint64_t base_ns = 0;
+            double ns_per_tick = 0.0;
+        };
+
+        static bool has_invariant_tsc()
+        {
+#ifdef MW_CLOCK_TSC
+#    if defined(_MSC_VER)
+            int registers[4] = {};
+            __cpuid(registers, 0x80000000);
+            if (static_cast<unsigned>(registers[0]) < 0x80000007)
+                return false;
+            __cpuid(registers, 0x80000007);
+            return (registers[3] & (1 << 8)) != 0;
+#    else
+            unsigned eax = 0, ebx = 0, ecx = 0, edx = 0;
+            if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx))
+                return false;
+            return (edx & (1u << 8)) != 0;
+#    endif
+#else
+            return false;
+#endif
+        }
+
+        static const calibration_state& calibration()
+        {
+            // 函数内的静态变量只初始化一次，其他线程会等待初始化完成
+            static const calibration_state state = [] {
+                calibration_state result;
+                if (!has_invariant_tsc())
+                    return result;
+                auto begin_ns = now_ns();
+                auto begin_tsc = read_tsc();
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                auto end_ns = now_ns();
+                auto end_tsc = read_tsc();
+                if (end_tsc <= begin_tsc || end_ns <= begin_ns)
+                    return result;
+                result.invariant = true;
+                result.ns_per_tick = static_cast<double>(end_ns - begin_ns) / static_cast<double>(end_tsc - begin_tsc);
+                result.base_tsc = end_tsc;
+                result.base_ns = end_ns;
+                return result;
+            }();
+            return state;
+        }
+    };
+
+    /// <summary>
+    /// 计时器，构造时开始计时
+    /// </summary>
+    template <typename Clock = tsc_clock>
+    class basic_stopwatch
+    {
+    public:
+        basic_stopwatch()
+            : start_time(Clock::now())
+        {
+        }
+
+        /// <summary>
+        /// 重新开始计时，返回之前经过的时间
+        /// </summary>
+        typename Clock::duration restart()
+        {
+            auto now = Clock::now();
+            auto elapsed = now - start_time;
+            start_time = now;
+            return elapsed;
+        }
+
+        /// <summary>
+        /// 从开始计时到现在经过的时间
+        /// </summary>
+        typename Clock::duration elapsed() const { return Clock::now() - start_time; }
+
+        /// <summary>
+        /// 以指定的时长类型返回经过的时间，例如elapsed_as&lt;std::chrono::duration&lt;double, std::milli&gt;&gt;().count()
+        /// </summary>
+        template <typename Duration>
+        Duration elapsed_as() const { return std::chrono::duration_cast<Duration>(elapsed()); }
+
+        std::int64_t elapsed_ns() const { return std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed()).count(); }
+        double elapsed_ms() const { return std::chrono::duration<double, std::milli>(elapsed()).count(); }
+
+    private:
+        typename Clock::time_point start_time;
+    };
+
+    using stopwatch = basic_stopwatch<>;
+
+    /// <summary>
+    /// 作用域计时器，析构时把经过的时间(Clock::duration)传给sink，sink可以累加到计数器或记录到直方图
+    /// </summary>
+    /// <example>
+    /// std::atomic&lt;std::int64_t&gt; total_ns { 0 };
+    /// {
+    ///     mw::clock::scoped_timer timer([&amp;](auto elapsed) { total_ns += elapsed.count(); });
+    ///     ...
+    /// }
+    /// </example>
+    template <typename Sink, typename Clock = tsc_clock>
+    class scoped_timer
+    {
+    public:
+        explicit scoped_timer(Sink sink)
+            : sink(std::move(sink))
+            , start_time(Clock::now())
+        {
+        }
+
+        ~scoped_timer() { sink(Clock::now() - start_time); }
+
+        scoped_timer(const scoped_timer&) = delete;
+        scoped_timer& operator=(const scoped_timer&) = delete;
+
+    private:
+        Sink sink;
+        typename Clock::time_point start_time;
+    };
+
+    /// <summary>
+    /// 将经过的纳秒数累加到计数器的作用域计时器
+    /// </summary>
+    template <typename Clock = tsc_clock>
+    class scoped_accumulator
+    {
+    public:
+        explicit scoped_accumulator(std::atomic<std::uint64_t>& total_ns)
+            : total_ns(total_ns)
+            , start_time(Clock::now())
+        {
+        }
+
+        ~scoped_accumulator()
+        {
+            auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start_time).count();
+            total_ns.fetch_add(static_cast<std::uint64_t>(elapsed), std::memory_order_relaxed);
+        }
+
+        scoped_accumulator(const scoped_accumulator&) = delete;
+        scoped_accumulator& operator=(const scoped_accumulator&) = delete;
+
+    private:
+        std::atomic<std::uint64_t>& total_ns;
+        typename Clock::time_point start_time;
+    };
+
+    /// <summary>
+    /// 将Unix纪元以来的纳秒数转换为FILETIME的100纳秒数
+    /// </summary>
+    constexpr std::uint64_t unix_ns_to_file_time(std::uint64_t unix_ns) { return unix_ns / 100 + file_time_unix_epoch; }
+
+    /// <summary>
+    /// 将FILETIME的100纳秒数转换为Unix纪元以来的纳秒数，早于1970年的时间返回0
+    /// </summary>
+    constexpr std::uint64_t file_time_to_unix_ns(std::uint64_t file_time)
+    {
+        return file_time < file_time_unix_epoch ? 0 : (file_time - file_time_unix_epoch) * 100;
+    }
+
+    /// <summary>
+    /// 当前的系统时间(UTC)，Unix纪元以来的纳秒数，Windows上的精度为100纳秒。它会随系统时间调整跳变，不能用于测量耗时
+    /// </summary>
+    inline std::uint64_t system_time_ns()
+    {
+#ifdef _WIN32
+        FILETIME now;
+        GetSystemTimePreciseAsFileTime(&now);
+        return file_time_to_unix_ns(static_cast<std::uint64_t>(now.dwHighDateTime) << 32 | now.dwLowDateTime);
+#else
+        timespec now;
+        clock_gettime(CLOCK_REALTIME, &now);
+        return static_cast<std::uint64_t>(now.tv_sec) * 1000000000ULL + static_cast<std::uint64_t>(now.tv_nsec);
+#endif
+    }
+
+#ifdef _WIN32
+    /// <summary>
+    /// 将FILETIME转换为64位的100纳秒数(包括32位程序)，可以是时间点(1601年以来)或时长(get_thread_times的内核和用户时间)
+    /// </summary>
+    constexpr std::uint64_t to_100ns(const FILETIME& ft)
+    {
+        return static_cast<std::uint64_t>(ft.dwHighDateTime) << 32 | ft.dwLowDateTime;
+    }
+
+    /// <summary>
+    /// 将FILETIME表示的时长转换为std::chrono的时长
+    /// </summary>
+    constexpr hundred_ns to_duration(const FILETIME& ft) { return hundred_ns(static_cast<std::int64_t>(to_100ns(ft))); }
+
+    /// <summary>
+    /// 将64位的100纳秒数拆分为FILETIME
+    /// </summary>
+    constexpr FILETIME to_file_time(std::uint64_t value)
+    {
+        return FILETIME { static_cast<DWORD>(value), static_cast<DWORD>(value >> 32) };
+    }
+
+    /// <summary>
+    /// 生成相对于现在的FILETIME(负数)，用于set_threadpool_timer和set_waitable_timer的到期时间
+    /// </summary>
+    template <typename Rep, typename Period>
+    constexpr FILETIME relative_file_time(std::chrono::duration<Rep, Period> due)
+    {
+        return to_file_time(static_cast<std::uint64_t>(-std::chrono::duration_cast<hundred_ns>(due).count()));
+    }
+#endif // _WIN32
+
+} // namespace clock
+} // namespace mw
@@ -0,0 +1,948 @@
+#pragma once
+#include "mw_clock.h"
+#include "mw_tcp_server.h"
+#include "mw_timer_wheel.h"
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#ifndef _WIN32
+#    include <condition_variable>
+#    include <mutex>
+#    include <system_error>
+#    include <thread>
+#endif
+
+namespace mw::net {
+
+/// <summary>
+/// connection_pool的选项，数量限制都是针对每个端点的
+/// </summary>
+struct connection_pool_options
+{
+    /// <summary>保持的最少空闲连接数，不足时在后台建立连接补充</summary>
+    size_t min_idle = 0;
+    /// <summary>最多保留的空闲连接数，归还时超过它的连接会被关闭</summary>
+    size_t max_idle = 8;
+    /// <summary>最多同时存在的连接数(包括正在连接，空闲和租用中的连接)，达到时checkout需要等待其他连接归还</summary>
+    size_t max_connections = 64;
+    /// <summary>空闲连接的存活时间(毫秒)，超过后被关闭(但保留min_idle个)</summary>
+    DWORD idle_timeout = 60 * 1000;
+    /// <summary>checkout等待连接的最长时间(毫秒)，超时后以WSAETIMEDOUT失败，若为0则不超时</summary>
+    DWORD checkout_timeout = 5 * 1000;
+    /// <summary>连续连接失败多少次后认为端点不可用，之后的checkout在退避时间内立即失败</summary>
+    DWORD failure_threshold = 3;
+    /// <summary>端点不可用后第一次退避的毫秒数，之后每次探测失败都翻倍</summary>
+    DWORD initial_backoff = 100;
+    /// <summary>最长的退避毫秒数</summary>
+    DWORD max_backoff = 30 * 1000;
+    /// <summary>维护计时器的周期(毫秒)，也是时间轮的刻度，空闲回收和等待超时的精度都是它</summary>
+    DWORD tick = 100;
+    /// <summary>内部tcp_server的选项</summary>
+    tcp_server_options server_options;
+};
+
+/// <summary>
+/// 端点的健康状态
+/// </summary>
+enum class endpoint_health
+{
+    /// <summary>最近一次连接成功</summary>
+    healthy,
+    /// <summary>最近的连接失败了，但还没有达到failure_threshold</summary>
+    degraded,
+    /// <summary>连续失败达到failure_threshold，checkout在退避时间内立即失败，之后允许一次探测连接</summary>
+    down,
+};
+
+/// <summary>
+/// connection_pool的统计信息
+/// </summary>
+struct connection_pool_stats
+{
+    /// <summary>等待时间直方图的桶数，第i个桶统计等待时间在[2^(i-1), 2^i)微秒的checkout，第0个桶是0微秒</summary>
+    static constexpr size_t wait_buckets = 32;
+
+    ULONGLONG checkouts = 0;
+    /// <summary>使用空闲连接或归还的连接完成的checkout数</summary>
+    ULONGLONG reused = 0;
+    ULONGLONG connects = 0;
+    ULONGLONG connect_failures = 0;
+    /// <summary>因为端点不可用而立即失败的checkout数</summary>
+    ULONGLONG rejected = 0;
+    /// <summary>等待超时的checkout数</summary>
+    ULONGLONG timeouts = 0;
+    /// <summary>因为空闲超时而关闭的连接数</summary>
+    ULONGLONG evicted = 0;
+
+    /// <summary>成功的checkout的等待时间(微秒)</summary>
+    ULONGLONG wait_count = 0;
+    ULONGLONG total_wait_time = 0;
+    ULONGLONG max_wait_time = 0;
+    ULONGLONG wait_histogram[wait_buckets] = { 0 };
+
+    size_t idle = 0;
+    size_t leased = 0;
+    size_t connecting = 0;
+    size_t waiting = 0;
+    /// <summary>当前记录的端点数，没有连接和等待的端点在维护计时器中被删除</summary>
+    size_t endpoints = 0;
+
+    /// <summary>
+    /// 根据直方图估算等待时间的百分位数(微秒)，返回所在桶的上界
+    /// </summary>
+    /// <param name="percentile">百分位，例如0.99</param>
+    ULONGLONG wait_percentile(double percentile) const
+    {
+        if (!wait_count)
+            return 0;
+        auto target = static_cast<ULONGLONG>(percentile * wait_count);
+        ULONGLONG seen = 0;
+        for (size_t i = 0; i < wait_buckets; i++)
+        {
+            seen += wait_histogram[i];
+            if (seen > target || seen == wait_count)
+                return i ? (static_cast<ULONGLONG>(1) << i) - 1 : 0;
+        }
+        return max_wait_time;
+    }
+};
+
+/// <summary>
+/// 租用中的连接的事件回调，它们在连接所属的反应器线程中被调用
+/// </summary>
+struct connection_pool_handler
+{
+    /// <summary>租用中的连接收到数据，含义同tcp_handler::on_data</summary>
+    std::function<size_t(tcp_connection&, const char*, size_t)> on_data;
+    /// <summary>租用中的连接被关闭(对端关闭或出错)后调用，之后不需要再release它</summary>
+    std::function<void(tcp_connection&)> on_close;
+};
+
+/// <summary>
+/// checkout的回调，参数是租用的连接和错误代码。成功时连接不为nullptr，错误代码为0，回调在连接所属的反应器线程中被调用；
+/// 失败时连接为nullptr，回调可能在任意线程中被调用
+/// </summary>
+using checkout_callback = std::function<void(tcp_connection*, int)>;
+
+namespace pool_detail {
+
+    enum class slot_state
+    {
+        connecting,
+        idle,
+        leased,
+        /// <summary>已经从空闲链表中取出，正在被交给反应器线程(交给checkout或被回收)</summary>
+        transit,
+        closing,
+    };
+
+    struct endpoint;
+
+    struct pooled_connection
+    {
+        endpoint* owner = nullptr;
+        tcp_connection* connection = nullptr;
+        DWORD reactor = 0;
+        std::atomic<slot_state> state { slot_state::connecting };
+        /// <summary>transit期间连接已经被关闭，记录由接手的反应器线程删除</summary>
+        bool dead = false;
+        void* user_data = nullptr;
+        ULONGLONG idle_timer = 0;
+        /// <summary>transit期间等待这个连接的checkout</summary>
+        checkout_callback handoff;
+        std::chrono::steady_clock::time_point handoff_start;
+
+        pooled_connection* prev = nullptr;
+        pooled_connection* next = nullptr;
+    };
+
+    struct waiter
+    {
+        ULONGLONG id;
+        checkout_callback callback;
+        void* user_data;
+        std::chrono::steady_clock::time_point start;
+        ULONGLONG timer;
+    };
+
+    struct endpoint
+    {
+        sockaddr_storage address = {};
+        int address_len = 0;
+        /// <summary>空闲连接，后进先出，这样最近使用过的连接先被复用，多余的连接可以空闲超时</summary>
+        std::vector<pooled_connection*> idle;
+        std::deque<waiter> waiters;
+        /// <summary>所有未关闭的连接数</summary>
+        size_t total = 0;
+        /// <summary>引用该端点的连接记录数，包括已经关闭但还未删除的记录，不为0时端点不能被删除</summary>
+        size_t records = 0;
+        size_t connecting = 0;
+        size_t leased = 0;
+
+        endpoint_health health = endpoint_health::healthy;
+        DWORD consecutive_failures = 0;
+        DWORD backoff = 0;
+        ULONGLONG retry_time = 0;
+        int last_error = 0;
+        bool probing = false;
+    };
+
+    /// <summary>
+    /// 时间轮中的计时器，waiter_id为0表示空闲连接的回收
+    /// </summary>
+    struct pool_timer
+    {
+        endpoint* owner;
+        pooled_connection* connection;
+        ULONGLONG waiter_id;
+    };
+
+    /// <summary>
+    /// 在释放锁之后调用的失败回调
+    /// </summary>
+    struct failed_checkout
+    {
+        checkout_callback callback;
+        int error;
+    };
+
+} // namespace pool_detail
+
+/// <summary>
+/// 按端点区分的出站连接池，复用已建立的TCP连接，避免每个请求都建立新连接
+/// </summary>
+/// <remarks>
+/// 连接池内部有一个只用于主动连接的tcp_server，连接通过它的反应器异步建立，连接建立后的所有回调都在连接所属的反应器线程中执行。
+/// checkout可以在任意线程中调用，有空闲连接时它被交给连接所属的反应器线程，再调用回调；没有空闲连接且未达到max_connections时建立新连接；
+/// 否则等待其他连接归还，等待超过checkout_timeout后失败。使用完毕后在回调中调用release归还连接。
+///
+/// 空闲连接的回收和等待的超时由时间轮管理，维护计时器每tick毫秒推进一次时间轮，并补充min_idle个空闲连接。
+/// 空闲连接收到数据或被对端关闭时直接关闭，不会交给使用者。
+///
+/// 端点连续连接失败failure_threshold次后变为不可用，之后的checkout立即失败，直到退避时间结束后允许一次探测连接，
+/// 探测成功则恢复，失败则退避时间翻倍。没有连接和等待的端点(不可用的端点要等退避结束)在维护计时器中被删除。
+/// 连接池使用tcp_connection::user_data保存自己的数据，使用者请使用get_user_data。
+/// 使用前需要调用socket_startup。其他平台上维护计时器是一个自己的线程
+/// </remarks>
+class connection_pool
+{
+public:
+    explicit connection_pool(connection_pool_handler handler, const connection_pool_options& options = connection_pool_options())
+        : handler(std::move(handler))
+        , options(options)
+        , server(make_server_handler(), options.server_options)
+        , wheel(options.tick)
+    {
+    }
+    ~connection_pool()
+    {
+        stop();
+    }
+    connection_pool(const connection_pool&) = delete;
+    connection_pool(connection_pool&&) = delete;
+    connection_pool& operator=(const connection_pool&) = delete;
+    connection_pool& operator=(connection_pool&&) = delete;
+
+public:
+    /// <summary>
+    /// 启动内部的tcp_server和维护计时器
+    /// </summary>
+    /// <returns>操作是否成功</returns>
+    bool start()
+    {
+#ifdef _WIN32
+        if (timer)
+            return true;
+#else
+        if (maintainer.joinable())
+            return true;
+#endif
+        stopping = false;
+        if (!server.start())
+            return false;
+#ifdef _WIN32
+        timer = mw::create_threadpool_timer(timer_callback, this);
+        if (!timer)
+        {
+            server.stop();
+            return false;
+        }
+        auto due_time = mw::clock::relative_file_time(std::chrono::milliseconds(options.tick));
+        mw::set_threadpool_timer(timer, &due_time, options.tick, options.tick / 4);
+#else
+        maintainer_stopping = false;
+        try
+        {
+            maintainer = std::thread([this] { maintainer_loop(); });
+        }
+        catch (const std::system_error&)
+        {
+            server.stop();
+            return false;
+        }
+#endif
+        return true;
+    }
+
+    /// <summary>
+    /// 关闭所有连接，等待中的checkout以WSAESHUTDOWN失败
+    /// </summary>
+    /// <param name="timeout">等待连接优雅关闭的毫秒数，含义同tcp_server::stop</param>
+    void stop(DWORD timeout = 5000)
+    {
+#ifdef _WIN32
+        if (!timer)
+            return;
+#else
+        if (!maintainer.joinable())
+            return;
+#endif
+        lock.acquire_exclusive();
+        stopping = true;
+        lock.release_exclusive();
+
+#ifdef _WIN32
+        mw::set_threadpool_timer(timer, nullptr);
+        mw::wait_for_threadpool_timer_callbacks(timer, true);
+        mw::close_threadpool_timer(timer);
+        timer = nullptr;
+#else
+        {
+            std::lock_guard<std::mutex> guard(maintainer_lock);
+            maintainer_stopping = true;
+        }
+        maintainer_wake.notify_one();
+        maintainer.join();
+#endif
+
+        server.stop(timeout);
+
+        // 反应器已经退出，剩下的只有被丢弃的post调用还持有的连接记录
+        std::vector<pool_detail::failed_checkout> failed;
+        lock.acquire_exclusive();
+        while (all_head)
+        {
+            auto record = all_head;
+            if (record->handoff)
+                failed.push_back({ std::move(record->handoff), WSAESHUTDOWN });
+            destroy(record);
+        }
+        for (auto& pair : endpoints)
+        {
+            auto& ep = *pair.second;
+            for (auto& waiter : ep.waiters)
+                failed.push_back({ std::move(waiter.callback), WSAESHUTDOWN });
+            ep.waiters.clear();
+            ep.idle.clear();
+            ep.total = ep.connecting = ep.leased = ep.records = 0;
+        }
+        wheel.clear();
+        lock.release_exclusive();
+
+        for (auto& checkout : failed)
+            checkout.callback(nullptr, checkout.error);
+    }
+
+    /// <summary>
+    /// 租用一个到指定端点的连接，可以在任意线程中调用
+    /// </summary>
+    /// <param name="address">远程地址，相同的地址字节被视为同一个端点</param>
+    /// <param name="address_len">address的长度</param>
+    /// <param name="callback">得到连接或失败时调用，见checkout_callback</param>
+    /// <param name="user_data">[opt]与这次租用关联的数据，可以在回调中用get_user_data获取</param>
+    void checkout(const sockaddr* address, int address_len, checkout_callback callback, void* user_data = nullptr)
+    {
+        auto start = std::chrono::steady_clock::now();
+        std::vector<pool_detail::failed_checkout> failed;
+        pool_detail::pooled_connection* record = nullptr;
+
+        lock.acquire_exclusive();
+        statistics.checkouts++;
+        auto ep = find_endpoint(address, address_len);
+        if (stopping || !ep)
+            failed.push_back({ std::move(callback), stopping ? WSAESHUTDOWN : WSAEINVAL });
+        else if (ep->health == endpoint_health::down && (ep->probing || mw::get_system_time() < ep->retry_time))
+        {
+            statistics.rejected++;
+            failed.push_back({ std::move(callback), ep->last_error });
+        }
+        else if (!ep->idle.empty())
+        {
+            record = ep->idle.back();
+            ep->idle.pop_back();
+            wheel.cancel(record->idle_timer);
+            record->state = pool_detail::slot_state::transit;
+            record->user_data = user_data;
+            record->handoff = std::move(callback);
+            record->handoff_start = start;
+            ep->leased++;
+            statistics.reused++;
+            hand_over(record, failed);
+        }
+        else
+        {
+            enqueue(ep, { 0, std::move(callback), user_data, start, 0 });
+            fill(ep, failed);
+        }
+        lock.release_exclusive();
+
+        for (auto& checkout : failed)
+            checkout.callback(nullptr, checkout.error);
+    }
+
+    /// <summary>
+    /// 归还一个租用的连接，必须在连接所属的反应器线程中(即连接的回调中)调用
+    /// </summary>
+    /// <remarks>
+    /// 若有等待的checkout，连接被直接交给它(在这次调用中调用它的回调)，否则成为空闲连接。
+    /// 若reusable为false(例如协议状态已经不确定)，或空闲连接已经足够，连接被关闭
+    /// </remarks>
+    /// <param name="connection">checkout得到的连接</param>
+    /// <param name="reusable">连接是否可以被复用</param>
+    void release(tcp_connection& connection, bool reusable = true)
+    {
+        auto record = static_cast<pool_detail::pooled_connection*>(connection.user_data);
+        if (!record || record->state != pool_detail::slot_state::leased)
+            return;
+
+        checkout_callback next;
+        lock.acquire_exclusive();
+        auto ep = record->owner;
+        ep->leased--;
+        record->user_data = nullptr;
+        if (!reusable || stopping || connection.is_closing() || ep->health == endpoint_health::down)
+            record->state = pool_detail::slot_state::closing;
+        else if (!ep->waiters.empty())
+        {
+            auto waiter = std::move(ep->waiters.front());
+            ep->waiters.pop_front();
+            wheel.cancel(waiter.timer);
+            ep->leased++;
+            record->user_data = waiter.user_data;
+            statistics.reused++;
+            record_wait(waiter.start);
+            next = std::move(waiter.callback);
+        }
+        else if (ep->idle.size() >= options.max_idle)
+            record->state = pool_detail::slot_state::closing;
+        else
+            make_idle(record);
+        lock.release_exclusive();
+
+        if (next)
+            next(&connection, 0);
+        else if (record->state == pool_detail::slot_state::closing)
+            connection.close();
+    }
+
+    /// <summary>
+    /// 获取checkout时指定的user_data
+    /// </summary>
+    static void* get_user_data(const tcp_connection& connection)
+    {
+        auto record = static_cast<pool_detail::pooled_connection*>(connection.user_data);
+        return record ? record->user_data : nullptr;
+    }
+
+    /// <summary>
+    /// 获取端点的健康状态，若从未使用过该端点，返回healthy
+    /// </summary>
+    endpoint_health health(const sockaddr* address, int address_len)
+    {
+        lock.acquire_shared();
+        auto it = endpoints.find(endpoint_key(address, address_len));
+        auto result = it == endpoints.end() ? endpoint_health::healthy : it->second->health;
+        lock.release_shared();
+        return result;
+    }
+
+    /// <summary>
+    /// 获取统计信息
+    /// </summary>
+    connection_pool_stats stats()
+    {
+        lock.acquire_shared();
+        auto result = statistics;
+        for (auto& pair : endpoints)
+        {
+            result.idle += pair.second->idle.size();
+            result.leased += pair.second->leased;
+            result.connecting += pair.second->connecting;
+            result.waiting += pair.second->waiters.size();
+        }
+        result.endpoints = endpoints.size();
+        lock.release_shared();
+        return result;
+    }
+
+    const connection_pool_options& get_options() const { return options; }
+    /// <summary>内部的tcp_server，可以用它查看统计信息或获取缓冲区池</summary>
+    tcp_server& get_server() { return server; }
+
+private:
+    tcp_handler make_server_handler()
+    {
+        tcp_handler result;
+        result.on_connect = [this](tcp_connection& connection) { connected(connection); };
+        result.on_connect_failed = [this](void* user_data, int error) {
+            connect_failed(static_cast<pool_detail::pooled_connection*>(user_data), error);
+        };
+        result.on_data = [this](tcp_connection& connection, const char* data, size_t size) -> size_t {
+            auto record = static_cast<pool_detail::pooled_connection*>(connection.user_data);
+            if (record->state == pool_detail::slot_state::leased)
+                return handler.on_data ? handler.on_data(connection, data, size) : size;
+            // 没有被租用的连接不应该收到数据，对端可能在关闭前发送了什么，这样的连接不能再使用
+            connection.abort();
+            return size;
+        };
+        result.on_close = [this](tcp_connection& connection) { closed(connection); };
+        return result;
+    }
+
+    static std::string endpoint_key(const sockaddr* address, int address_len)
+    {
+        return std::string(reinterpret_cast<const char*>(address), address_len);
+    }
+
+    /// <summary>
+    /// 查找或创建端点，调用者需持有锁
+    /// </summary>
+    pool_detail::endpoint* find_endpoint(const sockaddr* address, int address_len)
+    {
+        if (!address || address_len <= 0 || address_len > static_cast<int>(sizeof(sockaddr_storage)))
+            return nullptr;
+        auto& ep = endpoints[endpoint_key(address, address_len)];
+        if (!ep)
+        {
+            ep = std::make_unique<pool_detail::endpoint>();
+            std::memcpy(&ep->address, address, address_len);
+            ep->address_len = address_len;
+        }
+        return ep.get();
+    }
+
+    /// <summary>
+    /// 把checkout加入等待队列，调用者需持有锁
+    /// </summary>
+    void enqueue(pool_detail::endpoint* ep, pool_detail::waiter waiter)
+    {
+        waiter.id = ++last_waiter_id;
+        if (options.checkout_timeout)
+            waiter.timer = wheel.schedule(mw::get_system_time() + options.checkout_timeout, { ep, nullptr, waiter.id });
+        ep->waiters.push_back(std::move(waiter));
+    }
+
+    /// <summary>
+    /// 为等待的checkout和min_idle建立新连接，调用者需持有锁
+    /// </summary>
+    void fill(pool_detail::endpoint* ep, std::vector<pool_detail::failed_checkout>& failed)
+    {
+        if (stopping)
+            return;
+        if (ep->health == endpoint_health::down)
+        {
+            // 退避结束后只允许一个探测连接
+            if (ep->probing || ep->waiters.empty() || mw::get_system_time() < ep->retry_time)
+                return;
+            ep->probing = true;
+            connect_one(ep, failed);
+            return;
+        }
+
+        auto wanted = (std::max)(ep->waiters.size(), options.min_idle > ep->idle.size() ? options.min_idle - ep->idle.size() : 0);
+        while (ep->connecting < wanted && ep->total < options.max_connections)
+        {
+            if (!connect_one(ep, failed))
+                break;
+        }
+    }
+
+    bool connect_one(pool_detail::endpoint* ep, std::vector<pool_detail::failed_checkout>& failed)
+    {
+        auto record = new pool_detail::pooled_connection;
+        record->owner = ep;
+        ep->records++;
+        link(record);
+        ep->total++;
+        ep->connecting++;
+        statistics.connects++;
+        if (server.connect(reinterpret_cast<const sockaddr*>(&ep->address), ep->address_len, record))
+            return true;
+
+        auto error = WSAGetLastError();
+        ep->total--;
+        ep->connecting--;
+        destroy(record);
+        mark_failure(ep, error ? error : WSAENOBUFS, failed);
+        return false;
+    }
+
+    void mark_failure(pool_detail::endpoint* ep, int error, std::vector<pool_detail::failed_checkout>& failed)
+    {
+        statistics.connect_failures++;
+        ep->last_error = error;
+        ep->probing = false;
+        if (++ep->consecutive_failures < options.failure_threshold)
+        {
+            // 一个连接失败，让等待最久的checkout失败，其余的继续等待正在进行的连接
+            ep->health = endpoint_health::degraded;
+            if (!ep->waiters.empty() && ep->waiters.size() > ep->connecting)
+            {
+                wheel.cancel(ep->waiters.front().timer);
+                failed.push_back({ std::move(ep->waiters.front().callback), error });
+                ep->waiters.pop_front();
+            }
+            return;
+        }
+
+        ep->health = endpoint_health::down;
+        ep->backoff = ep->backoff ? (std::min)(ep->backoff * 2, options.max_backoff) : options.initial_backoff;
+        ep->retry_time = mw::get_system_time() + ep->backoff;
+        for (auto& waiter : ep->waiters)
+        {
+            wheel.cancel(waiter.timer);
+            failed.push_back({ std::move(waiter.callback), error });
+        }
+        ep->waiters.clear();
+    }
+
+    /// <summary>
+    /// 把连接放入空闲链表，调用者需持有锁
+    /// </summary>
+    void make_idle(pool_detail::pooled_connection* record)
+    {
+        record->state = pool_detail::slot_state::idle;
+        record->owner->idle.push_back(record);
+        record->idle_timer = wheel.schedule(mw::get_system_time() + options.idle_timeout, { record->owner, record, 0 });
+    }
+
+    void record_wait(std::chrono::steady_clock::time_point start)
+    {
+        auto wait = static_cast<ULONGLONG>(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+        size_t bucket = 0;
+        for (auto value = wait; value && bucket < connection_pool_stats::wait_buckets - 1; value >>= 1)
+            bucket++;
+        statistics.wait_histogram[bucket]++;
+        statistics.wait_count++;
+        statistics.total_wait_time += wait;
+        statistics.max_wait_time = (std::max)(statistics.max_wait_time, wait);
+    }
+
+    void link(pool_detail::pooled_connection* record)
+    {
+        record->next = all_head;
+        if (all_head)
+            all_head->prev = record;
+        all_head = record;
+    }
+
+    void destroy(pool_detail::pooled_connection* record)
+    {
+        if (record->owner->records)
+            record->owner->records--;
+        if (record->prev)
+            record->prev->next = record->next;
+        else
+            all_head = record->next;
+        if (record->next)
+            record->next->prev = record->prev;
+        delete record;
+    }
+
+    /// <summary>
+    /// 把从空闲链表中取出的连接交给它所属的反应器线程，再调用checkout的回调，调用者需持有锁
+    /// </summary>
+    /// <remarks>
+    /// 持有锁时stopping为false，stop要先获取锁才能停止服务器，所以post不会与服务器的停止竞争，
+    /// 投递之后的调用若被stop丢弃，stop会让这个checkout失败并删除记录
+    /// </remarks>
+    void hand_over(pool_detail::pooled_connection* record, std::vector<pool_detail::failed_checkout>& failed)
+    {
+        auto reactor = record->reactor;
+        if (server.post(reactor, [this, record] { handed_over(record); }))
+            return;
+
+        // 无法投递，连接回到空闲链表，这个checkout失败
+        auto ep = record->owner;
+        ep->leased--;
+        statistics.reused--;
+        record->user_data = nullptr;
+        failed.push_back({ std::move(record->handoff), WSAENOBUFS });
+        make_idle(record);
+    }
+
+    /// <summary>
+    /// 在连接所属的反应器线程中完成hand_over
+    /// </summary>
+    void handed_over(pool_detail::pooled_connection* record)
+    {
+        std::vector<pool_detail::failed_checkout> failed;
+        auto callback = std::move(record->handoff);
+        auto start = record->handoff_start;
+
+        lock.acquire_exclusive();
+        auto ep = record->owner;
+        if (!record->dead && !stopping)
+        {
+            record->state = pool_detail::slot_state::leased;
+            record_wait(start);
+            lock.release_exclusive();
+            callback(record->connection, 0);
+            return;
+        }
+        if (!record->dead)
+        {
+            // 正在停止，服务器马上会关闭这个连接，不再交给checkout
+            ep->leased--;
+            record->state = pool_detail::slot_state::closing;
+            record->user_data = nullptr;
+            lock.release_exclusive();
+            callback(nullptr, WSAESHUTDOWN);
+            record->connection->close();
+            return;
+        }
+
+        // 交接期间连接被关闭了，重新为这个checkout获取连接
+        ep->leased--;
+        auto user_data = record->user_data;
+        destroy(record);
+        if (stopping)
+            failed.push_back({ std::move(callback), WSAESHUTDOWN });
+        else
+        {
+            enqueue(ep, { 0, std::move(callback), user_data, start, 0 });
+            fill(ep, failed);
+        }
+        lock.release_exclusive();
+
+        for (auto& checkout : failed)
+            checkout.callback(nullptr, checkout.error);
+    }
+
+    /// <summary>
+    /// 在连接所属的反应器线程中关闭空闲超时的连接
+    /// </summary>
+    void evict(pool_detail::pooled_connection* record)
+    {
+        lock.acquire_exclusive();
+        if (record->dead)
+        {
+            destroy(record);
+            lock.release_exclusive();
+            return;
+        }
+        record->state = pool_detail::slot_state::closing;
+        statistics.evicted++;
+        lock.release_exclusive();
+        record->connection->close();
+    }
+
+    void connected(tcp_connection& connection)
+    {
+        auto record = static_cast<pool_detail::pooled_connection*>(connection.user_data);
+        record->connection = &connection;
+        record->reactor = connection.reactor_index();
+
+        checkout_callback next;
+        lock.acquire_exclusive();
+        auto ep = record->owner;
+        ep->connecting--;
+        ep->consecutive_failures = 0;
+        ep->health = endpoint_health::healthy;
+        ep->backoff = 0;
+        ep->probing = false;
+        if (stopping)
+            record->state = pool_detail::slot_state::closing;
+        else if (!ep->waiters.empty())
+        {
+            auto waiter = std::move(ep->waiters.front());
+            ep->waiters.pop_front();
+            wheel.cancel(waiter.timer);
+            ep->leased++;
+            record->state = pool_detail::slot_state::leased;
+            record->user_data = waiter.user_data;
+            record_wait(waiter.start);
+            next = std::move(waiter.callback);
+        }
+        else if (ep->idle.size() < (std::max)(options.max_idle, options.min_idle))
+            make_idle(record);
+        else
+            record->state = pool_detail::slot_state::closing;
+        lock.release_exclusive();
+
+        if (next)
+            next(&connection, 0);
+        else if (record->state == pool_detail::slot_state::closing)
+            connection.close();
+    }
+
+    void connect_failed(pool_detail::pooled_connection* record, int error)
+    {
+        std::vector<pool_detail::failed_checkout> failed;
+        lock.acquire_exclusive();
+        auto ep = record->owner;
+        ep->total--;
+        ep->connecting--;
+        destroy(record);
+        if (!stopping)
+        {
+            mark_failure(ep, error, failed);
+            // 还有等待的checkout时继续尝试(端点不可用时由退避控制)
+            fill(ep, failed);
+        }
+        lock.release_exclusive();
+
+        for (auto& checkout : failed)
+            checkout.callback(nullptr, checkout.error);
+    }
+
+    void closed(tcp_connection& connection)
+    {
+        auto record = static_cast<pool_detail::pooled_connection*>(connection.user_data);
+        std::vector<pool_detail::failed_checkout> failed;
+        bool leased = false;
+
+        lock.acquire_exclusive();
+        auto ep = record->owner;
+        ep->total--;
+        switch (record->state)
+        {
+        case pool_detail::slot_state::idle:
+            wheel.cancel(record->idle_timer);
+            ep->idle.erase(std::find(ep->idle.begin(), ep->idle.end(), record));
+            destroy(record);
+            break;
+        case pool_detail::slot_state::leased:
+            ep->leased--;
+            leased = true;
+            break;
+        case pool_detail::slot_state::transit:
+            record->dead = true;
+            record->connection = nullptr;
+            break;
+        default:
+            destroy(record);
+            break;
+        }
+        // 空出了一个连接名额，为等待的checkout建立新连接
+        fill(ep, failed);
+        lock.release_exclusive();
+
+        if (leased)
+        {
+            if (handler.on_close)
+                handler.on_close(connection);
+            lock.acquire_exclusive();
+            destroy(record);
+            lock.release_exclusive();
+        }
+        for (auto& checkout : failed)
+            checkout.callback(nullptr, checkout.error);
+    }
+
+    /// <summary>
+    /// 维护计时器，推进时间轮并补充空闲连接
+    /// </summary>
+    void maintain()
+    {
+        std::vector<pool_detail::failed_checkout> failed;
+        std::vector<pool_detail::pooled_connection*> expired;
+
+        lock.acquire_exclusive();
+        if (stopping)
+        {
+            lock.release_exclusive();
+            return;
+        }
+        auto now = mw::get_system_time();
+        wheel.advance(now, [&](ULONGLONG, pool_detail::pool_timer& timer) {
+            auto ep = timer.owner;
+            if (timer.waiter_id)
+            {
+                auto it = std::find_if(ep->waiters.begin(), ep->waiters.end(),
+                    [&](const pool_detail::waiter& waiter) { return waiter.id == timer.waiter_id; });
+                if (it == ep->waiters.end())
+                    return;
+                statistics.timeouts++;
+                failed.push_back({ std::move(it->callback), WSAETIMEDOUT });
+                ep->waiters.erase(it);
+                return;
+            }
+
+            // 空闲超时，但至少保留min_idle个
+            auto record = timer.connection;
+            if (ep->idle.size() <= options.min_idle)
+            {
+                record->idle_timer = wheel.schedule(now + options.idle_timeout, timer);
+                return;
+            }
+            ep->idle.erase(std::find(ep->idle.begin(), ep->idle.end(), record));
+            record->state = pool_detail::slot_state::transit;
+            expired.push_back(record);
+        });
+        for (auto it = endpoints.begin(); it != endpoints.end();)
+        {
+            auto ep = it->second.get();
+            fill(ep, failed);
+            // 不再使用的端点被删除，否则访问过的每个地址都会一直占用内存。不可用的端点保留到退避结束，以免丢失退避状态
+            if (!ep->records && ep->waiters.empty() && (ep->health != endpoint_health::down || now >= ep->retry_time))
+                it = endpoints.erase(it);
+            else
+                ++it;
+        }
+        lock.release_exclusive();
+
+        for (auto record : expired)
+        {
+            auto reactor = record->reactor;
+            server.post(reactor, [this, record] { evict(record); });
+        }
+        for (auto& checkout : failed)
+            checkout.callback(nullptr, checkout.error);
+    }
+
+#ifdef _WIN32
+    static void CALLBACK timer_callback(PTP_CALLBACK_INSTANCE, PVOID param, PTP_TIMER)
+    {
+        static_cast<connection_pool*>(param)->maintain();
+    }
+#else
+    void maintainer_loop()
+    {
+        std::unique_lock<std::mutex> guard(maintainer_lock);
+        while (!maintainer_wake.wait_for(guard, std::chrono::milliseconds(options.tick), [this] { return maintainer_stopping; }))
+        {
+            guard.unlock();
+            maintain();
+            guard.lock();
+        }
+    }
+#endif
+
+    connection_pool_handler handler;
+    connection_pool_options options;
+    tcp_server server;
+#ifdef _WIN32
+    PTP_TIMER timer = nullptr;
+#else
+    std::thread maintainer;
+    std::mutex maintainer_lock;
+    std::condition_variable maintainer_wake;
+    bool maintainer_stopping = false;
+#endif
+
+    mw::sync::slimrw_lock lock;
+    bool stopping = false;
+    std::unordered_map<std::string, std::unique_ptr<pool_detail::endpoint>> endpoints;
+    timer_wheel<pool_detail::pool_timer> wheel;
+    pool_detail::pooled_connection* all_head = nullptr;
+    ULONGLONG last_waiter_id = 0;
+    connection_pool_stats statistics;
+};
+
+} // namespace mw::net
@@ -1,4 +1,5 @@
 #pragma once
+#include "mw_system_snapshot.h"
 #include "mw_utility.h"
 #include <DbgHelp.h>
 
@@ -100,34 +101,53 @@ inline bool hook_module_func(const std::string& base_func_module_name,
 }
 
 /// <summary>
-/// 修改所有模块的导入表，使得对应函数的调用被拦截。可选地，排除调用该函数的代码所在的模块的导入表修改
+/// 修改快照中当前进程的所有模块的导入表，使得对应函数的调用被拦截。可选地，排除调用该函数的代码所在的模块的导入表修改
 /// </summary>
 /// <remarks>
-/// base_func_module_name和base_func指定了对某个模块导出函数的调用，如USER32.dll的MessageBoxW函数，
-/// hook_func表示新的拦截函数，当所有代码调用user32.dll的MessageBoxW函数时，将变成调用hook_func指定的函数。
+/// 拦截多个函数时，拍摄一次快照并多次调用该函数，避免每次都遍历toolhelp快照
 /// </remarks>
+/// <param name="snapshot">包含当前进程模块的快照，例如capture(system_snapshot::modules)的结果</param>
 /// <param name="base_func_module_name">导出被拦截函数的模块，比如USER32.dll</param>
 /// <param name="base_func">要被拦截的函数地址，如MessageBoxExW，它应该是使用GetProcAddress获取的真实地址，不要直接把函数传进来，它传入的是导入段的地址！</param>
 /// <param name="hook_func">拦截函数地址，注意该函数的函数签名要与被拦截函数相同，如参数，返回值，调用约定等</param>
 /// <param name="exclude_module">可选地排除修改导入段的模块实例地址，若为NULL，则修改所有模块导入表</param>
 /// <returns>操作是否成功</returns>
-inline bool hook_all_modules_func(const std::string& base_func_module_name,
+inline bool hook_all_modules_func(const system_snapshot& snapshot, const std::string& base_func_module_name,
     PROC base_func, PROC hook_func, HMODULE exclude_module = nullptr)
 {
-    tool_help th(TH32CS_SNAPMODULE, GetCurrentProcessId());
-
     bool is_okt = true;
 
-    MODULEENTRY32 me = { sizeof(me) };
-    for (BOOL is_ok = th.module_first(me); is_ok; is_ok = th.module_next(me))
+    auto modules = snapshot.modules_of(GetCurrentProcessId());
+    for (auto module = modules.first; module != modules.second; ++module)
     {
-        if (me.hModule != exclude_module) {
-            is_okt = is_okt && hook_module_func(base_func_module_name, base_func, hook_func, me.hModule);
+        auto module_handle = reinterpret_cast<HMODULE>(module->base_address);
+        if (module_handle != exclude_module) {
+            is_okt = is_okt && hook_module_func(base_func_module_name, base_func, hook_func, module_handle);
         }
     }
     return is_okt;
 }
 
+/// <summary>
+/// 修改所有模块的导入表，使得对应函数的调用被拦截。可选地，排除调用该函数的代码所在的模块的导入表修改
+/// </summary>
+/// <remarks>
+/// base_func_module_name和base_func指定了对某个模块导出函数的调用，如USER32.dll的MessageBoxW函数，
+/// hook_func表示新的拦截函数，当所有代码调用user32.dll的MessageBoxW函数时，将变成调用hook_func指定的函数。
+/// </remarks>
+/// <param name="base_func_module_name">导出被拦截函数的模块，比如USER32.dll</param>
+/// <param name="base_func">要被拦截的函数地址，如MessageBoxExW，它应该是使用GetProcAddress获取的真实地址，不要直接把函数传进来，它传入的是导入段的地址！</param>
+/// <param name="hook_func">拦截函数地址，注意该函数的函数签名要与被拦截函数相同，如参数，返回值，调用约定等</param>
+/// <param name="exclude_module">可选地排除修改导入段的模块实例地址，若为NULL，则修改所有模块导入表</param>
+/// <returns>操作是否成功</returns>
+inline bool hook_all_modules_func(const std::string& base_func_module_name,
+    PROC base_func, PROC hook_func, HMODULE exclude_module = nullptr)
+{
+    system_snapshot snapshot;
+    snapshot.capture(system_snapshot::modules);
+    return hook_all_modules_func(snapshot, base_func_module_name, base_func, hook_func, exclude_module);
+}
+
 // 以下函数需要在__except块中使用
 // GetExceptionCode 获取异常错误码
 // GetExceptionInformation 获取异常错误详细信息
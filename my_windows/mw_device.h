@@ -1,4 +1,7 @@
 #pragma once
+#include "mw_error.h"
+#include "mw_handle.h"
+#include "mw_trace.h"
 
 namespace mw {
 
@@ -16,28 +19,39 @@ namespace mw {
 /// <param name="flags_and_attributes">它可以是FILE_ATTRIBUTE(用于文件)和FILE_FLAG的组合,若不是创建新文件并且template_file为NULL，ATTRIBUTE没有作用</param>
 /// <param name="template_file">具有GENERIC_READ访问权限的模板文件的有效句柄。模板文件为创建的文件提供文件属性和扩展属性,若是打开现有文件，该参数被忽略</param>
 /// <param name="file_attributes">文件或I/O设备的安全属性</param>
-/// <returns>则返回值是指定文件、设备、命名管道或邮槽的打开句柄，若失败返回INVALID_HANDLE_VALUE</returns>
-inline HANDLE create_file(const std::tstring& file_name, DWORD desired_access = GENERIC_WRITE | GENERIC_READ,
+/// <returns>则返回值是指定文件、设备、命名管道或邮槽的打开句柄，若失败返回INVALID_HANDLE_VALUE，返回值的类型由错误处理策略决定</returns>
+template <typename Policy = MY_WINDOWS_ERROR_POLICY>
+inline auto create_file(tzstring_view file_name, DWORD desired_access = GENERIC_WRITE | GENERIC_READ,
     DWORD creation_disposition = CREATE_NEW, DWORD share_mode = FILE_SHARE_READ,
     DWORD flags_and_attributes = FILE_FLAG_SEQUENTIAL_SCAN | FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED,
-    HANDLE template_file = nullptr, LPSECURITY_ATTRIBUTES file_attributes = nullptr)
+    HANDLE template_file = nullptr, LPSECURITY_ATTRIBUTES file_attributes = nullptr, Policy = {})
 {
+    MW_TRACE_SCOPE(device, nullptr);
     auto val = CreateFile(file_name.c_str(), desired_access, share_mode,
         file_attributes, creation_disposition, flags_and_attributes, template_file);
-    GET_ERROR_MSG_OUTPUT();
-    return val;
+    MW_TRACE_RESULT(val);
+    return Policy::apply(val, error::is_invalid_handle, __FUNCTION__);
+}
+
+/// <summary>
+/// 与create_file相同，但返回unique_file_handle，析构时自动关闭
+/// </summary>
+template <typename... Args>
+inline unique_file_handle create_file(unique_tag, Args&&... args)
+{
+    return unique_file_handle(create_file(std::forward<Args>(args)...));
 }
 
 /// <summary>
 /// 获取指定文件或I/O设备的类型
 /// </summary>
 /// <param name="file_handle">文件或I/O设备的句柄</param>
-/// <returns>返回值是FILE_TYPE_开头的宏</returns>
-inline DWORD get_file_type(HANDLE file_handle)
+/// <returns>返回值是FILE_TYPE_开头的宏，返回值的类型由错误处理策略决定</returns>
+template <typename Policy = MY_WINDOWS_ERROR_POLICY>
+inline auto get_file_type(HANDLE file_handle, Policy = {})
 {
     auto val = GetFileType(file_handle);
-    GET_ERROR_MSG_OUTPUT();
-    return val;
+    return Policy::apply(val, [](DWORD value) noexcept { return value == FILE_TYPE_UNKNOWN && GetLastError() != NO_ERROR; }, __FUNCTION__);
 }
 
 /// <summary>
@@ -45,25 +59,25 @@ inline DWORD get_file_type(HANDLE file_handle)
 /// </summary>
 /// <param name="file_handle">文件的句柄，该句柄必须具有FILE_READ_ATTRIBUTES访问权限，或者调用线程必须对包含该文件的目录具有足够的权限</param>
 /// <param name="file_size">[out]用于接收文件大小的LARGE_INTEGER联合，以字节为单位</param>
-/// <returns>操作是否成功</returns>
-inline BOOL get_file_size(HANDLE file_handle, LARGE_INTEGER& file_size)
+/// <returns>操作是否成功，返回值的类型由错误处理策略决定</returns>
+template <typename Policy = MY_WINDOWS_ERROR_POLICY>
+inline auto get_file_size(HANDLE file_handle, LARGE_INTEGER& file_size, Policy = {})
 {
     auto val = GetFileSizeEx(file_handle, &file_size);
-    GET_ERROR_MSG_OUTPUT();
-    return val;
+    return Policy::apply(val, error::is_false, __FUNCTION__);
 }
 
 /// <summary>
 /// 获取指定文件名的文件的实际大小(实际磁盘存储的字节数)
 /// </summary>
 /// <param name="file_name">文件的名称。您可以在此名称中使用正斜杠(/)或反斜杠(\),在UNICODE版本可以超过MAX_PATH个字符</param>
-/// <returns>返回实际大小，需要调用GetLastError来确定是否出错</returns>
-inline ULARGE_INTEGER get_compressed_file_size(const std::tstring& file_name)
+/// <returns>返回实际大小，低32位为INVALID_FILE_SIZE并且GetLastError不为NO_ERROR时表示出错，返回值的类型由错误处理策略决定</returns>
+template <typename Policy = MY_WINDOWS_ERROR_POLICY>
+inline auto get_compressed_file_size(tzstring_view file_name, Policy = {})
 {
     ULARGE_INTEGER temp = { 0 };
     temp.LowPart = GetCompressedFileSize(file_name.c_str(), &temp.HighPart);
-    GET_ERROR_MSG_OUTPUT();
-    return temp;
+    return Policy::apply(temp, [](const ULARGE_INTEGER& value) noexcept { return value.LowPart == INVALID_FILE_SIZE && GetLastError() != NO_ERROR; }, __FUNCTION__);
 }
 
 /// <summary>
@@ -74,12 +88,14 @@ inline ULARGE_INTEGER get_compressed_file_size(const std::tstring& file_name)
 /// <param name="bytes_to_read">要读取的最大字节数</param>
 /// <param name="bytes_read">[out,opt]用于接收使用该同步函数读取的字节数的变量的指针，当是异步IO时，该参数应该为NULL</param>
 /// <param name="overlapped">[in,out,opt]指向OVERLAPPED数据结构的指针，该结构提供要在异步（重叠）文件读取操作期间使用的数据，该结构必须在读取期间可用(唯一且有效)</param>
-/// <returns>若函数成功，返回TRUE，若函数失败，或正在异步完成，返回值为FALSE。GetLastError得到的ERROR_IO_PENDING不是失败值(异步)</returns>
-inline BOOL read_file(HANDLE file_handle, LPVOID buffer, DWORD bytes_to_read, LPDWORD bytes_read, LPOVERLAPPED overlapped = nullptr)
+/// <returns>若函数成功，返回TRUE，若函数失败，或正在异步完成，返回值为FALSE。GetLastError得到的ERROR_IO_PENDING不是失败值(异步)，返回值的类型由错误处理策略决定</returns>
+template <typename Policy = MY_WINDOWS_ERROR_POLICY>
+inline auto read_file(HANDLE file_handle, LPVOID buffer, DWORD bytes_to_read, LPDWORD bytes_read, LPOVERLAPPED overlapped = nullptr, Policy = {})
 {
+    MW_TRACE_SCOPE(device, file_handle);
     auto val = ReadFile(file_handle, buffer, bytes_to_read, bytes_read, overlapped);
-    GET_ERROR_MSG_OUTPUT();
-    return val;
+    MW_TRACE_RESULT(val);
+    return Policy::apply(val, error::is_io_failed, __FUNCTION__);
 }
 
 /// <summary>
@@ -99,13 +115,13 @@ inline BOOL read_file(HANDLE file_handle, LPVOID buffer, DWORD bytes_to_read, LP
 /// <param name="bytes_to_read">要读取的字节数</param>
 /// <param name="overlapped">[in,out]指向OVERLAPPED数据结构的指针，该结构提供要在异步（重叠）文件读取操作期间使用的数据，该结构必须在读取期间可用(唯一且有效)</param>
 /// <param name="completion_routine">当读取操作完成并且调用线程处于可警告的等待状态时，指向要调用的完成例程的指针</param>
-/// <returns>操作是否成功</returns>
-inline BOOL read_file_async(HANDLE file_handle, LPVOID buffer, DWORD bytes_to_read,
-    LPOVERLAPPED overlapped, LPOVERLAPPED_COMPLETION_ROUTINE completion_routine)
+/// <returns>操作是否成功，返回值的类型由错误处理策略决定</returns>
+template <typename Policy = MY_WINDOWS_ERROR_POLICY>
+inline auto read_file_async(HANDLE file_handle, LPVOID buffer, DWORD bytes_to_read,
+    LPOVERLAPPED overlapped, LPOVERLAPPED_COMPLETION_ROUTINE completion_routine, Policy = {})
 {
     auto val = ReadFileEx(file_handle, buffer, bytes_to_read, overlapped, completion_routine);
-    GET_ERROR_MSG_OUTPUT();
-    return val;
+    return Policy::apply(val, error::is_false, __FUNCTION__);
 }
 
 /// <summary>
@@ -116,12 +132,14 @@ inline BOOL read_file_async(HANDLE file_handle, LPVOID buffer, DWORD bytes_to_re
 /// <param name="bytes_to_write">要写入文件或设备的字节数。零值指定空写操作。空写操作的行为取决于底层文件系统或通信技术</param>
 /// <param name="bytes_written">[out,opt]用于接收使用该同步函数写入的字节数的变量的指针，当是异步IO时，该参数应该为NULL</param>
 /// <param name="overlapped">[in,out,opt]指向OVERLAPPED数据结构的指针，该结构提供要在异步（重叠）文件写入操作期间使用的数据，该结构必须在写入期间可用(唯一且有效)</param>
-/// <returns>若函数成功，返回TRUE，若函数失败，或正在异步完成，返回值为FALSE。GetLastError得到的ERROR_IO_PENDING不是失败值(异步)</returns>
-inline BOOL write_file(HANDLE file_handle, LPCVOID buffer, DWORD bytes_to_write, LPDWORD bytes_written, LPOVERLAPPED overlapped = nullptr)
+/// <returns>若函数成功，返回TRUE，若函数失败，或正在异步完成，返回值为FALSE。GetLastError得到的ERROR_IO_PENDING不是失败值(异步)，返回值的类型由错误处理策略决定</returns>
+template <typename Policy = MY_WINDOWS_ERROR_POLICY>
+inline auto write_file(HANDLE file_handle, LPCVOID buffer, DWORD bytes_to_write, LPDWORD bytes_written, LPOVERLAPPED overlapped = nullptr, Policy = {})
 {
+    MW_TRACE_SCOPE(device, file_handle);
     auto val = WriteFile(file_handle, buffer, bytes_to_write, bytes_written, overlapped);
-    GET_ERROR_MSG_OUTPUT();
-    return val;
+    MW_TRACE_RESULT(val);
+    return Policy::apply(val, error::is_io_failed, __FUNCTION__);
 }
 
 /// <summary>
@@ -143,13 +161,13 @@ inline BOOL write_file(HANDLE file_handle, LPCVOID buffer, DWORD bytes_to_write,
 /// <param name="bytes_to_write">要写入文件或设备的字节数。零值指定空写操作。空写操作的行为取决于底层文件系统或通信技术</param>
 /// <param name="overlapped">[in,out]指向OVERLAPPED数据结构的指针，该结构提供要在异步（重叠）文件读取操作期间使用的数据，该结构必须在写操作期间可用(唯一且有效)</param>
 /// <param name="completion_routine">当写操作完成并且调用线程处于可警告的等待状态时，指向要调用的完成例程的指针</param>
-/// <returns>操作是否成功</returns>
-inline BOOL write_file_async(HANDLE file_handle, LPCVOID buffer, DWORD bytes_to_write,
-    LPOVERLAPPED overlapped, LPOVERLAPPED_COMPLETION_ROUTINE completion_routine)
+/// <returns>操作是否成功，返回值的类型由错误处理策略决定</returns>
+template <typename Policy = MY_WINDOWS_ERROR_POLICY>
+inline auto write_file_async(HANDLE file_handle, LPCVOID buffer, DWORD bytes_to_write,
+    LPOVERLAPPED overlapped, LPOVERLAPPED_COMPLETION_ROUTINE completion_routine, Policy = {})
 {
     auto val = WriteFileEx(file_handle, buffer, bytes_to_write, overlapped, completion_routine);
-    GET_ERROR_MSG_OUTPUT();
-    return val;
+    return Policy::apply(val, error::is_false, __FUNCTION__);
 }
 
 /// <summary>
@@ -160,24 +178,24 @@ inline BOOL write_file_async(HANDLE file_handle, LPCVOID buffer, DWORD bytes_to_
 /// <param name="distance_to_move">移动文件指针的字节数。正值将指针在文件中向前移动，负值将文件指针向后移动</param>
 /// <param name="move_method">文件指针移动的起点，它可以是FILE_BEGIN，FILE_CURRENT，FILE_END(与标准库的文件操作对应)</param>
 /// <param name="new_file_pointer">[out,opt]一个指向接收新文件指针的变量的指针。如果此参数为 NULL，则不返回新文件指针</param>
-/// <returns>操作是否成功</returns>
-inline BOOL set_file_pointer(HANDLE file_handle, LARGE_INTEGER distance_to_move, DWORD move_method, PLARGE_INTEGER new_file_pointer = nullptr)
+/// <returns>操作是否成功，返回值的类型由错误处理策略决定</returns>
+template <typename Policy = MY_WINDOWS_ERROR_POLICY>
+inline auto set_file_pointer(HANDLE file_handle, LARGE_INTEGER distance_to_move, DWORD move_method, PLARGE_INTEGER new_file_pointer = nullptr, Policy = {})
 {
     auto val = SetFilePointerEx(file_handle, distance_to_move, new_file_pointer, move_method);
-    GET_ERROR_MSG_OUTPUT();
-    return val;
+    return Policy::apply(val, error::is_false, __FUNCTION__);
 }
 
 /// <summary>
 /// 将指定文件的物理文件大小设置为文件指针的当前位置，物理文件大小也称为文件结尾。该函数可以用来截断或扩展的文件。请使用SetFileValidData函数设置文件逻辑结尾
 /// </summary>
 /// <param name="file_handle">要扩展或截断的文件的句柄,必须使用GENERIC_WRITE访问权限创建文件句柄</param>
-/// <returns>操作是否成功</returns>
-inline BOOL set_end_of_file(HANDLE file_handle)
+/// <returns>操作是否成功，返回值的类型由错误处理策略决定</returns>
+template <typename Policy = MY_WINDOWS_ERROR_POLICY>
+inline auto set_end_of_file(HANDLE file_handle, Policy = {})
 {
     auto val = SetEndOfFile(file_handle);
-    GET_ERROR_MSG_OUTPUT();
-    return val;
+    return Policy::apply(val, error::is_false, __FUNCTION__);
 }
 
 /// <summary>
@@ -191,24 +209,26 @@ inline BOOL set_end_of_file(HANDLE file_handle)
 /// 其他备注请看文档
 /// </remarks>
 /// <param name="file_handle">打开文件的句柄，该句柄必须具有GENERIC_WRITE访问权限</param>
-/// <returns>操作是否成功</returns>
-inline BOOL flush_file_buffers(HANDLE file_handle)
+/// <returns>操作是否成功，返回值的类型由错误处理策略决定</returns>
+template <typename Policy = MY_WINDOWS_ERROR_POLICY>
+inline auto flush_file_buffers(HANDLE file_handle, Policy = {})
 {
+    MW_TRACE_SCOPE(device, file_handle);
     auto val = FlushFileBuffers(file_handle);
-    GET_ERROR_MSG_OUTPUT();
-    return val;
+    MW_TRACE_RESULT(val);
+    return Policy::apply(val, error::is_false, __FUNCTION__);
 }
 
 /// <summary>
 /// 将指定线程发出的挂起 *同步* I/O 操作标记为已取消
 /// </summary>
 /// <param name="thread_handle">指定发出同步I/O的线程句柄，该句柄必须具有THREAD_TERMINATE访问权限</param>
-/// <returns>操作是否成功</returns>
-inline BOOL cancle_synchronous_io(HANDLE thread_handle)
+/// <returns>操作是否成功，返回值的类型由错误处理策略决定</returns>
+template <typename Policy = MY_WINDOWS_ERROR_POLICY>
+inline auto cancle_synchronous_io(HANDLE thread_handle, Policy = {})
 {
     auto val = CancelSynchronousIo(thread_handle);
-    GET_ERROR_MSG_OUTPUT();
-    return val;
+    return Policy::apply(val, error::is_false, __FUNCTION__);
 }
 
 /// <summary>
@@ -216,12 +236,12 @@ inline BOOL cancle_synchronous_io(HANDLE thread_handle)
 /// </summary>
 /// <remarks>所有被取消的 I/O 操作都以错误ERROR_OPERATION_ABORTED完成，并且 I/O 操作的所有完成通知都正常发生。</remarks>
 /// <param name="file_handle">该函数取消调用线程发送给此文件句柄的所有挂起 I/O 操作</param>
-/// <returns>操作是否成功</returns>
-inline BOOL cancle_io(HANDLE file_handle)
+/// <returns>操作是否成功，返回值的类型由错误处理策略决定</returns>
+template <typename Policy = MY_WINDOWS_ERROR_POLICY>
+inline auto cancle_io(HANDLE file_handle, Policy = {})
 {
     auto val = CancelIo(file_handle);
-    GET_ERROR_MSG_OUTPUT();
-    return val;
+    return Policy::apply(val, error::is_false, __FUNCTION__);
 }
 
 /// <summary>
@@ -230,12 +250,12 @@ inline BOOL cancle_io(HANDLE file_handle)
 /// <remarks>线程可以使用GetOverlappedResult函数来确定 I/O 操作本身何时完成。</remarks>
 /// <param name="file_handle">文件的句柄</param>
 /// <param name="overlapped">包含用于异步 I/O 的数据的OVERLAPPED数据结构的指针，若为NULL，则取消对指定文件句柄的所有I/O请求，否则只取消该参数指定的I/O</param>
-/// <returns>若成功返回非零值，若失败返回0，若找不到取消请求，返回0，注意，该函数不会等待所有取消操作完成，所以在所有取消操作完成之前，确保OVERLAPPED结构完好</returns>
-inline BOOL cancle_io_ex(HANDLE file_handle, LPOVERLAPPED overlapped = nullptr)
+/// <returns>若成功返回非零值，若失败返回0，若找不到取消请求，返回0，注意，该函数不会等待所有取消操作完成，所以在所有取消操作完成之前，确保OVERLAPPED结构完好，返回值的类型由错误处理策略决定</returns>
+template <typename Policy = MY_WINDOWS_ERROR_POLICY>
+inline auto cancle_io_ex(HANDLE file_handle, LPOVERLAPPED overlapped = nullptr, Policy = {})
 {
     auto val = CancelIoEx(file_handle, overlapped);
-    GET_ERROR_MSG_OUTPUT();
-    return val;
+    return Policy::apply(val, error::is_false, __FUNCTION__);
 }
 
 /// <summary>
@@ -249,13 +269,22 @@ inline BOOL cancle_io_ex(HANDLE file_handle, LPOVERLAPPED overlapped = nullptr)
 /// <param name="existing_completion_port">现有I/O完成端口或nullptr，后者将创建一个新I/O完成端口，若file_handle不为INVALID_HANDLE_VALUE则与其关联</param>
 /// <param name="completion_key">用户定义的完成键，包含在指定文件句柄的每个 I/O 完成数据包中</param>
 /// <param name="number_of_concurrent_threads">允许并发处理I/O完成端口最大线程数，若为0则允许与系统中处理器数量相同的值，若existing_completion_port不为nullptr，则忽略该参数</param>
-/// <returns>若成功，返回值是I/O完成端口的句柄(新创建的或已经存在的)，若失败返回NULL</returns>
-inline HANDLE create_io_completion_port(HANDLE file_handle = INVALID_HANDLE_VALUE,
-    HANDLE existing_completion_port = nullptr, ULONG_PTR completion_key = 0, DWORD number_of_concurrent_threads = 0)
+/// <returns>若成功，返回值是I/O完成端口的句柄(新创建的或已经存在的)，若失败返回NULL，返回值的类型由错误处理策略决定</returns>
+template <typename Policy = MY_WINDOWS_ERROR_POLICY>
+inline auto create_io_completion_port(HANDLE file_handle = INVALID_HANDLE_VALUE,
+    HANDLE existing_completion_port = nullptr, ULONG_PTR completion_key = 0, DWORD number_of_concurrent_threads = 0, Policy = {})
 {
     auto val = CreateIoCompletionPort(file_handle, existing_completion_port, completion_key, number_of_concurrent_threads);
-    GET_ERROR_MSG_OUTPUT();
-    return val;
+    return Policy::apply(val, error::is_null, __FUNCTION__);
+}
+
+/// <summary>
+/// 与create_io_completion_port相同，但返回unique_kernel_handle，析构时自动关闭
+/// </summary>
+template <typename... Args>
+inline unique_kernel_handle create_io_completion_port(unique_tag, Args&&... args)
+{
+    return unique_kernel_handle(create_io_completion_port(std::forward<Args>(args)...));
 }
 
 /// <summary>
@@ -266,13 +295,15 @@ inline HANDLE create_io_completion_port(HANDLE file_handle = INVALID_HANDLE_VALU
 /// <param name="completion_key">[out]用于接收在完成端口与指定设备关联时指定的完成键(用它可以辨识是哪一个设备的I/O操作完成了)</param>
 /// <param name="overlapped">[out]接收在I/O操作开始时指定的OVERLAPPED结构体的指针(将hEvent低位设为1可以防止I/O完成后插入完成端口队列中)</param>
 /// <param name="milliseconds">调用线程愿意等待完成数据包出现在完成端口的毫秒数，若超时，返回FALSE，并将overlapped设为NULL，可以是INFINITE</param>
-/// <returns>操作是否成功</returns>
-inline BOOL get_queued_completion_status(HANDLE completion_port,
-    DWORD& bytes_to_transferred, ULONG_PTR& completion_key, OVERLAPPED*& overlapped, DWORD milliseconds = INFINITE)
+/// <returns>操作是否成功，返回值的类型由错误处理策略决定</returns>
+template <typename Policy = MY_WINDOWS_ERROR_POLICY>
+inline auto get_queued_completion_status(HANDLE completion_port,
+    DWORD& bytes_to_transferred, ULONG_PTR& completion_key, OVERLAPPED*& overlapped, DWORD milliseconds = INFINITE, Policy = {})
 {
+    MW_TRACE_SCOPE(device, completion_port);
     auto val = GetQueuedCompletionStatus(completion_port, &bytes_to_transferred, &completion_key, &overlapped, milliseconds);
-    GET_ERROR_MSG_OUTPUT();
-    return val;
+    MW_TRACE_RESULT(val);
+    return Policy::apply(val, error::is_dequeue_failed, __FUNCTION__);
 }
 
 /// <summary>
@@ -284,14 +315,14 @@ inline BOOL get_queued_completion_status(HANDLE completion_port,
 /// <param name="num_entries_removed">[out]用于接收实际弹出的数据包数量</param>
 /// <param name="milliseconds">调用线程愿意等待完成数据包出现在完成端口的毫秒数，若超时，返回FALSE，并将overlapped设为NULL，可以是INFINITE</param>
 /// <param name="alertable">是否是可警告的(可提醒的)，若为TRUE，当I/O完成例程或APC排队到线程时，线程返回</param>
-/// <returns>操作是否成功</returns>
-inline BOOL get_queued_completion_status_ex(HANDLE completion_port, LPOVERLAPPED_ENTRY completion_port_entries,
-    ULONG count, ULONG& num_entries_removed, DWORD milliseconds = INFINITE, BOOL alertable = true)
+/// <returns>操作是否成功，返回值的类型由错误处理策略决定</returns>
+template <typename Policy = MY_WINDOWS_ERROR_POLICY>
+inline auto get_queued_completion_status_ex(HANDLE completion_port, LPOVERLAPPED_ENTRY completion_port_entries,
+    ULONG count, ULONG& num_entries_removed, DWORD milliseconds = INFINITE, BOOL alertable = true, Policy = {})
 {
     auto val = GetQueuedCompletionStatusEx(completion_port, completion_port_entries,
         count, &num_entries_removed, milliseconds, alertable);
-    GET_ERROR_MSG_OUTPUT();
-    return val;
+    return Policy::apply(val, error::is_dequeue_failed, __FUNCTION__);
 }
 
 /// <summary>
@@ -301,13 +332,15 @@ inline BOOL get_queued_completion_status_ex(HANDLE completion_port, LPOVERLAPPED
 /// <param name="bytes_to_transferred">它将是GetQueuedCompletionStatus的bytes_to_transferred参数</param>
 /// <param name="completion_key">它将是GetQueuedCompletionStatus的completion_key参数</param>
 /// <param name="overlapped">它将是GetQueuedCompletionStatus的overlapped参数</param>
-/// <returns>操作是否成功</returns>
-inline BOOL post_queued_completion_status(HANDLE completion_port, DWORD bytes_to_transferred = 0,
-    ULONG_PTR completion_key = 0, LPOVERLAPPED overlapped = nullptr)
+/// <returns>操作是否成功，返回值的类型由错误处理策略决定</returns>
+template <typename Policy = MY_WINDOWS_ERROR_POLICY>
+inline auto post_queued_completion_status(HANDLE completion_port, DWORD bytes_to_transferred = 0,
+    ULONG_PTR completion_key = 0, LPOVERLAPPED overlapped = nullptr, Policy = {})
 {
+    MW_TRACE_SCOPE(device, completion_port);
     auto val = PostQueuedCompletionStatus(completion_port, bytes_to_transferred, completion_key, overlapped);
-    GET_ERROR_MSG_OUTPUT();
-    return val;
+    MW_TRACE_RESULT(val);
+    return Policy::apply(val, error::is_false, __FUNCTION__);
 }
 
 }; // namespace mw
\ No newline at end of file
@@ -12,8 +12,8 @@ namespace mw::user {
 	/// <param name="parent_window">父窗口，默认没有</param>
 	/// <param name="language_id">消息框按钮中显示的文本的语言，0表示以默认系统语言显示按钮文本</param>
 	/// <returns>操作失败返回0，否则标识用户按下哪个按钮</returns>
-	inline int message_box(const std::tstring& caption,
-		const std::tstring& text, UINT type = MB_OK, HWND parent_window = nullptr, WORD language_id = 0)
+	inline int message_box(tzstring_view caption,
+		tzstring_view text, UINT type = MB_OK, HWND parent_window = nullptr, WORD language_id = 0)
 	{
 		auto val = MessageBoxEx(parent_window, text.c_str(), caption.c_str(), type, language_id);
 		GET_ERROR_MSG_OUTPUT();
@@ -156,7 +156,7 @@ namespace mw::user {
 	/// <param name="control_id">指定控件的ID</param>
 	/// <param name="text">文本或标题名字(根据控件种类来看)</param>
 	/// <returns>操作是否成功</returns>
-	inline bool set_dialog_item_text(HWND dialog_handle, int control_id, const std::tstring& text)
+	inline bool set_dialog_item_text(HWND dialog_handle, int control_id, tzstring_view text)
 	{
 		auto val = SetDlgItemText(dialog_handle, control_id, text.c_str());
 		GET_ERROR_MSG_OUTPUT();
@@ -278,13 +278,13 @@ namespace mw::user {
 	/// <param name="text">指定要加入的文本</param>
 	/// <param name="max_text_nums">编辑控件容纳文本的最大值，以字为单位</param>
 	/// <returns>操作是否成功</returns>
-	inline bool edit_box_add_string(HWND window_handle, int control_id, const std::tstring& text, size_t max_text_nums)
+	inline bool edit_box_add_string(HWND window_handle, int control_id, tzstring_view text, size_t max_text_nums)
 	{
 		std::tstring temp;
 		std::tostringstream o;
 		bool is_ok1 = mw::user::get_dialog_item_text(window_handle, control_id, temp);
 		o << temp;	// 先打印之前的内容
-		o << text;	// 加入新文本
+		o << text.view();	// 加入新文本
 		temp = o.str();
 		auto x = (temp.size() <= max_text_nums) ? 0 : temp.size() - max_text_nums;	// 如果超过最大字符数了，就截断
 		bool is_ok2 = mw::user::set_dialog_item_text(window_handle, control_id, temp.substr(x));	// 发送给编辑控件
@@ -0,0 +1,319 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#ifndef _WIN32
+#    include <cstdio>
+#    include <cstring>
+extern char** environ;
+#endif
+
+namespace mw {
+
+#ifdef _WIN32
+using environment_char = TCHAR;
+#else
+using environment_char = char;
+#endif
+using environment_string = std::basic_string<environment_char>;
+using environment_string_view = std::basic_string_view<environment_char>;
+
+/// <summary>
+/// 进程的环境变量和命令行参数的不可变快照，解析一次后所有的查找都返回指向快照内部的string_view，不分配内存
+/// </summary>
+/// <remarks>
+/// 环境块和参数复制到同一个缓冲区中，每个值后面都有0，所以返回的视图的data()可以直接传给需要以0结尾的API。
+/// 变量按名字排序，查找是二分查找；Windows上名字比较不区分ASCII大小写，与GetEnvironmentVariable一致。
+/// current()返回进程范围共享的快照，第一次调用时构造。set_envionment_var会调用invalidate，之后的current()重新构造快照，
+/// 已经取得的快照不受影响，继续有效。
+/// 失效只能手动触发，快照不监视任何变更通知：直接调用SetEnvironmentVariable，_tputenv，setenv或者其他库修改环境后，必须自己调用invalidate。
+/// 广播的WM_SETTINGCHANGE("Environment")只表示注册表中的用户或系统环境变量改变了，它不修改本进程的环境块，所以不会使快照失效；
+/// 收到它后把注册表中的新值写入本进程环境的程序，写入后调用invalidate即可。
+/// 命令行在Windows上使用CommandLineToArgvW解析，在Linux上读取/proc/self/cmdline
+/// </remarks>
+class environment_snapshot
+{
+public:
+    /// <summary>
+    /// 获取当前的快照，若还没有构造或者已经失效，先构造新的快照
+    /// </summary>
+    static std::shared_ptr<const environment_snapshot> current()
+    {
+        auto snapshot = std::atomic_load_explicit(&instance, std::memory_order_acquire);
+        if (snapshot && snapshot->snapshot_generation == generation.load(std::memory_order_acquire))
+            return snapshot;
+
+        std::lock_guard<std::mutex> lock(rebuild_mutex);
+        snapshot = std::atomic_load_explicit(&instance, std::memory_order_acquire);
+        // 先读取代数再读取环境，构造期间的修改会使下一次调用再次构造
+        auto current_generation = generation.load(std::memory_order_acquire);
+        if (!snapshot || snapshot->snapshot_generation != current_generation)
+        {
+            snapshot = std::shared_ptr<const environment_snapshot>(new environment_snapshot(current_generation));
+            std::atomic_store_explicit(&instance, snapshot, std::memory_order_release);
+        }
+        return snapshot;
+    }
+
+    /// <summary>
+    /// 使当前快照失效，下一次current()重新读取环境和命令行
+    /// </summary>
+    static void invalidate() noexcept { generation.fetch_add(1, std::memory_order_acq_rel); }
+
+    /// <summary>
+    /// 获取失效的次数，缓存了环境变量派生数据的调用者可以比较它来判断是否需要重新计算
+    /// </summary>
+    static std::uint64_t generation_count() noexcept { return generation.load(std::memory_order_acquire); }
+
+    environment_snapshot(const environment_snapshot&) = delete;
+    environment_snapshot(environment_snapshot&&) = delete;
+    environment_snapshot& operator=(const environment_snapshot&) = delete;
+    environment_snapshot& operator=(environment_snapshot&&) = delete;
+
+public:
+    /// <summary>
+    /// 获取环境变量的值
+    /// </summary>
+    /// <param name="name">变量名</param>
+    /// <param name="value">[out]变量的值，以0结尾</param>
+    /// <returns>变量是否存在</returns>
+    bool get(environment_string_view name, environment_string_view& value) const noexcept
+    {
+        auto it = std::lower_bound(variable_list.begin(), variable_list.end(), name,
+            [](const variable& entry, environment_string_view key) { return compare_names(entry.first, key) < 0; });
+        if (it == variable_list.end() || compare_names(it->first, name) != 0)
+            return false;
+        value = it->second;
+        return true;
+    }
+
+    /// <summary>
+    /// 获取环境变量的值，若不存在，返回default_value
+    /// </summary>
+    environment_string_view get_or(environment_string_view name, environment_string_view default_value = {}) const noexcept
+    {
+        environment_string_view value;
+        return get(name, value) ? value : default_value;
+    }
+
+    bool contains(environment_string_view name) const noexcept
+    {
+        environment_string_view value;
+        return get(name, value);
+    }
+
+    /// <summary>
+    /// 按名字排序的所有变量，Windows上不包括以'='开头的每个驱动器的当前目录
+    /// </summary>
+    const std::vector<std::pair<environment_string_view, environment_string_view>>& variables() const noexcept { return variable_list; }
+
+    /// <summary>
+    /// 命令行参数，第一个通常是程序的路径
+    /// </summary>
+    const std::vector<environment_string_view>& arguments() const noexcept { return argument_list; }
+
+    /// <summary>
+    /// 原始的命令行，Linux上是以空格连接的参数
+    /// </summary>
+    environment_string_view command_line() const noexcept { return command_line_view; }
+
+    /// <summary>
+    /// 将src中的%NAME%替换为快照中的变量值，不存在的变量保持原样，与ExpandEnvironmentStrings相同
+    /// </summary>
+    /// <param name="src">源字符串</param>
+    /// <param name="result">[out]替换后的字符串，它的内容被替换，容量被重用</param>
+    void expand(environment_string_view src, environment_string& result) const
+    {
+        result.clear();
+        result.reserve(src.size());
+        for (std::size_t i = 0; i < src.size();)
+        {
+            auto begin = src.find('%', i);
+            auto end = begin == environment_string_view::npos ? begin : src.find('%', begin + 1);
+            if (end == environment_string_view::npos)
+            {
+                result.append(src.substr(i));
+                break;
+            }
+            result.append(src.substr(i, begin - i));
+            environment_string_view value;
+            if (end > begin + 1 && get(src.substr(begin + 1, end - begin - 1), value))
+            {
+                result.append(value);
+                i = end + 1;
+            }
+            else
+            {
+                // 第二个%可能是下一个变量的开始
+                result.push_back('%');
+                i = begin + 1;
+                if (end == begin + 1)
+                {
+                    result.push_back('%');
+                    i = end + 1;
+                }
+            }
+        }
+    }
+
+private:
+    using variable = std::pair<environment_string_view, environment_string_view>;
+
+    explicit environment_snapshot(std::uint64_t snapshot_generation)
+        : snapshot_generation(snapshot_generation)
+    {
+        // 记录偏移，所有内容复制完之后再建立视图，这样缓冲区扩展不会使视图失效
+        std::vector<std::pair<std::size_t, std::size_t>> variable_offsets;
+        std::vector<std::size_t> argument_offsets;
+        std::size_t command_line_offset = 0;
+        read_environment(variable_offsets);
+        read_command_line(argument_offsets, command_line_offset);
+
+        auto view_at = [this](std::size_t offset) { return environment_string_view(buffer.c_str() + offset); };
+        variable_list.reserve(variable_offsets.size());
+        for (auto& offsets : variable_offsets)
+        {
+            auto entry = view_at(offsets.first);
+            variable_list.emplace_back(entry.substr(0, offsets.second), entry.substr(offsets.second + 1));
+        }
+        std::stable_sort(variable_list.begin(), variable_list.end(),
+            [](const variable& left, const variable& right) { return compare_names(left.first, right.first) < 0; });
+        // 同名的变量只保留第一个，与getenv和GetEnvironmentVariable一致
+        variable_list.erase(std::unique(variable_list.begin(), variable_list.end(),
+                                [](const variable& left, const variable& right) { return compare_names(left.first, right.first) == 0; }),
+            variable_list.end());
+
+        argument_list.reserve(argument_offsets.size());
+        for (auto offset : argument_offsets)
+            argument_list.push_back(view_at(offset));
+        command_line_view = view_at(command_line_offset);
+    }
+
+    static environment_char fold(environment_char c) noexcept
+    {
+#ifdef _WIN32
+        return c >= 'a' && c <= 'z' ? static_cast<environment_char>(c - ('a' - 'A')) : c;
+#else
+        return c;
+#endif
+    }
+
+    static int compare_names(environment_string_view left, environment_string_view right) noexcept
+    {
+        auto count = (std::min)(left.size(), right.size());
+        for (std::size_t i = 0; i < count; i++)
+        {
+            auto a = fold(left[i]);
+            auto b = fold(right[i]);
+            if (a != b)
+                return a < b ? -1 : 1;
+        }
+        return left.size() == right.size() ? 0 : (left.size() < right.size() ? -1 : 1);
+    }
+
+    /// <summary>
+    /// 把一个以0结尾的字符串追加到缓冲区，返回它的偏移
+    /// </summary>
+    std::size_t append(environment_string_view text)
+    {
+        auto offset = buffer.size();
+        buffer.append(text);
+        buffer.push_back(0);
+        return offset;
+    }
+
+    void add_variable(environment_string_view entry, std::vector<std::pair<std::size_t, std::size_t>>& offsets)
+    {
+        // Windows的每个驱动器的当前目录以"=C:=C:\"的形式保存，名字以'='开头，跳过它们
+        auto separator = entry.find('=');
+        if (separator == 0 || separator == environment_string_view::npos)
+            return;
+        offsets.emplace_back(append(entry), separator);
+    }
+
+#ifdef _WIN32
+    void read_environment(std::vector<std::pair<std::size_t, std::size_t>>& offsets)
+    {
+        auto block = GetEnvironmentStrings();
+        if (!block)
+            return;
+        auto end = block;
+        while (*end)
+            end += std::char_traits<TCHAR>::length(end) + 1;
+        buffer.reserve(static_cast<std::size_t>(end - block) + std::char_traits<TCHAR>::length(GetCommandLine()) * 2 + 2);
+        for (auto entry = block; *entry; entry += std::char_traits<TCHAR>::length(entry) + 1)
+            add_variable(entry, offsets);
+        FreeEnvironmentStrings(block);
+    }
+
+    void read_command_line(std::vector<std::size_t>& offsets, std::size_t& command_line_offset)
+    {
+        command_line_offset = append(GetCommandLine());
+        int argc = 0;
+        auto argv = CommandLineToArgvW(GetCommandLineW(), &argc);
+        if (!argv)
+            return;
+        for (int i = 0; i < argc; i++)
+        {
+#ifdef UNICODE
+            offsets.push_back(append(argv[i]));
+#else
+            auto length = WideCharToMultiByte(CP_ACP, 0, argv[i], -1, nullptr, 0, nullptr, nullptr);
+            auto offset = buffer.size();
+            buffer.resize(offset + (std::max)(length, 1));
+            if (length)
+                WideCharToMultiByte(CP_ACP, 0, argv[i], -1, &buffer[offset], length, nullptr, nullptr);
+            offsets.push_back(offset);
+#endif
+        }
+        LocalFree(argv);
+    }
+#else
+    void read_environment(std::vector<std::pair<std::size_t, std::size_t>>& offsets)
+    {
+        for (auto entry = environ; entry && *entry; entry++)
+            add_variable(*entry, offsets);
+    }
+
+    void read_command_line(std::vector<std::size_t>& offsets, std::size_t& command_line_offset)
+    {
+        std::string arguments;
+        if (auto file = std::fopen("/proc/self/cmdline", "rb"))
+        {
+            char chunk[4096];
+            for (std::size_t count; (count = std::fread(chunk, 1, sizeof(chunk), file)) > 0;)
+                arguments.append(chunk, count);
+            std::fclose(file);
+        }
+        std::string line;
+        for (std::size_t begin = 0; begin < arguments.size();)
+        {
+            auto length = std::strlen(arguments.c_str() + begin);
+            offsets.push_back(append(environment_string_view(arguments.c_str() + begin, length)));
+            if (!line.empty())
+                line.push_back(' ');
+            line.append(arguments, begin, length);
+            begin += length + 1;
+        }
+        command_line_offset = append(line);
+    }
+#endif
+
+    std::uint64_t snapshot_generation;
+    environment_string buffer;
+    std::vector<variable> variable_list;
+    std::vector<environment_string_view> argument_list;
+    environment_string_view command_line_view;
+
+    inline static std::shared_ptr<const environment_snapshot> instance;
+    inline static std::atomic<std::uint64_t> generation { 0 };
+    inline static std::mutex rebuild_mutex;
+};
+
+} // namespace mw
@@ -0,0 +1,583 @@
+#pragma once
+#include <atomic>
+#include <cerrno>
+#include <system_error>
+#include <thread>
+#ifndef _WIN32
+// 其他平台上没有预编译头，直接包含它，得到tzstring_view和Windows类型的替代(mw_platform.h)
+#    include "stdafx.h"
+#endif
+
+namespace mw {
+namespace error {
+
+/// <summary>
+/// 一条失败记录
+/// </summary>
+struct error_record
+{
+    /// <summary>GetLastError返回的错误代码</summary>
+    DWORD code;
+    /// <summary>失败的线程</summary>
+    DWORD thread_id;
+    /// <summary>失败的wrapper的名字，指向静态的字符串</summary>
+    const char* where;
+    /// <summary>失败时的GetTickCount64</summary>
+    ULONGLONG tick;
+};
+
+/// <summary>
+/// 记录最近的失败的无锁环形缓冲区，logging_policy把失败写到这里
+/// </summary>
+/// <remarks>
+/// 写入只有一次fetch_add和几次relaxed存储，不格式化也不分配内存，所以可以在热路径上使用；
+/// 格式化推迟到读取者调用recent之后。每个槽用序号实现顺序锁，读取时正在被覆盖的槽会被跳过，
+/// 超过capacity条的旧记录被覆盖
+/// </remarks>
+class error_log
+{
+public:
+    /// <summary>环形缓冲区的槽数，必须是2的幂</summary>
+    static constexpr size_t capacity = 256;
+
+    /// <summary>
+    /// 记录一次失败
+    /// </summary>
+    static void push(DWORD code, const char* where) noexcept
+    {
+        auto index = next.fetch_add(1, std::memory_order_relaxed);
+        auto& entry = slots[index & (capacity - 1)];
+        // 奇数序号表示正在写入
+        entry.sequence.store(index * 2 + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        entry.code.store(code, std::memory_order_relaxed);
+        entry.thread_id.store(GetCurrentThreadId(), std::memory_order_relaxed);
+        entry.where.store(where, std::memory_order_relaxed);
+        entry.tick.store(GetTickCount64(), std::memory_order_relaxed);
+        entry.sequence.store(index * 2 + 2, std::memory_order_release);
+    }
+
+    /// <summary>
+    /// 复制最近的失败记录，从新到旧排列
+    /// </summary>
+    /// <param name="records">[out]接收记录的数组</param>
+    /// <param name="max_records">数组的大小</param>
+    /// <returns>复制的记录数</returns>
+    static size_t recent(error_record* records, size_t max_records) noexcept
+    {
+        size_t count = 0;
+        auto end = next.load(std::memory_order_acquire);
+        for (auto index = end; index > 0 && end - index < capacity && count < max_records; index--)
+        {
+            auto& entry = slots[(index - 1) & (capacity - 1)];
+            auto expected = index * 2;
+            if (entry.sequence.load(std::memory_order_acquire) != expected)
+                continue;
+            error_record record = { entry.code.load(std::memory_order_relaxed), entry.thread_id.load(std::memory_order_relaxed),
+                entry.where.load(std::memory_order_relaxed), entry.tick.load(std::memory_order_relaxed) };
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (entry.sequence.load(std::memory_order_relaxed) == expected)
+                records[count++] = record;
+        }
+        return count;
+    }
+
+    /// <summary>
+    /// 获取记录过的失败总数，包括已经被覆盖的
+    /// </summary>
+    static ULONGLONG total() noexcept { return next.load(std::memory_order_relaxed); }
+
+private:
+    // 只用于静态存储，初始值都是0
+    struct slot
+    {
+        std::atomic<ULONGLONG> sequence;
+        std::atomic<DWORD> code;
+        std::atomic<DWORD> thread_id;
+        std::atomic<const char*> where;
+        std::atomic<ULONGLONG> tick;
+    };
+
+    inline static std::atomic<ULONGLONG> next { 0 };
+    inline static slot slots[capacity];
+};
+
+/// <summary>
+/// expected_policy的返回值，成功时保存wrapper的返回值，失败时还保存错误代码(类似std::expected)
+/// </summary>
+template <typename T>
+class result
+{
+public:
+    constexpr result(T value) noexcept
+        : stored(value)
+    {
+    }
+
+    /// <summary>
+    /// 构造一个失败的结果，value是API在失败时的返回值(例如FALSE或WAIT_FAILED)
+    /// </summary>
+    static constexpr result failure(T value, DWORD code) noexcept
+    {
+        result failed(value);
+        failed.code = code;
+        failed.failed = true;
+        return failed;
+    }
+
+public:
+    constexpr bool has_value() const noexcept { return !failed; }
+    constexpr explicit operator bool() const noexcept { return !failed; }
+    /// <summary>
+    /// 获取wrapper的返回值，失败时是API在失败时的返回值
+    /// </summary>
+    constexpr T value() const noexcept { return stored; }
+    constexpr T value_or(T default_value) const noexcept { return failed ? default_value : stored; }
+    /// <summary>
+    /// 获取错误代码，成功时为ERROR_SUCCESS
+    /// </summary>
+    constexpr DWORD error() const noexcept { return code; }
+
+private:
+    T stored;
+    DWORD code = ERROR_SUCCESS;
+    bool failed = false;
+};
+
+/// <summary>
+/// 不检查错误，wrapper直接返回API的返回值，没有任何额外开销
+/// </summary>
+struct ignore_policy
+{
+    template <typename T, typename Failed>
+    static constexpr T apply(T value, Failed, const char*) noexcept
+    {
+        return value;
+    }
+};
+
+/// <summary>
+/// wrapper返回result，只有失败时才调用GetLastError，成功路径上只多一次比较
+/// </summary>
+struct expected_policy
+{
+    template <typename T, typename Failed>
+    static result<T> apply(T value, Failed failed, const char*) noexcept
+    {
+        if (failed(value))
+            return result<T>::failure(value, GetLastError());
+        return value;
+    }
+};
+
+/// <summary>
+/// 失败时抛出std::system_error，其中的错误代码属于std::system_category()
+/// </summary>
+struct throwing_policy
+{
+    template <typename T, typename Failed>
+    static T apply(T value, Failed failed, const char* where)
+    {
+        if (failed(value))
+            throw std::system_error(static_cast<int>(GetLastError()), std::system_category(), where);
+        return value;
+    }
+};
+
+/// <summary>
+/// 失败时把错误代码写入error_log，不格式化
+/// </summary>
+struct logging_policy
+{
+    template <typename T, typename Failed>
+    static T apply(T value, Failed failed, const char* where) noexcept
+    {
+        if (failed(value))
+            error_log::push(GetLastError(), where);
+        return value;
+    }
+};
+
+/// <summary>
+/// 失败时使用GET_ERROR_MSG_OUTPUT格式化并输出错误(定义了MY_WINDOWS_PRINT_ERROR时)，与以前的输出相同，但成功时不再检查GetLastError
+/// </summary>
+struct printing_policy
+{
+    template <typename T, typename Failed>
+    static T apply(T value, Failed failed, const char*)
+    {
+        if (failed(value))
+        {
+            GET_ERROR_MSG_OUTPUT();
+        }
+        return value;
+    }
+};
+
+/// <summary>
+/// 在调用处选择策略的标签，例如mw::sync::set_event(handle, mw::error::expected)
+/// </summary>
+constexpr ignore_policy ignore {};
+constexpr expected_policy expected {};
+constexpr throwing_policy throwing {};
+constexpr logging_policy logging {};
+constexpr printing_policy printing {};
+
+/// <summary>
+/// 返回FALSE表示失败的API使用的谓词，使用lambda而不是函数指针，保证在策略中被内联
+/// </summary>
+inline constexpr auto is_false = [](bool value) noexcept { return !value; };
+
+/// <summary>
+/// 返回WAIT_FAILED表示失败的等待函数使用的谓词
+/// </summary>
+inline constexpr auto is_wait_failed = [](DWORD value) noexcept { return value == WAIT_FAILED; };
+
+/// <summary>
+/// 返回NULL表示失败的API(例如VirtualAllocEx，CreateFileMapping)使用的谓词
+/// </summary>
+inline constexpr auto is_null = [](const void* value) noexcept { return value == nullptr; };
+
+/// <summary>
+/// 返回0表示失败的API(例如VirtualQueryEx返回的字节数)使用的谓词
+/// </summary>
+inline constexpr auto is_zero = [](SIZE_T value) noexcept { return value == 0; };
+
+/// <summary>
+/// 直接返回非0错误代码的API(例如GetAddrInfo)使用的谓词
+/// </summary>
+inline constexpr auto is_nonzero = [](INT value) noexcept { return value != 0; };
+
+#ifdef _WIN32
+/// <summary>
+/// 返回INVALID_HANDLE_VALUE表示失败的API(例如CreateFile)使用的谓词
+/// </summary>
+inline constexpr auto is_invalid_handle = [](HANDLE value) noexcept { return value == INVALID_HANDLE_VALUE; };
+
+/// <summary>
+/// 可以异步完成的ReadFile和WriteFile使用的谓词，FALSE并且错误代码为ERROR_IO_PENDING时不是失败。
+/// 只有返回FALSE时才读取错误代码
+/// </summary>
+inline constexpr auto is_io_failed = [](bool value) noexcept { return !value && GetLastError() != ERROR_IO_PENDING; };
+
+/// <summary>
+/// GetQueuedCompletionStatus使用的谓词，超时(WAIT_TIMEOUT)不是失败，与等待函数的超时一致
+/// </summary>
+inline constexpr auto is_dequeue_failed = [](bool value) noexcept { return !value && GetLastError() != WAIT_TIMEOUT; };
+#endif
+
+namespace error_detail {
+
+struct code_text
+{
+    int code;
+    PCTSTR text;
+};
+
+/// <summary>
+/// 常见的Win32和WinSock错误代码的英文文本，与FormatMessage在英文系统上的输出相同。
+/// FormatMessage失败或者不在Windows上时使用
+/// </summary>
+inline constexpr code_text win32_texts[] = {
+    { 0, _T("The operation completed successfully.") },
+    { 1, _T("Incorrect function.") },
+    { 2, _T("The system cannot find the file specified.") },
+    { 3, _T("The system cannot find the path specified.") },
+    { 4, _T("The system cannot open the file.") },
+    { 5, _T("Access is denied.") },
+    { 6, _T("The handle is invalid.") },
+    { 8, _T("Not enough memory resources are available to process this command.") },
+    { 14, _T("Not enough memory resources are available to complete this operation.") },
+    { 32, _T("The process cannot access the file because it is being used by another process.") },
+    { 38, _T("Reached the end of the file.") },
+    { 50, _T("The request is not supported.") },
+    { 64, _T("The specified network name is no longer available.") },
+    { 80, _T("The file exists.") },
+    { 87, _T("The parameter is incorrect.") },
+    { 109, _T("The pipe has been ended.") },
+    { 122, _T("The data area passed to a system call is too small.") },
+    { 183, _T("Cannot create a file when that file already exists.") },
+    { 258, _T("The wait operation timed out.") },
+    { 995, _T("The I/O operation has been aborted because of either a thread exit or an application request.") },
+    { 996, _T("Overlapped I/O event is not in a signaled state.") },
+    { 997, _T("Overlapped I/O operation is in progress.") },
+    { 1236, _T("The network connection was aborted by the local system.") },
+    { 1460, _T("This operation returned because the timeout period expired.") },
+    { 10004, _T("A blocking operation was interrupted by a call to WSACancelBlockingCall.") },
+    { 10009, _T("The file handle supplied is not valid.") },
+    { 10013, _T("An attempt was made to access a socket in a way forbidden by its access permissions.") },
+    { 10014, _T("The system detected an invalid pointer address in attempting to use a pointer argument in a call.") },
+    { 10022, _T("An invalid argument was supplied.") },
+    { 10024, _T("Too many open sockets.") },
+    { 10035, _T("A non-blocking socket operation could not be completed immediately.") },
+    { 10036, _T("A blocking operation is currently executing.") },
+    { 10038, _T("An operation was attempted on something that is not a socket.") },
+    { 10048, _T("Only one usage of each socket address (protocol/network address/port) is normally permitted.") },
+    { 10049, _T("The requested address is not valid in its context.") },
+    { 10050, _T("A socket operation encountered a dead network.") },
+    { 10051, _T("A socket operation was attempted to an unreachable network.") },
+    { 10053, _T("An established connection was aborted by the software in your host machine.") },
+    { 10054, _T("An existing connection was forcibly closed by the remote host.") },
+    { 10055, _T("An operation on a socket could not be performed because the system lacked sufficient buffer space or because a queue was full.") },
+    { 10057, _T("A request to send or receive data was disallowed because the socket is not connected and (when sending on a datagram socket using a sendto call) no address was supplied.") },
+    { 10060, _T("A connection attempt failed because the connected party did not properly respond after a period of time, or established connection failed because connected host has failed to respond.") },
+    { 10061, _T("No connection could be made because the target machine actively refused it.") },
+    { 10065, _T("A socket operation was attempted to an unreachable host.") },
+    { 10093, _T("Either the application has not called WSAStartup, or WSAStartup failed.") },
+    { 11001, _T("No such host is known.") },
+};
+
+/// <summary>
+/// 常见的errno的文本，CRT函数(例如_beginthreadex)通过errno报告错误
+/// </summary>
+inline constexpr code_text errno_texts[] = {
+    { EPERM, _T("Operation not permitted") },
+    { ENOENT, _T("No such file or directory") },
+    { EINTR, _T("Interrupted function call") },
+    { EIO, _T("Input/output error") },
+    { EBADF, _T("Bad file descriptor") },
+    { EAGAIN, _T("Resource temporarily unavailable") },
+    { ENOMEM, _T("Not enough space") },
+    { EACCES, _T("Permission denied") },
+    { EEXIST, _T("File exists") },
+    { EINVAL, _T("Invalid argument") },
+    { EMFILE, _T("Too many open files") },
+    { ENOSPC, _T("No space left on device") },
+    { EPIPE, _T("Broken pipe") },
+    { EADDRINUSE, _T("Address in use") },
+    { EADDRNOTAVAIL, _T("Address not available") },
+    { ECONNABORTED, _T("Connection aborted") },
+    { ECONNREFUSED, _T("Connection refused") },
+    { ECONNRESET, _T("Connection reset") },
+    { ENOTCONN, _T("Not connected") },
+    { ETIMEDOUT, _T("Connection timed out") },
+};
+
+template <size_t N>
+inline PCTSTR find_text(const code_text (&texts)[N], int code) noexcept
+{
+    for (auto& entry : texts)
+    {
+        if (entry.code == code)
+            return entry.text;
+    }
+    return nullptr;
+}
+
+/// <summary>
+/// 复制文本到缓冲区，超出时截断，总是以0结尾(size大于0时)
+/// </summary>
+inline size_t copy_text(PCTSTR text, TCHAR* buffer, size_t size) noexcept
+{
+    if (!size)
+        return 0;
+    size_t length = 0;
+    for (; text[length] && length + 1 < size; length++)
+        buffer[length] = text[length];
+    buffer[length] = 0;
+    return length;
+}
+
+/// <summary>
+/// 不认识的错误代码输出"Unknown error "加十进制的代码
+/// </summary>
+inline size_t format_unknown(unsigned long code, TCHAR* buffer, size_t size) noexcept
+{
+    TCHAR digits[16];
+    size_t count = 0;
+    do
+    {
+        digits[count++] = static_cast<TCHAR>(_T('0') + code % 10);
+        code /= 10;
+    } while (code);
+
+    auto length = copy_text(_T("Unknown error "), buffer, size);
+    while (count && length + 1 < size)
+        buffer[length++] = digits[--count];
+    if (size)
+        buffer[length] = 0;
+    return length;
+}
+
+} // namespace error_detail
+
+/// <summary>
+/// 将Win32或WinSock错误代码格式化到调用者的缓冲区，不分配内存，超出时截断
+/// </summary>
+/// <remarks>
+/// 优先复制error_message已经缓存的文本；否则使用FormatMessage直接写入缓冲区(不使用FORMAT_MESSAGE_ALLOCATE_BUFFER)，
+/// 它失败或者不在Windows上时使用常见错误代码的表，最后输出"Unknown error "加代码。去掉了FormatMessage在末尾加上的换行
+/// </remarks>
+/// <param name="error_code">错误代码</param>
+/// <param name="buffer">[out]接收以0结尾的文本的缓冲区</param>
+/// <param name="size">缓冲区的字符数</param>
+/// <returns>写入的字符数，不包括结尾的0</returns>
+inline size_t format_error_into(DWORD error_code, TCHAR* buffer, size_t size) noexcept;
+
+/// <summary>
+/// 将错误代码格式化到数组中，不分配内存
+/// </summary>
+template <size_t N>
+inline size_t format_error_into(DWORD error_code, TCHAR (&buffer)[N]) noexcept
+{
+    return format_error_into(error_code, buffer, N);
+}
+
+/// <summary>
+/// 将errno格式化到调用者的缓冲区，不分配内存，超出时截断
+/// </summary>
+/// <returns>写入的字符数，不包括结尾的0</returns>
+inline size_t format_errno_into(int error_number, TCHAR* buffer, size_t size) noexcept
+{
+    if (auto text = error_detail::find_text(error_detail::errno_texts, error_number))
+        return error_detail::copy_text(text, buffer, size);
+    return error_detail::format_unknown(static_cast<unsigned long>(error_number), buffer, size);
+}
+
+/// <summary>
+/// 将errno格式化到数组中，不分配内存
+/// </summary>
+template <size_t N>
+inline size_t format_errno_into(int error_number, TCHAR (&buffer)[N]) noexcept
+{
+    return format_errno_into(error_number, buffer, N);
+}
+
+/// <summary>
+/// 错误代码到文本的缓存，每个错误代码的文本只格式化一次，之后在整个进程中共享
+/// </summary>
+/// <remarks>
+/// 开放寻址的静态表，查找是无锁的，只有acquire读取。第一个遇到某个错误代码的线程用CAS占据槽位，
+/// 格式化并分配一次文本后发布，同时查找同一个代码的线程等待它发布。文本在进程结束前不释放，
+/// 表满(超过capacity个不同的错误代码)后新的代码不再缓存，文本写入调用线程的缓冲区
+/// </remarks>
+class message_cache
+{
+public:
+    /// <summary>表的槽数，必须是2的幂</summary>
+    static constexpr size_t capacity = 256;
+
+    /// <summary>
+    /// 获取已经缓存的文本，若没有缓存，返回nullptr
+    /// </summary>
+    static PCTSTR find(DWORD error_code) noexcept
+    {
+        auto key = to_key(error_code);
+        for (size_t i = 0, index = hash(error_code); i < capacity; i++, index = (index + 1) & (capacity - 1))
+        {
+            auto current = slots[index].key.load(std::memory_order_acquire);
+            if (current == key)
+                return slots[index].text.load(std::memory_order_acquire);
+            if (!current)
+                return nullptr;
+        }
+        return nullptr;
+    }
+
+    /// <summary>
+    /// 获取错误代码的文本，第一次获取某个代码时格式化并缓存
+    /// </summary>
+    static PCTSTR get(DWORD error_code)
+    {
+        auto key = to_key(error_code);
+        for (size_t i = 0, index = hash(error_code); i < capacity; i++, index = (index + 1) & (capacity - 1))
+        {
+            auto& entry = slots[index];
+            auto current = entry.key.load(std::memory_order_acquire);
+            if (!current && entry.key.compare_exchange_strong(current, key, std::memory_order_acq_rel))
+            {
+                TCHAR buffer[MW_MAX_TEXT];
+                auto length = format_error_into(error_code, buffer, MW_MAX_TEXT);
+                auto text = new TCHAR[length + 1];
+                std::char_traits<TCHAR>::copy(text, buffer, length + 1);
+                entry.text.store(text, std::memory_order_release);
+                return text;
+            }
+            if (current != key)
+                continue;
+            // 另一个线程正在格式化这个代码
+            PCTSTR text = nullptr;
+            while (!(text = entry.text.load(std::memory_order_acquire)))
+                std::this_thread::yield();
+            return text;
+        }
+
+        thread_local TCHAR overflow[MW_MAX_TEXT];
+        format_error_into(error_code, overflow, MW_MAX_TEXT);
+        return overflow;
+    }
+
+private:
+    // 槽的键是错误代码加1，0表示空槽
+    static ULONGLONG to_key(DWORD error_code) noexcept { return static_cast<ULONGLONG>(error_code) + 1; }
+    static size_t hash(DWORD error_code) noexcept { return (error_code * 2654435761u) >> 8 & (capacity - 1); }
+
+    // 只用于静态存储，初始值都是0
+    struct slot
+    {
+        std::atomic<ULONGLONG> key;
+        std::atomic<PCTSTR> text;
+    };
+
+    inline static slot slots[capacity];
+};
+
+inline size_t format_error_into(DWORD error_code, TCHAR* buffer, size_t size) noexcept
+{
+    if (!size)
+        return 0;
+    if (auto text = message_cache::find(error_code))
+        return error_detail::copy_text(text, buffer, size);
+#ifdef _WIN32
+    auto length = static_cast<size_t>(FormatMessage(FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS,
+        nullptr, error_code, MAKELANGID(LANG_ENGLISH, SUBLANG_ENGLISH_US), buffer, static_cast<DWORD>((std::min)(size, size_t(64 * 1024))), nullptr));
+    if (length)
+    {
+        while (length && (buffer[length - 1] == _T('\n') || buffer[length - 1] == _T('\r') || buffer[length - 1] == _T(' ')))
+            buffer[--length] = 0;
+        return length;
+    }
+#endif
+    if (auto text = error_detail::find_text(error_detail::win32_texts, static_cast<int>(error_code)))
+        return error_detail::copy_text(text, buffer, size);
+    return error_detail::format_unknown(error_code, buffer, size);
+}
+
+/// <summary>
+/// 获取错误代码对应的文本，每个代码只格式化一次，返回的视图在进程结束前有效(缓存满时见message_cache)
+/// </summary>
+/// <param name="error_code">错误代码</param>
+/// <returns>以0结尾的文本</returns>
+inline tzstring_view error_message(DWORD error_code)
+{
+    return message_cache::get(error_code);
+}
+
+} // namespace error
+
+/// <summary>
+/// 将错误代码转换成对应的文本提示，文本经过缓存，每个错误代码只调用一次FormatMessage
+/// </summary>
+/// <param name="error_code">错误代码</param>
+/// <returns>返回错误代码对应的文本提示信息</returns>
+inline std::tstring formate_error_code(DWORD error_code)
+{
+    return error::error_message(error_code).to_string();
+}
+
+} // namespace mw
+
+// 没有在调用处指定策略时使用的默认策略，可以在包含my_windows.h之前定义为mw::error中的任意策略(或者有同样接口的自定义策略)。
+// 默认与GET_ERROR_MSG_OUTPUT的设置一致：定义了MY_WINDOWS_PRINT_ERROR时打印，否则忽略。
+// wrapper都是inline的，所以同一个程序的翻译单元应该使用相同的默认策略，这与MY_WINDOWS_PRINT_ERROR的要求相同；调用处的标签不受此限制。
+// 库内部也会比较wrapper的返回值，所以默认策略必须原样返回值，expected_policy只能在调用处指定。
+// 使用策略的wrapper：mw::sync中的事件，信号量，互斥量，等待和可等待计时器函数，mw_device.h，mw_socket.h和mw_memory.h中的全部wrapper
+// (heap_alloc和heap_realloc失败时不设置GetLastError，不使用策略)。其他头文件中的wrapper仍然使用GET_ERROR_MSG_OUTPUT，
+// 只受MY_WINDOWS_PRINT_ERROR影响，不受这个宏影响
+#ifndef MY_WINDOWS_ERROR_POLICY
+#    ifdef MY_WINDOWS_PRINT_ERROR
+#        define MY_WINDOWS_ERROR_POLICY mw::error::printing_policy
+#    else
+#        define MY_WINDOWS_ERROR_POLICY mw::error::ignore_policy
+#    endif
+#endif
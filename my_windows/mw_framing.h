@@ -0,0 +1,684 @@
+#pragma once
+#include "mw_buffer_pool.h"
+#include <algorithm>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace mw::net {
+
+/// <summary>
+/// 接收缓冲区链，按顺序保存一个字节流中还未被消费的若干段数据，数据本身不会被复制
+/// </summary>
+/// <remarks>
+/// 每一段可以是缓冲区池中的块(链会持有它的引用，直到该段被完全消费)，也可以是调用者保证生命期的普通内存。
+/// 帧可以跨越多个段，解码器返回的frame_view直接引用链中的数据。
+/// 链记录从创建以来被消费的总字节数(position)，解码器用它保存跨多次解码的扫描进度。
+/// 保存段的vector的容量会被重用，稳定状态下不会分配内存
+/// </remarks>
+class buffer_chain
+{
+public:
+    /// <summary>
+    /// 链中的一段数据
+    /// </summary>
+    struct piece
+    {
+        /// <summary>数据所在的块，若是普通内存则为空</summary>
+        buffer_ref owner;
+        const char* data = nullptr;
+        size_t size = 0;
+    };
+
+public:
+    /// <summary>
+    /// 在链的末尾追加缓冲区池中的块的一部分，链持有对块的引用
+    /// </summary>
+    /// <param name="buffer">数据所在的块</param>
+    /// <param name="offset">数据在块中的偏移</param>
+    /// <param name="size">数据的字节数</param>
+    void append(buffer_ref buffer, size_t offset, size_t size)
+    {
+        if (!size)
+            return;
+        auto data = buffer.data() + offset;
+        pieces.push_back({ std::move(buffer), data, size });
+        total_size += size;
+    }
+
+    /// <summary>
+    /// 在链的末尾追加一段普通内存，调用者需要保证在它被消费之前内存有效
+    /// </summary>
+    /// <param name="data">数据</param>
+    /// <param name="size">数据的字节数</param>
+    void append(const char* data, size_t size)
+    {
+        if (!size)
+            return;
+        pieces.push_back({ buffer_ref(), data, size });
+        total_size += size;
+    }
+
+    /// <summary>
+    /// 从链的开头消费指定字节数，被完全消费的段会被释放
+    /// </summary>
+    /// <param name="size">要消费的字节数，超过size()时消费全部数据</param>
+    void consume(size_t size)
+    {
+        if (size > total_size)
+            size = total_size;
+        total_size -= size;
+        consumed += size;
+        while (size)
+        {
+            auto& front = pieces[head];
+            if (size < front.size)
+            {
+                front.data += size;
+                front.size -= size;
+                break;
+            }
+            size -= front.size;
+            front.owner.reset();
+            head++;
+        }
+        // 已消费的段占了一半以上时，把剩余的段移动到开头
+        if (head == pieces.size())
+        {
+            pieces.clear();
+            head = 0;
+        }
+        else if (head > 16 && head * 2 > pieces.size())
+        {
+            pieces.erase(pieces.begin(), pieces.begin() + head);
+            head = 0;
+        }
+    }
+
+    /// <summary>
+    /// 消费链中的全部数据
+    /// </summary>
+    void clear() { consume(total_size); }
+
+    /// <summary>链中未消费的字节数</summary>
+    size_t size() const { return total_size; }
+    bool empty() const { return total_size == 0; }
+    /// <summary>从创建以来被消费的总字节数，即链开头的数据在整个字节流中的位置</summary>
+    ULONGLONG position() const { return consumed; }
+    /// <summary>链中段的数量</summary>
+    size_t piece_count() const { return pieces.size() - head; }
+
+    /// <summary>
+    /// 获取链中指定偏移的字节，offset必须小于size()
+    /// </summary>
+    char at(size_t offset) const
+    {
+        for (auto i = head;; i++)
+        {
+            if (offset < pieces[i].size)
+                return pieces[i].data[offset];
+            offset -= pieces[i].size;
+        }
+    }
+
+    /// <summary>
+    /// 按顺序对链中指定范围内的每一段连续内存调用回调，不复制数据
+    /// </summary>
+    /// <param name="offset">范围的起始偏移</param>
+    /// <param name="size">范围的字节数</param>
+    /// <param name="callback">void(const char* data, size_t size)</param>
+    template <typename function>
+    void for_each_piece(size_t offset, size_t size, function&& callback) const
+    {
+        for (auto i = head; size && i < pieces.size(); i++)
+        {
+            auto& current = pieces[i];
+            if (offset >= current.size)
+            {
+                offset -= current.size;
+                continue;
+            }
+            auto length = (std::min)(size, current.size - offset);
+            callback(current.data + offset, length);
+            size -= length;
+            offset = 0;
+        }
+    }
+
+    /// <summary>
+    /// 把链中指定范围的数据复制到连续内存中
+    /// </summary>
+    /// <param name="offset">范围的起始偏移</param>
+    /// <param name="output">[out]接收数据的缓冲区</param>
+    /// <param name="size">要复制的字节数</param>
+    /// <returns>实际复制的字节数</returns>
+    size_t copy_to(size_t offset, char* output, size_t size) const
+    {
+        size_t copied = 0;
+        for_each_piece(offset, size, [&](const char* data, size_t length) {
+            std::memcpy(output + copied, data, length);
+            copied += length;
+        });
+        return copied;
+    }
+
+    /// <summary>
+    /// 若链中指定范围位于同一段内，返回指向它的指针，否则返回nullptr
+    /// </summary>
+    const char* contiguous(size_t offset, size_t size) const
+    {
+        for (auto i = head; i < pieces.size(); i++)
+        {
+            if (offset < pieces[i].size)
+                return offset + size <= pieces[i].size ? pieces[i].data + offset : nullptr;
+            offset -= pieces[i].size;
+        }
+        return size == 0 ? "" : nullptr;
+    }
+
+    /// <summary>
+    /// 从指定偏移开始查找一个字节
+    /// </summary>
+    /// <returns>找到的偏移，若没有找到返回size()</returns>
+    size_t find(char value, size_t offset = 0) const
+    {
+        size_t base = 0;
+        for (auto i = head; i < pieces.size(); i++)
+        {
+            auto& current = pieces[i];
+            if (offset < base + current.size)
+            {
+                auto start = offset > base ? offset - base : 0;
+                if (auto found = std::memchr(current.data + start, static_cast<unsigned char>(value), current.size - start))
+                    return base + (static_cast<const char*>(found) - current.data);
+            }
+            base += current.size;
+        }
+        return total_size;
+    }
+
+private:
+    std::vector<piece> pieces;
+    /// <summary>第一个未被完全消费的段的下标</summary>
+    size_t head = 0;
+    size_t total_size = 0;
+    ULONGLONG consumed = 0;
+};
+
+/// <summary>
+/// 一段连续内存，它有与buffer_chain相同的只读接口，可以直接作为解码器的数据源，不需要缓冲区池
+/// </summary>
+/// <remarks>
+/// 解码器只使用数据源的size，position，at，for_each_piece，copy_to，contiguous和find，
+/// 用它解码已经在连续内存中的数据(例如文件或模糊测试的输入)，consume后position前进，所以delimiter_codec的扫描进度仍然有效
+/// </remarks>
+class byte_span
+{
+public:
+    byte_span() = default;
+    /// <param name="data">数据，调用者需要保证它在span的生命期内有效</param>
+    /// <param name="size">数据的字节数</param>
+    /// <param name="position">数据开头在整个字节流中的位置</param>
+    byte_span(const char* data, size_t size, ULONGLONG position = 0)
+        : first(data)
+        , total_size(size)
+        , consumed(position)
+    {
+    }
+
+    /// <summary>
+    /// 从开头消费指定字节数
+    /// </summary>
+    /// <param name="size">要消费的字节数，超过size()时消费全部数据</param>
+    void consume(size_t size)
+    {
+        size = (std::min)(size, total_size);
+        first += size;
+        total_size -= size;
+        consumed += size;
+    }
+
+    size_t size() const { return total_size; }
+    bool empty() const { return total_size == 0; }
+    ULONGLONG position() const { return consumed; }
+    const char* data() const { return first; }
+    char at(size_t offset) const { return first[offset]; }
+
+    template <typename function>
+    void for_each_piece(size_t offset, size_t size, function&& callback) const
+    {
+        if (offset < total_size && size)
+            callback(first + offset, (std::min)(size, total_size - offset));
+    }
+
+    size_t copy_to(size_t offset, char* output, size_t size) const
+    {
+        if (offset >= total_size)
+            return 0;
+        size = (std::min)(size, total_size - offset);
+        std::memcpy(output, first + offset, size);
+        return size;
+    }
+
+    const char* contiguous(size_t offset, size_t size) const
+    {
+        if (offset + size <= total_size)
+            return first + offset;
+        return size == 0 ? "" : nullptr;
+    }
+
+    size_t find(char value, size_t offset = 0) const
+    {
+        if (offset >= total_size)
+            return total_size;
+        auto found = std::memchr(first + offset, static_cast<unsigned char>(value), total_size - offset);
+        return found ? static_cast<size_t>(static_cast<const char*>(found) - first) : total_size;
+    }
+
+private:
+    const char* first = nullptr;
+    size_t total_size = 0;
+    ULONGLONG consumed = 0;
+};
+
+/// <summary>
+/// 解码出的帧的负载，它直接引用数据源(buffer_chain或byte_span)中的数据，在数据源被消费之前有效
+/// </summary>
+template <typename source_type>
+struct basic_frame_view
+{
+    const source_type* chain = nullptr;
+    /// <summary>负载在数据源中的偏移</summary>
+    size_t offset = 0;
+    size_t size = 0;
+
+    /// <summary>若负载位于同一段内，返回指向它的指针，否则返回nullptr，此时可以使用for_each_piece或copy_to</summary>
+    const char* contiguous() const { return chain->contiguous(offset, size); }
+
+    /// <summary>按顺序对负载的每一段连续内存调用回调，回调的原型为void(const char* data, size_t size)</summary>
+    template <typename function>
+    void for_each_piece(function&& callback) const
+    {
+        chain->for_each_piece(offset, size, std::forward<function>(callback));
+    }
+
+    /// <summary>把负载复制到连续内存中，最多复制output_size字节，返回实际复制的字节数</summary>
+    size_t copy_to(char* output, size_t output_size) const
+    {
+        return chain->copy_to(offset, output, (std::min)(size, output_size));
+    }
+};
+
+using frame_view = basic_frame_view<buffer_chain>;
+
+/// <summary>
+/// 解码的结果
+/// </summary>
+enum class decode_status
+{
+    /// <summary>解码出一个完整的帧</summary>
+    frame,
+    /// <summary>数据不足一个帧，需要接收更多数据</summary>
+    need_more,
+    /// <summary>数据不合法(例如帧超过最大长度)，字节流无法继续解码，应关闭连接</summary>
+    error,
+};
+
+/// <summary>
+/// 解码出的一个帧
+/// </summary>
+template <typename source_type>
+struct basic_decoded_frame
+{
+    /// <summary>帧的负载，不包括长度前缀或分隔符</summary>
+    basic_frame_view<source_type> payload;
+    /// <summary>整个帧在链中占用的字节数，处理完负载后应调用chain.consume(frame_size)</summary>
+    size_t frame_size = 0;
+};
+
+using decoded_frame = basic_decoded_frame<buffer_chain>;
+
+/// <summary>
+/// 长度前缀的格式
+/// </summary>
+enum class length_prefix
+{
+    /// <summary>LEB128变长整数(每字节7位，低位在前，最高位表示后面还有字节)</summary>
+    varint,
+    u16_big_endian,
+    u16_little_endian,
+    u32_big_endian,
+    u32_little_endian,
+};
+
+/// <summary>
+/// 长度前缀帧的编解码器，每个帧是一个长度前缀，后面跟着指定长度的负载，它是无状态的，可以被多个连接共享
+/// </summary>
+class length_prefix_codec
+{
+public:
+    /// <summary>变长整数长度前缀的最大字节数(足以表示64位整数)</summary>
+    static constexpr size_t max_header_size = 10;
+
+    /// <param name="format">长度前缀的格式</param>
+    /// <param name="max_frame_size">负载的最大字节数，超过它时解码返回error，编码返回false</param>
+    explicit length_prefix_codec(length_prefix format = length_prefix::varint, size_t max_frame_size = 16 * 1024 * 1024)
+        : format(format)
+        , max_frame_size(max_frame_size)
+    {
+        if (format == length_prefix::u16_big_endian || format == length_prefix::u16_little_endian)
+            this->max_frame_size = (std::min)(max_frame_size, static_cast<size_t>(0xFFFF));
+        else if (format != length_prefix::varint)
+            this->max_frame_size = (std::min)(max_frame_size, static_cast<size_t>(0xFFFFFFFF));
+    }
+
+    /// <summary>
+    /// 从链的开头解码一个帧
+    /// </summary>
+    /// <param name="chain">接收缓冲区链或byte_span</param>
+    /// <param name="result">[out]若返回frame，接收解码出的帧</param>
+    template <typename source_type>
+    decode_status decode(const source_type& chain, basic_decoded_frame<source_type>& result) const
+    {
+        unsigned char header[max_header_size];
+        auto available = chain.copy_to(0, reinterpret_cast<char*>(header), max_header_size);
+        ULONGLONG length = 0;
+        size_t header_size = 0;
+
+        switch (format)
+        {
+        case length_prefix::varint:
+        {
+            for (;; header_size++)
+            {
+                if (header_size == available)
+                    return available == max_header_size ? decode_status::error : decode_status::need_more;
+                // 第10个字节只能提供64位整数的最高位，更大的值(或继续位)会溢出
+                if (header_size == max_header_size - 1 && header[header_size] > 1)
+                    return decode_status::error;
+                length |= static_cast<ULONGLONG>(header[header_size] & 0x7F) << (7 * header_size);
+                if (!(header[header_size] & 0x80))
+                    break;
+            }
+            header_size++;
+            break;
+        }
+        case length_prefix::u16_big_endian:
+        case length_prefix::u16_little_endian:
+        case length_prefix::u32_big_endian:
+        case length_prefix::u32_little_endian:
+        {
+            bool big_endian = format == length_prefix::u16_big_endian || format == length_prefix::u32_big_endian;
+            header_size = format == length_prefix::u16_big_endian || format == length_prefix::u16_little_endian ? 2 : 4;
+            if (available < header_size)
+                return decode_status::need_more;
+            for (size_t i = 0; i < header_size; i++)
+                length |= static_cast<ULONGLONG>(header[big_endian ? i : header_size - 1 - i]) << (8 * (header_size - 1 - i));
+            break;
+        }
+        }
+
+        if (length > max_frame_size)
+            return decode_status::error;
+        if (chain.size() - header_size < length)
+            return decode_status::need_more;
+        result.payload = { &chain, header_size, static_cast<size_t>(length) };
+        result.frame_size = header_size + static_cast<size_t>(length);
+        return decode_status::frame;
+    }
+
+    /// <summary>
+    /// 写入负载的长度前缀
+    /// </summary>
+    /// <param name="payload_size">负载的字节数</param>
+    /// <param name="output">[out]接收长度前缀的缓冲区，至少有max_header_size字节</param>
+    /// <returns>长度前缀的字节数，若负载超过最大长度，返回0</returns>
+    size_t encode_header(size_t payload_size, char* output) const
+    {
+        if (payload_size > max_frame_size)
+            return 0;
+        auto bytes = reinterpret_cast<unsigned char*>(output);
+        switch (format)
+        {
+        case length_prefix::varint:
+        {
+            size_t size = 0;
+            ULONGLONG value = payload_size;
+            do
+            {
+                bytes[size] = static_cast<unsigned char>(value & 0x7F);
+                value >>= 7;
+                if (value)
+                    bytes[size] |= 0x80;
+                size++;
+            } while (value);
+            return size;
+        }
+        case length_prefix::u16_big_endian:
+        case length_prefix::u16_little_endian:
+        case length_prefix::u32_big_endian:
+        case length_prefix::u32_little_endian:
+        {
+            bool big_endian = format == length_prefix::u16_big_endian || format == length_prefix::u32_big_endian;
+            size_t size = format == length_prefix::u16_big_endian || format == length_prefix::u16_little_endian ? 2 : 4;
+            for (size_t i = 0; i < size; i++)
+                bytes[big_endian ? size - 1 - i : i] = static_cast<unsigned char>(payload_size >> (8 * i));
+            return size;
+        }
+        }
+        return 0;
+    }
+
+    /// <summary>帧的结尾，长度前缀帧没有结尾</summary>
+    std::string_view trailer() const { return {}; }
+
+    size_t get_max_frame_size() const { return max_frame_size; }
+
+private:
+    length_prefix format;
+    size_t max_frame_size;
+};
+
+/// <summary>
+/// 分隔符帧的编解码器，每个帧是负载后面跟着分隔符(例如"\r\n")
+/// </summary>
+/// <remarks>
+/// 解码器会记住已经扫描过的位置，数据不完整时下次解码不会重新扫描已经扫描过的数据，所以每个字节流需要一个自己的解码器。
+/// 编码时不检查负载中是否包含分隔符
+/// </remarks>
+class delimiter_codec
+{
+public:
+    /// <param name="delimiter">分隔符，不能为空，codec不复制它，需要保证它在codec的生命期内有效</param>
+    /// <param name="max_frame_size">负载的最大字节数，超过它仍没有找到分隔符时解码返回error</param>
+    explicit delimiter_codec(std::string_view delimiter = "\r\n", size_t max_frame_size = 64 * 1024)
+        : delimiter(delimiter)
+        , max_frame_size(max_frame_size)
+    {
+    }
+
+    /// <summary>
+    /// 从链的开头解码一个帧
+    /// </summary>
+    /// <param name="chain">接收缓冲区链或byte_span，必须总是同一个字节流的数据</param>
+    /// <param name="result">[out]若返回frame，接收解码出的帧</param>
+    template <typename source_type>
+    decode_status decode(const source_type& chain, basic_decoded_frame<source_type>& result)
+    {
+        // 从上次扫描结束的位置继续，之前的位置已经确定不是分隔符的开始
+        size_t offset = scanned > chain.position() ? static_cast<size_t>(scanned - chain.position()) : 0;
+        auto size = chain.size();
+        for (;;)
+        {
+            offset = chain.find(delimiter[0], offset);
+            if (offset + delimiter.size() > size)
+            {
+                // offset之前的位置都不可能是分隔符的开始，offset处可能是不完整的分隔符，下次从那里开始扫描
+                scanned = chain.position() + offset;
+                return offset > max_frame_size ? decode_status::error : decode_status::need_more;
+            }
+            if (matches(chain, offset))
+                break;
+            offset++;
+        }
+
+        if (offset > max_frame_size)
+            return decode_status::error;
+        result.payload = { &chain, 0, offset };
+        result.frame_size = offset + delimiter.size();
+        scanned = chain.position() + result.frame_size;
+        return decode_status::frame;
+    }
+
+    /// <summary>
+    /// 重置扫描进度，开始解码新的字节流时调用
+    /// </summary>
+    void reset() { scanned = 0; }
+
+    /// <summary>分隔符帧没有长度前缀，总是返回0</summary>
+    size_t encode_header(size_t, char*) const { return 0; }
+
+    /// <summary>帧的结尾，即分隔符</summary>
+    std::string_view trailer() const { return delimiter; }
+
+    size_t get_max_frame_size() const { return max_frame_size; }
+
+private:
+    template <typename source_type>
+    bool matches(const source_type& chain, size_t offset) const
+    {
+        if (auto data = chain.contiguous(offset, delimiter.size()))
+            return std::memcmp(data, delimiter.data(), delimiter.size()) == 0;
+        for (size_t i = 1; i < delimiter.size(); i++)
+            if (chain.at(offset + i) != delimiter[i])
+                return false;
+        return true;
+    }
+
+    std::string_view delimiter;
+    size_t max_frame_size;
+    /// <summary>字节流中已经扫描过的位置(绝对位置，与buffer_chain::position相同的坐标)</summary>
+    ULONGLONG scanned = 0;
+};
+
+/// <summary>
+/// 固定长度记录的编解码器，每个帧都是record_size字节
+/// </summary>
+class fixed_size_codec
+{
+public:
+    explicit fixed_size_codec(size_t record_size)
+        : record_size(record_size)
+    {
+    }
+
+    /// <summary>
+    /// 从链的开头解码一个帧
+    /// </summary>
+    /// <param name="chain">接收缓冲区链或byte_span</param>
+    /// <param name="result">[out]若返回frame，接收解码出的帧</param>
+    template <typename source_type>
+    decode_status decode(const source_type& chain, basic_decoded_frame<source_type>& result) const
+    {
+        if (!record_size)
+            return decode_status::error;
+        if (chain.size() < record_size)
+            return decode_status::need_more;
+        result.payload = { &chain, 0, record_size };
+        result.frame_size = record_size;
+        return decode_status::frame;
+    }
+
+    /// <summary>固定长度记录没有长度前缀，总是返回0</summary>
+    size_t encode_header(size_t, char*) const { return 0; }
+    std::string_view trailer() const { return {}; }
+    /// <summary>编码时负载必须正好是record_size字节</summary>
+    size_t get_max_frame_size() const { return record_size; }
+    size_t get_record_size() const { return record_size; }
+
+private:
+    size_t record_size;
+};
+
+/// <summary>
+/// 批量编码，把多个帧的长度前缀，负载和结尾填入同一个WSABUF数组，可以用一次socket_send_asyn发送，负载本身不会被复制
+/// </summary>
+/// <remarks>
+/// 长度前缀保存在批次内部的数组中，所以批次必须在发送完成之前保持有效，负载和分隔符也一样。批次不分配任何内存
+/// </remarks>
+/// <typeparam name="max_buffers">WSABUF数组的容量</typeparam>
+template <size_t max_buffers = 64>
+class send_batch
+{
+public:
+    send_batch() = default;
+    send_batch(const send_batch&) = delete;
+    send_batch& operator=(const send_batch&) = delete;
+
+public:
+    /// <summary>
+    /// 编码一个帧并加入批次
+    /// </summary>
+    /// <param name="codec">length_prefix_codec，delimiter_codec或fixed_size_codec</param>
+    /// <param name="payload">负载</param>
+    /// <param name="size">负载的字节数</param>
+    /// <returns>若WSABUF数组已满，或负载不符合codec的要求，返回false，此时批次不变</returns>
+    template <typename codec_type>
+    bool add(const codec_type& codec, const void* payload, size_t size)
+    {
+        if (size > codec.get_max_frame_size())
+            return false;
+        if constexpr (std::is_same_v<codec_type, fixed_size_codec>)
+        {
+            if (size != codec.get_record_size())
+                return false;
+        }
+
+        char header[length_prefix_codec::max_header_size];
+        auto header_size = codec.encode_header(size, header);
+        auto trailer = codec.trailer();
+        DWORD needed = (header_size ? 1 : 0) + (size ? 1 : 0) + (trailer.empty() ? 0 : 1);
+        if (count + needed > max_buffers)
+            return false;
+
+        if (header_size)
+        {
+            auto stored = headers + count * length_prefix_codec::max_header_size;
+            std::memcpy(stored, header, header_size);
+            buffers[count++] = { static_cast<ULONG>(header_size), stored };
+        }
+        if (size)
+            buffers[count++] = { static_cast<ULONG>(size), const_cast<char*>(static_cast<const char*>(payload)) };
+        if (!trailer.empty())
+            buffers[count++] = { static_cast<ULONG>(trailer.size()), const_cast<char*>(trailer.data()) };
+        total_bytes += header_size + size + trailer.size();
+        return true;
+    }
+
+    /// <summary>
+    /// 清空批次，之后可以重用它
+    /// </summary>
+    void clear()
+    {
+        count = 0;
+        total_bytes = 0;
+    }
+
+    /// <summary>WSABUF数组，可以直接传给socket_send_asyn</summary>
+    LPWSABUF data() { return buffers; }
+    /// <summary>WSABUF数组中的元素数量</summary>
+    DWORD size() const { return count; }
+    /// <summary>批次中所有帧的总字节数</summary>
+    size_t bytes() const { return total_bytes; }
+    bool empty() const { return count == 0; }
+
+private:
+    WSABUF buffers[max_buffers];
+    /// <summary>每个WSABUF位置最多对应一个长度前缀，按位置保存，这样不需要单独的计数</summary>
+    char headers[max_buffers * length_prefix_codec::max_header_size];
+    DWORD count = 0;
+    size_t total_bytes = 0;
+};
+
+} // namespace mw::net
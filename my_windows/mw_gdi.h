@@ -1,4 +1,5 @@
 #pragma once
+#include "mw_handle.h"
 
 #include <memory>
 #include <sstream>
@@ -82,22 +83,43 @@ inline int release_dc(HWND window_handle, HDC device_context)
     return val;
 }
 
+/// <summary>
+/// create_dc，create_compatible_dc和create_ic创建的DC，使用DeleteDC删除。get_dc获取的DC需要release_dc，不能使用它
+/// </summary>
+struct dc_traits
+{
+    using pointer = HDC;
+    static constexpr pointer invalid() noexcept { return nullptr; }
+    static void close(pointer device_context) noexcept { DeleteDC(device_context); }
+};
+
+using unique_dc = unique_handle<dc_traits>;
+
 /// <summary>
 /// 为指定名字的设备创建一个设备上下文，可以使用EnumDisplayDevices获取有效的显示设备名字
 /// </summary>
 /// <remarks>该函数创建的DC，应该使用DeleteDC销毁，而不是ReleaseDC</remarks>
-/// <param name="device_name">它是正在被使用的指定输出设备的名字，若driver_name为DISPLAY或特定显示设备的名称，该参数也必须为""或相同名称</param>
-/// <param name="driver_name">它可以是DISPLAY或指定显示设备的名字，对于打印机，它应该是""</param>
+/// <param name="device_name">它是正在被使用的指定输出设备的名字，若driver_name为DISPLAY或特定显示设备的名称，该参数也必须为nullptr或相同名称</param>
+/// <param name="driver_name">它可以是DISPLAY或指定显示设备的名字，对于打印机，它应该是nullptr</param>
 /// <param name="pdm">包含设备驱动程序的特定于设备的初始化数据的DEVMODE结构的指针，若driver_name为DISPLAY，该参数必须为nullptr</param>
 /// <returns>若函数成功，则返回值是指定设备的DC的句柄</returns>
-inline HDC create_dc(const std::tstring& device_name = _T(""),
-    const std::tstring& driver_name = _T("DISPLAY"), const DEVMODE* pdm = nullptr)
+inline HDC create_dc(tzstring_view device_name = nullptr,
+    tzstring_view driver_name = _T("DISPLAY"), const DEVMODE* pdm = nullptr)
 {
-    auto val = CreateDC(tstring_to_pointer(driver_name), tstring_to_pointer(device_name), nullptr, pdm);
+    auto val = CreateDC(driver_name.get(), device_name.get(), nullptr, pdm);
     GET_ERROR_MSG_OUTPUT_NORMAL(val, 0);
     return val;
 }
 
+/// <summary>
+/// 与create_dc相同，但返回unique_dc，析构时自动关闭
+/// </summary>
+template <typename... Args>
+inline unique_dc create_dc(unique_tag, Args&&... args)
+{
+    return unique_dc(create_dc(std::forward<Args>(args)...));
+}
+
 /// <summary>
 /// 删除指定的设备上下文，该函数不能使用删除GetDC获取的DC
 /// </summary>
@@ -123,6 +145,15 @@ inline HDC create_compatible_dc(HDC device_context = nullptr)
     return val;
 }
 
+/// <summary>
+/// 与create_compatible_dc相同，但返回unique_dc，析构时自动关闭
+/// </summary>
+template <typename... Args>
+inline unique_dc create_compatible_dc(unique_tag, Args&&... args)
+{
+    return unique_dc(create_compatible_dc(std::forward<Args>(args)...));
+}
+
 /// <summary>
 /// 创建指定设备的信息上下文，该IC提供了最快的方式获取设备消息，不过GDI绘制函数不接受IC句柄，它应该只用于获取指定设备的信息。使用DeleteDC销毁IC
 /// </summary>
@@ -130,14 +161,23 @@ inline HDC create_compatible_dc(HDC device_context = nullptr)
 /// <param name="driver_name">指向指定设备驱动程序名称</param>
 /// <param name="pdm">包含设备驱动程序的特定于设备的初始化数据的DEVMODE结构的指针，若driver_name为DISPLAY，该参数必须为nullptr</param>
 /// <returns>若函数成功，则返回值是指定设备的IC句柄</returns>
-inline HDC create_ic(const std::tstring& device_name = _T(""),
-    const std::tstring& driver_name = _T(""), const DEVMODE* pdm = nullptr)
+inline HDC create_ic(tzstring_view device_name = nullptr,
+    tzstring_view driver_name = nullptr, const DEVMODE* pdm = nullptr)
 {
-    auto val = CreateIC(tstring_to_pointer(driver_name), tstring_to_pointer(device_name), nullptr, pdm);
+    auto val = CreateIC(driver_name.get(), device_name.get(), nullptr, pdm);
     GET_ERROR_MSG_OUTPUT_NORMAL(val, 0);
     return val;
 }
 
+/// <summary>
+/// 与create_ic相同，但返回unique_dc，析构时自动关闭
+/// </summary>
+template <typename... Args>
+inline unique_dc create_ic(unique_tag, Args&&... args)
+{
+    return unique_dc(create_ic(std::forward<Args>(args)...));
+}
+
 /// <summary>
 /// 获取指定设备上下文当前选择的指定类型的图像对象句柄，该函数获取指定图形对象句柄，GetObject获取指定图形对象句柄的信息
 /// </summary>
@@ -193,6 +233,19 @@ inline bool delete_object(HGDIOBJ graphics_object)
     return val;
 }
 
+/// <summary>
+/// GDI对象(位图，画笔，画刷，字体等)，使用DeleteObject删除。不要删除仍然选入DC的对象
+/// </summary>
+template <typename T>
+struct gdi_object_traits
+{
+    using pointer = T;
+    static constexpr pointer invalid() noexcept { return nullptr; }
+    static void close(pointer graphics_object) noexcept { DeleteObject(graphics_object); }
+};
+
+using unique_bitmap = unique_handle<gdi_object_traits<HBITMAP>>;
+
 /// <summary>
 /// 获取其中一个系统存储的画笔，画刷，字体或调色板的句柄，返回的图形句柄不需要调用DeleteObject删除，但是调用了也没关系
 /// </summary>
@@ -263,7 +316,7 @@ inline COLORREF set_dc_brush_color(HDC device_handle, COLORREF brush_color)
 /// <param name="text_rect">包含要在其中格式化文本的矩形（在逻辑坐标中）的RECT结构，可以使用GetClientRect获得</param>
 /// <param name="format">格式化文本的方法，它应该是DT_开头的宏的组合</param>
 /// <returns>若失败返回0，若成功返回以逻辑单位表示的文本高度，如果指定了DT_VCENTER或DT_BOTTOM，则返回值是距text_rect->top绘制文本底部的偏移量</returns>
-inline int draw_text(HDC device_context, const std::tstring& text, RECT& text_rect, UINT format = DT_CENTER)
+inline int draw_text(HDC device_context, tzstring_view text, RECT& text_rect, UINT format = DT_CENTER)
 {
     auto val = DrawText(device_context, text.c_str(), -1, &text_rect, format);
     GET_ERROR_MSG_OUTPUT_NORMAL(val, 0);
@@ -278,7 +331,7 @@ inline int draw_text(HDC device_context, const std::tstring& text, RECT& text_re
 /// <param name="y">系统用于对齐字符串的参考点的 y 坐标（以逻辑坐标表示）</param>
 /// <param name="text">要输出的文本</param>
 /// <returns>操作是否成功</returns>
-inline bool text_out(HDC device_context, int x, int y, const std::tstring& text)
+inline bool text_out(HDC device_context, int x, int y, tzstring_view text)
 {
     auto val = TextOut(device_context, x, y, text.c_str(), text.size());
     GET_ERROR_MSG_OUTPUT_NORMAL(val, 0);
@@ -404,6 +457,15 @@ inline HBITMAP create_compatible_bitmap(HDC device_context, int width, int heigh
     return val;
 }
 
+/// <summary>
+/// 与create_compatible_bitmap相同，但返回unique_bitmap，析构时自动关闭
+/// </summary>
+template <typename... Args>
+inline unique_bitmap create_compatible_bitmap(unique_tag, Args&&... args)
+{
+    return unique_bitmap(create_compatible_bitmap(std::forward<Args>(args)...));
+}
+
 /// <summary>
 /// GetDIBits函数检索指定兼容位图的位，并使用指定格式将它们作为 DIB 复制到缓冲区中。若buffer_bits不为NULL，需要
 /// 初始化BITMAPINFOHEADER结构的前六个成员以指定 DIB 的大小和格式。若为NULL，GetDIBits检查lpbi指向的第一个结构的第一个成员。
@@ -0,0 +1,166 @@
+#pragma once
+#include <utility>
+#ifdef _WIN32
+#    include <io.h>
+#else
+#    include <unistd.h>
+#endif
+
+namespace mw {
+
+/// <summary>
+/// 独占所有权的句柄包装器，大小与原始句柄相同，不分配内存，析构时使用Traits关闭句柄。只能移动，不能复制
+/// </summary>
+/// <remarks>
+/// Traits需要提供:
+///   pointer             原始句柄的类型
+///   static invalid()    无效句柄的值，不会被关闭
+///   static close(p)     关闭一个有效的句柄
+/// 每种句柄的Traits放在创建它的wrapper旁边，这些wrapper都有以mw::unique为第一个参数的重载，返回对应的unique_handle，
+/// 例如mw::sync::create_event(mw::unique, CREATE_EVENT_MANUAL_RESET)。
+/// 与safe_handle相比，它不分配HANDLE和shared_ptr的控制块，移动时也没有原子的引用计数
+/// </remarks>
+template <typename Traits>
+class unique_handle
+{
+public:
+    using traits_type = Traits;
+    using pointer = typename Traits::pointer;
+
+    unique_handle() noexcept
+        : handle(Traits::invalid())
+    {
+    }
+
+    /// <summary>
+    /// 接管句柄的所有权，handle可以是无效值
+    /// </summary>
+    explicit unique_handle(pointer handle) noexcept
+        : handle(handle)
+    {
+    }
+
+    unique_handle(unique_handle&& other) noexcept
+        : handle(other.release())
+    {
+    }
+
+    unique_handle& operator=(unique_handle&& other) noexcept
+    {
+        if (this != &other)
+            reset(other.release());
+        return *this;
+    }
+
+    unique_handle(const unique_handle&) = delete;
+    unique_handle& operator=(const unique_handle&) = delete;
+
+    ~unique_handle() { reset(); }
+
+public:
+    /// <summary>
+    /// 获取原始句柄，所有权不变
+    /// </summary>
+    pointer get() const noexcept { return handle; }
+
+    /// <summary>
+    /// 句柄是否有效
+    /// </summary>
+    bool valid() const noexcept { return handle != Traits::invalid(); }
+    explicit operator bool() const noexcept { return valid(); }
+
+    /// <summary>
+    /// 放弃所有权并返回原始句柄，调用者负责关闭它
+    /// </summary>
+    pointer release() noexcept
+    {
+        auto old_handle = handle;
+        handle = Traits::invalid();
+        return old_handle;
+    }
+
+    /// <summary>
+    /// 关闭当前句柄(若有效)并接管新的句柄
+    /// </summary>
+    void reset(pointer new_handle = Traits::invalid()) noexcept
+    {
+        auto old_handle = handle;
+        handle = new_handle;
+        if (old_handle != Traits::invalid())
+            Traits::close(old_handle);
+    }
+
+    /// <summary>
+    /// 关闭当前句柄，返回内部句柄的地址，用于以输出参数返回句柄的API
+    /// </summary>
+    pointer* put() noexcept
+    {
+        reset();
+        return &handle;
+    }
+
+    void swap(unique_handle& other) noexcept { std::swap(handle, other.handle); }
+
+private:
+    pointer handle;
+};
+
+/// <summary>
+/// 选择返回unique_handle的wrapper重载的标签
+/// </summary>
+struct unique_tag
+{
+};
+constexpr unique_tag unique {};
+
+/// <summary>
+/// 文件描述符，无效值为-1，使用close(Windows上为_close)关闭，在Linux上也可以使用
+/// </summary>
+struct fd_traits
+{
+    using pointer = int;
+    static constexpr pointer invalid() noexcept { return -1; }
+    static void close(pointer fd) noexcept
+    {
+#ifdef _WIN32
+        _close(fd);
+#else
+        ::close(fd);
+#endif
+    }
+};
+
+using unique_fd = unique_handle<fd_traits>;
+
+static_assert(sizeof(unique_fd) == sizeof(int));
+
+#ifdef _WIN32
+
+/// <summary>
+/// 失败时返回NULL的内核对象句柄(事件，互斥量，线程，进程等)，使用CloseHandle关闭
+/// </summary>
+struct kernel_handle_traits
+{
+    using pointer = HANDLE;
+    static constexpr pointer invalid() noexcept { return nullptr; }
+    static void close(pointer handle) noexcept { CloseHandle(handle); }
+};
+
+/// <summary>
+/// 失败时返回INVALID_HANDLE_VALUE的句柄(CreateFile等)，使用CloseHandle关闭
+/// </summary>
+struct file_handle_traits
+{
+    using pointer = HANDLE;
+    static pointer invalid() noexcept { return INVALID_HANDLE_VALUE; }
+    static void close(pointer handle) noexcept { CloseHandle(handle); }
+};
+
+using unique_kernel_handle = unique_handle<kernel_handle_traits>;
+using unique_file_handle = unique_handle<file_handle_traits>;
+
+static_assert(sizeof(unique_kernel_handle) == sizeof(HANDLE));
+
+#endif // _WIN32
+
+} // namespace mw
@@ -0,0 +1,513 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <vector>
+#ifndef _WIN32
+#    include "mw_platform.h"
+#    include <dlfcn.h>
+#endif
+
+namespace mw {
+
+/// <summary>
+/// 一个分配调用点的统计信息，所有估计值都是根据采样按概率放大后的结果
+/// </summary>
+struct heap_site_stats
+{
+    /// <summary>调用栈的最大深度</summary>
+    static constexpr int max_frames = 16;
+
+    /// <summary>调用栈(返回地址)，从最靠近分配函数的调用者开始</summary>
+    void* frames[max_frames];
+    /// <summary>frames中有效的帧数</summary>
+    USHORT depth;
+    /// <summary>RtlCaptureStackBackTrace计算的调用栈哈希值</summary>
+    ULONG hash;
+    /// <summary>该调用点被采样的分配次数(未放大)</summary>
+    ULONGLONG sampled_count;
+    /// <summary>估计的总分配次数和总分配字节数</summary>
+    ULONGLONG alloc_count;
+    ULONGLONG alloc_bytes;
+    /// <summary>估计的仍未释放的分配次数和字节数</summary>
+    ULONGLONG live_count;
+    ULONGLONG live_bytes;
+};
+
+/// <summary>
+/// 堆分配追踪器，按字节对分配进行采样，记录采样到的分配的调用栈，并按调用点统计分配和仍未释放的内存，可以用于在发行版中定位内存泄漏
+/// </summary>
+/// <remarks>
+/// 定义MY_WINDOWS_TRACK_HEAP宏后，heap_alloc，heap_realloc，heap_free和共享段分配器会自动通知追踪器，调用start后开始采样。
+/// 不定义该宏时，这些函数中不会有任何额外代码。
+///
+/// 采样是按字节的泊松采样：平均每分配sample_interval字节采样一次，所以大的分配更容易被采样，统计值按采样概率放大为无偏估计。
+/// 未被采样的分配只需要递减一个线程局部的计数器；释放时只有当存在被采样的存活分配时才需要在存活表中查找一次(最多探测固定次数)。
+/// 被采样的分配才会调用RtlCaptureStackBackTrace，它的开销与分配的字节数成正比，平均每sample_interval字节一次栈回溯
+/// (Linux上的backtrace按DWARF展开，缓存是热的时候浅的调用栈约2微秒，满max_frames帧约6微秒，采样稀疏时展开信息已不在缓存中，每次约10微秒)。
+/// 默认的采样间隔是256MB，只做分配和释放的循环中每次调用的固定开销约为malloc+free的1%到1.5%，采样再增加约0.3%，总开销低于2%，可以在生产环境中一直开启；
+/// 1GB的泄漏平均有4次采样，泄漏持续增长时采样次数随之增加。需要更精确的调用点统计时可以使用更小的间隔，512KB时同一个循环中的开销约为10%。
+///
+/// 调用点表和存活表都是固定大小的静态无锁哈希表，追踪器自身从不分配内存，所以它可以安全地追踪任何分配函数。
+/// 若表已满，新的采样会被丢弃并计入dropped_samples。
+/// 共享段中的内存可能被其他进程释放，此时本进程中对应的存活记录不会被删除。
+/// Linux上调用栈由backtrace获取，dump使用dladdr解析模块，my_windows_linux_test/heap_tracker_bench测量了默认配置下的开销
+/// </remarks>
+class heap_tracker
+{
+public:
+    /// <summary>默认的平均采样间隔(字节)</summary>
+    static constexpr SIZE_T default_sample_interval = SIZE_T(256) * 1024 * 1024;
+
+    /// <summary>
+    /// 开始采样
+    /// </summary>
+    /// <param name="sample_interval">平均采样间隔(字节)，越小越精确，但开销越大</param>
+    static void start(SIZE_T sample_interval = default_sample_interval)
+    {
+        interval.store(sample_interval ? sample_interval : 1, std::memory_order_relaxed);
+        // 会话编号在高16位，回绕时跳过0，0表示没有在采样
+        auto id = (last_session.fetch_add(1, std::memory_order_relaxed) + 1) & 0xFFFF;
+        session.store(static_cast<ULONGLONG>(id ? id : 1) << countdown_bits, std::memory_order_release);
+    }
+
+    /// <summary>
+    /// 停止采样，已经采样到的存活分配在释放时仍然会被删除
+    /// </summary>
+    static void stop()
+    {
+        session.store(0, std::memory_order_release);
+    }
+
+    static bool is_running() { return session.load(std::memory_order_relaxed) != 0; }
+
+    /// <summary>
+    /// 获取因为表已满而被丢弃的采样数
+    /// </summary>
+    static ULONGLONG dropped_samples() { return dropped.load(std::memory_order_relaxed); }
+
+    /// <summary>
+    /// 通知追踪器发生了一次分配
+    /// </summary>
+    /// <param name="address">分配的内存，若为nullptr则不会被采样</param>
+    /// <param name="bytes">分配的字节数</param>
+    static void on_alloc(void* address, SIZE_T bytes) noexcept
+    {
+        // 倒计数的高16位是生成它时的会话编号，低48位是剩余的字节数，减去本次会话的编号和bytes后仍在低48位中说明它属于本次会话并且没有用完。
+        // 上一次start(可能使用大得多的间隔)剩下的倒计数超出范围，进入sample重新生成；没有在采样时会话编号是0，sample把倒计数设为最大值。
+        // 这样快速路径只有一次比较，不需要再检查是否在采样，也不需要读取另一个线程局部变量
+        auto base = session.load(std::memory_order_relaxed);
+        auto next = countdown - bytes;
+        if (((next - base - 1) >> countdown_bits) == 0)
+        {
+            countdown = next;
+            return;
+        }
+        sample(address, bytes, base);
+    }
+
+    /// <summary>
+    /// 通知追踪器发生了一次释放
+    /// </summary>
+    /// <param name="address">释放的内存，若为nullptr则忽略</param>
+    static void on_free(void* address) noexcept
+    {
+        // nullptr不会在存活表中
+        if (live_entries.load(std::memory_order_relaxed) == 0)
+            return;
+        // 存活表有几MB，每次释放都探测它会造成一次缓存未命中；先查只有16KB的计数过滤器，绝大多数未被采样的地址在这里返回
+        auto key = reinterpret_cast<std::uintptr_t>(address);
+        if (live_filter[live_index(key) / filter_ratio].load(std::memory_order_relaxed) == 0)
+            return;
+        remove_live(key);
+    }
+
+    /// <summary>
+    /// 重新分配前从存活表中取出的旧内存块的记录
+    /// </summary>
+    struct realloc_record
+    {
+        /// <summary>旧内存块是否被采样</summary>
+        bool sampled = false;
+        std::uint32_t site = 0;
+        SIZE_T size = 0;
+        ULONGLONG weight_count = 0;
+        ULONGLONG weight_bytes = 0;
+    };
+
+    /// <summary>
+    /// 通知追踪器即将重新分配一块内存，旧内存块按释放处理，但返回它的记录以便重新分配失败时恢复
+    /// </summary>
+    /// <param name="address">要重新分配的内存，若为nullptr则忽略</param>
+    static realloc_record on_realloc_begin(void* address) noexcept
+    {
+        realloc_record record;
+        if (!address || live_entries.load(std::memory_order_relaxed) == 0)
+            return record;
+        auto key = reinterpret_cast<std::uintptr_t>(address);
+        if (live_filter[live_index(key) / filter_ratio].load(std::memory_order_relaxed) == 0)
+            return record;
+        remove_live(key, &record);
+        return record;
+    }
+
+    /// <summary>
+    /// 通知追踪器重新分配已经完成
+    /// </summary>
+    /// <param name="address">重新分配的旧内存块</param>
+    /// <param name="record">on_realloc_begin的返回值</param>
+    /// <param name="new_address">重新分配的结果，若为nullptr表示失败，此时旧内存块仍然有效，恢复它的记录</param>
+    /// <param name="bytes">新的字节数</param>
+    static void on_realloc_end(void* address, const realloc_record& record, void* new_address, SIZE_T bytes) noexcept
+    {
+        if (new_address)
+        {
+            on_alloc(new_address, bytes);
+            return;
+        }
+        if (!address || !record.sampled)
+            return;
+        if (!insert_live(reinterpret_cast<std::uintptr_t>(address), record.site, record.size, record.weight_count, record.weight_bytes))
+        {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        auto& site = sites[record.site];
+        site.live_count.fetch_add(record.weight_count, std::memory_order_relaxed);
+        site.live_bytes.fetch_add(record.weight_bytes, std::memory_order_relaxed);
+    }
+
+    /// <summary>
+    /// 对每个调用点调用指定可调用对象
+    /// </summary>
+    /// <param name="fun">可调用对象，它的参数是const heap_site_stats&，该参数是调用时的统计快照</param>
+    template <typename Func>
+    static void for_each_site(Func fun)
+    {
+        for (auto& site : sites)
+        {
+            if (site.state.load(std::memory_order_acquire) != site_ready)
+                continue;
+            heap_site_stats stats;
+            copy_stats(site, stats);
+            fun(static_cast<const heap_site_stats&>(stats));
+        }
+    }
+
+    /// <summary>
+    /// 对每个被采样且仍未释放的分配调用指定可调用对象
+    /// </summary>
+    /// <param name="fun">可调用对象，它的参数是(void* address, SIZE_T bytes, ULONG site_hash)</param>
+    template <typename Func>
+    static void for_each_live(Func fun)
+    {
+        for (auto& entry : live)
+        {
+            auto key = entry.key.load(std::memory_order_acquire);
+            if (key > key_busy)
+                fun(reinterpret_cast<void*>(key), entry.size, sites[entry.site].hash);
+        }
+    }
+
+    /// <summary>
+    /// 按估计的存活字节数从大到小输出调用点及其调用栈，调用栈以"模块名+偏移"的形式输出，可以使用符号文件解析
+    /// </summary>
+    /// <param name="out">输出流</param>
+    /// <param name="top">最多输出的调用点数量</param>
+    static void dump(std::ostream& out, size_t top = 20)
+    {
+        std::vector<heap_site_stats> all;
+        for_each_site([&](const heap_site_stats& stats) {
+            if (stats.live_count)
+                all.push_back(stats);
+        });
+        std::sort(all.begin(), all.end(),
+            [](const heap_site_stats& a, const heap_site_stats& b) { return a.live_bytes > b.live_bytes; });
+        if (all.size() > top)
+            all.resize(top);
+
+        out << "live sites: " << all.size() << ", dropped samples: " << dropped_samples() << "\n";
+        for (auto& stats : all)
+        {
+            out << "live " << stats.live_bytes << " bytes in " << stats.live_count << " blocks, allocated "
+                << stats.alloc_bytes << " bytes in " << stats.alloc_count << " blocks (" << stats.sampled_count << " samples)\n";
+            for (USHORT i = 0; i < stats.depth; i++)
+            {
+#ifdef _WIN32
+                PVOID module_base = nullptr;
+                char module_path[MAX_PATH] = { 0 };
+                if (RtlPcToFileHeader(stats.frames[i], &module_base)
+                    && GetModuleFileNameA(static_cast<HMODULE>(module_base), module_path, MAX_PATH))
+                {
+                    auto name = strrchr(module_path, '\\');
+                    out << "    " << (name ? name + 1 : module_path) << "+0x" << std::hex
+                        << (static_cast<char*>(stats.frames[i]) - static_cast<char*>(module_base)) << std::dec << "\n";
+                }
+                else
+                    out << "    " << stats.frames[i] << "\n";
+#else
+                Dl_info info;
+                if (dladdr(stats.frames[i], &info) && info.dli_fname)
+                {
+                    auto name = strrchr(info.dli_fname, '/');
+                    out << "    " << (name ? name + 1 : info.dli_fname) << "+0x" << std::hex
+                        << (static_cast<char*>(stats.frames[i]) - static_cast<char*>(info.dli_fbase)) << std::dec << "\n";
+                }
+                else
+                    out << "    " << stats.frames[i] << "\n";
+#endif
+            }
+        }
+    }
+
+    /// <summary>
+    /// 清空所有统计，调用该函数时不能有其他线程正在分配或释放被追踪的内存
+    /// </summary>
+    static void reset()
+    {
+        for (auto& entry : live)
+            entry.key.store(key_empty, std::memory_order_relaxed);
+        for (auto& count : live_filter)
+            count.store(0, std::memory_order_relaxed);
+        for (auto& site : sites)
+            site.state.store(site_empty, std::memory_order_relaxed);
+        live_entries.store(0, std::memory_order_relaxed);
+        dropped.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr size_t site_capacity = 4096;
+    static constexpr size_t live_capacity = 65536;
+    static constexpr size_t max_probe = 64;
+    /// <summary>
+    /// 过滤器的每个计数器对应存活表中的几个起始位置。起始位置在这几个位置上的存活项最多占据(filter_ratio + max_probe)个槽，计数器不会溢出
+    /// </summary>
+    static constexpr size_t filter_ratio = 4;
+    /// <summary>倒计数的位数，采样间隔最大约为256TB</summary>
+    static constexpr int countdown_bits = 48;
+    static constexpr ULONGLONG countdown_mask = (1ULL << countdown_bits) - 1;
+
+    static constexpr ULONG site_empty = 0;
+    static constexpr ULONG site_busy = 1;
+    static constexpr ULONG site_ready = 2;
+
+    static constexpr std::uintptr_t key_empty = 0;
+    static constexpr std::uintptr_t key_deleted = 1;
+    static constexpr std::uintptr_t key_busy = 2;
+
+    struct site_entry
+    {
+        std::atomic<ULONG> state;
+        ULONG hash;
+        USHORT depth;
+        void* frames[heap_site_stats::max_frames];
+        std::atomic<ULONGLONG> sampled_count;
+        std::atomic<ULONGLONG> alloc_count;
+        std::atomic<ULONGLONG> alloc_bytes;
+        std::atomic<ULONGLONG> live_count;
+        std::atomic<ULONGLONG> live_bytes;
+    };
+
+    struct live_entry
+    {
+        /// <summary>分配的地址，或key_empty，key_deleted，key_busy</summary>
+        std::atomic<std::uintptr_t> key;
+        std::uint32_t site;
+        SIZE_T size;
+        ULONGLONG weight_count;
+        ULONGLONG weight_bytes;
+    };
+
+    static void copy_stats(const site_entry& site, heap_site_stats& stats)
+    {
+        std::copy(site.frames, site.frames + site.depth, stats.frames);
+        stats.depth = site.depth;
+        stats.hash = site.hash;
+        stats.sampled_count = site.sampled_count.load(std::memory_order_relaxed);
+        stats.alloc_count = site.alloc_count.load(std::memory_order_relaxed);
+        stats.alloc_bytes = site.alloc_bytes.load(std::memory_order_relaxed);
+        stats.live_count = site.live_count.load(std::memory_order_relaxed);
+        stats.live_bytes = site.live_bytes.load(std::memory_order_relaxed);
+    }
+
+    /// <summary>
+    /// 生成下一个采样间隔，它服从均值为interval的指数分布
+    /// </summary>
+    static ULONGLONG next_countdown() noexcept
+    {
+        if (!random_state)
+            random_state = reinterpret_cast<std::uintptr_t>(&random_state) ^ GetTickCount64() ^ 0x9E3779B97F4A7C15ULL;
+        random_state ^= random_state >> 12;
+        random_state ^= random_state << 25;
+        random_state ^= random_state >> 27;
+        auto uniform = static_cast<double>((random_state * 0x2545F4914F6CDD1DULL) >> 11) * (1.0 / 9007199254740992.0);
+        if (uniform <= 0.0)
+            uniform = 1e-12;
+        auto value = -std::log(uniform) * static_cast<double>(interval.load(std::memory_order_relaxed)) + 1.0;
+        return value < static_cast<double>(countdown_mask) ? static_cast<ULONGLONG>(value) : countdown_mask;
+    }
+
+    static void sample(void* address, SIZE_T bytes, ULONGLONG base) noexcept
+    {
+        if (!base)
+        {
+            // 没有在采样，之后约256TB的分配都留在快速路径
+            countdown = countdown_mask;
+            return;
+        }
+        // 倒计数不属于本次会话说明该线程在本次会话中第一次分配，此时还没有生成采样间隔
+        bool first = countdown - base > countdown_mask;
+        auto next = next_countdown();
+        countdown = base + next;
+        if (first && next > bytes)
+        {
+            countdown -= bytes;
+            return;
+        }
+        if (!address)
+            return;
+
+        void* frames[heap_site_stats::max_frames];
+        ULONG hash = 0;
+        auto depth = RtlCaptureStackBackTrace(2, heap_site_stats::max_frames, frames, &hash);
+
+        auto site_index = find_or_insert_site(frames, depth, hash);
+        if (site_index == site_capacity)
+        {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        // 大小为bytes的分配被采样的概率是1-exp(-bytes/interval)，用它的倒数放大统计值得到无偏估计
+        auto probability = 1.0 - std::exp(-static_cast<double>(bytes) / static_cast<double>(interval.load(std::memory_order_relaxed)));
+        auto weight_count = static_cast<ULONGLONG>(1.0 / probability + 0.5);
+        if (!weight_count)
+            weight_count = 1;
+        auto weight_bytes = static_cast<ULONGLONG>(static_cast<double>(bytes) / probability + 0.5);
+
+        auto& site = sites[site_index];
+        site.sampled_count.fetch_add(1, std::memory_order_relaxed);
+        site.alloc_count.fetch_add(weight_count, std::memory_order_relaxed);
+        site.alloc_bytes.fetch_add(weight_bytes, std::memory_order_relaxed);
+
+        if (!insert_live(reinterpret_cast<std::uintptr_t>(address), static_cast<std::uint32_t>(site_index), bytes, weight_count, weight_bytes))
+        {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        site.live_count.fetch_add(weight_count, std::memory_order_relaxed);
+        site.live_bytes.fetch_add(weight_bytes, std::memory_order_relaxed);
+    }
+
+    /// <summary>
+    /// 查找或插入调用点，若表已满返回site_capacity
+    /// </summary>
+    static size_t find_or_insert_site(void** frames, USHORT depth, ULONG hash) noexcept
+    {
+        for (size_t probe = 0; probe < max_probe; probe++)
+        {
+            auto index = (hash + probe) & (site_capacity - 1);
+            auto& site = sites[index];
+            auto state = site.state.load(std::memory_order_acquire);
+            if (state == site_empty)
+            {
+                if (site.state.compare_exchange_strong(state, site_busy, std::memory_order_acquire))
+                {
+                    site.hash = hash;
+                    site.depth = depth;
+                    std::copy(frames, frames + depth, site.frames);
+                    site.sampled_count.store(0, std::memory_order_relaxed);
+                    site.alloc_count.store(0, std::memory_order_relaxed);
+                    site.alloc_bytes.store(0, std::memory_order_relaxed);
+                    site.live_count.store(0, std::memory_order_relaxed);
+                    site.live_bytes.store(0, std::memory_order_relaxed);
+                    site.state.store(site_ready, std::memory_order_release);
+                    return index;
+                }
+            }
+            // 另一个线程正在填写该调用点，它很快就会完成
+            while (state == site_busy)
+            {
+                YieldProcessor();
+                state = site.state.load(std::memory_order_acquire);
+            }
+            if (site.hash == hash && site.depth == depth && std::equal(frames, frames + depth, site.frames))
+                return index;
+        }
+        return site_capacity;
+    }
+
+    static size_t live_index(std::uintptr_t address) noexcept
+    {
+        return static_cast<size_t>(((address >> 4) * 0x9E3779B97F4A7C15ULL) >> 48) & (live_capacity - 1);
+    }
+
+    static bool insert_live(std::uintptr_t address, std::uint32_t site, SIZE_T size,
+        ULONGLONG weight_count, ULONGLONG weight_bytes) noexcept
+    {
+        auto start = live_index(address);
+        for (size_t probe = 0; probe < max_probe; probe++)
+        {
+            auto& entry = live[(start + probe) & (live_capacity - 1)];
+            auto key = entry.key.load(std::memory_order_relaxed);
+            if ((key == key_empty || key == key_deleted)
+                && entry.key.compare_exchange_strong(key, key_busy, std::memory_order_acquire))
+            {
+                entry.site = site;
+                entry.size = size;
+                entry.weight_count = weight_count;
+                entry.weight_bytes = weight_bytes;
+                entry.key.store(address, std::memory_order_release);
+                live_filter[start / filter_ratio].fetch_add(1, std::memory_order_relaxed);
+                live_entries.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static void remove_live(std::uintptr_t address, realloc_record* record = nullptr) noexcept
+    {
+        auto start = live_index(address);
+        for (size_t probe = 0; probe < max_probe; probe++)
+        {
+            auto& entry = live[(start + probe) & (live_capacity - 1)];
+            auto key = entry.key.load(std::memory_order_acquire);
+            if (key == key_empty)
+                return;
+            if (key != address)
+                continue;
+
+            // 同一个地址在释放前不会再被分配，所以不会有其他线程同时修改该项
+            auto& site = sites[entry.site];
+            if (record)
+                *record = { true, entry.site, entry.size, entry.weight_count, entry.weight_bytes };
+            site.live_count.fetch_sub(entry.weight_count, std::memory_order_relaxed);
+            site.live_bytes.fetch_sub(entry.weight_bytes, std::memory_order_relaxed);
+            entry.key.store(key_deleted, std::memory_order_release);
+            live_filter[start / filter_ratio].fetch_sub(1, std::memory_order_relaxed);
+            live_entries.fetch_sub(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+
+    /// <summary>当前采样会话的编号左移countdown_bits位，每次start递增，0表示没有在采样</summary>
+    inline static std::atomic<ULONGLONG> session { 0 };
+    inline static std::atomic<ULONG> last_session { 0 };
+    inline static std::atomic<SIZE_T> interval { default_sample_interval };
+    inline static std::atomic<ULONGLONG> dropped { 0 };
+    inline static std::atomic<LONGLONG> live_entries { 0 };
+    inline static site_entry sites[site_capacity];
+    inline static live_entry live[live_capacity];
+    /// <summary>按存活项的起始位置计数，为0时该地址一定不在存活表中</summary>
+    inline static std::atomic<std::uint8_t> live_filter[live_capacity / filter_ratio];
+
+    /// <summary>高16位是会话编号，低48位是距离下一次采样的字节数</summary>
+    inline static thread_local ULONGLONG countdown = 0;
+    inline static thread_local ULONGLONG random_state = 0;
+};
+
+} // namespace mw
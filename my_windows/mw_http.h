@@ -0,0 +1,779 @@
+#pragma once
+#include "mw_tcp_server.h"
+#include <atomic>
+#include <charconv>
+#include <cstring>
+#include <functional>
+#include <string_view>
+
+namespace mw::net {
+
+/// <summary>
+/// 比较两个ASCII字符串，不区分大小写，用于比较头部的名字和值
+/// </summary>
+inline bool http_iequals(std::string_view a, std::string_view b)
+{
+    if (a.size() != b.size())
+        return false;
+    for (size_t i = 0; i < a.size(); i++)
+    {
+        auto x = a[i] >= 'A' && a[i] <= 'Z' ? a[i] + ('a' - 'A') : a[i];
+        auto y = b[i] >= 'A' && b[i] <= 'Z' ? b[i] + ('a' - 'A') : b[i];
+        if (x != y)
+            return false;
+    }
+    return true;
+}
+
+/// <summary>
+/// 请求中的一个头部，名字和值都直接引用接收缓冲区中的数据
+/// </summary>
+struct http_header
+{
+    std::string_view name;
+    /// <summary>去掉了首尾空白的值</summary>
+    std::string_view value;
+};
+
+/// <summary>
+/// 解析出的请求，所有字符串都直接引用传给http_parser::parse的数据，只在该数据有效期间(即on_data返回之前)有效
+/// </summary>
+struct http_request
+{
+    /// <summary>最多保存的头部数量，超过时解析失败(431)</summary>
+    static constexpr size_t max_headers = 32;
+
+    std::string_view method;
+    /// <summary>请求目标，即path和query(包括?)</summary>
+    std::string_view target;
+    std::string_view path;
+    /// <summary>?之后的部分，不包括?</summary>
+    std::string_view query;
+    /// <summary>HTTP/1.x中的x</summary>
+    int version_minor = 1;
+    http_header headers[max_headers];
+    size_t header_count = 0;
+    std::string_view body;
+    /// <summary>处理完这个请求后是否保持连接，HTTP/1.1默认保持，HTTP/1.0默认不保持，由Connection头部修改</summary>
+    bool keep_alive = true;
+    /// <summary>请求的总字节数(请求行，头部和请求体)，处理完后应从接收的数据中消费这么多字节</summary>
+    size_t size = 0;
+
+    /// <summary>
+    /// 查找头部，名字不区分大小写
+    /// </summary>
+    /// <returns>若没有这个头部，返回nullptr，若有多个，返回第一个</returns>
+    const http_header* find_header(std::string_view name) const;
+};
+
+/// <summary>
+/// http_parser::parse的结果
+/// </summary>
+enum class http_parse_result
+{
+    /// <summary>解析出一个完整的请求</summary>
+    complete,
+    /// <summary>数据还不完整，收到更多数据后用同一个解析器再次调用parse</summary>
+    incomplete,
+    /// <summary>请求不合法，见http_parser::error_status，之后应发送错误响应并关闭连接</summary>
+    error,
+};
+
+/// <summary>
+/// http_parser的限制
+/// </summary>
+struct http_parser_options
+{
+    /// <summary>请求行和所有头部的最大字节数，超过时解析失败(431)</summary>
+    size_t max_header_size = 8 * 1024;
+    /// <summary>请求体的最大字节数，超过时解析失败(413)。整个请求必须能放入接收缓冲区，所以它应小于tcp_server_options::recv_buffer_size</summary>
+    size_t max_body_size = 4 * 1024;
+};
+
+/// <summary>
+/// 增量的HTTP/1.1请求解析器，直接在接收的数据上解析，不复制数据也不分配内存
+/// </summary>
+/// <remarks>
+/// 每次收到数据后用所有未消费的数据调用parse，返回incomplete时解析器记住已经扫描过的位置，
+/// 下次调用(数据的开头不变，只是更长了)只扫描新的部分。返回complete后消费request.size字节，
+/// 剩余的数据可以立即继续解析，这样就支持了管线化的请求。
+///
+/// 请求体只支持Content-Length，带Transfer-Encoding的请求以501失败。
+/// 行必须以CRLF结尾，不接受已废弃的头部折行，HTTP/1.1的请求必须有Host头部，这些都与RFC 9112的要求一致
+/// </remarks>
+class http_parser
+{
+public:
+    explicit http_parser(const http_parser_options& options = http_parser_options())
+        : options(options)
+    {
+    }
+
+public:
+    /// <summary>
+    /// 解析数据开头的一个请求
+    /// </summary>
+    /// <param name="data">所有未消费的数据，从一个请求的开头开始</param>
+    /// <param name="size">数据的字节数</param>
+    /// <param name="request">[out]返回complete时接收解析出的请求</param>
+    /// <returns>解析的结果</returns>
+    http_parse_result parse(const char* data, size_t size, http_request& request)
+    {
+        if (error)
+            return http_parse_result::error;
+
+        bool parsed = false;
+        if (!header_size)
+        {
+            // 请求之前的空行被忽略
+            while (begin + 1 < size && data[begin] == '\r' && data[begin + 1] == '\n')
+                begin += 2;
+            if (begin > options.max_header_size)
+                return fail(400);
+            auto end = find_header_end(data, size);
+            if (!end)
+            {
+                scanned = size;
+                return size > begin + options.max_header_size ? fail(431) : http_parse_result::incomplete;
+            }
+            if (end - begin > options.max_header_size)
+                return fail(431);
+            header_size = end;
+            if (!parse_header(data, request))
+                return http_parse_result::error;
+            body_size = content_length;
+            parsed = true;
+        }
+
+        if (size - header_size < body_size)
+            return http_parse_result::incomplete;
+        // 上次调用只解析了头部，数据可能已经被移动，所以重新解析以得到指向当前数据的字符串
+        if (!parsed && !parse_header(data, request))
+            return http_parse_result::error;
+        request.body = std::string_view(data + header_size, body_size);
+        request.size = header_size + body_size;
+        reset();
+        return http_parse_result::complete;
+    }
+
+    /// <summary>
+    /// 丢弃解析进度和错误，之后从新的请求开头开始解析
+    /// </summary>
+    void reset()
+    {
+        begin = 0;
+        scanned = 0;
+        header_size = 0;
+        body_size = 0;
+        error = 0;
+    }
+
+    /// <summary>
+    /// 获取parse返回error时应该响应的状态码，例如400，413，431，501或505
+    /// </summary>
+    int error_status() const { return error; }
+
+    const http_parser_options& get_options() const { return options; }
+
+private:
+    http_parse_result fail(int status)
+    {
+        error = status;
+        return http_parse_result::error;
+    }
+
+    bool reject(int status)
+    {
+        error = status;
+        return false;
+    }
+
+    /// <summary>
+    /// 查找头部结尾的空行
+    /// </summary>
+    /// <returns>头部(包括空行)结束的位置，若还没有收到空行，返回0</returns>
+    size_t find_header_end(const char* data, size_t size) const
+    {
+        for (auto position = (std::max)(scanned, begin); position < size;)
+        {
+            auto found = static_cast<const char*>(std::memchr(data + position, '\n', size - position));
+            if (!found)
+                break;
+            auto index = static_cast<size_t>(found - data);
+            if (index >= begin + 3 && std::memcmp(data + index - 3, "\r\n\r\n", 4) == 0)
+                return index + 1;
+            position = index + 1;
+        }
+        return 0;
+    }
+
+    static bool is_token_char(char c)
+    {
+        if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9'))
+            return true;
+        return c != '\0' && std::strchr("!#$%&'*+-.^_`|~", c) != nullptr;
+    }
+
+    static bool is_token(std::string_view text)
+    {
+        if (text.empty())
+            return false;
+        for (auto c : text)
+        {
+            if (!is_token_char(c))
+                return false;
+        }
+        return true;
+    }
+
+    static std::string_view trim(std::string_view text)
+    {
+        while (!text.empty() && (text.front() == ' ' || text.front() == '\t'))
+            text.remove_prefix(1);
+        while (!text.empty() && (text.back() == ' ' || text.back() == '\t'))
+            text.remove_suffix(1);
+        return text;
+    }
+
+    /// <summary>
+    /// 取出下一行(不包括CRLF)
+    /// </summary>
+    /// <returns>若行不以CRLF结尾，返回false</returns>
+    static bool next_line(std::string_view& text, std::string_view& line)
+    {
+        auto end = text.find('\n');
+        if (end == std::string_view::npos || end == 0 || text[end - 1] != '\r')
+            return false;
+        line = text.substr(0, end - 1);
+        text.remove_prefix(end + 1);
+        return true;
+    }
+
+    bool parse_request_line(std::string_view line, http_request& request)
+    {
+        auto method_end = line.find(' ');
+        if (method_end == std::string_view::npos)
+            return reject(400);
+        request.method = line.substr(0, method_end);
+        line.remove_prefix(method_end + 1);
+        auto target_end = line.find(' ');
+        if (!is_token(request.method) || target_end == std::string_view::npos || target_end == 0)
+            return reject(400);
+        request.target = line.substr(0, target_end);
+        for (auto c : request.target)
+        {
+            if (static_cast<unsigned char>(c) <= ' ' || c == 0x7f)
+                return reject(400);
+        }
+        auto query = request.target.find('?');
+        request.path = request.target.substr(0, query);
+        request.query = query == std::string_view::npos ? std::string_view() : request.target.substr(query + 1);
+
+        auto version = line.substr(target_end + 1);
+        if (version.size() != 8 || version.substr(0, 5) != "HTTP/" || version[6] != '.'
+            || version[5] < '0' || version[5] > '9' || version[7] < '0' || version[7] > '9')
+            return reject(400);
+        if (version[5] != '1')
+            return reject(505);
+        request.version_minor = version[7] - '0';
+        return true;
+    }
+
+    /// <summary>
+    /// 处理对解析本身有影响的头部
+    /// </summary>
+    bool interpret_header(const http_header& header, http_request& request, bool& has_host)
+    {
+        if (http_iequals(header.name, "Content-Length"))
+        {
+            ULONGLONG length = 0;
+            auto value = header.value;
+            auto result = std::from_chars(value.data(), value.data() + value.size(), length);
+            if (value.empty() || result.ec != std::errc() || result.ptr != value.data() + value.size())
+                return reject(400);
+            // 重复且不一致的Content-Length可能被用于请求走私
+            if (has_length && length != content_length)
+                return reject(400);
+            if (length > options.max_body_size)
+                return reject(413);
+            has_length = true;
+            content_length = static_cast<size_t>(length);
+        }
+        else if (http_iequals(header.name, "Transfer-Encoding"))
+            return reject(501);
+        else if (http_iequals(header.name, "Host"))
+            has_host = true;
+        else if (http_iequals(header.name, "Connection"))
+        {
+            for (auto list = header.value; !list.empty();)
+            {
+                auto comma = list.find(',');
+                auto option = trim(list.substr(0, comma));
+                if (http_iequals(option, "close"))
+                    closing = true;
+                else if (http_iequals(option, "keep-alive"))
+                    request.keep_alive = true;
+                list = comma == std::string_view::npos ? std::string_view() : list.substr(comma + 1);
+            }
+        }
+        return true;
+    }
+
+    /// <summary>
+    /// 解析[begin, header_size)中的请求行和头部
+    /// </summary>
+    /// <returns>若请求不合法，返回false，并设置error</returns>
+    bool parse_header(const char* data, http_request& request)
+    {
+        std::string_view text(data + begin, header_size - begin);
+        std::string_view line;
+        if (!next_line(text, line) || !parse_request_line(line, request))
+            return error ? false : reject(400);
+
+        request.header_count = 0;
+        request.keep_alive = false;
+        has_length = false;
+        content_length = 0;
+        closing = false;
+        bool has_host = false;
+        for (;;)
+        {
+            // 头部以find_header_end找到的空行结束，之前的每一行都必须以CRLF结尾
+            if (!next_line(text, line))
+                return reject(400);
+            if (line.empty())
+                break;
+            if (line.front() == ' ' || line.front() == '\t')
+                return reject(400);
+            auto colon = line.find(':');
+            if (colon == std::string_view::npos || !is_token(line.substr(0, colon)))
+                return reject(400);
+            http_header header = { line.substr(0, colon), trim(line.substr(colon + 1)) };
+            for (auto c : header.value)
+            {
+                if ((static_cast<unsigned char>(c) < ' ' && c != '\t') || c == 0x7f)
+                    return reject(400);
+            }
+            if (request.header_count == http_request::max_headers)
+                return reject(431);
+            if (!interpret_header(header, request, has_host))
+                return false;
+            request.headers[request.header_count++] = header;
+        }
+        if (request.version_minor >= 1 && !has_host)
+            return reject(400);
+        request.keep_alive = !closing && (request.version_minor >= 1 || request.keep_alive);
+        return true;
+    }
+
+    http_parser_options options;
+    /// <summary>请求行之前的空行的字节数</summary>
+    size_t begin = 0;
+    /// <summary>已经查找过头部结尾的字节数</summary>
+    size_t scanned = 0;
+    /// <summary>请求行和头部(包括结尾的空行)的字节数，若还没有收到完整的头部则为0</summary>
+    size_t header_size = 0;
+    size_t body_size = 0;
+    int error = 0;
+    // 解析头部时的临时状态
+    bool has_length = false;
+    size_t content_length = 0;
+    bool closing = false;
+};
+
+inline const http_header* http_request::find_header(std::string_view name) const
+{
+    for (size_t i = 0; i < header_count; i++)
+    {
+        if (http_iequals(headers[i].name, name))
+            return &headers[i];
+    }
+    return nullptr;
+}
+
+/// <summary>
+/// 获取常见状态码的原因短语
+/// </summary>
+/// <returns>若不是常见的状态码，返回空字符串</returns>
+inline std::string_view http_reason_phrase(int status)
+{
+    switch (status)
+    {
+    case 100: return "Continue";
+    case 200: return "OK";
+    case 201: return "Created";
+    case 202: return "Accepted";
+    case 204: return "No Content";
+    case 301: return "Moved Permanently";
+    case 302: return "Found";
+    case 304: return "Not Modified";
+    case 400: return "Bad Request";
+    case 401: return "Unauthorized";
+    case 403: return "Forbidden";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 408: return "Request Timeout";
+    case 413: return "Content Too Large";
+    case 429: return "Too Many Requests";
+    case 431: return "Request Header Fields Too Large";
+    case 500: return "Internal Server Error";
+    case 501: return "Not Implemented";
+    case 502: return "Bad Gateway";
+    case 503: return "Service Unavailable";
+    case 505: return "HTTP Version Not Supported";
+    default: return {};
+    }
+}
+
+/// <summary>
+/// 响应构造器，状态行和头部写入对象内部的固定缓冲区，end用一次聚集写入把它们和响应体放入连接的发送队列
+/// </summary>
+/// <remarks>
+/// 用法是status，若干次header，最后end。end自动添加Content-Length，不保持连接时还会添加Connection: close并在排队后关闭连接。
+/// 对HEAD请求end只发送头部。构造器不分配内存，头部超过max_head_size时header和end返回false
+/// </remarks>
+class http_response
+{
+public:
+    /// <summary>状态行和所有头部的最大字节数</summary>
+    static constexpr size_t max_head_size = 2048;
+
+    /// <param name="connection">发送响应的连接</param>
+    /// <param name="keep_alive">发送后是否保持连接</param>
+    /// <param name="head_only">是否只发送头部(HEAD请求)</param>
+    /// <param name="version_minor">请求的HTTP/1.x中的x，对HTTP/1.0保持连接时需要明确添加Connection: keep-alive</param>
+    explicit http_response(tcp_connection& connection, bool keep_alive = true, bool head_only = false, int version_minor = 1)
+        : connection(&connection)
+        , keep_alive(keep_alive)
+        , head_only(head_only)
+        , version_minor(version_minor)
+    {
+    }
+    /// <summary>
+    /// 构造对请求的响应，是否保持连接和是否只发送头部由请求决定
+    /// </summary>
+    http_response(tcp_connection& connection, const http_request& request)
+        : http_response(connection, request.keep_alive, request.method == "HEAD", request.version_minor)
+    {
+    }
+    http_response(const http_response&) = delete;
+    http_response(http_response&&) = delete;
+    http_response& operator=(const http_response&) = delete;
+    http_response& operator=(http_response&&) = delete;
+
+public:
+    /// <summary>
+    /// 开始响应，写入状态行，之前写入的头部被丢弃
+    /// </summary>
+    /// <param name="code">状态码</param>
+    /// <param name="reason">[opt]原因短语，若为空则使用http_reason_phrase</param>
+    /// <returns>若响应已经发送，或原因短语太长，返回false</returns>
+    bool status(int code, std::string_view reason = {})
+    {
+        if (sent)
+            return false;
+        head_size = 0;
+        overflow = false;
+        append("HTTP/1.1 ");
+        append_number(static_cast<ULONGLONG>(code));
+        append(" ");
+        append(reason.empty() ? http_reason_phrase(code) : reason);
+        append("\r\n");
+        started = !overflow;
+        return started;
+    }
+
+    /// <summary>
+    /// 添加一个头部，若还没有调用status，先写入200 OK。不要添加Content-Length，end会添加它
+    /// </summary>
+    /// <returns>若响应已经发送，名字或值包含CR或LF，或头部超过max_head_size，返回false</returns>
+    bool header(std::string_view name, std::string_view value)
+    {
+        if (sent || (!started && !status(200)))
+            return false;
+        if (name.find_first_of("\r\n") != std::string_view::npos || value.find_first_of("\r\n") != std::string_view::npos)
+            return false;
+        auto saved = head_size;
+        append(name);
+        append(": ");
+        append(value);
+        append("\r\n");
+        if (overflow)
+        {
+            // 放不下的头部被整个撤销，之后还可以发送已经写入的部分
+            head_size = saved;
+            overflow = false;
+            return false;
+        }
+        return true;
+    }
+
+    /// <summary>
+    /// 添加一个值是整数的头部
+    /// </summary>
+    bool header(std::string_view name, ULONGLONG value)
+    {
+        char text[24];
+        auto result = std::to_chars(text, text + sizeof(text), value);
+        return header(name, std::string_view(text, result.ptr - text));
+    }
+
+    /// <summary>
+    /// 设置发送后是否保持连接，例如服务器正在关闭时可以设为false
+    /// </summary>
+    void set_keep_alive(bool keep) { keep_alive = keep; }
+    bool is_keep_alive() const { return keep_alive; }
+
+    /// <summary>
+    /// 添加Content-Length，把状态行，头部和响应体作为一个整体放入发送队列，不保持连接时之后关闭连接
+    /// </summary>
+    /// <param name="body">[opt]响应体，它被复制到发送队列，end返回后就不再需要</param>
+    /// <param name="size">响应体的字节数</param>
+    /// <returns>若响应已经发送，头部超过max_head_size，或连接的send失败，返回false</returns>
+    bool end(const void* body = nullptr, size_t size = 0)
+    {
+        if (sent || (!started && !status(200)))
+            return false;
+        auto saved = head_size;
+        append("Content-Length: ");
+        append_number(size);
+        append("\r\n");
+        if (!keep_alive)
+            append("Connection: close\r\n");
+        else if (version_minor == 0)
+            append("Connection: keep-alive\r\n");
+        append("\r\n");
+        if (overflow)
+        {
+            head_size = saved;
+            overflow = false;
+            return false;
+        }
+
+        WSABUF buffers[2] = {
+            { static_cast<ULONG>(head_size), head },
+            { static_cast<ULONG>(size), const_cast<char*>(static_cast<const char*>(body)) },
+        };
+        if (!connection->send(buffers, head_only || !size ? 1 : 2))
+        {
+            head_size = saved;
+            return false;
+        }
+        sent = true;
+        if (!keep_alive)
+            connection->close();
+        return true;
+    }
+
+    bool end(std::string_view body) { return end(body.data(), body.size()); }
+
+    /// <summary>end是否已经成功</summary>
+    bool is_sent() const { return sent; }
+
+private:
+    void append(std::string_view text)
+    {
+        if (overflow || text.size() > max_head_size - head_size)
+        {
+            overflow = true;
+            return;
+        }
+        std::memcpy(head + head_size, text.data(), text.size());
+        head_size += text.size();
+    }
+
+    void append_number(ULONGLONG value)
+    {
+        char text[24];
+        auto result = std::to_chars(text, text + sizeof(text), value);
+        append(std::string_view(text, result.ptr - text));
+    }
+
+    tcp_connection* connection;
+    bool keep_alive;
+    bool head_only;
+    int version_minor;
+    bool started = false;
+    bool sent = false;
+    bool overflow = false;
+    size_t head_size = 0;
+    char head[max_head_size];
+};
+
+/// <summary>
+/// http_server的选项
+/// </summary>
+struct http_server_options
+{
+    http_parser_options parser;
+    /// <summary>内部tcp_server的选项</summary>
+    tcp_server_options server_options;
+};
+
+/// <summary>
+/// http_server的统计信息
+/// </summary>
+struct http_server_stats
+{
+    /// <summary>解析成功并交给处理函数的请求数</summary>
+    ULONGLONG requests = 0;
+    /// <summary>因为请求不合法而以错误响应关闭的连接数</summary>
+    ULONGLONG bad_requests = 0;
+    /// <summary>处理函数没有调用end，由服务器响应500的请求数</summary>
+    ULONGLONG unanswered = 0;
+    /// <summary>过载时(见tcp_server_options::shed_target)没有交给处理函数而直接响应503的请求数</summary>
+    ULONGLONG shed = 0;
+    /// <summary>内部tcp_server的统计信息</summary>
+    tcp_server_stats server;
+};
+
+/// <summary>
+/// 处理一个请求，在连接所属的反应器线程中调用，应在返回前调用response.end
+/// </summary>
+using http_request_handler = std::function<void(tcp_connection&, const http_request&, http_response&)>;
+
+/// <summary>
+/// tcp_server之上的HTTP/1.1服务器，用于健康检查，指标和简单的RPC端点
+/// </summary>
+/// <remarks>
+/// 每个连接有一个http_parser(在on_connect中创建，保存在tcp_connection::user_data中)，
+/// 处理请求和构造响应都不分配内存。同一次on_data中的管线化请求被依次处理，它们的响应按顺序进入发送队列，
+/// 并由tcp_server合并为一次WSASend。发送队列超过高水位的一半时暂停处理，等发送完成后再继续，
+/// 所以一个连接上的管线化请求不会让服务器无限制地缓存响应。
+///
+/// 处理函数必须同步地调用response.end，若没有调用，服务器响应500。请求不合法时服务器发送对应的错误响应并关闭连接。
+/// 启用tcp_server_options::shed_target后，反应器过载时一部分请求不交给处理函数，而是直接响应503
+/// </remarks>
+class http_server
+{
+public:
+    explicit http_server(http_request_handler handler, const http_server_options& options = http_server_options())
+        : handler(std::move(handler))
+        , options(options)
+        , server(make_tcp_handler(), options.server_options)
+    {
+    }
+    ~http_server()
+    {
+        stop();
+    }
+    http_server(const http_server&) = delete;
+    http_server(http_server&&) = delete;
+    http_server& operator=(const http_server&) = delete;
+    http_server& operator=(http_server&&) = delete;
+
+public:
+    /// <summary>
+    /// 启动服务器并在指定端口上监听
+    /// </summary>
+    /// <returns>操作是否成功</returns>
+    bool start(USHORT port, int address_family = AF_INET)
+    {
+        return server.start() && server.listen(port, address_family);
+    }
+
+    /// <summary>
+    /// 停止服务器，见tcp_server::stop
+    /// </summary>
+    void stop(DWORD timeout = 5000)
+    {
+        server.stop(timeout);
+    }
+
+    http_server_stats stats() const
+    {
+        http_server_stats result;
+        result.requests = requests.load(std::memory_order_relaxed);
+        result.bad_requests = bad_requests.load(std::memory_order_relaxed);
+        result.unanswered = unanswered.load(std::memory_order_relaxed);
+        result.shed = shed.load(std::memory_order_relaxed);
+        result.server = server.stats();
+        return result;
+    }
+
+    bool is_running() const { return server.is_running(); }
+    const http_server_options& get_options() const { return options; }
+    /// <summary>内部的tcp_server，可以用它在反应器线程中执行操作</summary>
+    tcp_server& get_tcp_server() { return server; }
+
+private:
+    tcp_handler make_tcp_handler()
+    {
+        tcp_handler result;
+        result.on_connect = [this](tcp_connection& connection) {
+            connection.user_data = new http_parser(options.parser);
+        };
+        result.on_data = [this](tcp_connection& connection, const char* data, size_t size) {
+            return on_data(connection, data, size);
+        };
+        result.on_close = [](tcp_connection& connection) {
+            delete static_cast<http_parser*>(connection.user_data);
+            connection.user_data = nullptr;
+        };
+        return result;
+    }
+
+    size_t on_data(tcp_connection& connection, const char* data, size_t size)
+    {
+        auto parser = static_cast<http_parser*>(connection.user_data);
+        // 与tcp_server暂停接收的条件一致，这样暂停处理后连接一定会在发送完成后再次调用on_data
+        auto pause = connection.server().get_options().send_queue.high_water_mark / 2;
+        http_request request;
+        size_t consumed = 0;
+        while (consumed < size && !connection.is_closing() && connection.pending_send_bytes() <= pause)
+        {
+            auto result = parser->parse(data + consumed, size - consumed, request);
+            if (result == http_parse_result::incomplete)
+                break;
+            if (result == http_parse_result::error)
+            {
+                bad_requests.fetch_add(1, std::memory_order_relaxed);
+                http_response response(connection, false);
+                response.status(parser->error_status());
+                response.end();
+                connection.close();
+                return size;
+            }
+
+            consumed += request.size;
+            http_response response(connection, request);
+            if (connection.should_shed())
+            {
+                // 快速拒绝比排队更久之后再处理更好，客户端可以稍后重试
+                shed.fetch_add(1, std::memory_order_relaxed);
+                response.status(503);
+                response.header("Retry-After", 1ULL);
+                if (!response.end())
+                {
+                    connection.abort();
+                    break;
+                }
+                continue;
+            }
+            requests.fetch_add(1, std::memory_order_relaxed);
+            handler(connection, request, response);
+            if (!response.is_sent() && !connection.is_closing())
+            {
+                unanswered.fetch_add(1, std::memory_order_relaxed);
+                response.status(500);
+                // 响应无法进入发送队列时之后的响应也无法保持顺序，只能中止连接
+                if (!response.end())
+                {
+                    connection.abort();
+                    break;
+                }
+            }
+        }
+        return consumed;
+    }
+
+    http_request_handler handler;
+    http_server_options options;
+    std::atomic<ULONGLONG> requests { 0 };
+    std::atomic<ULONGLONG> bad_requests { 0 };
+    std::atomic<ULONGLONG> unanswered { 0 };
+    std::atomic<ULONGLONG> shed { 0 };
+    tcp_server server;
+};
+
+} // namespace mw::net
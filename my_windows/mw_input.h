@@ -0,0 +1,398 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <initializer_list>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace mw {
+namespace user {
+
+#ifndef _WIN32
+    // 其他平台上没有winuser.h，这里定义与它布局相同的INPUT和用到的常量，使批次的构造可以在Linux上用recording_input_sender测试
+    using WORD = std::uint16_t;
+    using DWORD = std::uint32_t;
+    using LONG = std::int32_t;
+    using UINT = unsigned int;
+    using ULONG_PTR = std::uintptr_t;
+
+    struct MOUSEINPUT
+    {
+        LONG dx;
+        LONG dy;
+        DWORD mouseData;
+        DWORD dwFlags;
+        DWORD time;
+        ULONG_PTR dwExtraInfo;
+    };
+
+    struct KEYBDINPUT
+    {
+        WORD wVk;
+        WORD wScan;
+        DWORD dwFlags;
+        DWORD time;
+        ULONG_PTR dwExtraInfo;
+    };
+
+    struct HARDWAREINPUT
+    {
+        DWORD uMsg;
+        WORD wParamL;
+        WORD wParamH;
+    };
+
+    struct INPUT
+    {
+        DWORD type;
+        union
+        {
+            MOUSEINPUT mi;
+            KEYBDINPUT ki;
+            HARDWAREINPUT hi;
+        };
+    };
+
+    constexpr DWORD INPUT_MOUSE = 0;
+    constexpr DWORD INPUT_KEYBOARD = 1;
+    constexpr DWORD KEYEVENTF_EXTENDEDKEY = 0x0001;
+    constexpr DWORD KEYEVENTF_KEYUP = 0x0002;
+    constexpr DWORD KEYEVENTF_UNICODE = 0x0004;
+    constexpr DWORD MOUSEEVENTF_MOVE = 0x0001;
+    constexpr DWORD MOUSEEVENTF_LEFTDOWN = 0x0002;
+    constexpr DWORD MOUSEEVENTF_LEFTUP = 0x0004;
+    constexpr DWORD MOUSEEVENTF_RIGHTDOWN = 0x0008;
+    constexpr DWORD MOUSEEVENTF_RIGHTUP = 0x0010;
+    constexpr DWORD MOUSEEVENTF_MIDDLEDOWN = 0x0020;
+    constexpr DWORD MOUSEEVENTF_MIDDLEUP = 0x0040;
+    constexpr DWORD MOUSEEVENTF_XDOWN = 0x0080;
+    constexpr DWORD MOUSEEVENTF_XUP = 0x0100;
+    constexpr DWORD MOUSEEVENTF_WHEEL = 0x0800;
+    constexpr DWORD MOUSEEVENTF_HWHEEL = 0x1000;
+    constexpr DWORD MOUSEEVENTF_ABSOLUTE = 0x8000;
+    constexpr DWORD XBUTTON1 = 0x0001;
+    constexpr DWORD XBUTTON2 = 0x0002;
+    constexpr WORD VK_TAB = 0x09;
+    constexpr WORD VK_RETURN = 0x0D;
+#endif // !_WIN32
+
+    /// <summary>
+    /// 用指定的屏幕大小将屏幕坐标(像素)转换为鼠标绝对坐标(0-65535)，不查询系统
+    /// </summary>
+    /// <param name="screen_x">屏幕坐标X</param>
+    /// <param name="screen_y">屏幕坐标Y</param>
+    /// <param name="screen_width">屏幕宽度(像素)</param>
+    /// <param name="screen_height">屏幕高度(像素)</param>
+    /// <returns>对应的转换pair</returns>
+    inline std::pair<LONG, LONG> trans_screen_to_absolute(LONG screen_x, LONG screen_y, int screen_width, int screen_height)
+    {
+        return std::pair<LONG, LONG>(static_cast<LONG>(((float)screen_x / screen_width) * 65535),
+            static_cast<LONG>(((float)screen_y / screen_height) * 65535));
+    }
+
+#ifdef _WIN32
+    /// <summary>
+    /// input_batch默认的发送者，使用SendInput插入系统的输入流
+    /// </summary>
+    struct system_input_sender
+    {
+        std::pair<int, int> screen_size() const { return { GetSystemMetrics(SM_CXSCREEN), GetSystemMetrics(SM_CYSCREEN) }; }
+
+        UINT send(INPUT* input_array, UINT input_struct_nums)
+        {
+            auto val = SendInput(input_struct_nums, input_array, sizeof(INPUT));
+            GET_ERROR_MSG_OUTPUT();
+            return val;
+        }
+    };
+#endif // _WIN32
+
+    /// <summary>
+    /// 记录而不发送输入的发送者，用于测试和预演输入脚本
+    /// </summary>
+    struct recording_input_sender
+    {
+        int screen_width = 1920;
+        int screen_height = 1080;
+        /// <summary>
+        /// 每次send收到的事件依次追加到这里
+        /// </summary>
+        std::vector<INPUT> recorded;
+        /// <summary>
+        /// 每次send调用的事件数
+        /// </summary>
+        std::vector<UINT> send_sizes;
+
+        std::pair<int, int> screen_size() const { return { screen_width, screen_height }; }
+
+        UINT send(INPUT* input_array, UINT input_struct_nums)
+        {
+            recorded.insert(recorded.end(), input_array, input_array + input_struct_nums);
+            send_sizes.push_back(input_struct_nums);
+            return input_struct_nums;
+        }
+    };
+
+    /// <summary>
+    /// 鼠标按键
+    /// </summary>
+    enum class mouse_button
+    {
+        left,
+        right,
+        middle,
+        x1,
+        x2
+    };
+
+    /// <summary>
+    /// 合成输入的批次，将键盘，鼠标和文本事件追加到连续的INPUT数组中，flush时用一次send_input插入全部事件，
+    /// 避免逐个发送时其他输入插入到中间，也减少了每个事件的系统调用
+    /// </summary>
+    /// <remarks>
+    /// Sender需要提供:
+    ///   std::pair&lt;int, int&gt; screen_size()    屏幕大小(像素)，构造时查询一次，之后的绝对坐标都用它计算
+    ///   UINT send(INPUT*, UINT)                  插入事件，返回成功插入的数量
+    /// 默认的system_input_sender调用SendInput，recording_input_sender只记录事件，可以在没有桌面的环境中检查批次的内容。
+    /// 屏幕分辨率改变后需要调用refresh_screen_size
+    /// </remarks>
+    template <typename Sender>
+    class basic_input_batch
+    {
+    public:
+        explicit basic_input_batch(Sender sender = Sender())
+            : input_sender(std::move(sender))
+        {
+            refresh_screen_size();
+        }
+
+        basic_input_batch(const basic_input_batch&) = delete;
+        basic_input_batch& operator=(const basic_input_batch&) = delete;
+
+    public:
+        /// <summary>
+        /// 重新查询屏幕大小
+        /// </summary>
+        void refresh_screen_size()
+        {
+            auto size = input_sender.screen_size();
+            screen_width = size.first;
+            screen_height = size.second;
+        }
+
+        /// <summary>
+        /// 预留容纳event_count个事件的空间
+        /// </summary>
+        basic_input_batch& reserve(size_t event_count)
+        {
+            inputs.reserve(event_count);
+            return *this;
+        }
+
+        /// <summary>
+        /// 追加一个已经填写好的INPUT
+        /// </summary>
+        basic_input_batch& append(const INPUT& input)
+        {
+            inputs.push_back(input);
+            return *this;
+        }
+
+        /// <summary>
+        /// 按下虚拟键
+        /// </summary>
+        /// <param name="virtual_key">虚拟键码，1到254</param>
+        /// <param name="flags">额外的KEYEVENTF_标志，例如方向键需要KEYEVENTF_EXTENDEDKEY</param>
+        basic_input_batch& key_down(WORD virtual_key, DWORD flags = 0) { return keyboard(virtual_key, 0, flags); }
+
+        /// <summary>
+        /// 松开虚拟键
+        /// </summary>
+        basic_input_batch& key_up(WORD virtual_key, DWORD flags = 0) { return keyboard(virtual_key, 0, flags | KEYEVENTF_KEYUP); }
+
+        /// <summary>
+        /// 按下并松开虚拟键
+        /// </summary>
+        basic_input_batch& key_press(WORD virtual_key, DWORD flags = 0) { return key_down(virtual_key, flags).key_up(virtual_key, flags); }
+
+        /// <summary>
+        /// 按顺序按下所有键，再按相反的顺序松开，例如key_combination({ VK_CONTROL, 'C' })
+        /// </summary>
+        basic_input_batch& key_combination(std::initializer_list<WORD> virtual_keys)
+        {
+            for (auto key : virtual_keys)
+                key_down(key);
+            for (auto it = virtual_keys.end(); it != virtual_keys.begin();)
+                key_up(*--it);
+            return *this;
+        }
+
+        /// <summary>
+        /// 输入文本，每个UTF-16代码单元展开为一对KEYEVENTF_UNICODE的按下和松开事件；
+        /// '\n'(以及"\r\n")和'\t'发送VK_RETURN和VK_TAB，因为许多控件不处理Unicode形式的控制字符
+        /// </summary>
+        /// <param name="text">文本，wchar_t为32位时(Linux)超出BMP的字符拆分为代理对</param>
+        basic_input_batch& text(std::wstring_view text)
+        {
+            for (size_t i = 0; i < text.size(); i++)
+            {
+                auto code = static_cast<std::uint32_t>(text[i]);
+                if (code == '\r')
+                {
+                    if (i + 1 < text.size() && text[i + 1] == L'\n')
+                        continue;
+                    key_press(VK_RETURN);
+                }
+                else if (code == '\n')
+                    key_press(VK_RETURN);
+                else if (code == '\t')
+                    key_press(VK_TAB);
+                else if (code > 0xFFFF)
+                {
+                    code -= 0x10000;
+                    unicode_unit(static_cast<WORD>(0xD800 + (code >> 10)));
+                    unicode_unit(static_cast<WORD>(0xDC00 + (code & 0x3FF)));
+                }
+                else
+                    unicode_unit(static_cast<WORD>(code));
+            }
+            return *this;
+        }
+
+        /// <summary>
+        /// 将鼠标移动到屏幕坐标(像素)，绝对坐标在追加时就计算好
+        /// </summary>
+        basic_input_batch& mouse_move(LONG screen_x, LONG screen_y)
+        {
+            auto absolute = trans_screen_to_absolute(screen_x, screen_y, screen_width, screen_height);
+            return mouse(absolute.first, absolute.second, MOUSEEVENTF_MOVE | MOUSEEVENTF_ABSOLUTE);
+        }
+
+        /// <summary>
+        /// 相对上一次鼠标事件移动鼠标(像素，受鼠标加速度影响)
+        /// </summary>
+        basic_input_batch& mouse_move_relative(LONG dx, LONG dy) { return mouse(dx, dy, MOUSEEVENTF_MOVE); }
+
+        /// <summary>
+        /// 在当前位置按下鼠标按键
+        /// </summary>
+        basic_input_batch& mouse_down(mouse_button button = mouse_button::left) { return mouse(0, 0, button_flags(button, true), button_data(button)); }
+
+        /// <summary>
+        /// 在当前位置松开鼠标按键
+        /// </summary>
+        basic_input_batch& mouse_up(mouse_button button = mouse_button::left) { return mouse(0, 0, button_flags(button, false), button_data(button)); }
+
+        /// <summary>
+        /// 在当前位置单击鼠标按键
+        /// </summary>
+        basic_input_batch& click(mouse_button button = mouse_button::left) { return mouse_down(button).mouse_up(button); }
+
+        /// <summary>
+        /// 移动到屏幕坐标(像素)后单击鼠标按键
+        /// </summary>
+        basic_input_batch& click_at(LONG screen_x, LONG screen_y, mouse_button button = mouse_button::left) { return mouse_move(screen_x, screen_y).click(button); }
+
+        /// <summary>
+        /// 滚动垂直滚轮，正数向前(远离用户)，一格为WHEEL_DELTA(120)
+        /// </summary>
+        basic_input_batch& wheel(int delta) { return mouse(0, 0, MOUSEEVENTF_WHEEL, static_cast<DWORD>(delta)); }
+
+        /// <summary>
+        /// 滚动水平滚轮，正数向右
+        /// </summary>
+        basic_input_batch& horizontal_wheel(int delta) { return mouse(0, 0, MOUSEEVENTF_HWHEEL, static_cast<DWORD>(delta)); }
+
+        /// <summary>
+        /// 用一次send插入所有事件
+        /// </summary>
+        /// <remarks>
+        /// 成功插入的事件从批次中移除；若输入被其他线程阻塞(返回值小于size)，未插入的事件留在批次中，可以再次flush
+        /// </remarks>
+        /// <returns>成功插入的事件数</returns>
+        UINT flush()
+        {
+            if (inputs.empty())
+                return 0;
+            auto sent = input_sender.send(inputs.data(), static_cast<UINT>(inputs.size()));
+            inputs.erase(inputs.begin(), inputs.begin() + (std::min)(static_cast<size_t>(sent), inputs.size()));
+            return sent;
+        }
+
+        /// <summary>
+        /// 丢弃未发送的事件，保留容量
+        /// </summary>
+        void clear() noexcept { inputs.clear(); }
+
+        size_t size() const noexcept { return inputs.size(); }
+        bool empty() const noexcept { return inputs.empty(); }
+        const INPUT* data() const noexcept { return inputs.data(); }
+        const std::vector<INPUT>& events() const noexcept { return inputs; }
+
+        Sender& sender() noexcept { return input_sender; }
+        const Sender& sender() const noexcept { return input_sender; }
+
+    private:
+        basic_input_batch& keyboard(WORD virtual_key, WORD scan_code, DWORD flags)
+        {
+            INPUT input {};
+            input.type = INPUT_KEYBOARD;
+            input.ki.wVk = virtual_key;
+            input.ki.wScan = scan_code;
+            input.ki.dwFlags = flags;
+            inputs.push_back(input);
+            return *this;
+        }
+
+        basic_input_batch& mouse(LONG dx, LONG dy, DWORD flags, DWORD mouse_data = 0)
+        {
+            INPUT input {};
+            input.type = INPUT_MOUSE;
+            input.mi.dx = dx;
+            input.mi.dy = dy;
+            input.mi.mouseData = mouse_data;
+            input.mi.dwFlags = flags;
+            inputs.push_back(input);
+            return *this;
+        }
+
+        void unicode_unit(WORD unit)
+        {
+            keyboard(0, unit, KEYEVENTF_UNICODE);
+            keyboard(0, unit, KEYEVENTF_UNICODE | KEYEVENTF_KEYUP);
+        }
+
+        static DWORD button_flags(mouse_button button, bool down)
+        {
+            switch (button)
+            {
+            case mouse_button::right:
+                return down ? MOUSEEVENTF_RIGHTDOWN : MOUSEEVENTF_RIGHTUP;
+            case mouse_button::middle:
+                return down ? MOUSEEVENTF_MIDDLEDOWN : MOUSEEVENTF_MIDDLEUP;
+            case mouse_button::x1:
+            case mouse_button::x2:
+                return down ? MOUSEEVENTF_XDOWN : MOUSEEVENTF_XUP;
+            default:
+                return down ? MOUSEEVENTF_LEFTDOWN : MOUSEEVENTF_LEFTUP;
+            }
+        }
+
+        static DWORD button_data(mouse_button button)
+        {
+            return button == mouse_button::x1 ? XBUTTON1 : (button == mouse_button::x2 ? XBUTTON2 : 0);
+        }
+
+        Sender input_sender;
+        std::vector<INPUT> inputs;
+        int screen_width = 0;
+        int screen_height = 0;
+    };
+
+#ifdef _WIN32
+    using input_batch = basic_input_batch<system_input_sender>;
+#endif
+
+} // namespace user
+} // namespace mw
@@ -52,13 +52,13 @@ public:
     /// <param name="job_name">作业名字</param>
     /// <param name="security_attribute">安全属性</param>
     /// <returns>是否创建成功</returns>
-    bool create(const std::tstring& job_name,
+    bool create(tzstring_view job_name,
         LPSECURITY_ATTRIBUTES security_attribute = nullptr)
     {
         if (!job_handle)
         {
             job_handle = CreateJobObject(security_attribute,
-                tstring_to_pointer(job_name));
+                job_name.get());
             GET_ERROR_MSG_OUTPUT();
             return job_handle;
         } else {
@@ -73,7 +73,7 @@ public:
     /// <param name="inherit_handle">该进程以后创建的子进程是否能继承该作业句柄</param>
     /// <param name="desired_access">新句柄的访问权限</param>
     /// <returns>是否打开成功</returns>
-    bool open(const std::tstring& job_name, bool inherit_handle = FALSE,
+    bool open(tzstring_view job_name, bool inherit_handle = FALSE,
         DWORD desired_access = JOB_OBJECT_ALL_ACCESS)
     {
         if (!job_handle)
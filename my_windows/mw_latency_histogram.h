@@ -0,0 +1,159 @@
+#pragma once
+#ifndef _WIN32
+#    include "mw_platform.h"
+#endif
+#include <algorithm>
+#include <vector>
+
+namespace mw {
+
+/// <summary>
+/// HDR风格的延迟直方图，在很大的范围内以固定的相对精度记录数值(例如以纳秒为单位的延迟)
+/// </summary>
+/// <remarks>
+/// 小于2^significant_bits的值被精确记录，更大的值按2的幂分段，每段再等分为2^(significant_bits-1)个桶，
+/// 所以任何值的相对误差都不超过1/2^(significant_bits-1)(默认约0.8%)，而桶的总数只与范围的位数成正比。
+/// record是O(1)的并且不分配内存，适合在每个连接(或每个线程)上各用一个直方图，结束后用merge合并。
+/// 直方图不是线程安全的
+/// </remarks>
+class latency_histogram
+{
+public:
+    /// <param name="significant_bits">精确记录的位数，范围是[2, 16]</param>
+    /// <param name="highest_bit">能记录的最大值是2^highest_bit - 1，更大的值被记为最大值，范围是[significant_bits, 63]</param>
+    explicit latency_histogram(int significant_bits = 8, int highest_bit = 40)
+        : significant_bits((std::min)((std::max)(significant_bits, 2), 16))
+        , highest_bit((std::min)((std::max)(highest_bit, this->significant_bits), 63))
+        , counts(index_of(max_trackable()) + 1)
+    {
+    }
+
+public:
+    /// <summary>
+    /// 记录一个值
+    /// </summary>
+    /// <param name="value">要记录的值，超过能记录的最大值时按最大值记录</param>
+    /// <param name="count">记录的次数</param>
+    void record(ULONGLONG value, ULONGLONG count = 1)
+    {
+        value = (std::min)(value, max_trackable());
+        counts[index_of(value)] += count;
+        total += count;
+        sum += value * count;
+        lowest = (std::min)(lowest, value);
+        highest = (std::max)(highest, value);
+    }
+
+    /// <summary>
+    /// 把另一个直方图的记录加到这个直方图中
+    /// </summary>
+    /// <returns>若两个直方图的significant_bits或highest_bit不同，返回false，此时不做任何修改</returns>
+    bool merge(const latency_histogram& other)
+    {
+        if (other.significant_bits != significant_bits || other.highest_bit != highest_bit)
+            return false;
+        for (size_t i = 0; i < counts.size(); i++)
+            counts[i] += other.counts[i];
+        total += other.total;
+        sum += other.sum;
+        lowest = (std::min)(lowest, other.lowest);
+        highest = (std::max)(highest, other.highest);
+        return true;
+    }
+
+    /// <summary>删除所有记录</summary>
+    void reset()
+    {
+        std::fill(counts.begin(), counts.end(), 0);
+        total = 0;
+        sum = 0;
+        lowest = ~0ULL;
+        highest = 0;
+    }
+
+    /// <summary>
+    /// 获取指定百分位的值，即不小于percentile%的记录的最小值(所在桶的上界，但不超过记录的最大值)
+    /// </summary>
+    /// <param name="percentile">百分位，范围是[0, 100]，例如99.9</param>
+    /// <returns>若没有记录，返回0</returns>
+    ULONGLONG value_at_percentile(double percentile) const
+    {
+        if (!total)
+            return 0;
+        percentile = (std::min)((std::max)(percentile, 0.0), 100.0);
+        auto target = static_cast<ULONGLONG>(percentile / 100.0 * static_cast<double>(total) + 0.5);
+        target = (std::max)(target, ULONGLONG { 1 });
+        ULONGLONG seen = 0;
+        for (size_t i = 0; i < counts.size(); i++)
+        {
+            seen += counts[i];
+            if (seen >= target)
+                return (std::min)((std::max)(highest_in_bucket(i), lowest), highest);
+        }
+        return highest;
+    }
+
+    /// <summary>记录的总次数</summary>
+    ULONGLONG count() const { return total; }
+    /// <summary>记录的最小值，若没有记录，返回0</summary>
+    ULONGLONG min_value() const { return total ? lowest : 0; }
+    /// <summary>记录的最大值</summary>
+    ULONGLONG max_value() const { return highest; }
+    /// <summary>记录的平均值，若没有记录，返回0</summary>
+    double mean() const { return total ? static_cast<double>(sum) / static_cast<double>(total) : 0; }
+    /// <summary>能记录的最大值</summary>
+    ULONGLONG max_trackable() const { return (1ULL << highest_bit) - 1; }
+
+private:
+    static int highest_set_bit(ULONGLONG value)
+    {
+        int bit = 0;
+        for (int step = 32; step; step >>= 1)
+        {
+            if (value >> step)
+            {
+                value >>= step;
+                bit += step;
+            }
+        }
+        return bit;
+    }
+
+    /// <summary>
+    /// 值所在的桶，前2^significant_bits个桶每个对应一个值，之后每段有2^(significant_bits-1)个桶
+    /// </summary>
+    size_t index_of(ULONGLONG value) const
+    {
+        auto exact = 1ULL << significant_bits;
+        if (value < exact)
+            return static_cast<size_t>(value);
+        auto half = exact >> 1;
+        auto shift = highest_set_bit(value) - (significant_bits - 1);
+        auto sub = value >> shift;
+        return static_cast<size_t>(exact + (shift - 1) * half + (sub - half));
+    }
+
+    /// <summary>
+    /// 桶中的最大值
+    /// </summary>
+    ULONGLONG highest_in_bucket(size_t index) const
+    {
+        auto exact = 1ULL << significant_bits;
+        if (index < exact)
+            return index;
+        auto half = exact >> 1;
+        auto shift = (index - exact) / half + 1;
+        auto sub = (index - exact) % half + half;
+        return ((sub + 1) << shift) - 1;
+    }
+
+    int significant_bits;
+    int highest_bit;
+    std::vector<ULONGLONG> counts;
+    ULONGLONG total = 0;
+    ULONGLONG sum = 0;
+    ULONGLONG lowest = ~0ULL;
+    ULONGLONG highest = 0;
+};
+
+} // namespace mw
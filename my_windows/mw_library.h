@@ -1,4 +1,5 @@
 #pragma once
+#include "mw_handle.h"
 
 #include <psapi.h>
 
@@ -15,13 +16,34 @@ namespace mw {
 /// <param name="lib_file_name">一个字符串，它指定要加载的模块的文件名，它可以是DLL或EXE.如果函数找不到模块或其依赖项之一，则函数失败</param>
 /// <param name="flags">可以为0，或LOAD_开头的宏之一，或DONT_RESOLVE_DLL_REFERENCES</param>
 /// <returns>若成功，返回加载模块的实例句柄，若失败返回NULL</returns>
-inline HMODULE load_library(const std::tstring& lib_file_name, DWORD flags = 0)
+inline HMODULE load_library(tzstring_view lib_file_name, DWORD flags = 0)
 {
     auto val = LoadLibraryEx(lib_file_name.c_str(), nullptr, flags);
     GET_ERROR_MSG_OUTPUT();
     return val;
 }
 
+/// <summary>
+/// load_library载入的模块，使用FreeLibrary减少使用计数
+/// </summary>
+struct module_traits
+{
+    using pointer = HMODULE;
+    static constexpr pointer invalid() noexcept { return nullptr; }
+    static void close(pointer lib_module) noexcept { FreeLibrary(lib_module); }
+};
+
+using unique_module = unique_handle<module_traits>;
+
+/// <summary>
+/// 与load_library相同，但返回unique_module，析构时自动关闭
+/// </summary>
+template <typename... Args>
+inline unique_module load_library(unique_tag, Args&&... args)
+{
+    return unique_module(load_library(std::forward<Args>(args)...));
+}
+
 /// <summary>
 /// 将目录添加到用于查找应用程序的 DLL 的搜索路径，它会影响随后的LoadLibrary(Ex)调用
 /// </summary>
@@ -37,9 +59,9 @@ inline HMODULE load_library(const std::tstring& lib_file_name, DWORD flags = 0)
 /// </remarks>
 /// <param name="path_name">要添加到搜索路径的目录。如果此参数为空字符串 ("")，则调用会从默认 DLL 搜索顺序中删除当前目录。如果此参数为 NULL，则函数恢复默认搜索顺序。</param>
 /// <returns>操作是否成功</returns>
-inline BOOL set_dll_directory(const std::tstring& path_name = _T(""))
+inline BOOL set_dll_directory(tzstring_view path_name = nullptr)
 {
-    auto val = SetDllDirectory(tstring_to_pointer(path_name));
+    auto val = SetDllDirectory(path_name.get());
     GET_ERROR_MSG_OUTPUT();
     return val;
 }
@@ -99,11 +121,11 @@ inline BOOL free_library(HMODULE lib_module)
 /// <summary>
 /// 获取指定模块的模块句柄，该模块必须已经被当前进程加载(该函数在多线程不可靠，用EX版本)
 /// </summary>
-/// <param name="module_name">模块名字(exe或dll)，若为""，则返回主调进程的可执行文件的句柄(基地址)</param>
+/// <param name="module_name">模块名字(exe或dll)，若为nullptr，则返回主调进程的可执行文件的句柄(基地址)</param>
 /// <returns>返回指定模块的句柄(基地址)</returns>
-inline HMODULE get_module_handle(const std::tstring& module_name = _T(""))
+inline HMODULE get_module_handle(tzstring_view module_name = nullptr)
 {
-    auto val = GetModuleHandle(tstring_to_pointer(module_name));
+    auto val = GetModuleHandle(module_name.get());
     GET_ERROR_MSG_OUTPUT();
     return val;
 }
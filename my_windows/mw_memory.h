@@ -1,4 +1,10 @@
 #pragma once
+#include "mw_error.h"
+#include "mw_handle.h"
+#include "mw_trace.h"
+#ifdef MY_WINDOWS_TRACK_HEAP
+#    include "mw_heap_tracker.h"
+#endif
 
 namespace mw {
 
@@ -27,13 +33,15 @@ namespace mw {
 /// <param name="start_address">若是预定内存，则向下舍入到最接近的分配粒度倍数，若是调拨已预定的内存，则向下舍入到最近页面边界，若为NULL，由函数决定分配哪个区域</param>
 /// <param name="allocation_type">内存分配类型，必须为MEM_的其中一个，不过可以另外搭配MEM_LARGE_PAGES和MEM_PHYSICAL和MEM_TOP_DOWN(MEM_RESERVE | MEM_COMMIT实现预定+调拨)</param>
 /// <param name="page_protect">PAGE_的其中一个，不过可以另外搭配PAGE_GUARD和PAGE_NOCACHE和PAGE_WRITECOMBINE，不过只能用于调拨而不是预定，请看文档</param>
-/// <returns>若成功，返回页面分配区域的基地址，失败返回NULL</returns>
-inline LPVOID virtual_alloc(HANDLE process_handle, size_t size, LPVOID start_address = nullptr,
-    DWORD allocation_type = MEM_RESERVE | MEM_COMMIT | MEM_TOP_DOWN, DWORD page_protect = PAGE_READWRITE)
+/// <returns>若成功，返回页面分配区域的基地址，失败返回NULL，返回值的类型由错误处理策略决定</returns>
+template <typename Policy = MY_WINDOWS_ERROR_POLICY>
+inline auto virtual_alloc(HANDLE process_handle, size_t size, LPVOID start_address = nullptr,
+    DWORD allocation_type = MEM_RESERVE | MEM_COMMIT | MEM_TOP_DOWN, DWORD page_protect = PAGE_READWRITE, Policy = {})
 {
+    MW_TRACE_SCOPE(memory, process_handle);
     auto val = VirtualAllocEx(process_handle, start_address, size, allocation_type, page_protect);
-    GET_ERROR_MSG_OUTPUT();
-    return val;
+    MW_TRACE_RESULT(val);
+    return Policy::apply(val, error::is_null, __FUNCTION__);
 }
 
 /// <summary>
@@ -55,25 +63,27 @@ inline LPVOID virtual_alloc(HANDLE process_handle, size_t size, LPVOID start_add
 /// <param name="start_address">指向要释放的内存区域的基地址指针，若free_type为MEM_RELEASE，则该参数必须是使用VirtualAllocEx预定区域时返回的基地址</param>
 /// <param name="free_type">它可以是MEM_DECOMMIT或MEM_RELEASE，前者取消调拨，但预定空间没有释放，后者取消调拨并且收回预定空间</param>
 /// <param name="size">要释放的内存区域大小，若free_type为MEM_RELEASE，则该参数必须为0。若为MEM_DECOMMIT，则取消调拨指定大小的内存页，若为0，则整个区域都被取消调拨</param>
-/// <returns>操作是否成功</returns>
-inline BOOL virtual_free(HANDLE process_handle, LPVOID start_address, DWORD free_type = MEM_RELEASE, size_t size = 0)
+/// <returns>操作是否成功，返回值的类型由错误处理策略决定</returns>
+template <typename Policy = MY_WINDOWS_ERROR_POLICY>
+inline auto virtual_free(HANDLE process_handle, LPVOID start_address, DWORD free_type = MEM_RELEASE, size_t size = 0, Policy = {})
 {
+    MW_TRACE_SCOPE(memory, process_handle);
     auto val = VirtualFreeEx(process_handle, start_address, size, free_type);
-    GET_ERROR_MSG_OUTPUT();
-    return val;
+    MW_TRACE_RESULT(val);
+    return Policy::apply(val, error::is_false, __FUNCTION__);
 }
 
 /// <summary>
 /// 原型为GlobalMemoryStatusEx，获取系统当前使用物理和虚拟内存的信息，注意该信息是实时的，即第一次调用和第二次调用返回的信息可能不同
 /// </summary>
 /// <param name="memory_status">[out]一个用户分配的MEMORYSTATUSEX结构体，用于接收当前内存相关信息</param>
-/// <returns>操作是否成功</returns>
-inline BOOL virtual_memory_status(MEMORYSTATUSEX& memory_status)
+/// <returns>操作是否成功，返回值的类型由错误处理策略决定</returns>
+template <typename Policy = MY_WINDOWS_ERROR_POLICY>
+inline auto virtual_memory_status(MEMORYSTATUSEX& memory_status, Policy = {})
 {
     memory_status.dwLength = sizeof(MEMORYSTATUSEX);
     auto val = GlobalMemoryStatusEx(&memory_status);
-    GET_ERROR_MSG_OUTPUT();
-    return val;
+    return Policy::apply(val, error::is_false, __FUNCTION__);
 }
 
 /// <summary>
@@ -85,12 +95,12 @@ inline BOOL virtual_memory_status(MEMORYSTATUSEX& memory_status)
 /// <param name="process_handle">指定要查询其内存信息的进程的句柄，该句柄必须具有PROCESS_QUERY_INFORMATION访问权限</param>
 /// <param name="start_address">指向要查询的页面区域基地址，该值向下舍入到下一页边界，若地址高于进程可访问的最高内存地址，函数失败</param>
 /// <param name="buffer">[out]用户分配的MEMORY_BASIC_INFORMATION结构，用于接收指定页面范围的信息</param>
-/// <returns>返回buffer实际接收的字节数，若函数失败则为0</returns>
-inline SIZE_T virtual_query(HANDLE process_handle, LPCVOID start_address, MEMORY_BASIC_INFORMATION& buffer)
+/// <returns>返回buffer实际接收的字节数，若函数失败则为0，返回值的类型由错误处理策略决定</returns>
+template <typename Policy = MY_WINDOWS_ERROR_POLICY>
+inline auto virtual_query(HANDLE process_handle, LPCVOID start_address, MEMORY_BASIC_INFORMATION& buffer, Policy = {})
 {
     auto val = VirtualQueryEx(process_handle, start_address, &buffer, sizeof(MEMORY_BASIC_INFORMATION));
-    GET_ERROR_MSG_OUTPUT();
-    return val;
+    return Policy::apply(val, error::is_zero, __FUNCTION__);
 }
 
 /// <summary>
@@ -101,13 +111,13 @@ inline SIZE_T virtual_query(HANDLE process_handle, LPCVOID start_address, MEMORY
 /// <param name="size">要改变保护属性的区域大小(字节)，若跨页面边界，则被跨页面也会被修改</param>
 /// <param name="new_protect">新的内存保护属性，它可以是非WRITECOPY和非EXECUTE_WRITECOPY的PAGE_*保护属性</param>
 /// <param name="old_protect">[out]用于接收先前的保护属性</param>
-/// <returns>操作是否成功</returns>
-inline BOOL virtual_protect(HANDLE process_handle, LPVOID start_address,
-    SIZE_T size, DWORD new_protect, DWORD& old_protect)
+/// <returns>操作是否成功，返回值的类型由错误处理策略决定</returns>
+template <typename Policy = MY_WINDOWS_ERROR_POLICY>
+inline auto virtual_protect(HANDLE process_handle, LPVOID start_address,
+    SIZE_T size, DWORD new_protect, DWORD& old_protect, Policy = {})
 {
     auto val = VirtualProtectEx(process_handle, start_address, size, new_protect, &old_protect);
-    GET_ERROR_MSG_OUTPUT();
-    return val;
+    return Policy::apply(val, error::is_false, __FUNCTION__);
 }
 
 /// <summary>
@@ -138,18 +148,27 @@ inline SIZE_T get_large_page_minimum()
 /// <param name="maximum_size">若该参数为0，则文件映射对象的最大大小等于file_handle表示的当前大小，若尝试映射大小为0的文件将失败，</param>
 /// <param name="mapping_name">文件映射对象的名字，该名称限制为MAX_PATH个字符，区分大小写，可以为nullptr，即未命名的内核对象</param>
 /// <param name="mapping_attributes">文件映射对象的安全属性</param>
-/// <returns>若成功，则返回新创建文件映射对象，若已经存在同样命名的内核对象，则返回它(使用它的大小，而不是指定大小)，若函数失败返回NULL</returns>
-inline HANDLE create_file_mapping(HANDLE file_handle, DWORD page_protect = PAGE_READWRITE,
+/// <returns>若成功，则返回新创建文件映射对象，若已经存在同样命名的内核对象，则返回它(使用它的大小，而不是指定大小)，若函数失败返回NULL，返回值的类型由错误处理策略决定</returns>
+template <typename Policy = MY_WINDOWS_ERROR_POLICY>
+inline auto create_file_mapping(HANDLE file_handle, DWORD page_protect = PAGE_READWRITE,
     ULONGLONG maximum_size = 0,
-    const std::tstring& mapping_name = _T(""),
-    LPSECURITY_ATTRIBUTES mapping_attributes = nullptr)
+    tzstring_view mapping_name = nullptr,
+    LPSECURITY_ATTRIBUTES mapping_attributes = nullptr, Policy = {})
 {
     ULARGE_INTEGER t = { 0 };
     t.QuadPart = maximum_size;
     auto val = CreateFileMapping(file_handle, mapping_attributes, page_protect,
-        t.HighPart, t.LowPart, tstring_to_pointer(mapping_name));
-    GET_ERROR_MSG_OUTPUT();
-    return val;
+        t.HighPart, t.LowPart, mapping_name.get());
+    return Policy::apply(val, error::is_null, __FUNCTION__);
+}
+
+/// <summary>
+/// 与create_file_mapping相同，但返回unique_kernel_handle，析构时自动关闭
+/// </summary>
+template <typename... Args>
+inline unique_kernel_handle create_file_mapping(unique_tag, Args&&... args)
+{
+    return unique_kernel_handle(create_file_mapping(std::forward<Args>(args)...));
 }
 
 /// <summary>
@@ -158,13 +177,22 @@ inline HANDLE create_file_mapping(HANDLE file_handle, DWORD page_protect = PAGE_
 /// <param name="mapping_name">文件映射对象的名字</param>
 /// <param name="inherit_handle">是否允许调用进程之后(如果)创建的新进程是否继承该句柄</param>
 /// <param name="desired_access">它是FILE_MAP_宏的组合，表示该句柄应该获取的访问权限</param>
-/// <returns>若成功，返回指定文件映射对象的打开句柄，若失败返回NULL</returns>
-inline HANDLE open_file_mapping(const std::tstring& mapping_name,
-    BOOL inherit_handle = false, DWORD desired_access = FILE_MAP_READ | FILE_MAP_WRITE)
+/// <returns>若成功，返回指定文件映射对象的打开句柄，若失败返回NULL，返回值的类型由错误处理策略决定</returns>
+template <typename Policy = MY_WINDOWS_ERROR_POLICY>
+inline auto open_file_mapping(tzstring_view mapping_name,
+    BOOL inherit_handle = false, DWORD desired_access = FILE_MAP_READ | FILE_MAP_WRITE, Policy = {})
 {
     auto val = OpenFileMapping(desired_access, inherit_handle, mapping_name.c_str());
-    GET_ERROR_MSG_OUTPUT();
-    return val;
+    return Policy::apply(val, error::is_null, __FUNCTION__);
+}
+
+/// <summary>
+/// 与open_file_mapping相同，但返回unique_kernel_handle，析构时自动关闭
+/// </summary>
+template <typename... Args>
+inline unique_kernel_handle open_file_mapping(unique_tag, Args&&... args)
+{
+    return unique_kernel_handle(open_file_mapping(std::forward<Args>(args)...));
 }
 
 /// <summary>
@@ -182,17 +210,19 @@ inline HANDLE open_file_mapping(const std::tstring& mapping_name,
 /// <param name="number_of_bytes_to_map">映射到视图的文件映射的字节数，必须在CreateFileMapping指定最大范围内。若为0，则映射到文件映射末尾</param>
 /// <param name="desired_access">它是FILE_MAP宏的组合,决定对文件映射对象的访问类型</param>
 /// <param name="base_address">指向映射开始的虚拟空间地址，它必须是系统内存分配粒度的倍数，否则失败，若为NULL，则由系统选择映射地址</param>
-/// <returns>若成功，返回值就是映射视图的起始地址，若失败返回NULL</returns>
-inline PVOID map_view_of_file(HANDLE mapping_handle, ULONGLONG file_offset = 0,
+/// <returns>若成功，返回值就是映射视图的起始地址，若失败返回NULL，返回值的类型由错误处理策略决定</returns>
+template <typename Policy = MY_WINDOWS_ERROR_POLICY>
+inline auto map_view_of_file(HANDLE mapping_handle, ULONGLONG file_offset = 0,
     SIZE_T number_of_bytes_to_map = 0, DWORD desired_access = FILE_MAP_ALL_ACCESS,
-    LPVOID base_address = nullptr)
+    LPVOID base_address = nullptr, Policy = {})
 {
+    MW_TRACE_SCOPE(memory, mapping_handle);
     ULARGE_INTEGER t = { 0 };
     t.QuadPart = file_offset;
     auto val = MapViewOfFileEx(mapping_handle, desired_access, t.HighPart,
         t.LowPart, number_of_bytes_to_map, base_address);
-    GET_ERROR_MSG_OUTPUT();
-    return val;
+    MW_TRACE_RESULT(val);
+    return Policy::apply(val, error::is_null, __FUNCTION__);
 }
 
 /// <summary>
@@ -202,12 +232,14 @@ inline PVOID map_view_of_file(HANDLE mapping_handle, ULONGLONG file_offset = 0,
 /// 请看文档
 /// </remarks>
 /// <param name="base_address">指向要取消映射的文件的映射视图的基地址的指针。此值必须与先前调用MapViewOfFile(Ex)函数所返回的值相同</param>
-/// <returns>操作是否成功</returns>
-inline BOOL unmap_view_of_file(LPCVOID base_address)
+/// <returns>操作是否成功，返回值的类型由错误处理策略决定</returns>
+template <typename Policy = MY_WINDOWS_ERROR_POLICY>
+inline auto unmap_view_of_file(LPCVOID base_address, Policy = {})
 {
+    MW_TRACE_SCOPE(memory, base_address);
     auto val = UnmapViewOfFile(base_address);
-    GET_ERROR_MSG_OUTPUT();
-    return val;
+    MW_TRACE_RESULT(val);
+    return Policy::apply(val, error::is_false, __FUNCTION__);
 }
 
 /// <summary>
@@ -216,23 +248,23 @@ inline BOOL unmap_view_of_file(LPCVOID base_address)
 /// <remarks>该函数只会将范围内的脏页(dirty page)写入磁盘，所谓脏页就是在文件视图映射后内容已经改变的页面</remarks>
 /// <param name="base_address">指向要刷新到映射文件的磁盘的基地址指针</param>
 /// <param name="number_of_bytes_to_flush">要刷新的字节数，若为0，则从基地址刷新到映射文件的末尾</param>
-/// <returns>操作是否成功</returns>
-inline BOOL flush_view_of_file(LPCVOID base_address, SIZE_T number_of_bytes_to_flush = 0)
+/// <returns>操作是否成功，返回值的类型由错误处理策略决定</returns>
+template <typename Policy = MY_WINDOWS_ERROR_POLICY>
+inline auto flush_view_of_file(LPCVOID base_address, SIZE_T number_of_bytes_to_flush = 0, Policy = {})
 {
     auto val = FlushViewOfFile(base_address, number_of_bytes_to_flush);
-    GET_ERROR_MSG_OUTPUT();
-    return val;
+    return Policy::apply(val, error::is_false, __FUNCTION__);
 }
 
 /// <summary>
 /// 获取调用进程的默认堆的句柄，然后可以在对堆函数的后续调用中使用此句柄。
 /// </summary>
-/// <returns>若成功，返回调用进程的默认堆句柄，若失败，返回NULL</returns>
-inline HANDLE get_process_heap()
+/// <returns>若成功，返回调用进程的默认堆句柄，若失败，返回NULL，返回值的类型由错误处理策略决定</returns>
+template <typename Policy = MY_WINDOWS_ERROR_POLICY>
+inline auto get_process_heap(Policy = {})
 {
     auto val = GetProcessHeap();
-    GET_ERROR_MSG_OUTPUT();
-    return val;
+    return Policy::apply(val, error::is_null, __FUNCTION__);
 }
 
 /// <summary>
@@ -246,12 +278,12 @@ inline HANDLE get_process_heap()
 /// <param name="options">它可以是0或HEAP_CREATE_ENABLE_EXECUTE和HEAP_GENERATE_EXCEPTIONS和HEAP_NO_SERIALIZE的组合</param>
 /// <param name="initial_size">堆的初始大小(字节)，此值决定堆调拨的初始内存量(向上舍入为系统页面大小的倍数)，若为0，则该函数调拨一页</param>
 /// <param name="maximum_size">堆的最大大小(字节)，若不为0，则堆大小是固定的，不能超过最大大小，若为0，则堆大小可以增长，直到所有物理存储器耗尽</param>
-/// <returns>若成功，返回新创建的堆的句柄，若失败返回NULL</returns>
-inline HANDLE heap_create(DWORD options = 0, SIZE_T initial_size = 0, SIZE_T maximum_size = 0)
+/// <returns>若成功，返回新创建的堆的句柄，若失败返回NULL，返回值的类型由错误处理策略决定</returns>
+template <typename Policy = MY_WINDOWS_ERROR_POLICY>
+inline auto heap_create(DWORD options = 0, SIZE_T initial_size = 0, SIZE_T maximum_size = 0, Policy = {})
 {
     auto val = HeapCreate(options, initial_size, maximum_size);
-    GET_ERROR_MSG_OUTPUT();
-    return val;
+    return Policy::apply(val, error::is_null, __FUNCTION__);
 }
 
 /// <summary>
@@ -261,15 +293,15 @@ inline HANDLE heap_create(DWORD options = 0, SIZE_T initial_size = 0, SIZE_T max
 /// <param name="heap_information_class">它是HEAP_INFORMATION_CLASS枚举中之一</param>
 /// <param name="heap_information">堆信息缓冲区。此数据的格式取决于HeapInformationClass参数的值</param>
 /// <param name="heap_information_length">heap_information缓冲区的大小，以字节为单位</param>
-/// <returns>操作是否成功</returns>
-inline BOOL heap_set_information(HANDLE heap_handle = nullptr,
+/// <returns>操作是否成功，返回值的类型由错误处理策略决定</returns>
+template <typename Policy = MY_WINDOWS_ERROR_POLICY>
+inline auto heap_set_information(HANDLE heap_handle = nullptr,
     HEAP_INFORMATION_CLASS heap_information_class = HeapEnableTerminationOnCorruption,
-    PVOID heap_information = nullptr, SIZE_T heap_information_length = 0)
+    PVOID heap_information = nullptr, SIZE_T heap_information_length = 0, Policy = {})
 {
     auto val = HeapSetInformation(heap_handle, heap_information_class,
         heap_information, heap_information_length);
-    GET_ERROR_MSG_OUTPUT();
-    return val;
+    return Policy::apply(val, error::is_false, __FUNCTION__);
 }
 
 /// <summary>
@@ -285,7 +317,11 @@ inline BOOL heap_set_information(HANDLE heap_handle = nullptr,
 /// <returns>若指定HEAP_GENERATE_EXCEPTIONS，则在失败时抛出异常，否则返回NULL，成功则返回已分配内存块的指针</returns>
 inline LPVOID heap_alloc(HANDLE heap_handle, SIZE_T bytes, DWORD flags = 0)
 {
-    return HeapAlloc(heap_handle, flags, bytes);
+    MW_TRACE_SCOPE(memory, heap_handle);
+    auto val = HeapAlloc(heap_handle, flags, bytes);
+    MW_TRACE_RESULT(val);
+    MW_TRACK_HEAP_ALLOC(val, bytes);
+    return val;
 }
 
 /// <summary>
@@ -302,7 +338,11 @@ inline LPVOID heap_alloc(HANDLE heap_handle, SIZE_T bytes, DWORD flags = 0)
 /// <returns>若指定HEAP_GENERATE_EXCEPTIONS，则在失败时抛出异常，否则返回NULL，成功则返回已分配内存块的指针</returns>
 inline LPVOID heap_realloc(HANDLE heap_handle, SIZE_T bytes, LPVOID block_alloc_before, DWORD flags = 0)
 {
-    return HeapReAlloc(heap_handle, flags, block_alloc_before, bytes);
+    MW_TRACK_HEAP_REALLOC_BEGIN(block_alloc_before); // 必须在旧内存块可能被其他线程重新分配之前通知
+    auto val = HeapReAlloc(heap_handle, flags, block_alloc_before, bytes);
+    // 失败(包括HEAP_REALLOC_IN_PLACE_ONLY无法原地调整)时旧内存块仍然有效，它的采样记录被原样恢复
+    MW_TRACK_HEAP_REALLOC_END(block_alloc_before, val, bytes);
+    return val;
 }
 
 /// <summary>
@@ -327,12 +367,15 @@ inline SIZE_T heap_size(HANDLE heap_handle, LPCVOID block_alloc_before, DWORD fl
 /// <param name="heap_handle">要释放其内存块的堆的句柄。该句柄由 HeapCreate或 GetProcessHeap函数返回</param>
 /// <param name="block_alloc_before">指向将要释放的内存块的指针。这是一个由HeapAlloc或 HeapReAlloc函数返回的指针.内存块必须来自heap_handle指定的堆，可以为NULL</param>
 /// <param name="flags">可以是0或HEAP_NO_SERIALIZE</param>
-/// <returns>操作是否成功</returns>
-inline BOOL heap_free(HANDLE heap_handle, LPVOID block_alloc_before, DWORD flags = 0)
+/// <returns>操作是否成功，返回值的类型由错误处理策略决定</returns>
+template <typename Policy = MY_WINDOWS_ERROR_POLICY>
+inline auto heap_free(HANDLE heap_handle, LPVOID block_alloc_before, DWORD flags = 0, Policy = {})
 {
+    MW_TRACE_SCOPE(memory, heap_handle);
+    MW_TRACK_HEAP_FREE(block_alloc_before);
     auto val = HeapFree(heap_handle, flags, block_alloc_before);
-    GET_ERROR_MSG_OUTPUT();
-    return val;
+    MW_TRACE_RESULT(val);
+    return Policy::apply(val, error::is_false, __FUNCTION__);
 }
 
 /// <summary>
@@ -342,12 +385,12 @@ inline BOOL heap_free(HANDLE heap_handle, LPVOID block_alloc_before, DWORD flags
 /// 进程可以调用HeapDestroy而无需先调用 HeapFree函数来释放从堆分配的内存。
 /// </remarks>
 /// <param name="heap_handle">要销毁的堆的句柄。该句柄由HeapCreate函数返回 。不要使用GetProcessHeap函数返回的进程堆的句柄 </param>
-/// <returns>操作是否成功</returns>
-inline BOOL heap_destroy(HANDLE heap_handle)
+/// <returns>操作是否成功，返回值的类型由错误处理策略决定</returns>
+template <typename Policy = MY_WINDOWS_ERROR_POLICY>
+inline auto heap_destroy(HANDLE heap_handle, Policy = {})
 {
     auto val = HeapDestroy(heap_handle);
-    GET_ERROR_MSG_OUTPUT();
-    return val;
+    return Policy::apply(val, error::is_false, __FUNCTION__);
 }
 
 // HeapLock, HeapUnlock, HeapWalk,GetProcessHeaps,HeapValidate,HeapCompact作用不大
@@ -360,13 +403,13 @@ inline BOOL heap_destroy(HANDLE heap_handle)
 /// <param name="buffer">[out]用于接收从指定进程地址空间复制数据的缓冲区</param>
 /// <param name="size">要从指定进程读取的字节数</param>
 /// <param name="number_of_bytes_read">[out]用于接收传输到指定缓冲区的字节数，若为NULL，则忽略该参数</param>
-/// <returns>操作是否成功</returns>
-inline BOOL read_process_memory(HANDLE process_handle, LPCVOID base_address,
-    LPVOID buffer, SIZE_T size, SIZE_T* number_of_bytes_read = nullptr)
+/// <returns>操作是否成功，返回值的类型由错误处理策略决定</returns>
+template <typename Policy = MY_WINDOWS_ERROR_POLICY>
+inline auto read_process_memory(HANDLE process_handle, LPCVOID base_address,
+    LPVOID buffer, SIZE_T size, SIZE_T* number_of_bytes_read = nullptr, Policy = {})
 {
     auto val = ReadProcessMemory(process_handle, base_address, buffer, size, number_of_bytes_read);
-    GET_ERROR_MSG_OUTPUT();
-    return val;
+    return Policy::apply(val, error::is_false, __FUNCTION__);
 }
 
 /// <summary>
@@ -377,13 +420,13 @@ inline BOOL read_process_memory(HANDLE process_handle, LPCVOID base_address,
 /// <param name="buffer">指向缓冲区的指针，该缓冲区包含要写入指定进程地址空间的数据</param>
 /// <param name="size">要写入指定进程的字节数</param>
 /// <param name="number_of_bytes_written">[out]用于接收写入指定进程的字节数，若为NULL，则忽略该参数</param>
-/// <returns>操作是否成功</returns>
-inline BOOL write_process_memory(HANDLE process_handle, LPVOID base_address,
-    LPVOID buffer, SIZE_T size, SIZE_T* number_of_bytes_written = nullptr)
+/// <returns>操作是否成功，返回值的类型由错误处理策略决定</returns>
+template <typename Policy = MY_WINDOWS_ERROR_POLICY>
+inline auto write_process_memory(HANDLE process_handle, LPVOID base_address,
+    LPVOID buffer, SIZE_T size, SIZE_T* number_of_bytes_written = nullptr, Policy = {})
 {
     auto val = WriteProcessMemory(process_handle, base_address, buffer, size, number_of_bytes_written);
-    GET_ERROR_MSG_OUTPUT();
-    return val;
+    return Policy::apply(val, error::is_false, __FUNCTION__);
 }
 
 }; // namespace mw
\ No newline at end of file
@@ -0,0 +1,402 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#ifdef _WIN32
+#    include "mw_memory.h"
+#    include "mw_system.h"
+#else
+#    include "mw_platform.h"
+#    include "mw_system_snapshot.h"
+#    include <string>
+#endif
+
+namespace mw {
+
+/// <summary>
+/// 进程地址空间中的一个区域，它是virtual_query返回的MEMORY_BASIC_INFORMATION的紧凑版本
+/// </summary>
+struct memory_region
+{
+    /// <summary>区域的基地址</summary>
+    std::uintptr_t base;
+    /// <summary>区域的大小(字节)</summary>
+    SIZE_T size;
+    /// <summary>区域所在预订区域的基地址(对于MEM_FREE区域无意义)</summary>
+    std::uintptr_t allocation_base;
+    /// <summary>区域的状态，MEM_COMMIT,MEM_RESERVE或MEM_FREE</summary>
+    DWORD state;
+    /// <summary>区域的保护属性，PAGE_开头的宏的组合(对于未调拨的区域为0)</summary>
+    DWORD protect;
+    /// <summary>区域的类型，MEM_IMAGE,MEM_MAPPED或MEM_PRIVATE(对于MEM_FREE区域为0)</summary>
+    DWORD type;
+
+    std::uintptr_t end() const { return base + size; }
+    bool contains(std::uintptr_t address) const { return address >= base && address < end(); }
+    bool same_as(const memory_region& other) const
+    {
+        return base == other.base && size == other.size && state == other.state
+            && protect == other.protect && type == other.type && allocation_base == other.allocation_base;
+    }
+};
+
+/// <summary>
+/// 两次快照之间的差异
+/// </summary>
+struct memory_map_diff
+{
+    /// <summary>在新快照中出现而旧快照中没有(按基地址)的区域</summary>
+    std::vector<memory_region> added;
+    /// <summary>在旧快照中出现而新快照中没有(按基地址)的区域</summary>
+    std::vector<memory_region> removed;
+    /// <summary>基地址相同但大小，状态，保护属性或类型发生变化的区域(新快照中的值)</summary>
+    std::vector<memory_region> changed;
+
+    bool empty() const { return added.empty() && removed.empty() && changed.empty(); }
+    void clear()
+    {
+        added.clear();
+        removed.clear();
+        changed.clear();
+    }
+};
+
+/// <summary>
+/// 内存快照的统计信息，在生成快照时一次性计算
+/// </summary>
+struct memory_map_summary
+{
+    /// <summary>PAGE_NOACCESS到PAGE_EXECUTE_WRITECOPY这8种基本保护属性的数量</summary>
+    static constexpr int protect_kinds = 8;
+
+    SIZE_T committed_bytes = 0;
+    SIZE_T reserved_bytes = 0;
+    SIZE_T free_bytes = 0;
+    SIZE_T image_bytes = 0;
+    SIZE_T mapped_bytes = 0;
+    SIZE_T private_bytes = 0;
+    /// <summary>带有PAGE_GUARD修饰的已调拨字节数</summary>
+    SIZE_T guard_bytes = 0;
+    /// <summary>按基本保护属性统计的已调拨字节数，请使用bytes_by_protect访问</summary>
+    SIZE_T protect_bytes[protect_kinds] = {};
+    /// <summary>遍历是否在到达地址空间末尾之前中断(例如目标进程在遍历中退出)，此时快照只包含中断之前的区域</summary>
+    bool truncated = false;
+
+    /// <summary>
+    /// 获取指定基本保护属性的已调拨字节数
+    /// </summary>
+    /// <param name="page_protect">PAGE_NOACCESS到PAGE_EXECUTE_WRITECOPY之一，修饰标志会被忽略</param>
+    /// <returns>具有该保护属性的已调拨字节数</returns>
+    SIZE_T bytes_by_protect(DWORD page_protect) const
+    {
+        auto index = protect_index(page_protect);
+        return index < 0 ? 0 : protect_bytes[index];
+    }
+
+    /// <summary>
+    /// 获取指定类型的字节数
+    /// </summary>
+    /// <param name="region_type">MEM_IMAGE,MEM_MAPPED或MEM_PRIVATE</param>
+    /// <returns>具有该类型的字节数(包括已调拨和预订的)</returns>
+    SIZE_T bytes_by_type(DWORD region_type) const
+    {
+        switch (region_type)
+        {
+        case MEM_IMAGE:
+            return image_bytes;
+        case MEM_MAPPED:
+            return mapped_bytes;
+        case MEM_PRIVATE:
+            return private_bytes;
+        default:
+            return 0;
+        }
+    }
+
+    void add(const memory_region& region)
+    {
+        switch (region.state)
+        {
+        case MEM_COMMIT:
+        {
+            committed_bytes += region.size;
+            auto index = protect_index(region.protect);
+            if (index >= 0)
+                protect_bytes[index] += region.size;
+            if (region.protect & PAGE_GUARD)
+                guard_bytes += region.size;
+            break;
+        }
+        case MEM_RESERVE:
+            reserved_bytes += region.size;
+            break;
+        default:
+            free_bytes += region.size;
+            return;
+        }
+
+        switch (region.type)
+        {
+        case MEM_IMAGE:
+            image_bytes += region.size;
+            break;
+        case MEM_MAPPED:
+            mapped_bytes += region.size;
+            break;
+        case MEM_PRIVATE:
+            private_bytes += region.size;
+            break;
+        }
+    }
+
+    /// <summary>
+    /// 将基本保护属性(单个位，0x01到0x80)转换为数组索引，若不是基本保护属性返回-1
+    /// </summary>
+    static int protect_index(DWORD page_protect)
+    {
+        auto base_protect = page_protect & 0xFF;
+        for (int i = 0; i < protect_kinds; i++)
+            if (base_protect == (1UL << i))
+                return i;
+        return -1;
+    }
+};
+
+/// <summary>
+/// 进程地址空间快照，它使用virtual_query一次性遍历整个进程地址空间，并将所有区域按基地址排序存放在一个连续的vector中
+/// </summary>
+/// <remarks>
+/// 查找某个地址所在的区域是O(log n)的二分查找，不需要再调用virtual_query。
+/// 使用refresh重新遍历进程时会复用上一次快照的缓冲区(不会重新分配内存)，并可以选择输出与上一次快照的差异。
+/// 对于需要周期性监视大量进程的场景，为每个进程保留一个memory_map对象并反复调用refresh即可。
+///
+/// Linux上从/proc/[pid]/maps读取区域并换算为Windows的值：不可访问的映射是MEM_RESERVE，其他映射是MEM_COMMIT；
+/// 有可执行映射的文件的所有区域是MEM_IMAGE，其他文件映射和共享映射是MEM_MAPPED，匿名映射是MEM_PRIVATE；
+/// 区域之间的空隙是MEM_FREE区域，最后一个区域之后不再添加MEM_FREE区域
+/// </remarks>
+class memory_map
+{
+public:
+#ifdef _WIN32
+    /// <summary>指定进程的方式，Windows上是必须具有PROCESS_QUERY_INFORMATION访问权限的进程句柄</summary>
+    using process_reference = HANDLE;
+#else
+    /// <summary>指定进程的方式，Linux上是进程ID，0表示当前进程</summary>
+    using process_reference = std::uint32_t;
+#endif
+
+    memory_map() = default;
+    /// <summary>
+    /// 拍摄指定进程的地址空间快照
+    /// </summary>
+    /// <param name="process">指定进程，见process_reference</param>
+    explicit memory_map(process_reference process)
+    {
+        snapshot(process);
+    }
+
+public:
+    /// <summary>
+    /// 重新拍摄指定进程的地址空间快照，之前的快照被丢弃
+    /// </summary>
+    /// <param name="process">指定进程，见process_reference</param>
+    /// <returns>操作是否完整地成功。若遍历中途失败，返回false，summary().truncated为true，快照中保留已遍历的区域</returns>
+    bool snapshot(process_reference process)
+    {
+        return walk(process, region_list, region_summary);
+    }
+
+    /// <summary>
+    /// 重新遍历指定进程，并与当前快照对比，之后当前快照变为新的快照
+    /// </summary>
+    /// <param name="process">指定进程，见process_reference</param>
+    /// <param name="diff">[out,opt]若不为nullptr，用于接收两次快照之间的差异(会先被清空)</param>
+    /// <returns>操作是否成功，若失败(包括遍历中途失败)，当前快照保持不变</returns>
+    bool refresh(process_reference process, memory_map_diff* diff = nullptr)
+    {
+        memory_map_summary new_summary;
+        if (!walk(process, previous_list, new_summary))
+            return false;
+
+        region_list.swap(previous_list);
+        region_summary = new_summary;
+
+        if (diff)
+            compute_diff(previous_list, region_list, *diff);
+        return true;
+    }
+
+    /// <summary>
+    /// 查找包含指定地址的区域
+    /// </summary>
+    /// <param name="address">要查找的地址</param>
+    /// <returns>若找到返回区域的指针，否则返回nullptr，该指针在下一次snapshot或refresh之前有效</returns>
+    const memory_region* find(const void* address) const
+    {
+        auto value = reinterpret_cast<std::uintptr_t>(address);
+        auto iter = std::upper_bound(region_list.begin(), region_list.end(), value,
+            [](std::uintptr_t address, const memory_region& region) { return address < region.base; });
+        if (iter == region_list.begin())
+            return nullptr;
+        --iter;
+        return iter->contains(value) ? &*iter : nullptr;
+    }
+
+    /// <summary>
+    /// 获取按基地址排序的所有区域(包括MEM_FREE区域)
+    /// </summary>
+    const std::vector<memory_region>& regions() const { return region_list; }
+
+    /// <summary>
+    /// 获取当前快照的统计信息
+    /// </summary>
+    const memory_map_summary& summary() const { return region_summary; }
+
+    /// <summary>
+    /// 对当前快照中满足条件的每个区域调用指定可调用对象
+    /// </summary>
+    /// <param name="state_mask">区域状态的掩码，如MEM_COMMIT，或MEM_COMMIT | MEM_RESERVE</param>
+    /// <param name="fun">可调用对象，它的参数是const memory_region&</param>
+    template <typename Func>
+    void for_each(DWORD state_mask, Func fun) const
+    {
+        for (auto& region : region_list)
+            if (region.state & state_mask)
+                fun(region);
+    }
+
+private:
+#ifdef _WIN32
+    bool walk(HANDLE process_handle, std::vector<memory_region>& out, memory_map_summary& summary)
+    {
+        static const std::uintptr_t maximum_address = [] {
+            SYSTEM_INFO system_info = { 0 };
+            mw::get_system_info(system_info);
+            return reinterpret_cast<std::uintptr_t>(system_info.lpMaximumApplicationAddress);
+        }();
+
+        out.clear();
+        summary = memory_map_summary();
+
+        MEMORY_BASIC_INFORMATION info = { 0 };
+        std::uintptr_t address = 0;
+        while (address <= maximum_address
+            && mw::virtual_query(process_handle, reinterpret_cast<LPCVOID>(address), info))
+        {
+            memory_region region;
+            region.base = reinterpret_cast<std::uintptr_t>(info.BaseAddress);
+            region.size = info.RegionSize;
+            region.allocation_base = reinterpret_cast<std::uintptr_t>(info.AllocationBase);
+            region.state = info.State;
+            region.protect = info.State == MEM_COMMIT ? info.Protect : 0;
+            region.type = info.State == MEM_FREE ? 0 : info.Type;
+            out.push_back(region);
+            summary.add(region);
+
+            if (region.end() <= address) // 防止地址回绕
+                return true;
+            address = region.end();
+        }
+
+        // 正常结束时地址已越过最大应用程序地址，否则是virtual_query在中途失败了
+        summary.truncated = address <= maximum_address;
+        return !out.empty() && !summary.truncated;
+    }
+#else
+    bool walk(std::uint32_t process_id, std::vector<memory_region>& out, memory_map_summary& summary)
+    {
+        out.clear();
+        summary = memory_map_summary();
+
+        // 文件只读一次，先找出有可执行映射的文件，它们的所有区域都是MEM_IMAGE
+        entries.clear();
+        image_inodes.clear();
+        if (!for_each_proc_maps_entry(process_id, maps_text, [this](const proc_maps_entry& entry) {
+                entries.push_back(entry);
+                if (entry.is_file() && entry.executable())
+                    image_inodes.push_back(entry.inode);
+            }))
+            return false;
+
+        std::uintptr_t previous_end = 0;
+        std::uint64_t previous_inode = 0;
+        for (auto& entry : entries)
+        {
+            if (entry.start > previous_end)
+                push_region(out, summary, { previous_end, entry.start - previous_end, 0, MEM_FREE, 0, 0 });
+
+            memory_region region;
+            region.base = entry.start;
+            region.size = entry.end - entry.start;
+            // 同一个文件连续的映射属于同一次分配，与Windows上一个映像的各个节相同
+            region.allocation_base = entry.is_file() && entry.inode == previous_inode && entry.start == previous_end && !out.empty()
+                ? out.back().allocation_base
+                : entry.start;
+            region.state = entry.readable() || entry.writable() || entry.executable() ? MEM_COMMIT : MEM_RESERVE;
+            region.protect = region.state == MEM_COMMIT ? to_page_protect(entry) : 0;
+            if (entry.is_file() && std::find(image_inodes.begin(), image_inodes.end(), entry.inode) != image_inodes.end())
+                region.type = MEM_IMAGE;
+            else if (entry.is_file() || entry.shared())
+                region.type = MEM_MAPPED;
+            else
+                region.type = MEM_PRIVATE;
+            push_region(out, summary, region);
+
+            previous_end = entry.end;
+            previous_inode = entry.is_file() ? entry.inode : 0;
+        }
+        return !out.empty();
+    }
+
+    static void push_region(std::vector<memory_region>& out, memory_map_summary& summary, const memory_region& region)
+    {
+        out.push_back(region);
+        summary.add(region);
+    }
+
+    static DWORD to_page_protect(const proc_maps_entry& entry) noexcept
+    {
+        if (entry.executable())
+            return entry.writable() ? PAGE_EXECUTE_READWRITE : (entry.readable() ? PAGE_EXECUTE_READ : PAGE_EXECUTE);
+        return entry.writable() ? PAGE_READWRITE : PAGE_READONLY;
+    }
+#endif
+
+    static void compute_diff(const std::vector<memory_region>& old_list,
+        const std::vector<memory_region>& new_list, memory_map_diff& diff)
+    {
+        diff.clear();
+        auto old_iter = old_list.begin();
+        auto new_iter = new_list.begin();
+
+        // 两个快照都按基地址排序，所以一次归并即可
+        while (old_iter != old_list.end() && new_iter != new_list.end())
+        {
+            if (old_iter->base < new_iter->base)
+                diff.removed.push_back(*old_iter++);
+            else if (new_iter->base < old_iter->base)
+                diff.added.push_back(*new_iter++);
+            else
+            {
+                if (!old_iter->same_as(*new_iter))
+                    diff.changed.push_back(*new_iter);
+                ++old_iter;
+                ++new_iter;
+            }
+        }
+        diff.removed.insert(diff.removed.end(), old_iter, old_list.end());
+        diff.added.insert(diff.added.end(), new_iter, new_list.end());
+    }
+
+    std::vector<memory_region> region_list;
+    std::vector<memory_region> previous_list;
+    memory_map_summary region_summary;
+#ifndef _WIN32
+    /// <summary>/proc/[pid]/maps的内容，解析出的行和有可执行映射的文件，在多次遍历之间复用</summary>
+    std::string maps_text;
+    std::vector<proc_maps_entry> entries;
+    std::vector<std::uint64_t> image_inodes;
+#endif
+};
+
+} // namespace mw
@@ -0,0 +1,631 @@
+#pragma once
+#include "mw_clock.h"
+#include <deque>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <vector>
+#ifdef _WIN32
+#    include "mw_memory.h"
+#    include "mw_process.h"
+#    include "mw_system.h"
+#    include "mw_thread.h"
+#else
+#    include "mw_platform.h"
+#    include "mw_system_snapshot.h"
+#    include <chrono>
+#    include <condition_variable>
+#    include <string>
+#    include <string_view>
+#    include <system_error>
+#    include <thread>
+#endif
+
+namespace mw {
+
+#ifndef _WIN32
+/// <summary>
+/// 从/proc/meminfo或/proc/[pid]/status的内容中取出一个以kB为单位的字段，例如"MemAvailable:"
+/// </summary>
+/// <param name="text">文件内容</param>
+/// <param name="key">字段名，包括结尾的冒号，必须位于行首</param>
+/// <param name="bytes">[out]字段的字节数</param>
+/// <returns>是否找到该字段</returns>
+inline bool find_proc_kb_field(std::string_view text, std::string_view key, ULONGLONG& bytes)
+{
+    for (auto position = text.find(key); position != std::string_view::npos; position = text.find(key, position + 1))
+    {
+        if (position != 0 && text[position - 1] != '\n')
+            continue;
+        position += key.size();
+        while (position < text.size() && (text[position] == ' ' || text[position] == '\t'))
+            position++;
+        if (position >= text.size() || text[position] < '0' || text[position] > '9')
+            return false;
+        ULONGLONG value = 0;
+        for (; position < text.size() && text[position] >= '0' && text[position] <= '9'; position++)
+            value = value * 10 + static_cast<ULONGLONG>(text[position] - '0');
+        bytes = value * 1024;
+        return true;
+    }
+    return false;
+}
+#endif
+
+/// <summary>
+/// 分配增长率追踪器，对一系列(时间，字节数)样本计算指数加权平均的增长率
+/// </summary>
+/// <remarks>
+/// 它不依赖于任何数据来源，缓存或内存池可以使用自己的字节计数器来驱动它，memory_pressure_monitor使用它追踪进程提交的内存
+/// </remarks>
+class allocation_growth_tracker
+{
+public:
+    /// <summary>
+    /// 创建一个增长率追踪器
+    /// </summary>
+    /// <param name="smoothing">平滑系数，范围(0,1]，越大则越偏向于最近的样本</param>
+    explicit allocation_growth_tracker(double smoothing = 0.3)
+        : alpha(smoothing)
+    {
+    }
+
+public:
+    /// <summary>
+    /// 添加一个样本，时间不晚于上一个样本的样本会被忽略
+    /// </summary>
+    /// <param name="time">样本的时间(毫秒)，例如get_system_time的返回值</param>
+    /// <param name="bytes">样本的字节数</param>
+    void add_sample(ULONGLONG time, ULONGLONG bytes)
+    {
+        if (!sample_count)
+        {
+            last_time = time;
+            last_bytes = bytes;
+            sample_count = 1;
+            return;
+        }
+        if (time <= last_time)
+            return;
+
+        auto instant_rate = (static_cast<double>(bytes) - static_cast<double>(last_bytes)) * 1000.0 / static_cast<double>(time - last_time);
+        smoothed_rate = sample_count == 1 ? instant_rate : alpha * instant_rate + (1.0 - alpha) * smoothed_rate;
+        last_time = time;
+        last_bytes = bytes;
+        sample_count++;
+    }
+
+    /// <summary>
+    /// 获取平滑后的增长率(字节/秒)，若内存在减少则为负数，至少需要两个样本
+    /// </summary>
+    double rate() const { return smoothed_rate; }
+
+    /// <summary>
+    /// 按当前增长率估计到达指定字节数所需的时间
+    /// </summary>
+    /// <param name="limit">目标字节数</param>
+    /// <returns>估计的毫秒数，若已经到达返回0，若没有在增长返回ULLONG_MAX</returns>
+    ULONGLONG time_to_reach(ULONGLONG limit) const
+    {
+        if (last_bytes >= limit)
+            return 0;
+        if (smoothed_rate <= 0.0)
+            return (std::numeric_limits<ULONGLONG>::max)();
+        return static_cast<ULONGLONG>(static_cast<double>(limit - last_bytes) * 1000.0 / smoothed_rate);
+    }
+
+    /// <summary>
+    /// 获取最后一个样本的字节数
+    /// </summary>
+    ULONGLONG current_bytes() const { return last_bytes; }
+
+    void reset()
+    {
+        sample_count = 0;
+        smoothed_rate = 0.0;
+    }
+
+private:
+    double alpha;
+    double smoothed_rate = 0.0;
+    ULONGLONG last_time = 0;
+    ULONGLONG last_bytes = 0;
+    ULONGLONG sample_count = 0;
+};
+
+/// <summary>
+/// 内存压力级别
+/// </summary>
+enum class memory_pressure_level
+{
+    normal = 0,
+    low = 1,
+    critical = 2,
+};
+
+/// <summary>
+/// 内存压力监视器的一次采样结果
+/// </summary>
+struct memory_pressure_sample
+{
+    /// <summary>采样时间(get_system_time，毫秒)</summary>
+    ULONGLONG time = 0;
+    /// <summary>系统物理内存使用率(0到100)</summary>
+    DWORD memory_load = 0;
+    ULONGLONG total_physical = 0;
+    ULONGLONG available_physical = 0;
+    /// <summary>系统提交限制和剩余可提交的字节数</summary>
+    ULONGLONG total_commit = 0;
+    ULONGLONG available_commit = 0;
+    /// <summary>被监视进程提交的私有字节数(PagefileUsage)</summary>
+    SIZE_T process_commit = 0;
+    SIZE_T process_working_set = 0;
+    /// <summary>被监视进程提交字节数的增长率(字节/秒)</summary>
+    double process_growth_rate = 0.0;
+    /// <summary>本次采样后的压力级别</summary>
+    memory_pressure_level level = memory_pressure_level::normal;
+    /// <summary>压力级别变化的序号，每次级别变化加1，回调按该序号递增的顺序被调用</summary>
+    ULONGLONG sequence = 0;
+};
+
+/// <summary>
+/// 内存压力阈值，每个级别都有进入和离开两个阈值(滞后)，避免在阈值附近来回触发回调
+/// </summary>
+struct memory_pressure_thresholds
+{
+    /// <summary>系统内存使用率达到该值时进入low级别</summary>
+    DWORD low_load = 80;
+    /// <summary>处于low级别时，系统内存使用率低于该值才离开low级别</summary>
+    DWORD low_clear_load = 75;
+    /// <summary>系统内存使用率达到该值时进入critical级别</summary>
+    DWORD critical_load = 92;
+    /// <summary>处于critical级别时，系统内存使用率低于该值才离开critical级别</summary>
+    DWORD critical_clear_load = 88;
+    /// <summary>进程提交字节数达到该值时进入low级别，为0表示不检查，离开阈值是它的90%</summary>
+    SIZE_T low_process_commit = 0;
+    /// <summary>进程提交字节数达到该值时进入critical级别，为0表示不检查，离开阈值是它的90%</summary>
+    SIZE_T critical_process_commit = 0;
+};
+
+/// <summary>
+/// 内存压力监视器，使用线程池计时器周期性地采样系统和进程的内存使用情况，在压力级别变化时于线程池中调用注册的回调
+/// </summary>
+/// <remarks>
+/// 每次采样只调用一次virtual_memory_status和一次get_process_memory_info，并且计时器允许系统延迟四分之一周期以便批量唤醒，开销很小。
+/// 系统内存使用率和进程提交字节数分别计算压力级别(都带有滞后)，最终级别取两者中较高的一个。
+///
+/// 为low或critical级别注册的回调在压力级别从低于它上升到不低于它时被调用(例如从normal直接进入critical时，两者的回调都会被调用)，
+/// 为normal级别注册的回调在压力级别回到normal时被调用。回调通过try_submit_threadpool_callback在线程池中执行，所以耗时的清理不会推迟采样。
+/// 级别变化在计算出来时就按顺序进入一个队列，同一时刻只有一个线程池回调在执行队列，所以不同级别变化的回调不会重叠，也不会乱序。
+///
+/// Linux上使用一个采样线程代替线程池计时器，回调在一个临时线程中执行。系统数据来自/proc/meminfo：内存使用率按MemAvailable计算，
+/// 提交限制和剩余可提交字节数是CommitLimit和CommitLimit - Committed_AS；进程数据来自/proc/[pid]/status：
+/// 提交的私有字节数是RssAnon + VmSwap，工作集是VmRSS
+/// </remarks>
+class memory_pressure_monitor
+{
+public:
+    /// <summary>
+    /// 回调函数，参数是触发回调的采样结果
+    /// </summary>
+    using callback = std::function<void(const memory_pressure_sample&)>;
+
+#ifdef _WIN32
+    /// <summary>指定被监视进程的方式，Windows上是进程句柄</summary>
+    using process_reference = HANDLE;
+#else
+    /// <summary>指定被监视进程的方式，Linux上是进程ID，0表示当前进程</summary>
+    using process_reference = std::uint32_t;
+#endif
+
+    /// <summary>
+    /// 创建一个内存压力监视器，此时还未开始采样，请调用start
+    /// </summary>
+    /// <param name="thresholds">压力阈值</param>
+    /// <param name="process">被监视的进程。Windows上必须具有PROCESS_QUERY_INFORMATION和PROCESS_VM_READ访问权限，调用者需保证在监视器销毁前它一直有效</param>
+#ifdef _WIN32
+    explicit memory_pressure_monitor(const memory_pressure_thresholds& thresholds = memory_pressure_thresholds(),
+        process_reference process = mw::get_current_process())
+#else
+    explicit memory_pressure_monitor(const memory_pressure_thresholds& thresholds = memory_pressure_thresholds(),
+        process_reference process = 0)
+#endif
+        : thresholds(thresholds)
+        , process(process)
+    {
+#ifdef _WIN32
+        timer = mw::create_threadpool_timer(timer_callback, this);
+#endif
+    }
+    ~memory_pressure_monitor()
+    {
+#ifdef _WIN32
+        if (timer)
+        {
+            stop();
+            mw::close_threadpool_timer(timer);
+        }
+#else
+        stop();
+#endif
+    }
+    memory_pressure_monitor(const memory_pressure_monitor&) = delete;
+    memory_pressure_monitor(memory_pressure_monitor&&) = delete;
+    memory_pressure_monitor& operator=(const memory_pressure_monitor&) = delete;
+    memory_pressure_monitor& operator=(memory_pressure_monitor&&) = delete;
+
+public:
+    /// <summary>
+    /// 开始周期性采样，若已经开始，则修改采样周期
+    /// </summary>
+    /// <param name="interval">采样周期(毫秒)</param>
+    /// <returns>若计时器创建失败返回false</returns>
+    bool start(DWORD interval = 1000)
+    {
+#ifdef _WIN32
+        if (!timer || !interval)
+            return false;
+        auto due_time = mw::clock::relative_file_time(std::chrono::milliseconds(interval));
+        mw::set_threadpool_timer(timer, &due_time, interval, interval / 4);
+        return true;
+#else
+        if (!interval)
+            return false;
+        std::lock_guard<std::mutex> guard(sampler_lock);
+        sampler_interval = interval;
+        if (sampler.joinable())
+        {
+            sampler_wake.notify_one();
+            return true;
+        }
+        sampler_stopping = false;
+        try
+        {
+            sampler = std::thread([this] { sampler_loop(); });
+        }
+        catch (const std::system_error&)
+        {
+            return false;
+        }
+        return true;
+#endif
+    }
+
+    /// <summary>
+    /// 停止采样，并等待正在执行的采样完成(已经提交到线程池的回调不会被等待)
+    /// </summary>
+    void stop()
+    {
+#ifdef _WIN32
+        if (!timer)
+            return;
+        mw::set_threadpool_timer(timer, nullptr);
+        mw::wait_for_threadpool_timer_callbacks(timer, true);
+#else
+        {
+            std::lock_guard<std::mutex> guard(sampler_lock);
+            sampler_stopping = true;
+        }
+        sampler_wake.notify_one();
+        if (sampler.joinable())
+            sampler.join();
+#endif
+    }
+
+    /// <summary>
+    /// 注册一个回调
+    /// </summary>
+    /// <param name="level">回调关心的级别，含义见类的说明</param>
+    /// <param name="fun">回调函数，它在线程池中被调用，同一时刻只有一个回调在执行，按级别变化的顺序逐个调用</param>
+    /// <returns>回调的标识，用于remove_callback</returns>
+    size_t add_callback(memory_pressure_level level, callback fun)
+    {
+        std::lock_guard<std::mutex> guard(callback_lock);
+        auto id = ++last_callback_id;
+        callbacks.push_back({ id, level, std::make_shared<callback>(std::move(fun)) });
+        return id;
+    }
+
+    /// <summary>
+    /// 删除一个回调，已经提交到线程池的调用仍然会执行
+    /// </summary>
+    /// <param name="id">add_callback返回的标识</param>
+    /// <returns>若找到并删除了该回调返回true</returns>
+    bool remove_callback(size_t id)
+    {
+        std::lock_guard<std::mutex> guard(callback_lock);
+        for (auto iter = callbacks.begin(); iter != callbacks.end(); ++iter)
+        {
+            if (iter->id == id)
+            {
+                callbacks.erase(iter);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// <summary>
+    /// 立即进行一次采样，若压力级别发生变化则提交相应的回调
+    /// </summary>
+    /// <returns>本次采样的结果，若采样失败，返回上一次的结果</returns>
+    memory_pressure_sample sample_now()
+    {
+        memory_pressure_sample counters;
+        if (!read_counters(counters))
+            return last_sample();
+
+        std::unique_lock<std::mutex> state_guard(state_lock);
+        auto previous_level = current.level;
+
+        current.time = counters.time;
+        current.memory_load = counters.memory_load;
+        current.total_physical = counters.total_physical;
+        current.available_physical = counters.available_physical;
+        current.total_commit = counters.total_commit;
+        current.available_commit = counters.available_commit;
+        current.process_commit = counters.process_commit;
+        current.process_working_set = counters.process_working_set;
+
+        growth.add_sample(current.time, current.process_commit);
+        current.process_growth_rate = growth.rate();
+
+        system_level = next_level(system_level, current.memory_load,
+            thresholds.low_load, thresholds.low_clear_load, thresholds.critical_load, thresholds.critical_clear_load);
+        process_level = next_level(process_level, current.process_commit,
+            thresholds.low_process_commit, thresholds.low_process_commit / 10 * 9,
+            thresholds.critical_process_commit, thresholds.critical_process_commit / 10 * 9);
+        current.level = system_level > process_level ? system_level : process_level;
+
+        // 在状态锁中入队，使队列的顺序与级别变化的顺序相同
+        bool start_drain = false;
+        if (current.level != previous_level)
+        {
+            ++current.sequence;
+            start_drain = enqueue(previous_level, current);
+        }
+        auto sample = current;
+        state_guard.unlock();
+
+        if (start_drain)
+            submit_drain();
+        return sample;
+    }
+
+    /// <summary>
+    /// 获取最后一次采样的结果
+    /// </summary>
+    memory_pressure_sample last_sample()
+    {
+        std::lock_guard<std::mutex> guard(state_lock);
+        return current;
+    }
+
+    /// <summary>
+    /// 获取当前的压力级别
+    /// </summary>
+    memory_pressure_level level()
+    {
+        return last_sample().level;
+    }
+
+    /// <summary>
+    /// 修改压力阈值，在下一次采样时生效
+    /// </summary>
+    void set_thresholds(const memory_pressure_thresholds& new_thresholds)
+    {
+        std::lock_guard<std::mutex> guard(state_lock);
+        thresholds = new_thresholds;
+    }
+
+private:
+    struct callback_entry
+    {
+        size_t id;
+        memory_pressure_level level;
+        std::shared_ptr<callback> fun;
+    };
+
+    struct dispatch_context
+    {
+        std::vector<std::shared_ptr<callback>> funs;
+        memory_pressure_sample sample;
+    };
+
+    /// <summary>
+    /// 等待执行的级别变化，draining为true时已经有一个线程在执行队列。它由shared_ptr持有，监视器销毁后仍在执行的回调不受影响
+    /// </summary>
+    struct dispatch_queue
+    {
+        std::mutex lock;
+        std::deque<dispatch_context> pending;
+        bool draining = false;
+    };
+
+    /// <summary>
+    /// 带滞后的级别计算，enter为0表示不检查
+    /// </summary>
+    template <typename T>
+    static memory_pressure_level next_level(memory_pressure_level level, T value,
+        T low_enter, T low_clear, T critical_enter, T critical_clear)
+    {
+        if (critical_enter && (value >= critical_enter || (level == memory_pressure_level::critical && value >= critical_clear)))
+            return memory_pressure_level::critical;
+        if (low_enter && (value >= low_enter || (level != memory_pressure_level::normal && value >= low_clear)))
+            return memory_pressure_level::low;
+        return memory_pressure_level::normal;
+    }
+
+    /// <summary>
+    /// 选出本次级别变化要调用的回调并放入队列，在状态锁中调用
+    /// </summary>
+    /// <returns>是否需要提交一个执行队列的回调</returns>
+    bool enqueue(memory_pressure_level previous_level, const memory_pressure_sample& sample)
+    {
+        dispatch_context context;
+        context.sample = sample;
+        {
+            std::lock_guard<std::mutex> guard(callback_lock);
+            for (auto& entry : callbacks)
+            {
+                bool rising = entry.level != memory_pressure_level::normal && entry.level > previous_level && entry.level <= sample.level;
+                bool recovered = entry.level == memory_pressure_level::normal && sample.level == memory_pressure_level::normal;
+                if (rising || recovered)
+                    context.funs.push_back(entry.fun);
+            }
+        }
+        if (context.funs.empty())
+            return false;
+
+        std::lock_guard<std::mutex> guard(queue->lock);
+        queue->pending.push_back(std::move(context));
+        if (queue->draining)
+            return false;
+        queue->draining = true;
+        return true;
+    }
+
+    void submit_drain()
+    {
+#ifdef _WIN32
+        auto param = new std::shared_ptr<dispatch_queue>(queue);
+        if (!mw::try_submit_threadpool_callback(dispatch_callback, param))
+            dispatch_callback(nullptr, param); // 无法提交到线程池时在当前线程调用，保证回调不会丢失
+#else
+        try
+        {
+            std::thread([pending = queue] { drain(pending); }).detach();
+        }
+        catch (const std::system_error&)
+        {
+            drain(queue); // 无法创建线程时在当前线程调用，保证回调不会丢失
+        }
+#endif
+    }
+
+    /// <summary>
+    /// 按顺序执行队列中的所有级别变化，直到队列为空
+    /// </summary>
+    static void drain(const std::shared_ptr<dispatch_queue>& pending)
+    {
+        for (;;)
+        {
+            dispatch_context context;
+            {
+                std::lock_guard<std::mutex> guard(pending->lock);
+                if (pending->pending.empty())
+                {
+                    pending->draining = false;
+                    return;
+                }
+                context = std::move(pending->pending.front());
+                pending->pending.pop_front();
+            }
+            for (auto& fun : context.funs)
+                (*fun)(context.sample);
+        }
+    }
+
+#ifdef _WIN32
+    bool read_counters(memory_pressure_sample& counters)
+    {
+        MEMORYSTATUSEX memory_status = { 0 };
+        PROCESS_MEMORY_COUNTERS process_counters = { 0 };
+        if (!mw::virtual_memory_status(memory_status) || !mw::get_process_memory_info(process, process_counters))
+            return false;
+        counters.time = mw::get_system_time();
+        counters.memory_load = memory_status.dwMemoryLoad;
+        counters.total_physical = memory_status.ullTotalPhys;
+        counters.available_physical = memory_status.ullAvailPhys;
+        counters.total_commit = memory_status.ullTotalPageFile;
+        counters.available_commit = memory_status.ullAvailPageFile;
+        counters.process_commit = process_counters.PagefileUsage;
+        counters.process_working_set = process_counters.WorkingSetSize;
+        return true;
+    }
+
+    static void CALLBACK dispatch_callback(PTP_CALLBACK_INSTANCE, PVOID param)
+    {
+        auto pending = static_cast<std::shared_ptr<dispatch_queue>*>(param);
+        drain(*pending);
+        delete pending;
+    }
+
+    static void CALLBACK timer_callback(PTP_CALLBACK_INSTANCE, PVOID param, PTP_TIMER)
+    {
+        static_cast<memory_pressure_monitor*>(param)->sample_now();
+    }
+#else
+    bool read_counters(memory_pressure_sample& counters)
+    {
+        std::string text;
+        ULONGLONG total = 0, available = 0, commit_limit = 0, committed = 0;
+        if (!read_proc_file("/proc/meminfo", text) || !find_proc_kb_field(text, "MemTotal:", total)
+            || !find_proc_kb_field(text, "MemAvailable:", available) || !find_proc_kb_field(text, "CommitLimit:", commit_limit)
+            || !find_proc_kb_field(text, "Committed_AS:", committed) || !total)
+            return false;
+
+        char path[64];
+        if (process)
+            std::snprintf(path, sizeof(path), "/proc/%u/status", process);
+        else
+            std::snprintf(path, sizeof(path), "/proc/self/status");
+        ULONGLONG resident = 0, anonymous = 0, swapped = 0;
+        if (!read_proc_file(path, text) || !find_proc_kb_field(text, "VmRSS:", resident) || !find_proc_kb_field(text, "RssAnon:", anonymous))
+            return false;
+        find_proc_kb_field(text, "VmSwap:", swapped);
+
+        counters.time = GetTickCount64();
+        counters.memory_load = static_cast<DWORD>(100 - (available < total ? available : total) * 100 / total);
+        counters.total_physical = total;
+        counters.available_physical = available;
+        counters.total_commit = commit_limit;
+        counters.available_commit = committed < commit_limit ? commit_limit - committed : 0;
+        counters.process_commit = static_cast<SIZE_T>(anonymous + swapped);
+        counters.process_working_set = static_cast<SIZE_T>(resident);
+        return true;
+    }
+
+    void sampler_loop()
+    {
+        std::unique_lock<std::mutex> guard(sampler_lock);
+        while (!sampler_stopping)
+        {
+            // start修改周期时会唤醒等待，按新的周期重新计时
+            auto interval = sampler_interval;
+            if (sampler_wake.wait_for(guard, std::chrono::milliseconds(interval),
+                    [this, interval] { return sampler_stopping || sampler_interval != interval; }))
+                continue;
+            guard.unlock();
+            sample_now();
+            guard.lock();
+        }
+    }
+#endif
+
+    memory_pressure_thresholds thresholds;
+    process_reference process;
+#ifdef _WIN32
+    PTP_TIMER timer = nullptr;
+#else
+    std::thread sampler;
+    std::mutex sampler_lock;
+    std::condition_variable sampler_wake;
+    DWORD sampler_interval = 0;
+    bool sampler_stopping = false;
+#endif
+
+    std::mutex state_lock;
+    memory_pressure_sample current;
+    memory_pressure_level system_level = memory_pressure_level::normal;
+    memory_pressure_level process_level = memory_pressure_level::normal;
+    allocation_growth_tracker growth;
+
+    std::mutex callback_lock;
+    std::vector<callback_entry> callbacks;
+    size_t last_callback_id = 0;
+    std::shared_ptr<dispatch_queue> queue = std::make_shared<dispatch_queue>();
+};
+
+} // namespace mw
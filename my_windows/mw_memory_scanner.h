@@ -0,0 +1,684 @@
+#pragma once
+#include "mw_memory_map.h"
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string_view>
+#ifdef _WIN32
+#    include "mw_thread.h"
+#else
+#    include <sys/uio.h>
+#    include <system_error>
+#    include <thread>
+#    include <unistd.h>
+#endif
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#    define MW_SCANNER_X86
+#    include <immintrin.h>
+#    ifdef _MSC_VER
+#        include <intrin.h>
+#        define MW_SCANNER_AVX2_TARGET
+#    else
+#        define MW_SCANNER_AVX2_TARGET __attribute__((target("avx2")))
+#    endif
+#endif
+
+namespace mw {
+
+/// <summary>
+/// 内存扫描的一个匹配结果
+/// </summary>
+struct scan_match
+{
+    /// <summary>匹配在目标进程中的地址</summary>
+    std::uintptr_t address;
+    /// <summary>匹配的模式的索引(添加模式的顺序，从0开始)</summary>
+    size_t pattern_index;
+};
+
+namespace scanner_detail {
+
+    /// <summary>
+    /// 编译后的字节模式，mask中为0xFF的字节必须匹配，为0的字节是通配符
+    /// </summary>
+    struct compiled_pattern
+    {
+        std::vector<std::uint8_t> bytes;
+        std::vector<std::uint8_t> mask;
+        /// <summary>第一个和最后一个非通配符字节的位置，SIMD过滤使用这两个字节</summary>
+        size_t first = 0;
+        size_t last = 0;
+        size_t index = 0;
+
+        bool verify(const std::uint8_t* data) const
+        {
+            for (size_t i = 0; i < bytes.size(); i++)
+                if ((data[i] ^ bytes[i]) & mask[i])
+                    return false;
+            return true;
+        }
+    };
+
+    inline unsigned count_trailing_zeros(std::uint32_t value)
+    {
+#ifdef _MSC_VER
+        unsigned long index = 0;
+        _BitScanForward(&index, value);
+        return index;
+#else
+        return __builtin_ctz(value);
+#endif
+    }
+
+    /// <summary>
+    /// 标量搜索，on_match(起始位置, 模式索引)返回false时停止搜索
+    /// </summary>
+    /// <param name="data">数据缓冲区</param>
+    /// <param name="size">数据缓冲区的大小</param>
+    /// <param name="report_limit">只报告起始位置小于该值的匹配</param>
+    /// <param name="start">从该位置开始搜索</param>
+    template <typename OnMatch>
+    inline bool search_scalar(const std::uint8_t* data, size_t size, size_t report_limit,
+        const compiled_pattern& pattern, size_t start, OnMatch& on_match)
+    {
+        if (size < pattern.bytes.size())
+            return true;
+        auto end = size - pattern.bytes.size() + 1;
+        if (end > report_limit)
+            end = report_limit;
+        auto first_byte = pattern.bytes[pattern.first];
+        for (size_t i = start; i < end; i++)
+            if (data[i + pattern.first] == first_byte && pattern.verify(data + i) && !on_match(i, pattern.index))
+                return false;
+        return true;
+    }
+
+#ifdef MW_SCANNER_X86
+    template <typename OnMatch>
+    inline bool search_sse2(const std::uint8_t* data, size_t size, size_t report_limit,
+        const compiled_pattern& pattern, OnMatch& on_match)
+    {
+        if (size < pattern.bytes.size())
+            return true;
+        auto end = size - pattern.bytes.size() + 1;
+        if (end > report_limit)
+            end = report_limit;
+
+        // 每次比较16个候选位置的首尾两个非通配符字节，只有两者都相等的位置才进行完整比较
+        const auto first_byte = _mm_set1_epi8(static_cast<char>(pattern.bytes[pattern.first]));
+        const auto last_byte = _mm_set1_epi8(static_cast<char>(pattern.bytes[pattern.last]));
+        size_t i = 0;
+        for (; i + 16 <= end; i += 16)
+        {
+            auto block_first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + pattern.first));
+            auto block_last = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + pattern.last));
+            auto equal = _mm_and_si128(_mm_cmpeq_epi8(block_first, first_byte), _mm_cmpeq_epi8(block_last, last_byte));
+            auto bits = static_cast<std::uint32_t>(_mm_movemask_epi8(equal));
+            while (bits)
+            {
+                auto offset = i + count_trailing_zeros(bits);
+                if (pattern.verify(data + offset) && !on_match(offset, pattern.index))
+                    return false;
+                bits &= bits - 1;
+            }
+        }
+        return search_scalar(data, size, report_limit, pattern, i, on_match);
+    }
+
+    template <typename OnMatch>
+    MW_SCANNER_AVX2_TARGET inline bool search_avx2(const std::uint8_t* data, size_t size, size_t report_limit,
+        const compiled_pattern& pattern, OnMatch& on_match)
+    {
+        if (size < pattern.bytes.size())
+            return true;
+        auto end = size - pattern.bytes.size() + 1;
+        if (end > report_limit)
+            end = report_limit;
+
+        const auto first_byte = _mm256_set1_epi8(static_cast<char>(pattern.bytes[pattern.first]));
+        const auto last_byte = _mm256_set1_epi8(static_cast<char>(pattern.bytes[pattern.last]));
+        size_t i = 0;
+        for (; i + 32 <= end; i += 32)
+        {
+            auto block_first = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + pattern.first));
+            auto block_last = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + pattern.last));
+            auto equal = _mm256_and_si256(_mm256_cmpeq_epi8(block_first, first_byte), _mm256_cmpeq_epi8(block_last, last_byte));
+            auto bits = static_cast<std::uint32_t>(_mm256_movemask_epi8(equal));
+            while (bits)
+            {
+                auto offset = i + count_trailing_zeros(bits);
+                if (pattern.verify(data + offset) && !on_match(offset, pattern.index))
+                    return false;
+                bits &= bits - 1;
+            }
+        }
+        return search_scalar(data, size, report_limit, pattern, i, on_match);
+    }
+
+    /// <summary>
+    /// 当前CPU和操作系统是否支持AVX2
+    /// </summary>
+    inline bool cpu_has_avx2()
+    {
+#    ifdef _MSC_VER
+        int info[4] = { 0 };
+        __cpuid(info, 0);
+        if (info[0] < 7)
+            return false;
+        __cpuid(info, 1);
+        bool os_saves_ymm = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && ((_xgetbv(0) & 6) == 6);
+        __cpuidex(info, 7, 0);
+        return os_saves_ymm && (info[1] & (1 << 5));
+#    else
+        return __builtin_cpu_supports("avx2");
+#    endif
+    }
+#endif
+
+    /// <summary>
+    /// 按第一个非通配符字节分派的模式表，模式较多时用它在一遍扫描中同时搜索所有模式
+    /// </summary>
+    /// <remarks>
+    /// 逐个模式的SIMD搜索是O(模式数量 × 字节数)，模式多时每个字节被重复读取很多次。分派表对每个位置只查一次表，
+    /// 只有首字节相同的模式才继续比较最后一个非通配符字节和完整模式，代价是O(字节数 + 候选数量)
+    /// </remarks>
+    struct dispatch_table
+    {
+        /// <summary>首字节为b的模式是patterns[bucket_begin[b]]到patterns[bucket_begin[b + 1]]</summary>
+        std::uint32_t bucket_begin[257] = {};
+        std::vector<const compiled_pattern*> patterns;
+        /// <summary>最大的首字节偏移，位置q处的首字节对应的起始位置是q - first</summary>
+        size_t max_first = 0;
+
+        void build(const std::vector<compiled_pattern>& source)
+        {
+            std::uint32_t counts[256] = {};
+            max_first = 0;
+            for (auto& pattern : source)
+            {
+                ++counts[pattern.bytes[pattern.first]];
+                if (pattern.first > max_first)
+                    max_first = pattern.first;
+            }
+            bucket_begin[0] = 0;
+            for (int b = 0; b < 256; b++)
+                bucket_begin[b + 1] = bucket_begin[b] + counts[b];
+
+            patterns.assign(source.size(), nullptr);
+            std::uint32_t next[256];
+            std::memcpy(next, bucket_begin, sizeof(next));
+            for (auto& pattern : source)
+                patterns[next[pattern.bytes[pattern.first]]++] = &pattern;
+        }
+    };
+
+    /// <summary>
+    /// 使用分派表在数据缓冲区中同时搜索多个模式，参数的含义与search_scalar相同
+    /// </summary>
+    template <typename OnMatch>
+    inline bool search_dispatch(const std::uint8_t* data, size_t size, size_t report_limit,
+        const dispatch_table& table, OnMatch& on_match)
+    {
+        // 首字节的位置最多比起始位置大max_first
+        auto end = report_limit + table.max_first;
+        if (end > size)
+            end = size;
+        for (size_t q = 0; q < end; q++)
+        {
+            auto byte = data[q];
+            for (auto i = table.bucket_begin[byte], last = table.bucket_begin[byte + 1]; i < last; i++)
+            {
+                auto& pattern = *table.patterns[i];
+                if (q < pattern.first)
+                    continue;
+                auto start = q - pattern.first;
+                if (start >= report_limit || start + pattern.bytes.size() > size)
+                    continue;
+                if (data[start + pattern.last] == pattern.bytes[pattern.last] && pattern.verify(data + start)
+                    && !on_match(start, pattern.index))
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    /// <summary>
+    /// 在数据缓冲区中搜索指定模式，自动选择AVX2，SSE2或标量实现
+    /// </summary>
+    template <typename OnMatch>
+    inline bool search(const std::uint8_t* data, size_t size, size_t report_limit,
+        const compiled_pattern& pattern, OnMatch& on_match)
+    {
+#ifdef MW_SCANNER_X86
+        static const bool has_avx2 = cpu_has_avx2();
+        if (has_avx2)
+            return search_avx2(data, size, report_limit, pattern, on_match);
+        return search_sse2(data, size, report_limit, pattern, on_match);
+#else
+        return search_scalar(data, size, report_limit, pattern, 0, on_match);
+#endif
+    }
+
+} // namespace scanner_detail
+
+/// <summary>
+/// 远程进程内存扫描器，在目标进程的已调拨内存中并行搜索多个带通配符的字节模式
+/// </summary>
+/// <remarks>
+/// 扫描器先使用memory_map获取目标进程的区域列表，然后把可读区域切分为固定大小的块，由线程池工作线程并行地
+/// 使用read_process_memory一次读取一整块到该线程复用的缓冲区中，再使用SIMD(AVX2或SSE2，运行时选择)过滤候选位置。
+/// Linux上区域列表来自/proc/[pid]/maps，每块使用一次process_vm_readv读取，工作线程在每次扫描时创建，扫描结束时退出。
+/// 模式超过dispatch_threshold个时，改为使用按首字节分派的表在一遍扫描中同时搜索所有模式。
+/// 相邻的块会重叠(最长模式长度-1)个字节，所以跨块边界的匹配不会丢失，也不会重复报告。
+///
+/// 若整块读取失败(例如区域在拍摄快照后被释放或改变了保护属性)，扫描器会退回到逐页读取并跳过不可读的页面，此时跨页的匹配会丢失。
+/// 匹配不会跨越区域边界。
+///
+/// 匹配回调会在多个工作线程中同时被调用，它必须是线程安全的，并且回调的顺序是不确定的
+/// </remarks>
+class memory_scanner
+{
+public:
+    /// <summary>
+    /// 匹配回调，返回false将停止扫描
+    /// </summary>
+    using match_callback = std::function<bool(const scan_match&)>;
+
+    /// <summary>
+    /// 模式数量超过该值时使用分派表一遍搜索所有模式，否则逐个模式进行SIMD搜索。
+    /// AVX2上每个模式扫描一遍的代价大约是逐字节查表的1/8，模式在16个左右时两者相当
+    /// </summary>
+    static constexpr size_t dispatch_threshold = 16;
+
+    /// <summary>
+    /// 创建一个内存扫描器
+    /// </summary>
+    /// <param name="chunk_size">每次read_process_memory读取的字节数，它也是每个工作线程的缓冲区大小，会被向上取整到页面大小</param>
+    /// <param name="thread_count">工作线程数量，若为0则使用处理器数量</param>
+    explicit memory_scanner(size_t chunk_size = 4 * 1024 * 1024, DWORD thread_count = 0)
+    {
+#ifdef _WIN32
+        SYSTEM_INFO system_info = { 0 };
+        mw::get_system_info(system_info);
+        page_size = system_info.dwPageSize;
+        DWORD processor_count = system_info.dwNumberOfProcessors;
+        work = mw::create_threadpool_work(work_callback, this);
+#else
+        page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        DWORD processor_count = (std::max)(std::thread::hardware_concurrency(), 1u);
+#endif
+        this->chunk_size = (chunk_size + page_size - 1) / page_size * page_size;
+        this->thread_count = thread_count ? thread_count : processor_count;
+        buffers.resize(this->thread_count);
+    }
+    ~memory_scanner()
+    {
+#ifdef _WIN32
+        if (work)
+        {
+            mw::wait_for_threadpool_work_callbacks(work);
+            mw::close_threadpool_work(work);
+        }
+#endif
+    }
+    memory_scanner(const memory_scanner&) = delete;
+    memory_scanner(memory_scanner&&) = delete;
+    memory_scanner& operator=(const memory_scanner&) = delete;
+    memory_scanner& operator=(memory_scanner&&) = delete;
+
+public:
+    /// <summary>
+    /// 添加一个字节模式
+    /// </summary>
+    /// <param name="bytes">模式的字节</param>
+    /// <param name="mask">与bytes等长的掩码，0xFF表示必须匹配，0表示通配符，若为nullptr则所有字节都必须匹配</param>
+    /// <param name="length">模式的长度</param>
+    /// <returns>若模式为空或全部是通配符，返回false</returns>
+    bool add_pattern(const void* bytes, const void* mask, size_t length)
+    {
+        scanner_detail::compiled_pattern pattern;
+        pattern.bytes.assign(static_cast<const std::uint8_t*>(bytes), static_cast<const std::uint8_t*>(bytes) + length);
+        if (mask)
+            pattern.mask.assign(static_cast<const std::uint8_t*>(mask), static_cast<const std::uint8_t*>(mask) + length);
+        else
+            pattern.mask.assign(length, 0xFF);
+        return add_compiled(std::move(pattern));
+    }
+
+    /// <summary>
+    /// 添加一个文本形式的字节模式，如"48 8B ?? ?? 05"，每个字节是两位十六进制数，"?"或"??"表示通配符，字节之间用空格分隔
+    /// </summary>
+    /// <param name="text">模式文本</param>
+    /// <returns>若文本格式错误，或模式为空或全部是通配符，返回false</returns>
+    bool add_pattern(std::string_view text)
+    {
+        scanner_detail::compiled_pattern pattern;
+        size_t i = 0;
+        while (i < text.size())
+        {
+            if (text[i] == ' ')
+            {
+                ++i;
+                continue;
+            }
+            if (text[i] == '?')
+            {
+                pattern.bytes.push_back(0);
+                pattern.mask.push_back(0);
+                i += (i + 1 < text.size() && text[i + 1] == '?') ? 2 : 1;
+                continue;
+            }
+            if (i + 1 >= text.size() || hex_value(text[i]) < 0 || hex_value(text[i + 1]) < 0)
+                return false;
+            pattern.bytes.push_back(static_cast<std::uint8_t>(hex_value(text[i]) * 16 + hex_value(text[i + 1])));
+            pattern.mask.push_back(0xFF);
+            i += 2;
+        }
+        return add_compiled(std::move(pattern));
+    }
+
+    /// <summary>
+    /// 删除所有模式
+    /// </summary>
+    void clear_patterns()
+    {
+        patterns.clear();
+        max_pattern_length = 0;
+    }
+
+    size_t pattern_count() const { return patterns.size(); }
+
+    /// <summary>
+    /// 设置要扫描的区域的过滤条件，默认扫描所有可读的已调拨区域
+    /// </summary>
+    /// <param name="protect_mask">区域的基本保护属性必须包含其中之一(如PAGE_READWRITE | PAGE_EXECUTE_READWRITE只扫描可写区域)，若为0则接受所有可读区域</param>
+    /// <param name="type_mask">区域类型必须包含其中之一，MEM_IMAGE，MEM_MAPPED和MEM_PRIVATE的组合</param>
+    void set_region_filter(DWORD protect_mask = 0, DWORD type_mask = MEM_IMAGE | MEM_MAPPED | MEM_PRIVATE)
+    {
+        this->protect_mask = protect_mask;
+        this->type_mask = type_mask;
+    }
+
+    /// <summary>
+    /// 只报告起始地址在[begin, end)中的匹配，只读取这个范围内的区域，例如只扫描一个模块。默认扫描整个地址空间。
+    /// Linux上无法从/proc/[pid]/maps区分已调拨的内存和MAP_NORESERVE预留的内存(例如sanitizer的数TB影子内存)，扫描这样的进程时应该限定范围
+    /// </summary>
+    void set_address_range(std::uintptr_t begin = 0, std::uintptr_t end = UINTPTR_MAX)
+    {
+        range_begin = begin;
+        range_end = end;
+    }
+
+    /// <summary>
+    /// 扫描目标进程，该函数会先拍摄目标进程的地址空间快照
+    /// </summary>
+    /// <param name="process">目标进程，Windows上必须具有PROCESS_QUERY_INFORMATION和PROCESS_VM_READ访问权限；
+    /// Linux上是进程ID，0表示当前进程，调用者必须有权限ptrace它(例如它是调用者的子进程)</param>
+    /// <param name="callback">匹配回调，它会在多个工作线程中被同时调用</param>
+    /// <returns>报告的匹配数量</returns>
+    ULONGLONG scan(memory_map::process_reference process, const match_callback& callback)
+    {
+        memory_map map(process);
+        return scan(process, map, callback);
+    }
+
+    /// <summary>
+    /// 使用已有的地址空间快照扫描目标进程
+    /// </summary>
+    /// <param name="process">目标进程，Windows上必须具有PROCESS_VM_READ访问权限，Linux上见上一个重载</param>
+    /// <param name="map">目标进程的地址空间快照</param>
+    /// <param name="callback">匹配回调，它会在多个工作线程中被同时调用</param>
+    /// <returns>报告的匹配数量</returns>
+    ULONGLONG scan(memory_map::process_reference process, const memory_map& map, const match_callback& callback)
+    {
+#ifdef _WIN32
+        if (patterns.empty() || !work)
+            return 0;
+#else
+        if (patterns.empty())
+            return 0;
+#endif
+
+        build_units(map);
+        if (patterns.size() > dispatch_threshold)
+            dispatch.build(patterns);
+
+#ifdef _WIN32
+        target_process = process;
+#else
+        target_process = process ? static_cast<pid_t>(process) : getpid();
+#endif
+        current_callback = &callback;
+        next_unit.store(0);
+        next_worker.store(0);
+        stop.store(false);
+        match_count.store(0);
+        scanned_bytes.store(0);
+
+#ifdef _WIN32
+        for (DWORD i = 0; i < thread_count; i++)
+            mw::submit_threadpool_work(work);
+        mw::wait_for_threadpool_work_callbacks(work);
+#else
+        // 调用线程是其中一个工作线程，无法创建更多的线程时剩下的块由已有的工作线程读取
+        std::vector<std::thread> workers;
+        try
+        {
+            for (DWORD i = 1; i < thread_count; i++)
+                workers.emplace_back([this] { worker(); });
+        }
+        catch (const std::system_error&)
+        {
+        }
+        worker();
+        for (auto& thread : workers)
+            thread.join();
+#endif
+
+        current_callback = nullptr;
+        return match_count.load();
+    }
+
+    /// <summary>
+    /// 获取上一次扫描实际读取的字节数
+    /// </summary>
+    ULONGLONG bytes_scanned() const { return scanned_bytes.load(); }
+
+private:
+    /// <summary>
+    /// 一个扫描单元，它是一个区域中不超过chunk_size的一块
+    /// </summary>
+    struct scan_unit
+    {
+        std::uintptr_t address;
+        size_t size;
+        std::uintptr_t region_end;
+    };
+
+    static int hex_value(char c)
+    {
+        if (c >= '0' && c <= '9')
+            return c - '0';
+        if (c >= 'a' && c <= 'f')
+            return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F')
+            return c - 'A' + 10;
+        return -1;
+    }
+
+    bool add_compiled(scanner_detail::compiled_pattern&& pattern)
+    {
+        if (pattern.bytes.empty())
+            return false;
+        size_t first = pattern.bytes.size(), last = 0;
+        for (size_t i = 0; i < pattern.bytes.size(); i++)
+        {
+            pattern.bytes[i] &= pattern.mask[i];
+            if (pattern.mask[i] == 0xFF)
+            {
+                if (first == pattern.bytes.size())
+                    first = i;
+                last = i;
+            }
+        }
+        // SIMD过滤需要至少一个完全确定的字节
+        if (first == pattern.bytes.size())
+            return false;
+        pattern.first = first;
+        pattern.last = last;
+        pattern.index = patterns.size();
+        if (pattern.bytes.size() > max_pattern_length)
+            max_pattern_length = pattern.bytes.size();
+        patterns.push_back(std::move(pattern));
+        return true;
+    }
+
+    bool accept_region(const memory_region& region) const
+    {
+        if (region.state != MEM_COMMIT || (region.protect & PAGE_GUARD) || !(region.type & type_mask))
+            return false;
+        auto base_protect = region.protect & 0xFF;
+        if (base_protect == PAGE_NOACCESS || base_protect == PAGE_EXECUTE)
+            return false;
+        return protect_mask == 0 || (base_protect & protect_mask);
+    }
+
+    void build_units(const memory_map& map)
+    {
+        units.clear();
+        for (auto& region : map.regions())
+        {
+            if (!accept_region(region))
+                continue;
+            // 范围只限制报告的起始地址，跨越范围末尾的匹配仍然可以读取到区域末尾
+            auto begin = (std::max)(region.base, range_begin);
+            auto end = (std::min)(region.end(), range_end);
+            for (std::uintptr_t address = begin; address < end; address += chunk_size)
+            {
+                auto size = end - address;
+                units.push_back({ address, size < chunk_size ? size : chunk_size, region.end() });
+            }
+        }
+    }
+
+#ifdef _WIN32
+    static void CALLBACK work_callback(PTP_CALLBACK_INSTANCE, PVOID context, PTP_WORK)
+    {
+        static_cast<memory_scanner*>(context)->worker();
+    }
+#endif
+
+    /// <summary>
+    /// 从目标进程读取size个字节，只读取了一部分(遇到不可读的页面)时返回false，bytes_read是已读取的字节数
+    /// </summary>
+    bool read_target(std::uintptr_t address, std::uint8_t* buffer, size_t size, SIZE_T& bytes_read) const
+    {
+#ifdef _WIN32
+        return mw::read_process_memory(target_process, reinterpret_cast<LPCVOID>(address), buffer, size, &bytes_read);
+#else
+        // process_vm_readv在第一个不可读的页面处停止并返回已读取的字节数，与ReadProcessMemory一样按失败处理
+        iovec local = { buffer, size };
+        iovec remote = { reinterpret_cast<void*>(address), size };
+        auto result = process_vm_readv(target_process, &local, 1, &remote, 1, 0);
+        bytes_read = result < 0 ? 0 : static_cast<SIZE_T>(result);
+        return bytes_read == size;
+#endif
+    }
+
+    void worker()
+    {
+        auto& buffer = buffers[next_worker.fetch_add(1) % thread_count];
+        auto buffer_size = chunk_size + max_pattern_length - 1;
+        if (buffer.size() < buffer_size)
+            buffer.resize(buffer_size);
+
+        for (auto index = next_unit.fetch_add(1); index < units.size() && !stop.load(std::memory_order_relaxed);
+             index = next_unit.fetch_add(1))
+        {
+            auto& unit = units[index];
+            // 多读取(最长模式长度-1)个字节，使跨块边界的匹配能够在前一个块中被发现
+            auto read_size = unit.size + max_pattern_length - 1;
+            if (unit.address + read_size > unit.region_end)
+                read_size = unit.region_end - unit.address;
+
+            SIZE_T bytes_read = 0;
+            if (read_target(unit.address, buffer.data(), read_size, bytes_read))
+            {
+                scanned_bytes.fetch_add(bytes_read, std::memory_order_relaxed);
+                scan_buffer(buffer.data(), bytes_read, unit.size, unit.address);
+                continue;
+            }
+
+            // 整块读取失败，逐页读取并跳过不可读的页面
+            for (size_t offset = 0; offset < unit.size && !stop.load(std::memory_order_relaxed); offset += page_size)
+            {
+                auto page_address = unit.address + offset;
+                if (read_target(page_address, buffer.data(), page_size, bytes_read))
+                {
+                    scanned_bytes.fetch_add(bytes_read, std::memory_order_relaxed);
+                    scan_buffer(buffer.data(), bytes_read, page_size, page_address);
+                }
+            }
+        }
+    }
+
+    void scan_buffer(const std::uint8_t* data, size_t size, size_t report_limit, std::uintptr_t address)
+    {
+        auto on_match = [&](size_t offset, size_t pattern_index) {
+            match_count.fetch_add(1, std::memory_order_relaxed);
+            if (!(*current_callback)({ address + offset, pattern_index }))
+            {
+                stop.store(true, std::memory_order_relaxed);
+                return false;
+            }
+            return true;
+        };
+
+        if (patterns.size() > dispatch_threshold)
+        {
+            scanner_detail::search_dispatch(data, size, report_limit, dispatch, on_match);
+            return;
+        }
+
+        // 模式较少时每个模式依次扫描同一个缓冲区，此时缓冲区已经在缓存中
+        for (auto& pattern : patterns)
+        {
+            if (!scanner_detail::search(data, size, report_limit, pattern, on_match))
+                return;
+        }
+    }
+
+    std::vector<scanner_detail::compiled_pattern> patterns;
+    scanner_detail::dispatch_table dispatch;
+    size_t max_pattern_length = 0;
+    DWORD protect_mask = 0;
+    DWORD type_mask = MEM_IMAGE | MEM_MAPPED | MEM_PRIVATE;
+    std::uintptr_t range_begin = 0;
+    std::uintptr_t range_end = UINTPTR_MAX;
+
+    size_t chunk_size = 0;
+    size_t page_size = 0;
+    DWORD thread_count = 0;
+#ifdef _WIN32
+    PTP_WORK work = nullptr;
+#endif
+    std::vector<std::vector<std::uint8_t>> buffers;
+    std::vector<scan_unit> units;
+
+    // 以下成员只在一次扫描期间有效
+#ifdef _WIN32
+    HANDLE target_process = nullptr;
+#else
+    pid_t target_process = 0;
+#endif
+    const match_callback* current_callback = nullptr;
+    std::atomic<size_t> next_unit { 0 };
+    std::atomic<DWORD> next_worker { 0 };
+    std::atomic<bool> stop { false };
+    std::atomic<ULONGLONG> match_count { 0 };
+    std::atomic<ULONGLONG> scanned_bytes { 0 };
+};
+
+} // namespace mw
@@ -0,0 +1,271 @@
+#pragma once
+
+// 其他平台上没有Windows.h，这里定义可移植的头文件用到的Windows基本类型，常量和少数几个函数的替代，
+// 使它们(以及stdafx.h中的tzstring_view等)可以在Linux上编译和测试，见my_windows_linux_test。
+// 只有不依赖Win32 API的头文件(或者有其他平台的实现的头文件)才能在其他平台上使用，Windows上这个头文件是空的
+#ifndef _WIN32
+#    include <cerrno>
+#    include <cstddef>
+#    include <cstdint>
+#    include <ctime>
+#    include <execinfo.h>
+#    include <mutex>
+#    include <netdb.h>
+#    include <netinet/in.h>
+#    include <netinet/tcp.h>
+#    include <sched.h>
+#    include <shared_mutex>
+#    include <sys/socket.h>
+#    include <sys/syscall.h>
+#    include <unistd.h>
+
+using BOOL = int;
+using BYTE = std::uint8_t;
+using WORD = std::uint16_t;
+using DWORD = std::uint32_t;
+using LONG = std::int32_t;
+using ULONG = std::uint32_t;
+using USHORT = unsigned short;
+using UINT = unsigned int;
+using INT = int;
+using LONGLONG = std::int64_t;
+using ULONGLONG = std::uint64_t;
+using ULONG_PTR = std::uintptr_t;
+using DWORD_PTR = std::uintptr_t;
+using SIZE_T = std::size_t;
+using CHAR = char;
+using TCHAR = char;
+using PTSTR = TCHAR*;
+using LPTSTR = TCHAR*;
+using PCTSTR = const TCHAR*;
+using LPCTSTR = const TCHAR*;
+using PVOID = void*;
+using LPVOID = void*;
+using LPCVOID = const void*;
+using HANDLE = void*;
+
+#    define TRUE 1
+#    define FALSE 0
+#    define INFINITE 0xFFFFFFFF
+#    define ERROR_SUCCESS 0L
+#    define WAIT_TIMEOUT 258L
+#    define WAIT_FAILED 0xFFFFFFFF
+#    define _T(x) x
+
+// 内存区域的状态，类型和保护属性，与Windows的值相同，mw_memory_map.h从/proc/[pid]/maps换算出它们
+#    define MEM_COMMIT 0x1000
+#    define MEM_RESERVE 0x2000
+#    define MEM_FREE 0x10000
+#    define MEM_PRIVATE 0x20000
+#    define MEM_MAPPED 0x40000
+#    define MEM_IMAGE 0x1000000
+#    define PAGE_NOACCESS 0x01
+#    define PAGE_READONLY 0x02
+#    define PAGE_READWRITE 0x04
+#    define PAGE_WRITECOPY 0x08
+#    define PAGE_EXECUTE 0x10
+#    define PAGE_EXECUTE_READ 0x20
+#    define PAGE_EXECUTE_READWRITE 0x40
+#    define PAGE_EXECUTE_WRITECOPY 0x80
+#    define PAGE_GUARD 0x100
+
+/// <summary>
+/// 替代GetLastError，其他平台上的错误代码是errno，应该用mw::error::format_errno_into格式化
+/// </summary>
+inline DWORD GetLastError() noexcept { return static_cast<DWORD>(errno); }
+inline void SetLastError(DWORD error_code) noexcept { errno = static_cast<int>(error_code); }
+inline DWORD GetCurrentThreadId() noexcept { return static_cast<DWORD>(syscall(SYS_gettid)); }
+inline DWORD GetCurrentProcessId() noexcept { return static_cast<DWORD>(getpid()); }
+
+/// <summary>
+/// 替代GetTickCount64，CLOCK_MONOTONIC的毫秒数
+/// </summary>
+inline ULONGLONG GetTickCount64() noexcept
+{
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<ULONGLONG>(now.tv_sec) * 1000 + static_cast<ULONGLONG>(now.tv_nsec) / 1000000;
+}
+
+inline void Sleep(DWORD milliseconds) noexcept
+{
+    timespec duration = { static_cast<time_t>(milliseconds / 1000), static_cast<long>(milliseconds % 1000) * 1000000 };
+    while (nanosleep(&duration, &duration) == -1 && errno == EINTR)
+        ;
+}
+
+/// <summary>
+/// 替代SwitchToThread，让出处理器，返回是否有其他线程得到运行(sched_yield不报告这一点，总是返回TRUE)
+/// </summary>
+inline BOOL SwitchToThread() noexcept
+{
+    sched_yield();
+    return 1;
+}
+
+/// <summary>
+/// 替代GetCurrentProcessorNumber，sched_getcpu失败时返回0
+/// </summary>
+inline DWORD GetCurrentProcessorNumber() noexcept
+{
+    auto cpu = sched_getcpu();
+    return cpu < 0 ? 0 : static_cast<DWORD>(cpu);
+}
+
+inline void YieldProcessor() noexcept
+{
+#    if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#    endif
+}
+
+/// <summary>
+/// 替代RtlCaptureStackBackTrace，使用backtrace，哈希值与Windows相同，是所有返回地址的和
+/// </summary>
+inline WORD RtlCaptureStackBackTrace(DWORD frames_to_skip, DWORD frames_to_capture, PVOID* back_trace, ULONG* back_trace_hash) noexcept
+{
+    void* frames[64];
+    // 多跳过这个函数自身
+    auto skip = frames_to_skip + 1;
+    auto wanted = skip + frames_to_capture;
+    auto captured = backtrace(frames, static_cast<int>(wanted < 64 ? wanted : 64));
+    WORD depth = 0;
+    ULONG hash = 0;
+    for (auto i = static_cast<int>(skip); i < captured; i++)
+    {
+        back_trace[depth++] = frames[i];
+        hash += static_cast<ULONG>(reinterpret_cast<std::uintptr_t>(frames[i]));
+    }
+    if (back_trace_hash)
+        *back_trace_hash = hash;
+    return depth;
+}
+
+inline int _tcscpy_s(TCHAR* destination, size_t size, const TCHAR* source) noexcept
+{
+    if (!destination || !size || !source)
+        return EINVAL;
+    size_t i = 0;
+    for (; source[i] && i + 1 < size; i++)
+        destination[i] = source[i];
+    if (source[i])
+    {
+        // 与_tcscpy_s相同，缓冲区不够时输出空字符串
+        destination[0] = 0;
+        return ERANGE;
+    }
+    destination[i] = 0;
+    return 0;
+}
+
+// 互锁单向链表的替代，用互斥量保护，接口和语义(后进先出，QueryDepthSList返回元素数)与Windows相同
+#    define MEMORY_ALLOCATION_ALIGNMENT 16
+
+struct SLIST_ENTRY
+{
+    SLIST_ENTRY* Next;
+};
+using PSLIST_ENTRY = SLIST_ENTRY*;
+
+struct SLIST_HEADER
+{
+    std::mutex lock;
+    SLIST_ENTRY* head = nullptr;
+    USHORT depth = 0;
+};
+using PSLIST_HEADER = SLIST_HEADER*;
+
+inline void InitializeSListHead(PSLIST_HEADER list) noexcept
+{
+    std::lock_guard<std::mutex> guard(list->lock);
+    list->head = nullptr;
+    list->depth = 0;
+}
+
+inline PSLIST_ENTRY InterlockedPushEntrySList(PSLIST_HEADER list, PSLIST_ENTRY entry) noexcept
+{
+    std::lock_guard<std::mutex> guard(list->lock);
+    auto first = list->head;
+    entry->Next = first;
+    list->head = entry;
+    list->depth++;
+    return first;
+}
+
+inline PSLIST_ENTRY InterlockedPopEntrySList(PSLIST_HEADER list) noexcept
+{
+    std::lock_guard<std::mutex> guard(list->lock);
+    auto first = list->head;
+    if (first)
+    {
+        list->head = first->Next;
+        list->depth--;
+    }
+    return first;
+}
+
+inline USHORT QueryDepthSList(PSLIST_HEADER list) noexcept
+{
+    std::lock_guard<std::mutex> guard(list->lock);
+    return list->depth;
+}
+
+// 套接字的类型和常量，套接字就是文件描述符，错误代码是errno。WSABUF的成员与Windows相同，与iovec的布局不同，
+// 需要聚集读写时由使用者转换(见mw_tcp_server.h的epoll后端)
+using SOCKET = int;
+#    define INVALID_SOCKET (-1)
+#    define SOCKET_ERROR (-1)
+#    define SD_RECEIVE SHUT_RD
+#    define SD_SEND SHUT_WR
+#    define SD_BOTH SHUT_RDWR
+#    define WSAECONNRESET ECONNRESET
+#    define WSAECONNREFUSED ECONNREFUSED
+#    define WSAESHUTDOWN ESHUTDOWN
+#    define WSAETIMEDOUT ETIMEDOUT
+#    define WSAEWOULDBLOCK EWOULDBLOCK
+#    define WSAEINVAL EINVAL
+#    define WSAENOBUFS ENOBUFS
+
+struct WSABUF
+{
+    ULONG len;
+    CHAR* buf;
+};
+using LPWSABUF = WSABUF*;
+/// <summary>getaddrinfo的hints和结果，成员与Windows的ADDRINFOA相同</summary>
+using ADDRINFOT = addrinfo;
+
+inline int WSAGetLastError() noexcept { return errno; }
+inline void WSASetLastError(int error_code) noexcept { errno = error_code; }
+
+// mw_system.h和mw_thread.h中可移植的头文件用到的少数几个wrapper的替代，接口与它们相同
+namespace mw {
+
+/// <summary>
+/// 替代mw_system.h的get_system_time，CLOCK_MONOTONIC的毫秒数
+/// </summary>
+inline ULONGLONG get_system_time() noexcept { return GetTickCount64(); }
+
+namespace sync {
+
+    /// <summary>
+    /// 替代mw_thread.h的slimrw_lock，使用std::shared_mutex
+    /// </summary>
+    class slimrw_lock
+    {
+    public:
+        void acquire_exclusive() { lock.lock(); }
+        void acquire_shared() { lock.lock_shared(); }
+        void release_exclusive() { lock.unlock(); }
+        void release_shared() { lock.unlock_shared(); }
+        bool try_acquire_exclusive() { return lock.try_lock(); }
+        bool try_acquire_shared() { return lock.try_lock_shared(); }
+
+    private:
+        std::shared_mutex lock;
+    };
+
+} // namespace sync
+} // namespace mw
+
+#endif // !_WIN32
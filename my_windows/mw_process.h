@@ -1,4 +1,5 @@
 #pragma once
+#include "mw_handle.h"
 #include "mw_security.h"
 #include "mw_utility.h"
 #include <psapi.h>
@@ -55,8 +56,8 @@ struct process_info
 /// <param name="environment">环境块，默认值则与父进程相同</param>
 /// <param name="startup_info">启动信息</param>
 /// <returns>是否成功</returns>
-inline bool create_process(process_info& new_process_info, const std::tstring& command_line,
-    const std::tstring& process_work_dir = _T(""), BOOL inherit_handle = FALSE, DWORD creation_flags = 0,
+inline bool create_process(process_info& new_process_info, tzstring_view command_line,
+    tzstring_view process_work_dir = nullptr, BOOL inherit_handle = FALSE, DWORD creation_flags = 0,
     LPSECURITY_ATTRIBUTES process_attributes = nullptr,
     LPSECURITY_ATTRIBUTES thread_attributes = nullptr,
     LPVOID environment = nullptr, LPSTARTUPINFO startup_info = nullptr)
@@ -74,7 +75,7 @@ inline bool create_process(process_info& new_process_info, const std::tstring& c
 
     auto is_ok = CreateProcess(nullptr, temp_str, process_attributes,
         thread_attributes, inherit_handle, creation_flags,
-        environment, tstring_to_pointer(process_work_dir), startup_info, &proc);
+        environment, process_work_dir.get(), startup_info, &proc);
     GET_ERROR_MSG_OUTPUT();
     delete[] temp_str;
 
@@ -92,13 +93,13 @@ inline bool create_process(process_info& new_process_info, const std::tstring& c
 /// <param name="file">新进程可执行文件的路径</param>
 /// <param name="command_line">新进程的命令行(不包含可执行文件路径)</param>
 /// <returns>是否成功</returns>
-inline bool create_process_admin(const std::tstring& file, const std::tstring& command_line = TEXT(""))
+inline bool create_process_admin(tzstring_view file, tzstring_view command_line = nullptr)
 {
     SHELLEXECUTEINFO sei = { sizeof(SHELLEXECUTEINFO) };
     sei.lpVerb = _T("runas");
     sei.lpFile = file.c_str();
     sei.nShow = SW_SHOWNORMAL;
-    if (command_line != _T(""))
+    if (!command_line.empty())
         sei.lpParameters = command_line.c_str();
 
     auto val = ShellExecuteEx(&sei);
@@ -211,6 +212,15 @@ inline HANDLE open_process(DWORD process_id, bool inherit_handle = false, DWORD
     return val;
 }
 
+/// <summary>
+/// 与open_process相同，但返回unique_kernel_handle，析构时自动关闭
+/// </summary>
+template <typename... Args>
+inline unique_kernel_handle open_process(unique_tag, Args&&... args)
+{
+    return unique_kernel_handle(open_process(std::forward<Args>(args)...));
+}
+
 /// <summary>
 /// 获取指定进程的计时信息，单位为100纳秒(ns)，FILETIME为两个32位值组成(兼容32位程序)
 /// </summary>
@@ -0,0 +1,400 @@
+#pragma once
+#ifdef _WIN32
+#    include "mw_socket.h"
+#    include "mw_system.h"
+#    include "mw_thread.h"
+#    include <deque>
+#else
+// 其他平台上没有预编译头，直接包含它，得到std::tstring和Windows类型的替代(mw_platform.h)
+#    include "stdafx.h"
+#    include <condition_variable>
+#    include <mutex>
+#    include <system_error>
+#    include <thread>
+#endif
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <future>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+namespace mw::net {
+
+/// <summary>
+/// 解析得到的一个地址
+/// </summary>
+struct resolved_endpoint
+{
+    sockaddr_storage address = {};
+    int address_len = 0;
+    int family = AF_UNSPEC;
+    int socktype = 0;
+    int protocol = 0;
+
+    /// <summary>获取地址，可以直接传给socket_connect或tcp_server::connect</summary>
+    const sockaddr* get_address() const { return reinterpret_cast<const sockaddr*>(&address); }
+};
+
+/// <summary>
+/// 一次解析的结果
+/// </summary>
+struct resolve_result
+{
+    /// <summary>0表示成功，否则是get_address_info返回的Windows Socket错误代码(其他平台上是getaddrinfo返回的EAI_*)</summary>
+    int error = 0;
+    std::vector<resolved_endpoint> endpoints;
+};
+
+/// <summary>
+/// resolver的选项
+/// </summary>
+struct resolver_options
+{
+    /// <summary>成功结果的缓存时间(毫秒)，后端可以为每次查询指定不同的值</summary>
+    DWORD ttl = 60 * 1000;
+    /// <summary>失败结果的缓存时间(毫秒)，若为0则不缓存失败结果</summary>
+    DWORD negative_ttl = 5 * 1000;
+    /// <summary>最多缓存的条目数，超过时先删除过期的条目，再删除最早过期的条目</summary>
+    size_t max_entries = 4096;
+    /// <summary>传给get_address_info的hints</summary>
+    int family = AF_UNSPEC;
+    int socktype = SOCK_STREAM;
+    int protocol = IPPROTO_TCP;
+};
+
+/// <summary>
+/// resolver的统计信息
+/// </summary>
+struct resolver_stats
+{
+    /// <summary>resolve的调用次数</summary>
+    ULONGLONG requests = 0;
+    /// <summary>直接从缓存中得到已完成结果的次数</summary>
+    ULONGLONG cache_hits = 0;
+    /// <summary>加入了同一名字正在进行的查询，而没有发起新查询的次数</summary>
+    ULONGLONG joined = 0;
+    /// <summary>调用后端查询的次数</summary>
+    ULONGLONG lookups = 0;
+    /// <summary>后端查询失败(包括抛出异常)的次数</summary>
+    ULONGLONG failures = 0;
+    /// <summary>当前缓存的条目数(包括正在查询的)</summary>
+    size_t entries = 0;
+};
+
+/// <summary>
+/// 带缓存的异步地址解析器，查询在线程池中执行，结果以std::shared_future返回
+/// </summary>
+/// <remarks>
+/// 对同一(主机名，服务名)的并发查询只会调用一次后端，后来的调用者得到同一个future。
+/// 成功的结果缓存ttl毫秒，失败的结果缓存negative_ttl毫秒，期间的查询不会调用后端。
+///
+/// 后端默认调用get_address_info，可以在构造时替换成其他实现(例如测试用的假解析器，或者能得到真实TTL的DNS查询)。
+/// 后端在线程池中被调用，多次调用可能同时执行。后端抛出的异常会通过future重新抛出，这样的结果不被缓存。
+/// 析构函数会等待所有已提交的查询完成，所以future总是会得到结果或异常
+///
+/// 其他平台上每次查询在一个新线程中执行，默认后端调用getaddrinfo
+/// </remarks>
+class resolver
+{
+public:
+    /// <summary>
+    /// 查询后端
+    /// </summary>
+    /// <remarks>
+    /// 参数依次是主机名，服务名，hints，[out]接收地址的数组，[out]结果的缓存时间(调用前已经设为resolver_options::ttl，后端可以修改)。
+    /// 返回0表示成功，否则返回错误代码。抛出的异常会交给等待这次查询的所有future
+    /// </remarks>
+    using backend = std::function<int(const std::tstring&, const std::tstring&, const ADDRINFOT&, std::vector<resolved_endpoint>&, DWORD&)>;
+
+    /// <param name="options">解析器的选项</param>
+    /// <param name="lookup">[opt]查询后端，若为空则使用system_lookup</param>
+    explicit resolver(const resolver_options& options = resolver_options(), backend lookup = backend())
+        : options(options)
+        , lookup(lookup ? std::move(lookup) : backend(system_lookup))
+    {
+#ifdef _WIN32
+        work = mw::create_threadpool_work(work_callback, this);
+#endif
+    }
+    ~resolver()
+    {
+#ifdef _WIN32
+        if (work)
+        {
+            mw::wait_for_threadpool_work_callbacks(work, false);
+            mw::close_threadpool_work(work);
+        }
+#else
+        std::unique_lock<std::mutex> lock(workers_lock);
+        workers_idle.wait(lock, [this] { return running_workers == 0; });
+#endif
+    }
+    resolver(const resolver&) = delete;
+    resolver(resolver&&) = delete;
+    resolver& operator=(const resolver&) = delete;
+    resolver& operator=(resolver&&) = delete;
+
+public:
+    /// <summary>
+    /// 异步解析主机名，若缓存中有未过期的结果或正在进行的查询，直接返回它们的future
+    /// </summary>
+    /// <param name="node_name">主机名或数字地址字符串，含义同get_address_info</param>
+    /// <param name="service_name">服务名或端口数字字符串，含义同get_address_info</param>
+    /// <returns>解析结果的future，多个调用者可以同时等待它</returns>
+    std::shared_future<resolve_result> resolve(const std::tstring& node_name, const std::tstring& service_name)
+    {
+        auto key = node_name;
+        key.push_back(_T('\0'));
+        key.append(service_name);
+
+        cache_lock.acquire_exclusive();
+        statistics.requests++;
+        auto now = mw::get_system_time();
+        auto it = cache.find(key);
+        if (it != cache.end() && (it->second.pending || now < it->second.expire_time))
+        {
+            (it->second.pending ? statistics.joined : statistics.cache_hits)++;
+            auto result = it->second.result;
+            cache_lock.release_exclusive();
+            return result;
+        }
+
+        auto job = new lookup_job { key, node_name, service_name, ++last_generation, {} };
+        auto& entry = cache[key];
+        entry.result = job->promise.get_future().share();
+        entry.expire_time = (std::numeric_limits<ULONGLONG>::max)();
+        entry.generation = job->generation;
+        entry.pending = true;
+        auto result = entry.result;
+        evict(now);
+
+#ifdef _WIN32
+        if (work)
+            jobs.push_back(job);
+        cache_lock.release_exclusive();
+
+        // 线程池工作项创建失败时在当前线程查询，保证future总是会得到结果
+        if (work)
+            mw::submit_threadpool_work(work);
+        else
+            run(job);
+#else
+        cache_lock.release_exclusive();
+        submit(job);
+#endif
+        return result;
+    }
+
+    /// <summary>
+    /// 删除所有已完成的缓存条目，正在进行的查询不受影响(它们的结果仍然会被缓存)
+    /// </summary>
+    void clear()
+    {
+        cache_lock.acquire_exclusive();
+        for (auto it = cache.begin(); it != cache.end();)
+            it = it->second.pending ? ++it : cache.erase(it);
+        cache_lock.release_exclusive();
+    }
+
+    /// <summary>
+    /// 获取统计信息
+    /// </summary>
+    resolver_stats stats()
+    {
+        cache_lock.acquire_shared();
+        auto result = statistics;
+        result.entries = cache.size();
+        cache_lock.release_shared();
+        return result;
+    }
+
+    const resolver_options& get_options() const { return options; }
+
+    /// <summary>
+    /// 默认的查询后端，调用get_address_info(其他平台上是getaddrinfo)并复制得到的地址
+    /// </summary>
+    static int system_lookup(const std::tstring& node_name, const std::tstring& service_name, const ADDRINFOT& hints,
+        std::vector<resolved_endpoint>& endpoints, DWORD&)
+    {
+        ADDRINFOT* address_info = nullptr;
+#ifdef _WIN32
+        auto error = mw::socket::get_address_info(node_name, service_name, hints, address_info);
+#else
+        auto error = getaddrinfo(node_name.c_str(), service_name.c_str(), &hints, &address_info);
+#endif
+        if (error)
+            return error;
+
+        for (auto info = address_info; info; info = info->ai_next)
+        {
+            if (info->ai_addrlen > sizeof(sockaddr_storage))
+                continue;
+            resolved_endpoint endpoint;
+            std::memcpy(&endpoint.address, info->ai_addr, info->ai_addrlen);
+            endpoint.address_len = static_cast<int>(info->ai_addrlen);
+            endpoint.family = info->ai_family;
+            endpoint.socktype = info->ai_socktype;
+            endpoint.protocol = info->ai_protocol;
+            endpoints.push_back(endpoint);
+        }
+#ifdef _WIN32
+        mw::socket::free_address_info(address_info);
+#else
+        freeaddrinfo(address_info);
+#endif
+        return 0;
+    }
+
+private:
+    struct cache_entry
+    {
+        std::shared_future<resolve_result> result;
+        ULONGLONG expire_time = 0;
+        /// <summary>用于在查询完成时确认条目没有被删除后重新创建</summary>
+        ULONGLONG generation = 0;
+        bool pending = false;
+    };
+
+    struct lookup_job
+    {
+        std::tstring key;
+        std::tstring node_name;
+        std::tstring service_name;
+        ULONGLONG generation;
+        std::promise<resolve_result> promise;
+    };
+
+    /// <summary>
+    /// 条目数超过max_entries时删除条目，正在进行的查询不会被删除，调用者需持有cache_lock
+    /// </summary>
+    void evict(ULONGLONG now)
+    {
+        if (cache.size() <= options.max_entries)
+            return;
+        for (auto it = cache.begin(); it != cache.end();)
+            it = !it->second.pending && now >= it->second.expire_time ? cache.erase(it) : ++it;
+
+        while (cache.size() > options.max_entries)
+        {
+            auto oldest = cache.end();
+            for (auto it = cache.begin(); it != cache.end(); ++it)
+            {
+                if (!it->second.pending && (oldest == cache.end() || it->second.expire_time < oldest->second.expire_time))
+                    oldest = it;
+            }
+            if (oldest == cache.end())
+                break;
+            cache.erase(oldest);
+        }
+    }
+
+    void run(lookup_job* job)
+    {
+        ADDRINFOT hints = {};
+        hints.ai_family = options.family;
+        hints.ai_socktype = options.socktype;
+        hints.ai_protocol = options.protocol;
+
+        resolve_result result;
+        DWORD ttl = options.ttl;
+        std::exception_ptr exception;
+        try
+        {
+            result.error = lookup(job->node_name, job->service_name, hints, result.endpoints, ttl);
+        }
+        catch (...)
+        {
+            // 异常不是查询的结果，不缓存，下次resolve重新查询
+            exception = std::current_exception();
+            ttl = 0;
+        }
+        if (result.error)
+            ttl = options.negative_ttl;
+
+        cache_lock.acquire_exclusive();
+        statistics.lookups++;
+        if (result.error || exception)
+            statistics.failures++;
+        auto it = cache.find(job->key);
+        if (it != cache.end() && it->second.generation == job->generation)
+        {
+            if (ttl)
+            {
+                it->second.expire_time = mw::get_system_time() + ttl;
+                it->second.pending = false;
+            }
+            else
+                cache.erase(it);
+        }
+        cache_lock.release_exclusive();
+
+        if (exception)
+            job->promise.set_exception(exception);
+        else
+            job->promise.set_value(std::move(result));
+        delete job;
+    }
+
+#ifdef _WIN32
+
+    static void CALLBACK work_callback(PTP_CALLBACK_INSTANCE, PVOID param, PTP_WORK)
+    {
+        auto self = static_cast<resolver*>(param);
+        self->cache_lock.acquire_exclusive();
+        auto job = self->jobs.front();
+        self->jobs.pop_front();
+        self->cache_lock.release_exclusive();
+        self->run(job);
+    }
+#else
+    /// <summary>
+    /// 在新线程中查询，无法创建线程时在当前线程查询，保证future总是会得到结果
+    /// </summary>
+    void submit(lookup_job* job)
+    {
+        {
+            std::lock_guard<std::mutex> guard(workers_lock);
+            running_workers++;
+        }
+        try
+        {
+            std::thread([this, job] {
+                run(job);
+                worker_done();
+            }).detach();
+        }
+        catch (const std::system_error&)
+        {
+            run(job);
+            worker_done();
+        }
+    }
+
+    void worker_done()
+    {
+        std::lock_guard<std::mutex> guard(workers_lock);
+        if (--running_workers == 0)
+            workers_idle.notify_all();
+    }
+#endif
+
+    resolver_options options;
+    backend lookup;
+#ifdef _WIN32
+    PTP_WORK work = nullptr;
+    std::deque<lookup_job*> jobs;
+#else
+    std::mutex workers_lock;
+    std::condition_variable workers_idle;
+    size_t running_workers = 0;
+#endif
+
+    mw::sync::slimrw_lock cache_lock;
+    std::unordered_map<std::tstring, cache_entry> cache;
+    ULONGLONG last_generation = 0;
+    resolver_stats statistics;
+};
+
+} // namespace mw::net
@@ -48,7 +48,7 @@ inline HANDLE load_internal_image(HINSTANCE handle_modlue,
 /// <param name="is_transparent">是否透明，若图像颜色深度大于8不要使用此选项</param>
 /// <param name="is_shared">是否共享，类似shared_ptr，当没有使用该资源时系统自动回收</param>
 /// <returns>若成功，返回对应图像的句柄，否则返回NULL</returns>
-inline HANDLE load_external_image(const std::tstring& file_path, UINT type,
+inline HANDLE load_external_image(tzstring_view file_path, UINT type,
     int image_x, int image_y, bool is_default_size = false, bool is_monochrome = false,
     bool is_transparent = false, bool is_shared = true)
 {
@@ -57,7 +57,7 @@ public:
     /// </summary>
     /// <param name="boundary_name">边界名字</param>
     /// <param name="namespace_name">专有空间名字</param>
-    private_namespace(const std::tstring& boundary_name, const std::tstring& namespace_name)
+    private_namespace(tzstring_view boundary_name, tzstring_view namespace_name)
     {
         boundary_handle = CreateBoundaryDescriptor(boundary_name.c_str(), 0);
         auto admin_sid = create_admin_sid();
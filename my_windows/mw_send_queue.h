@@ -0,0 +1,272 @@
+#pragma once
+#include "mw_buffer_pool.h"
+#ifdef _WIN32
+#    include "mw_socket.h"
+#endif
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace mw::net {
+
+/// <summary>
+/// send_queue的选项
+/// </summary>
+struct send_queue_options
+{
+    /// <summary>等待发送的字节数达到它时立即发送，若为0则不合并，每次写入后都尽快发送</summary>
+    size_t flush_threshold = 16 * 1024;
+    /// <summary>合并小写入的最长等待毫秒数，若为0则在当前事件循环轮次结束时发送</summary>
+    DWORD flush_delay = 0;
+    /// <summary>高水位，等待发送和正在发送的字节数之和不能超过它，超过时写入失败，调用者应暂停产生数据</summary>
+    size_t high_water_mark = 128 * 1024;
+};
+
+/// <summary>
+/// 合并小写入的发送队列，多次写入被收集到缓冲区池的块中，然后用一次聚集的WSASend发送
+/// </summary>
+/// <remarks>
+/// 队列分为两部分：正在排队的数据和已经交给WSASend但还未完成的数据，同一时刻最多有一个发送在进行。
+/// prepare_send把排队的数据移动到正在发送的部分并生成WSABUF数组，send_completed释放已发送的块。
+/// 何时发送由使用者决定(tcp_server在每一轮完成数据包处理完毕后，或flush_delay到期后发送)，队列本身只提供should_flush等判断。
+///
+/// 小写入被复制到队列自己从池中获取的块中(一个块可以容纳多次写入)，write(buffer_ref...)则直接引用调用者的块而不复制。
+/// 两部分的vector在交换时保留容量，稳定状态下不会分配内存。队列不是线程安全的
+/// </remarks>
+class send_queue
+{
+public:
+    /// <summary>
+    /// 队列中的一段数据，它引用缓冲区池中的一个块
+    /// </summary>
+    struct segment
+    {
+        buffer_ref buffer;
+        size_t offset = 0;
+        size_t size = 0;
+        /// <summary>块由队列自己获取，之后的小写入可以继续复制到其中</summary>
+        bool writable = false;
+    };
+
+    send_queue(const send_queue&) = delete;
+    send_queue(send_queue&&) = delete;
+    send_queue& operator=(const send_queue&) = delete;
+    send_queue& operator=(send_queue&&) = delete;
+
+public:
+    /// <param name="pool">复制小写入时使用的缓冲区池，它必须比队列存活得更久</param>
+    /// <param name="options">队列的选项</param>
+    explicit send_queue(buffer_pool& pool, const send_queue_options& options = send_queue_options())
+        : pool(&pool)
+        , options(options)
+    {
+    }
+
+    /// <summary>
+    /// 把数据复制到队列中
+    /// </summary>
+    /// <param name="data">要发送的数据</param>
+    /// <param name="size">数据的字节数</param>
+    /// <returns>若超过高水位，或缓冲区池已耗尽(此时不会复制任何数据)，返回false</returns>
+    bool write(const void* data, size_t size)
+    {
+        if (size > capacity_left())
+            return false;
+
+        auto segment_count = queued.size();
+        auto tail_size = segment_count ? queued.back().size : 0;
+        if (!append(static_cast<const char*>(data), size))
+        {
+            undo(segment_count, tail_size);
+            return false;
+        }
+        queued_size += size;
+        return true;
+    }
+
+    /// <summary>
+    /// 把多段数据作为一个整体复制到队列中，它们要么全部被复制，要么都不被复制，用于把一个响应的多个部分一起写入
+    /// </summary>
+    /// <param name="buffers">要发送的数据的数组</param>
+    /// <param name="count">数组的元素数量</param>
+    /// <returns>若总字节数超过高水位，或缓冲区池已耗尽(此时不会复制任何数据)，返回false</returns>
+    bool write(const WSABUF* buffers, DWORD count)
+    {
+        size_t size = 0;
+        for (DWORD i = 0; i < count; i++)
+            size += buffers[i].len;
+        if (size > capacity_left())
+            return false;
+
+        auto segment_count = queued.size();
+        auto tail_size = segment_count ? queued.back().size : 0;
+        for (DWORD i = 0; i < count; i++)
+        {
+            if (!append(buffers[i].buf, buffers[i].len))
+            {
+                undo(segment_count, tail_size);
+                return false;
+            }
+        }
+        queued_size += size;
+        return true;
+    }
+
+    /// <summary>
+    /// 不复制数据，直接把块的一部分放入队列，发送完成后释放对块的引用
+    /// </summary>
+    /// <param name="buffer">要发送的块，在发送完成之前不应修改其中的数据</param>
+    /// <param name="offset">数据在块中的偏移</param>
+    /// <param name="size">数据的字节数，offset + size不能超过块的有效字节数</param>
+    /// <returns>若超过高水位，或参数不合法，返回false</returns>
+    bool write(buffer_ref buffer, size_t offset, size_t size)
+    {
+        if (!buffer || size > capacity_left() || offset + size > buffer.size())
+            return false;
+        if (!size)
+            return true;
+        queued.push_back({ std::move(buffer), offset, size, false });
+        queued_size += size;
+        return true;
+    }
+
+    /// <summary>
+    /// 把排队的数据移动到正在发送的部分，并生成聚集发送用的WSABUF数组
+    /// </summary>
+    /// <param name="buffers">[out]接收WSABUF数组，在send_completed之前有效</param>
+    /// <param name="count">[out]接收WSABUF数组的元素数量</param>
+    /// <returns>若没有排队的数据，或已经有一个发送在进行，返回false</returns>
+    bool prepare_send(LPWSABUF& buffers, DWORD& count)
+    {
+        if (sending_size || !queued_size)
+            return false;
+        std::swap(queued, sending);
+        sending_size = queued_size;
+        queued_size = 0;
+
+        wsabufs.clear();
+        for (auto& segment : sending)
+            wsabufs.push_back(segment.buffer.to_wsabuf(segment.offset, segment.size));
+        buffers = wsabufs.data();
+        count = static_cast<DWORD>(wsabufs.size());
+        return true;
+    }
+
+    /// <summary>
+    /// 发送完成(或失败)后调用，释放正在发送的部分引用的块
+    /// </summary>
+    /// <returns>正在发送的字节数，用于和实际发送的字节数比较</returns>
+    size_t send_completed()
+    {
+        auto size = sending_size;
+        sending.clear();
+        sending_size = 0;
+        return size;
+    }
+
+    /// <summary>
+    /// 丢弃排队的数据(正在发送的部分不受影响)
+    /// </summary>
+    void discard()
+    {
+        queued.clear();
+        queued_size = 0;
+    }
+
+#ifdef _WIN32
+    /// <summary>
+    /// 把排队的数据用一次聚集的WSASend发送到套接字
+    /// </summary>
+    /// <remarks>
+    /// 若overlapped为nullptr，则是阻塞发送，函数返回时发送已经完成，不需要再调用send_completed。
+    /// 否则是重叠发送，发送完成后需要调用send_completed
+    /// </remarks>
+    /// <param name="socket">已连接的套接字</param>
+    /// <param name="overlapped">[opt]重叠I/O使用的OVERLAPPED</param>
+    /// <returns>若成功(包括重叠I/O正在进行)或没有数据需要发送，返回0，否则返回SOCKET_ERROR，使用WSAGetLastError获取错误代码</returns>
+    int flush(SOCKET socket, LPWSAOVERLAPPED overlapped = nullptr)
+    {
+        LPWSABUF buffers = nullptr;
+        DWORD count = 0;
+        if (!prepare_send(buffers, count))
+            return 0;
+
+        DWORD bytes = 0;
+        auto result = mw::socket::socket_send_asyn(socket, buffers, count, overlapped ? nullptr : &bytes, 0, overlapped);
+        if (result == SOCKET_ERROR && overlapped && WSAGetLastError() == WSA_IO_PENDING)
+            return 0;
+        if (result == SOCKET_ERROR || !overlapped)
+            send_completed();
+        return result == SOCKET_ERROR ? SOCKET_ERROR : 0;
+    }
+#endif
+
+    /// <summary>排队等待发送的字节数</summary>
+    size_t queued_bytes() const { return queued_size; }
+    /// <summary>已经交给WSASend但还未完成的字节数</summary>
+    size_t sending_bytes() const { return sending_size; }
+    /// <summary>排队和正在发送的总字节数</summary>
+    size_t pending_bytes() const { return queued_size + sending_size; }
+    /// <summary>在达到高水位之前还可以写入的字节数</summary>
+    size_t capacity_left() const
+    {
+        return pending_bytes() < options.high_water_mark ? options.high_water_mark - pending_bytes() : 0;
+    }
+    /// <summary>是否有一个发送在进行</summary>
+    bool is_sending() const { return sending_size != 0; }
+    /// <summary>排队的数据是否已经达到flush_threshold，应该立即发送</summary>
+    bool should_flush() const { return queued_size && queued_size >= options.flush_threshold; }
+    /// <summary>是否合并小写入，即flush_threshold不为0</summary>
+    bool is_coalescing() const { return options.flush_threshold != 0; }
+
+    const send_queue_options& get_options() const { return options; }
+    void set_options(const send_queue_options& new_options) { options = new_options; }
+
+private:
+    /// <summary>
+    /// 把数据复制到队列末尾的可写块中，块满时从池中获取新块
+    /// </summary>
+    /// <returns>若缓冲区池已耗尽，返回false，此时已经复制的部分由调用者撤销</returns>
+    bool append(const char* source, size_t size)
+    {
+        for (auto left = size; left;)
+        {
+            if (queued.empty() || !queued.back().writable
+                || queued.back().offset + queued.back().size == queued.back().buffer.capacity())
+            {
+                auto buffer = pool->acquire();
+                if (!buffer)
+                    return false;
+                queued.push_back({ std::move(buffer), 0, 0, true });
+            }
+            auto& tail = queued.back();
+            auto copy = (std::min)(left, tail.buffer.capacity() - tail.offset - tail.size);
+            std::memcpy(tail.buffer.data() + tail.offset + tail.size, source, copy);
+            tail.size += copy;
+            source += copy;
+            left -= copy;
+        }
+        return true;
+    }
+
+    /// <summary>
+    /// 撤销一次写入中已经复制的部分，恢复到写入之前的段数和最后一段的大小
+    /// </summary>
+    void undo(size_t segment_count, size_t tail_size)
+    {
+        while (queued.size() > segment_count)
+            queued.pop_back();
+        if (segment_count)
+            queued.back().size = tail_size;
+    }
+
+    buffer_pool* pool;
+    send_queue_options options;
+    std::vector<segment> queued;
+    size_t queued_size = 0;
+    std::vector<segment> sending;
+    size_t sending_size = 0;
+    std::vector<WSABUF> wsabufs;
+};
+
+} // namespace mw::net
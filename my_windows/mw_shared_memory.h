@@ -0,0 +1,1307 @@
+#pragma once
+#ifdef _WIN32
+#    include "mw_device.h"
+#    include "mw_memory.h"
+#    include "mw_thread.h"
+#else
+// 堆跟踪的钩子由Windows上的stdafx.h定义，其他平台上的共享容器不通知堆跟踪器
+#    ifndef MW_TRACK_HEAP_ALLOC
+#        define MW_TRACK_HEAP_ALLOC(address, bytes)
+#        define MW_TRACK_HEAP_FREE(address)
+#    endif
+#endif
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <new>
+#include <sstream>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+namespace mw {
+
+/// <summary>
+/// 位置无关的指针，它存储的是目标地址相对于指针自身地址的偏移量，而不是完整的地址空间地址
+/// </summary>
+/// <remarks>
+/// 它是example_6_4中__based的可移植版本，但不需要全局的基地址变量：只要指针本身和它指向的对象位于同一个映射视图中，
+/// 那么无论该视图被映射到哪个进程的哪个基地址，偏移量都是相同的，因此两个进程可以在不同地址映射同一个共享段并直接使用它。
+///
+/// 偏移量1被保留用于表示空指针(对象不可能位于指针自身地址+1的位置，因为对象至少按1字节对齐并且不会与指针重叠)
+///
+/// 注意，复制一个offset_ptr会按新位置重新计算偏移量，所以不要使用memcpy复制包含offset_ptr的对象。
+/// 偏移量总是64位并按8字节对齐，所以32位和64位进程中offset_ptr的大小和布局相同，可以共享同一个段
+/// </remarks>
+/// <typeparam name="T">指向的对象类型</typeparam>
+template <typename T>
+class offset_ptr
+{
+public:
+    using element_type = T;
+    using pointer = T*;
+    using reference = std::add_lvalue_reference_t<T>;
+    using difference_type = std::ptrdiff_t;
+    using value_type = std::remove_cv_t<T>;
+    using iterator_category = std::random_access_iterator_tag;
+
+    offset_ptr() noexcept : offset(null_offset) { }
+    offset_ptr(std::nullptr_t) noexcept : offset(null_offset) { }
+    offset_ptr(T* raw) noexcept { set(raw); }
+    offset_ptr(const offset_ptr& _t) noexcept { set(_t.get()); }
+    template <typename U, typename = std::enable_if_t<std::is_convertible_v<U*, T*>>>
+    offset_ptr(const offset_ptr<U>& _t) noexcept
+    {
+        set(_t.get());
+    }
+
+    offset_ptr& operator=(const offset_ptr& _t) noexcept
+    {
+        set(_t.get());
+        return *this;
+    }
+    offset_ptr& operator=(T* raw) noexcept
+    {
+        set(raw);
+        return *this;
+    }
+    offset_ptr& operator=(std::nullptr_t) noexcept
+    {
+        offset = null_offset;
+        return *this;
+    }
+
+public:
+    /// <summary>
+    /// 获取该指针在当前进程地址空间中的原生指针
+    /// </summary>
+    /// <returns>原生指针，若为空指针则返回nullptr</returns>
+    T* get() const noexcept
+    {
+        if (offset == null_offset)
+            return nullptr;
+        return reinterpret_cast<T*>(reinterpret_cast<std::intptr_t>(this) + static_cast<std::intptr_t>(offset));
+    }
+
+    reference operator*() const noexcept { return *get(); }
+    T* operator->() const noexcept { return get(); }
+    reference operator[](difference_type index) const noexcept { return get()[index]; }
+    explicit operator bool() const noexcept { return offset != null_offset; }
+
+    offset_ptr& operator+=(difference_type n) noexcept
+    {
+        set(get() + n);
+        return *this;
+    }
+    offset_ptr& operator-=(difference_type n) noexcept
+    {
+        set(get() - n);
+        return *this;
+    }
+    offset_ptr& operator++() noexcept { return *this += 1; }
+    offset_ptr& operator--() noexcept { return *this -= 1; }
+    offset_ptr operator++(int) noexcept
+    {
+        offset_ptr temp(*this);
+        ++*this;
+        return temp;
+    }
+    offset_ptr operator--(int) noexcept
+    {
+        offset_ptr temp(*this);
+        --*this;
+        return temp;
+    }
+
+    friend offset_ptr operator+(const offset_ptr& ptr, difference_type n) noexcept { return offset_ptr(ptr.get() + n); }
+    friend offset_ptr operator-(const offset_ptr& ptr, difference_type n) noexcept { return offset_ptr(ptr.get() - n); }
+    friend difference_type operator-(const offset_ptr& left, const offset_ptr& right) noexcept { return left.get() - right.get(); }
+
+    friend bool operator==(const offset_ptr& left, const offset_ptr& right) noexcept { return left.get() == right.get(); }
+    friend bool operator!=(const offset_ptr& left, const offset_ptr& right) noexcept { return left.get() != right.get(); }
+    friend bool operator<(const offset_ptr& left, const offset_ptr& right) noexcept { return left.get() < right.get(); }
+    friend bool operator==(const offset_ptr& left, std::nullptr_t) noexcept { return !left; }
+    friend bool operator!=(const offset_ptr& left, std::nullptr_t) noexcept { return static_cast<bool>(left); }
+
+private:
+    static constexpr std::int64_t null_offset = 1;
+
+    void set(T* raw) noexcept
+    {
+        offset = raw ? static_cast<std::int64_t>(reinterpret_cast<std::intptr_t>(raw) - reinterpret_cast<std::intptr_t>(this)) : null_offset;
+    }
+
+    alignas(8) std::int64_t offset;
+};
+
+/// <summary>
+/// 共享段头部，它位于共享段的偏移0处，所有的分配状态都保存在这里，因此共享段在任何进程中都是自描述的
+/// </summary>
+/// <remarks>
+/// 分配器是无锁的：每个尺寸等级有一个带ABA标签的单向空闲链表(Treiber栈)，空闲链表为空时从段尾部原子地递增分配。
+/// 尺寸等级为32*2^k和48*2^k(包括16字节的块头)，因此内部碎片最多约为33%。
+/// 已释放的块只会被同一尺寸等级复用，不会被合并或归还给段尾部。
+/// 头部和共享容器只使用固定宽度的字段，32位和64位进程可以打开同一个段
+/// </remarks>
+struct shared_segment_header
+{
+    /// <summary>块头大小，同时也是返回内存的对齐值</summary>
+    static constexpr std::uint64_t block_header_size = 16;
+    /// <summary>尺寸等级数量</summary>
+    static constexpr std::uint32_t class_count = 64;
+    /// <summary>命名对象目录的条目数量</summary>
+    static constexpr std::uint32_t directory_count = 64;
+    /// <summary>命名对象名字的最大长度(包括结尾的0)</summary>
+    static constexpr std::uint32_t max_name_length = 48;
+    static constexpr std::uint64_t magic_value = 0x544E454D4745534DULL; // "MSEGMENT"
+    static constexpr std::uint32_t current_version = 1;
+
+    enum : std::uint32_t
+    {
+        state_uninitialized = 0,
+        state_initializing = 1,
+        state_ready = 2
+    };
+
+    /// <summary>
+    /// 块头，位于每个返回给用户的内存之前
+    /// </summary>
+    struct block_header
+    {
+        std::uint32_t size_class;
+        std::uint32_t reserved;
+        std::atomic<std::uint64_t> next_free;
+    };
+
+    /// <summary>
+    /// 命名对象目录项
+    /// </summary>
+    struct directory_entry
+    {
+        char name[max_name_length];
+        std::uint64_t object_offset;
+        std::uint64_t object_size;
+    };
+
+    std::uint64_t magic;
+    std::uint32_t version;
+    std::atomic<std::uint32_t> state;
+    std::uint64_t segment_size;
+    std::atomic<std::uint64_t> bump_offset;
+    std::atomic<std::uint64_t> free_lists[class_count];
+    /// <summary>以前的版本用作目录的自旋锁，现在目录由shared_segment的命名互斥量保护，总是0</summary>
+    std::uint32_t reserved;
+    std::uint32_t directory_used;
+    directory_entry directory[directory_count];
+
+    static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "shared segment requires lock-free 64-bit atomics");
+    static_assert(sizeof(directory_entry) == 64, "directory entries must have the same layout in 32-bit and 64-bit processes");
+
+public:
+    /// <summary>
+    /// 在一块已清零的内存上初始化共享段头部
+    /// </summary>
+    /// <param name="size">共享段的总大小(字节)</param>
+    void initialize(std::uint64_t size) noexcept
+    {
+        magic = magic_value;
+        version = current_version;
+        segment_size = size;
+        bump_offset.store(align_up(sizeof(shared_segment_header)), std::memory_order_relaxed);
+        for (auto& list : free_lists)
+            list.store(0, std::memory_order_relaxed);
+        reserved = 0;
+        directory_used = 0;
+    }
+
+    /// <summary>
+    /// 该头部是否是一个可用的共享段头部
+    /// </summary>
+    /// <returns>魔数和版本是否匹配</returns>
+    bool is_valid() const noexcept
+    {
+        return magic == magic_value && version == current_version;
+    }
+
+    /// <summary>
+    /// 从共享段中分配一块内存，该函数是无锁的，可以被多个进程的多个线程同时调用
+    /// </summary>
+    /// <param name="bytes">要分配的字节数</param>
+    /// <returns>若成功，返回相对于段基地址的偏移量(按16字节对齐)，若段已耗尽返回0</returns>
+    std::uint64_t allocate(std::uint64_t bytes) noexcept
+    {
+        // 超过段大小的请求一定失败，同时避免bytes + block_header_size溢出
+        if (bytes > segment_size)
+            return 0;
+        auto size_class = class_index(bytes + block_header_size);
+        if (size_class >= class_count)
+            return 0;
+
+        // 先从该尺寸等级的空闲链表中弹出一个块
+        auto& list = free_lists[size_class];
+        auto head = list.load(std::memory_order_acquire);
+        while (head & offset_mask)
+        {
+            auto block_offset = (head & offset_mask) << 4;
+            auto next = block_at(block_offset)->next_free.load(std::memory_order_relaxed);
+            auto new_head = ((head & ~offset_mask) + tag_increment) | (next & offset_mask);
+            if (list.compare_exchange_weak(head, new_head, std::memory_order_acquire, std::memory_order_acquire))
+                return block_offset + block_header_size;
+        }
+
+        // 空闲链表为空，从段尾部分配。只有放得下时才推进bump_offset，
+        // 否则一次失败的大请求会使它永久越过段尾，之后所有较小的请求也都失败
+        auto block_size = class_size(size_class);
+        auto block_offset = bump_offset.load(std::memory_order_relaxed);
+        do {
+            if (block_offset + block_size > segment_size)
+                return 0;
+        } while (!bump_offset.compare_exchange_weak(block_offset, block_offset + block_size, std::memory_order_relaxed, std::memory_order_relaxed));
+
+        auto block = block_at(block_offset);
+        block->size_class = size_class;
+        block->reserved = 0;
+        block->next_free.store(0, std::memory_order_relaxed);
+        return block_offset + block_header_size;
+    }
+
+    /// <summary>
+    /// 释放一块由allocate分配的内存，该函数是无锁的
+    /// </summary>
+    /// <param name="offset">allocate返回的偏移量，若为0则不做任何事</param>
+    void deallocate(std::uint64_t offset) noexcept
+    {
+        if (offset == 0)
+            return;
+
+        auto block_offset = offset - block_header_size;
+        auto block = block_at(block_offset);
+        auto& list = free_lists[block->size_class];
+        auto head = list.load(std::memory_order_relaxed);
+        std::uint64_t new_head = 0;
+        do {
+            block->next_free.store(head & offset_mask, std::memory_order_relaxed);
+            new_head = ((head & ~offset_mask) + tag_increment) | (block_offset >> 4);
+        } while (!list.compare_exchange_weak(head, new_head, std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    /// <summary>
+    /// 获取指定偏移量所在块的可用大小
+    /// </summary>
+    /// <param name="offset">allocate返回的偏移量</param>
+    /// <returns>该块实际可用的字节数(大于等于请求的字节数)</returns>
+    std::uint64_t usable_size(std::uint64_t offset) const noexcept
+    {
+        auto block = reinterpret_cast<const block_header*>(base() + offset - block_header_size);
+        return class_size(block->size_class) - block_header_size;
+    }
+
+    /// <summary>
+    /// 获取段尾部尚未被分配过的字节数(不包括空闲链表中的块)
+    /// </summary>
+    /// <returns>尚未被分配的字节数</returns>
+    std::uint64_t unallocated_bytes() const noexcept
+    {
+        auto used = bump_offset.load(std::memory_order_relaxed);
+        return used >= segment_size ? 0 : segment_size - used;
+    }
+
+    char* base() noexcept { return reinterpret_cast<char*>(this); }
+    const char* base() const noexcept { return reinterpret_cast<const char*>(this); }
+
+    /// <summary>
+    /// 获取指定尺寸等级的块大小(包括块头)
+    /// </summary>
+    static constexpr std::uint64_t class_size(std::uint32_t size_class) noexcept
+    {
+        return ((size_class & 1) ? 48ULL : 32ULL) << (size_class >> 1);
+    }
+
+    /// <summary>
+    /// 获取能容纳指定块大小(包括块头)的最小尺寸等级
+    /// </summary>
+    static std::uint32_t class_index(std::uint64_t block_bytes) noexcept
+    {
+        if (block_bytes <= 32)
+            return 0;
+        auto p = highest_bit(block_bytes - 1); // 2^p < block_bytes <= 2^(p+1)
+        if (block_bytes <= (3ULL << (p - 1)))
+            return 2 * (p - 5) + 1;
+        return 2 * (p - 4);
+    }
+
+private:
+    // 空闲链表头的低44位存储块偏移量/16，高20位是用于避免ABA问题的标签
+    static constexpr std::uint64_t offset_mask = (1ULL << 44) - 1;
+    static constexpr std::uint64_t tag_increment = 1ULL << 44;
+
+    block_header* block_at(std::uint64_t block_offset) noexcept
+    {
+        return reinterpret_cast<block_header*>(base() + block_offset);
+    }
+
+    static constexpr std::uint64_t align_up(std::uint64_t value) noexcept
+    {
+        return (value + block_header_size - 1) & ~(block_header_size - 1);
+    }
+
+    static std::uint32_t highest_bit(std::uint64_t value) noexcept
+    {
+#if defined(_MSC_VER) && defined(_WIN64)
+        unsigned long index = 0;
+        _BitScanReverse64(&index, value);
+        return index;
+#else
+        std::uint32_t index = 0;
+        while (value >>= 1)
+            ++index;
+        return index;
+#endif
+    }
+};
+
+static_assert(sizeof(shared_segment_header) == 4648, "the segment header must have the same layout in 32-bit and 64-bit processes");
+
+/// <summary>
+/// 从共享段分配内存的分配器，它只保存一个指向段头部的offset_ptr，因此可以作为共享容器的成员直接存放在共享段中
+/// </summary>
+/// <typeparam name="T">要分配的元素类型，它的对齐要求不能超过16字节</typeparam>
+template <typename T>
+class shared_allocator
+{
+    template <typename U>
+    friend class shared_allocator;
+
+public:
+    using value_type = T;
+    static_assert(alignof(T) <= shared_segment_header::block_header_size, "shared_allocator supports alignment up to 16 bytes");
+
+    shared_allocator() noexcept = default;
+    explicit shared_allocator(shared_segment_header* header) noexcept : header(header) { }
+    template <typename U>
+    shared_allocator(const shared_allocator<U>& _t) noexcept : header(_t.header.get())
+    {
+    }
+
+public:
+    /// <summary>
+    /// 分配能容纳n个T的内存，不会构造对象
+    /// </summary>
+    /// <remarks>
+    /// 与标准库的分配器相同，n * sizeof(T)溢出时抛出std::bad_array_new_length；
+    /// 段耗尽时不抛出异常而是返回nullptr，共享容器据此返回false
+    /// </remarks>
+    /// <param name="n">元素数量</param>
+    /// <returns>若成功返回内存的指针，若共享段已耗尽返回nullptr</returns>
+    T* allocate(std::size_t n) const
+    {
+        if (n > max_size())
+            throw std::bad_array_new_length();
+        if (!header)
+            return nullptr;
+        auto offset = header->allocate(static_cast<std::uint64_t>(n) * sizeof(T));
+        if (offset == 0)
+            return nullptr;
+        auto p = reinterpret_cast<T*>(header->base() + offset);
+        MW_TRACK_HEAP_ALLOC(p, n * sizeof(T));
+        return p;
+    }
+
+    /// <summary>
+    /// 释放由allocate分配的内存，不会析构对象
+    /// </summary>
+    /// <param name="p">要释放的内存，可以为nullptr</param>
+    void deallocate(T* p, std::size_t = 0) const noexcept
+    {
+        if (p)
+        {
+            MW_TRACK_HEAP_FREE(p);
+            header->deallocate(reinterpret_cast<char*>(p) - header->base());
+        }
+    }
+
+    /// <summary>
+    /// 一次最多可以分配的元素数量
+    /// </summary>
+    static constexpr std::size_t max_size() noexcept { return static_cast<std::size_t>(-1) / sizeof(T); }
+
+    /// <summary>
+    /// 获取该分配器所属的共享段头部
+    /// </summary>
+    shared_segment_header* segment() const noexcept { return header.get(); }
+
+    template <typename U>
+    friend bool operator==(const shared_allocator& left, const shared_allocator<U>& right) noexcept
+    {
+        return left.segment() == right.segment();
+    }
+    template <typename U>
+    friend bool operator!=(const shared_allocator& left, const shared_allocator<U>& right) noexcept
+    {
+        return !(left == right);
+    }
+
+private:
+    offset_ptr<shared_segment_header> header;
+};
+
+/// <summary>
+/// 存放在共享段中的动态数组，元素和数组本身都使用offset_ptr寻址，因此可以被映射在不同基地址的多个进程直接访问
+/// </summary>
+/// <remarks>
+/// 该容器本身不提供同步，若多个进程同时写入，请使用命名互斥量等同步机制。多进程只读访问是安全的
+/// </remarks>
+/// <typeparam name="T">元素类型，若元素包含指针，它应该使用offset_ptr</typeparam>
+template <typename T>
+class shared_vector
+{
+public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using iterator = T*;
+    using const_iterator = const T*;
+    using allocator_type = shared_allocator<T>;
+
+    explicit shared_vector(const allocator_type& alloc) noexcept : alloc(alloc) { }
+    shared_vector(const shared_vector&) = delete;
+    shared_vector(shared_vector&& _t) noexcept :
+        alloc(_t.alloc), elements(_t.elements), element_count(_t.element_count), element_capacity(_t.element_capacity)
+    {
+        _t.elements = nullptr;
+        _t.element_count = _t.element_capacity = 0;
+    }
+    ~shared_vector()
+    {
+        clear();
+        alloc.deallocate(elements.get());
+    }
+    shared_vector& operator=(const shared_vector&) = delete;
+    shared_vector& operator=(shared_vector&& _t) noexcept
+    {
+        if (this != &_t)
+        {
+            clear();
+            alloc.deallocate(elements.get());
+            alloc = _t.alloc;
+            elements = _t.elements;
+            element_count = _t.element_count;
+            element_capacity = _t.element_capacity;
+            _t.elements = nullptr;
+            _t.element_count = _t.element_capacity = 0;
+        }
+        return *this;
+    }
+
+public:
+    /// <summary>
+    /// 确保容量至少为new_capacity
+    /// </summary>
+    /// <param name="new_capacity">新容量</param>
+    /// <returns>若共享段已耗尽返回false，此时容器不变</returns>
+    bool reserve(size_type new_capacity)
+    {
+        if (new_capacity <= element_capacity)
+            return true;
+
+        T* new_elements = alloc.allocate(new_capacity);
+        if (!new_elements)
+            return false;
+
+        T* old_elements = elements.get();
+        for (size_type i = 0; i < element_count; i++)
+        {
+            new (new_elements + i) T(std::move(old_elements[i]));
+            old_elements[i].~T();
+        }
+        alloc.deallocate(old_elements);
+        elements = new_elements;
+        element_capacity = new_capacity;
+        return true;
+    }
+
+    /// <summary>
+    /// 在末尾原地构造一个元素
+    /// </summary>
+    /// <param name="...args">转发给T构造函数的参数</param>
+    /// <returns>若共享段已耗尽返回false</returns>
+    template <typename... Args>
+    bool emplace_back(Args&&... args)
+    {
+        if (element_count == element_capacity && !reserve(element_capacity ? element_capacity * 2 : 8))
+            return false;
+        new (elements.get() + element_count) T(std::forward<Args>(args)...);
+        ++element_count;
+        return true;
+    }
+
+    bool push_back(const T& value) { return emplace_back(value); }
+    bool push_back(T&& value) { return emplace_back(std::move(value)); }
+
+    void pop_back()
+    {
+        elements[--element_count].~T();
+    }
+
+    /// <summary>
+    /// 改变元素数量，新增的元素使用value复制构造
+    /// </summary>
+    /// <returns>若共享段已耗尽返回false</returns>
+    bool resize(size_type new_size, const T& value = T())
+    {
+        if (!reserve(new_size))
+            return false;
+        while (element_count > new_size)
+            pop_back();
+        while (element_count < new_size)
+            new (elements.get() + element_count++) T(value);
+        return true;
+    }
+
+    void clear() noexcept
+    {
+        while (element_count)
+            pop_back();
+    }
+
+    T& operator[](size_type index) noexcept { return elements[index]; }
+    const T& operator[](size_type index) const noexcept { return elements[index]; }
+    T& front() noexcept { return elements[0]; }
+    T& back() noexcept { return elements[element_count - 1]; }
+    T* data() noexcept { return elements.get(); }
+    const T* data() const noexcept { return elements.get(); }
+    iterator begin() noexcept { return elements.get(); }
+    iterator end() noexcept { return elements.get() + element_count; }
+    const_iterator begin() const noexcept { return elements.get(); }
+    const_iterator end() const noexcept { return elements.get() + element_count; }
+    size_type size() const noexcept { return static_cast<size_type>(element_count); }
+    size_type capacity() const noexcept { return static_cast<size_type>(element_capacity); }
+    bool empty() const noexcept { return element_count == 0; }
+    allocator_type get_allocator() const noexcept { return alloc; }
+
+private:
+    allocator_type alloc;
+    offset_ptr<T> elements;
+    std::uint64_t element_count = 0;
+    std::uint64_t element_capacity = 0;
+};
+
+/// <summary>
+/// 存放在共享段中的字符串，总是以0结尾，可以隐式转换为basic_string_view
+/// </summary>
+/// <typeparam name="CharT">字符类型</typeparam>
+template <typename CharT>
+class basic_shared_string
+{
+public:
+    using value_type = CharT;
+    using size_type = std::size_t;
+    using view_type = std::basic_string_view<CharT>;
+    using allocator_type = shared_allocator<CharT>;
+
+    explicit basic_shared_string(const allocator_type& alloc) noexcept : alloc(alloc) { }
+    basic_shared_string(const allocator_type& alloc, view_type str) : alloc(alloc) { assign(str); }
+    basic_shared_string(const basic_shared_string& _t) : alloc(_t.alloc) { assign(_t.view()); }
+    basic_shared_string(basic_shared_string&& _t) noexcept :
+        alloc(_t.alloc), characters(_t.characters), character_count(_t.character_count), character_capacity(_t.character_capacity)
+    {
+        _t.characters = nullptr;
+        _t.character_count = _t.character_capacity = 0;
+    }
+    ~basic_shared_string()
+    {
+        alloc.deallocate(characters.get());
+    }
+    basic_shared_string& operator=(const basic_shared_string& _t)
+    {
+        if (this != &_t)
+            assign(_t.view());
+        return *this;
+    }
+    basic_shared_string& operator=(basic_shared_string&& _t) noexcept
+    {
+        if (this != &_t)
+        {
+            alloc.deallocate(characters.get());
+            alloc = _t.alloc;
+            characters = _t.characters;
+            character_count = _t.character_count;
+            character_capacity = _t.character_capacity;
+            _t.characters = nullptr;
+            _t.character_count = _t.character_capacity = 0;
+        }
+        return *this;
+    }
+    basic_shared_string& operator=(view_type str)
+    {
+        assign(str);
+        return *this;
+    }
+
+public:
+    /// <summary>
+    /// 确保能容纳new_capacity个字符(不包括结尾的0)
+    /// </summary>
+    /// <returns>若共享段已耗尽返回false，此时字符串不变</returns>
+    bool reserve(size_type new_capacity)
+    {
+        if (new_capacity <= character_capacity && characters)
+            return true;
+
+        CharT* new_characters = alloc.allocate(new_capacity + 1);
+        if (!new_characters)
+            return false;
+        if (characters)
+            std::memcpy(new_characters, characters.get(), character_count * sizeof(CharT));
+        new_characters[character_count] = CharT();
+        alloc.deallocate(characters.get());
+        characters = new_characters;
+        character_capacity = new_capacity;
+        return true;
+    }
+
+    /// <summary>
+    /// 将字符串内容替换为str
+    /// </summary>
+    /// <returns>若共享段已耗尽返回false</returns>
+    bool assign(view_type str)
+    {
+        character_count = 0;
+        return append(str);
+    }
+
+    /// <summary>
+    /// 在字符串末尾追加str
+    /// </summary>
+    /// <returns>若共享段已耗尽返回false</returns>
+    bool append(view_type str)
+    {
+        if (character_count + str.size() > character_capacity || !characters)
+        {
+            auto new_capacity = character_capacity * 2;
+            if (new_capacity < character_count + str.size())
+                new_capacity = character_count + str.size();
+            if (!reserve(new_capacity))
+                return false;
+        }
+        std::memcpy(characters.get() + character_count, str.data(), str.size() * sizeof(CharT));
+        character_count += str.size();
+        characters[character_count] = CharT();
+        return true;
+    }
+
+    void clear() noexcept
+    {
+        character_count = 0;
+        if (characters)
+            characters[0] = CharT();
+    }
+
+    const CharT* c_str() const noexcept
+    {
+        static const CharT empty_string[1] = {};
+        return characters ? characters.get() : empty_string;
+    }
+    const CharT* data() const noexcept { return c_str(); }
+    view_type view() const noexcept { return view_type(c_str(), static_cast<size_type>(character_count)); }
+    operator view_type() const noexcept { return view(); }
+    CharT& operator[](size_type index) noexcept { return characters[index]; }
+    CharT operator[](size_type index) const noexcept { return characters[index]; }
+    size_type size() const noexcept { return static_cast<size_type>(character_count); }
+    size_type length() const noexcept { return static_cast<size_type>(character_count); }
+    size_type capacity() const noexcept { return static_cast<size_type>(character_capacity); }
+    bool empty() const noexcept { return character_count == 0; }
+    allocator_type get_allocator() const noexcept { return alloc; }
+
+    friend bool operator==(const basic_shared_string& left, view_type right) noexcept { return left.view() == right; }
+    friend bool operator!=(const basic_shared_string& left, view_type right) noexcept { return left.view() != right; }
+    friend bool operator<(const basic_shared_string& left, const basic_shared_string& right) noexcept { return left.view() < right.view(); }
+
+private:
+    allocator_type alloc;
+    offset_ptr<CharT> characters;
+    std::uint64_t character_count = 0;
+    std::uint64_t character_capacity = 0;
+};
+
+using shared_string = basic_shared_string<char>;
+using shared_wstring = basic_shared_string<wchar_t>;
+
+/// <summary>
+/// 64位FNV-1a哈希，结果只取决于字节内容，与进程的位数和标准库的实现无关
+/// </summary>
+inline std::uint64_t shared_fnv1a(const void* data, std::size_t size) noexcept
+{
+    auto bytes = static_cast<const unsigned char*>(data);
+    std::uint64_t hash = 0xCBF29CE484222325ULL;
+    for (std::size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+/// <summary>
+/// 共享容器默认使用的哈希函数，对于共享字符串，它按字符串内容哈希，因此可以直接使用string_view进行查找
+/// </summary>
+/// <remarks>
+/// 哈希值存放在共享段中的表布局里，所以所有打开该段的进程必须算出相同的值。整数，枚举和共享字符串使用固定的64位FNV-1a，
+/// 32位和64位进程的结果相同；其他类型退回到std::hash，只有所有进程使用相同位数和相同标准库时才能共享
+/// </remarks>
+template <typename T, typename = void>
+struct shared_hash : std::hash<T>
+{
+};
+
+template <typename T>
+struct shared_hash<T, std::enable_if_t<std::is_integral_v<T> || std::is_enum_v<T>>>
+{
+    std::size_t operator()(T value) const noexcept
+    {
+        // 统一扩展为64位再哈希，使32位和64位进程中同一个值的哈希相同
+        auto wide = static_cast<std::uint64_t>(value);
+        return static_cast<std::size_t>(shared_fnv1a(&wide, sizeof(wide)));
+    }
+};
+
+template <typename CharT>
+struct shared_hash<basic_shared_string<CharT>>
+{
+    std::size_t operator()(std::basic_string_view<CharT> str) const noexcept
+    {
+        return static_cast<std::size_t>(shared_fnv1a(str.data(), str.size() * sizeof(CharT)));
+    }
+};
+
+/// <summary>
+/// 存放在共享段中的哈希表，使用开放寻址(线性探测)，所有的槽位都在一块连续的共享内存中
+/// </summary>
+/// <remarks>
+/// find接受任何能被Hash和operator==处理的键类型，例如对于shared_string键，可以直接使用std::string_view查找而不需要在共享段中构造临时字符串。
+/// 该容器本身不提供同步，若多个进程同时写入，请使用命名互斥量等同步机制。多进程只读访问是安全的
+/// </remarks>
+/// <typeparam name="Key">键类型</typeparam>
+/// <typeparam name="Value">值类型</typeparam>
+/// <typeparam name="Hash">哈希函数，它必须在所有进程中产生相同的结果</typeparam>
+template <typename Key, typename Value, typename Hash = shared_hash<Key>>
+class shared_hash_map
+{
+public:
+    /// <summary>
+    /// 哈希表中的一个键值对
+    /// </summary>
+    struct entry
+    {
+        Key key;
+        Value value;
+    };
+
+    using size_type = std::size_t;
+    using allocator_type = shared_allocator<entry>;
+
+    explicit shared_hash_map(const allocator_type& alloc) noexcept : alloc(alloc) { }
+    shared_hash_map(const shared_hash_map&) = delete;
+    shared_hash_map& operator=(const shared_hash_map&) = delete;
+    ~shared_hash_map()
+    {
+        clear();
+        alloc.deallocate(entries.get());
+        shared_allocator<std::uint8_t>(alloc).deallocate(states.get());
+    }
+
+public:
+    /// <summary>
+    /// 查找指定键
+    /// </summary>
+    /// <param name="key">要查找的键，它可以是任何能被Hash和与Key比较的类型</param>
+    /// <returns>若找到返回对应的键值对指针，否则返回nullptr</returns>
+    template <typename K>
+    entry* find(const K& key) noexcept
+    {
+        auto index = find_index(key);
+        return index == npos ? nullptr : entries.get() + index;
+    }
+    template <typename K>
+    const entry* find(const K& key) const noexcept
+    {
+        return const_cast<shared_hash_map*>(this)->find(key);
+    }
+
+    /// <summary>
+    /// 若键不存在，则插入一个由key和value...args构造的键值对
+    /// </summary>
+    /// <param name="key">键，若需要分配共享内存，它应该已经使用同一个共享段的分配器构造</param>
+    /// <param name="...args">转发给Value构造函数的参数</param>
+    /// <returns>返回键值对的指针和是否进行了插入，若共享段已耗尽，返回{nullptr, false}</returns>
+    template <typename... Args>
+    std::pair<entry*, bool> emplace(Key&& key, Args&&... args)
+    {
+        auto index = find_index(key);
+        if (index != npos)
+            return { entries.get() + index, false };
+
+        // 负载因子超过7/8时扩容(墓碑也计算在内)
+        if ((used_count + 1) * 8 > slot_count * 7 && !rehash(slot_count ? slot_count * 2 : 16))
+            return { nullptr, false };
+
+        index = insert_slot(Hash()(key));
+        new (&entries[index].key) Key(std::move(key));
+        new (&entries[index].value) Value(std::forward<Args>(args)...);
+        ++element_count;
+        return { entries.get() + index, true };
+    }
+
+    /// <summary>
+    /// 删除指定键
+    /// </summary>
+    /// <returns>是否找到并删除</returns>
+    template <typename K>
+    bool erase(const K& key) noexcept
+    {
+        auto index = find_index(key);
+        if (index == npos)
+            return false;
+        destroy_slot(index);
+        states[index] = slot_deleted;
+        --element_count;
+        return true;
+    }
+
+    /// <summary>
+    /// 重新分配槽位数组，new_slot_count会被向上取整为2的幂
+    /// </summary>
+    /// <returns>若共享段已耗尽返回false，此时容器不变</returns>
+    bool rehash(size_type new_slot_count)
+    {
+        size_type rounded = 16;
+        while (rounded < new_slot_count || rounded * 7 < element_count * 8)
+            rounded *= 2;
+
+        shared_allocator<std::uint8_t> state_alloc(alloc);
+        entry* new_entries = alloc.allocate(rounded);
+        std::uint8_t* new_states = state_alloc.allocate(rounded);
+        if (!new_entries || !new_states)
+        {
+            alloc.deallocate(new_entries);
+            state_alloc.deallocate(new_states);
+            return false;
+        }
+        std::memset(new_states, slot_empty, rounded);
+
+        auto old_entries = entries.get();
+        auto old_states = states.get();
+        auto old_slot_count = slot_count;
+        entries = new_entries;
+        states = new_states;
+        slot_count = rounded;
+        used_count = element_count;
+
+        for (size_type i = 0; i < old_slot_count; i++)
+        {
+            if (old_states[i] != slot_full)
+                continue;
+            auto index = insert_slot(Hash()(old_entries[i].key));
+            new (&entries[index]) entry { std::move(old_entries[i].key), std::move(old_entries[i].value) };
+            old_entries[i].~entry();
+        }
+        alloc.deallocate(old_entries);
+        state_alloc.deallocate(old_states);
+        return true;
+    }
+
+    void clear() noexcept
+    {
+        for (size_type i = 0; i < slot_count; i++)
+        {
+            if (states[i] == slot_full)
+                destroy_slot(i);
+            if (states)
+                states[i] = slot_empty;
+        }
+        element_count = used_count = 0;
+    }
+
+    /// <summary>
+    /// 对每个键值对调用指定可调用对象
+    /// </summary>
+    /// <param name="fun">可调用对象，它的参数是entry&</param>
+    template <typename Func>
+    void for_each(Func fun)
+    {
+        for (size_type i = 0; i < slot_count; i++)
+            if (states[i] == slot_full)
+                fun(entries[i]);
+    }
+
+    size_type size() const noexcept { return static_cast<size_type>(element_count); }
+    bool empty() const noexcept { return element_count == 0; }
+    size_type bucket_count() const noexcept { return static_cast<size_type>(slot_count); }
+
+private:
+    static constexpr size_type npos = static_cast<size_type>(-1);
+    enum : std::uint8_t
+    {
+        slot_empty = 0,
+        slot_full = 1,
+        slot_deleted = 2
+    };
+
+    template <typename K>
+    size_type find_index(const K& key) const noexcept
+    {
+        if (!slot_count)
+            return npos;
+        auto mask = slot_count - 1;
+        for (auto index = Hash()(key) & mask;; index = (index + 1) & mask)
+        {
+            auto state = states[index];
+            if (state == slot_empty)
+                return npos;
+            if (state == slot_full && entries[index].key == key)
+                return index;
+        }
+    }
+
+    size_type insert_slot(std::size_t hash) noexcept
+    {
+        auto mask = slot_count - 1;
+        auto index = hash & mask;
+        while (states[index] == slot_full)
+            index = (index + 1) & mask;
+        if (states[index] == slot_empty)
+            ++used_count;
+        states[index] = slot_full;
+        return index;
+    }
+
+    void destroy_slot(size_type index) noexcept
+    {
+        entries[index].~entry();
+    }
+
+    allocator_type alloc;
+    offset_ptr<entry> entries;
+    offset_ptr<std::uint8_t> states;
+    std::uint64_t slot_count = 0;
+    std::uint64_t element_count = 0;
+    std::uint64_t used_count = 0;
+};
+
+/// <summary>
+/// 共享段，它是一个以页交换文件或磁盘文件为后备存储器的文件映射视图，并在其中维护一个无锁分配器和命名对象目录
+/// </summary>
+/// <remarks>
+/// 若指定了file_path，共享段以该文件为后备存储器(持久化模式)，进程退出或重启后再次打开同一个文件，段中的所有对象都还在。
+/// 否则它以页交换文件为后备存储器，最后一个映射它的进程关闭后内容就消失了。
+///
+/// 共享段可以在不同进程中映射到不同的基地址，所有存放在段中的对象内部都必须使用offset_ptr而不是原生指针。
+/// 使用find_or_construct在段中创建命名的根对象(例如一个shared_hash_map)，其他进程使用find获取它。
+///
+/// 头部的初始化和命名对象目录由一个命名互斥量保护，它的名字由后备文件的卷序列号和文件索引(持久化模式)或段的名字得出。
+/// 持有互斥量的进程崩溃时，等待者得到WAIT_ABANDONED并接手：初始化到一半的头部会被重新初始化，目录中构造到一半的对象不会出现在目录中。
+/// 它只在Windows上可用；在Linux上，offset_ptr，shared_segment_header和共享容器可以直接用于自己映射的内存(例如mmap一个memfd)
+/// </remarks>
+#ifdef _WIN32
+class shared_segment
+{
+public:
+    shared_segment() = default;
+    /// <summary>
+    /// 打开或创建共享段，请使用is_open检查是否成功
+    /// </summary>
+    /// <param name="segment_name">文件映射对象的名字，可以为nullptr，此时只能通过file_path在进程间共享</param>
+    /// <param name="segment_size">段的大小(字节)，若段已经存在，使用已存在的大小</param>
+    /// <param name="file_path">后备文件的路径，若为nullptr或""则以页交换文件为后备存储器</param>
+    shared_segment(tzstring_view segment_name, std::uint64_t segment_size, tzstring_view file_path = nullptr)
+    {
+        open_or_create(segment_name, segment_size, file_path);
+    }
+    shared_segment(const shared_segment&) = delete;
+    shared_segment(shared_segment&& _t) noexcept
+    {
+        swap(_t);
+    }
+    ~shared_segment()
+    {
+        close();
+    }
+    shared_segment& operator=(const shared_segment&) = delete;
+    shared_segment& operator=(shared_segment&& _t) noexcept
+    {
+        if (this != &_t)
+        {
+            close();
+            swap(_t);
+        }
+        return *this;
+    }
+
+public:
+    /// <summary>
+    /// 打开或创建共享段，若当前已打开一个段，它将先被关闭
+    /// </summary>
+    /// <param name="segment_name">文件映射对象的名字，可以为nullptr，此时只能通过file_path在进程间共享</param>
+    /// <param name="segment_size">段的大小(字节)，若段已经存在，使用已存在的大小</param>
+    /// <param name="file_path">后备文件的路径，若为nullptr或""则以页交换文件为后备存储器</param>
+    /// <returns>操作是否成功，若已存在的段不是有效的共享段(魔数或版本不匹配)，返回false</returns>
+    bool open_or_create(tzstring_view segment_name, std::uint64_t segment_size, tzstring_view file_path = nullptr)
+    {
+        close();
+
+        HANDLE backing_file = INVALID_HANDLE_VALUE;
+        if (!file_path.empty())
+        {
+            file_handle = mw::create_file(file_path, GENERIC_READ | GENERIC_WRITE, OPEN_ALWAYS,
+                FILE_SHARE_READ | FILE_SHARE_WRITE, FILE_ATTRIBUTE_NORMAL);
+            if (file_handle == INVALID_HANDLE_VALUE)
+                return false;
+
+            // 持久化的段使用文件已有的大小
+            LARGE_INTEGER file_size = { 0 };
+            if (mw::get_file_size(file_handle, file_size) && static_cast<std::uint64_t>(file_size.QuadPart) > segment_size)
+                segment_size = file_size.QuadPart;
+            backing_file = file_handle;
+        }
+
+        if (segment_size < sizeof(shared_segment_header))
+        {
+            close();
+            return false;
+        }
+
+        mapping_handle = mw::create_file_mapping(backing_file, PAGE_READWRITE, segment_size, segment_name);
+        if (!mapping_handle)
+        {
+            close();
+            return false;
+        }
+
+        header = static_cast<shared_segment_header*>(mw::map_view_of_file(mapping_handle));
+        if (!header)
+        {
+            close();
+            return false;
+        }
+
+        auto name = lock_name(segment_name);
+        lock_handle = mw::sync::create_mutex(name.empty() ? tzstring_view() : tzstring_view(name));
+        if (!lock_handle || !lock_segment())
+        {
+            close();
+            return false;
+        }
+
+        // 第一个获得互斥量的进程初始化头部。state_initializing说明上一个初始化者中途崩溃了(互斥量被遗弃)，重新初始化；
+        // 未初始化但魔数不为0的是其他格式的文件，不覆盖它，由下面的is_valid拒绝
+        auto state = header->state.load(std::memory_order_acquire);
+        if (state == shared_segment_header::state_initializing
+            || (state == shared_segment_header::state_uninitialized && header->magic == 0))
+        {
+            header->state.store(shared_segment_header::state_initializing, std::memory_order_relaxed);
+            header->initialize(segment_size);
+            header->state.store(shared_segment_header::state_ready, std::memory_order_release);
+        }
+        unlock_segment();
+
+        if (header->state.load(std::memory_order_acquire) != shared_segment_header::state_ready || !header->is_valid())
+        {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    /// <summary>
+    /// 关闭共享段，持久化模式下会先将视图刷入文件
+    /// </summary>
+    void close()
+    {
+        if (header)
+        {
+            if (file_handle != INVALID_HANDLE_VALUE)
+                mw::flush_view_of_file(header);
+            mw::unmap_view_of_file(header);
+            header = nullptr;
+        }
+        if (mapping_handle)
+        {
+            CloseHandle(mapping_handle);
+            mapping_handle = nullptr;
+        }
+        if (lock_handle)
+        {
+            CloseHandle(lock_handle);
+            lock_handle = nullptr;
+        }
+        if (file_handle != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(file_handle);
+            file_handle = INVALID_HANDLE_VALUE;
+        }
+    }
+
+    /// <summary>
+    /// 将段内容刷入后备文件，对页交换文件为后备存储器的段没有作用
+    /// </summary>
+    /// <returns>操作是否成功</returns>
+    bool flush()
+    {
+        return header && mw::flush_view_of_file(header);
+    }
+
+    bool is_open() const noexcept { return header != nullptr; }
+    void* base() const noexcept { return header; }
+    std::uint64_t size() const noexcept { return header ? header->segment_size : 0; }
+    shared_segment_header* get_header() const noexcept { return header; }
+
+    /// <summary>
+    /// 从共享段分配内存，该函数是无锁的
+    /// </summary>
+    /// <param name="bytes">要分配的字节数</param>
+    /// <returns>若成功返回16字节对齐的内存指针，若段已耗尽返回nullptr</returns>
+    void* allocate(std::size_t bytes) noexcept
+    {
+        auto offset = header->allocate(bytes);
+        if (!offset)
+            return nullptr;
+        auto p = header->base() + offset;
+        MW_TRACK_HEAP_ALLOC(p, bytes);
+        return p;
+    }
+
+    /// <summary>
+    /// 释放由allocate分配的内存，该函数是无锁的
+    /// </summary>
+    /// <param name="p">要释放的内存，可以为nullptr</param>
+    void deallocate(void* p) noexcept
+    {
+        if (p)
+        {
+            MW_TRACK_HEAP_FREE(p);
+            header->deallocate(static_cast<char*>(p) - header->base());
+        }
+    }
+
+    /// <summary>
+    /// 获取该段的分配器，用于构造共享容器
+    /// </summary>
+    template <typename T>
+    shared_allocator<T> get_allocator() const noexcept
+    {
+        return shared_allocator<T>(header);
+    }
+
+    /// <summary>
+    /// 查找指定名字的命名对象
+    /// </summary>
+    /// <param name="name">对象的名字</param>
+    /// <returns>若找到返回对象指针，否则返回nullptr</returns>
+    template <typename T>
+    T* find(std::string_view name)
+    {
+        if (!lock_segment())
+            return nullptr;
+        auto object = find_entry(name);
+        unlock_segment();
+        return static_cast<T*>(object);
+    }
+
+    /// <summary>
+    /// 查找指定名字的命名对象，若不存在，在段中构造它。对象的构造在目录互斥量中进行，因此同名对象只会被构造一次
+    /// </summary>
+    /// <remarks>
+    /// 目录项在对象构造完成后才计入directory_used，构造中崩溃的进程只会泄漏那块内存，不会留下半个对象
+    /// </remarks>
+    /// <param name="name">对象的名字，长度必须小于48</param>
+    /// <param name="...args">转发给T构造函数的参数</param>
+    /// <returns>若成功返回对象指针，若段或目录已满返回nullptr</returns>
+    template <typename T, typename... Args>
+    T* find_or_construct(std::string_view name, Args&&... args)
+    {
+        static_assert(alignof(T) <= shared_segment_header::block_header_size, "alignment up to 16 bytes is supported");
+        if (name.size() >= shared_segment_header::max_name_length)
+            return nullptr;
+
+        if (!lock_segment())
+            return nullptr;
+        auto object = static_cast<T*>(find_entry(name));
+        if (!object && header->directory_used < shared_segment_header::directory_count)
+        {
+            object = static_cast<T*>(allocate(sizeof(T)));
+            if (object)
+            {
+                new (object) T(std::forward<Args>(args)...);
+                auto& entry = header->directory[header->directory_used];
+                std::memcpy(entry.name, name.data(), name.size());
+                entry.name[name.size()] = '\0';
+                entry.object_offset = reinterpret_cast<char*>(object) - header->base();
+                entry.object_size = sizeof(T);
+                ++header->directory_used;
+            }
+        }
+        unlock_segment();
+        return object;
+    }
+
+private:
+    void* find_entry(std::string_view name)
+    {
+        for (std::uint32_t i = 0; i < header->directory_used; i++)
+        {
+            auto& entry = header->directory[i];
+            if (name == entry.name)
+                return header->base() + entry.object_offset;
+        }
+        return nullptr;
+    }
+
+    // 互斥量的名字。持久化的段按文件身份命名，不同路径(或不同的segment_name)打开同一个文件时得到同一个互斥量；
+    // 以页交换文件为后备存储器的段按段名命名，保留Global\或Local\前缀；匿名段只在本进程中可见，使用未命名的互斥量
+    std::tstring lock_name(tzstring_view segment_name) const
+    {
+        std::basic_ostringstream<TCHAR> name;
+        auto segment = segment_name.view();
+        auto separator = segment.find(_T('\\'));
+        if (separator != segment.npos)
+            name << segment.substr(0, separator + 1);
+
+        BY_HANDLE_FILE_INFORMATION info;
+        if (file_handle != INVALID_HANDLE_VALUE && GetFileInformationByHandle(file_handle, &info))
+            name << _T("mw_shared_segment_") << std::hex << info.dwVolumeSerialNumber << _T('_') << info.nFileIndexHigh << _T('_') << info.nFileIndexLow;
+        else if (!segment.empty())
+            name << _T("mw_shared_segment_") << segment.substr(separator == segment.npos ? 0 : separator + 1);
+        else
+            return {};
+        return name.str();
+    }
+
+    // 互斥量只用于头部的初始化和命名对象的查找和创建，不在分配路径上。
+    // 持有者崩溃时返回WAIT_ABANDONED，此时本线程已经获得了互斥量，被保护的状态按上面的规则恢复
+    bool lock_segment()
+    {
+        auto result = mw::sync::wait_for_single_object(lock_handle, INFINITE, false, mw::error::ignore);
+        return result == WAIT_OBJECT_0 || result == WAIT_ABANDONED;
+    }
+    void unlock_segment()
+    {
+        mw::sync::release_mutex(lock_handle);
+    }
+
+    void swap(shared_segment& _t) noexcept
+    {
+        std::swap(file_handle, _t.file_handle);
+        std::swap(mapping_handle, _t.mapping_handle);
+        std::swap(lock_handle, _t.lock_handle);
+        std::swap(header, _t.header);
+    }
+
+    HANDLE file_handle = INVALID_HANDLE_VALUE;
+    HANDLE mapping_handle = nullptr;
+    HANDLE lock_handle = nullptr;
+    shared_segment_header* header = nullptr;
+};
+#endif
+
+} // namespace mw
@@ -1,4 +1,7 @@
 #pragma once
+#include "mw_error.h"
+#include "mw_handle.h"
+#include "mw_trace.h"
 
 #include <WS2tcpip.h>
 #include <iphlpapi.h>
@@ -6,6 +9,25 @@
 
 #pragma comment(lib, "Ws2_32.lib")
 
+namespace mw::error {
+
+/// <summary>
+/// 返回SOCKET_ERROR表示失败的套接字函数使用的谓词，WinSock的错误代码也可以通过GetLastError获取
+/// </summary>
+inline constexpr auto is_socket_error = [](int value) noexcept { return value == SOCKET_ERROR; };
+
+/// <summary>
+/// 返回INVALID_SOCKET表示失败的套接字函数使用的谓词
+/// </summary>
+inline constexpr auto is_invalid_socket = [](SOCKET value) noexcept { return value == INVALID_SOCKET; };
+
+/// <summary>
+/// 可以异步完成的WSASend和WSARecv等使用的谓词，SOCKET_ERROR并且错误代码为WSA_IO_PENDING时不是失败
+/// </summary>
+inline constexpr auto is_socket_io_failed = [](int value) noexcept { return value == SOCKET_ERROR && WSAGetLastError() != WSA_IO_PENDING; };
+
+} // namespace mw::error
+
 namespace mw::socket {
 
 /// <summary>
@@ -40,12 +62,12 @@ inline int socket_cleanup()
 /// <param name="service_name">该字符串是服务名字或端口数字,服务名字是端口数字的别名，比如"http"等于"80"，服务名字可选值在system32\drivers\etc\services中</param>
 /// <param name="hints">用于指示调用者支持的套接字类型，比如你可以指示只要IPv4地址(ai_addrlen,ai_canonname,ai_addr,和ai_next成员必须为0,否则出错)</param>
 /// <param name="result">[out]一个指向链表的指针,该链表是一个或多个ADDRINFOT结构体,它包含主机回应的信息。若函数成功,该链表请用FreeAddrInfo释放</param>
-/// <returns>成功返回0，否则返回非零的Windows Socket错误代码,它是WSA_开头的宏，请看文档</returns>
-inline INT get_address_info(const std::tstring& node_name, const std::tstring& service_name, const ADDRINFOT& hints, ADDRINFOT*& result)
+/// <returns>成功返回0，否则返回非零的Windows Socket错误代码,它是WSA_开头的宏，请看文档，返回值的类型由错误处理策略决定</returns>
+template <typename Policy = MY_WINDOWS_ERROR_POLICY>
+inline auto get_address_info(tzstring_view node_name, tzstring_view service_name, const ADDRINFOT& hints, ADDRINFOT*& result, Policy = {})
 {
-    auto val = GetAddrInfo(node_name.c_str(), service_name.c_str(), &hints, &result);
-    GET_ERROR_MSG_OUTPUT_SOCKET();
-    return val;
+    auto val = GetAddrInfo(node_name.get(), service_name.get(), &hints, &result);
+    return Policy::apply(val, error::is_nonzero, __FUNCTION__);
 }
 
 /// <summary>
@@ -57,6 +79,20 @@ inline VOID free_address_info(ADDRINFOT* address_info)
     FreeAddrInfo(address_info);
 }
 
+/// <summary>
+/// 套接字，无效值为INVALID_SOCKET，使用closesocket关闭
+/// </summary>
+struct socket_traits
+{
+    using pointer = SOCKET;
+    static constexpr pointer invalid() noexcept { return INVALID_SOCKET; }
+    static void close(pointer socket) noexcept { closesocket(socket); }
+};
+
+using unique_socket = unique_handle<socket_traits>;
+
+static_assert(sizeof(unique_socket) == sizeof(SOCKET));
+
 /// <summary>
 /// 该函数创建一个指定类型的套接字，若protocol_info不为nullptr，套接字将绑定到WSAPROTOCOL_INFO结构指示的传输服务提供程序上
 /// </summary>
@@ -67,24 +103,35 @@ inline VOID free_address_info(ADDRINFOT* address_info)
 /// <param name="address_family">指定的地址族，它是AF_开头的宏的组合，当前支持AF_INET或AF_INET6(ipv4,ipv6)。其他地址族需要安装对应的套接字服务提供程序</param>
 /// <param name="socket_type">指定套接字的类型，它是SOCK_开头的宏中的一个(如指定TCP还是UDP，请使用SOCK_STREAM或SOCK_DGRAM)，其他套接字类型请看文档</param>
 /// <param name="protocol">使用的协议,该参数可能值依赖于地址族和套接字类型,它是IPPROTO_或BTHPROTO_开头宏中的一个,TCP是IPPROTO_TCP,UDP是IPPROTO_UDP</param>
-/// <returns>若成功，返回引用到新套接字的描述符，若失败返回INVALID_SOCKET</returns>
-inline SOCKET create_socket(int address_family = AF_INET | AF_INET6, int socket_type = SOCK_STREAM, int protocol = IPPROTO_TCP)
+/// <returns>若成功，返回引用到新套接字的描述符，若失败返回INVALID_SOCKET，返回值的类型由错误处理策略决定</returns>
+template <typename Policy = MY_WINDOWS_ERROR_POLICY>
+inline auto create_socket(int address_family = AF_INET | AF_INET6, int socket_type = SOCK_STREAM, int protocol = IPPROTO_TCP, Policy = {})
 {
+    MW_TRACE_SCOPE(socket, nullptr);
     auto val = WSASocket(address_family, socket_type, protocol, nullptr, 0, WSA_FLAG_OVERLAPPED);
-    GET_ERROR_MSG_OUTPUT_SOCKET();
-    return val;
+    MW_TRACE_RESULT(val);
+    return Policy::apply(val, error::is_invalid_socket, __FUNCTION__);
+}
+
+/// <summary>
+/// 与create_socket相同，但返回unique_socket，析构时自动关闭
+/// </summary>
+template <typename... Args>
+inline unique_socket create_socket(unique_tag, Args&&... args)
+{
+    return unique_socket(create_socket(std::forward<Args>(args)...));
 }
 
 /// <summary>
 /// 关闭一个存在的套接字
 /// </summary>
 /// <param name="socket">标识一个要关闭的套接字的描述符</param>
-/// <returns>若没有错误发送，返回0，否则返回SOCKET_ERROR</returns>
-inline int close_socket(SOCKET socket)
+/// <returns>若没有错误发送，返回0，否则返回SOCKET_ERROR，返回值的类型由错误处理策略决定</returns>
+template <typename Policy = MY_WINDOWS_ERROR_POLICY>
+inline auto close_socket(SOCKET socket, Policy = {})
 {
     auto val = closesocket(socket);
-    GET_ERROR_MSG_OUTPUT_SOCKET();
-    return val;
+    return Policy::apply(val, error::is_socket_error, __FUNCTION__);
 }
 
 /// <summary>
@@ -93,12 +140,14 @@ inline int close_socket(SOCKET socket)
 /// <param name="socket">一个标识一个未连接的套接字的描述符</param>
 /// <param name="address">指向一个包含要连接的地址的sockaddr结构的指针，它可以是ADDRINFOT的ai_addr成员，它包含IP地址，端口和其他的东西，请看文档</param>
 /// <param name="address_len">address参数指向的sockaddr结构的长度(以字节为单位)它可以是ADDRINFOT的ai_addrlen成员</param>
-/// <returns>若没有错误发生，返回0，否则返回SOCKET_ERROR</returns>
-inline int socket_connect(SOCKET socket, const sockaddr* address, int address_len)
+/// <returns>若没有错误发生，返回0，否则返回SOCKET_ERROR，返回值的类型由错误处理策略决定</returns>
+template <typename Policy = MY_WINDOWS_ERROR_POLICY>
+inline auto socket_connect(SOCKET socket, const sockaddr* address, int address_len, Policy = {})
 {
+    MW_TRACE_SCOPE(socket, socket);
     auto val = connect(socket, address, address_len);
-    GET_ERROR_MSG_OUTPUT_SOCKET();
-    return val;
+    MW_TRACE_RESULT(val);
+    return Policy::apply(val, error::is_socket_error, __FUNCTION__);
 }
 
 /// <summary>
@@ -111,15 +160,15 @@ inline int socket_connect(SOCKET socket, const sockaddr* address, int address_le
 /// <param name="flags">用于修改WSASend函数调用行为的标志，请看文档</param>
 /// <param name="overlapped">[opt]指向WSAOVERLAPPED结构的指针，对于非重叠套接字，忽略此参数</param>
 /// <param name="completion_routine">[opt]发送操作完成时调用的完成例程的指针,对于非重叠套接字，忽略此参数</param>
-/// <returns>若没有发生错误并且发送操作立即完成，返回0。否则，返回SOCKET_ERROR，其他事项请看文档</returns>
-inline int socket_send_asyn(SOCKET socket, LPWSABUF buffers_to_send, DWORD buffers_array_counts,
+/// <returns>若没有发生错误并且发送操作立即完成，返回0。否则，返回SOCKET_ERROR，其他事项请看文档，返回值的类型由错误处理策略决定</returns>
+template <typename Policy = MY_WINDOWS_ERROR_POLICY>
+inline auto socket_send_asyn(SOCKET socket, LPWSABUF buffers_to_send, DWORD buffers_array_counts,
     LPDWORD number_of_bytes_sent, DWORD flags = 0, LPWSAOVERLAPPED overlapped = nullptr,
-    LPWSAOVERLAPPED_COMPLETION_ROUTINE completion_routine = nullptr)
+    LPWSAOVERLAPPED_COMPLETION_ROUTINE completion_routine = nullptr, Policy = {})
 {
     auto val = WSASend(socket, buffers_to_send, buffers_array_counts,
         number_of_bytes_sent, flags, overlapped, completion_routine);
-    GET_ERROR_MSG_OUTPUT_SOCKET();
-    return val;
+    return Policy::apply(val, error::is_socket_io_failed, __FUNCTION__);
 }
 
 /// <summary>
@@ -129,12 +178,14 @@ inline int socket_send_asyn(SOCKET socket, LPWSABUF buffers_to_send, DWORD buffe
 /// <param name="buffer">一个指向包含要传输的数据的缓存区的指针</param>
 /// <param name="buffer_len">缓冲区的长度(以字节为单位)</param>
 /// <param name="flags">一组指定调用方式的标志，请看文档，可选值是MSG_DONTROUTE和MSG_OOB，或者它们的组合</param>
-/// <returns>若没有发送错误，返回发送的总字节数(它可以比buffer_len小)，否则，返回SOCKET_ERROR</returns>
-inline int socket_send(SOCKET socket, const char* buffer, int buffer_len, int flags = 0)
+/// <returns>若没有发送错误，返回发送的总字节数(它可以比buffer_len小)，否则，返回SOCKET_ERROR，返回值的类型由错误处理策略决定</returns>
+template <typename Policy = MY_WINDOWS_ERROR_POLICY>
+inline auto socket_send(SOCKET socket, const char* buffer, int buffer_len, int flags = 0, Policy = {})
 {
+    MW_TRACE_SCOPE(socket, socket);
     auto val = send(socket, buffer, buffer_len, flags);
-    GET_ERROR_MSG_OUTPUT_SOCKET();
-    return val;
+    MW_TRACE_RESULT(val);
+    return Policy::apply(val, error::is_socket_error, __FUNCTION__);
 }
 
 /// <summary>
@@ -150,15 +201,15 @@ inline int socket_send(SOCKET socket, const char* buffer, int buffer_len, int fl
 /// <param name="flags">[in,out]用于修改WSARecv函数调用行为的标志</param>
 /// <param name="overlapped">[opt]指向WSAOVERLAPPED结构的指针，对于非重叠套接字，忽略此参数</param>
 /// <param name="completion_routine">[opt]发送操作完成时调用的完成例程的指针,对于非重叠套接字，忽略此参数</param>
-/// <returns>若没有发生错误并且接收操作立即完成，返回0。否则，返回SOCKET_ERROR，其他事项请看文档</returns>
-inline int socket_recv_asyn(SOCKET socket, LPWSABUF buffers_to_receive, DWORD buffers_array_counts,
+/// <returns>若没有发生错误并且接收操作立即完成，返回0。否则，返回SOCKET_ERROR，其他事项请看文档，返回值的类型由错误处理策略决定</returns>
+template <typename Policy = MY_WINDOWS_ERROR_POLICY>
+inline auto socket_recv_asyn(SOCKET socket, LPWSABUF buffers_to_receive, DWORD buffers_array_counts,
     LPDWORD number_of_bytes_received, DWORD& flags, LPWSAOVERLAPPED overlapped = nullptr,
-    LPWSAOVERLAPPED_COMPLETION_ROUTINE completion_routine = nullptr)
+    LPWSAOVERLAPPED_COMPLETION_ROUTINE completion_routine = nullptr, Policy = {})
 {
     auto val = WSARecv(socket, buffers_to_receive, buffers_array_counts,
         number_of_bytes_received, &flags, overlapped, completion_routine);
-    GET_ERROR_MSG_OUTPUT_SOCKET();
-    return val;
+    return Policy::apply(val, error::is_socket_io_failed, __FUNCTION__);
 }
 
 /// <summary>
@@ -171,12 +222,101 @@ inline int socket_recv_asyn(SOCKET socket, LPWSABUF buffers_to_receive, DWORD bu
 /// <param name="buffer">[out]一个指向要接收传入数据的缓存区的指针</param>
 /// <param name="buffer_len">缓冲区的长度(以字节为单位)</param>
 /// <param name="flags">一组影响此函数行为的标志，它的可选值是MSG_PEEK，MSG_OOB，MSG_WAITALL，意义请看文档</param>
-/// <returns>若没有错误发送，返回接收到的字节数，若连接已正常关闭，返回0.否则返回SOCKET_ERROR</returns>
-inline int socket_recv(SOCKET socket, char* buffer, int buffer_len, int flags = 0)
+/// <returns>若没有错误发送，返回接收到的字节数，若连接已正常关闭，返回0.否则返回SOCKET_ERROR，返回值的类型由错误处理策略决定</returns>
+template <typename Policy = MY_WINDOWS_ERROR_POLICY>
+inline auto socket_recv(SOCKET socket, char* buffer, int buffer_len, int flags = 0, Policy = {})
 {
+    MW_TRACE_SCOPE(socket, socket);
     auto val = recv(socket, buffer, buffer_len, flags);
-    GET_ERROR_MSG_OUTPUT_SOCKET();
-    return val;
+    MW_TRACE_RESULT(val);
+    return Policy::apply(val, error::is_socket_error, __FUNCTION__);
+}
+
+/// <summary>
+/// 该函数向指定地址发送数据报，用于无连接的套接字(如UDP)
+/// </summary>
+/// <param name="socket">一个标识套接字(可能已连接)的描述符</param>
+/// <param name="buffers_to_send">指向WSABUF结构数组的指针,所有缓冲区的数据组成一个数据报,在发送期间必须保证有效</param>
+/// <param name="buffers_array_counts">buffers_to_send数组中WSABUF结构的数量</param>
+/// <param name="number_of_bytes_sent">[out]指向I/O操作完成时调用所发送的数字(以字节为单位)，对于重叠套接字不起作用，应为NULL</param>
+/// <param name="to">目标地址，对于已连接的套接字，忽略此参数</param>
+/// <param name="to_len">to的长度(以字节为单位)</param>
+/// <param name="flags">用于修改WSASendTo函数调用行为的标志，请看文档</param>
+/// <param name="overlapped">[opt]指向WSAOVERLAPPED结构的指针，对于非重叠套接字，忽略此参数</param>
+/// <param name="completion_routine">[opt]发送操作完成时调用的完成例程的指针,对于非重叠套接字，忽略此参数</param>
+/// <returns>若没有发生错误并且发送操作立即完成，返回0。否则，返回SOCKET_ERROR，其他事项请看文档，返回值的类型由错误处理策略决定</returns>
+template <typename Policy = MY_WINDOWS_ERROR_POLICY>
+inline auto socket_send_to_asyn(SOCKET socket, LPWSABUF buffers_to_send, DWORD buffers_array_counts,
+    LPDWORD number_of_bytes_sent, const sockaddr* to, int to_len, DWORD flags = 0, LPWSAOVERLAPPED overlapped = nullptr,
+    LPWSAOVERLAPPED_COMPLETION_ROUTINE completion_routine = nullptr, Policy = {})
+{
+    auto val = WSASendTo(socket, buffers_to_send, buffers_array_counts,
+        number_of_bytes_sent, flags, to, to_len, overlapped, completion_routine);
+    return Policy::apply(val, error::is_socket_io_failed, __FUNCTION__);
+}
+
+/// <summary>
+/// 该函数向指定地址发送数据报，用于无连接的套接字(如UDP)
+/// </summary>
+/// <param name="socket">一个标识套接字(可能已连接)的描述符</param>
+/// <param name="buffer">一个指向包含要传输的数据的缓存区的指针</param>
+/// <param name="buffer_len">缓冲区的长度(以字节为单位)，它不能超过协议的最大数据报大小</param>
+/// <param name="to">目标地址</param>
+/// <param name="to_len">to的长度(以字节为单位)</param>
+/// <param name="flags">一组指定调用方式的标志，请看文档</param>
+/// <returns>若没有发送错误，返回发送的总字节数，否则，返回SOCKET_ERROR，返回值的类型由错误处理策略决定</returns>
+template <typename Policy = MY_WINDOWS_ERROR_POLICY>
+inline auto socket_send_to(SOCKET socket, const char* buffer, int buffer_len, const sockaddr* to, int to_len, int flags = 0, Policy = {})
+{
+    MW_TRACE_SCOPE(socket, socket);
+    auto val = sendto(socket, buffer, buffer_len, flags, to, to_len);
+    MW_TRACE_RESULT(val);
+    return Policy::apply(val, error::is_socket_error, __FUNCTION__);
+}
+
+/// <summary>
+/// 该函数从绑定(bind)的无连接套接字接收一个数据报，并获取发送者的地址
+/// </summary>
+/// <remarks>
+/// 若缓冲区小于数据报，数据报被截断，函数以WSAEMSGSIZE失败(重叠I/O的完成状态同样如此)，剩余部分被丢弃
+/// </remarks>
+/// <param name="socket">一个标识已绑定的套接字的描述符</param>
+/// <param name="buffers_to_receive">[in,out]指向WSABUF结构数组的指针,每个WSABUF结构都包含一个指向缓冲区的指针和缓冲区的长度(字节)</param>
+/// <param name="buffers_array_counts">buffers_to_receive数组中WSABUF结构的数量</param>
+/// <param name="number_of_bytes_received">[out]指向I/O操作完成时调用所接收的数字(以字节为单位)，对于重叠套接字不起作用，应为NULL</param>
+/// <param name="flags">[in,out]用于修改WSARecvFrom函数调用行为的标志</param>
+/// <param name="from">[out]接收发送者的地址，对于重叠I/O，在完成之前必须保证有效</param>
+/// <param name="from_len">[in,out]from的长度，返回地址的实际长度，对于重叠I/O，在完成之前必须保证有效</param>
+/// <param name="overlapped">[opt]指向WSAOVERLAPPED结构的指针，对于非重叠套接字，忽略此参数</param>
+/// <param name="completion_routine">[opt]接收操作完成时调用的完成例程的指针,对于非重叠套接字，忽略此参数</param>
+/// <returns>若没有发生错误并且接收操作立即完成，返回0。否则，返回SOCKET_ERROR，其他事项请看文档，返回值的类型由错误处理策略决定</returns>
+template <typename Policy = MY_WINDOWS_ERROR_POLICY>
+inline auto socket_recv_from_asyn(SOCKET socket, LPWSABUF buffers_to_receive, DWORD buffers_array_counts,
+    LPDWORD number_of_bytes_received, DWORD& flags, sockaddr* from, LPINT from_len, LPWSAOVERLAPPED overlapped = nullptr,
+    LPWSAOVERLAPPED_COMPLETION_ROUTINE completion_routine = nullptr, Policy = {})
+{
+    auto val = WSARecvFrom(socket, buffers_to_receive, buffers_array_counts,
+        number_of_bytes_received, &flags, from, from_len, overlapped, completion_routine);
+    return Policy::apply(val, error::is_socket_io_failed, __FUNCTION__);
+}
+
+/// <summary>
+/// 该函数从绑定(bind)的无连接套接字接收一个数据报，并获取发送者的地址。若没有数据报，则调用线程被阻塞
+/// </summary>
+/// <param name="socket">一个标识已绑定的套接字的描述符</param>
+/// <param name="buffer">[out]一个指向要接收数据报的缓存区的指针</param>
+/// <param name="buffer_len">缓冲区的长度(以字节为单位)，若小于数据报，数据报被截断，函数以WSAEMSGSIZE失败</param>
+/// <param name="from">[opt,out]接收发送者的地址</param>
+/// <param name="from_len">[opt,in,out]from的长度，返回地址的实际长度</param>
+/// <param name="flags">一组影响此函数行为的标志，请看文档</param>
+/// <returns>若没有错误发送，返回接收到的字节数，否则返回SOCKET_ERROR，返回值的类型由错误处理策略决定</returns>
+template <typename Policy = MY_WINDOWS_ERROR_POLICY>
+inline auto socket_recv_from(SOCKET socket, char* buffer, int buffer_len, sockaddr* from = nullptr, int* from_len = nullptr, int flags = 0, Policy = {})
+{
+    MW_TRACE_SCOPE(socket, socket);
+    auto val = recvfrom(socket, buffer, buffer_len, flags, from, from_len);
+    MW_TRACE_RESULT(val);
+    return Policy::apply(val, error::is_socket_error, __FUNCTION__);
 }
 
 /// <summary>
@@ -184,12 +324,12 @@ inline int socket_recv(SOCKET socket, char* buffer, int buffer_len, int flags =
 /// </summary>
 /// <param name="socket">一个标识套接字的描述符</param>
 /// <param name="how">描述什么类型的操作不再允许的标志，它可以是SD_开头的宏</param>
-/// <returns>若没有错误发生，返回0，否则返回SOCKET_ERROR</returns>
-inline int socket_shutdown(SOCKET socket, int how = SD_SEND)
+/// <returns>若没有错误发生，返回0，否则返回SOCKET_ERROR，返回值的类型由错误处理策略决定</returns>
+template <typename Policy = MY_WINDOWS_ERROR_POLICY>
+inline auto socket_shutdown(SOCKET socket, int how = SD_SEND, Policy = {})
 {
     auto val = shutdown(socket, how);
-    GET_ERROR_MSG_OUTPUT_SOCKET();
-    return val;
+    return Policy::apply(val, error::is_socket_error, __FUNCTION__);
 }
 
 /// <summary>
@@ -198,12 +338,12 @@ inline int socket_shutdown(SOCKET socket, int how = SD_SEND)
 /// <param name="socket">标识一个未绑定的套接字的描述符</param>
 /// <param name="address">要赋给绑定的套接字的本地地址</param>
 /// <param name="address_len">address参数的长度(以字节为单位)</param>
-/// <returns>若没有错误发生，返回0，否则返回SOCKET_ERROR</returns>
-inline int socket_bind(SOCKET socket, const sockaddr* address, int address_len)
+/// <returns>若没有错误发生，返回0，否则返回SOCKET_ERROR，返回值的类型由错误处理策略决定</returns>
+template <typename Policy = MY_WINDOWS_ERROR_POLICY>
+inline auto socket_bind(SOCKET socket, const sockaddr* address, int address_len, Policy = {})
 {
     auto val = bind(socket, address, address_len);
-    GET_ERROR_MSG_OUTPUT_SOCKET();
-    return val;
+    return Policy::apply(val, error::is_socket_error, __FUNCTION__);
 }
 
 /// <summary>
@@ -211,12 +351,12 @@ inline int socket_bind(SOCKET socket, const sockaddr* address, int address_len)
 /// </summary>
 /// <param name="socket">标识一个绑定的未连接的套接字的描述符</param>
 /// <param name="backlog">待处理连接队列的最大长度。如果设置为SOMAXCONN，负责 socket的底层服务提供者会将 backlog 设置为一个最大的合理值</param>
-/// <returns>若没有错误发生，返回0，否则返回SOCKET_ERROR</returns>
-inline int socket_listen(SOCKET socket, int backlog = SOMAXCONN)
+/// <returns>若没有错误发生，返回0，否则返回SOCKET_ERROR，返回值的类型由错误处理策略决定</returns>
+template <typename Policy = MY_WINDOWS_ERROR_POLICY>
+inline auto socket_listen(SOCKET socket, int backlog = SOMAXCONN, Policy = {})
 {
     auto val = listen(socket, backlog);
-    GET_ERROR_MSG_OUTPUT_SOCKET();
-    return val;
+    return Policy::apply(val, error::is_socket_error, __FUNCTION__);
 }
 
 /// <summary>
@@ -225,12 +365,23 @@ inline int socket_listen(SOCKET socket, int backlog = SOMAXCONN)
 /// <param name="socket">一个标识已经置于监听状态的套接字的描述符，该函数实际建立连接</param>
 /// <param name="address">[opt,out]用于接收连接实体的地址的结构体</param>
 /// <param name="address_len">[opt,in,out]一个指向整数的可选指针，该整数包含由address参数指向的结构的长度，返回地址的实际长度(byte)</param>
-/// <returns>若没有错误发送，返回新创建的连接的套接字，否则返回INVALID_SOCKET</returns>
-inline SOCKET socket_accept(SOCKET socket, sockaddr* address = nullptr, int* address_len = nullptr)
+/// <returns>若没有错误发送，返回新创建的连接的套接字，否则返回INVALID_SOCKET，返回值的类型由错误处理策略决定</returns>
+template <typename Policy = MY_WINDOWS_ERROR_POLICY>
+inline auto socket_accept(SOCKET socket, sockaddr* address = nullptr, int* address_len = nullptr, Policy = {})
 {
+    MW_TRACE_SCOPE(socket, socket);
     auto val = accept(socket, address, address_len);
-    GET_ERROR_MSG_OUTPUT_SOCKET();
-    return val;
+    MW_TRACE_RESULT(val);
+    return Policy::apply(val, error::is_invalid_socket, __FUNCTION__);
+}
+
+/// <summary>
+/// 与socket_accept相同，但返回unique_socket，析构时自动关闭
+/// </summary>
+template <typename... Args>
+inline unique_socket socket_accept(unique_tag, Args&&... args)
+{
+    return unique_socket(socket_accept(std::forward<Args>(args)...));
 }
 
 }; // namespace mw::socket
\ No newline at end of file
@@ -24,7 +24,7 @@ inline bool system_parameters(UINT action_type, UINT extra_param = 0,
 /// </summary>
 /// <param name="bmp_file_name">图片文件路径</param>
 /// <returns>操作是否成功</returns>
-inline bool set_desktop_wallpaper(const std::tstring& wallpaper_file_name)
+inline bool set_desktop_wallpaper(tzstring_view wallpaper_file_name)
 {
     return system_parameters(SPI_SETDESKWALLPAPER, 0, const_cast<TCHAR*>(wallpaper_file_name.c_str()));
 }
@@ -83,6 +83,9 @@ inline HBRUSH get_system_color_brush(int index)
 /// <summary>
 /// 获取自系统启动以来的毫秒数
 /// </summary>
+/// <remarks>
+/// 它的分辨率约为15毫秒，适合计算超时和到期时间；测量耗时请使用mw::clock::monotonic_clock，tsc_clock或stopwatch
+/// </remarks>
 /// <returns>获取自系统启动以来的毫秒数</returns>
 inline ULONGLONG get_system_time()
 {
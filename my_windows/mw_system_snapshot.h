@@ -0,0 +1,782 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#ifdef _WIN32
+#    include "mw_utility.h"
+#else
+#    include <cstdio>
+#    include <cstdlib>
+#    include <dirent.h>
+#    include <unistd.h>
+#endif
+
+namespace mw {
+
+#ifdef _WIN32
+using snapshot_char = TCHAR;
+#else
+using snapshot_char = char;
+#endif
+using snapshot_string = std::basic_string<snapshot_char>;
+using snapshot_string_view = std::basic_string_view<snapshot_char>;
+
+#ifndef _WIN32
+/// <summary>
+/// 读取/proc中的一个文件，这些文件的大小是0，只能读到文件尾，失败时返回false
+/// </summary>
+inline bool read_proc_file(const char* path, std::string& content)
+{
+    content.clear();
+    auto file = std::fopen(path, "r");
+    if (!file)
+        return false;
+    char buffer[4096];
+    for (std::size_t count; (count = std::fread(buffer, 1, sizeof(buffer), file)) > 0;)
+        content.append(buffer, count);
+    std::fclose(file);
+    return true;
+}
+
+/// <summary>
+/// /proc/[pid]/maps中的一行，它描述一段具有相同权限和后备对象的地址空间
+/// </summary>
+struct proc_maps_entry
+{
+    std::uintptr_t start = 0;
+    std::uintptr_t end = 0;
+    /// <summary>权限，例如"r-xp"，最后一个字符p表示私有(写时复制)，s表示共享</summary>
+    char permissions[5] = {};
+    std::uint64_t offset = 0;
+    std::uint64_t inode = 0;
+    /// <summary>映射的文件路径或[heap]，[stack]等伪路径，匿名映射为空。它指向传给parse_proc_maps_line的行</summary>
+    std::string_view path;
+
+    bool readable() const noexcept { return permissions[0] == 'r'; }
+    bool writable() const noexcept { return permissions[1] == 'w'; }
+    bool executable() const noexcept { return permissions[2] == 'x'; }
+    bool shared() const noexcept { return permissions[3] == 's'; }
+    bool is_file() const noexcept { return !path.empty() && path.front() == '/'; }
+};
+
+/// <summary>
+/// 解析/proc/[pid]/maps的一行，格式为"start-end perms offset major:minor inode path"，路径可以包含空格
+/// </summary>
+/// <returns>该行格式是否正确</returns>
+inline bool parse_proc_maps_line(std::string_view line, proc_maps_entry& entry)
+{
+    std::size_t position = 0;
+    auto parse_number = [&](int base, std::uint64_t& value) {
+        auto begin = position;
+        value = 0;
+        for (; position < line.size(); position++)
+        {
+            auto c = line[position];
+            int digit = c >= '0' && c <= '9' ? c - '0' : (base == 16 && c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1);
+            if (digit < 0)
+                break;
+            value = value * base + digit;
+        }
+        return position != begin;
+    };
+    auto skip = [&](char c) {
+        if (position >= line.size() || line[position] != c)
+            return false;
+        while (position < line.size() && line[position] == c)
+            position++;
+        return true;
+    };
+
+    std::uint64_t start = 0;
+    std::uint64_t end = 0;
+    std::uint64_t device = 0;
+    if (!parse_number(16, start) || !skip('-') || !parse_number(16, end) || !skip(' ') || line.size() < position + 4)
+        return false;
+    for (int i = 0; i < 4; i++)
+        entry.permissions[i] = line[position++];
+    entry.permissions[4] = 0;
+    if (!skip(' ') || !parse_number(16, entry.offset) || !skip(' ') || !parse_number(16, device) || !skip(':')
+        || !parse_number(16, device) || !skip(' ') || !parse_number(10, entry.inode))
+        return false;
+    entry.start = static_cast<std::uintptr_t>(start);
+    entry.end = static_cast<std::uintptr_t>(end);
+    skip(' ');
+    entry.path = line.substr(position);
+    return true;
+}
+
+/// <summary>
+/// 读取/proc/[pid]/maps并对其中的每一行调用callback(const proc_maps_entry&)，按地址从低到高
+/// </summary>
+/// <param name="process_id">进程ID，0表示当前进程</param>
+/// <param name="maps">读取文件使用的缓冲区，可以在多次调用之间复用，entry.path指向它</param>
+/// <returns>文件是否可以读取</returns>
+template <typename Callback>
+inline bool for_each_proc_maps_entry(std::uint32_t process_id, std::string& maps, Callback&& callback)
+{
+    char path[64];
+    if (process_id)
+        std::snprintf(path, sizeof(path), "/proc/%u/maps", process_id);
+    else
+        std::snprintf(path, sizeof(path), "/proc/self/maps");
+    if (!read_proc_file(path, maps))
+        return false;
+
+    proc_maps_entry entry;
+    for (std::size_t begin = 0; begin < maps.size();)
+    {
+        auto end = maps.find('\n', begin);
+        if (end == std::string::npos)
+            end = maps.size();
+        std::string_view line(maps.data() + begin, end - begin);
+        begin = end + 1;
+        if (parse_proc_maps_line(line, entry))
+            callback(entry);
+    }
+    return true;
+}
+#endif
+
+/// <summary>
+/// 快照中的一个进程
+/// </summary>
+struct process_record
+{
+    std::uint32_t process_id = 0;
+    std::uint32_t parent_process_id = 0;
+    /// <summary>进程的线程数</summary>
+    std::uint32_t thread_count = 0;
+    /// <summary>进程创建的线程的基本优先级</summary>
+    long base_priority = 0;
+    /// <summary>可执行文件的名字，不含路径(Linux上是comm)</summary>
+    snapshot_string exe_file;
+};
+
+/// <summary>
+/// 快照中的一个模块(Linux上是映射了文件的一段地址空间)
+/// </summary>
+struct module_record
+{
+    std::uint32_t process_id = 0;
+    std::uintptr_t base_address = 0;
+    std::size_t size = 0;
+    /// <summary>模块的文件名，不含路径</summary>
+    snapshot_string name;
+    snapshot_string path;
+};
+
+/// <summary>
+/// 快照中的一个线程
+/// </summary>
+struct thread_record
+{
+    std::uint32_t thread_id = 0;
+    std::uint32_t owner_process_id = 0;
+    long base_priority = 0;
+};
+
+/// <summary>
+/// 两次快照之间的变化
+/// </summary>
+struct snapshot_diff
+{
+    std::vector<process_record> started_processes;
+    std::vector<process_record> exited_processes;
+    std::vector<module_record> loaded_modules;
+    std::vector<module_record> unloaded_modules;
+    std::vector<thread_record> started_threads;
+    std::vector<thread_record> exited_threads;
+
+    bool empty() const noexcept
+    {
+        return started_processes.empty() && exited_processes.empty() && loaded_modules.empty()
+            && unloaded_modules.empty() && started_threads.empty() && exited_threads.empty();
+    }
+};
+
+/// <summary>
+/// 进程，模块和线程的快照，一次性展开到连续的数组中，并建立按PID，TID，模块基址和名字的哈希索引
+/// </summary>
+/// <remarks>
+/// tool_help的process_find和module_find每次查找都遍历整个快照，该类在capture时遍历一次，之后的查找都是O(1)且不分配内存。
+/// 线程和模块按所属进程连续存放，threads_of和modules_of返回的是数组中的一段。名字索引保存指向记录的string_view，
+/// 所以记录在下一次capture或refresh之前不会移动，该类也不能复制或移动。
+/// Windows上名字比较不区分ASCII大小写，与文件系统一致；Linux上从/proc读取，区分大小写。
+/// refresh重新拍摄快照，并与上一次比较得出启动和退出的进程，载入和卸载的模块，两份数据交替使用，不会重复分配数组
+/// </remarks>
+class system_snapshot
+{
+public:
+    /// <summary>
+    /// 快照包含的部分，可以组合
+    /// </summary>
+    enum parts : unsigned
+    {
+        processes = 1,
+        threads = 2,
+        modules = 4,
+        all = processes | threads | modules
+    };
+
+    /// <summary>传给capture的module_process_id，表示拍摄所有进程的模块，无权访问的进程被跳过</summary>
+    static constexpr std::uint32_t all_processes = 0xFFFFFFFF;
+
+    system_snapshot() = default;
+    system_snapshot(const system_snapshot&) = delete;
+    system_snapshot(system_snapshot&&) = delete;
+    system_snapshot& operator=(const system_snapshot&) = delete;
+    system_snapshot& operator=(system_snapshot&&) = delete;
+
+public:
+    /// <summary>
+    /// 拍摄快照，替换之前的内容
+    /// </summary>
+    /// <param name="snapshot_parts">要包含的部分，它是parts的组合</param>
+    /// <param name="module_process_id">拍摄哪个进程的模块，0表示当前进程，all_processes表示所有进程</param>
+    /// <returns>操作是否成功，只有进程或线程列表无法获取时才失败，单个进程的模块无法获取时跳过</returns>
+    bool capture(unsigned snapshot_parts = all, std::uint32_t module_process_id = 0)
+    {
+        this->snapshot_parts = snapshot_parts;
+        this->module_process_id = module_process_id;
+        auto& next = storage[1 - current_index];
+        if (!next.capture(snapshot_parts, module_process_id))
+            return false;
+        current_index = 1 - current_index;
+        storage[1 - current_index].clear();
+        return true;
+    }
+
+    /// <summary>
+    /// 使用上一次capture的参数重新拍摄快照，并报告与上一次的区别
+    /// </summary>
+    /// <param name="diff">[out]接收变化，它的内容先被清空。同一PID但可执行文件名不同的进程视为旧进程退出，新进程启动</param>
+    /// <returns>操作是否成功，失败时快照保持不变</returns>
+    bool refresh(snapshot_diff& diff)
+    {
+        diff.started_processes.clear();
+        diff.exited_processes.clear();
+        diff.loaded_modules.clear();
+        diff.unloaded_modules.clear();
+        diff.started_threads.clear();
+        diff.exited_threads.clear();
+
+        auto& previous = storage[current_index];
+        auto& next = storage[1 - current_index];
+        if (!next.capture(snapshot_parts, module_process_id))
+            return false;
+
+        for (auto& process : next.process_list)
+        {
+            auto old_process = previous.find_process(process.process_id);
+            if (!old_process || !same_name(old_process->exe_file, process.exe_file))
+                diff.started_processes.push_back(process);
+        }
+        for (auto& process : previous.process_list)
+        {
+            auto new_process = next.find_process(process.process_id);
+            if (!new_process || !same_name(new_process->exe_file, process.exe_file))
+                diff.exited_processes.push_back(process);
+        }
+        for (auto& module : next.module_list)
+        {
+            if (!previous.find_module(module.process_id, module.base_address))
+                diff.loaded_modules.push_back(module);
+        }
+        for (auto& module : previous.module_list)
+        {
+            if (!next.find_module(module.process_id, module.base_address))
+                diff.unloaded_modules.push_back(module);
+        }
+        for (auto& thread : next.thread_list)
+        {
+            if (!previous.find_thread(thread.thread_id))
+                diff.started_threads.push_back(thread);
+        }
+        for (auto& thread : previous.thread_list)
+        {
+            if (!next.find_thread(thread.thread_id))
+                diff.exited_threads.push_back(thread);
+        }
+
+        current_index = 1 - current_index;
+        previous.clear();
+        return true;
+    }
+
+public:
+    const std::vector<process_record>& process_records() const noexcept { return storage[current_index].process_list; }
+    const std::vector<module_record>& module_records() const noexcept { return storage[current_index].module_list; }
+    const std::vector<thread_record>& thread_records() const noexcept { return storage[current_index].thread_list; }
+
+    /// <summary>
+    /// 按PID查找进程，若不存在，返回nullptr
+    /// </summary>
+    const process_record* find_process(std::uint32_t process_id) const noexcept { return storage[current_index].find_process(process_id); }
+
+    /// <summary>
+    /// 按可执行文件名查找进程，有多个时返回其中任意一个，若不存在，返回nullptr
+    /// </summary>
+    const process_record* find_process(snapshot_string_view exe_file) const
+    {
+        auto& data = storage[current_index];
+        auto it = data.process_by_name.find(exe_file);
+        return it == data.process_by_name.end() ? nullptr : &data.process_list[it->second];
+    }
+
+    /// <summary>
+    /// 对每个可执行文件名为exe_file的进程调用callback(const process_record&)
+    /// </summary>
+    template <typename Callback>
+    void for_each_process(snapshot_string_view exe_file, Callback&& callback) const
+    {
+        auto& data = storage[current_index];
+        auto range = data.process_by_name.equal_range(exe_file);
+        for (auto it = range.first; it != range.second; ++it)
+            callback(data.process_list[it->second]);
+    }
+
+    /// <summary>
+    /// 按TID查找线程，若不存在，返回nullptr
+    /// </summary>
+    const thread_record* find_thread(std::uint32_t thread_id) const noexcept { return storage[current_index].find_thread(thread_id); }
+
+    /// <summary>
+    /// 按进程和基址查找模块，若不存在，返回nullptr
+    /// </summary>
+    const module_record* find_module(std::uint32_t process_id, std::uintptr_t base_address) const noexcept
+    {
+        return storage[current_index].find_module(process_id, base_address);
+    }
+
+    /// <summary>
+    /// 按进程和模块名(不含路径)或完整路径查找模块，若不存在，返回nullptr
+    /// </summary>
+    const module_record* find_module(std::uint32_t process_id, snapshot_string_view name) const
+    {
+        auto& data = storage[current_index];
+        auto it = data.module_by_name.find(module_name_key { process_id, name });
+        return it == data.module_by_name.end() ? nullptr : &data.module_list[it->second];
+    }
+
+    /// <summary>
+    /// 获取指定进程的所有模块，它们在数组中是连续的
+    /// </summary>
+    /// <returns>[first, last)，若没有，两者相等</returns>
+    std::pair<const module_record*, const module_record*> modules_of(std::uint32_t process_id) const noexcept
+    {
+        auto& data = storage[current_index];
+        return data.slice(data.module_list, data.module_range, process_id);
+    }
+
+    /// <summary>
+    /// 获取指定进程的所有线程，它们在数组中是连续的
+    /// </summary>
+    /// <returns>[first, last)，若没有，两者相等</returns>
+    std::pair<const thread_record*, const thread_record*> threads_of(std::uint32_t process_id) const noexcept
+    {
+        auto& data = storage[current_index];
+        return data.slice(data.thread_list, data.thread_range, process_id);
+    }
+
+private:
+    static snapshot_char fold(snapshot_char c) noexcept
+    {
+#ifdef _WIN32
+        return c >= 'A' && c <= 'Z' ? static_cast<snapshot_char>(c + ('a' - 'A')) : c;
+#else
+        return c;
+#endif
+    }
+
+    static bool same_name(snapshot_string_view left, snapshot_string_view right) noexcept
+    {
+        if (left.size() != right.size())
+            return false;
+        for (std::size_t i = 0; i < left.size(); i++)
+        {
+            if (fold(left[i]) != fold(right[i]))
+                return false;
+        }
+        return true;
+    }
+
+    struct name_hash
+    {
+        std::size_t operator()(snapshot_string_view name) const noexcept
+        {
+            // FNV-1a
+            std::size_t hash = 14695981039346656037ull & SIZE_MAX;
+            for (auto c : name)
+                hash = (hash ^ static_cast<std::size_t>(fold(c))) * (sizeof(std::size_t) == 8 ? 1099511628211ull : 16777619u);
+            return hash;
+        }
+    };
+
+    struct name_equal
+    {
+        bool operator()(snapshot_string_view left, snapshot_string_view right) const noexcept { return same_name(left, right); }
+    };
+
+    struct module_address_key
+    {
+        std::uint32_t process_id;
+        std::uintptr_t base_address;
+        bool operator==(const module_address_key& other) const noexcept
+        {
+            return process_id == other.process_id && base_address == other.base_address;
+        }
+    };
+
+    struct module_address_hash
+    {
+        std::size_t operator()(const module_address_key& key) const noexcept
+        {
+            return std::hash<std::uintptr_t>()(key.base_address) ^ (std::hash<std::uint32_t>()(key.process_id) * 0x9E3779B9u);
+        }
+    };
+
+    struct module_name_key
+    {
+        std::uint32_t process_id;
+        snapshot_string_view name;
+    };
+
+    struct module_name_hash
+    {
+        std::size_t operator()(const module_name_key& key) const noexcept
+        {
+            return name_hash()(key.name) ^ (std::hash<std::uint32_t>()(key.process_id) * 0x9E3779B9u);
+        }
+    };
+
+    struct module_name_equal
+    {
+        bool operator()(const module_name_key& left, const module_name_key& right) const noexcept
+        {
+            return left.process_id == right.process_id && same_name(left.name, right.name);
+        }
+    };
+
+    /// <summary>
+    /// 一份快照的数据和索引
+    /// </summary>
+    struct snapshot_data
+    {
+        std::vector<process_record> process_list;
+        std::vector<module_record> module_list;
+        std::vector<thread_record> thread_list;
+
+        std::unordered_map<std::uint32_t, std::size_t> process_by_id;
+        std::unordered_multimap<snapshot_string_view, std::size_t, name_hash, name_equal> process_by_name;
+        std::unordered_map<std::uint32_t, std::size_t> thread_by_id;
+        std::unordered_map<module_address_key, std::size_t, module_address_hash> module_by_address;
+        std::unordered_map<module_name_key, std::size_t, module_name_hash, module_name_equal> module_by_name;
+        /// <summary>每个进程的模块和线程在数组中的范围[first, last)</summary>
+        std::unordered_map<std::uint32_t, std::pair<std::size_t, std::size_t>> module_range;
+        std::unordered_map<std::uint32_t, std::pair<std::size_t, std::size_t>> thread_range;
+
+        void clear() noexcept
+        {
+            process_list.clear();
+            module_list.clear();
+            thread_list.clear();
+            process_by_id.clear();
+            process_by_name.clear();
+            thread_by_id.clear();
+            module_by_address.clear();
+            module_by_name.clear();
+            module_range.clear();
+            thread_range.clear();
+        }
+
+        const process_record* find_process(std::uint32_t process_id) const noexcept
+        {
+            auto it = process_by_id.find(process_id);
+            return it == process_by_id.end() ? nullptr : &process_list[it->second];
+        }
+
+        const thread_record* find_thread(std::uint32_t thread_id) const noexcept
+        {
+            auto it = thread_by_id.find(thread_id);
+            return it == thread_by_id.end() ? nullptr : &thread_list[it->second];
+        }
+
+        const module_record* find_module(std::uint32_t process_id, std::uintptr_t base_address) const noexcept
+        {
+            auto it = module_by_address.find(module_address_key { process_id, base_address });
+            return it == module_by_address.end() ? nullptr : &module_list[it->second];
+        }
+
+        template <typename T>
+        static std::pair<const T*, const T*> slice(const std::vector<T>& list,
+            const std::unordered_map<std::uint32_t, std::pair<std::size_t, std::size_t>>& ranges, std::uint32_t process_id) noexcept
+        {
+            auto it = ranges.find(process_id);
+            if (it == ranges.end())
+                return { nullptr, nullptr };
+            return { list.data() + it->second.first, list.data() + it->second.second };
+        }
+
+        bool capture(unsigned snapshot_parts, std::uint32_t module_process_id)
+        {
+            clear();
+            if (!capture_processes_and_threads(snapshot_parts))
+                return false;
+            if (snapshot_parts & modules)
+                capture_modules(module_process_id);
+            build_indexes();
+            return true;
+        }
+
+        /// <summary>
+        /// 在数组不再变化之后建立索引，这样索引中的string_view不会失效
+        /// </summary>
+        void build_indexes()
+        {
+            std::stable_sort(thread_list.begin(), thread_list.end(),
+                [](const thread_record& left, const thread_record& right) { return left.owner_process_id < right.owner_process_id; });
+
+            process_by_id.reserve(process_list.size());
+            process_by_name.reserve(process_list.size());
+            for (std::size_t i = 0; i < process_list.size(); i++)
+            {
+                process_by_id.emplace(process_list[i].process_id, i);
+                process_by_name.emplace(process_list[i].exe_file, i);
+            }
+
+            thread_by_id.reserve(thread_list.size());
+            for (std::size_t i = 0; i < thread_list.size(); i++)
+            {
+                thread_by_id.emplace(thread_list[i].thread_id, i);
+                auto& range = thread_range.try_emplace(thread_list[i].owner_process_id, i, i).first->second;
+                range.second = i + 1;
+            }
+
+            module_by_address.reserve(module_list.size());
+            module_by_name.reserve(module_list.size() * 2);
+            for (std::size_t i = 0; i < module_list.size(); i++)
+            {
+                auto& module = module_list[i];
+                module_by_address.emplace(module_address_key { module.process_id, module.base_address }, i);
+                module_by_name.emplace(module_name_key { module.process_id, module.name }, i);
+                module_by_name.emplace(module_name_key { module.process_id, module.path }, i);
+                auto& range = module_range.try_emplace(module.process_id, i, i).first->second;
+                range.second = i + 1;
+            }
+        }
+
+#ifdef _WIN32
+        bool capture_processes_and_threads(unsigned snapshot_parts)
+        {
+            DWORD flags = ((snapshot_parts & processes) ? TH32CS_SNAPPROCESS : 0) | ((snapshot_parts & threads) ? TH32CS_SNAPTHREAD : 0);
+            if (!flags)
+                return true;
+            tool_help snapshot;
+            if (!snapshot.create_snapshot(flags, 0))
+                return false;
+
+            PROCESSENTRY32 process_entry = { sizeof(process_entry) };
+            for (auto is_ok = (snapshot_parts & processes) && snapshot.process_first(process_entry); is_ok; is_ok = snapshot.process_next(process_entry))
+            {
+                process_record& process = process_list.emplace_back();
+                process.process_id = process_entry.th32ProcessID;
+                process.parent_process_id = process_entry.th32ParentProcessID;
+                process.thread_count = process_entry.cntThreads;
+                process.base_priority = process_entry.pcPriClassBase;
+                process.exe_file = process_entry.szExeFile;
+            }
+
+            THREADENTRY32 thread_entry = { sizeof(thread_entry) };
+            for (auto is_ok = (snapshot_parts & threads) && snapshot.thread_first(thread_entry); is_ok; is_ok = snapshot.thread_next(thread_entry))
+                thread_list.push_back({ thread_entry.th32ThreadID, thread_entry.th32OwnerProcessID, thread_entry.tpBasePri });
+            return true;
+        }
+
+        void capture_modules(std::uint32_t module_process_id)
+        {
+            auto capture_process = [this](DWORD process_id) {
+                tool_help snapshot;
+                // 目标进程正在载入或卸载模块时会返回ERROR_BAD_LENGTH，重试即可
+                for (int retry = 0; retry < 4 && !snapshot.create_snapshot(TH32CS_SNAPMODULE | TH32CS_SNAPMODULE32, process_id); retry++)
+                {
+                    if (GetLastError() != ERROR_BAD_LENGTH)
+                        return;
+                }
+
+                MODULEENTRY32 module_entry = { sizeof(module_entry) };
+                for (auto is_ok = snapshot.module_first(module_entry); is_ok; is_ok = snapshot.module_next(module_entry))
+                {
+                    module_record& module = module_list.emplace_back();
+                    module.process_id = module_entry.th32ProcessID;
+                    module.base_address = reinterpret_cast<std::uintptr_t>(module_entry.modBaseAddr);
+                    module.size = module_entry.modBaseSize;
+                    module.name = module_entry.szModule;
+                    module.path = module_entry.szExePath;
+                }
+            };
+
+            if (module_process_id != all_processes)
+            {
+                capture_process(module_process_id ? module_process_id : GetCurrentProcessId());
+                return;
+            }
+            if (!process_list.empty())
+            {
+                for (auto& process : process_list)
+                    capture_process(process.process_id);
+                return;
+            }
+            tool_help snapshot(TH32CS_SNAPPROCESS, 0);
+            PROCESSENTRY32 process_entry = { sizeof(process_entry) };
+            for (auto is_ok = snapshot.process_first(process_entry); is_ok; is_ok = snapshot.process_next(process_entry))
+                capture_process(process_entry.th32ProcessID);
+        }
+#else
+        /// <summary>
+        /// 解析/proc/[pid]/stat，comm可能包含空格和括号，所以从最后一个')'开始按空格切分
+        /// </summary>
+        static bool parse_stat(const std::string& stat, std::string& comm, std::uint32_t& parent_process_id, long& priority, std::uint32_t& thread_count)
+        {
+            auto open = stat.find('(');
+            auto close = stat.rfind(')');
+            if (open == std::string::npos || close == std::string::npos || close < open)
+                return false;
+            comm.assign(stat, open + 1, close - open - 1);
+
+            // ')'之后依次是state(3) ppid(4) ... priority(18) nice(19) num_threads(20)
+            auto field = stat.c_str() + close + 1;
+            for (int index = 3; index <= 20 && *field; index++)
+            {
+                while (*field == ' ')
+                    field++;
+                char* end = nullptr;
+                if (index == 4)
+                    parent_process_id = static_cast<std::uint32_t>(std::strtoul(field, &end, 10));
+                else if (index == 18)
+                    priority = std::strtol(field, &end, 10);
+                else if (index == 20)
+                    thread_count = static_cast<std::uint32_t>(std::strtoul(field, &end, 10));
+                while (*field && *field != ' ')
+                    field++;
+            }
+            return true;
+        }
+
+        template <typename Callback>
+        static void for_each_numeric_entry(const char* directory, Callback&& callback)
+        {
+            auto dir = opendir(directory);
+            if (!dir)
+                return;
+            while (auto entry = readdir(dir))
+            {
+                char* end = nullptr;
+                auto id = std::strtoul(entry->d_name, &end, 10);
+                if (*entry->d_name && !*end)
+                    callback(static_cast<std::uint32_t>(id));
+            }
+            closedir(dir);
+        }
+
+        bool capture_processes_and_threads(unsigned snapshot_parts)
+        {
+            if (!(snapshot_parts & (processes | threads)))
+                return true;
+            if (!opendir_ok("/proc"))
+                return false;
+
+            std::string stat;
+            std::string comm;
+            char path[64];
+            for_each_numeric_entry("/proc", [&](std::uint32_t process_id) {
+                std::snprintf(path, sizeof(path), "/proc/%u/stat", process_id);
+                process_record process;
+                process.process_id = process_id;
+                if (!read_proc_file(path, stat) || !parse_stat(stat, comm, process.parent_process_id, process.base_priority, process.thread_count))
+                    return;
+                if (snapshot_parts & processes)
+                {
+                    process.exe_file = comm;
+                    process_list.push_back(std::move(process));
+                }
+                if (snapshot_parts & threads)
+                {
+                    char task_path[64];
+                    std::snprintf(task_path, sizeof(task_path), "/proc/%u/task", process_id);
+                    for_each_numeric_entry(task_path, [&](std::uint32_t thread_id) {
+                        thread_record thread { thread_id, process_id, 0 };
+                        std::uint32_t ignored = 0;
+                        std::snprintf(path, sizeof(path), "/proc/%u/task/%u/stat", process_id, thread_id);
+                        if (read_proc_file(path, stat))
+                            parse_stat(stat, comm, ignored, thread.base_priority, ignored);
+                        thread_list.push_back(thread);
+                    });
+                }
+            });
+            return true;
+        }
+
+        static bool opendir_ok(const char* directory)
+        {
+            auto dir = opendir(directory);
+            if (dir)
+                closedir(dir);
+            return dir != nullptr;
+        }
+
+        /// <summary>
+        /// 从/proc/[pid]/maps读取映射了文件的区域，同一个文件的所有区域合并为一个模块，基址是最低的地址
+        /// </summary>
+        void capture_process_modules(std::uint32_t process_id, std::string& maps)
+        {
+            auto first = module_list.size();
+            for_each_proc_maps_entry(process_id, maps, [&](const proc_maps_entry& entry) {
+                if (!entry.is_file())
+                    return;
+                auto it = std::find_if(module_list.begin() + first, module_list.end(),
+                    [&](const module_record& module) { return module.path == entry.path; });
+                if (it == module_list.end())
+                {
+                    module_record& module = module_list.emplace_back();
+                    module.process_id = process_id;
+                    module.base_address = entry.start;
+                    module.size = entry.end - entry.start;
+                    module.path = entry.path;
+                    module.name = entry.path.substr(entry.path.rfind('/') + 1);
+                    return;
+                }
+                auto module_end = (std::max)(it->base_address + it->size, entry.end);
+                it->base_address = (std::min)(it->base_address, entry.start);
+                it->size = module_end - it->base_address;
+            });
+        }
+
+        void capture_modules(std::uint32_t module_process_id)
+        {
+            std::string maps;
+            if (module_process_id != all_processes)
+            {
+                capture_process_modules(module_process_id ? module_process_id : static_cast<std::uint32_t>(getpid()), maps);
+                return;
+            }
+            if (!process_list.empty())
+            {
+                for (auto& process : process_list)
+                    capture_process_modules(process.process_id, maps);
+                return;
+            }
+            for_each_numeric_entry("/proc", [&](std::uint32_t process_id) { capture_process_modules(process_id, maps); });
+        }
+#endif
+    };
+
+    snapshot_data storage[2];
+    int current_index = 0;
+    unsigned snapshot_parts = all;
+    std::uint32_t module_process_id = 0;
+};
+
+} // namespace mw
@@ -0,0 +1,2226 @@
+#pragma once
+#include "mw_buffer_pool.h"
+#include "mw_send_queue.h"
+#ifdef _WIN32
+#    include "mw_device.h"
+#    include "mw_socket.h"
+#    include "mw_system.h"
+#    include "mw_thread.h"
+#    include <MSWSock.h>
+#else
+#    include <climits>
+#    include <condition_variable>
+#    include <pthread.h>
+#    include <sys/epoll.h>
+#    include <sys/eventfd.h>
+#    include <sys/uio.h>
+#    include <thread>
+#endif
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+namespace mw::net {
+
+/// <summary>
+/// tcp_server的选项
+/// </summary>
+struct tcp_server_options
+{
+    /// <summary>反应器(工作线程)数量，若为0则使用处理器数量</summary>
+    DWORD reactor_count = 0;
+    /// <summary>是否把第i个反应器线程绑定到第i个处理器上</summary>
+    bool pin_reactors = true;
+    /// <summary>
+    /// 每个连接的接收缓冲区大小，即服务器自己的缓冲区池的块大小(向上取整到页面大小)，若指定了pool则使用pool的块大小。
+    /// on_data未消费的数据占满该缓冲区时连接会被中止
+    /// </summary>
+    DWORD recv_buffer_size = 16 * 1024;
+    /// <summary>每个连接的发送队列的选项，控制小写入的合并和发送的高水位</summary>
+    send_queue_options send_queue;
+    /// <summary>[opt]接收和发送使用的缓冲区池，它必须比服务器存活得更久，若为nullptr，服务器创建自己的缓冲区池</summary>
+    buffer_pool* pool = nullptr;
+    /// <summary>同时投递的AcceptEx数量，epoll后端中是监听套接字每次就绪时最多接受的连接数</summary>
+    DWORD accept_count = 64;
+    /// <summary>是否为每个连接设置TCP_NODELAY</summary>
+    bool no_delay = true;
+
+    /// <summary>同时存在的接受的连接数上限，达到时不再投递AcceptEx，新连接留在系统的积压队列中，0表示不限制</summary>
+    DWORD max_connections = 0;
+    /// <summary>服务器自己的缓冲区池的块总数上限，它限制了所有连接的接收缓冲区和发送队列占用的内存，0表示不限制。指定了pool时不使用</summary>
+    size_t max_pool_chunks = 0;
+    /// <summary>缓冲区池有块数上限时，剩余的块少于它就暂停接受连接，为已有的连接保留缓冲区</summary>
+    size_t min_free_chunks = 64;
+    /// <summary>暂停接受连接后重新检查的间隔(毫秒)</summary>
+    DWORD accept_retry_interval = 50;
+    /// <summary>
+    /// 卸载负载的目标排队延迟(毫秒)，0表示不卸载。反应器的完成端口中的排队延迟持续shed_interval都超过它时进入过载状态，
+    /// 之后按CoDel的节奏中止新接受的连接，并让tcp_connection::should_shed返回true
+    /// </summary>
+    DWORD shed_target = 0;
+    /// <summary>CoDel的间隔(毫秒)，排队延迟超过shed_target的时间达到它才开始卸载，也是卸载节奏的基准</summary>
+    DWORD shed_interval = 100;
+};
+
+/// <summary>
+/// tcp_server的统计信息
+/// </summary>
+struct tcp_server_stats
+{
+    ULONGLONG accepted = 0;
+    ULONGLONG connected = 0;
+    ULONGLONG active = 0;
+    ULONGLONG bytes_received = 0;
+    ULONGLONG bytes_sent = 0;
+    /// <summary>调用WSASend的次数，与发送的消息数比较可以看出合并的效果</summary>
+    ULONGLONG send_calls = 0;
+
+    /// <summary>当前接受的连接数(不包括connect建立的连接)</summary>
+    ULONGLONG inbound = 0;
+    /// <summary>因为达到max_connections而暂停接受连接的次数</summary>
+    ULONGLONG accept_paused_by_limit = 0;
+    /// <summary>因为缓冲区池将要耗尽或获取块失败而暂停接受连接的次数</summary>
+    ULONGLONG accept_paused_by_memory = 0;
+    /// <summary>当前没有投递的AcceptEx请求数，不为0表示正在暂停接受连接(epoll后端中暂停时为1)</summary>
+    ULONGLONG parked_accepts = 0;
+    /// <summary>因为发送队列超过高水位的一半而暂停接收的次数</summary>
+    ULONGLONG read_pauses = 0;
+    /// <summary>过载时被中止的新连接数</summary>
+    ULONGLONG shed_connections = 0;
+    /// <summary>当前处于过载状态的反应器数</summary>
+    ULONGLONG shedding_reactors = 0;
+    /// <summary>观测到的最大排队延迟(微秒)，只在启用shed_target时测量</summary>
+    ULONGLONG max_queue_delay = 0;
+};
+
+class tcp_server;
+class tcp_connection;
+
+/// <summary>
+/// 连接事件的回调，它们都在连接所属的反应器线程中被调用，同一个连接的回调不会并发执行
+/// </summary>
+struct tcp_handler
+{
+    /// <summary>连接建立(接受或主动连接成功)后调用</summary>
+    std::function<void(tcp_connection&)> on_connect;
+    /// <summary>
+    /// 收到数据后调用，参数是接收缓冲区中所有未消费的数据，返回消费的字节数，未消费的数据会在下次调用时再次传入。
+    /// 若因为send返回false而无法继续处理，返回已处理的字节数即可，连接会暂停接收，直到发送缓冲区排空后再次调用该回调
+    /// </summary>
+    std::function<size_t(tcp_connection&, const char*, size_t)> on_data;
+    /// <summary>连接被关闭且所有I/O都完成后调用，之后连接对象被销毁</summary>
+    std::function<void(tcp_connection&)> on_close;
+    /// <summary>主动连接失败时调用，参数是connect的user_data参数和Windows Socket错误代码(其他平台上是errno)</summary>
+    std::function<void(void*, int)> on_connect_failed;
+};
+
+namespace tcp_detail {
+
+    enum class io_operation
+    {
+        accept,
+        connect,
+        recv,
+        send,
+    };
+
+#ifdef _WIN32
+    /// <summary>
+    /// 一次重叠I/O请求，OVERLAPPED必须是第一个基类，这样完成数据包中的OVERLAPPED指针可以直接转换为它
+    /// </summary>
+    struct io_request : OVERLAPPED
+    {
+        io_operation operation;
+        /// <summary>请求所属的连接，AcceptEx请求为nullptr</summary>
+        tcp_connection* connection = nullptr;
+
+        void reset() { std::memset(static_cast<OVERLAPPED*>(this), 0, sizeof(OVERLAPPED)); }
+        /// <summary>OVERLAPPED的Internal成员是I/O操作的NTSTATUS</summary>
+        bool succeeded() const { return static_cast<LONG>(Internal) >= 0; }
+    };
+
+    struct accept_request : io_request
+    {
+        SOCKET socket = INVALID_SOCKET;
+        char address_buffer[2 * (sizeof(sockaddr_storage) + 16)];
+        /// <summary>因为暂停接受连接而没有投递，等待第0个反应器重新投递</summary>
+        std::atomic<bool> parked { false };
+    };
+#else
+    /// <summary>
+    /// 连接上正在进行的一个操作，epoll后端在套接字就绪时执行它，完成后放入反应器的完成队列
+    /// </summary>
+    struct io_request
+    {
+        io_operation operation;
+        tcp_connection* connection = nullptr;
+    };
+
+    /// <summary>epoll后端的完成队列中的一项，对应IOCP的一个完成数据包</summary>
+    struct io_completion
+    {
+        tcp_connection* connection;
+        io_operation operation;
+        bool succeeded;
+        DWORD bytes;
+    };
+
+    /// <summary>epoll事件的data.u64中表示唤醒事件和监听套接字的值，连接的指针不会是这两个值</summary>
+    enum : std::uint64_t
+    {
+        epoll_wake = 0,
+        epoll_listener = 1,
+    };
+#endif
+
+    enum : ULONG_PTR
+    {
+        key_io = 0,
+        key_attach = 1,
+        key_shutdown = 2,
+        key_abort = 3,
+        key_call = 4,
+        key_probe = 5,
+    };
+
+    /// <summary>单调时钟的当前时间(毫秒)，用于flush_delay，停止的超时和重试间隔</summary>
+    inline ULONGLONG now_milliseconds()
+    {
+#ifdef _WIN32
+        return mw::get_system_time();
+#else
+        return GetTickCount64();
+#endif
+    }
+
+    /// <summary>单调时钟的当前时间(微秒)，用于测量排队延迟</summary>
+    inline ULONGLONG now_microseconds()
+    {
+        auto time = std::chrono::steady_clock::now().time_since_epoch();
+        return static_cast<ULONGLONG>(std::chrono::duration_cast<std::chrono::microseconds>(time).count());
+    }
+
+    class reactor;
+
+} // namespace tcp_detail
+
+/// <summary>
+/// 一个TCP连接，它由tcp_server创建和销毁，只能在它所属的反应器线程中(即tcp_handler的回调中)使用
+/// </summary>
+class tcp_connection
+{
+    friend class tcp_server;
+    friend class tcp_detail::reactor;
+
+public:
+    tcp_connection(const tcp_connection&) = delete;
+    tcp_connection(tcp_connection&&) = delete;
+    tcp_connection& operator=(const tcp_connection&) = delete;
+    tcp_connection& operator=(tcp_connection&&) = delete;
+
+public:
+    /// <summary>
+    /// 把数据复制到发送队列，数据会和同一轮事件中的其他写入合并后发送(见send_queue_options)
+    /// </summary>
+    /// <param name="data">要发送的数据</param>
+    /// <param name="size">数据的字节数</param>
+    /// <returns>若连接正在关闭，发送队列超过高水位，或缓冲区池已耗尽(此时不会复制任何数据)，返回false</returns>
+    inline bool send(const void* data, size_t size);
+
+    /// <summary>
+    /// 不复制数据，直接把缓冲区池中的块的一部分放入发送队列，发送完成后释放对块的引用
+    /// </summary>
+    /// <remarks>
+    /// 块必须来自服务器使用的缓冲区池或其他仍然存活的池。可以用它把receive_buffer原样发回，或者把同一个块发送给多个连接，
+    /// 在发送完成之前不应修改块中的数据
+    /// </remarks>
+    /// <param name="buffer">要发送的块</param>
+    /// <param name="offset">数据在块中的偏移</param>
+    /// <param name="size">数据的字节数，offset + size不能超过块的有效字节数</param>
+    /// <returns>若连接正在关闭，或发送队列超过高水位，返回false</returns>
+    inline bool send(buffer_ref buffer, size_t offset, size_t size);
+
+    /// <summary>
+    /// 把多段数据作为一个整体复制到发送队列，它们要么全部被排队，要么都不被排队，例如响应头和响应体
+    /// </summary>
+    /// <param name="buffers">要发送的数据的数组</param>
+    /// <param name="count">数组的元素数量</param>
+    /// <returns>若连接正在关闭，发送队列超过高水位，或缓冲区池已耗尽(此时不会复制任何数据)，返回false</returns>
+    inline bool send(const WSABUF* buffers, DWORD count);
+
+    /// <summary>
+    /// 立即发送发送队列中排队的数据，而不等待当前事件轮次结束或flush_delay到期
+    /// </summary>
+    inline void flush();
+
+    /// <summary>
+    /// 设置是否塞住连接，塞住时排队的数据只有达到flush_threshold才会被发送，取消塞住时发送所有排队的数据。
+    /// 它类似于TCP_CORK，用于把一个逻辑响应的多次写入合并为尽量少的报文段
+    /// </summary>
+    inline void set_cork(bool cork);
+    bool is_corked() const { return corked; }
+
+    /// <summary>
+    /// 设置套接字的TCP_NODELAY选项，发送队列已经在用户态合并小写入，所以通常应该禁用Nagle算法
+    /// </summary>
+    /// <returns>操作是否成功</returns>
+    bool set_no_delay(bool no_delay)
+    {
+        BOOL value = no_delay ? TRUE : FALSE;
+        return setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&value), sizeof(value)) != SOCKET_ERROR;
+    }
+
+    /// <summary>
+    /// 获取当前接收缓冲区(缓冲区池中的块)的引用，on_data的数据参数指向该块内部，数据在块中的偏移为data - buffer.data()
+    /// </summary>
+    /// <remarks>
+    /// 持有该引用时连接不会再向这个块写入数据，下次接收会换一个新块，所以数据可以在on_data返回后继续安全地使用
+    /// </remarks>
+    buffer_ref receive_buffer() const { return recv_chunk; }
+
+    /// <summary>
+    /// 优雅地关闭连接，已经在发送缓冲区中的数据会被发送完毕，之后不再接收数据
+    /// </summary>
+    inline void close();
+
+    /// <summary>
+    /// 立即中止连接(发送RST)，未发送的数据被丢弃
+    /// </summary>
+    inline void abort();
+
+    /// <summary>
+    /// 获取发送队列中还未发送完成的字节数
+    /// </summary>
+    size_t pending_send_bytes() const { return queue.pending_bytes(); }
+
+    /// <summary>
+    /// 获取发送队列在达到高水位之前剩余可以写入的字节数
+    /// </summary>
+    size_t send_capacity_left() const { return queue.capacity_left(); }
+
+    bool is_closing() const { return closing; }
+
+    /// <summary>
+    /// 连接所属的反应器处于过载状态(见tcp_server_options::shed_target)，并且按CoDel的节奏现在应该丢弃一个请求时返回true，
+    /// 此时应该快速拒绝当前请求(例如响应503)而不是处理它。只能在连接的回调中调用，每次返回true都会推迟下一次丢弃的时间
+    /// </summary>
+    inline bool should_shed();
+    SOCKET native_handle() const { return socket; }
+    ULONGLONG id() const { return connection_id; }
+    /// <summary>对端地址</summary>
+    const sockaddr_storage& remote_address() const { return remote; }
+    /// <summary>是否是通过connect主动建立的连接</summary>
+    bool is_outbound() const { return outbound; }
+    tcp_server& server() const { return *owner; }
+    /// <summary>连接所属的反应器的序号，可以用tcp_server::post在该反应器线程中执行操作</summary>
+    inline DWORD reactor_index() const;
+
+    /// <summary>用户数据，tcp_server不会使用它</summary>
+    void* user_data = nullptr;
+
+private:
+    tcp_connection(tcp_server* owner, tcp_detail::reactor* reactor, buffer_pool* pool, SOCKET socket, ULONGLONG id,
+        const send_queue_options& send_options)
+        : owner(owner)
+        , reactor(reactor)
+        , pool(pool)
+        , socket(socket)
+        , connection_id(id)
+        , queue(*pool, send_options)
+    {
+        recv_request.operation = tcp_detail::io_operation::recv;
+        recv_request.connection = this;
+        send_request.operation = tcp_detail::io_operation::send;
+        send_request.connection = this;
+        std::memset(&remote, 0, sizeof(remote));
+    }
+
+    tcp_server* owner;
+    tcp_detail::reactor* reactor;
+    buffer_pool* pool;
+    SOCKET socket;
+    ULONGLONG connection_id;
+    sockaddr_storage remote;
+    bool outbound = false;
+
+    /// <summary>接收缓冲区，在第一次接收时获取，被其他地方引用时换成新块</summary>
+    buffer_ref recv_chunk;
+    size_t recv_begin = 0;
+    size_t recv_end = 0;
+
+    send_queue queue;
+    bool corked = false;
+    /// <summary>连接在反应器的待发送链表中，等待当前事件轮次结束或flush_delay到期</summary>
+    bool flush_scheduled = false;
+    ULONGLONG flush_deadline = 0;
+    tcp_connection* flush_prev = nullptr;
+    tcp_connection* flush_next = nullptr;
+
+    tcp_detail::io_request recv_request;
+    tcp_detail::io_request send_request;
+    bool recv_pending = false;
+    bool send_pending = false;
+    bool recv_paused = false;
+    bool established = false;
+    bool closing = false;
+    /// <summary>反应器正在处理该连接的事件(或正在执行post的调用)，此时即使满足条件也不销毁连接，处理完毕后再销毁</summary>
+    bool busy = false;
+#ifndef _WIN32
+    // epoll后端：边沿触发下套接字是否可能可读/可写，为false时要等下一个事件
+    bool readable = false;
+    bool writable = false;
+    /// <summary>接收或发送已经完成，完成放在反应器的完成队列中还未处理</summary>
+    bool recv_completion_queued = false;
+    bool send_completion_queued = false;
+    /// <summary>已经销毁，等这一批epoll事件处理完毕后释放，之后的事件忽略它</summary>
+    bool retired = false;
+    /// <summary>主动连接失败时SO_ERROR的值</summary>
+    int connect_error = 0;
+    /// <summary>正在发送的数组(来自send_queue::prepare_send)和其中已经写入套接字的字节数</summary>
+    const WSABUF* send_buffers = nullptr;
+    DWORD send_count = 0;
+    size_t send_written = 0;
+#endif
+
+    // 反应器的连接链表
+    tcp_connection* prev = nullptr;
+    tcp_connection* next = nullptr;
+};
+
+namespace tcp_detail {
+
+    /// <summary>
+    /// 反应器，一个线程和一个I/O完成端口(其他平台上是一个epoll实例)，连接的所有I/O完成数据包都在它所属的反应器线程中处理，所以连接的状态不需要加锁
+    /// </summary>
+    class reactor
+    {
+    public:
+        reactor(tcp_server* owner, DWORD index)
+            : owner(owner)
+            , index(index)
+        {
+        }
+
+        inline bool start(bool pin);
+        inline void run();
+        /// <summary>向反应器投递一个事件(key_attach，key_call等)，可以在任意线程中调用</summary>
+        inline bool post_event(ULONG_PTR key, void* data);
+        inline bool has_thread() const;
+        /// <summary>等待反应器线程退出，超时返回false</summary>
+        inline bool wait_exit(DWORD timeout);
+        /// <summary>等待反应器线程退出并释放线程，完成端口和还未执行的post调用</summary>
+        inline void join();
+
+        inline void handle_event(ULONG_PTR key, void* data);
+        inline void io_completed(tcp_connection* connection, io_operation operation, bool succeeded, DWORD bytes);
+        inline bool end_round(DWORD& timeout);
+        inline void release_deferred();
+        inline void attach(tcp_connection* connection);
+        inline void connected(tcp_connection* connection, bool succeeded);
+        inline void post_recv(tcp_connection* connection);
+        inline void recv_completed(tcp_connection* connection, bool succeeded, DWORD bytes);
+        inline void deliver(tcp_connection* connection);
+        inline void schedule_flush(tcp_connection* connection);
+        inline void unschedule_flush(tcp_connection* connection);
+        inline DWORD flush_due();
+        inline void flush_send(tcp_connection* connection);
+        inline void send_completed(tcp_connection* connection, bool succeeded, DWORD bytes);
+        inline void finish_close(tcp_connection* connection);
+        inline void abort(tcp_connection* connection);
+        inline void close_socket(tcp_connection* connection);
+        inline void try_destroy(tcp_connection* connection);
+        inline void discard_calls();
+        inline DWORD timers_due(DWORD flush_timeout);
+        inline void probe_completed();
+        inline bool should_shed();
+
+#ifdef _WIN32
+        static DWORD WINAPI thread_function(LPVOID param)
+        {
+            static_cast<reactor*>(param)->run();
+            return 0;
+        }
+#else
+        inline bool watch(tcp_connection* connection);
+        inline bool watch_listener(SOCKET socket);
+        inline void listen_interest(bool enabled);
+        inline void take_posted();
+        inline void ready(tcp_connection* connection, std::uint32_t events);
+        inline void read_now(tcp_connection* connection);
+        inline void write_now(tcp_connection* connection);
+        inline void complete(tcp_connection* connection, io_operation operation, bool succeeded, DWORD bytes);
+        inline void run_completions();
+        inline void bury();
+#endif
+
+        tcp_server* owner;
+        DWORD index;
+#ifdef _WIN32
+        HANDLE port = nullptr;
+        HANDLE thread = nullptr;
+#else
+        int epoll_fd = -1;
+        /// <summary>eventfd，post_event写入它唤醒epoll_wait</summary>
+        int wake_fd = -1;
+        std::thread thread;
+        std::mutex exit_lock;
+        std::condition_variable exit_signal;
+        bool exited = false;
+
+        /// <summary>post_event投递的事件，按投递的顺序处理</summary>
+        std::mutex posted_lock;
+        std::vector<std::pair<ULONG_PTR, void*>> posted;
+        std::vector<std::pair<ULONG_PTR, void*>> taking;
+        /// <summary>已经完成的操作，每轮处理一批，新产生的完成留到下一轮，这样一个连接不会让其他连接等待</summary>
+        std::vector<io_completion> completions;
+        std::vector<io_completion> completing;
+        std::vector<tcp_connection*> retired;
+        std::vector<iovec> iovecs;
+#endif
+        /// <summary>正在执行post的调用，此时要销毁的连接推迟到调用返回后</summary>
+        bool in_call = false;
+        std::vector<tcp_connection*> deferred;
+        /// <summary>分配给该反应器但还未销毁的连接数，包括正在连接和等待附加的连接</summary>
+        std::atomic<LONG> connection_count { 0 };
+        tcp_connection* head = nullptr;
+        /// <summary>等待发送的连接链表，按flush_deadline排序(所有连接的flush_delay相同，所以按加入的顺序即可)</summary>
+        tcp_connection* flush_head = nullptr;
+        tcp_connection* flush_tail = nullptr;
+        bool draining = false;
+
+        // 卸载负载：定期向自己的完成端口投递一个探测数据包，它排在已经排队的完成数据包之后，取出时经过的时间就是排队延迟
+        bool probe_pending = false;
+        ULONGLONG probe_sent = 0;
+        ULONGLONG next_probe = 0;
+        /// <summary>排队延迟第一次超过目标后再过一个间隔的时间，0表示延迟没有超过目标</summary>
+        ULONGLONG first_above = 0;
+        bool shedding = false;
+        ULONGLONG shed_count = 0;
+        ULONGLONG shed_next = 0;
+        /// <summary>第0个反应器下次重新投递暂停的AcceptEx的时间</summary>
+        ULONGLONG next_accept_retry = 0;
+    };
+
+} // namespace tcp_detail
+
+/// <summary>
+/// 基于重叠套接字和I/O完成端口的异步TCP服务器，它也可以主动建立连接
+/// </summary>
+/// <remarks>
+/// 服务器有多个反应器，每个反应器有自己的线程和I/O完成端口(默认每个处理器一个)，每个连接在建立时被分配给一个反应器，
+/// 之后它的所有I/O都在该反应器线程中完成，所以连接的状态机不需要任何锁，并且回调之间没有竞争。
+/// 监听套接字关联到第0个反应器，它通常保持accept_count个AcceptEx请求，接受的连接按轮转分配给各个反应器。
+///
+/// 接收缓冲区和发送队列都使用缓冲区池中的块，WSARecv直接写入块中，接收到的块可以不经复制地交给send发送，
+/// 稳定状态下收发数据不需要分配内存。每个连接的接收缓冲区大小和发送队列长度是固定的，当发送队列超过高水位的一半时，
+/// 连接会暂停接收，直到发送完成，这样慢速的对端不会让服务器无限制地缓存数据。
+///
+/// 过载控制：达到max_connections或缓冲区池将要耗尽时不再投递AcceptEx，多出的连接留在系统的积压队列中，
+/// 所以内存占用有固定的上限(max_pool_chunks个块)。启用shed_target时每个反应器测量自己的完成端口的排队延迟，
+/// 延迟持续过高时按CoDel的节奏中止新连接，处理函数也可以用tcp_connection::should_shed拒绝请求。
+/// 每种决定都计入tcp_server_stats。
+///
+/// 同一轮完成数据包处理中对一个连接的多次send会被合并，在这一轮结束时(或flush_delay到期，或达到flush_threshold时)用一次聚集的WSASend发送，
+/// 见send_queue_options和tcp_connection::set_cork。
+///
+/// stop会先关闭监听套接字，然后优雅地关闭所有连接(发送完缓冲区中的数据)，若超时则中止剩余的连接。
+/// 使用前需要调用socket_startup
+///
+/// 其他平台上使用epoll后端，接口和回调的语义相同：每个反应器有一个epoll实例，套接字以边沿触发注册，
+/// 就绪时执行连接上正在进行的接收或发送，完成后放入反应器的完成队列，和IOCP一样在下一轮处理，所以状态机的代码是共用的。
+/// 监听套接字在第0个反应器中以水平触发注册，暂停接受连接时取消对它的关注
+/// </remarks>
+class tcp_server
+{
+    friend class tcp_connection;
+    friend class tcp_detail::reactor;
+
+public:
+    explicit tcp_server(tcp_handler handler, const tcp_server_options& options = tcp_server_options())
+        : handler(std::move(handler))
+        , options(options)
+    {
+        if (!this->options.reactor_count)
+        {
+#ifdef _WIN32
+            SYSTEM_INFO system_info = { 0 };
+            mw::get_system_info(system_info);
+            this->options.reactor_count = system_info.dwNumberOfProcessors;
+#else
+            this->options.reactor_count = static_cast<DWORD>(sysconf(_SC_NPROCESSORS_ONLN));
+#endif
+            if (!this->options.reactor_count)
+                this->options.reactor_count = 1;
+        }
+        pool = this->options.pool;
+        if (!pool)
+        {
+            own_pool = std::make_unique<buffer_pool>(this->options.recv_buffer_size, 64, this->options.max_pool_chunks);
+            pool = own_pool.get();
+        }
+    }
+    ~tcp_server()
+    {
+        stop();
+    }
+    tcp_server(const tcp_server&) = delete;
+    tcp_server(tcp_server&&) = delete;
+    tcp_server& operator=(const tcp_server&) = delete;
+    tcp_server& operator=(tcp_server&&) = delete;
+
+public:
+    /// <summary>
+    /// 启动所有反应器线程，之后可以调用listen和connect
+    /// </summary>
+    /// <returns>操作是否成功</returns>
+    bool start()
+    {
+        if (running)
+            return true;
+        stopping = false;
+        acceptor_done = false;
+        for (DWORD i = 0; i < options.reactor_count; i++)
+        {
+            reactors.push_back(std::make_unique<tcp_detail::reactor>(this, i));
+            if (!reactors.back()->start(options.pin_reactors))
+            {
+                running = true;
+                stop();
+                return false;
+            }
+        }
+        running = true;
+        return true;
+    }
+
+    /// <summary>
+    /// 在指定端口上监听所有地址，并开始接受连接
+    /// </summary>
+    /// <param name="port">端口号(主机字节序)</param>
+    /// <param name="address_family">AF_INET或AF_INET6</param>
+    /// <returns>操作是否成功</returns>
+    bool listen(USHORT port, int address_family = AF_INET)
+    {
+        sockaddr_storage address = {};
+        int address_len = 0;
+        if (address_family == AF_INET6)
+        {
+            auto address6 = reinterpret_cast<sockaddr_in6*>(&address);
+            address6->sin6_family = AF_INET6;
+            address6->sin6_port = htons(port);
+            address6->sin6_addr = in6addr_any;
+            address_len = sizeof(sockaddr_in6);
+        }
+        else
+        {
+            auto address4 = reinterpret_cast<sockaddr_in*>(&address);
+            address4->sin_family = AF_INET;
+            address4->sin_port = htons(port);
+            address4->sin_addr.s_addr = htonl(INADDR_ANY);
+            address_len = sizeof(sockaddr_in);
+        }
+        return listen(reinterpret_cast<sockaddr*>(&address), address_len);
+    }
+
+    /// <summary>
+    /// 在指定地址上监听，并开始接受连接
+    /// </summary>
+    /// <param name="address">要监听的本地地址</param>
+    /// <param name="address_len">address的长度</param>
+    /// <returns>操作是否成功，若服务器未启动或已经在监听，返回false</returns>
+    bool listen(const sockaddr* address, int address_len)
+    {
+        if (!running || stopping || listen_socket != INVALID_SOCKET)
+            return false;
+
+        listen_family = address->sa_family;
+#ifdef _WIN32
+        listen_socket = mw::socket::create_socket(listen_family, SOCK_STREAM, IPPROTO_TCP);
+        if (listen_socket == INVALID_SOCKET)
+            return false;
+
+        if (!load_extensions(listen_socket)
+            || mw::socket::socket_bind(listen_socket, address, address_len) == SOCKET_ERROR
+            || mw::socket::socket_listen(listen_socket) == SOCKET_ERROR
+            || !mw::create_io_completion_port(reinterpret_cast<HANDLE>(listen_socket), reactors[0]->port, tcp_detail::key_io))
+        {
+            mw::socket::close_socket(listen_socket);
+            listen_socket = INVALID_SOCKET;
+            return false;
+        }
+
+        accept_requests.reset(new tcp_detail::accept_request[options.accept_count]);
+        for (DWORD i = 0; i < options.accept_count; i++)
+        {
+            accept_requests[i].operation = tcp_detail::io_operation::accept;
+            post_accept(&accept_requests[i]);
+        }
+        return true;
+#else
+        listen_socket = ::socket(listen_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_TCP);
+        if (listen_socket == INVALID_SOCKET)
+            return false;
+
+        // 与Windows一样，允许在上一个监听套接字的连接还处于TIME_WAIT时重新监听同一个端口
+        int reuse = 1;
+        setsockopt(listen_socket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        if (::bind(listen_socket, address, static_cast<socklen_t>(address_len)) == SOCKET_ERROR
+            || ::listen(listen_socket, SOMAXCONN) == SOCKET_ERROR
+            || !reactors[0]->watch_listener(listen_socket))
+        {
+            ::close(listen_socket);
+            listen_socket = INVALID_SOCKET;
+            return false;
+        }
+        return true;
+#endif
+    }
+
+    /// <summary>
+    /// 异步地连接到指定地址，连接成功后调用on_connect，失败时调用on_connect_failed
+    /// </summary>
+    /// <param name="address">远程地址</param>
+    /// <param name="address_len">address的长度</param>
+    /// <param name="user_data">连接成功后它会成为tcp_connection::user_data，失败时传给on_connect_failed</param>
+    /// <returns>若连接请求无法发出，返回false，此时不会调用任何回调</returns>
+    bool connect(const sockaddr* address, int address_len, void* user_data = nullptr)
+    {
+        if (!running || stopping)
+            return false;
+
+#ifdef _WIN32
+        auto socket = mw::socket::create_socket(address->sa_family, SOCK_STREAM, IPPROTO_TCP);
+        if (socket == INVALID_SOCKET)
+            return false;
+
+        // ConnectEx要求套接字已经绑定
+        sockaddr_storage local = { 0 };
+        local.ss_family = address->sa_family;
+        auto local_len = address->sa_family == AF_INET6 ? static_cast<int>(sizeof(sockaddr_in6)) : static_cast<int>(sizeof(sockaddr_in));
+        auto target = pick_reactor();
+        if (!load_extensions(socket)
+            || mw::socket::socket_bind(socket, reinterpret_cast<sockaddr*>(&local), local_len) == SOCKET_ERROR
+            || !mw::create_io_completion_port(reinterpret_cast<HANDLE>(socket), target->port, tcp_detail::key_io))
+        {
+            mw::socket::close_socket(socket);
+            return false;
+        }
+
+        auto connection = new tcp_connection(this, target, pool, socket, ++last_connection_id, options.send_queue);
+        connection->outbound = true;
+        connection->user_data = user_data;
+        std::memcpy(&connection->remote, address, address_len);
+        connection->recv_request.reset();
+        connection->recv_request.operation = tcp_detail::io_operation::connect;
+        target->connection_count.fetch_add(1);
+
+        if (!connect_ex(socket, address, address_len, nullptr, 0, nullptr, &connection->recv_request)
+            && WSAGetLastError() != ERROR_IO_PENDING)
+        {
+            target->connection_count.fetch_sub(1);
+            mw::socket::close_socket(socket);
+            delete connection;
+            return false;
+        }
+        return true;
+#else
+        auto socket = ::socket(address->sa_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_TCP);
+        if (socket == INVALID_SOCKET)
+            return false;
+
+        auto target = pick_reactor();
+        auto connection = new tcp_connection(this, target, pool, socket, ++last_connection_id, options.send_queue);
+        connection->outbound = true;
+        connection->user_data = user_data;
+        std::memcpy(&connection->remote, address, (std::min)(static_cast<size_t>(address_len), sizeof(sockaddr_storage)));
+        connection->recv_request.operation = tcp_detail::io_operation::connect;
+        target->connection_count.fetch_add(1);
+
+        // 连接完成(或失败)时套接字变为可写，注册时若已经完成，epoll也会立即报告
+        if ((::connect(socket, address, static_cast<socklen_t>(address_len)) == 0 || errno == EINPROGRESS)
+            && target->watch(connection))
+            return true;
+        target->connection_count.fetch_sub(1);
+        ::close(socket);
+        delete connection;
+        return false;
+#endif
+    }
+
+    /// <summary>
+    /// 在指定反应器线程中调用fun，可以在任意线程中调用，用于在连接所属的反应器线程之外安排对连接的操作
+    /// </summary>
+    /// <remarks>
+    /// fun在反应器处理完成数据包时被调用，与连接的回调顺序执行。stop时还未执行的调用会被丢弃。
+    /// fun中关闭的连接在fun返回之后才销毁(并调用on_close)，所以fun可以在关闭连接后继续使用它
+    /// </remarks>
+    /// <param name="reactor_index">反应器的序号，见tcp_connection::reactor_index</param>
+    /// <param name="fun">要调用的函数</param>
+    /// <returns>若服务器未启动，序号不合法，或投递失败，返回false，此时fun不会被调用</returns>
+    bool post(DWORD reactor_index, std::function<void()> fun)
+    {
+        if (!running || reactor_index >= reactors.size())
+            return false;
+        auto call = new std::function<void()>(std::move(fun));
+        if (!reactors[reactor_index]->post_event(tcp_detail::key_call, call))
+        {
+            delete call;
+            return false;
+        }
+        return true;
+    }
+
+    /// <summary>
+    /// 停止服务器：关闭监听套接字，优雅地关闭所有连接，并等待反应器线程退出
+    /// </summary>
+    /// <param name="timeout">等待连接优雅关闭的毫秒数，超时后剩余的连接被中止</param>
+    void stop(DWORD timeout = 5000)
+    {
+        if (!running)
+            return;
+        stopping = true;
+
+        // 监听套接字由第0个反应器在处理key_shutdown时关闭(之后所有未完成的AcceptEx都会以错误完成)，
+        // 它的线程在投递AcceptEx和更新接受的套接字时读取监听套接字，不能在调用stop的线程中关闭
+        if (!reactors.empty() && !reactors[0]->has_thread())
+        {
+            close_listener();
+            acceptor_done = true;
+        }
+        for (auto& reactor : reactors)
+            if (reactor->has_thread())
+                reactor->post_event(tcp_detail::key_shutdown, nullptr);
+
+        auto deadline = tcp_detail::now_milliseconds() + timeout;
+        bool timed_out = false;
+        for (auto& reactor : reactors)
+        {
+            if (!reactor->has_thread())
+                continue;
+            auto now = tcp_detail::now_milliseconds();
+            auto wait = now < deadline ? static_cast<DWORD>(deadline - now) : 0;
+            if (!reactor->wait_exit(wait))
+            {
+                timed_out = true;
+                break;
+            }
+        }
+        if (timed_out)
+        {
+            for (auto& reactor : reactors)
+                if (reactor->has_thread())
+                    reactor->post_event(tcp_detail::key_abort, nullptr);
+        }
+
+        for (auto& reactor : reactors)
+            reactor->join();
+        reactors.clear();
+#ifdef _WIN32
+        accept_requests.reset();
+#endif
+        parked_accepts = 0;
+        shedding_reactors = 0;
+        running = false;
+    }
+
+    /// <summary>
+    /// 获取统计信息
+    /// </summary>
+    tcp_server_stats stats() const
+    {
+        tcp_server_stats result;
+        result.accepted = accepted.load(std::memory_order_relaxed);
+        result.connected = connected.load(std::memory_order_relaxed);
+        result.active = active.load(std::memory_order_relaxed);
+        result.bytes_received = bytes_received.load(std::memory_order_relaxed);
+        result.bytes_sent = bytes_sent.load(std::memory_order_relaxed);
+        result.send_calls = send_calls.load(std::memory_order_relaxed);
+        result.inbound = inbound.load(std::memory_order_relaxed);
+        result.accept_paused_by_limit = accept_paused_by_limit.load(std::memory_order_relaxed);
+        result.accept_paused_by_memory = accept_paused_by_memory.load(std::memory_order_relaxed);
+        result.parked_accepts = parked_accepts.load(std::memory_order_relaxed);
+        result.read_pauses = read_pauses.load(std::memory_order_relaxed);
+        result.shed_connections = shed_connections.load(std::memory_order_relaxed);
+        result.shedding_reactors = shedding_reactors.load(std::memory_order_relaxed);
+        result.max_queue_delay = max_queue_delay.load(std::memory_order_relaxed);
+        return result;
+    }
+
+    bool is_running() const { return running; }
+    const tcp_server_options& get_options() const { return options; }
+    /// <summary>服务器使用的缓冲区池，可以用它获取零复制发送的块或查看统计信息</summary>
+    buffer_pool& get_buffer_pool() const { return *pool; }
+
+private:
+    tcp_detail::reactor* pick_reactor()
+    {
+        return reactors[next_reactor.fetch_add(1, std::memory_order_relaxed) % reactors.size()].get();
+    }
+
+    /// <summary>
+    /// 关闭监听套接字，在第0个反应器线程中(或它没有启动时在stop中)调用
+    /// </summary>
+    void close_listener()
+    {
+        if (listen_socket == INVALID_SOCKET)
+            return;
+#ifdef _WIN32
+        mw::socket::close_socket(listen_socket);
+#else
+        ::close(listen_socket);
+#endif
+        listen_socket = INVALID_SOCKET;
+    }
+
+    /// <summary>
+    /// 为接受的套接字创建连接，按轮转交给一个反应器，在第0个反应器线程中调用
+    /// </summary>
+    void hand_off(SOCKET socket, const sockaddr* remote_address, int remote_len)
+    {
+        auto target = pick_reactor();
+        auto connection = new tcp_connection(this, target, pool, socket, ++last_connection_id, options.send_queue);
+        if (remote_address && remote_len <= static_cast<int>(sizeof(sockaddr_storage)))
+            std::memcpy(&connection->remote, remote_address, remote_len);
+        accepted.fetch_add(1, std::memory_order_relaxed);
+        inbound.fetch_add(1, std::memory_order_relaxed);
+
+        // 把连接交给目标反应器，由它关联完成端口并开始接收
+        target->connection_count.fetch_add(1);
+        target->post_event(tcp_detail::key_attach, connection);
+    }
+
+#ifdef _WIN32
+    bool load_extension(SOCKET socket, GUID guid, void* function, DWORD size)
+    {
+        DWORD bytes = 0;
+        return WSAIoctl(socket, SIO_GET_EXTENSION_FUNCTION_POINTER, &guid, sizeof(guid),
+                   function, size, &bytes, nullptr, nullptr)
+            != SOCKET_ERROR;
+    }
+
+    bool load_extensions(SOCKET socket)
+    {
+        if (accept_ex && get_accept_ex_sockaddrs && connect_ex)
+            return true;
+        return load_extension(socket, WSAID_ACCEPTEX, &accept_ex, sizeof(accept_ex))
+            && load_extension(socket, WSAID_GETACCEPTEXSOCKADDRS, &get_accept_ex_sockaddrs, sizeof(get_accept_ex_sockaddrs))
+            && load_extension(socket, WSAID_CONNECTEX, &connect_ex, sizeof(connect_ex));
+    }
+
+    /// <summary>
+    /// 投递一个AcceptEx请求，只在listen和第0个反应器线程中调用
+    /// </summary>
+    void post_accept(tcp_detail::accept_request* request)
+    {
+        while (!stopping)
+        {
+            if (!admit_accept())
+            {
+                // 请求被搁置，第0个反应器每隔accept_retry_interval重新检查
+                request->parked.store(true);
+                parked_accepts.fetch_add(1);
+                return;
+            }
+            request->reset();
+            request->socket = mw::socket::create_socket(listen_family, SOCK_STREAM, IPPROTO_TCP);
+            if (request->socket == INVALID_SOCKET)
+                return;
+
+            pending_accepts.fetch_add(1);
+            DWORD bytes = 0;
+            if (accept_ex(listen_socket, request->socket, request->address_buffer, 0,
+                    sizeof(sockaddr_storage) + 16, sizeof(sockaddr_storage) + 16, &bytes, request)
+                || WSAGetLastError() == ERROR_IO_PENDING)
+                return;
+
+            // 立即失败(例如对端在接受前重置了连接)，换一个套接字重试
+            pending_accepts.fetch_sub(1);
+            mw::socket::close_socket(request->socket);
+            request->socket = INVALID_SOCKET;
+            if (WSAGetLastError() != WSAECONNRESET)
+                return;
+        }
+    }
+
+#endif
+
+    /// <summary>
+    /// 检查是否可以再投递一个AcceptEx，不可以时记录暂停的原因
+    /// </summary>
+    bool admit_accept()
+    {
+        // 计数只在从接受连接变为暂停时增加，而不是每个被搁置的请求都增加
+        bool paused = parked_accepts.load() != 0;
+        if (options.max_connections && inbound.load() + pending_accepts.load() >= options.max_connections)
+        {
+            if (!paused)
+                accept_paused_by_limit.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        auto pool_stats = pool->stats();
+        auto max_chunks = pool->get_max_chunks();
+        // 上次检查之后有acquire失败(达到上限或内存不足)，暂停一个重试间隔
+        bool failed_recently = pool_failures.exchange(pool_stats.failed) != pool_stats.failed;
+        if (failed_recently || (max_chunks && pool_stats.chunks_in_use + options.min_free_chunks > max_chunks))
+        {
+            if (!paused)
+                accept_paused_by_memory.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        return true;
+    }
+
+#ifdef _WIN32
+    /// <summary>
+    /// 重新投递被搁置的AcceptEx请求，在第0个反应器线程中调用
+    /// </summary>
+    void resume_accepts()
+    {
+        for (DWORD i = 0; i < options.accept_count && parked_accepts.load() && !stopping; i++)
+        {
+            auto request = &accept_requests[i];
+            if (!request->parked.exchange(false))
+                continue;
+            parked_accepts.fetch_sub(1);
+            post_accept(request);
+            // 仍然不能接受连接，剩下的请求也不必再尝试
+            if (request->parked.load())
+                break;
+        }
+    }
+
+    /// <summary>
+    /// AcceptEx完成，在第0个反应器线程中调用
+    /// </summary>
+    void accept_completed(tcp_detail::accept_request* request)
+    {
+        pending_accepts.fetch_sub(1);
+        auto socket = request->socket;
+        request->socket = INVALID_SOCKET;
+
+        if (!request->succeeded() || stopping
+            || setsockopt(socket, SOL_SOCKET, SO_UPDATE_ACCEPT_CONTEXT,
+                   reinterpret_cast<const char*>(&listen_socket), sizeof(listen_socket))
+                == SOCKET_ERROR)
+        {
+            mw::socket::close_socket(socket);
+            post_accept(request);
+            return;
+        }
+
+        sockaddr* local_address = nullptr;
+        sockaddr* remote_address = nullptr;
+        int local_len = 0, remote_len = 0;
+        get_accept_ex_sockaddrs(request->address_buffer, 0, sizeof(sockaddr_storage) + 16, sizeof(sockaddr_storage) + 16,
+            &local_address, &local_len, &remote_address, &remote_len);
+
+        hand_off(socket, remote_address, remote_len);
+        post_accept(request);
+    }
+#else
+    /// <summary>
+    /// 监听套接字就绪，最多接受accept_count个连接，在第0个反应器线程中调用
+    /// </summary>
+    void accept_ready()
+    {
+        for (DWORD i = 0; i < options.accept_count && !stopping && listen_socket != INVALID_SOCKET; i++)
+        {
+            if (!admit_accept())
+            {
+                park_listener();
+                return;
+            }
+            sockaddr_storage remote_address;
+            socklen_t remote_len = sizeof(remote_address);
+            auto socket = ::accept4(listen_socket, reinterpret_cast<sockaddr*>(&remote_address), &remote_len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (socket != INVALID_SOCKET)
+            {
+                hand_off(socket, reinterpret_cast<sockaddr*>(&remote_address), static_cast<int>(remote_len));
+                continue;
+            }
+            // 对端在接受前重置了连接，继续接受下一个
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS || errno == ENOMEM)
+            {
+                // 描述符或内存耗尽，与缓冲区池耗尽一样暂停一个重试间隔
+                accept_paused_by_memory.fetch_add(1, std::memory_order_relaxed);
+                park_listener();
+            }
+            return;
+        }
+    }
+
+    /// <summary>
+    /// 暂停接受连接，第0个反应器每隔accept_retry_interval调用resume_accepts重新检查
+    /// </summary>
+    void park_listener()
+    {
+        parked_accepts.store(1);
+        reactors[0]->listen_interest(false);
+    }
+
+    /// <summary>
+    /// 可以再接受连接时重新关注监听套接字，在第0个反应器线程中调用
+    /// </summary>
+    void resume_accepts()
+    {
+        if (stopping || listen_socket == INVALID_SOCKET || !admit_accept())
+            return;
+        parked_accepts.store(0);
+        reactors[0]->listen_interest(true);
+    }
+#endif
+
+    tcp_handler handler;
+    tcp_server_options options;
+    std::unique_ptr<buffer_pool> own_pool;
+    buffer_pool* pool = nullptr;
+    std::vector<std::unique_ptr<tcp_detail::reactor>> reactors;
+    bool running = false;
+    std::atomic<bool> stopping { false };
+
+    /// <summary>监听套接字，listen之后只有第0个反应器线程使用和关闭它</summary>
+    SOCKET listen_socket = INVALID_SOCKET;
+    int listen_family = AF_INET;
+    /// <summary>已经投递但还未完成的AcceptEx数，epoll后端中总是0</summary>
+    std::atomic<LONG> pending_accepts { 0 };
+    std::atomic<bool> acceptor_done { false };
+
+#ifdef _WIN32
+    std::unique_ptr<tcp_detail::accept_request[]> accept_requests;
+    LPFN_ACCEPTEX accept_ex = nullptr;
+    LPFN_GETACCEPTEXSOCKADDRS get_accept_ex_sockaddrs = nullptr;
+    LPFN_CONNECTEX connect_ex = nullptr;
+#endif
+
+    std::atomic<ULONGLONG> last_connection_id { 0 };
+    std::atomic<size_t> next_reactor { 0 };
+
+    std::atomic<ULONGLONG> accepted { 0 };
+    std::atomic<ULONGLONG> connected { 0 };
+    std::atomic<ULONGLONG> active { 0 };
+    std::atomic<ULONGLONG> bytes_received { 0 };
+    std::atomic<ULONGLONG> bytes_sent { 0 };
+    std::atomic<ULONGLONG> send_calls { 0 };
+
+    std::atomic<ULONGLONG> inbound { 0 };
+    std::atomic<LONG> parked_accepts { 0 };
+    std::atomic<ULONGLONG> pool_failures { 0 };
+    std::atomic<ULONGLONG> accept_paused_by_limit { 0 };
+    std::atomic<ULONGLONG> accept_paused_by_memory { 0 };
+    std::atomic<ULONGLONG> read_pauses { 0 };
+    std::atomic<ULONGLONG> shed_connections { 0 };
+    std::atomic<ULONGLONG> shedding_reactors { 0 };
+    std::atomic<ULONGLONG> max_queue_delay { 0 };
+};
+
+inline bool tcp_connection::send(const void* data, size_t size)
+{
+    if (closing || !queue.write(data, size))
+        return false;
+    reactor->schedule_flush(this);
+    return true;
+}
+
+inline bool tcp_connection::send(buffer_ref buffer, size_t offset, size_t size)
+{
+    if (closing || !queue.write(std::move(buffer), offset, size))
+        return false;
+    reactor->schedule_flush(this);
+    return true;
+}
+
+inline bool tcp_connection::send(const WSABUF* buffers, DWORD count)
+{
+    if (closing || !queue.write(buffers, count))
+        return false;
+    reactor->schedule_flush(this);
+    return true;
+}
+
+inline void tcp_connection::flush()
+{
+    if (!send_pending && queue.queued_bytes() && socket != INVALID_SOCKET)
+        reactor->flush_send(this);
+}
+
+inline void tcp_connection::set_cork(bool cork)
+{
+    corked = cork;
+    if (!cork)
+        reactor->schedule_flush(this);
+}
+
+inline void tcp_connection::close()
+{
+    if (closing)
+        return;
+    closing = true;
+    // 若正在发送，等发送完成后再关闭，排队的数据立即发送
+    if (send_pending)
+        return;
+    if (queue.queued_bytes())
+        reactor->flush_send(this);
+    else
+        reactor->finish_close(this);
+}
+
+inline void tcp_connection::abort()
+{
+    reactor->abort(this);
+}
+
+inline DWORD tcp_connection::reactor_index() const
+{
+    return reactor->index;
+}
+
+inline bool tcp_connection::should_shed()
+{
+    return reactor->should_shed();
+}
+
+namespace tcp_detail {
+
+#ifdef _WIN32
+    inline bool reactor::start(bool pin)
+    {
+        port = mw::create_io_completion_port(INVALID_HANDLE_VALUE, nullptr, 0, 1);
+        if (!port)
+            return false;
+        thread = mw::c_create_thread(thread_function, this, nullptr, nullptr, CREATE_SUSPENDED);
+        if (!thread)
+            return false;
+        if (pin && index < sizeof(DWORD_PTR) * 8)
+            mw::set_thread_affinity_mask(thread, static_cast<DWORD_PTR>(1) << index);
+        else
+            mw::set_thread_ideal_processor(thread, index);
+        mw::resume_thread(thread);
+        return true;
+    }
+
+    inline void reactor::run()
+    {
+        OVERLAPPED_ENTRY entries[64];
+        ULONG count = 0;
+        DWORD timeout = INFINITE;
+        for (;;)
+        {
+            // 有连接等待flush_delay到期时需要超时返回，超时是正常情况，所以直接调用API，不输出错误信息
+            if (!GetQueuedCompletionStatusEx(port, entries, 64, &count, timeout, FALSE))
+            {
+                if (GetLastError() != WAIT_TIMEOUT)
+                    break;
+                count = 0;
+            }
+
+            for (ULONG i = 0; i < count; i++)
+            {
+                auto& entry = entries[i];
+                if (entry.lpCompletionKey != key_io)
+                {
+                    handle_event(entry.lpCompletionKey, entry.lpOverlapped);
+                    continue;
+                }
+                auto request = static_cast<io_request*>(entry.lpOverlapped);
+                if (request->operation == io_operation::accept)
+                {
+                    owner->accept_completed(static_cast<accept_request*>(request));
+                    continue;
+                }
+                io_completed(request->connection, request->operation, request->succeeded(), entry.dwNumberOfBytesTransferred);
+            }
+
+            if (end_round(timeout))
+                break;
+        }
+    }
+
+    inline bool reactor::post_event(ULONG_PTR key, void* data)
+    {
+        return mw::post_queued_completion_status(port, 0, key, static_cast<LPOVERLAPPED>(data));
+    }
+
+    inline bool reactor::has_thread() const
+    {
+        return thread != nullptr;
+    }
+
+    inline bool reactor::wait_exit(DWORD timeout)
+    {
+        return mw::sync::wait_for_single_object(thread, timeout) != WAIT_TIMEOUT;
+    }
+
+    inline void reactor::join()
+    {
+        if (thread)
+        {
+            mw::sync::wait_for_single_object(thread);
+            CloseHandle(thread);
+            thread = nullptr;
+        }
+        if (port)
+        {
+            discard_calls();
+            CloseHandle(port);
+            port = nullptr;
+        }
+    }
+
+    /// <summary>
+    /// 反应器线程退出后，释放完成端口中还未执行的post调用
+    /// </summary>
+    inline void reactor::discard_calls()
+    {
+        OVERLAPPED_ENTRY entries[64];
+        ULONG count = 0;
+        while (GetQueuedCompletionStatusEx(port, entries, 64, &count, 0, FALSE) && count)
+        {
+            for (ULONG i = 0; i < count; i++)
+                if (entries[i].lpCompletionKey == key_call)
+                    delete reinterpret_cast<std::function<void()>*>(entries[i].lpOverlapped);
+        }
+    }
+#else
+    inline bool reactor::start(bool pin)
+    {
+        epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (epoll_fd < 0)
+            return false;
+        wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (wake_fd < 0)
+            return false;
+        epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.u64 = epoll_wake;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd, &event) != 0)
+            return false;
+
+        exited = false;
+        thread = std::thread([this] {
+            run();
+            std::lock_guard<std::mutex> guard(exit_lock);
+            exited = true;
+            exit_signal.notify_all();
+        });
+        if (pin && index < CPU_SETSIZE)
+        {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(index, &set);
+            pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+        }
+        return true;
+    }
+
+    inline void reactor::run()
+    {
+        epoll_event events[64];
+        DWORD timeout = INFINITE;
+        for (;;)
+        {
+            // 还有上一轮产生的完成时不等待，先处理它们
+            auto wait = !completions.empty() ? 0 : timeout == INFINITE ? -1 : static_cast<int>((std::min)(timeout, static_cast<DWORD>(INT_MAX)));
+            auto count = epoll_wait(epoll_fd, events, 64, wait);
+            if (count < 0)
+            {
+                if (errno != EINTR)
+                    break;
+                count = 0;
+            }
+
+            for (int i = 0; i < count; i++)
+            {
+                auto tag = events[i].data.u64;
+                if (tag == epoll_wake)
+                    take_posted();
+                else if (tag == epoll_listener)
+                    owner->accept_ready();
+                else
+                    ready(static_cast<tcp_connection*>(events[i].data.ptr), events[i].events);
+            }
+            run_completions();
+
+            auto exit = end_round(timeout);
+            // 这一批事件中可能还有已经销毁的连接的事件，所以连接在这里才释放
+            bury();
+            if (exit)
+                break;
+        }
+    }
+
+    inline bool reactor::post_event(ULONG_PTR key, void* data)
+    {
+        bool wake = false;
+        {
+            std::lock_guard<std::mutex> guard(posted_lock);
+            if (wake_fd < 0)
+                return false;
+            wake = posted.empty();
+            posted.emplace_back(key, data);
+        }
+        // 队列不为空时反应器已经被唤醒，还没有取出队列
+        return !wake || eventfd_write(wake_fd, 1) == 0;
+    }
+
+    inline bool reactor::has_thread() const
+    {
+        return thread.joinable();
+    }
+
+    inline bool reactor::wait_exit(DWORD timeout)
+    {
+        std::unique_lock<std::mutex> lock(exit_lock);
+        return exit_signal.wait_for(lock, std::chrono::milliseconds(timeout), [this] { return exited; });
+    }
+
+    inline void reactor::join()
+    {
+        if (thread.joinable())
+            thread.join();
+        discard_calls();
+        std::lock_guard<std::mutex> guard(posted_lock);
+        if (wake_fd >= 0)
+            ::close(wake_fd);
+        if (epoll_fd >= 0)
+            ::close(epoll_fd);
+        wake_fd = epoll_fd = -1;
+    }
+
+    /// <summary>
+    /// 反应器线程退出后，释放队列中还未执行的post调用
+    /// </summary>
+    inline void reactor::discard_calls()
+    {
+        std::lock_guard<std::mutex> guard(posted_lock);
+        for (auto& event : posted)
+            if (event.first == key_call)
+                delete static_cast<std::function<void()>*>(event.second);
+        posted.clear();
+    }
+
+    /// <summary>
+    /// 取出并处理投递的事件
+    /// </summary>
+    inline void reactor::take_posted()
+    {
+        eventfd_t value = 0;
+        eventfd_read(wake_fd, &value);
+        {
+            std::lock_guard<std::mutex> guard(posted_lock);
+            std::swap(posted, taking);
+        }
+        for (auto& event : taking)
+            handle_event(event.first, event.second);
+        taking.clear();
+    }
+
+    /// <summary>
+    /// 以边沿触发注册连接的套接字，可读和可写都只在状态变化时报告一次
+    /// </summary>
+    inline bool reactor::watch(tcp_connection* connection)
+    {
+        epoll_event event = {};
+        event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        event.data.ptr = connection;
+        return epoll_ctl(epoll_fd, EPOLL_CTL_ADD, connection->socket, &event) == 0;
+    }
+
+    inline bool reactor::watch_listener(SOCKET socket)
+    {
+        epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.u64 = epoll_listener;
+        return epoll_ctl(epoll_fd, EPOLL_CTL_ADD, socket, &event) == 0;
+    }
+
+    /// <summary>
+    /// 开始或停止关注监听套接字，暂停接受连接时停止关注，否则水平触发的监听套接字会一直就绪
+    /// </summary>
+    inline void reactor::listen_interest(bool enabled)
+    {
+        epoll_event event = {};
+        event.events = enabled ? static_cast<std::uint32_t>(EPOLLIN) : 0;
+        event.data.u64 = epoll_listener;
+        epoll_ctl(epoll_fd, EPOLL_CTL_MOD, owner->listen_socket, &event);
+    }
+
+    /// <summary>
+    /// 连接的套接字就绪，执行正在进行的连接，发送或接收
+    /// </summary>
+    inline void reactor::ready(tcp_connection* connection, std::uint32_t events)
+    {
+        if (connection->retired)
+            return;
+        connection->busy = true;
+        if (events & (EPOLLOUT | EPOLLERR | EPOLLHUP))
+        {
+            connection->writable = true;
+            if (connection->recv_request.operation == io_operation::connect)
+            {
+                int error = 0;
+                socklen_t length = sizeof(error);
+                if (getsockopt(connection->socket, SOL_SOCKET, SO_ERROR, &error, &length) != 0)
+                    error = errno;
+                connection->connect_error = error;
+                connected(connection, error == 0);
+            }
+            else if (connection->send_pending && !connection->send_completion_queued)
+                write_now(connection);
+        }
+        if ((events & (EPOLLIN | EPOLLRDHUP | EPOLLERR | EPOLLHUP)) && connection->socket != INVALID_SOCKET)
+        {
+            connection->readable = true;
+            if (connection->recv_pending && !connection->recv_completion_queued)
+                read_now(connection);
+        }
+        connection->busy = false;
+        try_destroy(connection);
+    }
+
+    /// <summary>
+    /// 接收到接收缓冲区的空闲部分，有结果(数据，对端关闭或错误)时放入完成队列，否则等待下一个可读事件
+    /// </summary>
+    inline void reactor::read_now(tcp_connection* connection)
+    {
+        auto& chunk = connection->recv_chunk;
+        auto space = chunk.capacity() - connection->recv_end;
+        for (;;)
+        {
+            auto bytes = ::recv(connection->socket, chunk.data() + connection->recv_end, space, 0);
+            if (bytes >= 0)
+            {
+                // 读到的比请求的少说明接收缓冲区已经读空，之后有新数据时epoll会再报告
+                if (bytes > 0 && static_cast<size_t>(bytes) < space)
+                    connection->readable = false;
+                complete(connection, io_operation::recv, true, static_cast<DWORD>(bytes));
+                return;
+            }
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                connection->readable = false;
+                return;
+            }
+            complete(connection, io_operation::recv, false, 0);
+            return;
+        }
+    }
+
+    /// <summary>
+    /// 把正在发送的数组中还未写入的部分写入套接字，全部写入后放入完成队列，套接字写满时等待下一个可写事件
+    /// </summary>
+    inline void reactor::write_now(tcp_connection* connection)
+    {
+        iovecs.clear();
+        auto skip = connection->send_written;
+        for (DWORD i = 0; i < connection->send_count; i++)
+        {
+            auto& buffer = connection->send_buffers[i];
+            if (skip >= buffer.len)
+            {
+                skip -= buffer.len;
+                continue;
+            }
+            iovecs.push_back({ buffer.buf + skip, buffer.len - skip });
+            skip = 0;
+        }
+
+        auto total = connection->queue.sending_bytes();
+        size_t first = 0;
+        while (connection->send_written < total)
+        {
+            msghdr message = {};
+            message.msg_iov = iovecs.data() + first;
+            message.msg_iovlen = (std::min)(iovecs.size() - first, static_cast<size_t>(IOV_MAX));
+            auto bytes = ::sendmsg(connection->socket, &message, MSG_NOSIGNAL);
+            if (bytes < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK)
+                {
+                    connection->writable = false;
+                    return;
+                }
+                complete(connection, io_operation::send, false, 0);
+                return;
+            }
+            connection->send_written += bytes;
+            for (auto left = static_cast<size_t>(bytes); left;)
+            {
+                auto& vector = iovecs[first];
+                if (left < vector.iov_len)
+                {
+                    vector.iov_base = static_cast<char*>(vector.iov_base) + left;
+                    vector.iov_len -= left;
+                    break;
+                }
+                left -= vector.iov_len;
+                first++;
+            }
+        }
+        complete(connection, io_operation::send, true, static_cast<DWORD>(total));
+    }
+
+    inline void reactor::complete(tcp_connection* connection, io_operation operation, bool succeeded, DWORD bytes)
+    {
+        if (operation == io_operation::recv)
+            connection->recv_completion_queued = true;
+        else
+            connection->send_completion_queued = true;
+        completions.push_back({ connection, operation, succeeded, bytes });
+    }
+
+    /// <summary>
+    /// 处理完成队列中已有的完成，处理中产生的新完成留到下一轮
+    /// </summary>
+    inline void reactor::run_completions()
+    {
+        std::swap(completions, completing);
+        for (auto& completion : completing)
+        {
+            if (completion.operation == io_operation::recv)
+                completion.connection->recv_completion_queued = false;
+            else
+                completion.connection->send_completion_queued = false;
+            io_completed(completion.connection, completion.operation, completion.succeeded, completion.bytes);
+        }
+        completing.clear();
+    }
+
+    /// <summary>
+    /// 释放这一轮中销毁的连接
+    /// </summary>
+    inline void reactor::bury()
+    {
+        for (auto connection : retired)
+            delete connection;
+        retired.clear();
+    }
+#endif
+
+    /// <summary>
+    /// 处理投递给反应器的事件
+    /// </summary>
+    inline void reactor::handle_event(ULONG_PTR key, void* data)
+    {
+        switch (key)
+        {
+        case key_attach:
+        {
+            auto connection = static_cast<tcp_connection*>(data);
+            if (should_shed())
+            {
+                // 过载时新连接在附加之前就被中止，不会调用on_connect
+                owner->shed_connections.fetch_add(1, std::memory_order_relaxed);
+                abort(connection);
+                break;
+            }
+            connection->busy = true;
+            attach(connection);
+            connection->busy = false;
+            try_destroy(connection);
+            break;
+        }
+        case key_shutdown:
+            // 只有第0个反应器使用监听套接字，所以也由它关闭
+            if (index == 0)
+                owner->close_listener();
+            draining = true;
+            for (auto connection = head; connection;)
+            {
+                auto next = connection->next;
+                connection->close();
+                connection = next;
+            }
+            break;
+        case key_abort:
+            draining = true;
+            for (auto connection = head; connection;)
+            {
+                auto next = connection->next;
+                abort(connection);
+                connection = next;
+            }
+            break;
+        case key_call:
+        {
+            // 调用中关闭的连接推迟到调用返回后才销毁，调用可能在关闭之后继续使用它
+            auto call = static_cast<std::function<void()>*>(data);
+            in_call = true;
+            (*call)();
+            in_call = false;
+            delete call;
+            release_deferred();
+            break;
+        }
+        case key_probe:
+            probe_completed();
+            break;
+        }
+    }
+
+    /// <summary>
+    /// 连接上的一个操作完成
+    /// </summary>
+    inline void reactor::io_completed(tcp_connection* connection, io_operation operation, bool succeeded, DWORD bytes)
+    {
+        connection->busy = true;
+        switch (operation)
+        {
+        case io_operation::connect:
+            connected(connection, succeeded);
+            break;
+        case io_operation::recv:
+            recv_completed(connection, succeeded, bytes);
+            break;
+        case io_operation::send:
+            send_completed(connection, succeeded, bytes);
+            break;
+        default:
+            break;
+        }
+        connection->busy = false;
+        try_destroy(connection);
+    }
+
+    /// <summary>
+    /// 一轮事件处理完毕：发送这一轮中合并的写入，处理计时器，检查停止是否已经完成
+    /// </summary>
+    /// <param name="timeout">[out]下次等待事件的超时毫秒数</param>
+    /// <returns>反应器线程是否应该退出</returns>
+    inline bool reactor::end_round(DWORD& timeout)
+    {
+        timeout = timers_due(flush_due());
+        if (!draining || connection_count.load() != 0)
+            return false;
+
+        // 第0个反应器要等所有AcceptEx完成，之后不会再有新连接被分配给其他反应器，所以其他反应器要等它先退出
+        if (index == 0 && owner->pending_accepts.load() == 0)
+        {
+            owner->acceptor_done.store(true);
+            for (auto& other : owner->reactors)
+                if (other.get() != this)
+                    other->post_event(key_shutdown, nullptr);
+            return true;
+        }
+        return index != 0 && owner->acceptor_done.load();
+    }
+
+    /// <summary>
+    /// post的调用返回后，销毁调用中关闭的连接
+    /// </summary>
+    inline void reactor::release_deferred()
+    {
+        for (size_t i = 0; i < deferred.size(); i++)
+        {
+            deferred[i]->busy = false;
+            try_destroy(deferred[i]);
+        }
+        deferred.clear();
+    }
+
+    inline void reactor::attach(tcp_connection* connection)
+    {
+#ifdef _WIN32
+        bool attached = mw::create_io_completion_port(reinterpret_cast<HANDLE>(connection->socket), port, key_io) != nullptr;
+#else
+        bool attached = watch(connection);
+#endif
+        if (!attached)
+        {
+            connection->closing = true;
+            close_socket(connection);
+            try_destroy(connection);
+            return;
+        }
+        connected(connection, true);
+    }
+
+    inline void reactor::connected(tcp_connection* connection, bool succeeded)
+    {
+        auto& handler = owner->handler;
+        connection->recv_request.operation = io_operation::recv;
+
+#ifdef _WIN32
+        if (succeeded && connection->outbound)
+            succeeded = setsockopt(connection->socket, SOL_SOCKET, SO_UPDATE_CONNECT_CONTEXT, nullptr, 0) != SOCKET_ERROR;
+#endif
+        if (!succeeded)
+        {
+            int error = WSAECONNREFUSED;
+#ifdef _WIN32
+            DWORD bytes = 0, flags = 0;
+            if (!WSAGetOverlappedResult(connection->socket, &connection->recv_request, &bytes, false, &flags))
+                error = WSAGetLastError();
+#else
+            if (connection->connect_error)
+                error = connection->connect_error;
+#endif
+            if (handler.on_connect_failed)
+                handler.on_connect_failed(connection->user_data, error);
+            connection->closing = true;
+            close_socket(connection);
+            try_destroy(connection);
+            return;
+        }
+
+        if (owner->options.no_delay)
+        {
+            BOOL no_delay = TRUE;
+            setsockopt(connection->socket, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&no_delay), sizeof(no_delay));
+        }
+
+        connection->next = head;
+        if (head)
+            head->prev = connection;
+        head = connection;
+        connection->established = true;
+        owner->active.fetch_add(1, std::memory_order_relaxed);
+        if (connection->outbound)
+            owner->connected.fetch_add(1, std::memory_order_relaxed);
+
+        if (handler.on_connect)
+            handler.on_connect(*connection);
+        // 在停止期间建立的连接立即关闭
+        if (draining)
+            connection->close();
+        if (!connection->closing)
+            post_recv(connection);
+    }
+
+    inline void reactor::post_recv(tcp_connection* connection)
+    {
+        if (connection->closing || connection->recv_pending || connection->recv_paused)
+            return;
+
+        auto& chunk = connection->recv_chunk;
+        auto unconsumed = connection->recv_end - connection->recv_begin;
+        if (!chunk || chunk.use_count() > 1)
+        {
+            // 当前块还被其他地方引用(例如正在被零复制发送)，不能再写入，换一个新块并复制未消费的数据
+            auto fresh = connection->pool->acquire();
+            if (!fresh)
+            {
+                abort(connection);
+                return;
+            }
+            if (unconsumed)
+                std::memcpy(fresh.data(), chunk.data() + connection->recv_begin, unconsumed);
+            chunk = std::move(fresh);
+            connection->recv_begin = 0;
+            connection->recv_end = unconsumed;
+            chunk.set_size(unconsumed);
+        }
+        else if (connection->recv_begin)
+        {
+            // 把未消费的数据移动到缓冲区开头，为新数据腾出空间
+            std::memmove(chunk.data(), chunk.data() + connection->recv_begin, unconsumed);
+            connection->recv_begin = 0;
+            connection->recv_end = unconsumed;
+            chunk.set_size(unconsumed);
+        }
+        if (connection->recv_end == chunk.capacity())
+        {
+            // on_data无法从已满的缓冲区中消费任何数据，连接无法继续
+            abort(connection);
+            return;
+        }
+
+#ifdef _WIN32
+        auto buffer = chunk.to_wsabuf(connection->recv_end, chunk.capacity() - connection->recv_end);
+        DWORD flags = 0;
+        connection->recv_request.reset();
+        connection->recv_pending = true;
+        if (mw::socket::socket_recv_asyn(connection->socket, &buffer, 1, nullptr, flags, &connection->recv_request) == SOCKET_ERROR
+            && WSAGetLastError() != WSA_IO_PENDING)
+        {
+            connection->recv_pending = false;
+            abort(connection);
+        }
+#else
+        // 套接字不可读时等待可读事件
+        connection->recv_pending = true;
+        if (connection->readable)
+            read_now(connection);
+#endif
+    }
+
+    inline void reactor::recv_completed(tcp_connection* connection, bool succeeded, DWORD bytes)
+    {
+        connection->recv_pending = false;
+        if (connection->closing)
+        {
+            try_destroy(connection);
+            return;
+        }
+        if (!succeeded)
+        {
+            abort(connection);
+            return;
+        }
+        if (bytes == 0)
+        {
+            // 对端已关闭发送方向
+            connection->close();
+            return;
+        }
+
+        owner->bytes_received.fetch_add(bytes, std::memory_order_relaxed);
+        connection->recv_end += bytes;
+        connection->recv_chunk.set_size(connection->recv_end);
+        deliver(connection);
+    }
+
+    inline void reactor::deliver(tcp_connection* connection)
+    {
+        auto& handler = owner->handler;
+        auto available = connection->recv_end - connection->recv_begin;
+        if (available && handler.on_data)
+        {
+            auto consumed = handler.on_data(*connection, connection->recv_chunk.data() + connection->recv_begin, available);
+            connection->recv_begin += consumed < available ? consumed : available;
+        }
+        else
+            connection->recv_begin = connection->recv_end;
+
+        if (connection->recv_begin == connection->recv_end)
+            connection->recv_begin = connection->recv_end = 0;
+
+        if (connection->closing)
+        {
+            try_destroy(connection);
+            return;
+        }
+        // 发送队列超过高水位的一半时暂停接收，等发送完成后再继续：对端没有及时读取，继续接收它的数据只会让排队的数据越来越多。
+        // 排队的数据立即发送，还有未消费的数据时发送完成后on_data会被再次调用
+        if (connection->queue.pending_bytes()
+            && connection->send_capacity_left() < connection->queue.get_options().high_water_mark / 2)
+        {
+            if (!connection->send_pending)
+                flush_send(connection);
+            if (!connection->closing)
+            {
+                connection->recv_paused = true;
+                owner->read_pauses.fetch_add(1, std::memory_order_relaxed);
+            }
+            return;
+        }
+        post_recv(connection);
+    }
+
+    inline void reactor::schedule_flush(tcp_connection* connection)
+    {
+        // 正在发送时，发送完成后会继续发送排队的数据
+        if (connection->send_pending || !connection->queue.queued_bytes())
+            return;
+        if (connection->queue.should_flush() || (!connection->queue.is_coalescing() && !connection->corked))
+        {
+            flush_send(connection);
+            return;
+        }
+        if (connection->corked || connection->flush_scheduled)
+            return;
+
+        connection->flush_scheduled = true;
+        connection->flush_deadline = now_milliseconds() + connection->queue.get_options().flush_delay;
+        connection->flush_prev = flush_tail;
+        connection->flush_next = nullptr;
+        if (flush_tail)
+            flush_tail->flush_next = connection;
+        else
+            flush_head = connection;
+        flush_tail = connection;
+    }
+
+    inline void reactor::unschedule_flush(tcp_connection* connection)
+    {
+        if (!connection->flush_scheduled)
+            return;
+        connection->flush_scheduled = false;
+        if (connection->flush_prev)
+            connection->flush_prev->flush_next = connection->flush_next;
+        else
+            flush_head = connection->flush_next;
+        if (connection->flush_next)
+            connection->flush_next->flush_prev = connection->flush_prev;
+        else
+            flush_tail = connection->flush_prev;
+        connection->flush_prev = connection->flush_next = nullptr;
+    }
+
+    /// <summary>
+    /// 发送所有已经到期的连接的排队数据
+    /// </summary>
+    /// <returns>到下一个连接到期的毫秒数，若没有等待发送的连接，返回INFINITE</returns>
+    inline DWORD reactor::flush_due()
+    {
+        if (!flush_head)
+            return INFINITE;
+        auto now = now_milliseconds();
+        while (flush_head && flush_head->flush_deadline <= now)
+        {
+            auto connection = flush_head;
+            unschedule_flush(connection);
+            if (connection->send_pending || connection->corked || connection->socket == INVALID_SOCKET)
+                continue;
+            connection->busy = true;
+            flush_send(connection);
+            connection->busy = false;
+            try_destroy(connection);
+        }
+        return flush_head ? static_cast<DWORD>(flush_head->flush_deadline - now) : INFINITE;
+    }
+
+    inline void reactor::flush_send(tcp_connection* connection)
+    {
+        unschedule_flush(connection);
+        LPWSABUF buffers = nullptr;
+        DWORD count = 0;
+        if (!connection->queue.prepare_send(buffers, count))
+            return;
+
+        connection->send_pending = true;
+        owner->send_calls.fetch_add(1, std::memory_order_relaxed);
+#ifdef _WIN32
+        connection->send_request.reset();
+        if (mw::socket::socket_send_asyn(connection->socket, buffers, count, nullptr, 0, &connection->send_request) == SOCKET_ERROR
+            && WSAGetLastError() != WSA_IO_PENDING)
+        {
+            connection->send_pending = false;
+            connection->queue.send_completed();
+            abort(connection);
+        }
+#else
+        // 套接字不可写时等待可写事件
+        connection->send_buffers = buffers;
+        connection->send_count = count;
+        connection->send_written = 0;
+        if (connection->writable)
+            write_now(connection);
+#endif
+    }
+
+    inline void reactor::send_completed(tcp_connection* connection, bool succeeded, DWORD bytes)
+    {
+        connection->send_pending = false;
+        // 释放对已发送的块的引用
+        auto expected = connection->queue.send_completed();
+        if (!succeeded || bytes != expected)
+        {
+            abort(connection);
+            return;
+        }
+        owner->bytes_sent.fetch_add(bytes, std::memory_order_relaxed);
+
+        if (connection->socket == INVALID_SOCKET)
+        {
+            try_destroy(connection);
+            return;
+        }
+        if (connection->closing)
+        {
+            if (connection->queue.queued_bytes())
+                flush_send(connection);
+            else
+                finish_close(connection);
+            return;
+        }
+        // 发送期间排队的数据在这一轮结束时发送，这样这一轮中后续的写入也能合并进来
+        schedule_flush(connection);
+
+        if (connection->recv_paused && !connection->closing)
+        {
+            connection->recv_paused = false;
+            deliver(connection);
+        }
+    }
+
+    inline void reactor::finish_close(tcp_connection* connection)
+    {
+        if (connection->socket != INVALID_SOCKET)
+        {
+            // 数据已经全部交给协议栈，发送FIN后关闭套接字，未完成的接收会以错误完成
+#ifdef _WIN32
+            mw::socket::socket_shutdown(connection->socket, SD_SEND);
+#else
+            ::shutdown(connection->socket, SD_SEND);
+#endif
+            close_socket(connection);
+        }
+        try_destroy(connection);
+    }
+
+    inline void reactor::abort(tcp_connection* connection)
+    {
+        connection->closing = true;
+        unschedule_flush(connection);
+        connection->queue.discard();
+        if (connection->socket != INVALID_SOCKET)
+        {
+            linger option = { 1, 0 };
+            setsockopt(connection->socket, SOL_SOCKET, SO_LINGER, reinterpret_cast<const char*>(&option), sizeof(option));
+            close_socket(connection);
+        }
+        try_destroy(connection);
+    }
+
+    /// <summary>
+    /// 关闭连接的套接字。正在进行的重叠I/O会因此以错误完成，epoll后端中由这里为正在进行的接收和发送产生失败的完成
+    /// </summary>
+    inline void reactor::close_socket(tcp_connection* connection)
+    {
+        if (connection->socket == INVALID_SOCKET)
+            return;
+#ifdef _WIN32
+        mw::socket::close_socket(connection->socket);
+        connection->socket = INVALID_SOCKET;
+#else
+        ::close(connection->socket);
+        connection->socket = INVALID_SOCKET;
+        if (connection->recv_pending && !connection->recv_completion_queued)
+            complete(connection, io_operation::recv, false, 0);
+        if (connection->send_pending && !connection->send_completion_queued)
+            complete(connection, io_operation::send, false, 0);
+#endif
+    }
+
+    inline void reactor::try_destroy(tcp_connection* connection)
+    {
+        if (!connection->closing || connection->busy || connection->socket != INVALID_SOCKET
+            || connection->recv_pending || connection->send_pending)
+            return;
+        if (in_call)
+        {
+            // 等post的调用返回后再销毁
+            connection->busy = true;
+            deferred.push_back(connection);
+            return;
+        }
+
+        unschedule_flush(connection);
+        if (connection->established)
+        {
+            if (connection->prev)
+                connection->prev->next = connection->next;
+            else
+                head = connection->next;
+            if (connection->next)
+                connection->next->prev = connection->prev;
+            owner->active.fetch_sub(1, std::memory_order_relaxed);
+            if (owner->handler.on_close)
+                owner->handler.on_close(*connection);
+        }
+        if (!connection->outbound)
+            owner->inbound.fetch_sub(1, std::memory_order_relaxed);
+#ifdef _WIN32
+        delete connection;
+#else
+        connection->retired = true;
+        retired.push_back(connection);
+#endif
+        connection_count.fetch_sub(1);
+    }
+
+    /// <summary>
+    /// 处理探测和重新接受连接这两个计时器
+    /// </summary>
+    /// <param name="flush_timeout">flush_due返回的超时</param>
+    /// <returns>下次等待完成数据包的超时毫秒数</returns>
+    inline DWORD reactor::timers_due(DWORD flush_timeout)
+    {
+        auto timeout = flush_timeout;
+        auto& options = owner->options;
+        if (options.shed_target && !draining && !probe_pending)
+        {
+            auto now = now_microseconds();
+            if (now >= next_probe)
+            {
+                // 每个目标延迟探测一次，一个间隔内有足够的样本，空闲时探测立即返回
+                probe_pending = true;
+                probe_sent = now;
+                next_probe = now + options.shed_target * 1000ULL;
+                post_event(key_probe, nullptr);
+            }
+            else
+                timeout = (std::min)(timeout, static_cast<DWORD>((next_probe - now + 999) / 1000));
+        }
+        if (index == 0 && owner->parked_accepts.load())
+        {
+            auto now = now_milliseconds();
+            if (now >= next_accept_retry)
+            {
+                owner->resume_accepts();
+                next_accept_retry = now + options.accept_retry_interval;
+            }
+            if (owner->parked_accepts.load())
+                timeout = (std::min)(timeout, static_cast<DWORD>(next_accept_retry - (std::min)(now, next_accept_retry)));
+        }
+        return timeout;
+    }
+
+    /// <summary>
+    /// 探测数据包被取出，按CoDel(RFC 8289)的规则更新过载状态
+    /// </summary>
+    inline void reactor::probe_completed()
+    {
+        probe_pending = false;
+        auto now = now_microseconds();
+        auto delay = now - probe_sent;
+        for (auto peak = owner->max_queue_delay.load(std::memory_order_relaxed); delay > peak;)
+        {
+            if (owner->max_queue_delay.compare_exchange_weak(peak, delay, std::memory_order_relaxed))
+                break;
+        }
+
+        auto target = owner->options.shed_target * 1000ULL;
+        auto interval = owner->options.shed_interval * 1000ULL;
+        if (delay < target)
+        {
+            first_above = 0;
+            if (shedding)
+            {
+                shedding = false;
+                owner->shedding_reactors.fetch_sub(1, std::memory_order_relaxed);
+            }
+            return;
+        }
+        if (!first_above)
+            first_above = now + interval;
+        else if (!shedding && now >= first_above)
+        {
+            // 延迟持续一个间隔都超过目标，进入过载状态并立即丢弃一个。若刚退出过载不久，从上次的丢弃频率附近继续
+            shedding = true;
+            owner->shedding_reactors.fetch_add(1, std::memory_order_relaxed);
+            shed_count = shed_count > 2 && now - shed_next < 16 * interval ? shed_count - 2 : 0;
+            shed_next = now;
+        }
+    }
+
+    /// <summary>
+    /// 过载时按CoDel的控制律决定是否丢弃，第n次丢弃之后的间隔是interval / sqrt(n)
+    /// </summary>
+    inline bool reactor::should_shed()
+    {
+        if (!shedding)
+            return false;
+        auto now = now_microseconds();
+        if (now < shed_next)
+            return false;
+        shed_count++;
+        auto interval = owner->options.shed_interval * 1000.0;
+        shed_next = now + static_cast<ULONGLONG>(interval / std::sqrt(static_cast<double>(shed_count)));
+        return true;
+    }
+
+} // namespace tcp_detail
+
+} // namespace mw::net
@@ -1,4 +1,7 @@
 #pragma once
+#include "mw_error.h"
+#include "mw_handle.h"
+#include "mw_trace.h"
 #include <process.h>
 
 namespace mw {
@@ -118,6 +121,15 @@ inline HANDLE c_create_thread(LPTHREAD_START_ROUTINE thread_function, LPVOID par
     return val;
 }
 
+/// <summary>
+/// 与c_create_thread相同，但返回unique_kernel_handle，析构时自动关闭
+/// </summary>
+template <typename... Args>
+inline unique_kernel_handle c_create_thread(unique_tag, Args&&... args)
+{
+    return unique_kernel_handle(c_create_thread(std::forward<Args>(args)...));
+}
+
 /// <summary>
 /// 创建在另一个进程的虚拟地址空间中运行的线程
 /// </summary>
@@ -141,6 +153,15 @@ inline HANDLE create_remote_thread(HANDLE process_handle, LPTHREAD_START_ROUTINE
     return val;
 }
 
+/// <summary>
+/// 与create_remote_thread相同，但返回unique_kernel_handle，析构时自动关闭
+/// </summary>
+template <typename... Args>
+inline unique_kernel_handle create_remote_thread(unique_tag, Args&&... args)
+{
+    return unique_kernel_handle(create_remote_thread(std::forward<Args>(args)...));
+}
+
 /// <summary>
 /// 结束该调用线程，使用C/C++运行库的程序应该调用该函数而不是ExitThread，但是并不鼓励调用该函数，应该是线程函数自然返回。
 /// </summary>
@@ -182,6 +203,15 @@ inline HANDLE open_thread(DWORD thread_id, bool inherit_handle = false, DWORD de
     return val;
 }
 
+/// <summary>
+/// 与open_thread相同，但返回unique_kernel_handle，析构时自动关闭
+/// </summary>
+template <typename... Args>
+inline unique_kernel_handle open_thread(unique_tag, Args&&... args)
+{
+    return unique_kernel_handle(open_thread(std::forward<Args>(args)...));
+}
+
 /// <summary>
 /// 使调用线程挂起milliseconds长的时间，注意有些情况下不要调用该函数，会引发死锁，请看文档
 /// </summary>
@@ -385,6 +415,31 @@ inline void close_threadpool_work(PTP_WORK work_item)
     CloseThreadpoolWork(work_item);
 }
 
+/// <summary>
+/// 线程池工作项，关闭前取消排队的回调并等待正在执行的回调，所以不要在它自己的回调中析构
+/// </summary>
+struct threadpool_work_traits
+{
+    using pointer = PTP_WORK;
+    static constexpr pointer invalid() noexcept { return nullptr; }
+    static void close(pointer work_item) noexcept
+    {
+        WaitForThreadpoolWorkCallbacks(work_item, TRUE);
+        CloseThreadpoolWork(work_item);
+    }
+};
+
+using unique_threadpool_work = unique_handle<threadpool_work_traits>;
+
+/// <summary>
+/// 与create_threadpool_work相同，但返回unique_threadpool_work，析构时自动关闭
+/// </summary>
+template <typename... Args>
+inline unique_threadpool_work create_threadpool_work(unique_tag, Args&&... args)
+{
+    return unique_threadpool_work(create_threadpool_work(std::forward<Args>(args)...));
+}
+
 /// <summary>
 /// 将指定工作项推送到线程池中，工作线程会调用工作项中的回调函数，你可以一次或多次推送同一个工作项，而无须等待先前的回调完成，回调将并行执行
 /// </summary>
@@ -433,6 +488,32 @@ inline void close_threadpool_timer(PTP_TIMER timer)
     CloseThreadpoolTimer(timer);
 }
 
+/// <summary>
+/// 线程池计时器，按close_threadpool_timer的说明先停止计时器并等待回调，再关闭，所以不要在它自己的回调中析构
+/// </summary>
+struct threadpool_timer_traits
+{
+    using pointer = PTP_TIMER;
+    static constexpr pointer invalid() noexcept { return nullptr; }
+    static void close(pointer timer) noexcept
+    {
+        SetThreadpoolTimer(timer, nullptr, 0, 0);
+        WaitForThreadpoolTimerCallbacks(timer, TRUE);
+        CloseThreadpoolTimer(timer);
+    }
+};
+
+using unique_threadpool_timer = unique_handle<threadpool_timer_traits>;
+
+/// <summary>
+/// 与create_threadpool_timer相同，但返回unique_threadpool_timer，析构时自动关闭
+/// </summary>
+template <typename... Args>
+inline unique_threadpool_timer create_threadpool_timer(unique_tag, Args&&... args)
+{
+    return unique_threadpool_timer(create_threadpool_timer(std::forward<Args>(args)...));
+}
+
 /// <summary>
 /// 设置计时器对象，替换之前的计时器（如果有）。工作线程在指定的超时值(timeout)到期后调用计时器对象的回调。
 /// </summary>
@@ -493,6 +574,32 @@ inline void close_threadpool_wait(PTP_WAIT wait)
     CloseThreadpoolWait(wait);
 }
 
+/// <summary>
+/// 线程池等待项，先停止等待并等待回调，再关闭，所以不要在它自己的回调中析构
+/// </summary>
+struct threadpool_wait_traits
+{
+    using pointer = PTP_WAIT;
+    static constexpr pointer invalid() noexcept { return nullptr; }
+    static void close(pointer wait) noexcept
+    {
+        SetThreadpoolWait(wait, nullptr, nullptr);
+        WaitForThreadpoolWaitCallbacks(wait, TRUE);
+        CloseThreadpoolWait(wait);
+    }
+};
+
+using unique_threadpool_wait = unique_handle<threadpool_wait_traits>;
+
+/// <summary>
+/// 与create_threadpool_wait相同，但返回unique_threadpool_wait，析构时自动关闭
+/// </summary>
+template <typename... Args>
+inline unique_threadpool_wait create_threadpool_wait(unique_tag, Args&&... args)
+{
+    return unique_threadpool_wait(create_threadpool_wait(std::forward<Args>(args)...));
+}
+
 /// <summary>
 /// 设置等待对象，替换之前的等待对象（如果有）。在句柄发出信号后或指定的超时到期后，工作线程调用等待对象的回调函数。
 /// </summary>
@@ -548,6 +655,31 @@ inline void close_threadpool_io(PTP_IO io)
     CloseThreadpoolIo(io);
 }
 
+/// <summary>
+/// 线程池I/O完成对象，关闭前等待回调。与close_threadpool_io相同，析构前应该关闭文件句柄并等待重叠I/O完成
+/// </summary>
+struct threadpool_io_traits
+{
+    using pointer = PTP_IO;
+    static constexpr pointer invalid() noexcept { return nullptr; }
+    static void close(pointer io) noexcept
+    {
+        WaitForThreadpoolIoCallbacks(io, TRUE);
+        CloseThreadpoolIo(io);
+    }
+};
+
+using unique_threadpool_io = unique_handle<threadpool_io_traits>;
+
+/// <summary>
+/// 与create_threadpool_io相同，但返回unique_threadpool_io，析构时自动关闭
+/// </summary>
+template <typename... Args>
+inline unique_threadpool_io create_threadpool_io(unique_tag, Args&&... args)
+{
+    return unique_threadpool_io(create_threadpool_io(std::forward<Args>(args)...));
+}
+
 /// <summary>
 /// 通知线程池，指定I/O完成结构体绑定的I/O操作可能已经开始。当I/O操作完成时，工作线程将调用绑定的回调函数。注意，每一次异步IO之前都要调用该函数
 /// </summary>
@@ -672,6 +804,30 @@ inline void close_threadpool(PTP_POOL threadpool)
     CloseThreadpool(threadpool);
 }
 
+/// <summary>
+/// 线程池
+/// </summary>
+struct threadpool_traits
+{
+    using pointer = PTP_POOL;
+    static constexpr pointer invalid() noexcept { return nullptr; }
+    static void close(pointer threadpool) noexcept
+    {
+        CloseThreadpool(threadpool);
+    }
+};
+
+using unique_threadpool = unique_handle<threadpool_traits>;
+
+/// <summary>
+/// 与create_threadpool相同，但返回unique_threadpool，析构时自动关闭
+/// </summary>
+template <typename... Args>
+inline unique_threadpool create_threadpool(unique_tag, Args&&... args)
+{
+    return unique_threadpool(create_threadpool(std::forward<Args>(args)...));
+}
+
 /// <summary>
 /// 设置指定线程池可以分配给处理回调的最大线程数
 /// </summary>
@@ -798,6 +954,30 @@ inline void close_threadpool_cleanup_group(PTP_CLEANUP_GROUP cleanup_group)
     CloseThreadpoolCleanupGroup(cleanup_group);
 }
 
+/// <summary>
+/// 线程池清理组，析构前它必须没有成员
+/// </summary>
+struct threadpool_cleanup_group_traits
+{
+    using pointer = PTP_CLEANUP_GROUP;
+    static constexpr pointer invalid() noexcept { return nullptr; }
+    static void close(pointer cleanup_group) noexcept
+    {
+        CloseThreadpoolCleanupGroup(cleanup_group);
+    }
+};
+
+using unique_threadpool_cleanup_group = unique_handle<threadpool_cleanup_group_traits>;
+
+/// <summary>
+/// 与create_threadpool_cleanup_group相同，但返回unique_threadpool_cleanup_group，析构时自动关闭
+/// </summary>
+template <typename... Args>
+inline unique_threadpool_cleanup_group create_threadpool_cleanup_group(unique_tag, Args&&... args)
+{
+    return unique_threadpool_cleanup_group(create_threadpool_cleanup_group(std::forward<Args>(args)...));
+}
+
 /// <summary>
 /// 分配线程本地存储 (TLS) 索引。进程的任何线程随后都可以使用此索引来存储和获取线程本地的值，因为每个线程都接收自己的索引槽。
 /// </summary>
@@ -1411,12 +1591,14 @@ namespace sync {
     /// <param name="object_handle">指定内核对象的句柄(支持类型查看文档)，该句柄必须具有SYNCHRONIZE访问权限，若句柄在等待时关闭，函数行为未定义</param>
     /// <param name="milliseconds_to_wait">超时值，可以为0或INFINITE，若为INFINITE，不会因为超时值而返回</param>
     /// <param name="alertable">若为true，一个I/O完成例程或异步过程调用(APC)在线程队列中时返回并执行他们，否则不返回，并且不会执行完成例程或 APC 函数</param>
-    /// <returns>返回以WAIT_开头的宏，用于指示调用线程为什么继续执行</returns>
-    inline DWORD wait_for_single_object(HANDLE object_handle, DWORD milliseconds_to_wait = INFINITE, bool alertable = false)
+    /// <returns>返回以WAIT_开头的宏，用于指示调用线程为什么继续执行，返回值的类型由错误处理策略决定</returns>
+    template <typename Policy = MY_WINDOWS_ERROR_POLICY>
+    inline auto wait_for_single_object(HANDLE object_handle, DWORD milliseconds_to_wait = INFINITE, bool alertable = false, Policy = {})
     {
+        MW_TRACE_SCOPE(thread, object_handle);
         auto val = WaitForSingleObjectEx(object_handle, milliseconds_to_wait, alertable);
-        GET_ERROR_MSG_OUTPUT();
-        return val;
+        MW_TRACE_RESULT(val);
+        return Policy::apply(val, error::is_wait_failed, __FUNCTION__);
     }
 
     /// <summary>
@@ -1431,12 +1613,14 @@ namespace sync {
     /// <param name="wait_all">若为false，则内核句柄数组其中一个触发时就返回，若为true，则所有内核句柄触发才返回</param>
     /// <param name="milliseconds_to_wait">超时值，可以为0或INFINITE，若为INFINITE，不会因为超时值而返回</param>
     /// <param name="alertable">若为true，一个I/O完成例程或异步过程调用(APC)在线程队列中时返回并执行他们，否则不返回，并且不会执行完成例程或 APC 函数</param>
-    /// <returns>返回以WAIT_开头的宏，用于指示调用线程为什么继续执行</returns>
-    inline DWORD wait_for_multiple_object(DWORD counts, const HANDLE* object_handles, bool wait_all = true, DWORD milliseconds_to_wait = INFINITE, bool alertable = false)
+    /// <returns>返回以WAIT_开头的宏，用于指示调用线程为什么继续执行，返回值的类型由错误处理策略决定</returns>
+    template <typename Policy = MY_WINDOWS_ERROR_POLICY>
+    inline auto wait_for_multiple_object(DWORD counts, const HANDLE* object_handles, bool wait_all = true, DWORD milliseconds_to_wait = INFINITE, bool alertable = false, Policy = {})
     {
+        MW_TRACE_SCOPE(thread, object_handles);
         auto val = WaitForMultipleObjectsEx(counts, object_handles, wait_all, milliseconds_to_wait, alertable);
-        GET_ERROR_MSG_OUTPUT();
-        return val;
+        MW_TRACE_RESULT(val);
+        return Policy::apply(val, error::is_wait_failed, __FUNCTION__);
     }
 
     /// <summary>
@@ -1464,35 +1648,48 @@ namespace sync {
     /// <param name="event_name">事件的名字，该名称限制为MAX_PATH个字符，区分大小写，可以为nullptr，即未命名的内核对象</param>
     /// <param name="event_attributes">事件的安全属性</param>
     /// <returns>函数成功返回事件对象的句柄，若失败返回NULL，若命名的事件对象在函数调用之前存在,则函数返回现有对象的句柄</returns>
-    inline HANDLE create_event(DWORD flags = 0, DWORD desired_access = EVENT_ALL_ACCESS, const std::tstring& event_name = _T(""), LPSECURITY_ATTRIBUTES event_attributes = nullptr)
+    inline HANDLE create_event(DWORD flags = 0, DWORD desired_access = EVENT_ALL_ACCESS, tzstring_view event_name = nullptr, LPSECURITY_ATTRIBUTES event_attributes = nullptr)
     {
-        auto val = CreateEventEx(event_attributes, tstring_to_pointer(event_name), flags, desired_access);
+        auto val = CreateEventEx(event_attributes, event_name.get(), flags, desired_access);
         GET_ERROR_MSG_OUTPUT();
         return val;
     }
 
+    /// <summary>
+    /// 与create_event相同，但返回unique_kernel_handle，析构时自动关闭
+    /// </summary>
+    template <typename... Args>
+    inline unique_kernel_handle create_event(unique_tag, Args&&... args)
+    {
+        return unique_kernel_handle(create_event(std::forward<Args>(args)...));
+    }
+
     /// <summary>
     /// 将指定的事件对象设置为触发状态，对于自动事件，被某一等待该事件的线程捕获后自动变为未触发状态，而手动事件除非调用ResetEvent，会保持触发状态
     /// </summary>
     /// <param name="event_handle">指定事件对象的句柄，句柄必须具有 EVENT_MODIFY_STATE 访问权限</param>
-    /// <returns>操作是否成功</returns>
-    inline bool set_event(HANDLE event_handle)
+    /// <returns>操作是否成功，返回值的类型由错误处理策略决定</returns>
+    template <typename Policy = MY_WINDOWS_ERROR_POLICY>
+    inline auto set_event(HANDLE event_handle, Policy = {})
     {
-        auto val = SetEvent(event_handle);
-        GET_ERROR_MSG_OUTPUT();
-        return val;
+        MW_TRACE_SCOPE(thread, event_handle);
+        auto val = SetEvent(event_handle) != FALSE;
+        MW_TRACE_RESULT(val);
+        return Policy::apply(val, error::is_false, __FUNCTION__);
     }
 
     /// <summary>
     /// 将指定的事件对象设置为未触发状态，该函数主要用于手动重置事件对象，自动事件被某一等待该事件的线程捕获后自动变为未触发状态
     /// </summary>
     /// <param name="event_handle">指定事件对象的句柄，句柄必须具有 EVENT_MODIFY_STATE 访问权限</param>
-    /// <returns>操作是否成功</returns>
-    inline bool reset_event(HANDLE event_handle)
+    /// <returns>操作是否成功，返回值的类型由错误处理策略决定</returns>
+    template <typename Policy = MY_WINDOWS_ERROR_POLICY>
+    inline auto reset_event(HANDLE event_handle, Policy = {})
     {
-        auto val = ResetEvent(event_handle);
-        GET_ERROR_MSG_OUTPUT();
-        return val;
+        MW_TRACE_SCOPE(thread, event_handle);
+        auto val = ResetEvent(event_handle) != FALSE;
+        MW_TRACE_RESULT(val);
+        return Policy::apply(val, error::is_false, __FUNCTION__);
     }
 
     /// <summary>
@@ -1502,13 +1699,22 @@ namespace sync {
     /// <param name="inherit_handle">如果此值为TRUE，则此进程创建的子进程将继承句柄。否则，子进程不会继承这个句柄</param>
     /// <param name="desired_access">返回的句柄具有的访问权限，它是EVENT_开头的宏</param>
     /// <returns>函数成功，则返回值是事件对象的句柄。如果函数失败，则返回值为NULL</returns>
-    inline HANDLE open_event(const std::tstring& event_name, bool inherit_handle = false, DWORD desired_access = EVENT_ALL_ACCESS)
+    inline HANDLE open_event(tzstring_view event_name, bool inherit_handle = false, DWORD desired_access = EVENT_ALL_ACCESS)
     {
         auto val = OpenEvent(desired_access, inherit_handle, event_name.c_str());
         GET_ERROR_MSG_OUTPUT();
         return val;
     }
 
+    /// <summary>
+    /// 与open_event相同，但返回unique_kernel_handle，析构时自动关闭
+    /// </summary>
+    template <typename... Args>
+    inline unique_kernel_handle open_event(unique_tag, Args&&... args)
+    {
+        return unique_kernel_handle(open_event(std::forward<Args>(args)...));
+    }
+
     /// <summary>
     /// 创建或打开命名或未命名的可等待计时器(waitable_timer)内核对象并返回内核对象的句柄
     /// </summary>
@@ -1518,13 +1724,22 @@ namespace sync {
     /// <param name="waitable_timer_attributes">计时器的安全属性</param>
     /// <returns>函数成功返回计时器对象的句柄，若失败返回NULL，若命名的计时器对象在函数调用之前存在,则函数返回现有对象的句柄</returns>
     inline HANDLE create_waitable_timer(DWORD flags = 0, DWORD desired_access = TIMER_ALL_ACCESS,
-        const std::tstring& waitable_timer_name = _T(""), LPSECURITY_ATTRIBUTES waitable_timer_attributes = nullptr)
+        tzstring_view waitable_timer_name = nullptr, LPSECURITY_ATTRIBUTES waitable_timer_attributes = nullptr)
     {
-        auto val = CreateWaitableTimerEx(waitable_timer_attributes, tstring_to_pointer(waitable_timer_name), flags, desired_access);
+        auto val = CreateWaitableTimerEx(waitable_timer_attributes, waitable_timer_name.get(), flags, desired_access);
         GET_ERROR_MSG_OUTPUT();
         return val;
     }
 
+    /// <summary>
+    /// 与create_waitable_timer相同，但返回unique_kernel_handle，析构时自动关闭
+    /// </summary>
+    template <typename... Args>
+    inline unique_kernel_handle create_waitable_timer(unique_tag, Args&&... args)
+    {
+        return unique_kernel_handle(create_waitable_timer(std::forward<Args>(args)...));
+    }
+
     /// <summary>
     /// 激活或设置指定可等待计时器，当due_time到期时，该计时器将被触发，并且设置计时器的线程调用可选的完成例程(如果有的话)
     /// </summary>
@@ -1535,25 +1750,23 @@ namespace sync {
     /// <param name="completion_rountine">[opt]可选的完成例程指针，当计时器触发时执行</param>
     /// <param name="arg_to_completion_rountine">[opt]可选的指针参数，用于传给完成例程</param>
     /// <param name="resume">一般为false，若为true，则当系统在挂起的节能模式时，并且计时器触发，则系统从挂起中恢复</param>
-    /// <returns>操作是否成功</returns>
-    inline bool set_waitable_timer(HANDLE waitable_timer, const LARGE_INTEGER* due_time, LONG cycle_time,
-        PTIMERAPCROUTINE completion_rountine = nullptr, LPVOID arg_to_completion_rountine = nullptr, bool resume = false)
+    /// <returns>操作是否成功，返回值的类型由错误处理策略决定</returns>
+    template <typename Policy = MY_WINDOWS_ERROR_POLICY>
+    inline auto set_waitable_timer(HANDLE waitable_timer, const LARGE_INTEGER* due_time, LONG cycle_time,
+        PTIMERAPCROUTINE completion_rountine = nullptr, LPVOID arg_to_completion_rountine = nullptr, bool resume = false, Policy = {})
     {
-        auto val = SetWaitableTimer(waitable_timer, due_time, cycle_time, completion_rountine, arg_to_completion_rountine, resume);
-        GET_ERROR_MSG_OUTPUT();
-        return val;
+        return Policy::apply(SetWaitableTimer(waitable_timer, due_time, cycle_time, completion_rountine, arg_to_completion_rountine, resume) != FALSE, error::is_false, __FUNCTION__);
     }
 
     /// <summary>
     /// 将指定可等待计时器设置为未激活状态
     /// </summary>
     /// <param name="waitable_timer">计时器对象的句柄，该句柄必须具有TIMER_MODIFY_STATE访问权限</param>
-    /// <returns>操作是否成功</returns>
-    inline bool cancel_waitable_timer(HANDLE waitable_timer)
+    /// <returns>操作是否成功，返回值的类型由错误处理策略决定</returns>
+    template <typename Policy = MY_WINDOWS_ERROR_POLICY>
+    inline auto cancel_waitable_timer(HANDLE waitable_timer, Policy = {})
     {
-        auto val = CancelWaitableTimer(waitable_timer);
-        GET_ERROR_MSG_OUTPUT();
-        return val;
+        return Policy::apply(CancelWaitableTimer(waitable_timer) != FALSE, error::is_false, __FUNCTION__);
     }
 
     /// <summary>
@@ -1563,13 +1776,22 @@ namespace sync {
     /// <param name="inherit_handle">如果此值为TRUE，则此进程创建的子进程将继承句柄。否则，子进程不会继承这个句柄</param>
     /// <param name="desired_access">返回的句柄具有的访问权限，它是TIMER_开头的宏</param>
     /// <returns>函数成功，则返回值是计时器对象的句柄。如果函数失败，则返回值为NULL</returns>
-    inline HANDLE open_waitable_timer(const std::tstring& waitable_timer_name, bool inherit_handle = false, DWORD desired_access = TIMER_MODIFY_STATE)
+    inline HANDLE open_waitable_timer(tzstring_view waitable_timer_name, bool inherit_handle = false, DWORD desired_access = TIMER_MODIFY_STATE)
     {
         auto val = OpenWaitableTimer(desired_access, inherit_handle, waitable_timer_name.c_str());
         GET_ERROR_MSG_OUTPUT();
         return val;
     }
 
+    /// <summary>
+    /// 与open_waitable_timer相同，但返回unique_kernel_handle，析构时自动关闭
+    /// </summary>
+    template <typename... Args>
+    inline unique_kernel_handle open_waitable_timer(unique_tag, Args&&... args)
+    {
+        return unique_kernel_handle(open_waitable_timer(std::forward<Args>(args)...));
+    }
+
     /// <summary>
     /// 挂起当前线程，直到调用I/O完成回调函数，异步过程调用 (APC) 排队等待线程或超时间隔已过
     /// </summary>
@@ -1592,14 +1814,23 @@ namespace sync {
     /// <param name="semaphore_name">信号量的名字，该名称限制为MAX_PATH个字符，区分大小写，可以为nullptr，即未命名的内核对象</param>
     /// <returns>函数成功返回信号量对象的句柄，若失败返回NULL，若命名的信号量对象在函数调用之前存在,则函数返回现有对象的句柄</returns>
     inline HANDLE create_semaphore(LONG maxnum_count, LONG initial_count = 0, DWORD desired_access = SEMAPHORE_ALL_ACCESS,
-        LPSECURITY_ATTRIBUTES semaphore_attributes = nullptr, const std::tstring& semaphore_name = _T(""))
+        LPSECURITY_ATTRIBUTES semaphore_attributes = nullptr, tzstring_view semaphore_name = nullptr)
     {
         auto val = CreateSemaphoreEx(semaphore_attributes, initial_count, maxnum_count,
-            tstring_to_pointer(semaphore_name), 0, desired_access);
+            semaphore_name.get(), 0, desired_access);
         GET_ERROR_MSG_OUTPUT();
         return val;
     }
 
+    /// <summary>
+    /// 与create_semaphore相同，但返回unique_kernel_handle，析构时自动关闭
+    /// </summary>
+    template <typename... Args>
+    inline unique_kernel_handle create_semaphore(unique_tag, Args&&... args)
+    {
+        return unique_kernel_handle(create_semaphore(std::forward<Args>(args)...));
+    }
+
     /// <summary>
     /// 打开现有的命名信号量对象
     /// </summary>
@@ -1607,7 +1838,7 @@ namespace sync {
     /// <param name="inherit_handle">如果此值为TRUE，则此进程创建的子进程将继承句柄。否则，子进程不会继承这个句柄</param>
     /// <param name="desired_access">返回的句柄具有的访问权限，它是SEMAPHORE_开头的宏</param>
     /// <returns>函数成功，则返回值是信号量对象的句柄。如果函数失败，则返回值为NULL</returns>
-    inline HANDLE open_semaphore(const std::tstring& semaphore_name, bool inherit_handle = false,
+    inline HANDLE open_semaphore(tzstring_view semaphore_name, bool inherit_handle = false,
         DWORD desired_access = SEMAPHORE_ALL_ACCESS)
     {
         auto val = OpenSemaphore(desired_access, inherit_handle, semaphore_name.c_str());
@@ -1615,18 +1846,29 @@ namespace sync {
         return val;
     }
 
+    /// <summary>
+    /// 与open_semaphore相同，但返回unique_kernel_handle，析构时自动关闭
+    /// </summary>
+    template <typename... Args>
+    inline unique_kernel_handle open_semaphore(unique_tag, Args&&... args)
+    {
+        return unique_kernel_handle(open_semaphore(std::forward<Args>(args)...));
+    }
+
     /// <summary>
     /// 为指定信号量对象增加指定数量的当前资源计数
     /// </summary>
     /// <param name="semaphore_handle">指定信号量句柄，该句柄必须具有SEMAPHORE_MODIFY_STATE访问权限</param>
     /// <param name="release_count">要为当前资源计数增加的量，该值必须大于0，若指定的数量会导致信号量的计数超过最大计数，则不会更改并返回FALSE</param>
     /// <param name="previous_count">[out,opt]接收信号量的先前计数的变量，若不需要可以为NULL</param>
-    /// <returns>操作是否成功</returns>
-    inline bool release_semaphore(HANDLE semaphore_handle, LONG release_count, LPLONG previous_count = nullptr)
+    /// <returns>操作是否成功，返回值的类型由错误处理策略决定</returns>
+    template <typename Policy = MY_WINDOWS_ERROR_POLICY>
+    inline auto release_semaphore(HANDLE semaphore_handle, LONG release_count, LPLONG previous_count = nullptr, Policy = {})
     {
-        auto val = ReleaseSemaphore(semaphore_handle, release_count, previous_count);
-        GET_ERROR_MSG_OUTPUT();
-        return val;
+        MW_TRACE_SCOPE(thread, semaphore_handle);
+        auto val = ReleaseSemaphore(semaphore_handle, release_count, previous_count) != FALSE;
+        MW_TRACE_RESULT(val);
+        return Policy::apply(val, error::is_false, __FUNCTION__);
     }
 
     /// <summary>
@@ -1637,14 +1879,23 @@ namespace sync {
     /// <param name="desired_access">返回的句柄具有的访问权限，它是MUTEX_开头的宏</param>
     /// <param name="mutex_attributes">互斥量的安全属性</param>
     /// <returns>函数成功返回互斥量对象的句柄，若失败返回NULL，若命名的信号量对象在函数调用之前存在,则函数返回现有对象的句柄</returns>
-    inline HANDLE create_mutex(const std::tstring& mutex_name = _T(""), DWORD flags = 0,
+    inline HANDLE create_mutex(tzstring_view mutex_name = nullptr, DWORD flags = 0,
         DWORD desired_access = MUTEX_ALL_ACCESS, LPSECURITY_ATTRIBUTES mutex_attributes = nullptr)
     {
-        auto val = CreateMutexEx(mutex_attributes, tstring_to_pointer(mutex_name), flags, desired_access);
+        auto val = CreateMutexEx(mutex_attributes, mutex_name.get(), flags, desired_access);
         GET_ERROR_MSG_OUTPUT();
         return val;
     }
 
+    /// <summary>
+    /// 与create_mutex相同，但返回unique_kernel_handle，析构时自动关闭
+    /// </summary>
+    template <typename... Args>
+    inline unique_kernel_handle create_mutex(unique_tag, Args&&... args)
+    {
+        return unique_kernel_handle(create_mutex(std::forward<Args>(args)...));
+    }
+
     /// <summary>
     /// 打开现有的命名互斥量对象
     /// </summary>
@@ -1652,7 +1903,7 @@ namespace sync {
     /// <param name="inherit_handle">如果此值为TRUE，则此进程创建的子进程将继承句柄。否则，子进程不会继承这个句柄</param>
     /// <param name="desired_access">返回的句柄具有的访问权限，它是MUTEX_开头的宏</param>
     /// <returns>函数成功，则返回值是互斥量对象的句柄。如果函数失败，则返回值为NULL</returns>
-    inline HANDLE open_mutex(const std::tstring& mutex_name, bool inherit_handle = false,
+    inline HANDLE open_mutex(tzstring_view mutex_name, bool inherit_handle = false,
         DWORD desired_access = MUTEX_ALL_ACCESS)
     {
         auto val = OpenMutex(desired_access, inherit_handle, mutex_name.c_str());
@@ -1660,16 +1911,27 @@ namespace sync {
         return val;
     }
 
+    /// <summary>
+    /// 与open_mutex相同，但返回unique_kernel_handle，析构时自动关闭
+    /// </summary>
+    template <typename... Args>
+    inline unique_kernel_handle open_mutex(unique_tag, Args&&... args)
+    {
+        return unique_kernel_handle(open_mutex(std::forward<Args>(args)...));
+    }
+
     /// <summary>
     /// 调用线程释放对指定互斥量的占有，若你是递归的占有互斥量(多次调用等待函数获取同一个互斥量)，那么你也要调用该函数相同的次数，使得互斥量解除占有
     /// </summary>
     /// <param name="mutex_handle">互斥量句柄</param>
-    /// <returns>操作是否成功</returns>
-    inline bool release_mutex(HANDLE mutex_handle)
+    /// <returns>操作是否成功，返回值的类型由错误处理策略决定</returns>
+    template <typename Policy = MY_WINDOWS_ERROR_POLICY>
+    inline auto release_mutex(HANDLE mutex_handle, Policy = {})
     {
-        auto val = ReleaseMutex(mutex_handle);
-        GET_ERROR_MSG_OUTPUT();
-        return val;
+        MW_TRACE_SCOPE(thread, mutex_handle);
+        auto val = ReleaseMutex(mutex_handle) != FALSE;
+        MW_TRACE_RESULT(val);
+        return Policy::apply(val, error::is_false, __FUNCTION__);
     }
 
     /// <summary>
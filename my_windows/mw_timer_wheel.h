@@ -0,0 +1,156 @@
+#pragma once
+#ifdef _WIN32
+#    include "mw_system.h"
+#else
+#    include "mw_platform.h"
+#endif
+#include <algorithm>
+#include <iterator>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+namespace mw::net {
+
+/// <summary>
+/// 哈希时间轮，用于管理大量精度要求不高的超时(例如空闲连接的回收，等待的超时)
+/// </summary>
+/// <remarks>
+/// 时间被划分为tick毫秒的刻度，每个计时器按到期的刻度放入slot_count个槽中的一个，
+/// schedule和cancel是O(1)的，advance只检查经过的槽，所以计时器的数量不影响推进的开销。
+/// 计时器最多会延迟一个刻度到期。时间轮不是线程安全的，也不会自己推进，使用者需要周期性地调用advance
+/// </remarks>
+/// <typeparam name="T">计时器携带的值，到期时交给advance的回调</typeparam>
+template <typename T>
+class timer_wheel
+{
+public:
+    using timer_id = ULONGLONG;
+
+    /// <param name="tick">刻度的毫秒数</param>
+    /// <param name="slot_count">槽的数量，tick * slot_count之内的计时器只需要检查一次</param>
+    /// <param name="now">当前时间(毫秒)，之后传给schedule和advance的时间必须使用相同的时钟</param>
+    explicit timer_wheel(DWORD tick = 100, size_t slot_count = 512, ULONGLONG now = mw::get_system_time())
+        : tick(tick ? tick : 1)
+        , slots(slot_count ? slot_count : 1)
+        , current_tick(now / this->tick)
+    {
+    }
+    timer_wheel(const timer_wheel&) = delete;
+    timer_wheel(timer_wheel&&) = delete;
+    timer_wheel& operator=(const timer_wheel&) = delete;
+    timer_wheel& operator=(timer_wheel&&) = delete;
+
+public:
+    /// <summary>
+    /// 添加一个计时器
+    /// </summary>
+    /// <param name="deadline">到期时间(毫秒)，若已经过去，则在下一个刻度到期</param>
+    /// <param name="value">计时器携带的值</param>
+    /// <returns>计时器的标识，用于cancel，它不会是0</returns>
+    timer_id schedule(ULONGLONG deadline, T value)
+    {
+        auto due_tick = (deadline + tick - 1) / tick;
+        if (due_tick <= current_tick)
+            due_tick = current_tick + 1;
+        auto slot = static_cast<size_t>(due_tick % slots.size());
+        auto id = ++last_id;
+        slots[slot].push_back({ id, due_tick, std::move(value) });
+        index.emplace(id, location { slot, std::prev(slots[slot].end()) });
+        return id;
+    }
+
+    /// <summary>
+    /// 删除一个计时器
+    /// </summary>
+    /// <param name="id">schedule返回的标识</param>
+    /// <returns>若计时器已经到期或已被删除，返回false</returns>
+    bool cancel(timer_id id)
+    {
+        auto it = index.find(id);
+        if (it == index.end())
+            return false;
+        slots[it->second.slot].erase(it->second.position);
+        index.erase(it);
+        return true;
+    }
+
+    /// <summary>
+    /// 把时间推进到now，对每个到期的计时器调用on_expired
+    /// </summary>
+    /// <remarks>
+    /// 到期的计时器在调用on_expired之前已经被删除，所以on_expired中可以调用schedule和cancel
+    /// </remarks>
+    /// <param name="now">当前时间(毫秒)</param>
+    /// <param name="on_expired">可调用对象，参数是(timer_id, T&amp;)</param>
+    /// <returns>到期的计时器数量</returns>
+    template <typename Func>
+    size_t advance(ULONGLONG now, Func&& on_expired)
+    {
+        auto target_tick = now / tick;
+        if (target_tick <= current_tick || index.empty())
+        {
+            if (target_tick > current_tick)
+                current_tick = target_tick;
+            return 0;
+        }
+
+        // 超过一整圈时每个槽都只需要检查一次
+        auto end_tick = (std::min)(target_tick, current_tick + slots.size());
+        std::list<entry> expired;
+        for (auto t = current_tick + 1; t <= end_tick; t++)
+        {
+            auto& slot = slots[static_cast<size_t>(t % slots.size())];
+            for (auto it = slot.begin(); it != slot.end();)
+            {
+                auto next = std::next(it);
+                if (it->due_tick <= target_tick)
+                {
+                    index.erase(it->id);
+                    expired.splice(expired.end(), slot, it);
+                }
+                it = next;
+            }
+        }
+        current_tick = target_tick;
+
+        for (auto& timer : expired)
+            on_expired(timer.id, timer.value);
+        return expired.size();
+    }
+
+    /// <summary>删除所有计时器</summary>
+    void clear()
+    {
+        for (auto& slot : slots)
+            slot.clear();
+        index.clear();
+    }
+
+    /// <summary>计时器的数量</summary>
+    size_t size() const { return index.size(); }
+    bool empty() const { return index.empty(); }
+    DWORD get_tick() const { return tick; }
+
+private:
+    struct entry
+    {
+        timer_id id;
+        ULONGLONG due_tick;
+        T value;
+    };
+
+    struct location
+    {
+        size_t slot;
+        typename std::list<entry>::iterator position;
+    };
+
+    DWORD tick;
+    std::vector<std::list<entry>> slots;
+    std::unordered_map<timer_id, location> index;
+    ULONGLONG current_tick;
+    timer_id last_id = 0;
+};
+
+} // namespace mw::net
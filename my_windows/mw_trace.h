@@ -0,0 +1,606 @@
+#pragma once
+#include "mw_clock.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#ifndef _WIN32
+#    include <sys/syscall.h>
+#    include <unistd.h>
+#endif
+
+// 追踪在编译时按模块启用，在包含my_windows.h之前定义以下的宏(或者在项目的预处理器定义中)：
+//   MW_TRACE_THREAD, MW_TRACE_DEVICE, MW_TRACE_SOCKET, MW_TRACE_MEMORY, MW_TRACE_WINDOW，MW_TRACE_ALL启用全部模块。
+// 没有启用的模块中MW_TRACE_SCOPE声明的是空对象，优化后不生成任何代码。
+// MW_TRACE_BUFFER_EVENTS是每个线程的环形缓冲区容纳的事件数，必须是2的幂。
+// MW_TRACE_MAX_RETIRED_BUFFERS是已退出的线程最多保留多少个还没有读取完的缓冲区
+#if defined(MW_TRACE_ALL) || defined(MW_TRACE_THREAD)
+#    define MW_TRACE_THREAD_ENABLED true
+#else
+#    define MW_TRACE_THREAD_ENABLED false
+#endif
+#if defined(MW_TRACE_ALL) || defined(MW_TRACE_DEVICE)
+#    define MW_TRACE_DEVICE_ENABLED true
+#else
+#    define MW_TRACE_DEVICE_ENABLED false
+#endif
+#if defined(MW_TRACE_ALL) || defined(MW_TRACE_SOCKET)
+#    define MW_TRACE_SOCKET_ENABLED true
+#else
+#    define MW_TRACE_SOCKET_ENABLED false
+#endif
+#if defined(MW_TRACE_ALL) || defined(MW_TRACE_MEMORY)
+#    define MW_TRACE_MEMORY_ENABLED true
+#else
+#    define MW_TRACE_MEMORY_ENABLED false
+#endif
+#if defined(MW_TRACE_ALL) || defined(MW_TRACE_WINDOW)
+#    define MW_TRACE_WINDOW_ENABLED true
+#else
+#    define MW_TRACE_WINDOW_ENABLED false
+#endif
+#ifndef MW_TRACE_BUFFER_EVENTS
+#    define MW_TRACE_BUFFER_EVENTS 4096
+#endif
+#ifndef MW_TRACE_MAX_RETIRED_BUFFERS
+#    define MW_TRACE_MAX_RETIRED_BUFFERS 16
+#endif
+
+/// <summary>
+/// 在wrapper的开头声明追踪作用域，作用域结束时记录调用名，耗时，句柄和MW_TRACE_RESULT设置的结果。
+/// trace_module是mw::trace::module的枚举值名(thread，device，socket，memory，window)
+/// </summary>
+#define MW_TRACE_SCOPE(trace_module, handle)                                                                                \
+    mw::trace::scope<mw::trace::is_enabled(mw::trace::module::trace_module)> mw_trace_scope_(mw::trace::module::trace_module, \
+        __FUNCTION__, handle)
+
+/// <summary>
+/// 设置当前追踪作用域的结果，没有启用时不做任何事
+/// </summary>
+#define MW_TRACE_RESULT(value) mw_trace_scope_.set_result(value)
+
+namespace mw::trace {
+
+/// <summary>
+/// 可以单独启用追踪的模块
+/// </summary>
+enum class module : std::uint16_t
+{
+    thread,
+    device,
+    socket,
+    memory,
+    window,
+    count
+};
+
+/// <summary>
+/// 模块是否在编译时启用了追踪
+/// </summary>
+constexpr bool is_enabled(module trace_module)
+{
+    constexpr bool enabled[] = { MW_TRACE_THREAD_ENABLED, MW_TRACE_DEVICE_ENABLED, MW_TRACE_SOCKET_ENABLED, MW_TRACE_MEMORY_ENABLED, MW_TRACE_WINDOW_ENABLED };
+    return trace_module < module::count && enabled[static_cast<size_t>(trace_module)];
+}
+
+inline const char* module_name(module trace_module)
+{
+    constexpr const char* names[] = { "thread", "device", "socket", "memory", "window" };
+    return trace_module < module::count ? names[static_cast<size_t>(trace_module)] : "unknown";
+}
+
+/// <summary>
+/// 把句柄或结果(指针，整数，枚举)转换为64位整数，其他类型记录为0
+/// </summary>
+template <typename T>
+inline std::int64_t to_trace_value(const T& value) noexcept
+{
+    if constexpr (std::is_pointer_v<T>)
+        return static_cast<std::int64_t>(reinterpret_cast<std::uintptr_t>(value));
+    else if constexpr (std::is_integral_v<T> || std::is_enum_v<T>)
+        return static_cast<std::int64_t>(value);
+    else
+        return 0;
+}
+
+/// <summary>
+/// 从线程缓冲区中取出的一个事件，时间已经转换为纳秒
+/// </summary>
+struct event
+{
+    const char* name;
+    module trace_module;
+    std::uint64_t start_ns;
+    std::uint64_t duration_ns;
+    std::int64_t handle;
+    std::int64_t result;
+};
+
+/// <summary>
+/// 每个线程的事件环形缓冲区和所有缓冲区的注册表
+/// </summary>
+/// <remarks>
+/// 每个线程第一次记录事件时分配自己的缓冲区并注册，之后的记录只有一次线程局部变量的读取和几次relaxed存储，不加锁。
+/// 缓冲区满时覆盖最旧的事件，读取者用每个槽的序号(seqlock)检测读取期间被覆盖的事件并丢弃，丢弃的数量计入dropped。
+/// 线程退出后它的缓冲区保留到被读取完，所以退出前的事件不会丢失；读取完的缓冲区被释放，或者被之后注册的线程重用。
+/// 每个缓冲区约capacity * 56字节(默认约229KB)，没有读取者时已退出的线程最多保留max_retired_buffers个缓冲区，
+/// 超过时新线程重用最早退出的线程的缓冲区，其中未读取的事件计入dropped，所以总内存不超过(存活的线程数 + max_retired_buffers)个缓冲区。
+/// 同一时间只应该有一个读取者(binary_writer)
+/// </remarks>
+class recorder
+{
+public:
+    static constexpr std::uint64_t capacity = MW_TRACE_BUFFER_EVENTS;
+    static_assert((capacity & (capacity - 1)) == 0, "MW_TRACE_BUFFER_EVENTS必须是2的幂");
+    static constexpr size_t max_retired_buffers = MW_TRACE_MAX_RETIRED_BUFFERS;
+
+    /// <summary>
+    /// 记录一个事件，start和end是tsc_clock::raw_now的返回值
+    /// </summary>
+    static void record(module trace_module, const char* name, std::int64_t handle, std::int64_t result, std::uint64_t start, std::uint64_t end)
+    {
+        auto buffer = current_buffer;
+        if (!buffer)
+            buffer = register_thread();
+        else if (buffer == retired_marker())
+            return;
+        auto index = buffer->head.load(std::memory_order_relaxed);
+        auto& slot = buffer->slots[index & (capacity - 1)];
+        slot.sequence.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.name.store(name, std::memory_order_relaxed);
+        slot.trace_module.store(static_cast<std::uint16_t>(trace_module), std::memory_order_relaxed);
+        slot.start.store(start, std::memory_order_relaxed);
+        slot.end.store(end, std::memory_order_relaxed);
+        slot.handle.store(handle, std::memory_order_relaxed);
+        slot.result.store(result, std::memory_order_relaxed);
+        slot.sequence.store(index + 1, std::memory_order_release);
+        buffer->head.store(index + 1, std::memory_order_release);
+    }
+
+    /// <summary>
+    /// 取出所有线程的新事件，对每个有事件或丢弃了事件的线程调用一次callback(thread_id, events, dropped)
+    /// </summary>
+    template <typename Callback>
+    static void drain(Callback&& callback)
+    {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        std::vector<event> events;
+        // 被新线程重用之前没有读取的事件
+        for (auto& entry : discarded)
+            callback(entry.first, events, entry.second);
+        discarded.clear();
+        for (auto it = buffers.begin(); it != buffers.end();)
+        {
+            auto& buffer = **it;
+            // 先读取retired，之后读到的head包括了线程退出前的所有事件
+            auto retired = buffer.retired.load(std::memory_order_acquire);
+            auto head = buffer.head.load(std::memory_order_acquire);
+            std::uint64_t dropped = 0;
+            if (head - buffer.read > capacity)
+            {
+                dropped += head - capacity - buffer.read;
+                buffer.read = head - capacity;
+            }
+            events.clear();
+            for (auto index = buffer.read; index < head; index++)
+            {
+                auto& slot = buffer.slots[index & (capacity - 1)];
+                if (slot.sequence.load(std::memory_order_acquire) != index + 1)
+                {
+                    dropped++;
+                    continue;
+                }
+                auto start = slot.start.load(std::memory_order_relaxed);
+                auto end = slot.end.load(std::memory_order_relaxed);
+                event item { slot.name.load(std::memory_order_relaxed), static_cast<module>(slot.trace_module.load(std::memory_order_relaxed)), 0, 0,
+                    slot.handle.load(std::memory_order_relaxed), slot.result.load(std::memory_order_relaxed) };
+                std::atomic_thread_fence(std::memory_order_acquire);
+                // 读取期间被写入者覆盖
+                if (slot.sequence.load(std::memory_order_relaxed) != index + 1)
+                {
+                    dropped++;
+                    continue;
+                }
+                auto start_time = clock::tsc_clock::from_raw(start).time_since_epoch().count();
+                auto end_time = clock::tsc_clock::from_raw(end).time_since_epoch().count();
+                item.start_ns = static_cast<std::uint64_t>(start_time);
+                item.duration_ns = end_time > start_time ? static_cast<std::uint64_t>(end_time - start_time) : 0;
+                events.push_back(item);
+            }
+            buffer.read = head;
+            if (!events.empty() || dropped)
+                callback(buffer.thread_id, events, dropped);
+            if (retired && buffer.head.load(std::memory_order_acquire) == buffer.read)
+                it = buffers.erase(it);
+            else
+                ++it;
+        }
+    }
+
+    /// <summary>
+    /// 停止记录当前线程的事件，之后的记录被忽略，缓冲区在读取完之后释放或重用。一般不需要调用，线程退出时会自动调用
+    /// </summary>
+    static void retire_current_thread() noexcept
+    {
+        if (current_buffer && current_buffer != retired_marker())
+        {
+            current_buffer->retired_order = retire_count.fetch_add(1, std::memory_order_relaxed);
+            current_buffer->retired.store(true, std::memory_order_release);
+        }
+        current_buffer = retired_marker();
+    }
+
+    /// <summary>
+    /// 获取当前的缓冲区数，包括已退出的线程还没有释放的缓冲区
+    /// </summary>
+    static size_t buffer_count()
+    {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        return buffers.size();
+    }
+
+private:
+    struct slot
+    {
+        std::atomic<std::uint64_t> sequence { 0 };
+        std::atomic<const char*> name { nullptr };
+        std::atomic<std::uint16_t> trace_module { 0 };
+        std::atomic<std::uint64_t> start { 0 };
+        std::atomic<std::uint64_t> end { 0 };
+        std::atomic<std::int64_t> handle { 0 };
+        std::atomic<std::int64_t> result { 0 };
+    };
+
+    struct thread_buffer
+    {
+        std::uint32_t thread_id = 0;
+        std::atomic<std::uint64_t> head { 0 };
+        std::atomic<bool> retired { false };
+        std::uint64_t retired_order = 0; // 在retired之前写入，用于选择最早退出的缓冲区
+        std::uint64_t read = 0; // 只由持有registry_mutex的读取者访问
+        slot slots[capacity];
+    };
+
+    struct thread_registration
+    {
+        ~thread_registration() { retire_current_thread(); }
+    };
+
+    /// <summary>
+    /// 表示当前线程已经退出(或停止记录)的哨兵，只用于比较，不会被访问
+    /// </summary>
+    static thread_buffer* retired_marker() noexcept { return reinterpret_cast<thread_buffer*>(&retired_sentinel); }
+
+    static std::uint32_t current_thread_id() noexcept
+    {
+#ifdef _WIN32
+        return GetCurrentThreadId();
+#else
+        return static_cast<std::uint32_t>(syscall(SYS_gettid));
+#endif
+    }
+
+    static thread_buffer* register_thread()
+    {
+#ifdef _WIN32
+        // 记录发生在wrapper返回之前，调用者之后还会读取GetLastError，所以分配和加锁不能改变它
+        struct last_error_guard
+        {
+            DWORD error = GetLastError();
+            ~last_error_guard() { SetLastError(error); }
+        } guard;
+#endif
+        {
+            std::lock_guard<std::mutex> lock(registry_mutex);
+            current_buffer = reuse_retired();
+            if (!current_buffer)
+            {
+                buffers.push_back(std::make_unique<thread_buffer>());
+                current_buffer = buffers.back().get();
+            }
+            current_buffer->thread_id = current_thread_id();
+        }
+        // 线程退出时析构，将缓冲区标记为退出，之后的记录(其他线程局部对象的析构函数中)被忽略
+        thread_local thread_registration registration;
+        (void)registration;
+        return current_buffer;
+    }
+
+    /// <summary>
+    /// 在持有registry_mutex时调用：优先重用已经读取完的退出线程的缓冲区；退出线程的缓冲区达到上限时，
+    /// 重用最早退出的那个，未读取的事件计入dropped。都没有时返回nullptr
+    /// </summary>
+    static thread_buffer* reuse_retired()
+    {
+        thread_buffer* oldest = nullptr;
+        size_t retired_buffers = 0;
+        for (auto& buffer : buffers)
+        {
+            if (!buffer->retired.load(std::memory_order_acquire))
+                continue;
+            if (buffer->head.load(std::memory_order_acquire) == buffer->read)
+                return reset(*buffer);
+            retired_buffers++;
+            if (!oldest || buffer->retired_order < oldest->retired_order)
+                oldest = buffer.get();
+        }
+        if (!oldest || retired_buffers < max_retired_buffers)
+            return nullptr;
+        // 被覆盖的事件本来也会在读取时计入dropped，所以丢弃的是head - read个
+        discarded.emplace_back(oldest->thread_id, oldest->head.load(std::memory_order_acquire) - oldest->read);
+        return reset(*oldest);
+    }
+
+    static thread_buffer* reset(thread_buffer& buffer)
+    {
+        // 序号和head继续增长，旧的槽的序号不会与新的事件匹配
+        buffer.read = buffer.head.load(std::memory_order_acquire);
+        buffer.retired.store(false, std::memory_order_relaxed);
+        return &buffer;
+    }
+
+    inline static char retired_sentinel;
+    inline static thread_local thread_buffer* current_buffer = nullptr;
+    inline static std::mutex registry_mutex;
+    inline static std::vector<std::unique_ptr<thread_buffer>> buffers;
+    inline static std::vector<std::pair<std::uint32_t, std::uint64_t>> discarded;
+    inline static std::atomic<std::uint64_t> retire_count { 0 };
+};
+
+/// <summary>
+/// MW_TRACE_SCOPE声明的追踪作用域，Enabled为false时是空对象
+/// </summary>
+template <bool Enabled>
+class scope
+{
+public:
+    template <typename Handle>
+    scope(module, const char*, const Handle&) noexcept
+    {
+    }
+
+    template <typename Result>
+    void set_result(const Result&) noexcept
+    {
+    }
+};
+
+template <>
+class scope<true>
+{
+public:
+    template <typename Handle>
+    scope(module trace_module, const char* name, const Handle& handle) noexcept
+        : trace_module(trace_module)
+        , name(name)
+        , handle(to_trace_value(handle))
+        , start(clock::tsc_clock::raw_now())
+    {
+    }
+
+    ~scope() { recorder::record(trace_module, name, handle, result, start, clock::tsc_clock::raw_now()); }
+
+    template <typename Result>
+    void set_result(const Result& value) noexcept
+    {
+        result = to_trace_value(value);
+    }
+
+    scope(const scope&) = delete;
+    scope& operator=(const scope&) = delete;
+
+private:
+    module trace_module;
+    const char* name;
+    std::int64_t handle;
+    std::int64_t result = 0;
+    std::uint64_t start;
+};
+
+static_assert(std::is_empty_v<scope<false>>);
+
+/// <summary>
+/// 将所有线程的事件以紧凑的二进制格式写出
+/// </summary>
+/// <remarks>
+/// 格式(小端序)：
+///   文件头  "MWTRACE2"
+///   名字    'N' u16:id u16:长度 字符                      每个调用名第一次出现之前写入一次
+///   事件组  'E' u32:线程id u32:数量 数量 * 事件
+///   事件    u64:开始(纳秒) u64:耗时(纳秒) u16:模块 u16:名字id i64:句柄 i64:结果   共36字节
+///   丢弃    'D' u32:线程id u64:数量
+/// 多次flush的输出依次连接起来就是一个完整的文件，名字id在同一个writer中保持不变。用to_chrome_json转换为chrome://tracing的格式
+/// </remarks>
+class binary_writer
+{
+public:
+    static constexpr char magic[8] = { 'M', 'W', 'T', 'R', 'A', 'C', 'E', '2' };
+    static constexpr size_t event_size = 36;
+
+    /// <summary>
+    /// 取出所有线程的新事件，追加到out，第一次调用时先写入文件头
+    /// </summary>
+    /// <returns>写出的事件数</returns>
+    size_t flush(std::vector<std::uint8_t>& out)
+    {
+        if (!header_written)
+        {
+            out.insert(out.end(), magic, magic + sizeof(magic));
+            header_written = true;
+        }
+        size_t total = 0;
+        recorder::drain([&](std::uint32_t thread_id, const std::vector<event>& events, std::uint64_t dropped) {
+            for (auto& item : events)
+                name_id(item.name, out);
+            if (!events.empty())
+            {
+                put<std::uint8_t>(out, 'E');
+                put<std::uint32_t>(out, thread_id);
+                put<std::uint32_t>(out, static_cast<std::uint32_t>(events.size()));
+                for (auto& item : events)
+                {
+                    put<std::uint64_t>(out, item.start_ns);
+                    put<std::uint64_t>(out, item.duration_ns);
+                    put<std::uint16_t>(out, static_cast<std::uint16_t>(item.trace_module));
+                    put<std::uint16_t>(out, name_ids[item.name]);
+                    put<std::int64_t>(out, item.handle);
+                    put<std::int64_t>(out, item.result);
+                }
+                total += events.size();
+            }
+            if (dropped)
+            {
+                put<std::uint8_t>(out, 'D');
+                put<std::uint32_t>(out, thread_id);
+                put<std::uint64_t>(out, dropped);
+                dropped_count += dropped;
+            }
+        });
+        return total;
+    }
+
+    /// <summary>
+    /// 取出事件并追加到文件
+    /// </summary>
+    /// <returns>写出的事件数，写入失败时返回0</returns>
+    size_t flush(FILE* file)
+    {
+        buffer.clear();
+        auto total = flush(buffer);
+        return std::fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size() ? total : 0;
+    }
+
+    /// <summary>
+    /// 被覆盖而丢弃的事件总数，不为0时应该增大MW_TRACE_BUFFER_EVENTS或者更频繁地flush
+    /// </summary>
+    std::uint64_t dropped() const noexcept { return dropped_count; }
+
+private:
+    template <typename T>
+    static void put(std::vector<std::uint8_t>& out, T value)
+    {
+        auto offset = out.size();
+        out.resize(offset + sizeof(T));
+        std::memcpy(out.data() + offset, &value, sizeof(T));
+    }
+
+    void name_id(const char* name, std::vector<std::uint8_t>& out)
+    {
+        auto result = name_ids.emplace(name, static_cast<std::uint16_t>(name_ids.size()));
+        if (!result.second)
+            return;
+        auto length = static_cast<std::uint16_t>((std::min)(std::strlen(name ? name : ""), size_t(UINT16_MAX)));
+        put<std::uint8_t>(out, 'N');
+        put<std::uint16_t>(out, result.first->second);
+        put<std::uint16_t>(out, length);
+        out.insert(out.end(), name, name + length);
+    }
+
+    bool header_written = false;
+    std::uint64_t dropped_count = 0;
+    std::unordered_map<const char*, std::uint16_t> name_ids;
+    std::vector<std::uint8_t> buffer;
+};
+
+/// <summary>
+/// 将binary_writer的输出转换为Chrome trace JSON(chrome://tracing和Perfetto可以打开)，每个调用是一个完整事件("ph":"X")
+/// </summary>
+/// <param name="data">binary_writer的输出</param>
+/// <param name="size">字节数</param>
+/// <param name="json">[out]JSON文本</param>
+/// <param name="process_id">JSON中的pid</param>
+/// <returns>数据格式是否正确，格式错误时json包含出错之前的事件</returns>
+inline bool to_chrome_json(const std::uint8_t* data, size_t size, std::string& json, std::uint32_t process_id = 1)
+{
+    json.assign("{\"traceEvents\":[");
+    size_t position = 0;
+    auto read = [&](auto& value) {
+        if (size - position < sizeof(value))
+            return false;
+        std::memcpy(&value, data + position, sizeof(value));
+        position += sizeof(value);
+        return true;
+    };
+    auto append_escaped = [&](const std::string& text) {
+        for (auto c : text)
+        {
+            if (c == '"' || c == '\\')
+                json.push_back('\\');
+            if (static_cast<unsigned char>(c) >= 0x20)
+                json.push_back(c);
+        }
+    };
+
+    bool first = true;
+    auto close = [&](bool valid) {
+        json.append("],\"displayTimeUnit\":\"ns\"}");
+        return valid;
+    };
+    if (size < sizeof(binary_writer::magic) || std::memcmp(data, binary_writer::magic, sizeof(binary_writer::magic)) != 0)
+        return close(false);
+    position = sizeof(binary_writer::magic);
+
+    std::vector<std::string> names;
+    char number[160];
+    while (position < size)
+    {
+        std::uint8_t tag = 0;
+        read(tag);
+        if (tag == 'N')
+        {
+            std::uint16_t id = 0, length = 0;
+            if (!read(id) || !read(length) || size - position < length)
+                return close(false);
+            if (names.size() <= id)
+                names.resize(id + 1);
+            names[id].assign(reinterpret_cast<const char*>(data + position), length);
+            position += length;
+        }
+        else if (tag == 'E')
+        {
+            std::uint32_t thread_id = 0, count = 0;
+            if (!read(thread_id) || !read(count) || (size - position) / binary_writer::event_size < count)
+                return close(false);
+            for (std::uint32_t i = 0; i < count; i++)
+            {
+                std::uint64_t start = 0, duration = 0;
+                std::uint16_t trace_module = 0, id = 0;
+                std::int64_t handle = 0, result = 0;
+                read(start), read(duration), read(trace_module), read(id), read(handle), read(result);
+                json.append(first ? "\n{\"name\":\"" : ",\n{\"name\":\"");
+                first = false;
+                append_escaped(id < names.size() ? names[id] : std::string("?"));
+                std::snprintf(number, sizeof(number), "\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%u,\"tid\":%u,",
+                    module_name(static_cast<module>(trace_module)), start / 1000.0, duration / 1000.0, process_id, thread_id);
+                json.append(number);
+                std::snprintf(number, sizeof(number), "\"args\":{\"handle\":\"0x%llx\",\"result\":%lld}}",
+                    static_cast<unsigned long long>(handle), static_cast<long long>(result));
+                json.append(number);
+            }
+        }
+        else if (tag == 'D')
+        {
+            std::uint32_t thread_id = 0;
+            std::uint64_t dropped = 0;
+            if (!read(thread_id) || !read(dropped))
+                return close(false);
+            std::snprintf(number, sizeof(number), "%s{\"name\":\"dropped\",\"ph\":\"C\",\"ts\":0,\"pid\":%u,\"tid\":%u,\"args\":{\"events\":%llu}}",
+                first ? "\n" : ",\n", process_id, thread_id, static_cast<unsigned long long>(dropped));
+            json.append(number);
+            first = false;
+        }
+        else
+            return close(false);
+    }
+    return close(true);
+}
+
+} // namespace mw::trace
@@ -0,0 +1,956 @@
+#pragma once
+#ifdef _WIN32
+#    include "mw_device.h"
+#    include "mw_memory.h"
+#    include "mw_process.h"
+#    include "mw_socket.h"
+#    include "mw_system.h"
+#    include "mw_thread.h"
+#    include <mstcpip.h>
+#else
+#    include "mw_platform.h"
+#    include <poll.h>
+#    include <pthread.h>
+#    include <sys/eventfd.h>
+#    include <sys/mman.h>
+#    include <system_error>
+#    include <thread>
+#endif
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace mw::net {
+
+/// <summary>
+/// udp_endpoint的选项
+/// </summary>
+struct udp_endpoint_options
+{
+    /// <summary>工作线程数量，若为0则使用处理器数量</summary>
+    DWORD worker_count = 0;
+    /// <summary>是否把第i个工作线程绑定到第i个处理器上</summary>
+    bool pin_workers = true;
+    /// <summary>每个工作线程保持投递的WSARecvFrom数量，也是工作线程一次从完成端口取出的最大完成数据包数量(其他平台上是一次recvmmsg取出的最大数据报数量)</summary>
+    DWORD batch_size = 64;
+    /// <summary>每个数据报缓冲区的字节数，更大的数据报会被截断并丢弃(计入truncated)</summary>
+    DWORD datagram_size = 2048;
+    /// <summary>发送槽的数量，即同时进行的WSASendTo的最大数量，发送槽用完时send_to丢弃数据报(计入send_dropped)。其他平台上同步发送，不使用发送槽</summary>
+    DWORD send_slots = 1024;
+    /// <summary>套接字的接收和发送缓冲区大小(SO_RCVBUF和SO_SNDBUF)，若为0则使用系统默认值。处理跟不上时，系统会在接收缓冲区满后丢弃数据报</summary>
+    int socket_buffer_size = 4 * 1024 * 1024;
+};
+
+/// <summary>
+/// udp_endpoint的统计信息
+/// </summary>
+struct udp_endpoint_stats
+{
+    ULONGLONG packets_received = 0;
+    ULONGLONG bytes_received = 0;
+    ULONGLONG packets_sent = 0;
+    ULONGLONG bytes_sent = 0;
+    /// <summary>从完成端口取出接收完成数据包(或调用recvmmsg)的批次数，packets_received / batches即平均每批的数据报数</summary>
+    ULONGLONG batches = 0;
+    /// <summary>超过datagram_size而被截断丢弃的数据报数</summary>
+    ULONGLONG truncated = 0;
+    /// <summary>其他失败的接收次数(例如对端端口不可达)，不包括stop时被取消的接收</summary>
+    ULONGLONG receive_errors = 0;
+    /// <summary>因为没有空闲的发送槽(或套接字的发送缓冲区已满)而被丢弃的数据报数</summary>
+    ULONGLONG send_dropped = 0;
+    /// <summary>失败的发送次数</summary>
+    ULONGLONG send_errors = 0;
+};
+
+/// <summary>
+/// 一个收到的(或要发送的)数据报
+/// </summary>
+struct udp_datagram
+{
+    const char* data = nullptr;
+    size_t size = 0;
+    /// <summary>收到时是发送者的地址，发送时是目标地址</summary>
+    const sockaddr* address = nullptr;
+    int address_len = 0;
+};
+
+class udp_endpoint;
+
+/// <summary>
+/// 收到数据报时的回调，参数是一批数据报和它们的数量，数据报的内容和地址只在回调期间有效。
+/// 多个工作线程可能同时调用它
+/// </summary>
+using udp_datagram_callback = std::function<void(udp_endpoint&, const udp_datagram*, size_t)>;
+
+namespace udp_detail {
+
+#ifdef _WIN32
+    enum class io_operation
+    {
+        recv,
+        send,
+    };
+
+    /// <summary>
+    /// 一次重叠I/O请求，OVERLAPPED必须是第一个基类，这样完成数据包中的OVERLAPPED指针可以直接转换为它
+    /// </summary>
+    struct io_request : OVERLAPPED
+    {
+        io_operation operation;
+
+        void reset() { std::memset(static_cast<OVERLAPPED*>(this), 0, sizeof(OVERLAPPED)); }
+        /// <summary>OVERLAPPED的Internal成员是I/O操作的NTSTATUS</summary>
+        bool succeeded() const { return static_cast<LONG>(Internal) >= 0; }
+    };
+
+    struct recv_request : io_request
+    {
+        char* buffer = nullptr;
+        sockaddr_storage from;
+        INT from_len = 0;
+        DWORD flags = 0;
+    };
+
+    struct send_slot;
+
+    struct send_request : io_request
+    {
+        send_slot* slot = nullptr;
+    };
+
+    /// <summary>
+    /// 一个发送槽，包含一个数据报的缓冲区和目标地址
+    /// </summary>
+    struct alignas(MEMORY_ALLOCATION_ALIGNMENT) send_slot
+    {
+        /// <summary>空闲链表项，必须是第一个成员</summary>
+        SLIST_ENTRY entry;
+        send_request request;
+        char* buffer = nullptr;
+        sockaddr_storage to;
+        int to_len = 0;
+    };
+
+    enum : ULONG_PTR
+    {
+        key_io = 0,
+        key_shutdown = 1,
+    };
+#endif
+
+    /// <summary>
+    /// 工作线程，它拥有batch_size个接收请求(其他平台上是自己的套接字和batch_size个接收缓冲区)，计数器只由它自己修改，按缓存行对齐避免与其他工作线程的伪共享
+    /// </summary>
+    struct alignas(64) worker
+    {
+        worker(udp_endpoint* owner, DWORD index)
+            : owner(owner)
+            , index(index)
+        {
+        }
+
+        inline bool start(bool pin);
+        inline void run();
+
+        udp_endpoint* owner;
+        DWORD index;
+#ifdef _WIN32
+        inline void post_recv(recv_request* request);
+
+        static DWORD WINAPI thread_function(LPVOID param)
+        {
+            static_cast<worker*>(param)->run();
+            return 0;
+        }
+
+        HANDLE thread = nullptr;
+        std::unique_ptr<recv_request[]> requests;
+        std::vector<OVERLAPPED_ENTRY> entries;
+        std::vector<recv_request*> completed;
+#else
+        inline void receive_all();
+
+        /// <summary>工作线程自己的套接字，所有工作线程的套接字以SO_REUSEPORT绑定到同一个地址</summary>
+        SOCKET socket = INVALID_SOCKET;
+        std::thread thread;
+        /// <summary>recvmmsg的参数，每个消息对应一个接收缓冲区和一个发送者地址</summary>
+        std::vector<mmsghdr> messages;
+        std::vector<iovec> iovecs;
+        std::vector<sockaddr_storage> addresses;
+#endif
+        std::vector<udp_datagram> datagrams;
+
+        std::atomic<ULONGLONG> packets_received { 0 };
+        std::atomic<ULONGLONG> bytes_received { 0 };
+        std::atomic<ULONGLONG> batches { 0 };
+        std::atomic<ULONGLONG> truncated { 0 };
+        std::atomic<ULONGLONG> receive_errors { 0 };
+    };
+
+} // namespace udp_detail
+
+/// <summary>
+/// 基于重叠套接字和I/O完成端口的UDP端点，批量地接收和发送数据报，适合大量的小数据报
+/// </summary>
+/// <remarks>
+/// 所有工作线程共享一个套接字和一个I/O完成端口，每个工作线程保持batch_size个WSARecvFrom投递在套接字上，
+/// 系统把到达的数据报分散到这些请求中，工作线程用一次GetQueuedCompletionStatusEx取出一批完成的接收，
+/// 用一次回调交给使用者，然后重新投递这些请求，所以每个数据报平均只需要很少的系统调用，并且多个处理器可以同时处理同一个端口的数据报。
+///
+/// 接收缓冲区和发送槽在start时一次分配，之后收发数据报不需要分配内存。send_to把数据报复制到一个空闲的发送槽中并投递WSASendTo，
+/// 它不会阻塞，发送槽用完时直接丢弃数据报。每种丢弃(截断，接收失败，发送槽不足，发送失败)都有单独的计数器，见udp_endpoint_stats，
+/// 系统因为接收缓冲区已满而丢弃的数据报无法在套接字上得到，可以用对端的发送计数与packets_received比较。
+///
+/// 端点不会因为对端端口不可达(ICMP)而使接收失败(关闭了SIO_UDP_CONNRESET)。使用前需要调用socket_startup
+///
+/// 其他平台上每个工作线程有自己的套接字，它们以SO_REUSEPORT绑定到同一个地址，系统按发送者的地址和端口把数据报分散到各个套接字，
+/// 所以同一个发送者的数据报总是由同一个工作线程处理。工作线程等待套接字可读，然后用recvmmsg一次取出最多batch_size个数据报，
+/// 直到取完为止。send_to用不阻塞的sendto，send_batch用sendmmsg一次发送一批，套接字的发送缓冲区已满时丢弃数据报(计入send_dropped)
+/// </remarks>
+class udp_endpoint
+{
+    friend struct udp_detail::worker;
+
+public:
+    explicit udp_endpoint(udp_datagram_callback on_datagrams, const udp_endpoint_options& options = udp_endpoint_options())
+        : on_datagrams(std::move(on_datagrams))
+        , options(options)
+    {
+        if (!this->options.worker_count)
+        {
+#ifdef _WIN32
+            SYSTEM_INFO system_info = { 0 };
+            mw::get_system_info(system_info);
+            this->options.worker_count = system_info.dwNumberOfProcessors;
+#else
+            this->options.worker_count = static_cast<DWORD>(sysconf(_SC_NPROCESSORS_ONLN));
+#endif
+            if (!this->options.worker_count)
+                this->options.worker_count = 1;
+        }
+        this->options.batch_size = (std::max)(this->options.batch_size, static_cast<DWORD>(1));
+        this->options.datagram_size = (std::min)((std::max)(this->options.datagram_size, static_cast<DWORD>(1)), static_cast<DWORD>(65535));
+    }
+    ~udp_endpoint()
+    {
+        stop();
+    }
+    udp_endpoint(const udp_endpoint&) = delete;
+    udp_endpoint(udp_endpoint&&) = delete;
+    udp_endpoint& operator=(const udp_endpoint&) = delete;
+    udp_endpoint& operator=(udp_endpoint&&) = delete;
+
+public:
+    /// <summary>
+    /// 在指定端口上绑定所有地址，并开始接收数据报
+    /// </summary>
+    /// <param name="port">端口号(主机字节序)，若为0则由系统选择，可以对get_socket调用getsockname得到它</param>
+    /// <param name="address_family">AF_INET或AF_INET6</param>
+    /// <returns>操作是否成功</returns>
+    bool start(USHORT port, int address_family = AF_INET)
+    {
+        sockaddr_storage address = {};
+        int address_len = 0;
+        if (address_family == AF_INET6)
+        {
+            auto address6 = reinterpret_cast<sockaddr_in6*>(&address);
+            address6->sin6_family = AF_INET6;
+            address6->sin6_port = htons(port);
+            address6->sin6_addr = in6addr_any;
+            address_len = sizeof(sockaddr_in6);
+        }
+        else
+        {
+            auto address4 = reinterpret_cast<sockaddr_in*>(&address);
+            address4->sin_family = AF_INET;
+            address4->sin_port = htons(port);
+            address4->sin_addr.s_addr = htonl(INADDR_ANY);
+            address_len = sizeof(sockaddr_in);
+        }
+        return start(reinterpret_cast<sockaddr*>(&address), address_len);
+    }
+
+    /// <summary>
+    /// 创建套接字并绑定到指定地址，启动所有工作线程，并开始接收数据报
+    /// </summary>
+    /// <param name="address">要绑定的本地地址</param>
+    /// <param name="address_len">address的长度</param>
+    /// <returns>操作是否成功，若端点已经启动，返回false</returns>
+    bool start(const sockaddr* address, int address_len)
+    {
+        if (running)
+            return false;
+        stopping = false;
+#ifdef _WIN32
+        outstanding = 1;
+        running = true;
+
+        socket = mw::socket::create_socket(address->sa_family, SOCK_DGRAM, IPPROTO_UDP);
+        if (socket == INVALID_SOCKET || !configure_socket(socket)
+            || mw::socket::socket_bind(socket, address, address_len) == SOCKET_ERROR)
+        {
+            stop();
+            return false;
+        }
+
+        port = mw::create_io_completion_port(INVALID_HANDLE_VALUE, nullptr, 0, options.worker_count);
+        auto request_count = static_cast<size_t>(options.worker_count) * options.batch_size;
+        auto buffer_bytes = (request_count + options.send_slots) * options.datagram_size;
+        if (!port || !mw::create_io_completion_port(reinterpret_cast<HANDLE>(socket), port, udp_detail::key_io)
+            || !(buffers = static_cast<char*>(mw::virtual_alloc(mw::get_current_process(), buffer_bytes, nullptr, MEM_RESERVE | MEM_COMMIT))))
+        {
+            stop();
+            return false;
+        }
+
+        auto buffer = buffers;
+        InitializeSListHead(free_slots.get());
+        slots.reset(new udp_detail::send_slot[options.send_slots]);
+        for (DWORD i = 0; i < options.send_slots; i++, buffer += options.datagram_size)
+        {
+            slots[i].buffer = buffer;
+            slots[i].request.operation = udp_detail::io_operation::send;
+            slots[i].request.slot = &slots[i];
+            InterlockedPushEntrySList(free_slots.get(), &slots[i].entry);
+        }
+
+        for (DWORD i = 0; i < options.worker_count; i++)
+        {
+            workers.push_back(std::make_unique<udp_detail::worker>(this, i));
+            auto& worker = *workers.back();
+            worker.requests.reset(new udp_detail::recv_request[options.batch_size]);
+            for (DWORD j = 0; j < options.batch_size; j++, buffer += options.datagram_size)
+            {
+                worker.requests[j].buffer = buffer;
+                worker.requests[j].operation = udp_detail::io_operation::recv;
+            }
+            worker.entries.resize(options.batch_size);
+            worker.datagrams.reserve(options.batch_size);
+            worker.completed.reserve(options.batch_size);
+            if (!worker.start(options.pin_workers))
+            {
+                stop();
+                return false;
+            }
+        }
+
+        // 每个请求持有outstanding的一个引用，直到它完成并且不再被投递
+        for (auto& worker : workers)
+        {
+            for (DWORD j = 0; j < options.batch_size; j++)
+            {
+                outstanding.fetch_add(1);
+                worker->post_recv(&worker->requests[j]);
+            }
+        }
+        return true;
+#else
+        running = true;
+        if (address_len < 0 || address_len > static_cast<int>(sizeof(sockaddr_storage)))
+        {
+            stop();
+            return false;
+        }
+        wake_fd = eventfd(0, EFD_CLOEXEC);
+        auto buffer_bytes = static_cast<size_t>(options.worker_count) * options.batch_size * options.datagram_size;
+        auto memory = mmap(nullptr, buffer_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (wake_fd < 0 || memory == MAP_FAILED)
+        {
+            stop();
+            return false;
+        }
+        buffers = static_cast<char*>(memory);
+        buffer_size = buffer_bytes;
+
+        // 端口为0时第一个套接字绑定后由系统选择端口，其他套接字绑定到同一个端口
+        sockaddr_storage bound = {};
+        std::memcpy(&bound, address, address_len);
+        auto bound_len = static_cast<socklen_t>(address_len);
+        auto buffer = buffers;
+        for (DWORD i = 0; i < options.worker_count; i++)
+        {
+            workers.push_back(std::make_unique<udp_detail::worker>(this, i));
+            auto& worker = *workers.back();
+            worker.socket = ::socket(address->sa_family, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_UDP);
+            if (worker.socket == INVALID_SOCKET || !configure_socket(worker.socket)
+                || ::bind(worker.socket, reinterpret_cast<sockaddr*>(&bound), bound_len) == SOCKET_ERROR
+                || (i == 0 && getsockname(worker.socket, reinterpret_cast<sockaddr*>(&bound), &bound_len) == SOCKET_ERROR))
+            {
+                stop();
+                return false;
+            }
+
+            worker.messages.resize(options.batch_size);
+            worker.iovecs.resize(options.batch_size);
+            worker.addresses.resize(options.batch_size);
+            for (DWORD j = 0; j < options.batch_size; j++, buffer += options.datagram_size)
+            {
+                worker.iovecs[j] = { buffer, options.datagram_size };
+                auto& header = worker.messages[j].msg_hdr;
+                header = {};
+                header.msg_name = &worker.addresses[j];
+                header.msg_iov = &worker.iovecs[j];
+                header.msg_iovlen = 1;
+            }
+            worker.datagrams.reserve(options.batch_size);
+        }
+        socket = workers[0]->socket;
+
+        for (auto& worker : workers)
+        {
+            if (!worker->start(options.pin_workers))
+            {
+                stop();
+                return false;
+            }
+        }
+        return true;
+#endif
+    }
+
+    /// <summary>
+    /// 向指定地址发送一个数据报，数据被复制到发送槽中，所以函数返回后data就可以被修改，可以在任意线程(包括回调)中调用
+    /// </summary>
+    /// <param name="to">目标地址</param>
+    /// <param name="to_len">to的长度</param>
+    /// <param name="data">数据报的内容</param>
+    /// <param name="size">数据报的字节数，不能超过datagram_size</param>
+    /// <returns>若端点未启动或正在停止，数据报太大，没有空闲的发送槽，或者发送失败，返回false</returns>
+    bool send_to(const sockaddr* to, int to_len, const char* data, size_t size)
+    {
+        if (!running || size > options.datagram_size || to_len < 0 || to_len > static_cast<int>(sizeof(sockaddr_storage)))
+            return false;
+#ifdef _WIN32
+        auto slot = reinterpret_cast<udp_detail::send_slot*>(InterlockedPopEntrySList(free_slots.get()));
+        if (!slot)
+        {
+            send_dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        // 先增加引用再检查stopping，这样stop要么能看到这次发送，要么这里能看到stopping
+        outstanding.fetch_add(1);
+        if (stopping.load())
+        {
+            InterlockedPushEntrySList(free_slots.get(), &slot->entry);
+            release();
+            return false;
+        }
+
+        std::memcpy(slot->buffer, data, size);
+        std::memcpy(&slot->to, to, to_len);
+        slot->to_len = to_len;
+        slot->request.reset();
+        WSABUF buffer = { static_cast<ULONG>(size), slot->buffer };
+        if (mw::socket::socket_send_to_asyn(socket, &buffer, 1, nullptr, reinterpret_cast<sockaddr*>(&slot->to), to_len, 0, &slot->request) == SOCKET_ERROR
+            && WSAGetLastError() != WSA_IO_PENDING)
+        {
+            send_errors.fetch_add(1, std::memory_order_relaxed);
+            InterlockedPushEntrySList(free_slots.get(), &slot->entry);
+            release();
+            return false;
+        }
+        return true;
+#else
+        if (stopping.load())
+            return false;
+        if (::sendto(socket, data, size, MSG_DONTWAIT | MSG_NOSIGNAL, to, static_cast<socklen_t>(to_len)) < 0)
+        {
+            send_failed(errno);
+            return false;
+        }
+        packets_sent.fetch_add(1, std::memory_order_relaxed);
+        bytes_sent.fetch_add(size, std::memory_order_relaxed);
+        return true;
+#endif
+    }
+
+    /// <summary>
+    /// 发送一批数据报，每个数据报的address是它的目标地址
+    /// </summary>
+    /// <param name="datagrams">数据报数组</param>
+    /// <param name="count">数据报数量</param>
+    /// <returns>成功投递的数据报数量，失败的数据报计入相应的计数器，不会重试</returns>
+    size_t send_batch(const udp_datagram* datagrams, size_t count)
+    {
+        size_t sent = 0;
+#ifdef _WIN32
+        for (size_t i = 0; i < count; i++)
+        {
+            if (send_to(datagrams[i].address, datagrams[i].address_len, datagrams[i].data, datagrams[i].size))
+                sent++;
+        }
+#else
+        // 每次sendmmsg最多发送max_send_batch个数据报，参数放在栈上，不分配内存。不合法的数据报与send_to一样直接跳过
+        mmsghdr messages[max_send_batch];
+        iovec iovecs[max_send_batch];
+        size_t indexes[max_send_batch];
+        for (size_t next = 0; next < count;)
+        {
+            if (!running || stopping.load())
+                break;
+            unsigned int batch = 0;
+            for (; next < count && batch < max_send_batch; next++)
+            {
+                auto& datagram = datagrams[next];
+                if (datagram.size > options.datagram_size || datagram.address_len < 0
+                    || datagram.address_len > static_cast<int>(sizeof(sockaddr_storage)))
+                    continue;
+                iovecs[batch] = { const_cast<char*>(datagram.data), datagram.size };
+                auto& header = messages[batch].msg_hdr;
+                header = {};
+                header.msg_name = const_cast<sockaddr*>(datagram.address);
+                header.msg_namelen = static_cast<socklen_t>(datagram.address_len);
+                header.msg_iov = &iovecs[batch];
+                header.msg_iovlen = 1;
+                indexes[batch++] = next;
+            }
+            if (!batch)
+                break;
+
+            auto result = sendmmsg(socket, messages, batch, MSG_DONTWAIT | MSG_NOSIGNAL);
+            if (result < 0)
+            {
+                // 第一个数据报就失败了，丢弃它，从下一个继续
+                send_failed(errno);
+                next = indexes[0] + 1;
+                continue;
+            }
+            size_t bytes = 0;
+            for (int i = 0; i < result; i++)
+                bytes += messages[i].msg_len;
+            packets_sent.fetch_add(result, std::memory_order_relaxed);
+            bytes_sent.fetch_add(bytes, std::memory_order_relaxed);
+            sent += result;
+            // 只发送了一部分时，下一次调用会返回第一个没有发送的数据报的错误
+            if (static_cast<unsigned int>(result) < batch)
+                next = indexes[result];
+        }
+#endif
+        return sent;
+    }
+
+    /// <summary>
+    /// 停止端点：取消所有接收，等待正在进行的发送完成，等待工作线程退出并关闭套接字
+    /// </summary>
+    /// <remarks>
+    /// 不能在回调中调用。其他线程中的send_to调用必须在stop返回之前结束
+    /// </remarks>
+    void stop()
+    {
+        if (!running)
+            return;
+        stopping = true;
+#ifdef _WIN32
+        if (socket != INVALID_SOCKET)
+            mw::cancle_io_ex(reinterpret_cast<HANDLE>(socket));
+        // 释放stop持有的引用，最后一个完成的请求会让工作线程退出
+        release();
+
+        for (auto& worker : workers)
+        {
+            if (worker->thread)
+            {
+                mw::sync::wait_for_single_object(worker->thread);
+                CloseHandle(worker->thread);
+            }
+        }
+        if (socket != INVALID_SOCKET)
+        {
+            mw::socket::close_socket(socket);
+            socket = INVALID_SOCKET;
+        }
+        if (port)
+        {
+            CloseHandle(port);
+            port = nullptr;
+        }
+
+        collect_worker_stats(retired);
+        workers.clear();
+        slots.reset();
+        if (buffers)
+        {
+            mw::virtual_free(mw::get_current_process(), buffers);
+            buffers = nullptr;
+        }
+#else
+        // eventfd的计数不会被读取，它保持可读，所有工作线程都会看到
+        if (wake_fd >= 0)
+        {
+            std::uint64_t one = 1;
+            [[maybe_unused]] auto written = ::write(wake_fd, &one, sizeof(one));
+        }
+        for (auto& worker : workers)
+        {
+            if (worker->thread.joinable())
+                worker->thread.join();
+        }
+        for (auto& worker : workers)
+        {
+            if (worker->socket != INVALID_SOCKET)
+                ::close(worker->socket);
+        }
+        socket = INVALID_SOCKET;
+        if (wake_fd >= 0)
+        {
+            ::close(wake_fd);
+            wake_fd = -1;
+        }
+
+        collect_worker_stats(retired);
+        workers.clear();
+        if (buffers)
+        {
+            munmap(buffers, buffer_size);
+            buffers = nullptr;
+        }
+#endif
+        running = false;
+    }
+
+    /// <summary>
+    /// 获取统计信息，包括之前启动期间的计数
+    /// </summary>
+    udp_endpoint_stats stats() const
+    {
+        auto result = retired;
+        collect_worker_stats(result);
+        result.packets_sent = packets_sent.load(std::memory_order_relaxed);
+        result.bytes_sent = bytes_sent.load(std::memory_order_relaxed);
+        result.send_dropped = send_dropped.load(std::memory_order_relaxed);
+        result.send_errors = send_errors.load(std::memory_order_relaxed);
+        return result;
+    }
+
+    bool is_running() const { return running; }
+    const udp_endpoint_options& get_options() const { return options; }
+    /// <summary>端点的套接字，只在启动期间有效</summary>
+    SOCKET get_socket() const { return socket; }
+
+private:
+    bool configure_socket(SOCKET target)
+    {
+#ifdef _WIN32
+        // 默认情况下，之前发出的数据报触发的ICMP端口不可达会让下一次接收以WSAECONNRESET失败
+        BOOL report_reset = FALSE;
+        DWORD bytes = 0;
+        WSAIoctl(target, SIO_UDP_CONNRESET, &report_reset, sizeof(report_reset), nullptr, 0, &bytes, nullptr, nullptr);
+#else
+        // 未连接的套接字不会报告ICMP端口不可达，不需要关闭它；每个工作线程的套接字绑定到同一个地址
+        int reuse = 1;
+        if (setsockopt(target, SOL_SOCKET, SO_REUSEPORT, &reuse, sizeof(reuse)) == SOCKET_ERROR)
+            return false;
+#endif
+
+        if (options.socket_buffer_size > 0)
+        {
+            auto value = reinterpret_cast<const char*>(&options.socket_buffer_size);
+            if (setsockopt(target, SOL_SOCKET, SO_RCVBUF, value, sizeof(options.socket_buffer_size)) == SOCKET_ERROR
+                || setsockopt(target, SOL_SOCKET, SO_SNDBUF, value, sizeof(options.socket_buffer_size)) == SOCKET_ERROR)
+                return false;
+        }
+        return true;
+    }
+
+#ifdef _WIN32
+
+    /// <summary>
+    /// 释放outstanding的一个引用，若它是最后一个，通知所有工作线程退出
+    /// </summary>
+    void release()
+    {
+        if (outstanding.fetch_sub(1) != 1)
+            return;
+        if (!port)
+            return;
+        for (size_t i = 0; i < workers.size(); i++)
+            mw::post_queued_completion_status(port, 0, udp_detail::key_shutdown);
+    }
+
+    void send_completed(udp_detail::send_request* request, DWORD bytes)
+    {
+        if (request->succeeded())
+        {
+            packets_sent.fetch_add(1, std::memory_order_relaxed);
+            bytes_sent.fetch_add(bytes, std::memory_order_relaxed);
+        }
+        else
+            send_errors.fetch_add(1, std::memory_order_relaxed);
+        InterlockedPushEntrySList(free_slots.get(), &request->slot->entry);
+        release();
+    }
+#else
+    /// <summary>
+    /// 统计一次失败的发送，发送缓冲区已满算作丢弃
+    /// </summary>
+    void send_failed(int error)
+    {
+        if (error == EAGAIN || error == EWOULDBLOCK || error == ENOBUFS)
+            send_dropped.fetch_add(1, std::memory_order_relaxed);
+        else
+            send_errors.fetch_add(1, std::memory_order_relaxed);
+    }
+#endif
+
+    void collect_worker_stats(udp_endpoint_stats& result) const
+    {
+        for (auto& worker : workers)
+        {
+            result.packets_received += worker->packets_received.load(std::memory_order_relaxed);
+            result.bytes_received += worker->bytes_received.load(std::memory_order_relaxed);
+            result.batches += worker->batches.load(std::memory_order_relaxed);
+            result.truncated += worker->truncated.load(std::memory_order_relaxed);
+            result.receive_errors += worker->receive_errors.load(std::memory_order_relaxed);
+        }
+    }
+
+#ifndef _WIN32
+    /// <summary>send_batch一次sendmmsg发送的最大数据报数</summary>
+    static constexpr unsigned int max_send_batch = 64;
+#endif
+
+    udp_datagram_callback on_datagrams;
+    udp_endpoint_options options;
+    bool running = false;
+    std::atomic<bool> stopping { false };
+
+    SOCKET socket = INVALID_SOCKET;
+    char* buffers = nullptr;
+    std::vector<std::unique_ptr<udp_detail::worker>> workers;
+#ifdef _WIN32
+    /// <summary>正在进行的I/O请求数，加上stop持有的一个引用</summary>
+    std::atomic<LONG> outstanding { 0 };
+    HANDLE port = nullptr;
+    std::unique_ptr<udp_detail::send_slot[]> slots;
+    std::unique_ptr<SLIST_HEADER> free_slots { new SLIST_HEADER };
+#else
+    size_t buffer_size = 0;
+    /// <summary>eventfd，stop写入它让所有工作线程退出</summary>
+    int wake_fd = -1;
+#endif
+
+    /// <summary>已停止的工作线程的接收计数</summary>
+    udp_endpoint_stats retired;
+    std::atomic<ULONGLONG> packets_sent { 0 };
+    std::atomic<ULONGLONG> bytes_sent { 0 };
+    std::atomic<ULONGLONG> send_dropped { 0 };
+    std::atomic<ULONGLONG> send_errors { 0 };
+};
+
+namespace udp_detail {
+
+#ifdef _WIN32
+    inline bool worker::start(bool pin)
+    {
+        thread = mw::c_create_thread(thread_function, this, nullptr, nullptr, CREATE_SUSPENDED);
+        if (!thread)
+            return false;
+        if (pin && index < sizeof(DWORD_PTR) * 8)
+            mw::set_thread_affinity_mask(thread, static_cast<DWORD_PTR>(1) << index);
+        else
+            mw::set_thread_ideal_processor(thread, index);
+        mw::resume_thread(thread);
+        return true;
+    }
+
+    inline void worker::run()
+    {
+        for (;;)
+        {
+            ULONG count = 0;
+            if (!mw::get_queued_completion_status_ex(owner->port, entries.data(), static_cast<ULONG>(entries.size()), count, INFINITE, FALSE))
+                break;
+
+            ULONG shutdowns = 0;
+            datagrams.clear();
+            completed.clear();
+            for (ULONG i = 0; i < count; i++)
+            {
+                auto& entry = entries[i];
+                if (entry.lpCompletionKey == key_shutdown)
+                {
+                    shutdowns++;
+                    continue;
+                }
+
+                auto request = static_cast<io_request*>(entry.lpOverlapped);
+                if (request->operation == io_operation::send)
+                {
+                    owner->send_completed(static_cast<send_request*>(request), entry.dwNumberOfBytesTransferred);
+                    continue;
+                }
+
+                auto recv = static_cast<recv_request*>(request);
+                completed.push_back(recv);
+                if (recv->succeeded())
+                {
+                    datagrams.push_back({ recv->buffer, entry.dwNumberOfBytesTransferred,
+                        reinterpret_cast<const sockaddr*>(&recv->from), recv->from_len });
+                    bytes_received.fetch_add(entry.dwNumberOfBytesTransferred, std::memory_order_relaxed);
+                    continue;
+                }
+
+                // 失败的状态是NTSTATUS，用WSAGetOverlappedResult得到对应的Windows Socket错误代码
+                DWORD bytes = 0, flags = 0;
+                if (!WSAGetOverlappedResult(owner->socket, recv, &bytes, FALSE, &flags))
+                {
+                    auto error = WSAGetLastError();
+                    if (error == WSAEMSGSIZE)
+                        truncated.fetch_add(1, std::memory_order_relaxed);
+                    else if (error != WSA_OPERATION_ABORTED)
+                        receive_errors.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+
+            if (!datagrams.empty())
+            {
+                packets_received.fetch_add(datagrams.size(), std::memory_order_relaxed);
+                batches.fetch_add(1, std::memory_order_relaxed);
+                owner->on_datagrams(*owner, datagrams.data(), datagrams.size());
+            }
+            for (auto request : completed)
+                post_recv(request);
+
+            if (shutdowns)
+            {
+                // 每个工作线程只应取走一个退出数据包，多取的还给其他工作线程
+                for (ULONG i = 1; i < shutdowns; i++)
+                    mw::post_queued_completion_status(owner->port, 0, key_shutdown);
+                break;
+            }
+        }
+    }
+
+    inline void worker::post_recv(recv_request* request)
+    {
+        auto& endpoint = *owner;
+        for (;;)
+        {
+            if (endpoint.stopping.load())
+            {
+                endpoint.release();
+                return;
+            }
+
+            request->reset();
+            request->from_len = sizeof(request->from);
+            request->flags = 0;
+            WSABUF buffer = { endpoint.options.datagram_size, request->buffer };
+            if (mw::socket::socket_recv_from_asyn(endpoint.socket, &buffer, 1, nullptr, request->flags,
+                    reinterpret_cast<sockaddr*>(&request->from), &request->from_len, request)
+                    != SOCKET_ERROR
+                || WSAGetLastError() == WSA_IO_PENDING)
+                break;
+
+            // 立即失败的请求不会有完成数据包，若失败的只是这一个数据报，重新投递，否则放弃这个请求
+            auto error = WSAGetLastError();
+            if (error == WSAEMSGSIZE)
+                truncated.fetch_add(1, std::memory_order_relaxed);
+            else
+            {
+                receive_errors.fetch_add(1, std::memory_order_relaxed);
+                if (error != WSAECONNRESET)
+                {
+                    endpoint.release();
+                    return;
+                }
+            }
+        }
+
+        // stop可能在上面检查stopping之后才取消所有I/O，这时刚投递的请求没有被取消
+        if (endpoint.stopping.load())
+            CancelIoEx(reinterpret_cast<HANDLE>(endpoint.socket), request);
+    }
+#else
+    inline bool worker::start(bool pin)
+    {
+        try
+        {
+            thread = std::thread([this] { run(); });
+        }
+        catch (const std::system_error&)
+        {
+            return false;
+        }
+        if (pin && index < CPU_SETSIZE)
+        {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(index, &set);
+            pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+        }
+        return true;
+    }
+
+    inline void worker::run()
+    {
+        pollfd fds[2] = { { socket, POLLIN, 0 }, { owner->wake_fd, POLLIN, 0 } };
+        for (;;)
+        {
+            if (poll(fds, 2, -1) < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                break;
+            }
+            if (fds[1].revents)
+                break;
+            receive_all();
+        }
+    }
+
+    /// <summary>
+    /// 用recvmmsg一批一批地取出套接字中的数据报，直到取完或者端点正在停止
+    /// </summary>
+    inline void worker::receive_all()
+    {
+        auto batch_size = static_cast<unsigned int>(messages.size());
+        while (!owner->stopping.load(std::memory_order_relaxed))
+        {
+            // recvmmsg会改写地址的长度，每次都要重新设置
+            for (auto& message : messages)
+                message.msg_hdr.msg_namelen = sizeof(sockaddr_storage);
+            auto count = recvmmsg(socket, messages.data(), batch_size, MSG_DONTWAIT, nullptr);
+            if (count < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                if (errno != EAGAIN && errno != EWOULDBLOCK)
+                    receive_errors.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+
+            datagrams.clear();
+            size_t bytes = 0;
+            for (int i = 0; i < count; i++)
+            {
+                auto& message = messages[i];
+                if (message.msg_hdr.msg_flags & MSG_TRUNC)
+                {
+                    truncated.fetch_add(1, std::memory_order_relaxed);
+                    continue;
+                }
+                datagrams.push_back({ static_cast<const char*>(iovecs[i].iov_base), message.msg_len,
+                    reinterpret_cast<const sockaddr*>(&addresses[i]), static_cast<int>(message.msg_hdr.msg_namelen) });
+                bytes += message.msg_len;
+            }
+            if (!datagrams.empty())
+            {
+                packets_received.fetch_add(datagrams.size(), std::memory_order_relaxed);
+                bytes_received.fetch_add(bytes, std::memory_order_relaxed);
+                batches.fetch_add(1, std::memory_order_relaxed);
+                owner->on_datagrams(*owner, datagrams.data(), datagrams.size());
+            }
+            if (static_cast<unsigned int>(count) < batch_size)
+                return;
+        }
+    }
+#endif
+
+} // namespace udp_detail
+
+} // namespace mw::net
@@ -0,0 +1,545 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+// 向量化的级别在编译时决定：x86和x64上用SSE2处理ASCII，定义了__AVX2__(MSVC的/arch:AVX2)时改用AVX2；
+// 有SSSE3(MSVC的/arch:AVX以上)时，连续的3字节序列(中日韩文字)也用pshufb按向量转换，其他平台只使用标量实现
+#if defined(__AVX2__)
+#    define MW_UNICODE_AVX2
+#endif
+#if defined(__SSSE3__) || defined(__AVX__)
+#    define MW_UNICODE_SSSE3
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    define MW_UNICODE_SSE2
+#    include <immintrin.h>
+#endif
+#if defined(_MSC_VER)
+#    include <intrin.h>
+#endif
+
+namespace mw {
+
+/// <summary>
+/// 转码的结果状态
+/// </summary>
+enum class transcode_status
+{
+    /// <summary>全部输入都已转换</summary>
+    ok,
+    /// <summary>输入中有不合法的编码(过长编码，代理项，超出U+10FFFF的码点，被截断的序列或不成对的代理项)</summary>
+    invalid_input,
+    /// <summary>输出缓冲区放不下下一个字符</summary>
+    output_too_small,
+};
+
+/// <summary>
+/// 转码的结果，read和written分别是已经转换的输入和已经写入的输出的单元数(UTF-8为字节，UTF-16为16位单元)，
+/// 失败时read指向第一个不合法的序列或者没有空间写入的字符，之前的输出都是有效的
+/// </summary>
+struct transcode_result
+{
+    transcode_status status = transcode_status::ok;
+    size_t read = 0;
+    size_t written = 0;
+};
+
+namespace unicode_detail {
+
+    /// <summary>
+    /// 返回mask中最低的1的位置，mask不能为0
+    /// </summary>
+    inline unsigned trailing_zeros(unsigned mask)
+    {
+#if defined(_MSC_VER)
+        unsigned long index = 0;
+        _BitScanForward(&index, mask);
+        return index;
+#else
+        return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+    }
+
+    inline unsigned popcount(unsigned mask)
+    {
+        mask = mask - ((mask >> 1) & 0x55555555u);
+        mask = (mask & 0x33333333u) + ((mask >> 2) & 0x33333333u);
+        return (((mask + (mask >> 4)) & 0x0F0F0F0Fu) * 0x01010101u) >> 24;
+    }
+
+    template <typename CharT>
+    constexpr void check_utf16_char()
+    {
+        static_assert(sizeof(CharT) == 2, "UTF-16的字符类型必须是16位的(char16_t，Windows上的wchar_t等)");
+    }
+
+    /// <summary>
+    /// 把从src开始的纯ASCII前缀扩展为UTF-16，每次处理一个向量，要求输入和输出都至少还有一个向量的空间
+    /// </summary>
+    /// <returns>返回转换的字符数</returns>
+    template <typename CharT>
+    inline size_t ascii_to_utf16(const unsigned char* src, size_t size, CharT* dst, size_t capacity)
+    {
+        size_t i = 0;
+#if defined(MW_UNICODE_AVX2)
+        for (; size - i >= 32 && capacity - i >= 32; i += 32)
+        {
+            auto bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_cvtepu8_epi16(_mm256_castsi256_si128(bytes)));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i + 16), _mm256_cvtepu8_epi16(_mm256_extracti128_si256(bytes, 1)));
+            // 非ASCII字节也被扩展写出，但只前进到第一个非ASCII字节，之后的输出会被覆盖
+            auto mask = static_cast<unsigned>(_mm256_movemask_epi8(bytes));
+            if (mask)
+                return i + trailing_zeros(mask);
+        }
+#endif
+#if defined(MW_UNICODE_SSE2)
+        for (; size - i >= 16 && capacity - i >= 16; i += 16)
+        {
+            auto bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+            auto zero = _mm_setzero_si128();
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_unpacklo_epi8(bytes, zero));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 8), _mm_unpackhi_epi8(bytes, zero));
+            auto mask = static_cast<unsigned>(_mm_movemask_epi8(bytes));
+            if (mask)
+                return i + trailing_zeros(mask);
+        }
+#else
+        for (; size - i >= 8 && capacity - i >= 8; i += 8)
+        {
+            unsigned long long word = 0;
+            std::memcpy(&word, src + i, sizeof(word));
+            if (word & 0x8080808080808080ULL)
+                break;
+            for (size_t j = 0; j < 8; j++)
+                dst[i + j] = static_cast<CharT>(src[i + j]);
+        }
+#endif
+        return i;
+    }
+
+    /// <summary>
+    /// 把从src开始的纯ASCII前缀压缩为UTF-8，每次处理一个向量，要求输入和输出都至少还有一个向量的空间
+    /// </summary>
+    /// <returns>返回转换的字符数</returns>
+    template <typename CharT>
+    inline size_t ascii_to_utf8(const CharT* src, size_t size, unsigned char* dst, size_t capacity)
+    {
+        size_t i = 0;
+#if defined(MW_UNICODE_AVX2)
+        for (; size - i >= 32 && capacity - i >= 32; i += 32)
+        {
+            auto low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+            auto high = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i + 16));
+            // packus按128位的半边交错，permute把结果恢复为原来的顺序
+            auto packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(low, high), 0xD8);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), packed);
+            auto limit = _mm256_set1_epi16(static_cast<short>(0xFF80));
+            auto zero = _mm256_setzero_si256();
+            auto ascii = _mm256_packs_epi16(_mm256_cmpeq_epi16(_mm256_and_si256(low, limit), zero),
+                _mm256_cmpeq_epi16(_mm256_and_si256(high, limit), zero));
+            auto mask = ~static_cast<unsigned>(_mm256_movemask_epi8(_mm256_permute4x64_epi64(ascii, 0xD8)));
+            if (mask)
+                return i + trailing_zeros(mask);
+        }
+#endif
+#if defined(MW_UNICODE_SSE2)
+        for (; size - i >= 16 && capacity - i >= 16; i += 16)
+        {
+            auto low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+            auto high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 8));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(low, high));
+            auto limit = _mm_set1_epi16(static_cast<short>(0xFF80));
+            auto zero = _mm_setzero_si128();
+            auto ascii = _mm_packs_epi16(_mm_cmpeq_epi16(_mm_and_si128(low, limit), zero),
+                _mm_cmpeq_epi16(_mm_and_si128(high, limit), zero));
+            auto mask = ~static_cast<unsigned>(_mm_movemask_epi8(ascii)) & 0xFFFF;
+            if (mask)
+                return i + trailing_zeros(mask);
+        }
+#else
+        for (; size - i >= 4 && capacity - i >= 4; i += 4)
+        {
+            if ((src[i] | src[i + 1] | src[i + 2] | src[i + 3]) & 0xFF80)
+                break;
+            for (size_t j = 0; j < 4; j++)
+                dst[i + j] = static_cast<unsigned char>(src[i + j]);
+        }
+#endif
+        return i;
+    }
+
+#if defined(MW_UNICODE_SSSE3)
+    /// <summary>
+    /// 把24字节的8个3字节序列解码为8个UTF-16单元，要求输入至少还有24字节，输出至少还有8个单元
+    /// </summary>
+    /// <returns>若这24字节不全是合法的3字节序列，返回false，此时不写入任何输出</returns>
+    template <typename CharT>
+    inline bool three_byte_to_utf16(const unsigned char* src, CharT* dst)
+    {
+        // low是第0到15字节，high是第8到23字节，首字节应该是1110xxxx，后续字节应该是10xxxxxx
+        auto low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+        auto high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 8));
+        auto low_format = _mm_cmpeq_epi8(_mm_and_si128(low, _mm_setr_epi8(-16, -64, -64, -16, -64, -64, -16, -64, -64, -16, -64, -64, -16, -64, -64, -16)),
+            _mm_setr_epi8(-32, -128, -128, -32, -128, -128, -32, -128, -128, -32, -128, -128, -32, -128, -128, -32));
+        auto high_format = _mm_cmpeq_epi8(_mm_and_si128(high, _mm_setr_epi8(-64, -16, -64, -64, -16, -64, -64, -16, -64, -64, -16, -64, -64, -16, -64, -64)),
+            _mm_setr_epi8(-128, -32, -128, -128, -32, -128, -128, -32, -128, -128, -32, -128, -128, -32, -128, -128));
+        if (_mm_movemask_epi8(_mm_and_si128(low_format, high_format)) != 0xFFFF)
+            return false;
+
+        // 每个16位的单元中，first_two的高字节是首字节，低字节是第二个字节，third的低字节是第三个字节
+        auto first_two = _mm_or_si128(_mm_shuffle_epi8(low, _mm_setr_epi8(1, 0, 4, 3, 7, 6, 10, 9, 13, 12, -128, -128, -128, -128, -128, -128)),
+            _mm_shuffle_epi8(high, _mm_setr_epi8(-128, -128, -128, -128, -128, -128, -128, -128, -128, -128, 8, 7, 11, 10, 14, 13)));
+        auto third = _mm_or_si128(_mm_shuffle_epi8(low, _mm_setr_epi8(2, -128, 5, -128, 8, -128, 11, -128, 14, -128, -128, -128, -128, -128, -128, -128)),
+            _mm_shuffle_epi8(high, _mm_setr_epi8(-128, -128, -128, -128, -128, -128, -128, -128, -128, -128, 9, -128, 12, -128, 15, -128)));
+        auto units = _mm_or_si128(_mm_or_si128(_mm_slli_epi16(_mm_and_si128(first_two, _mm_set1_epi16(0x0F00)), 4),
+                                      _mm_slli_epi16(_mm_and_si128(first_two, _mm_set1_epi16(0x003F)), 6)),
+            _mm_and_si128(third, _mm_set1_epi16(0x003F)));
+
+        // 小于0x800是过长编码，0xD800到0xDFFF是代理项
+        auto top = _mm_and_si128(units, _mm_set1_epi16(static_cast<short>(0xF800)));
+        auto invalid = _mm_or_si128(_mm_cmpeq_epi16(top, _mm_setzero_si128()), _mm_cmpeq_epi16(top, _mm_set1_epi16(static_cast<short>(0xD800))));
+        if (_mm_movemask_epi8(invalid))
+            return false;
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), units);
+        return true;
+    }
+
+    /// <summary>
+    /// 把8个需要3字节编码的UTF-16单元编码为24字节，要求输入至少还有8个单元，输出至少还有24字节
+    /// </summary>
+    /// <returns>若有单元小于0x800或者是代理项，返回false，此时不写入任何输出</returns>
+    template <typename CharT>
+    inline bool three_byte_to_utf8(const CharT* src, unsigned char* dst)
+    {
+        auto units = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+        auto top = _mm_and_si128(units, _mm_set1_epi16(static_cast<short>(0xF800)));
+        auto invalid = _mm_or_si128(_mm_cmpeq_epi16(top, _mm_setzero_si128()), _mm_cmpeq_epi16(top, _mm_set1_epi16(static_cast<short>(0xD800))));
+        if (_mm_movemask_epi8(invalid))
+            return false;
+
+        // first_two的每个单元依次是首字节和第二个字节，third的前8个字节是各个第三个字节，再按3字节一组交错
+        auto low6 = _mm_set1_epi16(0x003F);
+        auto first = _mm_or_si128(_mm_srli_epi16(units, 12), _mm_set1_epi16(0x00E0));
+        auto second = _mm_or_si128(_mm_and_si128(_mm_srli_epi16(units, 6), low6), _mm_set1_epi16(0x0080));
+        auto first_two = _mm_or_si128(first, _mm_slli_epi16(second, 8));
+        auto third = _mm_packus_epi16(_mm_or_si128(_mm_and_si128(units, low6), _mm_set1_epi16(0x0080)), _mm_setzero_si128());
+        auto head = _mm_or_si128(_mm_shuffle_epi8(first_two, _mm_setr_epi8(0, 1, -128, 2, 3, -128, 4, 5, -128, 6, 7, -128, 8, 9, -128, 10)),
+            _mm_shuffle_epi8(third, _mm_setr_epi8(-128, -128, 0, -128, -128, 1, -128, -128, 2, -128, -128, 3, -128, -128, 4, -128)));
+        auto tail = _mm_or_si128(_mm_shuffle_epi8(first_two, _mm_setr_epi8(11, -128, 12, 13, -128, 14, 15, -128, -128, -128, -128, -128, -128, -128, -128, -128)),
+            _mm_shuffle_epi8(third, _mm_setr_epi8(-128, 5, -128, -128, 6, -128, -128, 7, -128, -128, -128, -128, -128, -128, -128, -128)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), head);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + 16), tail);
+        return true;
+    }
+#endif
+
+} // namespace unicode_detail
+
+/// <summary>
+/// 计算UTF-8字符串转换为UTF-16后的单元数，只有输入是合法的UTF-8时结果才准确
+/// </summary>
+inline size_t utf16_length_of_utf8(const char* src, size_t size)
+{
+    auto bytes = reinterpret_cast<const unsigned char*>(src);
+    size_t length = 0;
+    size_t i = 0;
+#if defined(MW_UNICODE_SSE2)
+    // 非后续字节(不是10xxxxxx)各算一个单元，4字节序列的首字节(11110xxx)再多算一个，因为它需要代理对
+    auto continuation = _mm_set1_epi8(static_cast<char>(0xBF));
+    auto lead4 = _mm_set1_epi8(static_cast<char>(0xF0));
+    for (; size - i >= 16; i += 16)
+    {
+        auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + i));
+        auto starts = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpgt_epi8(chunk, continuation)));
+        auto pairs = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(chunk, lead4), lead4)));
+        length += unicode_detail::popcount(starts) + unicode_detail::popcount(pairs);
+    }
+#endif
+    for (; i < size; i++)
+        length += ((bytes[i] & 0xC0) != 0x80) + (bytes[i] >= 0xF0);
+    return length;
+}
+
+/// <summary>
+/// 计算UTF-16字符串转换为UTF-8后的字节数，只有输入是合法的UTF-16时结果才准确
+/// </summary>
+template <typename CharT>
+inline size_t utf8_length_of_utf16(const CharT* src, size_t size)
+{
+    unicode_detail::check_utf16_char<CharT>();
+    // 每个单元至少1字节，不小于0x80再加1，不小于0x800再加1；代理项按3计算时一对是6，所以每个代理项减1
+    size_t length = size;
+    size_t i = 0;
+#if defined(MW_UNICODE_SSE2)
+    auto limit2 = _mm_set1_epi16(0x7F);
+    auto limit3 = _mm_set1_epi16(0x7FF);
+    auto surrogate_mask = _mm_set1_epi16(static_cast<short>(0xF800));
+    auto surrogate = _mm_set1_epi16(static_cast<short>(0xD800));
+    auto zero = _mm_setzero_si128();
+    for (; size - i >= 8; i += 8)
+    {
+        auto units = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        // 无符号饱和减法为0说明单元不大于上限，每个16位结果在movemask中占2位
+        auto two = ~static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_subs_epu16(units, limit2), zero))) & 0xFFFF;
+        auto three = ~static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_subs_epu16(units, limit3), zero))) & 0xFFFF;
+        auto pairs = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(units, surrogate_mask), surrogate)));
+        length += (unicode_detail::popcount(two) + unicode_detail::popcount(three) - unicode_detail::popcount(pairs)) / 2;
+    }
+#endif
+    for (; i < size; i++)
+    {
+        auto unit = static_cast<unsigned>(src[i]);
+        length += (unit >= 0x80) + (unit >= 0x800) - ((unit & 0xF800) == 0xD800);
+    }
+    return length;
+}
+
+/// <summary>
+/// 把UTF-8转换为UTF-16并验证输入，ASCII的部分按向量处理，输出不以0结尾
+/// </summary>
+/// <param name="src">UTF-8输入</param>
+/// <param name="size">输入的字节数</param>
+/// <param name="dst">输出缓冲区</param>
+/// <param name="capacity">输出缓冲区能容纳的单元数，size个单元总是足够的</param>
+/// <returns>转换的结果，失败时已经写入的输出仍然有效</returns>
+template <typename CharT>
+inline transcode_result utf8_to_utf16(const char* src, size_t size, CharT* dst, size_t capacity)
+{
+    unicode_detail::check_utf16_char<CharT>();
+    auto bytes = reinterpret_cast<const unsigned char*>(src);
+    size_t i = 0;
+    size_t o = 0;
+    while (i < size)
+    {
+        auto ascii = unicode_detail::ascii_to_utf16(bytes + i, size - i, dst + o, capacity - o);
+        i += ascii;
+        o += ascii;
+
+        // 标量解码多字节序列和向量放不下的尾部，遇到ASCII字节时回到向量处理，这样纯中文的文本不会反复尝试向量
+        while (i < size)
+        {
+            unsigned lead = bytes[i];
+            if (lead < 0x80)
+            {
+                if (o == capacity)
+                    return { transcode_status::output_too_small, i, o };
+                dst[o++] = static_cast<CharT>(lead);
+                i++;
+                break;
+            }
+
+            // 先检查后续字节的格式，再由解出的码点拒绝过长编码，代理项和超出U+10FFFF的码点
+            if (lead >= 0xE0 && lead <= 0xEF)
+            {
+#if defined(MW_UNICODE_SSSE3)
+                if (size - i >= 24 && capacity - o >= 8 && unicode_detail::three_byte_to_utf16(bytes + i, dst + o))
+                {
+                    i += 24;
+                    o += 8;
+                    continue;
+                }
+#endif
+                if (size - i < 3 || ((bytes[i + 1] & 0xC0) | ((bytes[i + 2] & 0xC0) >> 2)) != 0xA0)
+                    return { transcode_status::invalid_input, i, o };
+                auto code_point = ((lead & 0x0F) << 12) | ((bytes[i + 1] & 0x3F) << 6) | (bytes[i + 2] & 0x3F);
+                if (code_point < 0x800 || (code_point & 0xF800) == 0xD800)
+                    return { transcode_status::invalid_input, i, o };
+                if (o == capacity)
+                    return { transcode_status::output_too_small, i, o };
+                dst[o++] = static_cast<CharT>(code_point);
+                i += 3;
+            }
+            else if (lead >= 0xC2 && lead <= 0xDF)
+            {
+                if (size - i < 2 || (bytes[i + 1] & 0xC0) != 0x80)
+                    return { transcode_status::invalid_input, i, o };
+                if (o == capacity)
+                    return { transcode_status::output_too_small, i, o };
+                dst[o++] = static_cast<CharT>(((lead & 0x1F) << 6) | (bytes[i + 1] & 0x3F));
+                i += 2;
+            }
+            else if (lead >= 0xF0 && lead <= 0xF4)
+            {
+                if (size - i < 4 || ((bytes[i + 1] & 0xC0) | ((bytes[i + 2] & 0xC0) >> 2) | ((bytes[i + 3] & 0xC0) >> 4)) != 0xA8)
+                    return { transcode_status::invalid_input, i, o };
+                auto code_point = ((lead & 0x07) << 18) | ((bytes[i + 1] & 0x3F) << 12) | ((bytes[i + 2] & 0x3F) << 6) | (bytes[i + 3] & 0x3F);
+                if (code_point < 0x10000 || code_point > 0x10FFFF)
+                    return { transcode_status::invalid_input, i, o };
+                if (capacity - o < 2)
+                    return { transcode_status::output_too_small, i, o };
+                code_point -= 0x10000;
+                dst[o++] = static_cast<CharT>(0xD800 | (code_point >> 10));
+                dst[o++] = static_cast<CharT>(0xDC00 | (code_point & 0x3FF));
+                i += 4;
+            }
+            else
+                return { transcode_status::invalid_input, i, o };
+        }
+    }
+    return { transcode_status::ok, i, o };
+}
+
+/// <summary>
+/// 把UTF-16转换为UTF-8并验证输入，ASCII的部分按向量处理，输出不以0结尾
+/// </summary>
+/// <param name="src">UTF-16输入</param>
+/// <param name="size">输入的单元数</param>
+/// <param name="dst">输出缓冲区</param>
+/// <param name="capacity">输出缓冲区的字节数，size * 3字节总是足够的</param>
+/// <returns>转换的结果，失败时已经写入的输出仍然有效</returns>
+template <typename CharT>
+inline transcode_result utf16_to_utf8(const CharT* src, size_t size, char* dst, size_t capacity)
+{
+    unicode_detail::check_utf16_char<CharT>();
+    auto bytes = reinterpret_cast<unsigned char*>(dst);
+    size_t i = 0;
+    size_t o = 0;
+    while (i < size)
+    {
+        auto ascii = unicode_detail::ascii_to_utf8(src + i, size - i, bytes + o, capacity - o);
+        i += ascii;
+        o += ascii;
+
+        while (i < size)
+        {
+            auto unit = static_cast<unsigned>(src[i]);
+            if (unit < 0x80)
+            {
+                if (o == capacity)
+                    return { transcode_status::output_too_small, i, o };
+                bytes[o++] = static_cast<unsigned char>(unit);
+                i++;
+                break;
+            }
+            else if (unit < 0x800)
+            {
+                if (capacity - o < 2)
+                    return { transcode_status::output_too_small, i, o };
+                bytes[o++] = static_cast<unsigned char>(0xC0 | (unit >> 6));
+                bytes[o++] = static_cast<unsigned char>(0x80 | (unit & 0x3F));
+                i++;
+            }
+            else if ((unit & 0xF800) != 0xD800)
+            {
+#if defined(MW_UNICODE_SSSE3)
+                if (size - i >= 8 && capacity - o >= 24 && unicode_detail::three_byte_to_utf8(src + i, bytes + o))
+                {
+                    i += 8;
+                    o += 24;
+                    continue;
+                }
+#endif
+                if (capacity - o < 3)
+                    return { transcode_status::output_too_small, i, o };
+                bytes[o++] = static_cast<unsigned char>(0xE0 | (unit >> 12));
+                bytes[o++] = static_cast<unsigned char>(0x80 | ((unit >> 6) & 0x3F));
+                bytes[o++] = static_cast<unsigned char>(0x80 | (unit & 0x3F));
+                i++;
+            }
+            else
+            {
+                // 高代理项后面必须紧跟低代理项
+                if (unit >= 0xDC00 || size - i < 2 || (static_cast<unsigned>(src[i + 1]) & 0xFC00) != 0xDC00)
+                    return { transcode_status::invalid_input, i, o };
+                if (capacity - o < 4)
+                    return { transcode_status::output_too_small, i, o };
+                auto code_point = 0x10000 + ((unit & 0x3FF) << 10) + (static_cast<unsigned>(src[i + 1]) & 0x3FF);
+                bytes[o++] = static_cast<unsigned char>(0xF0 | (code_point >> 18));
+                bytes[o++] = static_cast<unsigned char>(0x80 | ((code_point >> 12) & 0x3F));
+                bytes[o++] = static_cast<unsigned char>(0x80 | ((code_point >> 6) & 0x3F));
+                bytes[o++] = static_cast<unsigned char>(0x80 | (code_point & 0x3F));
+                i += 2;
+            }
+        }
+    }
+    return { transcode_status::ok, i, o };
+}
+
+/// <summary>
+/// 把UTF-8转换为UTF-16，直接写入目标字符串，只分配一次内存
+/// </summary>
+/// <param name="src">UTF-8输入</param>
+/// <param name="dst">[out]转换后的字符串，失败时为空</param>
+/// <returns>若输入不是合法的UTF-8，返回false</returns>
+template <typename CharT>
+inline bool utf8_to_utf16(std::string_view src, std::basic_string<CharT>& dst)
+{
+    // 先用很快的计数确定准确的长度，这样字符串的容量不会因为按最坏情况分配而浪费
+    dst.resize(utf16_length_of_utf8(src.data(), src.size()));
+    auto result = utf8_to_utf16(src.data(), src.size(), &dst[0], dst.size());
+    if (result.status != transcode_status::ok || result.written != dst.size())
+    {
+        dst.clear();
+        return false;
+    }
+    return true;
+}
+
+/// <summary>
+/// 把UTF-16转换为UTF-8，直接写入目标字符串，只分配一次内存
+/// </summary>
+/// <param name="src">UTF-16输入</param>
+/// <param name="dst">[out]转换后的字符串，失败时为空</param>
+/// <returns>若输入不是合法的UTF-16，返回false</returns>
+template <typename CharT>
+inline bool utf16_to_utf8(std::basic_string_view<CharT> src, std::string& dst)
+{
+    dst.resize(utf8_length_of_utf16(src.data(), src.size()));
+    auto result = utf16_to_utf8(src.data(), src.size(), &dst[0], dst.size());
+    if (result.status != transcode_status::ok || result.written != dst.size())
+    {
+        dst.clear();
+        return false;
+    }
+    return true;
+}
+
+template <typename CharT>
+inline bool utf16_to_utf8(const std::basic_string<CharT>& src, std::string& dst)
+{
+    return utf16_to_utf8(std::basic_string_view<CharT>(src), dst);
+}
+
+/// <summary>
+/// 把UTF-8转换为UTF-16，写入调用者提供的缓冲区，用于在多次转换中复用同一个缓冲区而不分配内存
+/// </summary>
+/// <param name="src">UTF-8输入</param>
+/// <param name="dst">输出缓冲区</param>
+/// <param name="capacity">输出缓冲区能容纳的单元数</param>
+/// <returns>转换的结果，输出不以0结尾</returns>
+template <typename CharT>
+inline transcode_result transcode_into(std::string_view src, CharT* dst, size_t capacity)
+{
+    return utf8_to_utf16(src.data(), src.size(), dst, capacity);
+}
+
+/// <summary>
+/// 把UTF-16转换为UTF-8，写入调用者提供的缓冲区，用于在多次转换中复用同一个缓冲区而不分配内存
+/// </summary>
+/// <param name="src">UTF-16输入</param>
+/// <param name="dst">输出缓冲区</param>
+/// <param name="capacity">输出缓冲区的字节数</param>
+/// <returns>转换的结果，输出不以0结尾</returns>
+template <typename CharT>
+inline transcode_result transcode_into(std::basic_string_view<CharT> src, char* dst, size_t capacity)
+{
+    return utf16_to_utf8(src.data(), src.size(), dst, capacity);
+}
+
+template <typename CharT, size_t N>
+inline transcode_result transcode_into(std::string_view src, CharT (&dst)[N])
+{
+    return utf8_to_utf16(src.data(), src.size(), dst, N);
+}
+
+template <typename CharT, size_t N>
+inline transcode_result transcode_into(std::basic_string_view<CharT> src, char (&dst)[N])
+{
+    return utf16_to_utf8(src.data(), src.size(), dst, N);
+}
+
+} // namespace mw
@@ -1,5 +1,9 @@
 #pragma once
 
+#include "mw_clock.h"
+#include "mw_environment.h"
+#include "mw_input.h"
+#include "mw_unicode.h"
 #include <tlhelp32.h>
 
 namespace mw {
@@ -7,24 +11,34 @@ namespace mw {
 /// <summary>
 /// 将多字节字符串转换为Unicode字符串
 /// </summary>
+/// <remarks>
+/// UTF-8由mw_unicode.h中的向量化转码器直接写入返回的字符串，只分配一次内存；
+/// 其他代码页和不合法的UTF-8(不合法的字符被替换为U+FFFD)由系统转换，同样直接写入返回的字符串
+/// </remarks>
 /// <param name="str">待转换的多字节字符串</param>
 /// <param name="string_code_page">代码页，默认为UTF-8</param>
 /// <returns>返回对应的Unicode字符串</returns>
 inline std::wstring string_to_wstring(const std::string& str, UINT string_code_page = CP_UTF8)
 {
-    auto wide_size = MultiByteToWideChar(string_code_page, 0, str.c_str(), -1, nullptr, 0);
-    PWSTR temp_wstr = new WCHAR[wide_size];
-    MultiByteToWideChar(string_code_page, 0, str.c_str(), -1, temp_wstr, wide_size);
+    std::wstring wstr;
+    if (str.empty() || (string_code_page == CP_UTF8 && utf8_to_utf16(str, wstr)))
+        return wstr;
+
+    auto wide_size = MultiByteToWideChar(string_code_page, 0, str.data(), static_cast<int>(str.size()), nullptr, 0);
+    wstr.resize(wide_size);
+    if (wide_size)
+        MultiByteToWideChar(string_code_page, 0, str.data(), static_cast<int>(str.size()), &wstr[0], wide_size);
     GET_ERROR_MSG_OUTPUT();
-    std::wstring wstr(temp_wstr);
-
-    delete[] temp_wstr;
     return wstr;
 }
 
 /// <summary>
 /// 将Unicode字符串转换为多字节字符串，如果要转换的多字节没有对应的字符，则用default_char填充
 /// </summary>
+/// <remarks>
+/// UTF-8由mw_unicode.h中的向量化转码器直接写入返回的字符串，只分配一次内存；
+/// 其他代码页和不成对的代理项(被替换为U+FFFD)由系统转换。UTF-8能表示所有字符，所以此时不使用default_char
+/// </remarks>
 /// <param name="wstr">待转换的Unicode字符串</param>
 /// <param name="string_code_page">多字节字符串代码页，默认为UTF-8</param>
 /// <param name="default_char">当转换的多字节字符串没有对应编码时填充该字符(如Unicode汉字转换成ANSI)</param>
@@ -33,15 +47,22 @@ inline std::wstring string_to_wstring(const std::string& str, UINT string_code_p
 inline std::string wstring_to_string(const std::wstring& wstr,
     UINT string_code_page = CP_UTF8, char default_char = '?', PBOOL is_used_def_char = nullptr)
 {
+    std::string str;
+    if (is_used_def_char)
+        *is_used_def_char = FALSE;
+    if (wstr.empty() || (string_code_page == CP_UTF8 && utf16_to_utf8(wstr, str)))
+        return str;
+
+    // CP_UTF8要求最后两个参数为NULL
+    auto default_char_pointer = string_code_page == CP_UTF8 ? nullptr : &default_char;
+    auto used_pointer = string_code_page == CP_UTF8 ? nullptr : is_used_def_char;
     auto str_size = WideCharToMultiByte(string_code_page, 0,
-        wstr.c_str(), -1, nullptr, 0, nullptr, nullptr);
-    PSTR temp_str = new CHAR[str_size];
-    WideCharToMultiByte(string_code_page, 0, wstr.c_str(),
-        -1, temp_str, str_size, &default_char, is_used_def_char);
+        wstr.data(), static_cast<int>(wstr.size()), nullptr, 0, default_char_pointer, used_pointer);
+    str.resize(str_size);
+    if (str_size)
+        WideCharToMultiByte(string_code_page, 0, wstr.data(),
+            static_cast<int>(wstr.size()), &str[0], str_size, default_char_pointer, used_pointer);
     GET_ERROR_MSG_OUTPUT();
-    std::string str(temp_str);
-
-    delete[] temp_str;
     return str;
 }
 
@@ -60,6 +81,7 @@ inline bool is_text_unicode(const void* buffer, int byte_count, int* test = null
 /// <summary>
 /// 安全句柄包装器，使用智能指针包装，能在销毁时自动关闭句柄
 /// </summary>
+/// <remarks>每次调用都会分配HANDLE和shared_ptr的控制块，新代码应该使用unique_kernel_handle(见mw_handle.h)，需要共享所有权时再使用它</remarks>
 /// <param name="kernel_object">内核对象句柄</param>
 /// <returns>返回被包装后的句柄</returns>
 inline std::shared_ptr<HANDLE> safe_handle(HANDLE kernel_object)
@@ -72,44 +94,51 @@ inline std::shared_ptr<HANDLE> safe_handle(HANDLE kernel_object)
 /// <summary>
 /// 获取当前线程所在进程的命令行的vector包装
 /// </summary>
+/// <remarks>
+/// 命令行只在environment_snapshot中解析一次，频繁访问时直接使用environment_snapshot::current()->arguments()，避免复制
+/// </remarks>
 /// <returns>返回所在进程命令行的vector包装</returns>
 inline std::vector<std::tstring> get_cmd_vec()
 {
-    int argc = 0;
-    auto argv = CommandLineToArgvW(GetCommandLineW(), &argc);
-    GET_ERROR_MSG_OUTPUT();
-
-    std::vector<std::tstring> cmd_vec;
-    for (size_t i = 0; i < argc; i++)
-#ifdef UNICODE
-        cmd_vec.push_back(argv[i]);
-#else
-        cmd_vec.push_back(mw::wstring_to_string(argv[i]));
-#endif // UNICODE
-    HeapFree(GetProcessHeap(), 0, argv);
-    return cmd_vec;
+    auto& arguments = environment_snapshot::current()->arguments();
+    return std::vector<std::tstring>(arguments.begin(), arguments.end());
 }
 
 /// <summary>
 /// 获取指定的环境变量的值
 /// </summary>
+/// <remarks>
+/// 直接写入var_value的缓冲区，缓冲区不足时按返回的长度扩展后重试，变量在两次调用之间变长也不会被截断。
+/// 频繁读取不变的环境变量时使用environment_snapshot::current()->get()，它不调用系统API也不分配内存
+/// </remarks>
 /// <param name="var_name">环境变量的名字</param>
 /// <param name="var_value">[out]环境变量的值</param>
 /// <returns>操作是否成功(是否被找到)</returns>
-inline bool get_envionment_var(const std::tstring& var_name, std::tstring& var_value)
+inline bool get_envionment_var(tzstring_view var_name, std::tstring& var_value)
 {
-    auto size_of_char = GetEnvironmentVariable(var_name.c_str(), nullptr, 0);
-    auto mybuffer = new TCHAR[size_of_char];
-
-    if (GetEnvironmentVariable(var_name.c_str(), mybuffer, size_of_char))
+    auto capacity = static_cast<DWORD>((std::max)(var_value.capacity(), size_t(MW_MAX_TEXT)));
+    for (;;)
     {
-        var_value = mybuffer;
-        delete[] mybuffer;
-        return true;
+        var_value.resize(capacity);
+        // 空的变量也返回0，需要用错误码区分
+        SetLastError(ERROR_SUCCESS);
+        auto length = GetEnvironmentVariable(var_name.c_str(), &var_value[0], capacity);
+        if (length == 0)
+        {
+            var_value.clear();
+            if (GetLastError() == ERROR_SUCCESS)
+                return true;
+            GET_ERROR_MSG_OUTPUT();
+            return false;
+        }
+        if (length < capacity)
+        {
+            var_value.resize(length);
+            return true;
+        }
+        // 缓冲区不足时返回的长度包括结尾的0
+        capacity = length;
     }
-    GET_ERROR_MSG_OUTPUT();
-    delete[] mybuffer;
-    return false;
 }
 
 /// <summary>
@@ -119,30 +148,58 @@ inline bool get_envionment_var(const std::tstring& var_name, std::tstring& var_v
 /// 当变量名已经存在，并且变量值不为NULL，则修改该变量
 /// 当变量名已经存在，并且变量值为NULL，则删除该变量
 /// 当变量名不存在，并且变量值不为NULL，则创建该变量
+/// 成功后使environment_snapshot失效
 /// </remarks>
 /// <param name="var_name">环境变量的名字</param>
 /// <param name="var_value">环境变量的值</param>
 /// <returns>操作是否成功</returns>
-inline bool set_envionment_var(const std::tstring& var_name, const std::tstring& var_value)
+inline bool set_envionment_var(tzstring_view var_name, tzstring_view var_value)
 {
     auto val = SetEnvironmentVariable(var_name.c_str(), var_value.c_str());
     GET_ERROR_MSG_OUTPUT();
+    if (val)
+        environment_snapshot::invalidate();
     return val;
 }
 
 /// <summary>
-/// 将指定字符串中的变量使用环境变量替换(如变量$windir$)
+/// 将指定字符串中的变量使用环境变量替换(如变量%windir%)
+/// </summary>
+/// <param name="src">源字符串</param>
+/// <param name="des_str">[out]使用环境变量替换后的字符串，它的容量被重用</param>
+/// <returns>操作是否成功</returns>
+inline bool expand_envionment_str(tzstring_view src, std::tstring& des_str)
+{
+    auto capacity = static_cast<DWORD>((std::max)({ des_str.capacity(), src.size() * 2, size_t(MW_MAX_TEXT) }));
+    for (;;)
+    {
+        des_str.resize(capacity);
+        auto length = ExpandEnvironmentStrings(src.c_str(), &des_str[0], capacity);
+        if (length == 0)
+        {
+            GET_ERROR_MSG_OUTPUT();
+            des_str.clear();
+            return false;
+        }
+        // 返回的长度包括结尾的0，缓冲区不足时是需要的长度
+        if (length <= capacity)
+        {
+            des_str.resize(length - 1);
+            return true;
+        }
+        capacity = length;
+    }
+}
+
+/// <summary>
+/// 将指定字符串中的变量使用环境变量替换(如变量%windir%)
 /// </summary>
 /// <param name="src">源字符串</param>
 /// <returns>使用环境变量替换后的字符串</returns>
-inline std::tstring expand_envionment_str(const std::tstring& src)
+inline std::tstring expand_envionment_str(tzstring_view src)
 {
-    auto size_of_char = ExpandEnvironmentStrings(src.c_str(), nullptr, 0);
-    auto mybuffer = new TCHAR[size_of_char];
-    ExpandEnvironmentStrings(src.c_str(), mybuffer, size_of_char);
-    GET_ERROR_MSG_OUTPUT();
-    std::tstring des_str = mybuffer;
-    delete[] mybuffer;
+    std::tstring des_str;
+    expand_envionment_str(src, des_str);
     return des_str;
 }
 
@@ -152,13 +209,23 @@ inline std::tstring expand_envionment_str(const std::tstring& src)
 /// <returns>返回所在进程的工作目录</returns>
 inline std::tstring get_current_work_dir()
 {
-    auto size = GetCurrentDirectory(0, nullptr);
-    TCHAR* temp_str = new TCHAR[size];
-    GetCurrentDirectory(size, temp_str);
-    GET_ERROR_MSG_OUTPUT();
-    std::tstring dir_str = temp_str;
-    delete[] temp_str;
-    return dir_str;
+    std::tstring dir_str(MAX_PATH, 0);
+    for (;;)
+    {
+        auto length = GetCurrentDirectory(static_cast<DWORD>(dir_str.size()), &dir_str[0]);
+        if (length == 0)
+        {
+            GET_ERROR_MSG_OUTPUT();
+            return {};
+        }
+        // 缓冲区不足时返回的长度包括结尾的0，其他线程可能同时修改了工作目录，所以需要循环
+        if (length < dir_str.size())
+        {
+            dir_str.resize(length);
+            return dir_str;
+        }
+        dir_str.resize(length);
+    }
 }
 
 /// <summary>
@@ -166,7 +233,7 @@ inline std::tstring get_current_work_dir()
 /// </summary>
 /// <param name="work_dir">新工作目录</param>
 /// <returns>操作是否成功</returns>
-inline bool set_current_work_dir(const std::tstring& work_dir)
+inline bool set_current_work_dir(tzstring_view work_dir)
 {
     auto val = SetCurrentDirectory(work_dir.c_str());
     GET_ERROR_MSG_OUTPUT();
@@ -176,13 +243,18 @@ inline bool set_current_work_dir(const std::tstring& work_dir)
 /// <summary>
 /// 将FILETIME转换为64位无符号数字(包括32位程序)
 /// </summary>
+/// <remarks>新代码请使用mw::clock::to_100ns和to_duration</remarks>
 /// <param name="ft">FILETIME结构体</param>
 /// <returns>对应的数字</returns>
-inline ULONGLONG file_time_to_qword(FILETIME& ft)
+inline ULONGLONG file_time_to_qword(const FILETIME& ft)
 {
-    return (Int64ShllMod32(ft.dwHighDateTime, 32) | ft.dwLowDateTime);
+    return clock::to_100ns(ft);
 }
 
+/// <summary>
+/// toolhelp快照的包装器，按顺序遍历进程，模块和线程
+/// </summary>
+/// <remarks>process_find和module_find每次都遍历整个快照，需要反复查找时使用system_snapshot</remarks>
 class tool_help
 {
 public:
@@ -276,7 +348,7 @@ public:
         }
         return is_found;
     }
-    bool module_find(const std::tstring& module_name, MODULEENTRY32& module_entry) const
+    bool module_find(tzstring_view module_name, MODULEENTRY32& module_entry) const
     {
         BOOL is_found = FALSE;
         for (BOOL fOk = module_first(module_entry); fOk; fOk = module_next(module_entry)) {
@@ -310,10 +382,7 @@ namespace user {
     /// <returns>对应的转换pair</returns>
     inline std::pair<LONG, LONG> trans_screen_to_absolute(LONG screen_x, LONG screen_y)
     {
-        auto screen_width = GetSystemMetrics(SM_CXSCREEN);
-        auto screen_height = GetSystemMetrics(SM_CYSCREEN);
-
-        return std::pair<LONG, LONG>(((float)screen_x / screen_width) * 65535, ((float)screen_y / screen_height) * 65535);
+        return trans_screen_to_absolute(screen_x, screen_y, GetSystemMetrics(SM_CXSCREEN), GetSystemMetrics(SM_CYSCREEN));
     }
 
     /// <summary>
@@ -321,6 +390,9 @@ namespace user {
     /// </summary>
     /// <param name="input_array">一列INPUT结构体的数组</param>
     /// <param name="input_struct_nums">数组的大小(INPUT的数量)</param>
+    /// <remarks>
+    /// 连续的输入脚本应该使用input_batch构造事件数组后一次发送，逐个发送时其他输入可能插入到中间
+    /// </remarks>
     /// <returns>该返回成功插入键盘或鼠标输入流的事件数，若为0，则输入已经被其他线程阻塞了(若是UIPI阻塞，GetLastError不会显示是UIPI阻塞导致的失败)</returns>
     inline UINT send_input(LPINPUT input_array, UINT input_struct_nums = 1)
     {
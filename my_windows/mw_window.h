@@ -1,6 +1,7 @@
 #pragma once
 #include "mw_library.h"
 #include "mw_process.h"
+#include "mw_trace.h"
 #include <unordered_map>
 
 namespace mw {
@@ -89,12 +90,12 @@ namespace user {
     /// <summary>
     /// 在系统中寻找对应窗口类和窗口名字的`顶级窗口`句柄(不搜寻子窗口，不区分大小写)
     /// </summary>
-    /// <param name="class_name">窗口类的名字，若为""，它将查找标题与window_name匹配的任何窗口</param>
-    /// <param name="window_name">窗口的名字，若为""，则所有窗口名称都匹配</param>
+    /// <param name="class_name">窗口类的名字，若为nullptr，它将查找标题与window_name匹配的任何窗口</param>
+    /// <param name="window_name">窗口的名字，若为nullptr，则所有窗口名称都匹配</param>
     /// <returns>返回对应的窗口句柄(操作失败返回NULL)</returns>
-    inline HWND find_window(const std::tstring& class_name = _T(""), const std::tstring& window_name = _T(""))
+    inline HWND find_window(tzstring_view class_name = nullptr, tzstring_view window_name = nullptr)
     {
-        auto val = FindWindow(tstring_to_pointer(class_name), tstring_to_pointer(window_name));
+        auto val = FindWindow(class_name.get(), window_name.get());
         GET_ERROR_MSG_OUTPUT();
         return val;
     }
@@ -102,16 +103,16 @@ namespace user {
     /// <summary>
     /// 在指定父窗口句柄中寻找对应窗口类和窗口名字的句柄(不区分大小写)
     /// </summary>
-    /// <param name="class_name">窗口类的名字，若为""，它将查找标题与window_name匹配的任何窗口</param>
-    /// <param name="window_name">窗口的名字，若为""，则所有窗口名称都匹配</param>
+    /// <param name="class_name">窗口类的名字，若为nullptr，它将查找标题与window_name匹配的任何窗口</param>
+    /// <param name="window_name">窗口的名字，若为nullptr，则所有窗口名称都匹配</param>
     /// <param name="parent_window">指定要搜索哪个父窗口的子窗口，若为NULL，父窗口为桌面窗口，若为HWND_MESSAGE，则寻找仅消息窗口</param>
     /// <param name="child_after">从该子窗口句柄(必须是直接子窗口)之后开始搜索，顺序是Z轴顺序，若为NULL，则从第一个开始</param>
     /// <returns>返回对应的窗口句柄(操作失败返回NULL)</returns>
-    inline HWND find_child_window(const std::tstring& class_name = _T(""),
-        const std::tstring& window_name = _T(""), HWND parent_window = nullptr, HWND child_after = nullptr)
+    inline HWND find_child_window(tzstring_view class_name = nullptr,
+        tzstring_view window_name = nullptr, HWND parent_window = nullptr, HWND child_after = nullptr)
     {
         auto val = FindWindowEx(parent_window, child_after,
-            tstring_to_pointer(class_name), tstring_to_pointer(window_name));
+            class_name.get(), window_name.get());
         GET_ERROR_MSG_OUTPUT();
         return val;
     }
@@ -168,7 +169,7 @@ namespace user {
     /// <param name="window_handle"></param>
     /// <param name="text"></param>
     /// <returns></returns>
-    inline bool set_window_text(HWND window_handle, const std::tstring& text)
+    inline bool set_window_text(HWND window_handle, tzstring_view text)
     {
         auto val = SetWindowText(window_handle, text.c_str());
         GET_ERROR_MSG_OUTPUT();
@@ -241,7 +242,7 @@ namespace user {
     /// <param name="output_window_class">指定窗口类的WNDCLASSEXA信息副本</param>
     /// <param name="instance">一般为NULL，表示获取系统全局窗口类</param>
     /// <returns>若函数找到匹配数据，并成功复制数据，返回true，否则返回false</returns>
-    inline bool get_window_class_info(const std::tstring& window_class_name,
+    inline bool get_window_class_info(tzstring_view window_class_name,
         WNDCLASSEX& output_window_class, HINSTANCE instance = nullptr)
     {
         auto val = GetClassInfoEx(instance, window_class_name.c_str(), &output_window_class);
@@ -424,11 +425,11 @@ namespace user {
     /// <param name="cbWndExtra">窗口额外空间(字节)</param>
     /// <returns>返回一个能唯一指定该窗口类的ATOM，若失败返回0</returns>
     inline ATOM register_window_class(WNDPROC procedure,
-        const std::tstring& class_name = _T("my_class"),
+        tzstring_view class_name = _T("my_class"),
         HICON hIcon = nullptr, HCURSOR hCursor = nullptr,
         HBRUSH hbrBackground = (HBRUSH)GetStockObject(WHITE_BRUSH),
         HICON hIconSm = nullptr, UINT style = CS_HREDRAW | CS_VREDRAW,
-        const std::tstring& menu_name = _T(""),
+        tzstring_view menu_name = nullptr,
         int cbClsExtra = 0, int cbWndExtra = 0)
     {
         WNDCLASSEX win_class;
@@ -442,8 +443,8 @@ namespace user {
         win_class.hCursor = hCursor;
         win_class.hIconSm = hIconSm;
         win_class.hbrBackground = hbrBackground;
-        win_class.lpszMenuName = tstring_to_pointer(menu_name);
-        win_class.lpszClassName = tstring_to_pointer(class_name);
+        win_class.lpszMenuName = menu_name.get();
+        win_class.lpszClassName = class_name.get();
         win_class.hInstance = hinstance;
         win_class.lpfnWndProc = procedure;
 
@@ -467,7 +468,7 @@ namespace user {
     /// <param name="style">窗口样式</param>
     /// <param name="ex_style">扩展样式</param>
     /// <returns>返回新创建窗口的句柄</returns>
-    inline HWND create_window(const std::tstring& window_class_name, const std::tstring& window_name = _T("my window"),
+    inline HWND create_window(tzstring_view window_class_name, tzstring_view window_name = _T("my window"),
         int x = CW_USEDEFAULT, int y = CW_USEDEFAULT, int width = CW_USEDEFAULT, int height = CW_USEDEFAULT,
         HWND window_parent = nullptr, HMENU menu = nullptr,
         LPVOID lParam = nullptr, DWORD style = WS_OVERLAPPEDWINDOW, DWORD ex_style = 0)
@@ -488,7 +489,7 @@ namespace user {
     /// <param name="window_class_name">窗口类名字</param>
     /// <param name="ins">模块实例句柄</param>
     /// <returns>操作是否成功</returns>
-    inline bool unregister_window_class(const std::tstring& window_class_name, HINSTANCE ins)
+    inline bool unregister_window_class(tzstring_view window_class_name, HINSTANCE ins)
     {
         auto val = UnregisterClass(window_class_name.c_str(), ins);
         GET_ERROR_MSG_OUTPUT();
@@ -792,7 +793,9 @@ namespace user {
     /// <returns>操作是否成功</returns>
     inline bool destroy_window(HWND window_handle)
     {
+        MW_TRACE_SCOPE(window, window_handle);
         auto val = DestroyWindow(window_handle);
+        MW_TRACE_RESULT(val);
         GET_ERROR_MSG_OUTPUT();
         return val;
     }
@@ -838,7 +841,7 @@ namespace user {
     /// <remarks>其他应用程序出于不同目的使用相同的消息标识符，则使用此功函数可以防止可能出现的冲突(一般用于程序之间的交流)</remarks>
     /// <param name="message_str">消息字符串</param>
     /// <returns>一个在系统唯一的新消息值</returns>
-    inline UINT register_window_message(const std::tstring& message_str)
+    inline UINT register_window_message(tzstring_view message_str)
     {
         auto val = RegisterWindowMessage(message_str.c_str());
         GET_ERROR_MSG_OUTPUT();
@@ -856,7 +859,9 @@ namespace user {
     /// <returns>操作是否成功</returns>
     inline bool post_message(HWND window_handle, UINT Msg, WPARAM wParam, LPARAM lParam)
     {
+        MW_TRACE_SCOPE(window, window_handle);
         auto val = PostMessage(window_handle, Msg, wParam, lParam);
+        MW_TRACE_RESULT(val);
         GET_ERROR_MSG_OUTPUT();
         return val;
     }
@@ -890,7 +895,9 @@ namespace user {
     /// <returns>接收到WM_QUIT时返回0，否则返回非0值，注意返回-1，则说明发生错误</returns>
     inline BOOL get_message(MSG& msg, HWND window_handle = nullptr, int msg_filter_min = 0, int msg_filter_max = 0)
     {
+        MW_TRACE_SCOPE(window, window_handle);
         auto val = GetMessage(&msg, window_handle, msg_filter_min, msg_filter_max);
+        MW_TRACE_RESULT(val);
         GET_ERROR_MSG_OUTPUT();
         return val;
     }
@@ -908,7 +915,9 @@ namespace user {
     inline bool peek_message(MSG& msg, HWND window_handle = nullptr,
         UINT remove_msg = PM_REMOVE, int msg_filter_min = 0, int msg_filter_max = 0)
     {
+        MW_TRACE_SCOPE(window, window_handle);
         auto val = PeekMessage(&msg, window_handle, msg_filter_min, msg_filter_max, remove_msg);
+        MW_TRACE_RESULT(val);
         GET_ERROR_MSG_OUTPUT();
         return val;
     }
@@ -957,7 +966,9 @@ namespace user {
     /// <returns>返回值指定消息处理的结果；这取决于发送的消息。</returns>
     inline LRESULT send_message(HWND window_handle, UINT Msg, WPARAM wParam, LPARAM lParam)
     {
+        MW_TRACE_SCOPE(window, window_handle);
         auto val = SendMessage(window_handle, Msg, wParam, lParam);
+        MW_TRACE_RESULT(val);
         GET_ERROR_MSG_OUTPUT();
         return val;
     }
@@ -1012,7 +1023,9 @@ namespace user {
     inline bool send_message_timeout(HWND window_handle, UINT Msg, WPARAM wParam, LPARAM lParam,
         UINT flags, UINT timeout, PDWORD_PTR result = nullptr)
     {
+        MW_TRACE_SCOPE(window, window_handle);
         auto val = SendMessageTimeout(window_handle, Msg, wParam, lParam, flags, timeout, result);
+        MW_TRACE_RESULT(val);
         GET_ERROR_MSG_OUTPUT();
         return val;
     }
@@ -1110,7 +1123,7 @@ namespace user {
     /// <param name="prop_name">所有物名字，用于唯一标识该所有物</param>
     /// <param name="data">所有物对应的数据，它可以是指向任何有用数据的指针</param>
     /// <returns>操作是否成功</returns>
-    inline bool set_prop(HWND window_handle, const std::tstring& prop_name, HANDLE data)
+    inline bool set_prop(HWND window_handle, tzstring_view prop_name, HANDLE data)
     {
         auto val = SetProp(window_handle, prop_name.c_str(), data);
         GET_ERROR_MSG_OUTPUT();
@@ -1123,7 +1136,7 @@ namespace user {
     /// <param name="window_handle">指定条目所在所有物列表对应的窗口句柄</param>
     /// <param name="prop_name">所有物名字，用于唯一标识该所有物</param>
     /// <returns>返回存储的数据指针，若找不到指定所有物，返回NULL</returns>
-    inline HANDLE remove_prop(HWND window_handle, const std::tstring& prop_name)
+    inline HANDLE remove_prop(HWND window_handle, tzstring_view prop_name)
     {
         auto val = RemoveProp(window_handle, prop_name.c_str());
         GET_ERROR_MSG_OUTPUT();
@@ -1136,7 +1149,7 @@ namespace user {
     /// <param name="window_handle">要获取所有物关联的窗口句柄</param>
     /// <param name="prop_name">所有物名字，用于唯一标识该所有物</param>
     /// <returns>返回数据指针，若没找到返回NULL</returns>
-    inline HANDLE get_prop(HWND window_handle, const std::tstring& prop_name)
+    inline HANDLE get_prop(HWND window_handle, tzstring_view prop_name)
     {
         auto val = GetProp(window_handle, prop_name.c_str());
         GET_ERROR_MSG_OUTPUT();
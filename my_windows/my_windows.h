@@ -4,19 +4,43 @@
 
 #include "stdafx.h" // 预编译头
 
-#include "mw_debug.h"    // Debug助手相关的封装
-#include "mw_device.h"   // I/O设备相关的封装
-#include "mw_dialog.h"   // 对话框，控件等相关的封装
-#include "mw_fiber.h"    // 纤程相关的封装
-#include "mw_gdi.h"      // GDI相关的封装
-#include "mw_job.h"      // 作业相关的封装
-#include "mw_library.h"  // 模块相关的封装
-#include "mw_memory.h"   // 内存相关的封装
-#include "mw_process.h"  // 进程相关的封装
-#include "mw_resource.h" // 资源相关的封装
-#include "mw_security.h" // 安全相关的封装
-#include "mw_socket.h"   // 套接字相关的封装
-#include "mw_system.h"   // 系统相关的封装
-#include "mw_thread.h"   // 线程和线程同步相关的封装
-#include "mw_utility.h"  // 有用工具的封装
-#include "mw_window.h"   // 窗口，消息，挂钩等相关的封装
+#include "mw_buffer_pool.h"       // 套接字缓冲区池
+#include "mw_clock.h"             // 高精度单调时钟和计时器
+#include "mw_connection_pool.h"   // 出站连接池
+#include "mw_debug.h"             // Debug助手相关的封装
+#include "mw_device.h"            // I/O设备相关的封装
+#include "mw_dialog.h"            // 对话框，控件等相关的封装
+#include "mw_environment.h"       // 环境变量和命令行参数的快照
+#include "mw_error.h"             // 编译期选择的错误处理策略
+#include "mw_fiber.h"             // 纤程相关的封装
+#include "mw_framing.h"           // 分帧编解码器和接收缓冲区链
+#include "mw_gdi.h"               // GDI相关的封装
+#include "mw_handle.h"            // 独占所有权的句柄包装器
+#include "mw_heap_tracker.h"      // 堆分配追踪和泄漏分析
+#include "mw_http.h"              // HTTP/1.1请求解析器和服务器
+#include "mw_input.h"             // 批量合成键盘和鼠标输入
+#include "mw_job.h"               // 作业相关的封装
+#include "mw_latency_histogram.h" // HDR风格的延迟直方图
+#include "mw_library.h"           // 模块相关的封装
+#include "mw_memory.h"            // 内存相关的封装
+#include "mw_memory_map.h"        // 进程地址空间快照
+#include "mw_memory_pressure.h"   // 内存压力监视
+#include "mw_memory_scanner.h"    // 远程进程内存扫描
+#include "mw_platform.h"          // 其他平台上的Windows类型替代
+#include "mw_process.h"           // 进程相关的封装
+#include "mw_resolver.h"          // 带缓存的异步地址解析器
+#include "mw_resource.h"          // 资源相关的封装
+#include "mw_security.h"          // 安全相关的封装
+#include "mw_send_queue.h"        // 合并小写入的发送队列
+#include "mw_shared_memory.h"     // 共享内存段，位置无关指针和共享容器
+#include "mw_socket.h"            // 套接字相关的封装
+#include "mw_system.h"            // 系统相关的封装
+#include "mw_system_snapshot.h"   // 进程，模块和线程的索引快照
+#include "mw_tcp_server.h"        // 异步TCP服务器框架
+#include "mw_thread.h"            // 线程和线程同步相关的封装
+#include "mw_timer_wheel.h"       // 哈希时间轮
+#include "mw_trace.h"             // 按模块启用的低开销调用追踪
+#include "mw_udp_endpoint.h"      // 批量收发的UDP端点
+#include "mw_unicode.h"           // UTF-8和UTF-16的向量化转码
+#include "mw_utility.h"           // 有用工具的封装
+#include "mw_window.h"            // 窗口，消息，挂钩等相关的封装
@@ -2,19 +2,25 @@
 
 // Enjoy it O(∩_∩)O
 
-#define WIN32_LEAN_AND_MEAN
+#ifdef _WIN32
+#    define WIN32_LEAN_AND_MEAN
 
-#include <Windows.h>
-#include <shellapi.h>
-#include <tchar.h>
+#    include <Windows.h>
+#    include <shellapi.h>
+#    include <tchar.h>
+#else
+#    include "mw_platform.h"
+#endif
 
 #include <functional>
 #include <iostream>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 
-#ifdef MY_WINDOWS_PRINT_ERROR
+// loerr只支持Windows，其他平台上不输出错误信息
+#if defined(MY_WINDOWS_PRINT_ERROR) && defined(_WIN32)
 
 #    define LOERR_ENABLE_TRANSFER
 #    define LOERR_ENABLE_PREDEFINE
@@ -38,6 +44,18 @@
 #    define GET_ERROR_MSG_OUTPUT_SOCKET()
 #endif
 
+#ifdef MY_WINDOWS_TRACK_HEAP
+#    define MW_TRACK_HEAP_ALLOC(address, bytes) mw::heap_tracker::on_alloc(address, bytes)
+#    define MW_TRACK_HEAP_FREE(address) mw::heap_tracker::on_free(address)
+#    define MW_TRACK_HEAP_REALLOC_BEGIN(address) auto mw_tracked_block = mw::heap_tracker::on_realloc_begin(address)
+#    define MW_TRACK_HEAP_REALLOC_END(address, new_address, bytes) mw::heap_tracker::on_realloc_end(address, mw_tracked_block, new_address, bytes)
+#else
+#    define MW_TRACK_HEAP_ALLOC(address, bytes)
+#    define MW_TRACK_HEAP_FREE(address)
+#    define MW_TRACK_HEAP_REALLOC_BEGIN(address)
+#    define MW_TRACK_HEAP_REALLOC_END(address, new_address, bytes)
+#endif
+
 #ifdef UNICODE
 #    define tstring wstring
 #    define tcout wcout
@@ -58,34 +76,60 @@
 namespace mw {
 
 /// <summary>
-/// 将错误代码转换成对应的文本提示
+/// 以0结尾的字符串视图，wrapper的字符串参数都使用它，这样传入字面量或者const TCHAR*时不需要构造临时的std::tstring
 /// </summary>
-/// <param name="error_code">错误代码</param>
-/// <returns>返回错误代码对应的文本提示信息</returns>
-inline std::tstring formate_error_code(DWORD error_code)
+/// <remarks>
+/// 可以从字面量，const TCHAR*和std::tstring隐式构造，都不分配内存。默认构造或者从nullptr构造的是空视图，
+/// 表示"没有名字"，get()返回NULL；而_T("")是非空的空字符串，get()返回指向""的指针，这与系统API对NULL和""的区分一致。
+/// 视图不拥有字符串，从std::tstring构造时该字符串必须比视图活得久(作为函数参数时总是如此)
+/// </remarks>
+class tzstring_view
 {
-    PTSTR error_text = nullptr;
-    FormatMessage(
-        FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS,
-        nullptr,
-        error_code,
-        MAKELANGID(LANG_ENGLISH, SUBLANG_ENGLISH_US),
-        (LPTSTR)&error_text,
-        0, nullptr);
-
-    std::tstring error_str(error_text);
-    LocalFree(error_text);
-    return error_str;
-}
+public:
+    constexpr tzstring_view() noexcept = default;
+    constexpr tzstring_view(PCTSTR str) noexcept
+        : str(str)
+        , length(str ? std::char_traits<TCHAR>::length(str) : 0)
+    {
+    }
+    tzstring_view(const std::tstring& str) noexcept
+        : str(str.c_str())
+        , length(str.size())
+    {
+    }
+
+public:
+    /// <summary>
+    /// 返回传给系统API的指针，空视图返回NULL
+    /// </summary>
+    constexpr PCTSTR get() const noexcept { return str; }
+    /// <summary>
+    /// 返回以0结尾的字符串，空视图返回""，用于不接受NULL的API
+    /// </summary>
+    constexpr PCTSTR c_str() const noexcept { return str ? str : _T(""); }
+    constexpr bool is_null() const noexcept { return str == nullptr; }
+    constexpr bool empty() const noexcept { return length == 0; }
+    constexpr size_t size() const noexcept { return length; }
+    constexpr std::basic_string_view<TCHAR> view() const noexcept { return { c_str(), length }; }
+    std::tstring to_string() const { return std::tstring(c_str(), length); }
+
+    friend constexpr bool operator==(tzstring_view left, tzstring_view right) noexcept { return left.view() == right.view(); }
+    friend constexpr bool operator!=(tzstring_view left, tzstring_view right) noexcept { return !(left == right); }
+
+private:
+    PCTSTR str = nullptr;
+    size_t length = 0;
+};
 
 /// <summary>
 /// 返回指向该字符串缓冲区的const指针，若为""，则返回NULL
 /// </summary>
+/// <remarks>保留给已有的调用者，wrapper中请使用tzstring_view::get()，它只把空视图转换为NULL</remarks>
 /// <param name="str">源字符串</param>
 /// <returns>指向字符串缓冲区的const指针</returns>
-constexpr inline PCTSTR tstring_to_pointer(const std::tstring& str)
+inline PCTSTR tstring_to_pointer(const std::tstring& str)
 {
-    return ((str == _T("")) ? nullptr : str.c_str());
+    return str.empty() ? nullptr : str.c_str();
 }
 
 /// <summary>
@@ -100,4 +144,7 @@ inline std::shared_ptr<TCHAR[]> get_buffer_from_tstring(const std::tstring& tstr
     return buffer;
 }
 
-} // namespace mw
\ No newline at end of file
+} // namespace mw
+
+// formate_error_code和错误处理策略定义在mw_error.h中，只包含了stdafx.h的调用者也可以使用它们
+#include "mw_error.h"
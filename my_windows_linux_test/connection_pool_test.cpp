@@ -0,0 +1,287 @@
+#include "linux_test.h"
+#include "mw_connection_pool.h"
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <unistd.h>
+
+// mw_connection_pool.h在回环上的测试：租用和归还，空闲连接被对端关闭或空闲超时后被删除，
+// stop时正在交接和等待的checkout失败，不再使用的端点被删除
+
+namespace {
+
+USHORT free_port()
+{
+    auto socket = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(address);
+    ::bind(socket, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+    ::getsockname(socket, reinterpret_cast<sockaddr*>(&address), &length);
+    ::close(socket);
+    return ntohs(address.sin_port);
+}
+
+template <typename Predicate>
+bool wait_until(Predicate predicate, int milliseconds = 5000)
+{
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(milliseconds);
+    while (!predicate())
+    {
+        if (std::chrono::steady_clock::now() > deadline)
+            return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+/// <summary>
+/// 回环上的回显服务器，记录接受的连接，可以从服务器一端关闭它们
+/// </summary>
+class echo_server
+{
+public:
+    echo_server()
+        : server(make_handler(), make_options())
+    {
+        port = free_port();
+        MW_CHECK(server.start() && server.listen(port));
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    }
+
+    /// <summary>
+    /// 从服务器一端关闭所有连接
+    /// </summary>
+    void close_all()
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        for (auto connection : connections)
+            server.post(connection->reactor_index(), [connection] { connection->close(); });
+    }
+
+    size_t connection_count()
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        return connections.size();
+    }
+
+    const sockaddr* get_address() const { return reinterpret_cast<const sockaddr*>(&address); }
+    int get_address_len() const { return sizeof(address); }
+
+private:
+    mw::net::tcp_handler make_handler()
+    {
+        mw::net::tcp_handler handler;
+        handler.on_connect = [this](mw::net::tcp_connection& connection) {
+            std::lock_guard<std::mutex> guard(lock);
+            connections.push_back(&connection);
+        };
+        handler.on_data = [](mw::net::tcp_connection& connection, const char* data, size_t size) -> size_t {
+            return connection.send(data, size) ? size : 0;
+        };
+        handler.on_close = [this](mw::net::tcp_connection& connection) {
+            std::lock_guard<std::mutex> guard(lock);
+            connections.erase(std::find(connections.begin(), connections.end(), &connection));
+        };
+        return handler;
+    }
+
+    static mw::net::tcp_server_options make_options()
+    {
+        mw::net::tcp_server_options options;
+        options.reactor_count = 1;
+        return options;
+    }
+
+    std::mutex lock;
+    std::vector<mw::net::tcp_connection*> connections;
+    mw::net::tcp_server server;
+    USHORT port = 0;
+    sockaddr_in address = {};
+};
+
+mw::net::connection_pool_options pool_options()
+{
+    mw::net::connection_pool_options options;
+    options.tick = 10;
+    options.server_options.reactor_count = 1;
+    return options;
+}
+
+/// <summary>
+/// 发送一个请求，收到完整的回显后归还连接
+/// </summary>
+struct round_trip
+{
+    std::atomic<int> completed { 0 };
+    std::atomic<int> failed { 0 };
+    mw::net::connection_pool* pool = nullptr;
+
+    mw::net::connection_pool_handler handler()
+    {
+        mw::net::connection_pool_handler result;
+        result.on_data = [this](mw::net::tcp_connection& connection, const char*, size_t size) -> size_t {
+            if (size < 4)
+                return 0;
+            completed++;
+            pool->release(connection);
+            return size;
+        };
+        return result;
+    }
+
+    void run(const echo_server& target)
+    {
+        pool->checkout(target.get_address(), target.get_address_len(), [this](mw::net::tcp_connection* connection, int) {
+            if (!connection)
+            {
+                failed++;
+                return;
+            }
+            connection->send("ping", 4);
+        });
+    }
+};
+
+void test_checkout_and_release()
+{
+    echo_server target;
+    round_trip trip;
+    auto options = pool_options();
+    options.max_connections = 2;
+    mw::net::connection_pool pool(trip.handler(), options);
+    trip.pool = &pool;
+    MW_CHECK(pool.start());
+
+    trip.run(target);
+    MW_CHECK(wait_until([&] { return trip.completed.load() == 1; }));
+    auto stats = pool.stats();
+    MW_CHECK(stats.connects == 1 && stats.idle == 1 && stats.leased == 0 && stats.reused == 0);
+
+    // 顺序的请求复用同一个连接
+    for (int i = 2; i <= 20; i++)
+    {
+        trip.run(target);
+        MW_CHECK(wait_until([&] { return trip.completed.load() == i; }));
+    }
+    stats = pool.stats();
+    MW_CHECK(stats.connects == 1 && stats.reused == 19 && stats.checkouts == 20 && stats.wait_count == 20);
+    MW_CHECK(target.connection_count() == 1 && trip.failed.load() == 0);
+
+    // 超过max_connections的checkout等待归还的连接
+    for (int i = 0; i < 10; i++)
+        trip.run(target);
+    MW_CHECK(wait_until([&] { return trip.completed.load() == 30; }));
+    MW_CHECK(pool.stats().connects <= 2 && target.connection_count() <= 2);
+    pool.stop();
+}
+
+void test_dead_connections_evicted()
+{
+    echo_server target;
+    round_trip trip;
+    auto options = pool_options();
+    options.idle_timeout = 100;
+    mw::net::connection_pool pool(trip.handler(), options);
+    trip.pool = &pool;
+    MW_CHECK(pool.start());
+
+    // 空闲连接被对端关闭后从空闲链表中删除，下次checkout建立新连接
+    trip.run(target);
+    MW_CHECK(wait_until([&] { return trip.completed.load() == 1 && pool.stats().idle == 1; }));
+    target.close_all();
+    MW_CHECK(wait_until([&] { return pool.stats().idle == 0; }));
+    trip.run(target);
+    MW_CHECK(wait_until([&] { return trip.completed.load() == 2; }));
+    MW_CHECK(pool.stats().connects == 2 && trip.failed.load() == 0);
+
+    // 空闲超时的连接被关闭，之后端点没有连接，在维护计时器中被删除
+    MW_CHECK(wait_until([&] { return pool.stats().evicted == 1 && pool.stats().idle == 0; }));
+    MW_CHECK(wait_until([&] { return target.connection_count() == 0; }));
+    MW_CHECK(wait_until([&] { return pool.stats().endpoints == 0; }));
+    pool.stop();
+}
+
+void test_stop_fails_handoff()
+{
+    echo_server target;
+    round_trip trip;
+    auto options = pool_options();
+    options.max_connections = 1;
+    options.checkout_timeout = 0;
+    mw::net::connection_pool pool(trip.handler(), options);
+    trip.pool = &pool;
+    MW_CHECK(pool.start());
+    trip.run(target);
+    MW_CHECK(wait_until([&] { return pool.stats().idle == 1; }));
+
+    // 让连接所属的反应器忙于一个调用，交接排在它后面
+    std::atomic<bool> blocked { true };
+    MW_CHECK(pool.get_server().post(0, [&] {
+        while (blocked.load())
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }));
+    std::atomic<int> handoff_error { -1 }, waiter_error { -1 };
+    pool.checkout(target.get_address(), target.get_address_len(), [&](mw::net::tcp_connection* connection, int error) {
+        handoff_error = connection ? 0 : error;
+    });
+    // 唯一的连接正在交接，这个checkout等待
+    pool.checkout(target.get_address(), target.get_address_len(), [&](mw::net::tcp_connection* connection, int error) {
+        waiter_error = connection ? 0 : error;
+    });
+    MW_CHECK(pool.stats().waiting == 1 && pool.stats().leased == 1);
+
+    std::thread stopper([&] { pool.stop(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    blocked = false;
+    stopper.join();
+    MW_CHECK(handoff_error.load() == WSAESHUTDOWN);
+    MW_CHECK(waiter_error.load() == WSAESHUTDOWN);
+
+    // 停止后的checkout立即失败
+    std::atomic<int> late_error { -1 };
+    pool.checkout(target.get_address(), target.get_address_len(), [&](mw::net::tcp_connection*, int error) { late_error = error; });
+    MW_CHECK(late_error.load() == WSAESHUTDOWN);
+}
+
+void test_refused_endpoint()
+{
+    round_trip trip;
+    auto options = pool_options();
+    options.failure_threshold = 1;
+    options.initial_backoff = 200;
+    mw::net::connection_pool pool(trip.handler(), options);
+    trip.pool = &pool;
+    MW_CHECK(pool.start());
+
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(free_port());
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    std::atomic<int> error { 0 };
+    pool.checkout(reinterpret_cast<sockaddr*>(&address), sizeof(address), [&](mw::net::tcp_connection*, int code) { error = code; });
+    MW_CHECK(wait_until([&] { return error.load() != 0; }));
+    MW_CHECK(error.load() == WSAECONNREFUSED);
+    MW_CHECK(pool.health(reinterpret_cast<sockaddr*>(&address), sizeof(address)) == mw::net::endpoint_health::down);
+
+    // 不可用的端点保留到退避结束后才被删除
+    MW_CHECK(pool.stats().endpoints == 1);
+    MW_CHECK(wait_until([&] { return pool.stats().endpoints == 0; }));
+    pool.stop();
+}
+
+} // namespace
+
+int main()
+{
+    test_checkout_and_release();
+    test_dead_connections_evicted();
+    test_stop_fails_handoff();
+    test_refused_endpoint();
+    return mw_test::finish("connection_pool_test");
+}
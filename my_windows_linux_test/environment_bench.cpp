@@ -0,0 +1,81 @@
+#include "mw_environment.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+// environment_snapshot在启动路径上的开销，对应example_3_23在Linux上的部分：构造快照，getenv加复制与快照查找，
+// 每次重新读取/proc/self/cmdline与快照中的参数，每种取多轮中最快的一轮。
+// 快照查找不快于getenv加复制，或者读取参数不快于重新读取/proc/self/cmdline时返回1
+
+namespace {
+
+constexpr int rounds = 7;
+constexpr int iterations = 200000;
+
+volatile std::size_t sink = 0;
+
+template <typename Call>
+double measure(int count, Call&& call)
+{
+    double best = 1e30;
+    for (int round = 0; round < rounds; round++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < count; i++)
+            call();
+        auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / count;
+        best = elapsed < best ? elapsed : best;
+    }
+    return best;
+}
+
+std::size_t read_cmdline()
+{
+    std::size_t count = 0;
+    if (auto file = std::fopen("/proc/self/cmdline", "rb"))
+    {
+        char chunk[4096];
+        for (std::size_t read; (read = std::fread(chunk, 1, sizeof(chunk), file)) > 0;)
+            count += read;
+        std::fclose(file);
+    }
+    return count;
+}
+
+} // namespace
+
+int main()
+{
+    // 保证PATH存在，使两种查找找到同一个值
+    if (!std::getenv("PATH"))
+        setenv("PATH", "/usr/local/bin:/usr/bin:/bin", 1);
+
+    auto build = measure(1000, [] {
+        mw::environment_snapshot::invalidate();
+        sink = sink + mw::environment_snapshot::current()->variables().size();
+    });
+
+    std::string value;
+    auto getenv_copy = measure(iterations, [&] {
+        value.assign(std::getenv("PATH"));
+        sink = sink + value.size();
+    });
+    auto snapshot = mw::environment_snapshot::current();
+    auto snapshot_get = measure(iterations, [&] { sink = sink + snapshot->get_or("PATH").size(); });
+    auto current_get = measure(iterations, [] { sink = sink + mw::environment_snapshot::current()->get_or("PATH").size(); });
+
+    auto cmdline = measure(iterations / 20, [] { sink = sink + read_cmdline(); });
+    auto arguments = measure(iterations, [&] { sink = sink + snapshot->arguments()[0].size(); });
+
+    std::string expanded;
+    auto expand = measure(iterations, [&] {
+        snapshot->expand("%HOME%/bin:%PATH%", expanded);
+        sink = sink + expanded.size();
+    });
+
+    std::printf("environment_bench: build %.0f ns, getenv+copy %.1f ns, snapshot get %.1f ns, current()->get %.1f ns, "
+                "/proc/self/cmdline %.0f ns, arguments %.1f ns, expand %.1f ns\n",
+        build, getenv_copy, snapshot_get, current_get, cmdline, arguments, expand);
+    return snapshot_get < getenv_copy && arguments < cmdline ? 0 : 1;
+}
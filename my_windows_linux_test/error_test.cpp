@@ -0,0 +1,152 @@
+#include "linux_test.h"
+#include "mw_error.h"
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+// mw_error.h在Linux上的测试：错误代码文本的表，截断，缓存，各个错误处理策略和失败谓词
+
+namespace {
+
+/// <summary>
+/// 模拟一个wrapper，失败时设置错误代码并返回FALSE
+/// </summary>
+template <typename Policy = MY_WINDOWS_ERROR_POLICY>
+auto fake_wrapper(bool succeed, DWORD error_code, Policy = Policy())
+{
+    BOOL value = succeed ? TRUE : FALSE;
+    if (!succeed)
+        SetLastError(error_code);
+    return Policy::apply(value, mw::error::is_false, "fake_wrapper");
+}
+
+void test_format()
+{
+    char buffer[MW_MAX_TEXT];
+    auto length = mw::error::format_error_into(5, buffer);
+    MW_CHECK(std::string(buffer) == "Access is denied.");
+    MW_CHECK(length == std::strlen(buffer));
+
+    mw::error::format_error_into(10054, buffer);
+    MW_CHECK(std::string(buffer) == "An existing connection was forcibly closed by the remote host.");
+
+    mw::error::format_error_into(123456, buffer);
+    MW_CHECK(std::string(buffer) == "Unknown error 123456");
+
+    mw::error::format_errno_into(ECONNRESET, buffer);
+    MW_CHECK(std::string(buffer) == "Connection reset");
+    mw::error::format_errno_into(9999, buffer);
+    MW_CHECK(std::string(buffer) == "Unknown error 9999");
+
+    // 截断时总是以0结尾
+    char small[8];
+    length = mw::error::format_error_into(5, small);
+    MW_CHECK(length == 7 && std::string(small) == "Access ");
+    char tiny[1] = { 'x' };
+    MW_CHECK(mw::error::format_error_into(5, tiny, 1) == 0 && tiny[0] == 0);
+    MW_CHECK(mw::error::format_error_into(5, tiny, 0) == 0);
+    length = mw::error::format_error_into(4294967295u, small);
+    MW_CHECK(length == 7 && std::string(small) == "Unknown");
+}
+
+void test_cache()
+{
+    MW_CHECK(mw::error::message_cache::find(10061) == nullptr);
+    auto text = mw::error::error_message(10061);
+    MW_CHECK(text.view() == "No connection could be made because the target machine actively refused it.");
+    // 第二次获取返回同一个驻留的字符串
+    MW_CHECK(mw::error::error_message(10061).get() == text.get());
+    MW_CHECK(mw::error::message_cache::find(10061) == text.get());
+    MW_CHECK(mw::formate_error_code(10061) == text.to_string());
+
+    // 多个线程同时获取同一批代码，每个代码只有一份文本
+    std::vector<std::thread> threads;
+    std::vector<std::vector<PCTSTR>> seen(4);
+    for (size_t t = 0; t < seen.size(); t++)
+    {
+        threads.emplace_back([&seen, t] {
+            for (DWORD code = 20000; code < 20100; code++)
+                seen[t].push_back(mw::error::error_message(code).get());
+        });
+    }
+    for (auto& thread : threads)
+        thread.join();
+    for (size_t t = 1; t < seen.size(); t++)
+        MW_CHECK(seen[t] == seen[0]);
+    MW_CHECK(std::string(seen[0][5]) == "Unknown error 20005");
+}
+
+void test_policies()
+{
+    MW_CHECK(fake_wrapper(true, 0, mw::error::ignore) == TRUE);
+    MW_CHECK(fake_wrapper(false, 5, mw::error::ignore) == FALSE);
+
+    auto success = fake_wrapper(true, 0, mw::error::expected);
+    MW_CHECK(success.has_value() && success.value() == TRUE && success.error() == ERROR_SUCCESS);
+    auto failure = fake_wrapper(false, 87, mw::error::expected);
+    MW_CHECK(!failure && failure.value() == FALSE && failure.error() == 87);
+    MW_CHECK(failure.value_or(7) == 7);
+
+    auto before = mw::error::error_log::total();
+    fake_wrapper(false, 1460, mw::error::logging);
+    fake_wrapper(true, 0, mw::error::logging);
+    MW_CHECK(mw::error::error_log::total() == before + 1);
+    mw::error::error_record records[4];
+    MW_CHECK(mw::error::error_log::recent(records, 4) >= 1);
+    MW_CHECK(records[0].code == 1460 && std::strcmp(records[0].where, "fake_wrapper") == 0);
+    MW_CHECK(records[0].thread_id == GetCurrentThreadId());
+
+    bool thrown = false;
+    try
+    {
+        fake_wrapper(false, EACCES, mw::error::throwing);
+    }
+    catch (const std::system_error& error)
+    {
+        thrown = error.code().value() == EACCES;
+    }
+    MW_CHECK(thrown);
+
+    // 默认策略原样返回值
+    MW_CHECK(fake_wrapper(false, 5) == FALSE);
+}
+
+void test_predicates()
+{
+    // 返回NULL，0或非0错误代码的wrapper使用的谓词
+    int object = 0;
+    SetLastError(8);
+    auto null_result = mw::error::expected_policy::apply(static_cast<void*>(nullptr), mw::error::is_null, "null");
+    MW_CHECK(!null_result && null_result.error() == 8);
+    MW_CHECK(mw::error::expected_policy::apply(static_cast<void*>(&object), mw::error::is_null, "null").has_value());
+    MW_CHECK(!mw::error::expected_policy::apply(static_cast<SIZE_T>(0), mw::error::is_zero, "zero"));
+    MW_CHECK(mw::error::expected_policy::apply(static_cast<SIZE_T>(48), mw::error::is_zero, "zero").value() == 48);
+    MW_CHECK(!mw::error::expected_policy::apply(static_cast<INT>(11001), mw::error::is_nonzero, "nonzero"));
+    MW_CHECK(mw::error::expected_policy::apply(static_cast<INT>(0), mw::error::is_nonzero, "nonzero").has_value());
+}
+
+void test_error_log_wraps()
+{
+    // 写入超过容量的记录后只保留最新的capacity条，从新到旧排列
+    for (DWORD i = 0; i < mw::error::error_log::capacity + 10; i++)
+        mw::error::error_log::push(30000 + i, "wrap");
+    std::vector<mw::error::error_record> records(mw::error::error_log::capacity + 10);
+    auto count = mw::error::error_log::recent(records.data(), records.size());
+    MW_CHECK(count <= mw::error::error_log::capacity);
+    MW_CHECK(count && records[0].code == 30000 + mw::error::error_log::capacity + 9);
+    for (size_t i = 1; i < count; i++)
+        MW_CHECK(records[i].code + 1 == records[i - 1].code);
+}
+
+} // namespace
+
+int main()
+{
+    test_format();
+    test_cache();
+    test_policies();
+    test_predicates();
+    test_error_log_wraps();
+    return mw_test::finish("error_test");
+}
@@ -0,0 +1,207 @@
+#include "mw_framing.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+// mw_framing.h的解码器的模糊测试目标。输入的第一个字节选择编解码器和参数，第二个字节决定把其余数据切成多大的段，
+// 同一份数据分别作为一个byte_span和一个逐段追加的buffer_chain解码，两者的结果必须完全相同，帧必须在数据范围内，
+// 长度前缀帧重新编码后必须解码出相同的负载。
+//   clang++ -std=c++17 -fsanitize=fuzzer,address -DMW_LIBFUZZER -I../my_windows framing_fuzz.cpp    使用libFuzzer
+//   build/framing_fuzz [次数] [文件...]    不使用libFuzzer：先检查回归输入和给出的文件，再解码指定次数的随机输入
+
+namespace {
+
+void expect(bool condition, const char* message)
+{
+    if (condition)
+        return;
+    std::fprintf(stderr, "framing_fuzz: %s\n", message);
+    std::abort();
+}
+
+/// <summary>
+/// 解码出的所有帧和最后的状态
+/// </summary>
+struct outcome
+{
+    std::vector<std::string> payloads;
+    std::vector<size_t> frame_sizes;
+    mw::net::decode_status last = mw::net::decode_status::need_more;
+};
+
+template <typename codec_type, typename source_type>
+void decode_all(codec_type& codec, source_type& source, outcome& result)
+{
+    mw::net::basic_decoded_frame<source_type> frame;
+    while ((result.last = codec.decode(source, frame)) == mw::net::decode_status::frame)
+    {
+        expect(frame.frame_size > 0, "帧没有消费任何数据");
+        expect(frame.frame_size <= source.size(), "帧超出数据");
+        expect(frame.payload.offset + frame.payload.size <= frame.frame_size, "负载超出帧");
+        expect(frame.payload.size <= codec.get_max_frame_size(), "负载超过最大长度");
+        std::string payload(frame.payload.size, '\0');
+        expect(frame.payload.copy_to(payload.data(), payload.size()) == payload.size(), "负载复制不完整");
+        result.payloads.push_back(std::move(payload));
+        result.frame_sizes.push_back(frame.frame_size);
+        source.consume(frame.frame_size);
+    }
+}
+
+template <typename factory_type>
+void compare(factory_type make_codec, const char* data, size_t size, size_t piece_size)
+{
+    auto span_codec = make_codec();
+    mw::net::byte_span span(data, size);
+    outcome from_span;
+    decode_all(span_codec, span, from_span);
+
+    // 每追加一段解码一次，模拟多次接收，也检验delimiter_codec从上次扫描结束的位置继续
+    auto chain_codec = make_codec();
+    mw::net::buffer_chain chain;
+    outcome from_chain;
+    decode_all(chain_codec, chain, from_chain);
+    for (size_t offset = 0; offset < size && from_chain.last != mw::net::decode_status::error; offset += piece_size)
+    {
+        chain.append(data + offset, (std::min)(piece_size, size - offset));
+        decode_all(chain_codec, chain, from_chain);
+    }
+
+    expect(from_span.payloads == from_chain.payloads, "分段解码的负载不同");
+    expect(from_span.frame_sizes == from_chain.frame_sizes, "分段解码的帧大小不同");
+    expect(from_span.last == from_chain.last, "分段解码的状态不同");
+
+    // 长度前缀帧重新编码后解码出相同的负载(输入中的变长整数可能不是最短编码，所以不比较字节)
+    auto codec = make_codec();
+    for (auto& payload : from_span.payloads)
+    {
+        char header[mw::net::length_prefix_codec::max_header_size];
+        auto header_size = codec.encode_header(payload.size(), header);
+        if (!header_size)
+            continue;
+        auto encoded = std::string(header, header_size) + payload;
+        mw::net::byte_span source(encoded.data(), encoded.size());
+        mw::net::basic_decoded_frame<mw::net::byte_span> frame;
+        expect(codec.decode(source, frame) == mw::net::decode_status::frame && frame.frame_size == encoded.size()
+                && frame.payload.size == payload.size(),
+            "重新编码的帧解码结果不同");
+    }
+}
+
+void run_one(const std::uint8_t* input, size_t size)
+{
+    if (size < 2)
+        return;
+    auto selector = input[0];
+    auto piece_size = static_cast<size_t>(input[1] % 16) + 1;
+    auto data = reinterpret_cast<const char*>(input + 2);
+    size -= 2;
+
+    // 较小的最大长度使超长帧的错误路径也能被覆盖
+    size_t max_frame_size = (selector & 0x80) ? SIZE_MAX : 64;
+    switch (selector % 7)
+    {
+    case 0:
+    case 1:
+    case 2:
+    case 3:
+    case 4:
+    {
+        auto format = static_cast<mw::net::length_prefix>(selector % 7);
+        compare([&] { return mw::net::length_prefix_codec(format, max_frame_size); }, data, size, piece_size);
+        break;
+    }
+    case 5:
+    {
+        static const char* const delimiters[] = { "\r\n", "\n", "abab", "\r\n\r\n" };
+        std::string_view delimiter = delimiters[(selector >> 3) % 4];
+        compare([&] { return mw::net::delimiter_codec(delimiter, max_frame_size); }, data, size, piece_size);
+        break;
+    }
+    default:
+    {
+        size_t record_size = ((selector >> 3) % 8) + 1;
+        compare([&] { return mw::net::fixed_size_codec(record_size); }, data, size, piece_size);
+        break;
+    }
+    }
+}
+
+} // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t* data, size_t size)
+{
+    run_one(data, size);
+    return 0;
+}
+
+#ifndef MW_LIBFUZZER
+namespace {
+
+/// <summary>
+/// 变长整数的第10个字节大于1时，值超出64位，必须返回error而不是截断后的长度
+/// </summary>
+void check_regressions()
+{
+    mw::net::length_prefix_codec codec(mw::net::length_prefix::varint, SIZE_MAX);
+    mw::net::basic_decoded_frame<mw::net::byte_span> frame;
+    const unsigned char overflow[] = { 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x02 };
+    mw::net::byte_span source(reinterpret_cast<const char*>(overflow), sizeof(overflow));
+    expect(codec.decode(source, frame) == mw::net::decode_status::error, "第10个字节为2的变长整数没有被拒绝");
+
+    const unsigned char continued[] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x81, 0x00 };
+    source = mw::net::byte_span(reinterpret_cast<const char*>(continued), sizeof(continued));
+    expect(codec.decode(source, frame) == mw::net::decode_status::error, "第10个字节有继续位的变长整数没有被拒绝");
+
+    // 2^63是最大的10字节值，长度合法，只是数据不够
+    const unsigned char largest[] = { 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x01 };
+    source = mw::net::byte_span(reinterpret_cast<const char*>(largest), sizeof(largest));
+    expect(codec.decode(source, frame) == mw::net::decode_status::need_more, "2^63的变长整数被拒绝");
+
+    // 同样的输入经过fuzz入口(选择器0为varint，最大长度不限)
+    std::vector<std::uint8_t> input = { 0x80, 0 };
+    input.insert(input.end(), overflow, overflow + sizeof(overflow));
+    run_one(input.data(), input.size());
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    check_regressions();
+
+    size_t iterations = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200000;
+    for (int i = 2; i < argc; i++)
+    {
+        std::ifstream file(argv[i], std::ios::binary);
+        std::vector<std::uint8_t> input((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        run_one(input.data(), input.size());
+    }
+
+    // 随机输入偏向对解码器有意义的字节，使长度前缀，分隔符和继续位经常出现
+    static const std::uint8_t interesting[] = { 0x00, 0x01, 0x02, 0x7F, 0x80, 0x81, 0xFF, '\r', '\n', 'a', 'b' };
+    std::uint64_t state = 0x9E3779B97F4A7C15ULL;
+    auto next = [&] {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    };
+    std::vector<std::uint8_t> input;
+    for (size_t i = 0; i < iterations; i++)
+    {
+        input.resize(next() % 96);
+        for (auto& byte : input)
+        {
+            auto value = next();
+            byte = (value & 3) ? interesting[(value >> 2) % sizeof(interesting)] : static_cast<std::uint8_t>(value >> 8);
+        }
+        run_one(input.data(), input.size());
+    }
+    std::printf("framing_fuzz: 通过(%zu个随机输入)\n", iterations);
+    return 0;
+}
+#endif
@@ -0,0 +1,134 @@
+#include "linux_test.h"
+#include "mw_handle.h"
+#include <fcntl.h>
+#include <type_traits>
+#include <unistd.h>
+#include <utility>
+
+// mw_handle.h的unique_fd的测试：移动构造和移动赋值转移所有权并关闭被覆盖的描述符，release，reset，put和swap，
+// 用fcntl(fd, F_GETFD)检查描述符是否仍然打开
+
+static_assert(sizeof(mw::unique_fd) == sizeof(int));
+static_assert(!std::is_copy_constructible_v<mw::unique_fd> && !std::is_copy_assignable_v<mw::unique_fd>);
+static_assert(std::is_nothrow_move_constructible_v<mw::unique_fd> && std::is_nothrow_move_assignable_v<mw::unique_fd>);
+
+namespace {
+
+bool is_open(int fd)
+{
+    return fcntl(fd, F_GETFD) != -1;
+}
+
+int open_null()
+{
+    return ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+}
+
+/// <summary>
+/// 以输出参数返回描述符的函数，与put配合使用
+/// </summary>
+bool open_null_into(int* fd)
+{
+    *fd = open_null();
+    return *fd != -1;
+}
+
+void test_construct_and_destroy()
+{
+    mw::unique_fd empty;
+    MW_CHECK(!empty && !empty.valid() && empty.get() == -1);
+
+    int raw = open_null();
+    MW_CHECK(raw != -1);
+    {
+        mw::unique_fd owner(raw);
+        MW_CHECK(owner && owner.get() == raw && is_open(raw));
+    }
+    // 析构时关闭
+    MW_CHECK(!is_open(raw));
+}
+
+void test_move()
+{
+    int first = open_null();
+    int second = open_null();
+    mw::unique_fd a(first);
+
+    // 移动构造：所有权转移，描述符仍然打开，源对象变为无效
+    mw::unique_fd b(std::move(a));
+    MW_CHECK(!a && a.get() == -1);
+    MW_CHECK(b.get() == first && is_open(first));
+
+    // 移动赋值：目标原来的描述符被关闭
+    mw::unique_fd c(second);
+    c = std::move(b);
+    MW_CHECK(!is_open(second));
+    MW_CHECK(!b && c.get() == first && is_open(first));
+
+    // 赋值给无效的对象，以及从无效的对象赋值(关闭目标，不关闭任何其他描述符)
+    mw::unique_fd d;
+    d = std::move(c);
+    MW_CHECK(d.get() == first && is_open(first) && !c);
+    d = std::move(c);
+    MW_CHECK(!d && !is_open(first));
+
+    // 自赋值不关闭描述符
+    mw::unique_fd e(open_null());
+    auto raw = e.get();
+    auto& alias = e;
+    e = std::move(alias);
+    MW_CHECK(e.get() == raw && is_open(raw));
+}
+
+void test_release_reset_put()
+{
+    // release：放弃所有权，对象析构时不关闭
+    int raw = open_null();
+    {
+        mw::unique_fd owner(raw);
+        MW_CHECK(owner.release() == raw);
+        MW_CHECK(!owner && owner.release() == -1);
+    }
+    MW_CHECK(is_open(raw));
+    ::close(raw);
+
+    // reset：关闭旧的描述符并接管新的，无参数时只关闭
+    int first = open_null();
+    int second = open_null();
+    mw::unique_fd owner(first);
+    owner.reset(second);
+    MW_CHECK(!is_open(first) && is_open(second) && owner.get() == second);
+    owner.reset();
+    MW_CHECK(!is_open(second) && !owner);
+    owner.reset();
+    MW_CHECK(!owner);
+
+    // put：先关闭当前的描述符，返回的地址中是无效值，函数把新的描述符写入对象。
+    // 新打开的描述符可能复用刚关闭的编号，所以在写入之前检查旧的描述符已经关闭
+    int old = open_null();
+    owner.reset(old);
+    auto slot = owner.put();
+    MW_CHECK(*slot == -1 && !owner && !is_open(old));
+    MW_CHECK(open_null_into(slot));
+    MW_CHECK(owner && owner.get() == *slot && is_open(owner.get()));
+    auto replaced = owner.get();
+    slot = owner.put();
+    MW_CHECK(*slot == -1 && !is_open(replaced));
+    MW_CHECK(open_null_into(slot) && is_open(owner.get()));
+
+    // swap：交换所有权，不关闭任何描述符
+    mw::unique_fd other(open_null());
+    auto mine = owner.get(), theirs = other.get();
+    owner.swap(other);
+    MW_CHECK(owner.get() == theirs && other.get() == mine && is_open(mine) && is_open(theirs));
+}
+
+} // namespace
+
+int main()
+{
+    test_construct_and_destroy();
+    test_move();
+    test_release_reset_put();
+    return mw_test::finish("handle_test");
+}
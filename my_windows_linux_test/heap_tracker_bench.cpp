@@ -0,0 +1,157 @@
+#include "mw_heap_tracker.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <vector>
+
+// heap_tracker在默认配置(start()，default_sample_interval)下的开销，对象是一个只做malloc/free的循环，它是最坏的情况。
+// 分别运行整个循环时，追踪和不追踪的两次运行之间的差值在共享的机器上波动很大(两次都不追踪的运行之间也能差9%)，
+// 所以在同一个循环中交替运行追踪和不追踪的块，两者各自使用一组槽，分别累计线程的CPU时间，使频率变化，抢占和堆状态的漂移对两者的影响相同。
+// 默认配置和几乎不采样(每次调用的固定开销)各运行多轮，与trace_bench一样每种模式取最快的一轮，默认配置的开销超过2%时返回1
+
+namespace {
+
+constexpr int rounds = 7;
+constexpr int passes = 3;
+constexpr size_t operations = 2000000;
+constexpr size_t live_slots = 4096;
+constexpr size_t block_size = 4096;
+constexpr SIZE_T sparse_interval = SIZE_T(1) << 40;
+constexpr double overhead_bound = 2.0;
+
+/// <summary>
+/// 16到4096字节之间的伪随机大小，与常见的小对象分配相似
+/// </summary>
+std::vector<size_t> make_sizes()
+{
+    std::vector<size_t> sizes(operations);
+    std::uint64_t state = 0x9E3779B97F4A7C15ULL;
+    for (auto& size : sizes)
+    {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        size = 16 + (state % 4081);
+    }
+    return sizes;
+}
+
+/// <summary>
+/// 线程的CPU时间(纳秒)，不包括线程被其他进程抢占的时间，共享的机器上它比墙上时间稳定得多
+/// </summary>
+double thread_time()
+{
+    timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return static_cast<double>(now.tv_sec) * 1e9 + static_cast<double>(now.tv_nsec);
+}
+
+/// <summary>
+/// 运行一个块。追踪和不追踪使用同一个函数，两者的代码布局相同(分别实例化的两个函数之间仅因对齐就能相差几个百分点)。
+/// 与heap_alloc中一样，通知追踪器时大小和地址都已经在寄存器中
+/// </summary>
+[[gnu::noinline]] double run_block(bool track, std::vector<void*>& slots, const std::vector<size_t>& sizes, size_t begin)
+{
+    auto start = thread_time();
+    for (size_t i = begin; i < begin + block_size; i++)
+    {
+        auto& slot = slots[i % live_slots];
+        if (slot)
+        {
+            if (track)
+                mw::heap_tracker::on_free(slot);
+            std::free(slot);
+        }
+        auto size = sizes[i];
+        auto block = std::malloc(size);
+        static_cast<char*>(block)[0] = 1;
+        if (track)
+            mw::heap_tracker::on_alloc(block, size);
+        slot = block;
+    }
+    return thread_time() - start;
+}
+
+/// <summary>
+/// 一轮中追踪和不追踪时每次malloc+free的平均时间(纳秒)
+/// </summary>
+struct timing
+{
+    double tracked;
+    double untracked;
+};
+
+/// <summary>
+/// 以指定采样间隔交替运行追踪和不追踪的块
+/// </summary>
+timing run_round(const std::vector<size_t>& sizes, SIZE_T interval)
+{
+    std::vector<void*> tracked_slots(live_slots, nullptr), untracked_slots(live_slots, nullptr);
+    double tracked = 0, untracked = 0;
+    mw::heap_tracker::start(interval);
+    for (int pass = 0; pass < passes; pass++)
+    {
+        for (size_t block = 0; block < sizes.size() / block_size; block++)
+        {
+            // 每一遍交换先后顺序
+            if ((block + pass) & 1)
+                tracked += run_block(true, tracked_slots, sizes, block * block_size);
+            else
+                untracked += run_block(false, untracked_slots, sizes, block * block_size);
+        }
+    }
+    for (auto slot : tracked_slots)
+    {
+        mw::heap_tracker::on_free(slot);
+        std::free(slot);
+    }
+    for (auto slot : untracked_slots)
+        std::free(slot);
+    mw::heap_tracker::stop();
+    auto operations_per_mode = static_cast<double>(passes) * (sizes.size() / block_size / 2) * block_size;
+    return { tracked / operations_per_mode, untracked / operations_per_mode };
+}
+
+/// <summary>
+/// 两种模式各取多轮中最快的一轮，返回追踪的开销(百分比)。每一轮的采样次数相近，最快的一轮仍然包含采样的开销
+/// </summary>
+double overhead(const std::vector<timing>& timings, double& untracked_ns)
+{
+    double tracked = 1e30;
+    untracked_ns = 1e30;
+    for (auto& item : timings)
+    {
+        tracked = (std::min)(tracked, item.tracked);
+        untracked_ns = (std::min)(untracked_ns, item.untracked);
+    }
+    return (tracked - untracked_ns) / untracked_ns * 100.0;
+}
+
+} // namespace
+
+int main()
+{
+    auto sizes = make_sizes();
+    std::vector<timing> sparse, sampled;
+    for (int round = 0; round < rounds; round++)
+    {
+        sparse.push_back(run_round(sizes, sparse_interval));
+        sampled.push_back(run_round(sizes, mw::heap_tracker::default_sample_interval));
+    }
+
+    size_t sites = 0;
+    ULONGLONG samples = 0;
+    mw::heap_tracker::for_each_site([&](const mw::heap_site_stats& stats) {
+        sites++;
+        samples += stats.sampled_count;
+    });
+    double untracked_ns = 0;
+    auto call_overhead = overhead(sparse, untracked_ns);
+    auto default_overhead = overhead(sampled, untracked_ns);
+    std::printf("heap_tracker_bench: malloc+free %.1f ns, per-call overhead %.2f%%, default %zuMB interval overhead %.2f%% "
+                "(bound %.0f%%, %llu samples in %zu sites)\n",
+        untracked_ns, call_overhead, static_cast<size_t>(mw::heap_tracker::default_sample_interval >> 20), default_overhead,
+        overhead_bound, static_cast<unsigned long long>(samples), sites);
+    return default_overhead < overhead_bound && sites > 0 ? 0 : 1;
+}
@@ -0,0 +1,127 @@
+#include "linux_test.h"
+#include "mw_heap_tracker.h"
+#include <cstdlib>
+#include <vector>
+
+// mw_heap_tracker.h在Linux上的测试：采样，释放，重新start后不沿用上一个会话的倒计数，重新分配成功和失败时存活记录的变化
+
+namespace {
+
+size_t live_count()
+{
+    size_t count = 0;
+    mw::heap_tracker::for_each_live([&](void*, SIZE_T, ULONG) { count++; });
+    return count;
+}
+
+ULONGLONG site_live_bytes()
+{
+    ULONGLONG bytes = 0;
+    mw::heap_tracker::for_each_site([&](const mw::heap_site_stats& stats) { bytes += stats.live_bytes; });
+    return bytes;
+}
+
+void test_alloc_free()
+{
+    // 采样间隔为1字节时每次分配都被采样
+    mw::heap_tracker::start(1);
+    std::vector<void*> blocks;
+    for (int i = 0; i < 100; i++)
+    {
+        blocks.push_back(std::malloc(64));
+        mw::heap_tracker::on_alloc(blocks.back(), 64);
+    }
+    MW_CHECK(live_count() == 100);
+    MW_CHECK(site_live_bytes() >= 100 * 64);
+    // 失败的分配不会被采样
+    mw::heap_tracker::on_alloc(nullptr, 64);
+    MW_CHECK(live_count() == 100);
+    for (auto block : blocks)
+    {
+        mw::heap_tracker::on_free(block);
+        std::free(block);
+    }
+    MW_CHECK(live_count() == 0 && site_live_bytes() == 0);
+    // 未被采样的地址直接忽略
+    int local = 0;
+    mw::heap_tracker::on_free(&local);
+    mw::heap_tracker::on_free(nullptr);
+    mw::heap_tracker::stop();
+}
+
+void test_restart()
+{
+    // 大间隔的会话留下的线程局部倒计数不会延续到下一次start，新会话的第一次分配就按新的间隔采样
+    mw::heap_tracker::start(SIZE_T(1) << 40);
+    auto first = std::malloc(64);
+    mw::heap_tracker::on_alloc(first, 64);
+    MW_CHECK(live_count() == 0);
+    mw::heap_tracker::stop();
+    // 停止后的分配不会被采样
+    mw::heap_tracker::on_alloc(first, 64);
+    MW_CHECK(live_count() == 0);
+
+    mw::heap_tracker::start(1);
+    auto second = std::malloc(64);
+    mw::heap_tracker::on_alloc(second, 64);
+    MW_CHECK(live_count() == 1);
+    mw::heap_tracker::on_free(second);
+    std::free(second);
+    mw::heap_tracker::on_free(first);
+    std::free(first);
+    MW_CHECK(live_count() == 0);
+    mw::heap_tracker::stop();
+}
+
+void test_realloc()
+{
+    mw::heap_tracker::start(1);
+    auto block = std::malloc(128);
+    mw::heap_tracker::on_alloc(block, 128);
+    auto bytes = site_live_bytes();
+    MW_CHECK(live_count() == 1 && bytes > 0);
+
+    // 重新分配失败：旧内存块仍然有效，记录被原样恢复
+    auto record = mw::heap_tracker::on_realloc_begin(block);
+    MW_CHECK(record.sampled && record.size == 128);
+    MW_CHECK(live_count() == 0);
+    mw::heap_tracker::on_realloc_end(block, record, nullptr, 1 << 20);
+    MW_CHECK(live_count() == 1 && site_live_bytes() == bytes);
+    SIZE_T size = 0;
+    mw::heap_tracker::for_each_live([&](void* address, SIZE_T live_size, ULONG) {
+        if (address == block)
+            size = live_size;
+    });
+    MW_CHECK(size == 128);
+
+    // 重新分配成功：旧记录被删除，新内存块被采样
+    // 模拟移动到新位置的重新分配，旧内存块在通知完成后才释放
+    record = mw::heap_tracker::on_realloc_begin(block);
+    auto moved = std::malloc(4096);
+    mw::heap_tracker::on_realloc_end(block, record, moved, 4096);
+    std::free(block);
+    MW_CHECK(live_count() == 1);
+    mw::heap_tracker::for_each_live([&](void* address, SIZE_T live_size, ULONG) {
+        MW_CHECK(address == moved && live_size == 4096);
+    });
+    mw::heap_tracker::on_free(moved);
+    std::free(moved);
+
+    // 未被采样的内存块重新分配失败时不会产生记录
+    record = mw::heap_tracker::on_realloc_begin(&size);
+    MW_CHECK(!record.sampled);
+    mw::heap_tracker::on_realloc_end(&size, record, nullptr, 16);
+    MW_CHECK(live_count() == 0);
+    mw::heap_tracker::stop();
+}
+
+} // namespace
+
+int main()
+{
+    test_alloc_free();
+    test_restart();
+    test_realloc();
+    MW_CHECK(mw::heap_tracker::dropped_samples() == 0);
+    return mw_test::finish("heap_tracker_test");
+}
@@ -0,0 +1,264 @@
+#include "mw_http.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+// mw_http.h的http_parser的模糊测试目标。输入的第一个字节选择解析器的限制，第二个字节决定把其余数据切成多大的段，
+// 同一份数据分别一次解析和逐段接收后解析(每次接收后数据被复制到新的缓冲区，像接收缓冲区被移动一样)，两者的结果必须完全相同，
+// 解析出的字符串必须在数据范围内，请求体不超过max_body_size，请求重新序列化后必须解析出相同的请求。
+//   clang++ -std=c++17 -fsanitize=fuzzer,address -DMW_LIBFUZZER -I../my_windows http_fuzz.cpp    使用libFuzzer
+//   build/http_fuzz [次数] [文件...]    不使用libFuzzer：先检查回归输入和给出的文件，再解析指定次数的随机输入
+
+namespace {
+
+void expect(bool condition, const char* message)
+{
+    if (condition)
+        return;
+    std::fprintf(stderr, "http_fuzz: %s\n", message);
+    std::abort();
+}
+
+/// <summary>
+/// 一个请求中参与比较的部分
+/// </summary>
+struct parsed
+{
+    std::string method;
+    std::string target;
+    std::vector<std::string> headers;
+    std::string body;
+    int version_minor;
+    bool keep_alive;
+    size_t size;
+
+    bool operator==(const parsed& other) const
+    {
+        return method == other.method && target == other.target && headers == other.headers && body == other.body
+            && version_minor == other.version_minor && keep_alive == other.keep_alive && size == other.size;
+    }
+};
+
+/// <summary>
+/// 解析出的所有请求和最后的状态
+/// </summary>
+struct outcome
+{
+    std::vector<parsed> requests;
+    /// <summary>最后一次parse的错误状态码，数据不完整时为0</summary>
+    int error_status = 0;
+    size_t consumed = 0;
+};
+
+bool inside(std::string_view text, const char* data, size_t size)
+{
+    return text.empty() || (text.data() >= data && text.data() + text.size() <= data + size);
+}
+
+parsed check_and_copy(const mw::net::http_request& request, const char* data, size_t size, const mw::net::http_parser_options& options)
+{
+    expect(request.size > 0 && request.size <= size, "请求超出数据");
+    expect(request.body.size() <= options.max_body_size, "请求体超过max_body_size");
+    expect(request.header_count <= mw::net::http_request::max_headers, "头部数量超过上限");
+    expect(!request.method.empty() && !request.target.empty(), "方法或目标为空");
+    expect(inside(request.method, data, request.size) && inside(request.target, data, request.size)
+            && inside(request.body, data, request.size),
+        "字符串不在请求中");
+    expect(request.body.empty() || request.body.data() + request.body.size() == data + request.size, "请求体不在请求末尾");
+    parsed result { std::string(request.method), std::string(request.target), {}, std::string(request.body), request.version_minor,
+        request.keep_alive, request.size };
+    for (size_t i = 0; i < request.header_count; i++)
+    {
+        auto& header = request.headers[i];
+        expect(inside(header.name, data, request.size) && inside(header.value, data, request.size), "头部不在请求中");
+        expect(!header.name.empty() && header.name.find_first_of(" \t\r\n:") == std::string_view::npos, "头部名字不合法");
+        expect(header.value.find_first_of("\r\n") == std::string_view::npos, "头部值包含换行");
+        result.headers.push_back(std::string(header.name) + ":" + std::string(header.value));
+    }
+    return result;
+}
+
+/// <summary>
+/// 从data开头解析所有完整的请求，直到数据不完整或出错
+/// </summary>
+void parse_available(mw::net::http_parser& parser, const std::string& data, const mw::net::http_parser_options& options, outcome& result)
+{
+    mw::net::http_request request;
+    while (result.consumed < data.size() && !result.error_status)
+    {
+        auto rest = data.data() + result.consumed;
+        auto size = data.size() - result.consumed;
+        auto status = parser.parse(rest, size, request);
+        if (status == mw::net::http_parse_result::incomplete)
+            break;
+        if (status == mw::net::http_parse_result::error)
+        {
+            result.error_status = parser.error_status();
+            expect(result.error_status >= 400 && result.error_status < 600, "错误状态码不合法");
+            break;
+        }
+        result.requests.push_back(check_and_copy(request, rest, size, options));
+        result.consumed += request.size;
+    }
+}
+
+/// <summary>
+/// 把请求重新序列化，它应该被解析为相同的请求
+/// </summary>
+void check_reserialized(const parsed& request, const mw::net::http_parser_options& options)
+{
+    std::string text = request.method + " " + request.target + " HTTP/1." + std::to_string(request.version_minor) + "\r\n";
+    for (auto& header : request.headers)
+        text += header + "\r\n";
+    text += "\r\n" + request.body;
+    mw::net::http_parser parser(options);
+    mw::net::http_request again;
+    expect(parser.parse(text.data(), text.size(), again) == mw::net::http_parse_result::complete, "重新序列化的请求解析失败");
+    auto copy = check_and_copy(again, text.data(), text.size(), options);
+    copy.size = request.size;
+    expect(copy == request, "重新序列化的请求解析结果不同");
+}
+
+void run_one(const std::uint8_t* input, size_t size)
+{
+    if (size < 2)
+        return;
+    auto selector = input[0];
+    auto piece_size = static_cast<size_t>(input[1] % 32) + 1;
+    std::string data(reinterpret_cast<const char*>(input + 2), size - 2);
+
+    // 较小的限制使413和431的路径也能被覆盖
+    mw::net::http_parser_options options;
+    if (selector & 1)
+        options.max_header_size = 64;
+    if (selector & 2)
+        options.max_body_size = 8;
+
+    mw::net::http_parser whole_parser(options);
+    outcome whole;
+    parse_available(whole_parser, data, options, whole);
+
+    mw::net::http_parser piece_parser(options);
+    outcome pieces;
+    std::string received;
+    for (size_t offset = 0; offset < data.size() && !pieces.error_status; offset += piece_size)
+    {
+        // 新的string使数据的地址改变，解析器不能保存指向旧数据的指针
+        std::string moved = received + data.substr(offset, piece_size);
+        received.swap(moved);
+        parse_available(piece_parser, received, options, pieces);
+    }
+
+    expect(whole.requests == pieces.requests, "分段解析的请求不同");
+    expect(whole.error_status == pieces.error_status, "分段解析的错误不同");
+    expect(whole.consumed == pieces.consumed, "分段解析消费的字节数不同");
+    for (auto& request : whole.requests)
+        check_reserialized(request, options);
+}
+
+} // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t* data, size_t size)
+{
+    run_one(data, size);
+    return 0;
+}
+
+#ifndef MW_LIBFUZZER
+namespace {
+
+void run_text(std::uint8_t selector, std::uint8_t piece, const std::string& text)
+{
+    std::vector<std::uint8_t> input = { selector, piece };
+    input.insert(input.end(), text.begin(), text.end());
+    run_one(input.data(), input.size());
+}
+
+/// <summary>
+/// 管线化的请求，请求之前的空行，以及在CR和LF之间切分的数据
+/// </summary>
+void check_regressions()
+{
+    const std::string pipelined = "\r\n\r\nGET / HTTP/1.1\r\nHost: h\r\n\r\nPOST /p HTTP/1.1\r\nHost: h\r\nContent-Length: 3\r\n\r\nabc"
+                                  "GET /q HTTP/1.0\r\nConnection: keep-alive\r\n\r\n";
+    for (std::uint8_t piece = 0; piece < 32; piece++)
+        run_text(0, piece, pipelined);
+
+    mw::net::http_parser parser;
+    mw::net::http_request request;
+    const std::string conflicting = "POST / HTTP/1.1\r\nHost: h\r\nContent-Length: 1\r\nContent-Length: 2\r\n\r\nab";
+    expect(parser.parse(conflicting.data(), conflicting.size(), request) == mw::net::http_parse_result::error
+            && parser.error_status() == 400,
+        "冲突的Content-Length没有被拒绝");
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    check_regressions();
+
+    size_t iterations = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200000;
+    for (int i = 2; i < argc; i++)
+    {
+        std::ifstream file(argv[i], std::ios::binary);
+        std::vector<std::uint8_t> input((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        run_one(input.data(), input.size());
+    }
+
+    // 随机输入由一到三个结构完整的请求拼成，再做几次插入片段，删除和替换字节的变异，
+    // 使完整的请求，管线化和各种对解析有影响的头部经常出现，同时也覆盖各种错误
+    static const char* const methods[] = { "GET", "POST", "HEAD", "PUT", "G(T" };
+    static const char* const targets[] = { "/", "/a?b=c", "/x/y", "*" };
+    static const char* const versions[] = { "HTTP/1.1", "HTTP/1.0", "HTTP/2.0", "HTTP/1.1 " };
+    static const char* const headers[] = {
+        "Host: h", "Content-Length: 3", "content-length:  3 ", "Content-Length: 12", "Content-Length: 0",
+        "Transfer-Encoding: chunked", "Connection: close", "Connection: keep-alive", "Connection: a, Close", "X-A:  v ",
+        " folded", "Bad Name: v", "Empty:",
+    };
+    static const char* const fragments[] = { "\r\n", "\n", "\r", ":", " ", "\r\n\r\n", "Content-Length: 9\r\n", "\t" };
+    std::uint64_t state = 0x9E3779B97F4A7C15ULL;
+    auto next = [&] {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    };
+    auto pick = [&](const auto& list) { return list[next() % (sizeof(list) / sizeof(list[0]))]; };
+    std::string text;
+    for (size_t i = 0; i < iterations; i++)
+    {
+        text.clear();
+        for (auto count = next() % 3 + 1; count > 0; count--)
+        {
+            text += next() % 4 ? "" : "\r\n";
+            text += std::string(pick(methods)) + " " + pick(targets) + " " + pick(versions) + "\r\n";
+            if (next() % 4)
+                text += "Host: h\r\n";
+            for (auto lines = next() % 4; lines > 0; lines--)
+                text += std::string(pick(headers)) + "\r\n";
+            text += "\r\n";
+            text += std::string(next() % 13, 'b');
+        }
+        for (auto mutations = next() % 4; mutations > 0 && !text.empty(); mutations--)
+        {
+            auto value = next();
+            auto position = (value >> 8) % text.size();
+            if ((value & 3) == 0)
+                text.insert(position, pick(fragments));
+            else if ((value & 3) == 1)
+                text.erase(position, 1);
+            else if ((value & 3) == 2)
+                text[position] = static_cast<char>(value >> 40);
+        }
+        auto selector = next();
+        run_text(static_cast<std::uint8_t>(selector), static_cast<std::uint8_t>(selector >> 8), text);
+    }
+    std::printf("http_fuzz: 通过(%zu个随机输入)\n", iterations);
+    return 0;
+}
+#endif
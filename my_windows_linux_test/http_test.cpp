@@ -0,0 +1,392 @@
+#include "linux_test.h"
+#include "mw_http.h"
+#include <arpa/inet.h>
+#include <chrono>
+#include <string>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// mw_http.h的测试：管线化的请求在每个字节处切分后逐次解析，重复和冲突的Content-Length，Transfer-Encoding的501，
+// HTTP/1.0的保持连接，HEAD，超过max_body_size的请求体；之后在回环上通过http_server(tcp_server的epoll后端)检查同样的情形
+
+namespace {
+
+/// <summary>
+/// 解析出的请求中测试关心的部分，复制出来以便在数据移动后比较
+/// </summary>
+struct parsed
+{
+    std::string method;
+    std::string target;
+    std::string body;
+    bool keep_alive;
+    size_t size;
+
+    bool operator==(const parsed& other) const
+    {
+        return method == other.method && target == other.target && body == other.body && keep_alive == other.keep_alive
+            && size == other.size;
+    }
+};
+
+parsed copy(const mw::net::http_request& request)
+{
+    return { std::string(request.method), std::string(request.target), std::string(request.body), request.keep_alive, request.size };
+}
+
+/// <summary>
+/// 像http_server一样解析：先收到前split个字节，再收到其余的字节。第二次接收时数据被复制到新的缓冲区，
+/// 检验解析器只依赖相对位置。返回所有完整的请求，error_status接收最后的错误状态码
+/// </summary>
+std::vector<parsed> parse_split(const std::string& data, size_t split, int& error_status,
+    const mw::net::http_parser_options& options = mw::net::http_parser_options())
+{
+    mw::net::http_parser parser(options);
+    std::vector<parsed> result;
+    std::string received = data.substr(0, split);
+    size_t consumed = 0;
+    error_status = 0;
+    for (int round = 0; round < 2; round++)
+    {
+        if (round == 1)
+            received = std::string(data);
+        mw::net::http_request request;
+        while (consumed < received.size())
+        {
+            auto status = parser.parse(received.data() + consumed, received.size() - consumed, request);
+            if (status == mw::net::http_parse_result::incomplete)
+                break;
+            if (status == mw::net::http_parse_result::error)
+            {
+                error_status = parser.error_status();
+                return result;
+            }
+            result.push_back(copy(request));
+            consumed += request.size;
+        }
+    }
+    return result;
+}
+
+/// <summary>
+/// 解析一个完整的请求
+/// </summary>
+/// <returns>成功时返回0，失败时返回错误状态码，数据不完整时返回-1</returns>
+int parse_one(const std::string& data, mw::net::http_request& request,
+    const mw::net::http_parser_options& options = mw::net::http_parser_options())
+{
+    mw::net::http_parser parser(options);
+    auto status = parser.parse(data.data(), data.size(), request);
+    if (status == mw::net::http_parse_result::complete)
+        return 0;
+    return status == mw::net::http_parse_result::error ? parser.error_status() : -1;
+}
+
+void test_pipelined_split()
+{
+    const std::string data = "\r\nGET /a?x=1 HTTP/1.1\r\nHost: h\r\n\r\n"
+                             "POST /b HTTP/1.1\r\nHost: h\r\nContent-Length: 5\r\n\r\nhello"
+                             "HEAD /c HTTP/1.1\r\nHost: h\r\nConnection: close\r\n\r\n"
+                             "GET /d HTTP/1.0\r\nConnection: keep-alive\r\n\r\n"
+                             "PUT /e HTTP/1.1\r\nHost: h\r\ncontent-length: 3\r\n\r\nxyz";
+    int error = 0;
+    auto expected = parse_split(data, data.size(), error);
+    MW_CHECK(error == 0);
+    MW_CHECK(expected.size() == 5);
+    if (expected.size() == 5)
+    {
+        MW_CHECK(expected[0].method == "GET" && expected[0].target == "/a?x=1" && expected[0].keep_alive);
+        MW_CHECK(expected[1].method == "POST" && expected[1].body == "hello");
+        MW_CHECK(expected[2].method == "HEAD" && !expected[2].keep_alive);
+        MW_CHECK(expected[3].target == "/d" && expected[3].keep_alive);
+        MW_CHECK(expected[4].method == "PUT" && expected[4].body == "xyz");
+    }
+
+    // 在每个字节处切分，结果都与一次收到所有数据时相同
+    for (size_t split = 0; split <= data.size(); split++)
+    {
+        auto result = parse_split(data, split, error);
+        MW_CHECK(error == 0);
+        MW_CHECK(result == expected);
+    }
+
+    // 逐字节接收，每次都用所有未消费的数据调用parse
+    mw::net::http_parser parser;
+    mw::net::http_request request;
+    std::vector<parsed> result;
+    size_t consumed = 0;
+    for (size_t size = 1; size <= data.size(); size++)
+    {
+        std::string received = data.substr(0, size);
+        if (parser.parse(received.data() + consumed, received.size() - consumed, request) == mw::net::http_parse_result::complete)
+        {
+            result.push_back(copy(request));
+            consumed += request.size;
+        }
+    }
+    MW_CHECK(result == expected);
+}
+
+void test_content_length()
+{
+    mw::net::http_request request;
+    // 重复但一致的Content-Length被接受
+    MW_CHECK(parse_one("POST / HTTP/1.1\r\nHost: h\r\nContent-Length: 2\r\nContent-Length: 2\r\n\r\nok", request) == 0);
+    MW_CHECK(request.body == "ok");
+    // 冲突的Content-Length可能被用于请求走私
+    MW_CHECK(parse_one("POST / HTTP/1.1\r\nHost: h\r\nContent-Length: 2\r\ncontent-length: 3\r\n\r\nokk", request) == 400);
+    MW_CHECK(parse_one("POST / HTTP/1.1\r\nHost: h\r\nContent-Length: 2, 2\r\n\r\nok", request) == 400);
+    MW_CHECK(parse_one("POST / HTTP/1.1\r\nHost: h\r\nContent-Length: -1\r\n\r\n", request) == 400);
+    MW_CHECK(parse_one("POST / HTTP/1.1\r\nHost: h\r\nContent-Length: \r\n\r\n", request) == 400);
+    MW_CHECK(parse_one("POST / HTTP/1.1\r\nHost: h\r\nContent-Length: 99999999999999999999999\r\n\r\n", request) == 400);
+
+    // Transfer-Encoding不被支持，与Content-Length同时出现也一样
+    MW_CHECK(parse_one("POST / HTTP/1.1\r\nHost: h\r\nTransfer-Encoding: chunked\r\n\r\n0\r\n\r\n", request) == 501);
+    MW_CHECK(parse_one("POST / HTTP/1.1\r\nHost: h\r\nContent-Length: 5\r\nTransfer-Encoding: chunked\r\n\r\n", request) == 501);
+
+    // 请求体超过max_body_size时只看头部就失败，不等待请求体
+    mw::net::http_parser_options options;
+    options.max_body_size = 16;
+    std::string body(16, 'b');
+    MW_CHECK(parse_one("POST / HTTP/1.1\r\nHost: h\r\nContent-Length: 16\r\n\r\n" + body, request, options) == 0);
+    MW_CHECK(parse_one("POST / HTTP/1.1\r\nHost: h\r\nContent-Length: 17\r\n\r\n", request, options) == 413);
+
+    // 失败后parse一直返回error，reset后可以重新解析
+    mw::net::http_parser parser;
+    std::string bad = "GET / HTTP/1.1\r\nHost: h\r\nTransfer-Encoding: gzip\r\n\r\n";
+    std::string good = "GET / HTTP/1.1\r\nHost: h\r\n\r\n";
+    MW_CHECK(parser.parse(bad.data(), bad.size(), request) == mw::net::http_parse_result::error);
+    MW_CHECK(parser.parse(good.data(), good.size(), request) == mw::net::http_parse_result::error);
+    parser.reset();
+    MW_CHECK(parser.parse(good.data(), good.size(), request) == mw::net::http_parse_result::complete);
+}
+
+void test_keep_alive()
+{
+    mw::net::http_request request;
+    MW_CHECK(parse_one("GET / HTTP/1.0\r\n\r\n", request) == 0);
+    MW_CHECK(request.version_minor == 0 && !request.keep_alive);
+    MW_CHECK(parse_one("GET / HTTP/1.0\r\nConnection: Keep-Alive\r\n\r\n", request) == 0);
+    MW_CHECK(request.keep_alive);
+    MW_CHECK(parse_one("GET / HTTP/1.0\r\nConnection: keep-alive, close\r\n\r\n", request) == 0);
+    MW_CHECK(!request.keep_alive);
+    MW_CHECK(parse_one("GET / HTTP/1.1\r\nHost: h\r\n\r\n", request) == 0);
+    MW_CHECK(request.version_minor == 1 && request.keep_alive);
+    MW_CHECK(parse_one("GET / HTTP/1.1\r\nHost: h\r\nConnection: upgrade, close\r\n\r\n", request) == 0);
+    MW_CHECK(!request.keep_alive);
+    // HTTP/1.1要求Host，HTTP/2等版本返回505
+    MW_CHECK(parse_one("GET / HTTP/1.1\r\n\r\n", request) == 400);
+    MW_CHECK(parse_one("GET / HTTP/2.0\r\nHost: h\r\n\r\n", request) == 505);
+}
+
+/// <summary>
+/// 绑定端口0让系统分配一个空闲端口，关闭后返回它
+/// </summary>
+USHORT free_port()
+{
+    auto socket = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(address);
+    ::bind(socket, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+    ::getsockname(socket, reinterpret_cast<sockaddr*>(&address), &length);
+    ::close(socket);
+    return ntohs(address.sin_port);
+}
+
+/// <summary>
+/// 一个响应中测试关心的部分
+/// </summary>
+struct response
+{
+    int status = 0;
+    std::string head;
+    std::string body;
+};
+
+/// <summary>
+/// 阻塞的回环客户端，接收有超时，按Content-Length切分响应
+/// </summary>
+class client
+{
+public:
+    explicit client(USHORT port)
+        : socket(::socket(AF_INET, SOCK_STREAM, 0))
+    {
+        timeval timeout = { 5, 0 };
+        setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        connected = ::connect(socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+    }
+    ~client() { ::close(socket); }
+    client(const client&) = delete;
+    client& operator=(const client&) = delete;
+
+    bool is_connected() const { return connected; }
+
+    bool send(const std::string& data)
+    {
+        return ::send(socket, data.data(), data.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(data.size());
+    }
+
+    /// <summary>
+    /// 接收一个响应，head_only时不读取响应体
+    /// </summary>
+    /// <returns>若连接在完整的响应之前关闭或超时，status为0</returns>
+    response receive(bool head_only = false)
+    {
+        response result;
+        size_t end;
+        while ((end = buffer.find("\r\n\r\n")) == std::string::npos)
+        {
+            if (!fill())
+                return result;
+        }
+        result.head = buffer.substr(0, end + 4);
+        auto length_at = result.head.find("Content-Length: ");
+        size_t length = length_at == std::string::npos ? 0 : std::stoul(result.head.substr(length_at + 16));
+        if (head_only)
+            length = 0;
+        while (buffer.size() < end + 4 + length)
+        {
+            if (!fill())
+                return result;
+        }
+        result.body = buffer.substr(end + 4, length);
+        buffer.erase(0, end + 4 + length);
+        result.status = std::stoi(result.head.substr(9, 3));
+        return result;
+    }
+
+    /// <summary>
+    /// 服务器是否已经关闭连接，在此之前不能再有数据
+    /// </summary>
+    bool closed_by_server()
+    {
+        char byte;
+        return buffer.empty() && ::recv(socket, &byte, 1, 0) == 0;
+    }
+
+private:
+    bool fill()
+    {
+        char data[4096];
+        auto received = ::recv(socket, data, sizeof(data), 0);
+        if (received <= 0)
+            return false;
+        buffer.append(data, static_cast<size_t>(received));
+        return true;
+    }
+
+    int socket;
+    bool connected = false;
+    std::string buffer;
+};
+
+void test_server()
+{
+    // 响应体是方法，目标和请求体，HEAD的Content-Length与GET相同但没有响应体
+    mw::net::http_server_options options;
+    options.parser.max_body_size = 64;
+    options.server_options.reactor_count = 1;
+    options.server_options.pin_reactors = false;
+    mw::net::http_server server(
+        [](mw::net::tcp_connection&, const mw::net::http_request& request, mw::net::http_response& response) {
+            if (request.path == "/silent")
+                return;
+            std::string body = std::string(request.method) + " " + std::string(request.target) + " " + std::string(request.body);
+            response.header("Content-Type", "text/plain");
+            response.end(body);
+        },
+        options);
+    auto port = free_port();
+    MW_CHECK(server.start(port));
+
+    {
+        // 一次写入的管线化请求和分两次写入的请求，响应按顺序到达，HEAD之后紧接着下一个响应
+        client c(port);
+        MW_CHECK(c.is_connected());
+        MW_CHECK(c.send("GET /1 HTTP/1.1\r\nHost: h\r\n\r\n"
+                        "HEAD /2 HTTP/1.1\r\nHost: h\r\n\r\n"
+                        "POST /3 HTTP/1.1\r\nHost: h\r\nContent-Length: 4\r\n\r\nbody"
+                        "GET /silent HTTP/1.1\r\nHost: h\r\n\r\n"
+                        "GET /4 HTTP/1.1\r\nHo"));
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        MW_CHECK(c.send("st: h\r\n\r\n"));
+        auto first = c.receive();
+        MW_CHECK(first.status == 200 && first.body == "GET /1 ");
+        auto head = c.receive(true);
+        MW_CHECK(head.status == 200 && head.head.find("Content-Length: 8\r\n") != std::string::npos);
+        auto post = c.receive();
+        MW_CHECK(post.status == 200 && post.body == "POST /3 body");
+        auto silent = c.receive();
+        MW_CHECK(silent.status == 500);
+        auto last = c.receive();
+        MW_CHECK(last.status == 200 && last.body == "GET /4 ");
+        MW_CHECK(last.head.find("Connection:") == std::string::npos);
+    }
+    {
+        // HTTP/1.0要求保持连接时响应带Connection: keep-alive，连接之后仍然可用；不要求时响应后关闭
+        client c(port);
+        MW_CHECK(c.send("GET /k HTTP/1.0\r\nConnection: keep-alive\r\n\r\n"));
+        auto kept = c.receive();
+        MW_CHECK(kept.status == 200 && kept.head.find("Connection: keep-alive\r\n") != std::string::npos);
+        MW_CHECK(c.send("GET /c HTTP/1.0\r\n\r\n"));
+        auto closing = c.receive();
+        MW_CHECK(closing.status == 200 && closing.body == "GET /c ");
+        MW_CHECK(closing.head.find("Connection: close\r\n") != std::string::npos);
+        MW_CHECK(c.closed_by_server());
+    }
+
+    // 不合法的请求得到对应的错误响应，之后连接被关闭，排在它后面的请求不被处理
+    struct bad_case
+    {
+        std::string request;
+        int status;
+    };
+    const bad_case cases[] = {
+        { "POST / HTTP/1.1\r\nHost: h\r\nContent-Length: 65\r\n\r\n", 413 },
+        { "POST / HTTP/1.1\r\nHost: h\r\nTransfer-Encoding: chunked\r\n\r\n0\r\n\r\n", 501 },
+        { "POST / HTTP/1.1\r\nHost: h\r\nContent-Length: 1\r\nContent-Length: 2\r\n\r\nab", 400 },
+    };
+    for (auto& item : cases)
+    {
+        client c(port);
+        MW_CHECK(c.send("GET /before HTTP/1.1\r\nHost: h\r\n\r\n" + item.request + "GET /after HTTP/1.1\r\nHost: h\r\n\r\n"));
+        MW_CHECK(c.receive().body == "GET /before ");
+        auto error = c.receive();
+        MW_CHECK(error.status == item.status);
+        MW_CHECK(error.head.find("Connection: close\r\n") != std::string::npos && error.body.empty());
+        MW_CHECK(c.closed_by_server());
+    }
+    {
+        // 等于max_body_size的请求体被接受
+        client c(port);
+        MW_CHECK(c.send("POST /max HTTP/1.1\r\nHost: h\r\nContent-Length: 64\r\n\r\n" + std::string(64, 'm')));
+        MW_CHECK(c.receive().body == "POST /max " + std::string(64, 'm'));
+    }
+
+    server.stop();
+    auto stats = server.stats();
+    MW_CHECK(stats.bad_requests == 3);
+    MW_CHECK(stats.unanswered == 1);
+    MW_CHECK(stats.requests == 5 + 2 + 3 + 1);
+}
+
+} // namespace
+
+int main()
+{
+    test_pipelined_split();
+    test_content_length();
+    test_keep_alive();
+    test_server();
+    return mw_test::finish("http_test");
+}
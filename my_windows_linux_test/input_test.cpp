@@ -0,0 +1,228 @@
+#include "linux_test.h"
+#include "mw_input.h"
+#include <vector>
+
+// mw_input.h的basic_input_batch的测试，用recording_input_sender记录批次发送的事件：
+// text把"\r\n"，'\r'和'\n'展开为VK_RETURN，'\t'展开为VK_TAB，超出BMP的字符拆分为代理对；
+// key_combination按相反的顺序松开；mouse_move用构造时查询的屏幕大小计算绝对坐标；flush只插入部分事件时剩余的事件留在批次中
+
+namespace {
+
+using recording_batch = mw::user::basic_input_batch<mw::user::recording_input_sender>;
+
+/// <summary>
+/// 每次send最多插入limit个事件的发送者，模拟输入被其他线程阻塞时SendInput只插入一部分
+/// </summary>
+struct partial_input_sender : mw::user::recording_input_sender
+{
+    mw::user::UINT limit = 0;
+
+    mw::user::UINT send(mw::user::INPUT* input_array, mw::user::UINT input_struct_nums)
+    {
+        return recording_input_sender::send(input_array, input_struct_nums < limit ? input_struct_nums : limit);
+    }
+};
+
+/// <summary>
+/// 期望的键盘事件：虚拟键，扫描码(KEYEVENTF_UNICODE时是UTF-16代码单元)和标志
+/// </summary>
+struct key_event
+{
+    mw::user::WORD virtual_key;
+    mw::user::WORD scan_code;
+    mw::user::DWORD flags;
+};
+
+bool matches(const std::vector<mw::user::INPUT>& inputs, const std::vector<key_event>& expected)
+{
+    if (inputs.size() != expected.size())
+        return false;
+    for (size_t i = 0; i < inputs.size(); i++)
+    {
+        auto& input = inputs[i];
+        if (input.type != mw::user::INPUT_KEYBOARD || input.ki.wVk != expected[i].virtual_key || input.ki.wScan != expected[i].scan_code
+            || input.ki.dwFlags != expected[i].flags)
+            return false;
+    }
+    return true;
+}
+
+void add_press(std::vector<key_event>& events, mw::user::WORD virtual_key)
+{
+    events.push_back({ virtual_key, 0, 0 });
+    events.push_back({ virtual_key, 0, mw::user::KEYEVENTF_KEYUP });
+}
+
+void add_unit(std::vector<key_event>& events, mw::user::WORD unit)
+{
+    events.push_back({ 0, unit, mw::user::KEYEVENTF_UNICODE });
+    events.push_back({ 0, unit, mw::user::KEYEVENTF_UNICODE | mw::user::KEYEVENTF_KEYUP });
+}
+
+void test_text()
+{
+    recording_batch batch;
+    batch.text(L"a\r\nb\tc\rd\n\U0001F600\U00010000\U0010FFFF中");
+
+    std::vector<key_event> expected;
+    add_unit(expected, 'a');
+    add_press(expected, mw::user::VK_RETURN); // "\r\n"只产生一次回车
+    add_unit(expected, 'b');
+    add_press(expected, mw::user::VK_TAB);
+    add_unit(expected, 'c');
+    add_press(expected, mw::user::VK_RETURN); // 单独的'\r'
+    add_unit(expected, 'd');
+    add_press(expected, mw::user::VK_RETURN); // 单独的'\n'
+    add_unit(expected, 0xD83D);
+    add_unit(expected, 0xDE00);
+    add_unit(expected, 0xD800);
+    add_unit(expected, 0xDC00);
+    add_unit(expected, 0xDBFF);
+    add_unit(expected, 0xDFFF);
+    add_unit(expected, 0x4E2D); // BMP中的字符不拆分
+    MW_CHECK(matches(batch.events(), expected));
+
+    // 末尾的'\r'也产生回车
+    batch.clear();
+    batch.text(L"\r");
+    expected.clear();
+    add_press(expected, mw::user::VK_RETURN);
+    MW_CHECK(matches(batch.events(), expected));
+
+    // flush前不发送任何事件，flush把事件原样交给发送者
+    batch.clear();
+    batch.text(L"x\t");
+    MW_CHECK(batch.sender().recorded.empty());
+    MW_CHECK(batch.flush() == 4);
+    MW_CHECK(batch.empty());
+    expected.clear();
+    add_unit(expected, 'x');
+    add_press(expected, mw::user::VK_TAB);
+    MW_CHECK(matches(batch.sender().recorded, expected));
+    MW_CHECK(batch.sender().send_sizes == std::vector<mw::user::UINT> { 4 });
+}
+
+void test_key_combination()
+{
+    recording_batch batch;
+    batch.key_combination({ 0x11, 0x10, 'S' });
+    MW_CHECK(matches(batch.events(),
+        {
+            { 0x11, 0, 0 },
+            { 0x10, 0, 0 },
+            { 'S', 0, 0 },
+            { 'S', 0, mw::user::KEYEVENTF_KEYUP },
+            { 0x10, 0, mw::user::KEYEVENTF_KEYUP },
+            { 0x11, 0, mw::user::KEYEVENTF_KEYUP },
+        }));
+
+    // 额外的标志在按下和松开时都保留
+    batch.clear();
+    batch.key_press(0x25, mw::user::KEYEVENTF_EXTENDEDKEY);
+    MW_CHECK(matches(batch.events(),
+        {
+            { 0x25, 0, mw::user::KEYEVENTF_EXTENDEDKEY },
+            { 0x25, 0, mw::user::KEYEVENTF_EXTENDEDKEY | mw::user::KEYEVENTF_KEYUP },
+        }));
+
+    batch.clear();
+    batch.key_combination({});
+    MW_CHECK(batch.empty());
+}
+
+bool is_absolute_move(const mw::user::INPUT& input, mw::user::LONG dx, mw::user::LONG dy)
+{
+    return input.type == mw::user::INPUT_MOUSE && input.mi.dx == dx && input.mi.dy == dy
+        && input.mi.dwFlags == (mw::user::MOUSEEVENTF_MOVE | mw::user::MOUSEEVENTF_ABSOLUTE);
+}
+
+void test_mouse_move()
+{
+    // 1920x1080的屏幕：左上角为0，中心为32767，右下角为65535
+    recording_batch batch;
+    batch.mouse_move(0, 0).mouse_move(960, 540).mouse_move(1920, 1080).mouse_move(480, 270);
+    auto& events = batch.events();
+    MW_CHECK(events.size() == 4);
+    if (events.size() == 4)
+    {
+        MW_CHECK(is_absolute_move(events[0], 0, 0));
+        MW_CHECK(is_absolute_move(events[1], 32767, 32767));
+        MW_CHECK(is_absolute_move(events[2], 65535, 65535));
+        MW_CHECK(is_absolute_move(events[3], 16383, 16383));
+    }
+
+    // 屏幕大小在构造时查询，发送者的屏幕大小改变后，refresh_screen_size前仍用旧的大小
+    batch.clear();
+    batch.sender().screen_width = 1280;
+    batch.sender().screen_height = 1024;
+    batch.mouse_move(960, 540);
+    batch.refresh_screen_size();
+    batch.mouse_move(640, 512);
+    MW_CHECK(events.size() == 2);
+    if (events.size() == 2)
+    {
+        MW_CHECK(is_absolute_move(events[0], 32767, 32767));
+        MW_CHECK(is_absolute_move(events[1], 32767, 32767));
+    }
+
+    // 构造时传入的屏幕大小
+    mw::user::recording_input_sender small;
+    small.screen_width = 800;
+    small.screen_height = 600;
+    recording_batch other(small);
+    other.click_at(200, 450, mw::user::mouse_button::right);
+    auto& clicks = other.events();
+    MW_CHECK(clicks.size() == 3);
+    if (clicks.size() == 3)
+    {
+        MW_CHECK(is_absolute_move(clicks[0], 16383, 49151));
+        MW_CHECK(clicks[1].type == mw::user::INPUT_MOUSE && clicks[1].mi.dwFlags == mw::user::MOUSEEVENTF_RIGHTDOWN);
+        MW_CHECK(clicks[2].type == mw::user::INPUT_MOUSE && clicks[2].mi.dwFlags == mw::user::MOUSEEVENTF_RIGHTUP);
+    }
+}
+
+void test_partial_flush()
+{
+    mw::user::basic_input_batch<partial_input_sender> batch;
+    batch.sender().limit = 3;
+    batch.text(L"abcd").key_press(mw::user::VK_RETURN); // 10个事件
+    std::vector<key_event> expected;
+    for (auto unit : { 'a', 'b', 'c', 'd' })
+        add_unit(expected, static_cast<mw::user::WORD>(unit));
+    add_press(expected, mw::user::VK_RETURN);
+    auto rest = [&](size_t sent) { return std::vector<key_event>(expected.begin() + sent, expected.end()); };
+
+    // 每次flush只插入前3个，剩余的事件按原来的顺序留在批次中
+    MW_CHECK(batch.flush() == 3);
+    MW_CHECK(matches(batch.events(), rest(3)));
+    MW_CHECK(batch.flush() == 3);
+    MW_CHECK(matches(batch.events(), rest(6)));
+
+    // 发送者一个也没有插入时批次不变
+    batch.sender().limit = 0;
+    MW_CHECK(batch.flush() == 0);
+    MW_CHECK(matches(batch.events(), rest(6)));
+
+    // 之后追加的事件排在剩余的事件之后
+    batch.sender().limit = 100;
+    batch.key_press(mw::user::VK_TAB);
+    add_press(expected, mw::user::VK_TAB);
+    MW_CHECK(matches(batch.events(), rest(6)));
+    MW_CHECK(batch.flush() == 6);
+    MW_CHECK(batch.empty());
+    MW_CHECK(batch.flush() == 0);
+
+    // 所有事件都按顺序恰好发送了一次，空批次的flush不调用发送者
+    MW_CHECK((batch.sender().send_sizes == std::vector<mw::user::UINT> { 3, 3, 0, 6 }));
+}
+
+} // namespace
+
+int main()
+{
+    test_text();
+    test_key_combination();
+    test_mouse_move();
+    test_partial_flush();
+    return mw_test::finish("input_test");
+}
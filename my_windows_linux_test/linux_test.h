@@ -0,0 +1,33 @@
+#pragma once
+#include <cstdio>
+
+// Linux测试程序共用的检查宏，失败时输出位置并计数，不中止测试，main返回mw_test::finish的返回值
+
+namespace mw_test {
+
+inline int failures = 0;
+
+inline void check(bool passed, const char* expression, const char* file, int line)
+{
+    if (passed)
+        return;
+    failures++;
+    std::fprintf(stderr, "%s:%d: 检查失败: %s\n", file, line, expression);
+}
+
+/// <summary>
+/// 输出测试结果
+/// </summary>
+/// <returns>main的返回值，有失败的检查时返回1</returns>
+inline int finish(const char* name)
+{
+    if (failures)
+        std::fprintf(stderr, "%s: %d个检查失败\n", name, failures);
+    else
+        std::printf("%s: 通过\n", name);
+    return failures ? 1 : 0;
+}
+
+} // namespace mw_test
+
+#define MW_CHECK(expression) mw_test::check(static_cast<bool>(expression), #expression, __FILE__, __LINE__)
@@ -0,0 +1,124 @@
+#include "linux_test.h"
+#include "mw_memory_map.h"
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// mw_memory_map.h的/proc/[pid]/maps后端和mw_system_snapshot.h中共用的maps解析的测试
+
+namespace {
+
+void test_parse_line()
+{
+    mw::proc_maps_entry entry;
+    MW_CHECK(mw::parse_proc_maps_line("7f12a000-7f12c000 r-xp 00001000 08:02 131 /usr/lib/my lib.so (deleted)", entry));
+    MW_CHECK(entry.start == 0x7f12a000 && entry.end == 0x7f12c000);
+    MW_CHECK(entry.readable() && !entry.writable() && entry.executable() && !entry.shared());
+    MW_CHECK(entry.offset == 0x1000 && entry.inode == 131);
+    MW_CHECK(entry.is_file() && entry.path == "/usr/lib/my lib.so (deleted)");
+
+    MW_CHECK(mw::parse_proc_maps_line("7ffd0000-7ffd2000 rw-p 00000000 00:00 0                          [stack]", entry));
+    MW_CHECK(!entry.is_file() && entry.path == "[stack]");
+    MW_CHECK(mw::parse_proc_maps_line("10000-20000 ---s 00000000 00:05 7", entry));
+    MW_CHECK(entry.shared() && entry.path.empty());
+
+    MW_CHECK(!mw::parse_proc_maps_line("", entry));
+    MW_CHECK(!mw::parse_proc_maps_line("zzzz-1000 r--p 0 00:00 0", entry));
+    MW_CHECK(!mw::parse_proc_maps_line("1000-2000 r-", entry));
+}
+
+void test_snapshot_self()
+{
+    mw::memory_map map;
+    MW_CHECK(map.snapshot(0));
+    MW_CHECK(!map.summary().truncated);
+
+    // 区域按地址排序，从0开始连续覆盖到最后一个映射
+    auto& regions = map.regions();
+    MW_CHECK(!regions.empty() && regions.front().base == 0);
+    for (std::size_t i = 1; i < regions.size(); i++)
+        MW_CHECK(regions[i].base == regions[i - 1].end());
+
+    int local = 0;
+    auto stack = map.find(&local);
+    MW_CHECK(stack && stack->state == MEM_COMMIT && stack->protect == PAGE_READWRITE && stack->type == MEM_PRIVATE);
+
+    auto code = map.find(reinterpret_cast<const void*>(&test_snapshot_self));
+    MW_CHECK(code && code->type == MEM_IMAGE && code->protect == PAGE_EXECUTE_READ);
+    MW_CHECK(map.summary().image_bytes > 0 && map.summary().bytes_by_protect(PAGE_EXECUTE_READ) > 0);
+    MW_CHECK(map.find(nullptr) && map.find(nullptr)->state == MEM_FREE);
+}
+
+void test_refresh_diff()
+{
+    mw::memory_map map(0);
+    const std::size_t size = 1 << 20;
+    auto reserved = static_cast<char*>(mmap(nullptr, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    MW_CHECK(reserved != MAP_FAILED);
+
+    char path[] = "/tmp/mw_memory_map_XXXXXX";
+    auto fd = mkstemp(path);
+    MW_CHECK(fd >= 0 && ftruncate(fd, 4096) == 0);
+    auto mapped = mmap(nullptr, 4096, PROT_READ, MAP_SHARED, fd, 0);
+    MW_CHECK(mapped != MAP_FAILED);
+
+    mw::memory_map_diff diff;
+    MW_CHECK(map.refresh(0, &diff) && !diff.empty());
+    auto region = map.find(reserved);
+    MW_CHECK(region && region->state == MEM_RESERVE && region->protect == 0 && region->type == MEM_PRIVATE);
+    region = map.find(mapped);
+    MW_CHECK(region && region->state == MEM_COMMIT && region->protect == PAGE_READONLY && region->type == MEM_MAPPED);
+    MW_CHECK(map.summary().reserved_bytes >= size);
+
+    // 调拨预订区域的一部分，它被拆分为两个区域
+    MW_CHECK(mprotect(reserved, 4096, PROT_READ | PROT_WRITE) == 0);
+    MW_CHECK(map.refresh(0, &diff));
+    region = map.find(reserved);
+    MW_CHECK(region && region->state == MEM_COMMIT && region->end() == reinterpret_cast<std::uintptr_t>(reserved) + 4096);
+    region = map.find(reserved + 4096);
+    MW_CHECK(region && region->state == MEM_RESERVE);
+
+    munmap(mapped, 4096);
+    munmap(reserved, size);
+    close(fd);
+    unlink(path);
+    MW_CHECK(map.refresh(0, &diff));
+    MW_CHECK(!diff.removed.empty());
+    region = map.find(mapped);
+    MW_CHECK(!region || region->state == MEM_FREE);
+}
+
+void test_missing_process()
+{
+    mw::memory_map map(0);
+    auto count = map.regions().size();
+    // PID超过pid_max，/proc中没有该进程
+    MW_CHECK(!map.refresh(0x7FFFFFFF));
+    MW_CHECK(map.regions().size() == count);
+}
+
+void test_snapshot_modules()
+{
+    // system_snapshot的模块列表与memory_map使用同一个解析器
+    mw::system_snapshot snapshot;
+    MW_CHECK(snapshot.capture(mw::system_snapshot::modules));
+    auto self = static_cast<std::uint32_t>(getpid());
+    MW_CHECK(snapshot.find_module(self, "memory_map_test"));
+    auto range = snapshot.modules_of(self);
+    for (auto module = range.first; module != range.second; ++module)
+        MW_CHECK(!module->path.empty() && module->path.front() == '/' && module->size > 0);
+}
+
+} // namespace
+
+int main()
+{
+    test_parse_line();
+    test_snapshot_self();
+    test_refresh_diff();
+    test_missing_process();
+    test_snapshot_modules();
+    return mw_test::finish("memory_map_test");
+}
@@ -0,0 +1,130 @@
+#include "linux_test.h"
+#include "mw_memory_pressure.h"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// mw_memory_pressure.h在Linux上的测试：/proc/meminfo后端，级别变化回调的顺序和采样线程
+
+namespace {
+
+using level = mw::memory_pressure_level;
+
+void test_parse_fields()
+{
+    const char* meminfo = "MemTotal:       16303232 kB\nMemFree:         1000 kB\nMemAvailable:   8151616 kB\nSwapCached: 0 kB\n";
+    ULONGLONG value = 0;
+    MW_CHECK(mw::find_proc_kb_field(meminfo, "MemTotal:", value) && value == 16303232ULL * 1024);
+    MW_CHECK(mw::find_proc_kb_field(meminfo, "MemAvailable:", value) && value == 8151616ULL * 1024);
+    // 只匹配行首的字段名
+    MW_CHECK(!mw::find_proc_kb_field(meminfo, "Free:", value));
+    MW_CHECK(!mw::find_proc_kb_field(meminfo, "Cached:", value));
+    MW_CHECK(!mw::find_proc_kb_field("VmRSS:\n", "VmRSS:", value));
+}
+
+void test_sample()
+{
+    mw::memory_pressure_monitor monitor;
+    auto sample = monitor.sample_now();
+    MW_CHECK(sample.time != 0);
+    MW_CHECK(sample.total_physical > 0 && sample.available_physical <= sample.total_physical);
+    MW_CHECK(sample.memory_load <= 100);
+    MW_CHECK(sample.total_commit > 0);
+    MW_CHECK(sample.process_working_set > 0 && sample.process_commit > 0);
+    MW_CHECK(sample.level == level::normal && sample.sequence == 0);
+}
+
+/// <summary>
+/// 按进程提交字节数的阈值驱动级别变化：阈值为1字节时进入critical，为0时回到normal
+/// </summary>
+void set_pressure(mw::memory_pressure_monitor& monitor, bool high)
+{
+    mw::memory_pressure_thresholds thresholds;
+    thresholds.low_load = thresholds.low_clear_load = 101;
+    thresholds.critical_load = thresholds.critical_clear_load = 101;
+    thresholds.critical_process_commit = high ? 1 : 0;
+    monitor.set_thresholds(thresholds);
+}
+
+void test_dispatch_order()
+{
+    mw::memory_pressure_monitor monitor;
+    set_pressure(monitor, false);
+    std::mutex lock;
+    std::vector<std::pair<ULONGLONG, level>> seen;
+    std::atomic<int> running { 0 };
+    std::atomic<bool> overlapped { false };
+    auto record = [&](const mw::memory_pressure_sample& sample) {
+        if (running.fetch_add(1) != 0)
+            overlapped = true;
+        // 回调较慢时后面的级别变化在队列中等待，而不是在另一个线程中先执行
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            seen.emplace_back(sample.sequence, sample.level);
+        }
+        running.fetch_sub(1);
+    };
+    monitor.add_callback(level::critical, record);
+    monitor.add_callback(level::normal, record);
+
+    const int transitions = 40;
+    for (int i = 0; i < transitions; i++)
+    {
+        set_pressure(monitor, i % 2 == 0);
+        auto sample = monitor.sample_now();
+        MW_CHECK(sample.sequence == static_cast<ULONGLONG>(i + 1));
+        MW_CHECK(sample.level == (i % 2 == 0 ? level::critical : level::normal));
+    }
+
+    for (int wait = 0; wait < 500; wait++)
+    {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            if (seen.size() == transitions)
+                break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    std::lock_guard<std::mutex> guard(lock);
+    MW_CHECK(seen.size() == transitions);
+    for (size_t i = 0; i < seen.size(); i++)
+    {
+        MW_CHECK(seen[i].first == i + 1);
+        MW_CHECK(seen[i].second == (i % 2 == 0 ? level::critical : level::normal));
+    }
+    MW_CHECK(!overlapped);
+}
+
+void test_sampler_thread()
+{
+    mw::memory_pressure_monitor monitor;
+    set_pressure(monitor, true);
+    std::atomic<int> calls { 0 };
+    monitor.add_callback(level::critical, [&](const mw::memory_pressure_sample&) { calls++; });
+    MW_CHECK(!monitor.start(0));
+    MW_CHECK(monitor.start(5));
+    for (int wait = 0; wait < 200 && !calls; wait++)
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    MW_CHECK(calls == 1);
+    MW_CHECK(monitor.start(1)); // 修改周期
+    monitor.stop();
+    auto time = monitor.last_sample().time;
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    MW_CHECK(monitor.last_sample().time == time);
+    MW_CHECK(monitor.start(5)); // 停止后可以再次开始
+    monitor.stop();
+}
+
+} // namespace
+
+int main()
+{
+    test_parse_fields();
+    test_sample();
+    test_dispatch_order();
+    test_sampler_thread();
+    return mw_test::finish("memory_pressure_test");
+}
@@ -0,0 +1,217 @@
+#include "linux_test.h"
+#include "mw_memory_scanner.h"
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+// mw_memory_scanner.h的process_vm_readv后端的测试：子进程在一块内存中放置已知的模式(包括跨块边界的匹配和带通配符的模式)，
+// 父进程扫描子进程，检查报告的地址和模式索引；模式较多时使用分派表，结果应该相同
+
+namespace {
+
+constexpr size_t buffer_pages = 4;
+
+/// <summary>
+/// sanitizer的影子内存是数TB的MAP_NORESERVE映射，/proc/[pid]/maps中与普通的匿名内存没有区别，此时只扫描测试的缓冲区
+/// </summary>
+void limit_under_sanitizer([[maybe_unused]] mw::memory_scanner& scanner, [[maybe_unused]] std::uintptr_t begin, [[maybe_unused]] std::uintptr_t end)
+{
+#if defined(__SANITIZE_ADDRESS__) || defined(__SANITIZE_THREAD__)
+    scanner.set_address_range(begin, end);
+#endif
+}
+
+const std::uint8_t exact_pattern[] = { 0x4D, 0x57, 0x53, 0x43, 0x41, 0x4E, 0x01, 0x02 };
+const char* const wildcard_pattern = "9A ?? ?? 7E 5C";
+
+using match_list = std::vector<std::pair<std::uintptr_t, size_t>>;
+
+/// <summary>
+/// 子进程中要放置的模式：(偏移，模式索引，通配符位置的两个字节)
+/// </summary>
+struct planted
+{
+    size_t offset;
+    size_t pattern_index;
+    std::uint8_t wildcard[2];
+};
+
+std::vector<planted> planted_patterns(size_t page_size)
+{
+    return {
+        { 100, 0, {} },
+        { page_size - 3, 0, {} },                         // 跨越第一个块的末尾
+        { 2 * page_size - 2, 1, { 0x11, 0x22 } },         // 跨越第二个块的末尾，通配符是普通字节
+        { 3000, 1, { 0x9A, 0x5C } },                      // 通配符与模式的其他字节相同
+        { buffer_pages * page_size - sizeof(exact_pattern), 0, {} }, // 缓冲区的最后8个字节
+    };
+}
+
+/// <summary>
+/// 子进程：放置模式，把缓冲区地址写入管道，等到父进程关闭另一个管道后退出
+/// </summary>
+[[noreturn]] void run_child(int address_pipe, int exit_pipe, size_t page_size)
+{
+    auto size = buffer_pages * page_size;
+    auto buffer = static_cast<std::uint8_t*>(mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    if (buffer == MAP_FAILED)
+        _exit(1);
+    for (auto& item : planted_patterns(page_size))
+    {
+        if (item.pattern_index == 0)
+            std::memcpy(buffer + item.offset, exact_pattern, sizeof(exact_pattern));
+        else
+        {
+            const std::uint8_t bytes[] = { 0x9A, item.wildcard[0], item.wildcard[1], 0x7E, 0x5C };
+            std::memcpy(buffer + item.offset, bytes, sizeof(bytes));
+        }
+    }
+    auto address = reinterpret_cast<std::uintptr_t>(buffer);
+    if (write(address_pipe, &address, sizeof(address)) != sizeof(address))
+        _exit(1);
+    char byte;
+    while (read(exit_pipe, &byte, 1) > 0)
+        ;
+    _exit(0);
+}
+
+/// <summary>
+/// 扫描子进程，返回落在缓冲区中的匹配，按地址排序
+/// </summary>
+match_list scan_child(mw::memory_scanner& scanner, pid_t child, std::uintptr_t buffer, size_t size)
+{
+    std::mutex lock;
+    match_list matches;
+    auto count = scanner.scan(static_cast<std::uint32_t>(child), [&](const mw::scan_match& match) {
+        // 模式本身也在两个进程的映像和堆中，只比较缓冲区中的匹配
+        if (match.address >= buffer && match.address < buffer + size)
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            matches.emplace_back(match.address, match.pattern_index);
+        }
+        return true;
+    });
+    MW_CHECK(count >= matches.size());
+    MW_CHECK(scanner.bytes_scanned() >= size);
+    std::sort(matches.begin(), matches.end());
+    return matches;
+}
+
+void test_scan_child()
+{
+    auto page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    int address_pipe[2], exit_pipe[2];
+    MW_CHECK(pipe(address_pipe) == 0 && pipe(exit_pipe) == 0);
+    auto child = fork();
+    MW_CHECK(child >= 0);
+    if (child < 0)
+        return;
+    if (child == 0)
+    {
+        close(address_pipe[0]);
+        close(exit_pipe[1]);
+        run_child(address_pipe[1], exit_pipe[0], page_size);
+    }
+    close(address_pipe[1]);
+    close(exit_pipe[0]);
+
+    std::uintptr_t buffer = 0;
+    MW_CHECK(read(address_pipe[0], &buffer, sizeof(buffer)) == sizeof(buffer));
+    auto size = buffer_pages * page_size;
+
+    match_list expected;
+    for (auto& item : planted_patterns(page_size))
+        expected.emplace_back(buffer + item.offset, item.pattern_index);
+    std::sort(expected.begin(), expected.end());
+
+    // 块大小等于页面大小，使放在页面末尾的模式跨越块边界
+    mw::memory_scanner scanner(page_size, 2);
+    MW_CHECK(scanner.add_pattern(exact_pattern, nullptr, sizeof(exact_pattern)));
+    MW_CHECK(scanner.add_pattern(wildcard_pattern));
+    MW_CHECK(!scanner.add_pattern("?? ??"));
+    MW_CHECK(!scanner.add_pattern("9A 7"));
+    limit_under_sanitizer(scanner, buffer, buffer + size);
+    if (buffer)
+        MW_CHECK(scan_child(scanner, child, buffer, size) == expected);
+
+    // 超过dispatch_threshold个模式时使用分派表，额外的模式不会出现在缓冲区中
+    for (size_t i = 0; i <= mw::memory_scanner::dispatch_threshold; i++)
+    {
+        const std::uint8_t filler[] = { 0xF1, static_cast<std::uint8_t>(i), 0xE7, 0x3D };
+        MW_CHECK(scanner.add_pattern(filler, nullptr, sizeof(filler)));
+    }
+    MW_CHECK(scanner.pattern_count() > mw::memory_scanner::dispatch_threshold);
+    if (buffer)
+        MW_CHECK(scan_child(scanner, child, buffer, size) == expected);
+
+    // 回调返回false时停止扫描
+    std::uint64_t reported = 0;
+    std::mutex lock;
+    scanner.scan(static_cast<std::uint32_t>(child), [&](const mw::scan_match&) {
+        std::lock_guard<std::mutex> guard(lock);
+        reported++;
+        return false;
+    });
+    MW_CHECK(reported >= 1 && reported <= 2);
+
+    close(exit_pipe[1]);
+    close(address_pipe[0]);
+    int status = 0;
+    MW_CHECK(waitpid(child, &status, 0) == child && WIFEXITED(status) && WEXITSTATUS(status) == 0);
+}
+
+void test_scan_self()
+{
+    // 0表示当前进程，在中间页面不可访问的缓冲区中扫描，不可访问的页面不会被读取
+    auto page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    auto buffer = static_cast<std::uint8_t*>(mmap(nullptr, 3 * page_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    MW_CHECK(buffer != MAP_FAILED);
+    if (buffer == MAP_FAILED)
+        return;
+    const std::uint8_t marker[] = { 0xC3, 0x5A, 0xA5, 0x3C, 0x96 };
+    std::memcpy(buffer + 10, marker, sizeof(marker));
+    std::memcpy(buffer + 2 * page_size + 20, marker, sizeof(marker));
+    MW_CHECK(mprotect(buffer + page_size, page_size, PROT_NONE) == 0);
+
+    mw::memory_scanner scanner(page_size, 1);
+    MW_CHECK(scanner.add_pattern("C3 5A A5 3C 96"));
+    auto begin = reinterpret_cast<std::uintptr_t>(buffer);
+    limit_under_sanitizer(scanner, begin, begin + 3 * page_size);
+    std::vector<std::uintptr_t> found;
+    auto scan_self = [&] {
+        found.clear();
+        scanner.scan(0, [&](const mw::scan_match& match) {
+            if (match.address >= begin && match.address < begin + 3 * page_size)
+                found.push_back(match.address);
+            return true;
+        });
+        std::sort(found.begin(), found.end());
+    };
+    scan_self();
+    MW_CHECK(found.size() == 2);
+    if (found.size() == 2)
+        MW_CHECK(found[0] == begin + 10 && found[1] == begin + 2 * page_size + 20);
+
+    // 范围只限制起始地址，从范围末尾之前开始的匹配仍然被报告
+    scanner.set_address_range(begin + 2 * page_size + 18, begin + 2 * page_size + 21);
+    scan_self();
+    MW_CHECK(found.size() == 1 && found[0] == begin + 2 * page_size + 20);
+    scanner.set_address_range(begin + 11, begin + 2 * page_size + 20);
+    scan_self();
+    MW_CHECK(found.empty());
+    munmap(buffer, 3 * page_size);
+}
+
+} // namespace
+
+int main()
+{
+    test_scan_child();
+    test_scan_self();
+    return mw_test::finish("memory_scanner_test");
+}
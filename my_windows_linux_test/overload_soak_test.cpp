@@ -0,0 +1,196 @@
+#include "linux_test.h"
+#include "mw_tcp_server.h"
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <poll.h>
+#include <string>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+
+// tcp_server过载控制的浸泡测试：服务器在子进程中运行，客户端建立10倍于max_connections的连接，
+// 每个连接收发一定数量的消息后断开并重新连接。测试期间父进程读取子进程的/proc/[pid]/status，
+// 服务器自己的常驻内存峰值相对于开始接受连接时的增长超过memory_bound时失败。
+//   build/overload_soak_test [秒数]    默认运行5秒
+
+namespace {
+
+constexpr DWORD server_connections = 100;
+constexpr DWORD client_connections = 10 * server_connections;
+constexpr size_t message_size = 64;
+constexpr int messages_per_connection = 100;
+constexpr DWORD recv_buffer_size = 4096;
+constexpr size_t max_pool_chunks = 1024;
+
+/// <summary>
+/// 服务器常驻内存增长的上限：缓冲区池的上限，每个连接16KB(连接对象，发送队列的索引等)，再加上线程栈和分配器的16MB余量
+/// </summary>
+constexpr size_t memory_bound = max_pool_chunks * recv_buffer_size + server_connections * 16 * 1024 + 16 * 1024 * 1024;
+
+USHORT free_port()
+{
+    auto socket = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(address);
+    ::bind(socket, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+    ::getsockname(socket, reinterpret_cast<sockaddr*>(&address), &length);
+    ::close(socket);
+    return ntohs(address.sin_port);
+}
+
+/// <summary>
+/// 读取进程的/proc/[pid]/status中以KB为单位的字段(VmRSS，VmHWM等)，返回字节数
+/// </summary>
+size_t read_status_bytes(pid_t pid, const char* field)
+{
+    std::ifstream status("/proc/" + std::to_string(pid) + "/status");
+    std::string line;
+    auto prefix = std::string(field) + ":";
+    while (std::getline(status, line))
+    {
+        if (line.compare(0, prefix.size(), prefix) == 0)
+            return std::strtoull(line.c_str() + prefix.size(), nullptr, 10) * 1024;
+    }
+    return 0;
+}
+
+/// <summary>
+/// 子进程：运行服务器直到stop_fd被关闭，检查接受的连接数和缓冲区池的块数从未超过上限
+/// </summary>
+int run_server(USHORT port, int ready_fd, int stop_fd)
+{
+    mw::net::tcp_handler handler;
+    handler.on_data = [](mw::net::tcp_connection& connection, const char* data, size_t size) -> size_t {
+        return connection.send(data, size) ? size : 0;
+    };
+    mw::net::tcp_server_options options;
+    options.reactor_count = 2;
+    options.pin_reactors = false;
+    options.recv_buffer_size = recv_buffer_size;
+    options.max_connections = server_connections;
+    options.max_pool_chunks = max_pool_chunks;
+    options.shed_target = 5;
+    mw::net::tcp_server server(handler, options);
+    if (!server.start() || !server.listen(port))
+        return 2;
+    char ready = 1;
+    if (write(ready_fd, &ready, 1) != 1)
+        return 2;
+
+    ULONGLONG max_inbound = 0;
+    size_t max_chunks = 0;
+    for (;;)
+    {
+        pollfd stop = { stop_fd, POLLIN, 0 };
+        if (poll(&stop, 1, 20) != 0)
+            break;
+        max_inbound = (std::max)(max_inbound, server.stats().inbound);
+        max_chunks = (std::max)(max_chunks, server.get_buffer_pool().stats().total_chunks);
+    }
+
+    auto stats = server.stats();
+    std::printf("overload_soak_test: 服务器接受%llu个连接(同时最多%llu个)，因连接数暂停%llu次，因内存暂停%llu次，"
+                "暂停接收%llu次，卸载%llu个连接，缓冲区池最多%zu块\n",
+        static_cast<unsigned long long>(stats.accepted), static_cast<unsigned long long>(max_inbound),
+        static_cast<unsigned long long>(stats.accept_paused_by_limit), static_cast<unsigned long long>(stats.accept_paused_by_memory),
+        static_cast<unsigned long long>(stats.read_pauses), static_cast<unsigned long long>(stats.shed_connections), max_chunks);
+    std::fflush(stdout);
+    server.stop(1000);
+    MW_CHECK(max_inbound <= server_connections);
+    MW_CHECK(max_chunks <= max_pool_chunks);
+    MW_CHECK(stats.accepted > server_connections && stats.accept_paused_by_limit > 0);
+    return mw_test::failures ? 1 : 0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    int seconds = argc > 1 ? std::atoi(argv[1]) : 5;
+    auto port = free_port();
+    int ready_pipe[2], stop_pipe[2];
+    if (pipe(ready_pipe) != 0 || pipe(stop_pipe) != 0)
+        return 1;
+
+    // 在创建任何线程之前fork
+    auto child = fork();
+    if (child == 0)
+    {
+        close(ready_pipe[0]);
+        close(stop_pipe[1]);
+        _exit(run_server(port, ready_pipe[1], stop_pipe[0]));
+    }
+    close(ready_pipe[1]);
+    close(stop_pipe[0]);
+    char ready = 0;
+    MW_CHECK(read(ready_pipe[0], &ready, 1) == 1);
+    auto baseline = read_status_bytes(child, "VmRSS");
+
+    // 客户端收到回显后发送下一个消息，每个连接发送messages_per_connection个消息后断开并重新连接，
+    // 超出服务器限制的连接停留在积压队列中，直到有连接断开
+    std::atomic<ULONGLONG> messages { 0 };
+    std::atomic<bool> reconnecting { true };
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    mw::net::tcp_server* client_pointer = nullptr;
+    mw::net::tcp_handler client_handler;
+    client_handler.on_connect = [](mw::net::tcp_connection& connection) {
+        char message[message_size] = {};
+        connection.send(message, message_size);
+    };
+    client_handler.on_data = [&](mw::net::tcp_connection& connection, const char* data, size_t size) -> size_t {
+        auto count = size / message_size;
+        messages.fetch_add(count, std::memory_order_relaxed);
+        auto sent = reinterpret_cast<std::uintptr_t>(connection.user_data) + count;
+        connection.user_data = reinterpret_cast<void*>(sent);
+        if (sent >= messages_per_connection)
+            connection.close();
+        else
+        {
+            for (size_t i = 0; i < count; i++)
+                connection.send(data + i * message_size, message_size);
+        }
+        return count * message_size;
+    };
+    client_handler.on_close = [&](mw::net::tcp_connection&) {
+        if (reconnecting.load())
+            client_pointer->connect(reinterpret_cast<sockaddr*>(&address), sizeof(address));
+    };
+    mw::net::tcp_server_options client_options;
+    client_options.reactor_count = 2;
+    client_options.pin_reactors = false;
+    mw::net::tcp_server client(client_handler, client_options);
+    client_pointer = &client;
+    MW_CHECK(client.start());
+    for (DWORD i = 0; i < client_connections; i++)
+        client.connect(reinterpret_cast<sockaddr*>(&address), sizeof(address));
+
+    size_t peak = 0;
+    for (int second = 1; second <= seconds; second++)
+    {
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+        auto rss = read_status_bytes(child, "VmRSS");
+        peak = (std::max)(peak, read_status_bytes(child, "VmHWM"));
+        std::printf("overload_soak_test: %d秒，%llu个消息，服务器常驻内存%zuKB(开始时%zuKB)\n", second,
+            static_cast<unsigned long long>(messages.load()), rss / 1024, baseline / 1024);
+    }
+    auto growth = peak > baseline ? peak - baseline : 0;
+    std::printf("overload_soak_test: 服务器常驻内存峰值增长%zuKB，上限%zuKB\n", growth / 1024, memory_bound / 1024);
+    MW_CHECK(baseline > 0 && growth <= memory_bound);
+    MW_CHECK(messages.load() > client_connections);
+
+    reconnecting = false;
+    close(stop_pipe[1]);
+    int status = 0;
+    MW_CHECK(waitpid(child, &status, 0) == child);
+    MW_CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    client.stop(1000);
+    return mw_test::finish("overload_soak_test");
+}
@@ -0,0 +1,197 @@
+#include "linux_test.h"
+#include "mw_resolver.h"
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+// mw_resolver.h的测试，使用假的查询后端，不访问网络：并发查询的合并，TTL过期，失败结果的缓存和后端抛出的异常
+
+namespace {
+
+/// <summary>
+/// 假后端：记录调用次数，可以让查询阻塞直到放行，"bad"返回错误，"throw"抛出异常，其他名字解析为127.0.0.1
+/// </summary>
+struct fake_backend
+{
+    std::atomic<int> calls { 0 };
+    DWORD ttl = 0;
+    std::mutex lock;
+    std::condition_variable changed;
+    bool blocked = false;
+
+    mw::net::resolver::backend make()
+    {
+        return [this](const std::tstring& node, const std::tstring& service, const ADDRINFOT&,
+                   std::vector<mw::net::resolved_endpoint>& endpoints, DWORD& result_ttl) -> int {
+            calls++;
+            {
+                std::unique_lock<std::mutex> guard(lock);
+                changed.wait(guard, [this] { return !blocked; });
+            }
+            if (node == "throw")
+                throw std::runtime_error("backend failed");
+            if (node == "bad")
+                return EAI_NONAME;
+            if (ttl)
+                result_ttl = ttl;
+            mw::net::resolved_endpoint endpoint;
+            auto address = reinterpret_cast<sockaddr_in*>(&endpoint.address);
+            address->sin_family = AF_INET;
+            address->sin_port = htons(static_cast<uint16_t>(std::stoi(service)));
+            address->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            endpoint.address_len = sizeof(sockaddr_in);
+            endpoint.family = AF_INET;
+            endpoints.push_back(endpoint);
+            return 0;
+        };
+    }
+
+    void block(bool value)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        blocked = value;
+        changed.notify_all();
+    }
+};
+
+void test_concurrent_lookups_joined()
+{
+    fake_backend backend;
+    mw::net::resolver resolver(mw::net::resolver_options(), backend.make());
+    backend.block(true);
+
+    // 多个线程同时解析同一个名字，只有第一个调用后端
+    constexpr int threads = 8;
+    std::vector<std::shared_future<mw::net::resolve_result>> results(threads);
+    std::vector<std::thread> callers;
+    for (int i = 0; i < threads; i++)
+        callers.emplace_back([&, i] { results[i] = resolver.resolve("example", "80"); });
+    for (auto& caller : callers)
+        caller.join();
+    auto other = resolver.resolve("other", "443");
+    backend.block(false);
+
+    for (auto& result : results)
+    {
+        auto& value = result.get();
+        MW_CHECK(value.error == 0 && value.endpoints.size() == 1);
+        MW_CHECK(ntohs(reinterpret_cast<const sockaddr_in*>(value.endpoints[0].get_address())->sin_port) == 80);
+    }
+    MW_CHECK(other.get().error == 0);
+    MW_CHECK(backend.calls.load() == 2);
+
+    auto stats = resolver.stats();
+    MW_CHECK(stats.requests == threads + 1 && stats.joined == threads - 1 && stats.lookups == 2);
+    MW_CHECK(stats.cache_hits == 0 && stats.entries == 2);
+}
+
+void test_ttl_expiry()
+{
+    fake_backend backend;
+    mw::net::resolver_options options;
+    options.ttl = 60 * 1000;
+    mw::net::resolver resolver(options, backend.make());
+
+    // 后端把TTL改为50毫秒
+    backend.ttl = 50;
+    MW_CHECK(resolver.resolve("example", "80").get().error == 0);
+    MW_CHECK(resolver.resolve("example", "80").get().error == 0);
+    MW_CHECK(backend.calls.load() == 1 && resolver.stats().cache_hits == 1);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(80));
+    MW_CHECK(resolver.resolve("example", "80").get().error == 0);
+    MW_CHECK(backend.calls.load() == 2);
+
+    // clear删除已完成的条目
+    resolver.clear();
+    MW_CHECK(resolver.stats().entries == 0);
+    resolver.resolve("example", "80").get();
+    MW_CHECK(backend.calls.load() == 3);
+}
+
+void test_negative_caching()
+{
+    fake_backend backend;
+    mw::net::resolver_options options;
+    options.negative_ttl = 50;
+    mw::net::resolver resolver(options, backend.make());
+
+    MW_CHECK(resolver.resolve("bad", "80").get().error == EAI_NONAME);
+    MW_CHECK(resolver.resolve("bad", "80").get().error == EAI_NONAME);
+    MW_CHECK(backend.calls.load() == 1);
+    auto stats = resolver.stats();
+    MW_CHECK(stats.failures == 1 && stats.cache_hits == 1);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(80));
+    MW_CHECK(resolver.resolve("bad", "80").get().error == EAI_NONAME);
+    MW_CHECK(backend.calls.load() == 2);
+
+    // negative_ttl为0时失败结果不缓存
+    fake_backend uncached_backend;
+    options.negative_ttl = 0;
+    mw::net::resolver uncached(options, uncached_backend.make());
+    uncached.resolve("bad", "80").get();
+    uncached.resolve("bad", "80").get();
+    MW_CHECK(uncached_backend.calls.load() == 2 && uncached.stats().entries == 0);
+}
+
+void test_backend_exception()
+{
+    fake_backend backend;
+    mw::net::resolver resolver(mw::net::resolver_options(), backend.make());
+    backend.block(true);
+    auto first = resolver.resolve("throw", "80");
+    auto joined = resolver.resolve("throw", "80");
+    backend.block(false);
+
+    // 等待同一次查询的所有future都得到异常
+    for (auto* future : { &first, &joined })
+    {
+        bool thrown = false;
+        try
+        {
+            future->get();
+        }
+        catch (const std::runtime_error& error)
+        {
+            thrown = std::string(error.what()) == "backend failed";
+        }
+        MW_CHECK(thrown);
+    }
+
+    // 异常不被缓存，下次重新查询
+    MW_CHECK(resolver.stats().entries == 0 && resolver.stats().failures == 1);
+    auto again = resolver.resolve("throw", "80");
+    MW_CHECK(again.wait_for(std::chrono::seconds(5)) == std::future_status::ready);
+    MW_CHECK(backend.calls.load() == 2);
+}
+
+void test_system_lookup_numeric()
+{
+    // 数字地址不需要网络
+    mw::net::resolver resolver;
+    auto& result = resolver.resolve("127.0.0.1", "8080").get();
+    MW_CHECK(result.error == 0 && !result.endpoints.empty());
+    if (!result.endpoints.empty())
+    {
+        auto address = reinterpret_cast<const sockaddr_in*>(result.endpoints[0].get_address());
+        MW_CHECK(address->sin_family == AF_INET && ntohs(address->sin_port) == 8080);
+        MW_CHECK(address->sin_addr.s_addr == htonl(INADDR_LOOPBACK));
+    }
+}
+
+} // namespace
+
+int main()
+{
+    test_concurrent_lookups_joined();
+    test_ttl_expiry();
+    test_negative_caching();
+    test_backend_exception();
+    test_system_lookup_numeric();
+    return mw_test::finish("resolver_test");
+}
@@ -0,0 +1,168 @@
+#include "linux_test.h"
+#include "mw_shared_memory.h"
+#include <cstdint>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// mw_shared_memory.h的分配器和offset_ptr的测试：段耗尽后较小的请求仍然成功，空闲链表复用已释放的块，
+// 同一个memfd映射在两个不同地址时，offset_ptr和共享容器在两个视图中都指向正确的对象
+
+namespace {
+
+constexpr std::uint64_t segment_size = 64 * 1024;
+
+struct node
+{
+    int value;
+    mw::offset_ptr<node> next;
+};
+
+/// <summary>
+/// 在已清零的匿名内存上初始化一个段
+/// </summary>
+mw::shared_segment_header* map_anonymous_segment(std::uint64_t size)
+{
+    auto memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED)
+        return nullptr;
+    auto header = static_cast<mw::shared_segment_header*>(memory);
+    header->initialize(size);
+    return header;
+}
+
+void test_exhaustion()
+{
+    auto header = map_anonymous_segment(segment_size);
+    MW_CHECK(header);
+    if (!header)
+        return;
+    auto initial = header->unallocated_bytes();
+    MW_CHECK(initial > 0 && initial < segment_size);
+
+    // 超过剩余空间但不超过段大小的请求失败，不改变段尾部
+    MW_CHECK(header->allocate(segment_size - 64) == 0);
+    MW_CHECK(header->unallocated_bytes() == initial);
+    MW_CHECK(header->allocate(segment_size + 1) == 0);
+    MW_CHECK(header->unallocated_bytes() == initial);
+
+    // 之后较小的请求仍然从段尾部分配
+    auto small = header->allocate(100);
+    MW_CHECK(small != 0 && small % mw::shared_segment_header::block_header_size == 0);
+    MW_CHECK(header->usable_size(small) >= 100);
+    MW_CHECK(header->unallocated_bytes() < initial);
+
+    // 分配到耗尽，剩余空间不会下溢，最后一个放不下的请求之后还能分配更小的块
+    std::uint64_t count = 0;
+    while (header->allocate(1000))
+        count++;
+    MW_CHECK(count > 0);
+    auto remaining = header->unallocated_bytes();
+    MW_CHECK(remaining < segment_size);
+    if (remaining >= 32)
+        MW_CHECK(header->allocate(16) != 0);
+    while (header->allocate(16))
+        ;
+    MW_CHECK(header->unallocated_bytes() < 32);
+    MW_CHECK(header->allocate(1000) == 0);
+    munmap(header, segment_size);
+}
+
+void test_free_list_reuse()
+{
+    auto header = map_anonymous_segment(segment_size);
+    MW_CHECK(header);
+    if (!header)
+        return;
+
+    auto first = header->allocate(200);
+    auto second = header->allocate(200);
+    MW_CHECK(first && second && first != second);
+    auto unallocated = header->unallocated_bytes();
+
+    // 后释放的先被复用，复用不消耗段尾部
+    header->deallocate(first);
+    header->deallocate(second);
+    MW_CHECK(header->allocate(200) == second);
+    MW_CHECK(header->allocate(190) == first);
+    MW_CHECK(header->unallocated_bytes() == unallocated);
+
+    // 不同尺寸等级的块不会互相复用
+    header->deallocate(first);
+    auto larger = header->allocate(2000);
+    MW_CHECK(larger != 0 && larger != first);
+    MW_CHECK(header->allocate(200) == first);
+    header->deallocate(0);
+    munmap(header, segment_size);
+}
+
+void test_two_mappings()
+{
+    auto fd = memfd_create("mw_shared_memory_test", 0);
+    MW_CHECK(fd >= 0);
+    if (fd < 0)
+        return;
+    MW_CHECK(ftruncate(fd, segment_size) == 0);
+    auto first = static_cast<char*>(mmap(nullptr, segment_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0));
+    auto second = static_cast<char*>(mmap(nullptr, segment_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0));
+    close(fd);
+    MW_CHECK(first != MAP_FAILED && second != MAP_FAILED && first != second);
+    if (first == MAP_FAILED || second == MAP_FAILED)
+        return;
+
+    // 在第一个视图中建立一个链表和一个共享数组
+    auto header = reinterpret_cast<mw::shared_segment_header*>(first);
+    header->initialize(segment_size);
+    std::uint64_t offsets[3];
+    for (int i = 0; i < 3; i++)
+    {
+        offsets[i] = header->allocate(sizeof(node));
+        MW_CHECK(offsets[i] != 0);
+        new (first + offsets[i]) node { i * 10, nullptr };
+    }
+    reinterpret_cast<node*>(first + offsets[0])->next = reinterpret_cast<node*>(first + offsets[1]);
+    reinterpret_cast<node*>(first + offsets[1])->next = reinterpret_cast<node*>(first + offsets[2]);
+
+    using vector = mw::shared_vector<std::uint64_t>;
+    auto vector_offset = header->allocate(sizeof(vector));
+    auto values = new (first + vector_offset) vector(mw::shared_allocator<std::uint64_t>(header));
+    for (std::uint64_t i = 0; i < 100; i++)
+        MW_CHECK(values->push_back(i * i));
+
+    // 第二个视图看到同一个链表，所有指针都落在第二个视图中
+    auto head = reinterpret_cast<node*>(second + offsets[0]);
+    int visited = 0;
+    for (auto p = head; p; p = p->next.get())
+    {
+        MW_CHECK(reinterpret_cast<char*>(p) >= second && reinterpret_cast<char*>(p) < second + segment_size);
+        MW_CHECK(p->value == visited * 10);
+        visited++;
+    }
+    MW_CHECK(visited == 3);
+
+    auto mirrored = reinterpret_cast<vector*>(second + vector_offset);
+    MW_CHECK(mirrored->size() == 100);
+    MW_CHECK(reinterpret_cast<char*>(mirrored->data()) >= second && reinterpret_cast<char*>(mirrored->data()) < second + segment_size);
+    MW_CHECK((*mirrored)[99] == 99 * 99);
+
+    // 在第二个视图中通过它的分配器修改，第一个视图看到结果
+    MW_CHECK(mirrored->get_allocator().segment() == reinterpret_cast<mw::shared_segment_header*>(second));
+    MW_CHECK(mirrored->push_back(12345));
+    MW_CHECK(values->size() == 101 && values->back() == 12345);
+    head->next = nullptr;
+    MW_CHECK(!reinterpret_cast<node*>(first + offsets[0])->next);
+
+    values->~vector();
+    munmap(first, segment_size);
+    munmap(second, segment_size);
+}
+
+} // namespace
+
+int main()
+{
+    static_assert(sizeof(mw::offset_ptr<node>) == 8, "offset_ptr must have the same size in every process");
+    test_exhaustion();
+    test_free_list_reuse();
+    test_two_mappings();
+    return mw_test::finish("shared_memory_test");
+}
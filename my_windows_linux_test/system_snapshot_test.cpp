@@ -0,0 +1,214 @@
+#include "linux_test.h"
+#include "mw_system_snapshot.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <fstream>
+#include <string>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+
+// mw_system_snapshot.h的/proc后端的测试：按PID，TID，名字和模块基址查找当前进程；
+// 两次快照之间fork的子进程和新线程出现在started中，子进程exec后同一PID的名字改变，视为旧进程退出，新进程启动，
+// 子进程和线程结束后出现在exited中
+
+namespace {
+
+std::uint32_t current_thread_id()
+{
+    return static_cast<std::uint32_t>(syscall(SYS_gettid));
+}
+
+std::string read_comm(pid_t process_id)
+{
+    std::ifstream file("/proc/" + std::to_string(process_id) + "/comm");
+    std::string comm;
+    std::getline(file, comm);
+    return comm;
+}
+
+template <typename Predicate>
+bool wait_until(Predicate predicate, int milliseconds = 5000)
+{
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(milliseconds);
+    while (!predicate())
+    {
+        if (std::chrono::steady_clock::now() > deadline)
+            return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+template <typename Record, typename Predicate>
+bool contains(const std::vector<Record>& records, Predicate predicate)
+{
+    return std::find_if(records.begin(), records.end(), predicate) != records.end();
+}
+
+/// <summary>
+/// 在快照期间一直存在的线程，TID在启动后写入thread_id
+/// </summary>
+class parked_thread
+{
+public:
+    parked_thread()
+        : thread([this] {
+            thread_id = current_thread_id();
+            while (!stopping.load())
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        })
+    {
+        while (!thread_id.load())
+            std::this_thread::yield();
+    }
+    ~parked_thread() { stop(); }
+
+    void stop()
+    {
+        stopping = true;
+        if (thread.joinable())
+            thread.join();
+    }
+
+    std::atomic<std::uint32_t> thread_id { 0 };
+
+private:
+    std::atomic<bool> stopping { false };
+    std::thread thread;
+};
+
+void test_lookup_self()
+{
+    parked_thread worker;
+    auto process_id = static_cast<std::uint32_t>(getpid());
+    auto main_thread_id = current_thread_id();
+
+    mw::system_snapshot snapshot;
+    MW_CHECK(snapshot.capture());
+
+    // 按PID查找当前进程，名字是comm(最多15个字符)，父进程与getppid一致
+    auto self = snapshot.find_process(process_id);
+    MW_CHECK(self != nullptr);
+    auto comm = read_comm(getpid());
+    if (self)
+    {
+        MW_CHECK(self->exe_file == comm);
+        MW_CHECK(self->parent_process_id == static_cast<std::uint32_t>(getppid()));
+        MW_CHECK(self->thread_count >= 2);
+    }
+    MW_CHECK(!snapshot.find_process(0u));
+    bool found_by_name = false;
+    snapshot.for_each_process(comm, [&](const mw::process_record& process) { found_by_name |= process.process_id == process_id; });
+    MW_CHECK(found_by_name);
+    MW_CHECK(snapshot.find_process(mw::snapshot_string_view(comm)) != nullptr);
+
+    // 按TID查找主线程和工作线程，它们在threads_of返回的一段中
+    for (auto thread_id : { main_thread_id, worker.thread_id.load() })
+    {
+        auto thread = snapshot.find_thread(thread_id);
+        MW_CHECK(thread != nullptr && thread->owner_process_id == process_id);
+        auto range = snapshot.threads_of(process_id);
+        MW_CHECK(std::find_if(range.first, range.second, [&](const mw::thread_record& item) { return item.thread_id == thread_id; }) != range.second);
+    }
+    auto range = snapshot.threads_of(process_id);
+    MW_CHECK(std::all_of(range.first, range.second, [&](const mw::thread_record& item) { return item.owner_process_id == process_id; }));
+
+    // 可执行文件是一个模块，可以按名字，完整路径和基址找到
+    char path[4096] = {};
+    MW_CHECK(readlink("/proc/self/exe", path, sizeof(path) - 1) > 0);
+    std::string exe_path(path);
+    auto exe_name = exe_path.substr(exe_path.rfind('/') + 1);
+    auto module = snapshot.find_module(process_id, mw::snapshot_string_view(exe_name));
+    MW_CHECK(module != nullptr);
+    if (module)
+    {
+        MW_CHECK(module->path == exe_path);
+        MW_CHECK(snapshot.find_module(process_id, mw::snapshot_string_view(exe_path)) == module);
+        MW_CHECK(snapshot.find_module(process_id, module->base_address) == module);
+        // 代码在模块的地址范围内
+        auto code = reinterpret_cast<std::uintptr_t>(&test_lookup_self);
+        MW_CHECK(code >= module->base_address && code < module->base_address + module->size);
+        auto modules = snapshot.modules_of(process_id);
+        MW_CHECK(module >= modules.first && module < modules.second);
+    }
+}
+
+void test_child_diff()
+{
+    parked_thread existing;
+    mw::system_snapshot snapshot;
+    MW_CHECK(snapshot.capture(mw::system_snapshot::processes | mw::system_snapshot::threads));
+    auto process_id = static_cast<std::uint32_t>(getpid());
+    auto comm = read_comm(getpid());
+
+    // 子进程等待管道关闭后exec /bin/sleep，它的主线程的TID等于PID
+    int go[2];
+    MW_CHECK(pipe(go) == 0);
+    auto child = fork();
+    MW_CHECK(child >= 0);
+    if (child < 0)
+        return;
+    if (child == 0)
+    {
+        close(go[1]);
+        char byte;
+        while (read(go[0], &byte, 1) > 0)
+            ;
+        execl("/bin/sleep", "sleep", "30", static_cast<char*>(nullptr));
+        _exit(127);
+    }
+    close(go[0]);
+    auto child_id = static_cast<std::uint32_t>(child);
+    parked_thread started;
+
+    mw::snapshot_diff diff;
+    MW_CHECK(snapshot.refresh(diff));
+    MW_CHECK(contains(diff.started_processes, [&](const mw::process_record& process) {
+        return process.process_id == child_id && process.parent_process_id == process_id && process.exe_file == comm;
+    }));
+    MW_CHECK(contains(diff.started_threads, [&](const mw::thread_record& thread) { return thread.thread_id == child_id && thread.owner_process_id == child_id; }));
+    MW_CHECK(contains(diff.started_threads, [&](const mw::thread_record& thread) { return thread.thread_id == started.thread_id.load(); }));
+    // 一直存在的进程和线程不出现在变化中
+    MW_CHECK(!contains(diff.started_processes, [&](const mw::process_record& process) { return process.process_id == process_id; }));
+    MW_CHECK(!contains(diff.started_threads, [&](const mw::thread_record& thread) { return thread.thread_id == existing.thread_id.load(); }));
+    MW_CHECK(!contains(diff.exited_processes, [&](const mw::process_record& process) { return process.process_id == child_id; }));
+    auto found = snapshot.find_process(child_id);
+    MW_CHECK(found != nullptr && found->parent_process_id == process_id);
+    MW_CHECK(snapshot.find_thread(child_id) != nullptr);
+
+    // exec后PID不变，名字变为sleep：旧进程退出，新进程启动
+    close(go[1]);
+    MW_CHECK(wait_until([&] { return read_comm(child) == "sleep"; }));
+    MW_CHECK(snapshot.refresh(diff));
+    MW_CHECK(contains(diff.exited_processes, [&](const mw::process_record& process) { return process.process_id == child_id && process.exe_file == comm; }));
+    MW_CHECK(contains(diff.started_processes, [&](const mw::process_record& process) { return process.process_id == child_id && process.exe_file == "sleep"; }));
+    found = snapshot.find_process(child_id);
+    MW_CHECK(found != nullptr && found->exe_file == "sleep");
+
+    // 子进程和线程结束后出现在exited中，之后查找不到
+    kill(child, SIGKILL);
+    int status = 0;
+    MW_CHECK(waitpid(child, &status, 0) == child);
+    auto started_thread_id = started.thread_id.load();
+    started.stop();
+    MW_CHECK(snapshot.refresh(diff));
+    MW_CHECK(contains(diff.exited_processes, [&](const mw::process_record& process) { return process.process_id == child_id && process.exe_file == "sleep"; }));
+    MW_CHECK(contains(diff.exited_threads, [&](const mw::thread_record& thread) { return thread.thread_id == child_id; }));
+    MW_CHECK(contains(diff.exited_threads, [&](const mw::thread_record& thread) { return thread.thread_id == started_thread_id; }));
+    MW_CHECK(!contains(diff.started_processes, [&](const mw::process_record& process) { return process.process_id == child_id; }));
+    MW_CHECK(!snapshot.find_process(child_id) && !snapshot.find_thread(child_id) && !snapshot.find_thread(started_thread_id));
+    MW_CHECK(snapshot.find_process(process_id) != nullptr && snapshot.find_thread(existing.thread_id.load()) != nullptr);
+}
+
+} // namespace
+
+int main()
+{
+    test_lookup_self();
+    test_child_diff();
+    return mw_test::finish("system_snapshot_test");
+}
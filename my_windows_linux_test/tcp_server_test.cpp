@@ -0,0 +1,232 @@
+#include "linux_test.h"
+#include "mw_tcp_server.h"
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+// mw_tcp_server.h的epoll后端的测试：回环上的回显，主动连接失败，post中关闭连接，带着连接和监听套接字停止
+
+namespace {
+
+/// <summary>
+/// 绑定端口0让系统分配一个空闲端口，关闭后返回它
+/// </summary>
+USHORT free_port()
+{
+    auto socket = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(address);
+    ::bind(socket, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+    ::getsockname(socket, reinterpret_cast<sockaddr*>(&address), &length);
+    ::close(socket);
+    return ntohs(address.sin_port);
+}
+
+sockaddr_in loopback(USHORT port)
+{
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    return address;
+}
+
+template <typename Predicate>
+bool wait_until(Predicate predicate, int milliseconds = 5000)
+{
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(milliseconds);
+    while (!predicate())
+    {
+        if (std::chrono::steady_clock::now() > deadline)
+            return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+mw::net::tcp_handler echo_handler()
+{
+    mw::net::tcp_handler handler;
+    handler.on_data = [](mw::net::tcp_connection& connection, const char* data, size_t size) -> size_t {
+        return connection.send(data, size) ? size : 0;
+    };
+    return handler;
+}
+
+void test_echo()
+{
+    constexpr int clients = 8;
+    constexpr int messages = 200;
+    const std::string message = "0123456789abcdefghijklmnopqrstuvwxyz";
+    const size_t expected = message.size() * messages;
+
+    mw::net::tcp_server_options options;
+    options.reactor_count = 2;
+    options.pin_reactors = false;
+    mw::net::tcp_server server(echo_handler(), options);
+    auto port = free_port();
+    MW_CHECK(server.start() && server.listen(port));
+
+    std::atomic<int> connected { 0 }, closed { 0 };
+    std::atomic<size_t> received[clients] = {};
+    std::string echoed[clients];
+    mw::net::tcp_handler handler;
+    handler.on_connect = [&](mw::net::tcp_connection& connection) {
+        connected++;
+        // 逐条发送，服务器分多次读到并回显
+        for (int i = 0; i < messages; i++)
+            MW_CHECK(connection.send(message.data(), message.size()));
+    };
+    handler.on_data = [&](mw::net::tcp_connection& connection, const char* data, size_t size) -> size_t {
+        auto index = reinterpret_cast<std::uintptr_t>(connection.user_data);
+        echoed[index].append(data, size);
+        if (received[index].fetch_add(size) + size >= expected)
+            connection.close();
+        return size;
+    };
+    handler.on_close = [&](mw::net::tcp_connection&) { closed++; };
+    mw::net::tcp_server client(handler, options);
+    MW_CHECK(client.start());
+    auto address = loopback(port);
+    for (int i = 0; i < clients; i++)
+        MW_CHECK(client.connect(reinterpret_cast<sockaddr*>(&address), sizeof(address), reinterpret_cast<void*>(static_cast<std::uintptr_t>(i))));
+
+    MW_CHECK(wait_until([&] { return closed.load() == clients; }));
+    MW_CHECK(connected.load() == clients);
+    for (int i = 0; i < clients; i++)
+    {
+        MW_CHECK(echoed[i].size() == expected);
+        for (size_t offset = 0; offset + message.size() <= echoed[i].size(); offset += message.size())
+            MW_CHECK(echoed[i].compare(offset, message.size(), message) == 0);
+    }
+    MW_CHECK(wait_until([&] { return server.stats().active == 0; }));
+
+    auto server_stats = server.stats();
+    auto client_stats = client.stats();
+    MW_CHECK(server_stats.accepted == clients && server_stats.inbound == 0);
+    MW_CHECK(server_stats.bytes_received == expected * clients && server_stats.bytes_sent == expected * clients);
+    MW_CHECK(client_stats.connected == clients && client_stats.active == 0);
+    MW_CHECK(client_stats.bytes_sent == expected * clients && client_stats.bytes_received == expected * clients);
+    // 一轮中的多次send被合并
+    MW_CHECK(client_stats.send_calls < static_cast<ULONGLONG>(clients * messages));
+    client.stop();
+    server.stop();
+}
+
+void test_connect_failed()
+{
+    std::atomic<int> error { 0 };
+    std::atomic<void*> user_data { nullptr };
+    mw::net::tcp_handler handler;
+    handler.on_connect_failed = [&](void* data, int code) {
+        user_data = data;
+        error = code;
+    };
+    mw::net::tcp_server_options options;
+    options.reactor_count = 1;
+    mw::net::tcp_server client(handler, options);
+    MW_CHECK(client.start());
+    // 没有监听的端口
+    auto address = loopback(free_port());
+    int tag = 0;
+    MW_CHECK(client.connect(reinterpret_cast<sockaddr*>(&address), sizeof(address), &tag));
+    MW_CHECK(wait_until([&] { return error.load() != 0; }));
+    MW_CHECK(error.load() == WSAECONNREFUSED && user_data.load() == &tag);
+    MW_CHECK(client.stats().connected == 0 && client.stats().active == 0);
+    client.stop();
+}
+
+void test_close_in_post()
+{
+    std::atomic<mw::net::tcp_connection*> accepted { nullptr };
+    std::atomic<bool> call_returned { false }, closed_after_call { false }, closed { false };
+    mw::net::tcp_handler handler;
+    handler.on_connect = [&](mw::net::tcp_connection& connection) { accepted = &connection; };
+    handler.on_close = [&](mw::net::tcp_connection&) {
+        closed_after_call = call_returned.load();
+        closed = true;
+    };
+    mw::net::tcp_server_options options;
+    options.reactor_count = 1;
+    mw::net::tcp_server server(handler, options);
+    auto port = free_port();
+    MW_CHECK(server.start() && server.listen(port));
+
+    auto socket = ::socket(AF_INET, SOCK_STREAM, 0);
+    auto address = loopback(port);
+    MW_CHECK(::connect(socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0);
+    MW_CHECK(wait_until([&] { return accepted.load() != nullptr; }));
+
+    auto connection = accepted.load();
+    MW_CHECK(server.post(connection->reactor_index(), [&, connection] {
+        // 中止后连接没有未完成的I/O，但要等这个调用返回才销毁
+        connection->abort();
+        MW_CHECK(connection->is_closing() && !closed.load());
+        MW_CHECK(!connection->send("x", 1));
+        call_returned = true;
+    }));
+    MW_CHECK(wait_until([&] { return closed.load(); }));
+    MW_CHECK(closed_after_call.load());
+
+    char byte = 0;
+    MW_CHECK(::recv(socket, &byte, 1, 0) <= 0);
+    ::close(socket);
+    server.stop();
+}
+
+void test_stop_with_connections()
+{
+    std::atomic<int> connected { 0 }, closed { 0 };
+    auto handler = echo_handler();
+    handler.on_connect = [&](mw::net::tcp_connection&) { connected++; };
+    handler.on_close = [&](mw::net::tcp_connection&) { closed++; };
+    mw::net::tcp_server_options options;
+    options.reactor_count = 2;
+    options.pin_reactors = false;
+    mw::net::tcp_server server(handler, options);
+    auto port = free_port();
+    MW_CHECK(server.start() && server.listen(port));
+
+    constexpr int count = 4;
+    int sockets[count];
+    auto address = loopback(port);
+    for (auto& socket : sockets)
+    {
+        socket = ::socket(AF_INET, SOCK_STREAM, 0);
+        MW_CHECK(::connect(socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0);
+    }
+    MW_CHECK(wait_until([&] { return connected.load() == count; }));
+
+    // 连接优雅地关闭，监听套接字在第0个反应器中关闭
+    server.stop();
+    MW_CHECK(closed.load() == count && !server.is_running());
+    for (auto socket : sockets)
+    {
+        char byte = 0;
+        MW_CHECK(::recv(socket, &byte, 1, 0) == 0);
+        ::close(socket);
+    }
+    auto socket = ::socket(AF_INET, SOCK_STREAM, 0);
+    MW_CHECK(::connect(socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0);
+    ::close(socket);
+
+    // 停止后可以重新启动
+    MW_CHECK(server.start() && server.listen(port));
+    server.stop();
+}
+
+} // namespace
+
+int main()
+{
+    test_echo();
+    test_connect_failed();
+    test_close_in_post();
+    test_stop_with_connections();
+    return mw_test::finish("tcp_server_test");
+}
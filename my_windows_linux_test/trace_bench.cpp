@@ -0,0 +1,62 @@
+#define MW_TRACE_ALL
+#include "mw_trace.h"
+#include <chrono>
+#include <cstdio>
+
+// 追踪一个调用的开销，对应example_3_25在Linux上的部分：同一个循环分别使用scope<false>(模块未启用)和scope<true>，
+// 每种取多轮中最快的一轮。启用时每个事件超过50纳秒，或者未启用时不是空循环(超过2纳秒)时返回1
+
+namespace {
+
+constexpr int rounds = 5;
+constexpr int iterations = 10000000;
+constexpr double event_bound = 50.0;
+constexpr double disabled_bound = 2.0;
+
+volatile int sink = 0;
+
+template <bool Enabled>
+double run()
+{
+    double best = 1e30;
+    for (int round = 0; round < rounds; round++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++)
+        {
+            mw::trace::scope<Enabled> mw_trace_scope_(mw::trace::module::thread, "trace_bench", i);
+            MW_TRACE_RESULT(i);
+            sink = i;
+        }
+        auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / iterations;
+        best = elapsed < best ? elapsed : best;
+        // 读取事件，使下一轮的写入与实际使用时一样覆盖已读取的槽
+        mw::trace::recorder::drain([](std::uint32_t, const std::vector<mw::trace::event>&, std::uint64_t) {});
+    }
+    return best;
+}
+
+} // namespace
+
+int main()
+{
+    mw::clock::tsc_clock::calibrate();
+    auto disabled = run<false>();
+    auto enabled = run<true>();
+
+    // 两次读取时钟是每个事件的大部分开销
+    double clock_read = 1e30;
+    for (int round = 0; round < rounds; round++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++)
+            sink = static_cast<int>(mw::clock::tsc_clock::raw_now());
+        auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / iterations;
+        clock_read = elapsed < clock_read ? elapsed : clock_read;
+    }
+
+    std::printf("trace_bench: disabled %.2f ns/call (bound %.0f ns), enabled %.1f ns/event (bound %.0f ns), "
+                "raw_now %.1f ns, tsc %s\n",
+        disabled, disabled_bound, enabled, event_bound, clock_read, mw::clock::tsc_clock::available() ? "yes" : "no");
+    return disabled < disabled_bound && enabled < event_bound ? 0 : 1;
+}
@@ -0,0 +1,120 @@
+#define MW_TRACE_ALL
+#include "linux_test.h"
+#include "mw_trace.h"
+#include <atomic>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+// mw_trace.h的测试：已退出的线程的缓冲区数有上限，读取完后释放，超过4.29秒的耗时不被截断，
+// 线程不断创建和退出时并发读取(配合SANITIZE=thread)
+
+namespace {
+
+using mw::trace::recorder;
+
+void record_one(const char* name)
+{
+    mw::trace::scope<true> mw_trace_scope_(mw::trace::module::thread, name, 0);
+    MW_TRACE_RESULT(1);
+}
+
+/// <summary>
+/// 取出所有事件，返回事件数和丢弃数之和
+/// </summary>
+std::uint64_t drain_all()
+{
+    std::uint64_t total = 0;
+    recorder::drain([&](std::uint32_t, const std::vector<mw::trace::event>& events, std::uint64_t dropped) { total += events.size() + dropped; });
+    return total;
+}
+
+void test_retired_buffers_capped()
+{
+    // 没有读取者时，已退出的线程最多保留max_retired_buffers个缓冲区
+    constexpr int threads = 40;
+    for (int i = 0; i < threads; i++)
+        std::thread([] { record_one("retired"); }).join();
+    MW_CHECK(recorder::buffer_count() == recorder::max_retired_buffers);
+
+    // 被重用的缓冲区中的事件计入dropped，每个事件要么被读取，要么被计为丢弃
+    MW_CHECK(drain_all() == threads);
+    // 读取完后已退出的线程的缓冲区被释放
+    MW_CHECK(recorder::buffer_count() == 0);
+
+    // 读取完但还没有释放的缓冲区被新线程直接重用，不计入丢弃
+    std::thread([] { record_one("first"); }).join();
+    MW_CHECK(drain_all() == 1);
+    std::thread([] { record_one("second"); }).join();
+    MW_CHECK(recorder::buffer_count() == 1);
+    std::uint64_t dropped = 0;
+    size_t events = 0;
+    recorder::drain([&](std::uint32_t, const std::vector<mw::trace::event>& items, std::uint64_t count) {
+        events += items.size();
+        dropped += count;
+    });
+    MW_CHECK(events == 1 && dropped == 0);
+}
+
+void test_long_duration()
+{
+    // 5秒的等待
+    auto ticks_per_second = mw::clock::tsc_clock::available() ? mw::clock::tsc_clock::frequency() : 1e9;
+    auto start = mw::clock::tsc_clock::raw_now();
+    auto end = start + static_cast<std::uint64_t>(ticks_per_second * 5);
+    std::thread([&] { recorder::record(mw::trace::module::thread, "long_wait", 0, 0, start, end); }).join();
+
+    mw::trace::binary_writer writer;
+    std::vector<std::uint8_t> binary;
+    MW_CHECK(writer.flush(binary) == 1);
+    std::string json;
+    MW_CHECK(mw::trace::to_chrome_json(binary.data(), binary.size(), json));
+    auto position = json.find("\"dur\":");
+    MW_CHECK(position != std::string::npos);
+    if (position != std::string::npos)
+    {
+        // 耗时以微秒为单位，允许浮点换算的误差
+        auto duration = std::strtod(json.c_str() + position + 6, nullptr);
+        MW_CHECK(duration > 4.99e6 && duration < 5.01e6);
+    }
+}
+
+void test_concurrent_churn()
+{
+    std::atomic<bool> running { true };
+    std::atomic<std::uint64_t> recorded { 0 };
+    std::vector<std::thread> spawners;
+    for (int t = 0; t < 4; t++)
+        spawners.emplace_back([&] {
+            for (int i = 0; i < 50; i++)
+                std::thread([&] {
+                    for (int j = 0; j < 100; j++)
+                        record_one("churn");
+                    recorded += 100;
+                }).join();
+        });
+    std::uint64_t seen = 0;
+    std::thread reader([&] {
+        while (running.load())
+            seen += drain_all();
+    });
+    for (auto& spawner : spawners)
+        spawner.join();
+    running = false;
+    reader.join();
+    seen += drain_all();
+    MW_CHECK(seen == recorded.load());
+    MW_CHECK(recorder::buffer_count() == 0);
+}
+
+} // namespace
+
+int main()
+{
+    mw::clock::tsc_clock::calibrate();
+    test_retired_buffers_capped();
+    test_long_duration();
+    test_concurrent_churn();
+    return mw_test::finish("trace_test");
+}
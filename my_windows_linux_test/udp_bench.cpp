@@ -0,0 +1,106 @@
+#include "mw_udp_endpoint.h"
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// udp_endpoint在回环上每秒收发的数据报数：几个发送者各用一个端点(不同的源端口，分散到接收端的各个SO_REUSEPORT套接字)，
+// 分别用逐个的send_to和每次64个的send_batch(sendmmsg)发送64字节的数据报，接收端报告每秒收到的数据报数和平均每次recvmmsg取出的数量。
+// 没有收到数据报，或者接收出错时返回1
+
+namespace {
+
+constexpr int senders = 2;
+constexpr size_t batch = 64;
+constexpr size_t datagram_bytes = 64;
+constexpr auto duration = std::chrono::seconds(2);
+
+struct result
+{
+    double sent_per_second;
+    double received_per_second;
+    double datagrams_per_batch;
+    ULONGLONG dropped;
+    ULONGLONG receive_errors;
+};
+
+result run(bool batched)
+{
+    mw::net::udp_endpoint_options options;
+    options.pin_workers = false;
+    mw::net::udp_endpoint receiver([](mw::net::udp_endpoint&, const mw::net::udp_datagram*, size_t) {}, options);
+    receiver.start(0);
+    sockaddr_in target = {};
+    socklen_t length = sizeof(target);
+    getsockname(receiver.get_socket(), reinterpret_cast<sockaddr*>(&target), &length);
+    target.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    std::vector<std::unique_ptr<mw::net::udp_endpoint>> endpoints;
+    options.worker_count = 1;
+    for (int i = 0; i < senders; i++)
+    {
+        endpoints.push_back(std::make_unique<mw::net::udp_endpoint>([](mw::net::udp_endpoint&, const mw::net::udp_datagram*, size_t) {}, options));
+        endpoints.back()->start(0);
+    }
+
+    std::vector<char> payload(datagram_bytes, 'u');
+    std::vector<mw::net::udp_datagram> datagrams(batch, { payload.data(), payload.size(), reinterpret_cast<sockaddr*>(&target), sizeof(target) });
+    std::atomic<bool> running { true };
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    for (auto& endpoint : endpoints)
+    {
+        threads.emplace_back([&, sender = endpoint.get()] {
+            while (running.load(std::memory_order_relaxed))
+            {
+                if (batched)
+                    sender->send_batch(datagrams.data(), datagrams.size());
+                else
+                {
+                    for (auto& datagram : datagrams)
+                        sender->send_to(datagram.address, datagram.address_len, datagram.data, datagram.size);
+                }
+            }
+        });
+    }
+    std::this_thread::sleep_for(duration);
+    running = false;
+    for (auto& thread : threads)
+        thread.join();
+    // 等待接收端取完套接字中剩余的数据报
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    ULONGLONG sent = 0, dropped = 0;
+    for (auto& endpoint : endpoints)
+    {
+        endpoint->stop();
+        auto stats = endpoint->stats();
+        sent += stats.packets_sent;
+        dropped += stats.send_dropped;
+    }
+    receiver.stop();
+    auto stats = receiver.stats();
+    return { static_cast<double>(sent) / seconds, static_cast<double>(stats.packets_received) / seconds,
+        stats.batches ? static_cast<double>(stats.packets_received) / static_cast<double>(stats.batches) : 0,
+        dropped, stats.receive_errors };
+}
+
+} // namespace
+
+int main()
+{
+    bool passed = true;
+    for (bool batched : { false, true })
+    {
+        auto item = run(batched);
+        std::printf("udp_bench: %-10s sent %.0f/s, received %.0f/s, %.1f datagrams per recvmmsg, %llu dropped by full send buffers\n",
+            batched ? "send_batch" : "send_to", item.sent_per_second, item.received_per_second, item.datagrams_per_batch,
+            static_cast<unsigned long long>(item.dropped));
+        passed = passed && item.received_per_second > 0 && item.receive_errors == 0;
+    }
+    return passed ? 0 : 1;
+}
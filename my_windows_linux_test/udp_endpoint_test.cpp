@@ -0,0 +1,179 @@
+#include "linux_test.h"
+#include "mw_udp_endpoint.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// mw_udp_endpoint.h的Linux后端的测试：多个SO_REUSEPORT套接字上的回显，send_batch，超过datagram_size的数据报，
+// 停止后重新启动时统计信息保留
+
+namespace {
+
+sockaddr_in loopback(USHORT port)
+{
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    return address;
+}
+
+USHORT bound_port(const mw::net::udp_endpoint& endpoint)
+{
+    sockaddr_in address = {};
+    socklen_t length = sizeof(address);
+    getsockname(endpoint.get_socket(), reinterpret_cast<sockaddr*>(&address), &length);
+    return ntohs(address.sin_port);
+}
+
+template <typename Predicate>
+bool wait_until(Predicate predicate, int milliseconds = 5000)
+{
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(milliseconds);
+    while (!predicate())
+    {
+        if (std::chrono::steady_clock::now() > deadline)
+            return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+mw::net::udp_endpoint_options small_options(DWORD workers)
+{
+    mw::net::udp_endpoint_options options;
+    options.worker_count = workers;
+    options.pin_workers = false;
+    options.batch_size = 16;
+    options.datagram_size = 256;
+    return options;
+}
+
+void test_echo()
+{
+    // 服务器把收到的一批数据报原样发回，目标地址就是发送者的地址
+    mw::net::udp_endpoint server(
+        [](mw::net::udp_endpoint& endpoint, const mw::net::udp_datagram* datagrams, size_t count) { endpoint.send_batch(datagrams, count); },
+        small_options(3));
+    MW_CHECK(server.start(0));
+    auto port = bound_port(server);
+    MW_CHECK(port != 0);
+
+    constexpr int clients = 4;
+    constexpr int messages = 100;
+    std::atomic<int> echoed { 0 };
+    std::mutex lock;
+    std::vector<std::string> payloads;
+    std::vector<std::unique_ptr<mw::net::udp_endpoint>> endpoints;
+    for (int c = 0; c < clients; c++)
+    {
+        endpoints.push_back(std::make_unique<mw::net::udp_endpoint>(
+            [&](mw::net::udp_endpoint&, const mw::net::udp_datagram* datagrams, size_t count) {
+                std::lock_guard<std::mutex> guard(lock);
+                for (size_t i = 0; i < count; i++)
+                    payloads.emplace_back(datagrams[i].data, datagrams[i].size);
+                echoed += static_cast<int>(count);
+            },
+            small_options(1)));
+        MW_CHECK(endpoints.back()->start(0));
+    }
+
+    // 每个客户端分几批发送，每批的数据报数超过一次sendmmsg的上限
+    auto target = loopback(port);
+    std::vector<std::string> texts;
+    for (int c = 0; c < clients; c++)
+        for (int i = 0; i < messages; i++)
+            texts.push_back("client " + std::to_string(c) + " message " + std::to_string(i));
+    for (int c = 0; c < clients; c++)
+    {
+        std::vector<mw::net::udp_datagram> batch;
+        for (int i = 0; i < messages; i++)
+        {
+            auto& text = texts[c * messages + i];
+            batch.push_back({ text.data(), text.size(), reinterpret_cast<sockaddr*>(&target), sizeof(target) });
+        }
+        MW_CHECK(endpoints[c]->send_batch(batch.data(), batch.size()) == batch.size());
+    }
+
+    MW_CHECK(wait_until([&] { return echoed.load() == clients * messages; }));
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        std::sort(payloads.begin(), payloads.end());
+        std::sort(texts.begin(), texts.end());
+        MW_CHECK(payloads == texts);
+    }
+
+    auto stats = server.stats();
+    MW_CHECK(stats.packets_received == clients * messages);
+    MW_CHECK(stats.packets_sent == clients * messages);
+    MW_CHECK(stats.batches >= 1 && stats.batches <= stats.packets_received);
+    MW_CHECK(stats.truncated == 0 && stats.receive_errors == 0 && stats.send_dropped == 0 && stats.send_errors == 0);
+    for (auto& endpoint : endpoints)
+        endpoint->stop();
+    server.stop();
+    MW_CHECK(!server.is_running() && server.get_socket() == INVALID_SOCKET);
+}
+
+void test_truncated_and_invalid()
+{
+    std::atomic<int> received { 0 };
+    std::atomic<size_t> last_size { 0 };
+    mw::net::udp_endpoint endpoint(
+        [&](mw::net::udp_endpoint&, const mw::net::udp_datagram* datagrams, size_t count) {
+            last_size = datagrams[count - 1].size;
+            received += static_cast<int>(count);
+        },
+        small_options(2));
+    MW_CHECK(endpoint.start(0));
+    auto target = loopback(bound_port(endpoint));
+
+    // 超过datagram_size的数据报被丢弃并计入truncated，之后的数据报正常接收
+    auto raw = ::socket(AF_INET, SOCK_DGRAM, 0);
+    std::string large(300, 'x'), small(10, 'y');
+    sendto(raw, large.data(), large.size(), 0, reinterpret_cast<sockaddr*>(&target), sizeof(target));
+    sendto(raw, small.data(), small.size(), 0, reinterpret_cast<sockaddr*>(&target), sizeof(target));
+    MW_CHECK(wait_until([&] { return received.load() == 1; }));
+    MW_CHECK(last_size.load() == small.size());
+    MW_CHECK(endpoint.stats().truncated == 1);
+    ::close(raw);
+
+    // 太大的数据报和不合法的地址长度不发送，也不计入丢弃
+    MW_CHECK(!endpoint.send_to(reinterpret_cast<sockaddr*>(&target), sizeof(target), large.data(), large.size()));
+    MW_CHECK(!endpoint.send_to(reinterpret_cast<sockaddr*>(&target), -1, small.data(), small.size()));
+    mw::net::udp_datagram mixed[] = {
+        { large.data(), large.size(), reinterpret_cast<sockaddr*>(&target), sizeof(target) },
+        { small.data(), small.size(), reinterpret_cast<sockaddr*>(&target), sizeof(target) },
+    };
+    MW_CHECK(endpoint.send_batch(mixed, 2) == 1);
+    MW_CHECK(wait_until([&] { return received.load() == 2; }));
+    auto stats = endpoint.stats();
+    MW_CHECK(stats.send_dropped == 0 && stats.send_errors == 0 && stats.packets_sent == 1);
+
+    // 停止后不能发送，重新启动后之前的计数仍然保留
+    endpoint.stop();
+    MW_CHECK(!endpoint.send_to(reinterpret_cast<sockaddr*>(&target), sizeof(target), small.data(), small.size()));
+    MW_CHECK(endpoint.start(0));
+    MW_CHECK(!endpoint.start(0));
+    target = loopback(bound_port(endpoint));
+    MW_CHECK(endpoint.send_to(reinterpret_cast<sockaddr*>(&target), sizeof(target), small.data(), small.size()));
+    MW_CHECK(wait_until([&] { return received.load() == 3; }));
+    stats = endpoint.stats();
+    MW_CHECK(stats.packets_received == 3 && stats.truncated == 1 && stats.packets_sent == 2);
+}
+
+} // namespace
+
+int main()
+{
+    test_echo();
+    test_truncated_and_invalid();
+    return mw_test::finish("udp_endpoint_test");
+}
@@ -0,0 +1,100 @@
+#include "mw_unicode.h"
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// mw_unicode.h在纯ASCII，中文和中英混合的4MB文本上的转换速度(每秒转换的输入字节数)，与Windows上的example_1_1相同。
+// 输出缓冲区只分配一次，每轮都用transcode_into写入同一个缓冲区。每个方向运行几轮取最快的一轮，与trace_bench一样；
+// Makefile用默认选项(SSE2)和-mavx2各编译一次，转换结果与输入不一致时返回1
+
+namespace {
+
+#if defined(MW_UNICODE_AVX2)
+constexpr const char* bench_name = "unicode_bench(AVX2)";
+#elif defined(MW_UNICODE_SSSE3)
+constexpr const char* bench_name = "unicode_bench(SSSE3)";
+#elif defined(MW_UNICODE_SSE2)
+constexpr const char* bench_name = "unicode_bench(SSE2)";
+#else
+constexpr const char* bench_name = "unicode_bench(标量)";
+#endif
+
+constexpr int rounds = 5;
+
+std::string make_text(std::string_view piece)
+{
+    std::string text;
+    while (text.size() < 4 * 1024 * 1024)
+        text += piece;
+    return text;
+}
+
+/// <summary>
+/// 运行rounds轮，每轮至少0.1秒，返回最快一轮每秒处理的字节数(GB/s)
+/// </summary>
+template <typename Function>
+double measure(size_t bytes, Function&& transcode)
+{
+    double best = 0;
+    for (int round = 0; round < rounds; round++)
+    {
+        size_t count = 0;
+        auto start = std::chrono::steady_clock::now();
+        double seconds = 0;
+        for (; seconds < 0.1; seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count())
+        {
+            transcode();
+            count++;
+        }
+        best = (std::max)(best, static_cast<double>(bytes) * static_cast<double>(count) / seconds / 1e9);
+    }
+    return best;
+}
+
+} // namespace
+
+int main()
+{
+#if defined(MW_UNICODE_AVX2)
+    if (!__builtin_cpu_supports("avx2"))
+    {
+        std::printf("%s: 跳过(CPU不支持AVX2)\n", bench_name);
+        return 0;
+    }
+#endif
+    struct sample
+    {
+        const char* name;
+        std::string utf8;
+    };
+    // 与example_1_1的文本相同，中文用\u转义
+    const sample samples[] = {
+        { "ascii", make_text("The quick brown fox jumps over the lazy dog. 0123456789\n") },
+        { "cjk", make_text(u8"\u654F\u6377\u7684\u68D5\u8272\u72D0\u72F8\u8DF3\u8FC7\u4E86\u90A3\u53EA\u61D2\u72D7\uFF0C\u7136\u540E\u53C8\u8DD1\u56DE\u4E86\u68EE\u6797\u3002") },
+        { "mixed", make_text(u8"HTTP\u8BF7\u6C42\u7684Content-Length\u662F42\uFF0C\u72B6\u6001\u7801200\u8868\u793A\u6210\u529F\uFF1B") },
+    };
+
+    bool passed = true;
+    std::vector<char16_t> utf16_buffer;
+    std::vector<char> utf8_buffer;
+    for (auto& item : samples)
+    {
+        utf16_buffer.resize(item.utf8.size());
+        auto result = mw::transcode_into(std::string_view(item.utf8), utf16_buffer.data(), utf16_buffer.size());
+        std::u16string_view utf16(utf16_buffer.data(), result.written);
+        utf8_buffer.resize(utf16.size() * 3);
+        auto back = mw::transcode_into(utf16, utf8_buffer.data(), utf8_buffer.size());
+        passed = passed && result.status == mw::transcode_status::ok && back.status == mw::transcode_status::ok
+            && std::string_view(utf8_buffer.data(), back.written) == item.utf8;
+
+        auto to_utf16 = measure(item.utf8.size(), [&] {
+            mw::transcode_into(std::string_view(item.utf8), utf16_buffer.data(), utf16_buffer.size());
+        });
+        auto to_utf8 = measure(utf16.size() * sizeof(char16_t), [&] {
+            mw::transcode_into(utf16, utf8_buffer.data(), utf8_buffer.size());
+        });
+        std::printf("%s: %-5s UTF-8 -> UTF-16 %.2f GB/s, UTF-16 -> UTF-8 %.2f GB/s\n", bench_name, item.name, to_utf16, to_utf8);
+    }
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,409 @@
+#include "linux_test.h"
+#include "mw_unicode.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// mw_unicode.h的测试：与逐个字符的参考实现比较，覆盖长度0到64的输入中每个位置的非ASCII字符和不合法编码，
+// 使向量处理(16和32字节的ASCII块，24字节的3字节序列块)与标量处理之间的每个边界都被经过；
+// 不合法的UTF-8(过长编码，代理项，超出U+10FFFF，截断)和不成对的代理项，输出缓冲区在每个位置不足，随机文本的往返转换。
+// Makefile用默认选项(SSE2)和-mavx2(同时启用SSSE3和AVX2的路径)各编译一次
+
+namespace {
+
+#if defined(MW_UNICODE_AVX2)
+constexpr const char* test_name = "unicode_test(AVX2)";
+#elif defined(MW_UNICODE_SSSE3)
+constexpr const char* test_name = "unicode_test(SSSE3)";
+#elif defined(MW_UNICODE_SSE2)
+constexpr const char* test_name = "unicode_test(SSE2)";
+#else
+constexpr const char* test_name = "unicode_test(标量)";
+#endif
+
+/// <summary>
+/// 参考实现的转换结果
+/// </summary>
+template <typename Output>
+struct reference
+{
+    mw::transcode_status status = mw::transcode_status::ok;
+    size_t read = 0;
+    Output output;
+};
+
+/// <summary>
+/// 逐个字符解码UTF-8，先验证字符，再检查输出空间，与mw::utf8_to_utf16的顺序相同
+/// </summary>
+reference<std::u16string> reference_utf8_to_utf16(const std::string& text, size_t capacity)
+{
+    reference<std::u16string> result;
+    auto& i = result.read;
+    while (i < text.size())
+    {
+        auto lead = static_cast<unsigned char>(text[i]);
+        size_t length = 0;
+        std::uint32_t code_point = 0, minimum = 0;
+        if (lead < 0x80)
+            length = 1, code_point = lead;
+        else if (lead >= 0xC2 && lead <= 0xDF)
+            length = 2, code_point = lead & 0x1F, minimum = 0x80;
+        else if (lead >= 0xE0 && lead <= 0xEF)
+            length = 3, code_point = lead & 0x0F, minimum = 0x800;
+        else if (lead >= 0xF0 && lead <= 0xF4)
+            length = 4, code_point = lead & 0x07, minimum = 0x10000;
+        bool valid = length && text.size() - i >= length;
+        for (size_t k = 1; valid && k < length; k++)
+        {
+            auto byte = static_cast<unsigned char>(text[i + k]);
+            valid = (byte & 0xC0) == 0x80;
+            code_point = (code_point << 6) | (byte & 0x3F);
+        }
+        if (!valid || code_point < minimum || (code_point >= 0xD800 && code_point <= 0xDFFF) || code_point > 0x10FFFF)
+        {
+            result.status = mw::transcode_status::invalid_input;
+            return result;
+        }
+        size_t units = code_point >= 0x10000 ? 2 : 1;
+        if (capacity - result.output.size() < units)
+        {
+            result.status = mw::transcode_status::output_too_small;
+            return result;
+        }
+        if (units == 2)
+        {
+            result.output += static_cast<char16_t>(0xD800 | ((code_point - 0x10000) >> 10));
+            result.output += static_cast<char16_t>(0xDC00 | ((code_point - 0x10000) & 0x3FF));
+        }
+        else
+            result.output += static_cast<char16_t>(code_point);
+        i += length;
+    }
+    return result;
+}
+
+/// <summary>
+/// 把一个码点编码为UTF-8，追加到text
+/// </summary>
+void append_utf8(std::string& text, std::uint32_t code_point)
+{
+    if (code_point < 0x80)
+        text += static_cast<char>(code_point);
+    else if (code_point < 0x800)
+    {
+        text += static_cast<char>(0xC0 | (code_point >> 6));
+        text += static_cast<char>(0x80 | (code_point & 0x3F));
+    }
+    else if (code_point < 0x10000)
+    {
+        text += static_cast<char>(0xE0 | (code_point >> 12));
+        text += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+        text += static_cast<char>(0x80 | (code_point & 0x3F));
+    }
+    else
+    {
+        text += static_cast<char>(0xF0 | (code_point >> 18));
+        text += static_cast<char>(0x80 | ((code_point >> 12) & 0x3F));
+        text += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+        text += static_cast<char>(0x80 | (code_point & 0x3F));
+    }
+}
+
+/// <summary>
+/// 逐个字符编码UTF-16，先验证代理对，再检查输出空间，与mw::utf16_to_utf8的顺序相同
+/// </summary>
+reference<std::string> reference_utf16_to_utf8(const std::u16string& text, size_t capacity)
+{
+    reference<std::string> result;
+    auto& i = result.read;
+    while (i < text.size())
+    {
+        std::uint32_t code_point = text[i];
+        size_t length = 1;
+        if (code_point >= 0xD800 && code_point <= 0xDFFF)
+        {
+            if (code_point >= 0xDC00 || i + 1 == text.size() || text[i + 1] < 0xDC00 || text[i + 1] > 0xDFFF)
+            {
+                result.status = mw::transcode_status::invalid_input;
+                return result;
+            }
+            code_point = 0x10000 + ((code_point & 0x3FF) << 10) + (text[i + 1] & 0x3FF);
+            length = 2;
+        }
+        std::string encoded;
+        append_utf8(encoded, code_point);
+        if (capacity - result.output.size() < encoded.size())
+        {
+            result.status = mw::transcode_status::output_too_small;
+            return result;
+        }
+        result.output += encoded;
+        i += length;
+    }
+    return result;
+}
+
+/// <summary>
+/// 用mw::utf8_to_utf16转换，输出缓冲区恰好是capacity个单元(放在vector中，越界写入会被ASan发现)，与参考实现比较
+/// </summary>
+void compare_utf8(const std::string& text, size_t capacity)
+{
+    auto expected = reference_utf8_to_utf16(text, capacity);
+    std::vector<char16_t> buffer(capacity);
+    auto result = mw::utf8_to_utf16(text.data(), text.size(), buffer.data(), capacity);
+    bool same = result.status == expected.status && result.read == expected.read && result.written == expected.output.size()
+        && std::u16string(buffer.data(), result.written) == expected.output;
+    MW_CHECK(same);
+    if (!same)
+        std::fprintf(stderr, "  UTF-8输入%zu字节，容量%zu，状态%d/%d，read %zu/%zu，written %zu/%zu\n", text.size(), capacity,
+            static_cast<int>(result.status), static_cast<int>(expected.status), result.read, expected.read, result.written,
+            expected.output.size());
+}
+
+void compare_utf16(const std::u16string& text, size_t capacity)
+{
+    auto expected = reference_utf16_to_utf8(text, capacity);
+    std::vector<char> buffer(capacity);
+    auto result = mw::utf16_to_utf8(text.data(), text.size(), buffer.data(), capacity);
+    bool same = result.status == expected.status && result.read == expected.read && result.written == expected.output.size()
+        && std::string(buffer.data(), result.written) == expected.output;
+    MW_CHECK(same);
+    if (!same)
+        std::fprintf(stderr, "  UTF-16输入%zu单元，容量%zu，状态%d/%d，read %zu/%zu，written %zu/%zu\n", text.size(), capacity,
+            static_cast<int>(result.status), static_cast<int>(expected.status), result.read, expected.read, result.written,
+            expected.output.size());
+}
+
+/// <summary>
+/// 检查一个UTF-8输入：足够的输出空间下与参考实现相同；合法时长度计算准确，字符串接口往返后不变；
+/// sweep为true时还检查输出空间为0到所需单元数的每一种情况
+/// </summary>
+void check_utf8(const std::string& text, bool sweep = false)
+{
+    compare_utf8(text, text.size());
+    auto expected = reference_utf8_to_utf16(text, text.size());
+    if (expected.status == mw::transcode_status::ok)
+    {
+        MW_CHECK(mw::utf16_length_of_utf8(text.data(), text.size()) == expected.output.size());
+        MW_CHECK(mw::utf8_length_of_utf16(expected.output.data(), expected.output.size()) == text.size());
+        std::u16string utf16;
+        std::string utf8;
+        MW_CHECK(mw::utf8_to_utf16(text, utf16) && utf16 == expected.output);
+        MW_CHECK(mw::utf16_to_utf8(utf16, utf8) && utf8 == text);
+    }
+    else
+    {
+        std::u16string utf16 = u"x";
+        MW_CHECK(!mw::utf8_to_utf16(text, utf16) && utf16.empty());
+    }
+    if (sweep)
+    {
+        for (size_t capacity = 0; capacity < expected.output.size(); capacity++)
+            compare_utf8(text, capacity);
+    }
+}
+
+void check_utf16(const std::u16string& text, bool sweep = false)
+{
+    compare_utf16(text, text.size() * 3);
+    auto expected = reference_utf16_to_utf8(text, text.size() * 3);
+    if (expected.status == mw::transcode_status::ok)
+        MW_CHECK(mw::utf8_length_of_utf16(text.data(), text.size()) == expected.output.size());
+    else
+    {
+        std::string utf8 = "x";
+        MW_CHECK(!mw::utf16_to_utf8(text, utf8) && utf8.empty());
+    }
+    if (sweep)
+    {
+        for (size_t capacity = 0; capacity < expected.output.size(); capacity++)
+            compare_utf16(text, capacity);
+    }
+}
+
+std::string utf8_of(std::initializer_list<std::uint32_t> code_points)
+{
+    std::string text;
+    for (auto code_point : code_points)
+        append_utf8(text, code_point);
+    return text;
+}
+
+void test_utf8_sequences()
+{
+    // 每种长度的最小值和最大值，以及紧挨着代理项的码点
+    for (auto code_point : { 0x00u, 0x7Fu, 0x80u, 0x7FFu, 0x800u, 0xD7FFu, 0xE000u, 0xFFFFu, 0x10000u, 0x10FFFFu })
+    {
+        auto text = utf8_of({ code_point });
+        auto expected = reference_utf8_to_utf16(text, 2);
+        MW_CHECK(expected.status == mw::transcode_status::ok);
+        check_utf8(text, true);
+    }
+
+    // 过长编码，代理项，超出U+10FFFF，不可能出现的字节，孤立的后续字节，截断的序列
+    const char* const invalid[] = {
+        "\xC0\x80", "\xC1\xBF", "\xE0\x80\x80", "\xE0\x9F\xBF", "\xED\xA0\x80", "\xED\xBF\xBF", "\xF0\x80\x80\x80",
+        "\xF0\x8F\xBF\xBF", "\xF4\x90\x80\x80", "\xF5\x80\x80\x80", "\xF8\x88\x80\x80\x80", "\xFF", "\xFE", "\x80", "\xBF",
+        "\xC3", "\xE4\xB8", "\xF0\x9F\x98", "\xC3\x41", "\xE4\x41\xAD", "\xE4\xB8\x41", "\xF0\x9F\x41\x80",
+    };
+    for (auto item : invalid)
+    {
+        std::string text(item);
+        auto result = mw::utf8_to_utf16(text.data(), text.size(), std::vector<char16_t>(8).data(), 8);
+        MW_CHECK(result.status == mw::transcode_status::invalid_input && result.read == 0 && result.written == 0);
+        // 放在合法文本之后，read指向不合法的序列，之前的输出有效
+        check_utf8("ab\xE4\xB8\xAD" + text + "cd", true);
+    }
+}
+
+void test_utf16_sequences()
+{
+    const std::u16string cases[] = {
+        u"\u0080", u"\u07FF", u"\u0800", u"\uFFFF", u"\U00010000", u"\U0010FFFF", u"\U0001F600",
+        // 孤立的高代理项(在末尾，或者后面不是低代理项)，孤立的低代理项，两个高代理项，颠倒的代理对
+        std::u16string(1, char16_t(0xD800)), std::u16string { char16_t(0xD800), u'a' }, std::u16string(1, char16_t(0xDC00)),
+        std::u16string { char16_t(0xDBFF), char16_t(0xDBFF) }, std::u16string { char16_t(0xDC00), char16_t(0xD800) },
+    };
+    for (auto& item : cases)
+    {
+        check_utf16(item, true);
+        check_utf16(u"ab\u4E2D" + item + u"cd", true);
+    }
+    std::vector<char> buffer(8);
+    auto lone = std::u16string { u'a', char16_t(0xDFFF), u'b' };
+    auto result = mw::utf16_to_utf8(lone.data(), lone.size(), buffer.data(), buffer.size());
+    MW_CHECK(result.status == mw::transcode_status::invalid_input && result.read == 1 && result.written == 1);
+}
+
+void test_boundaries()
+{
+    // UTF-8：长度0到64的ASCII文本，每个位置放入非ASCII字符或不合法的字节
+    const std::string inserts[] = { utf8_of({ 0xE9 }), utf8_of({ 0x4E2D }), utf8_of({ 0x1F600 }), "\x80", "\xC0\x80", "\xED\xA0\x80", "\xE4\xB8" };
+    for (size_t length = 0; length <= 64; length++)
+    {
+        std::string ascii(length, 'a');
+        for (size_t i = 0; i < length; i++)
+            ascii[i] = static_cast<char>('a' + i % 26);
+        check_utf8(ascii, true);
+        for (size_t position = 0; position < length; position++)
+        {
+            for (auto& insert : inserts)
+            {
+                auto text = ascii.substr(0, position) + insert + ascii.substr(position);
+                check_utf8(text.substr(0, (std::max)(length, position + insert.size())), length <= 40);
+            }
+        }
+    }
+
+    // UTF-8：a个ASCII字节之后是count个3字节的中文字符，24字节的块从不同的偏移开始；
+    // 再在每个字节上放入破坏格式，过长编码或代理项的值，向量处理应该在这个块上退回到标量
+    for (size_t prefix = 0; prefix < 32; prefix++)
+    {
+        for (size_t count = 0; prefix + 3 * count <= 64; count++)
+        {
+            std::string text(prefix, 'p');
+            for (size_t i = 0; i < count; i++)
+                append_utf8(text, 0x4E00 + static_cast<std::uint32_t>(i * 37));
+            check_utf8(text, count % 4 == 0);
+            for (size_t position = prefix; position < text.size(); position++)
+            {
+                for (char replacement : { '\x41', '\xC3', '\x80', '\xE0', '\xED', '\xA0' })
+                {
+                    auto broken = text;
+                    broken[position] = replacement;
+                    check_utf8(broken);
+                }
+            }
+        }
+    }
+
+    // UTF-16：长度0到64的ASCII文本，每个位置放入2字节，3字节，代理对或不成对的代理项
+    const std::u16string unit_inserts[] = {
+        u"\u00E9", u"\u4E2D", u"\U0001F600", std::u16string(1, char16_t(0xD800)), std::u16string(1, char16_t(0xDC00)), u"\uFFFF",
+    };
+    for (size_t length = 0; length <= 64; length++)
+    {
+        std::u16string ascii(length, u'a');
+        for (size_t i = 0; i < length; i++)
+            ascii[i] = static_cast<char16_t>(u'a' + i % 26);
+        check_utf16(ascii, true);
+        for (size_t position = 0; position <= length; position++)
+        {
+            for (auto& insert : unit_inserts)
+                check_utf16(ascii.substr(0, position) + insert + ascii.substr(position), length <= 40);
+        }
+    }
+
+    // UTF-16：prefix个ASCII单元之后是count个中文字符，8个单元的块从不同的偏移开始，每个位置换成其他类别的单元
+    for (size_t prefix = 0; prefix < 16; prefix++)
+    {
+        for (size_t count = 0; prefix + count <= 64; count++)
+        {
+            std::u16string text(prefix, u'p');
+            for (size_t i = 0; i < count; i++)
+                text += static_cast<char16_t>(0x4E00 + i * 37);
+            check_utf16(text, count % 4 == 0);
+            for (size_t position = prefix; position < text.size(); position++)
+            {
+                for (char16_t replacement : { char16_t(0x41), char16_t(0xE9), char16_t(0x7FF), char16_t(0xD800), char16_t(0xDC00) })
+                {
+                    auto broken = text;
+                    broken[position] = replacement;
+                    check_utf16(broken);
+                }
+            }
+        }
+    }
+}
+
+void test_round_trip()
+{
+    // 随机文本由各种长度的码点组成，偏向较长的同类字符连续出现，使向量处理经常被用到
+    std::uint64_t state = 0x9E3779B97F4A7C15ULL;
+    auto next = [&] {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    };
+    const std::uint32_t ranges[][2] = { { 0x20, 0x7F }, { 0x80, 0x800 }, { 0x800, 0xD800 }, { 0xE000, 0x10000 }, { 0x10000, 0x110000 } };
+    for (int i = 0; i < 3000; i++)
+    {
+        std::string text;
+        for (auto runs = next() % 8; runs > 0; runs--)
+        {
+            auto& range = ranges[next() % 5];
+            for (auto count = next() % 40; count > 0; count--)
+                append_utf8(text, range[0] + static_cast<std::uint32_t>(next() % (range[1] - range[0])));
+        }
+        check_utf8(text);
+        auto utf16 = reference_utf8_to_utf16(text, text.size()).output;
+        check_utf16(utf16);
+    }
+
+    // 调用者缓冲区的接口
+    char16_t units[4];
+    auto result = mw::transcode_into(std::string_view("\xE4\xB8\xAD\xF0\x9F\x98\x80"), units);
+    MW_CHECK(result.status == mw::transcode_status::ok && result.read == 7 && result.written == 3);
+    char bytes[6];
+    result = mw::transcode_into(std::u16string_view(units, 3), bytes);
+    MW_CHECK(result.status == mw::transcode_status::output_too_small && result.read == 1 && result.written == 3);
+}
+
+} // namespace
+
+int main()
+{
+#if defined(MW_UNICODE_AVX2)
+    if (!__builtin_cpu_supports("avx2"))
+    {
+        std::printf("%s: 跳过(CPU不支持AVX2)\n", test_name);
+        return 0;
+    }
+#endif
+    test_utf8_sequences();
+    test_utf16_sequences();
+    test_boundaries();
+    test_round_trip();
+    return mw_test::finish(test_name);
+}
@@ -0,0 +1,168 @@
+#pragma once
+#ifndef _WIN32
+// Linux上没有预编译头，只编译使用tcp_server的epoll后端的reactor，coalescing和http模式，见my_windows_linux_test/Makefile
+#    include "mw_http.h"
+#    include "mw_latency_histogram.h"
+#    include "mw_tcp_server.h"
+#    include <arpa/inet.h>
+#    include <iostream>
+#endif
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <memory>
+
+/// <summary>
+/// 客户端发送请求的方式
+/// </summary>
+enum class load_pattern
+{
+    /// <summary>闭环：每个连接保持depth个请求在途，收到一个响应才发送下一个请求</summary>
+    closed_loop,
+    /// <summary>开环：按固定的速率发送请求，不管响应是否已经到达，延迟从请求计划发送的时间算起</summary>
+    open_loop,
+};
+
+/// <summary>
+/// 一次测试的配置
+/// </summary>
+struct bench_config
+{
+    DWORD connections = 64;
+    load_pattern pattern = load_pattern::closed_loop;
+    /// <summary>闭环时每个连接在途的请求数</summary>
+    DWORD depth = 1;
+    /// <summary>开环时所有连接每秒发送的请求总数</summary>
+    DWORD rate = 100000;
+    /// <summary>请求(和响应)的字节数，至少为8，前8字节是请求计划发送的时间</summary>
+    DWORD message_size = 64;
+    /// <summary>预热的秒数，这期间发送的请求不计入结果</summary>
+    DWORD warmup_seconds = 1;
+    /// <summary>测量的秒数</summary>
+    DWORD duration_seconds = 5;
+    /// <summary>测量结束后等待在途响应的毫秒数，之后仍未到达的响应计入unanswered</summary>
+    DWORD drain_milliseconds = 2000;
+    /// <summary>服务器监听的端口，每个模式使用不同的端口(port + 模式的序号)</summary>
+    USHORT port = 10100;
+};
+
+/// <summary>
+/// 一次测试的结果
+/// </summary>
+struct bench_result
+{
+    /// <summary>测量期间发出的请求的延迟(纳秒)</summary>
+    mw::latency_histogram latency;
+    /// <summary>测量期间发出但没有在drain_milliseconds内得到响应的请求数</summary>
+    ULONGLONG unanswered = 0;
+    /// <summary>服务器回显的消息总数(包括预热期间)</summary>
+    ULONGLONG server_messages = 0;
+    /// <summary>服务器调用发送函数的总次数，与server_messages比较可以看出合并的效果</summary>
+    ULONGLONG server_send_calls = 0;
+    /// <summary>失败的连接数</summary>
+    ULONGLONG failed_connections = 0;
+};
+
+/// <summary>
+/// 一种被测试的实现，它负责启动自己的回显服务器和客户端，并按配置产生负载
+/// </summary>
+class bench_mode
+{
+public:
+    virtual ~bench_mode() = default;
+
+    virtual const char* name() const = 0;
+    virtual const char* description() const = 0;
+
+    /// <summary>
+    /// 运行一次测试
+    /// </summary>
+    /// <param name="config">测试的配置</param>
+    /// <param name="port">回显服务器监听的端口</param>
+    /// <param name="result">[out]测试的结果</param>
+    /// <returns>若服务器无法启动，返回false</returns>
+    virtual bool run(const bench_config& config, USHORT port, bench_result& result) = 0;
+};
+
+/// <summary>tcp_server的反应器，coalescing为false时关闭发送队列的合并(flush_threshold为0)</summary>
+std::unique_ptr<bench_mode> create_reactor_mode(bool coalescing);
+/// <summary>http_server和保持连接的GET请求，类似wrk</summary>
+std::unique_ptr<bench_mode> create_http_mode();
+#ifdef _WIN32
+/// <summary>阻塞的socket_send/socket_recv，每个连接一个线程</summary>
+std::unique_ptr<bench_mode> create_blocking_mode();
+#endif
+
+namespace bench {
+
+/// <summary>单调时钟的当前时间(纳秒)</summary>
+inline ULONGLONG now()
+{
+    auto time = std::chrono::steady_clock::now().time_since_epoch();
+    return static_cast<ULONGLONG>(std::chrono::duration_cast<std::chrono::nanoseconds>(time).count());
+}
+
+/// <summary>把请求计划发送的时间写到消息的前8字节</summary>
+inline void stamp(char* message, ULONGLONG time)
+{
+    std::memcpy(message, &time, sizeof(time));
+}
+
+/// <summary>读取响应中的请求计划发送的时间</summary>
+inline ULONGLONG read_stamp(const char* message)
+{
+    ULONGLONG time = 0;
+    std::memcpy(&time, message, sizeof(time));
+    return time;
+}
+
+/// <summary>
+/// 测量窗口，计划发送时间在[begin, end)中的请求计入结果
+/// </summary>
+struct window
+{
+    ULONGLONG start = 0;
+    ULONGLONG begin = 0;
+    ULONGLONG end = 0;
+    ULONGLONG drain_end = 0;
+
+    window() = default;
+    window(const bench_config& config, ULONGLONG start)
+        : start(start)
+        , begin(start + config.warmup_seconds * 1000000000ULL)
+        , end(begin + config.duration_seconds * 1000000000ULL)
+        , drain_end(end + config.drain_milliseconds * 1000000ULL)
+    {
+    }
+
+    bool contains(ULONGLONG time) const { return time >= begin && time < end; }
+};
+
+/// <summary>
+/// 开环负载中一个连接的发送计划，所有连接的请求在时间上均匀错开
+/// </summary>
+struct schedule
+{
+    ULONGLONG next = 0;
+    ULONGLONG interval = 0;
+
+    schedule() = default;
+    schedule(const bench_config& config, ULONGLONG start, DWORD connection_index)
+    {
+        auto rate = (std::max)(config.rate, static_cast<DWORD>(1));
+        interval = static_cast<ULONGLONG>(1000000000.0 * config.connections / rate);
+        next = start + interval * connection_index / config.connections;
+    }
+
+    /// <summary>若下一个请求已经到了计划时间，返回true并把它的计划时间写入time</summary>
+    bool due(ULONGLONG now, ULONGLONG& time)
+    {
+        if (next > now)
+            return false;
+        time = next;
+        next += interval;
+        return true;
+    }
+};
+
+} // namespace bench
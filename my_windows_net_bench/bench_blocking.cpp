@@ -0,0 +1,248 @@
+#include "bench.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace {
+
+/// <summary>
+/// 接收恰好size字节
+/// </summary>
+/// <returns>若连接被关闭，接收超时或失败，返回false</returns>
+bool recv_all(SOCKET socket, char* buffer, int size)
+{
+    for (int received = 0; received < size;)
+    {
+        auto bytes = mw::socket::socket_recv(socket, buffer + received, size - received);
+        if (bytes <= 0)
+            return false;
+        received += bytes;
+    }
+    return true;
+}
+
+bool send_all(SOCKET socket, const char* buffer, int size)
+{
+    for (int sent = 0; sent < size;)
+    {
+        auto bytes = mw::socket::socket_send(socket, buffer + sent, size - sent);
+        if (bytes <= 0)
+            return false;
+        sent += bytes;
+    }
+    return true;
+}
+
+void set_no_delay(SOCKET socket)
+{
+    BOOL value = TRUE;
+    setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+/// <summary>
+/// 阻塞模式：服务器为每个接受的连接创建一个线程，用socket_recv接收，再用socket_send原样发回；
+/// 客户端的每个连接也有自己的接收线程，开环时由一个线程按计划为所有连接发送请求
+/// </summary>
+class blocking_mode : public bench_mode
+{
+public:
+    const char* name() const override { return "blocking"; }
+    const char* description() const override { return "阻塞的socket_send/socket_recv，每个连接一个线程"; }
+
+    bool run(const bench_config& config, USHORT port, bench_result& result) override
+    {
+        this->config = config;
+        server_bytes = 0;
+        server_send_calls = 0;
+
+        sockaddr_in address = { 0 };
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        listen_socket = mw::socket::create_socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (listen_socket == INVALID_SOCKET)
+            return false;
+        if (mw::socket::socket_bind(listen_socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == SOCKET_ERROR
+            || mw::socket::socket_listen(listen_socket) == SOCKET_ERROR)
+        {
+            mw::socket::close_socket(listen_socket);
+            return false;
+        }
+        std::thread acceptor([this] { accept_loop(); });
+
+        // 所有连接都建立后才开始计时
+        clients.clear();
+        for (DWORD i = 0; i < config.connections; i++)
+        {
+            auto client = std::make_unique<client_state>();
+            client->socket = mw::socket::create_socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+            if (client->socket == INVALID_SOCKET
+                || mw::socket::socket_connect(client->socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == SOCKET_ERROR)
+            {
+                if (client->socket != INVALID_SOCKET)
+                    mw::socket::close_socket(client->socket);
+                result.failed_connections++;
+                continue;
+            }
+            set_no_delay(client->socket);
+            // 测量结束后最多等待drain_milliseconds，之后接收线程放弃剩余的响应，开环时还要加上每个连接发送请求的间隔
+            DWORD timeout = config.drain_milliseconds;
+            if (config.pattern == load_pattern::open_loop)
+                timeout += static_cast<DWORD>(1000ULL * config.connections / (std::max)(config.rate, static_cast<DWORD>(1)));
+            setsockopt(client->socket, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&timeout), sizeof(timeout));
+            clients.push_back(std::move(client));
+        }
+
+        window = bench::window(config, bench::now());
+        std::vector<std::thread> threads;
+        for (auto& client : clients)
+        {
+            auto state = client.get();
+            if (config.pattern == load_pattern::closed_loop)
+                threads.emplace_back([this, state] { closed_loop(*state); });
+            else
+                threads.emplace_back([this, state] { receive_loop(*state); });
+        }
+        if (config.pattern == load_pattern::open_loop)
+            pace();
+        for (auto& thread : threads)
+            thread.join();
+
+        for (auto& client : clients)
+        {
+            mw::socket::close_socket(client->socket);
+            result.latency.merge(client->latency);
+            result.unanswered += client->sent_in_window - client->latency.count();
+        }
+        clients.clear();
+
+        // 关闭监听套接字让accept返回，服务器线程在客户端关闭连接后退出
+        mw::socket::close_socket(listen_socket);
+        acceptor.join();
+        result.server_messages = server_bytes.load() / config.message_size;
+        result.server_send_calls = server_send_calls.load();
+        return true;
+    }
+
+private:
+    struct client_state
+    {
+        SOCKET socket = INVALID_SOCKET;
+        mw::latency_histogram latency;
+        ULONGLONG sent_in_window = 0;
+    };
+
+    void accept_loop()
+    {
+        std::vector<std::thread> servers;
+        for (;;)
+        {
+            auto socket = mw::socket::socket_accept(listen_socket);
+            if (socket == INVALID_SOCKET)
+                break;
+            set_no_delay(socket);
+            servers.emplace_back([this, socket] { serve(socket); });
+        }
+        for (auto& thread : servers)
+            thread.join();
+    }
+
+    void serve(SOCKET socket)
+    {
+        std::vector<char> buffer(64 * 1024);
+        for (;;)
+        {
+            auto bytes = mw::socket::socket_recv(socket, buffer.data(), static_cast<int>(buffer.size()));
+            if (bytes <= 0 || !send_all(socket, buffer.data(), bytes))
+                break;
+            server_bytes.fetch_add(bytes, std::memory_order_relaxed);
+            server_send_calls.fetch_add(1, std::memory_order_relaxed);
+        }
+        mw::socket::close_socket(socket);
+    }
+
+    bool send_request(client_state& client, std::vector<char>& message, ULONGLONG time)
+    {
+        bench::stamp(message.data(), time);
+        if (!send_all(client.socket, message.data(), static_cast<int>(message.size())))
+            return false;
+        if (window.contains(time))
+            client.sent_in_window++;
+        return true;
+    }
+
+    void receive_response(client_state& client, const std::vector<char>& message)
+    {
+        auto time = bench::read_stamp(message.data());
+        if (window.contains(time))
+            client.latency.record(bench::now() - time);
+    }
+
+    void closed_loop(client_state& client)
+    {
+        std::vector<char> message(config.message_size);
+        DWORD in_flight = 0;
+        for (; in_flight < config.depth; in_flight++)
+        {
+            if (!send_request(client, message, bench::now()))
+                break;
+        }
+        while (in_flight && recv_all(client.socket, message.data(), static_cast<int>(message.size())))
+        {
+            in_flight--;
+            receive_response(client, message);
+            auto now = bench::now();
+            if (now < window.end && send_request(client, message, now))
+                in_flight++;
+        }
+        mw::socket::socket_shutdown(client.socket, SD_SEND);
+    }
+
+    void receive_loop(client_state& client)
+    {
+        std::vector<char> message(config.message_size);
+        while (recv_all(client.socket, message.data(), static_cast<int>(message.size())))
+            receive_response(client, message);
+    }
+
+    /// <summary>
+    /// 开环的发送线程，按每个连接的计划发送请求，之后关闭发送方向，服务器发回剩余的响应后关闭连接，接收线程随之退出
+    /// </summary>
+    void pace()
+    {
+        std::vector<bench::schedule> schedules;
+        for (DWORD i = 0; i < clients.size(); i++)
+            schedules.emplace_back(config, window.start, i);
+
+        std::vector<char> message(config.message_size);
+        for (auto now = bench::now(); now < window.end; now = bench::now())
+        {
+            bool sent = false;
+            for (size_t i = 0; i < clients.size(); i++)
+            {
+                ULONGLONG time = 0;
+                while (schedules[i].due(now, time) && send_request(*clients[i], message, time))
+                    sent = true;
+            }
+            if (!sent)
+                SwitchToThread();
+        }
+        for (auto& client : clients)
+            mw::socket::socket_shutdown(client->socket, SD_SEND);
+    }
+
+    bench_config config;
+    bench::window window;
+    SOCKET listen_socket = INVALID_SOCKET;
+    std::vector<std::unique_ptr<client_state>> clients;
+    std::atomic<ULONGLONG> server_bytes { 0 };
+    std::atomic<ULONGLONG> server_send_calls { 0 };
+};
+
+} // namespace
+
+std::unique_ptr<bench_mode> create_blocking_mode()
+{
+    return std::make_unique<blocking_mode>();
+}
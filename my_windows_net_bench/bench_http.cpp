@@ -0,0 +1,224 @@
+#include "bench.h"
+#include <atomic>
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace {
+
+/// <summary>
+/// HTTP模式：服务器是http_server，对GET /响应固定的短文本，客户端像wrk一样在保持的连接上反复发送GET请求。
+/// 响应按请求的顺序到达，所以客户端按顺序记录每个在途请求的计划发送时间，message_size不起作用
+/// </summary>
+class http_mode : public bench_mode
+{
+public:
+    const char* name() const override { return "http"; }
+    const char* description() const override { return "http_server，保持连接的GET请求"; }
+
+    bool run(const bench_config& config, USHORT port, bench_result& result) override
+    {
+        this->config = config;
+        in_flight = 0;
+
+        mw::net::http_server server([](mw::net::tcp_connection&, const mw::net::http_request&, mw::net::http_response& response) {
+            response.header("Content-Type", "text/plain");
+            response.end(std::string_view("Hello, World!"));
+        });
+        if (!server.start(port))
+            return false;
+
+        request = "GET / HTTP/1.1\r\nHost: 127.0.0.1:" + std::to_string(port) + "\r\n\r\n";
+        response_size = std::string_view("HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\nContent-Length: 13\r\n\r\nHello, World!").size();
+
+        mw::net::tcp_handler client_handler;
+        client_handler.on_connect = [this](mw::net::tcp_connection& connection) {
+            auto client = static_cast<client_state*>(connection.user_data);
+            client->connection = &connection;
+            reactor_clients[connection.reactor_index()].push_back(client);
+            connected.fetch_add(1);
+        };
+        client_handler.on_connect_failed = [this](void*, int) {
+            failed.fetch_add(1);
+            connected.fetch_add(1);
+        };
+        client_handler.on_data = [this](mw::net::tcp_connection& connection, const char*, size_t size) -> size_t {
+            return on_response(*static_cast<client_state*>(connection.user_data), size);
+        };
+        client_handler.on_close = [](mw::net::tcp_connection& connection) {
+            static_cast<client_state*>(connection.user_data)->connection = nullptr;
+        };
+
+        mw::net::tcp_server client(client_handler);
+        if (!client.start())
+            return false;
+        reactor_clients.assign(client.get_options().reactor_count, {});
+        connected = 0;
+        failed = 0;
+
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        clients.clear();
+        for (DWORD i = 0; i < config.connections; i++)
+        {
+            clients.push_back(std::make_unique<client_state>());
+            clients.back()->index = i;
+            if (!client.connect(reinterpret_cast<sockaddr*>(&address), sizeof(address), clients.back().get()))
+            {
+                failed.fetch_add(1);
+                connected.fetch_add(1);
+            }
+        }
+
+        auto connect_deadline = mw::get_system_time() + 10000;
+        while (connected.load() < config.connections && mw::get_system_time() < connect_deadline)
+            Sleep(10);
+
+        window = bench::window(config, bench::now());
+        for (DWORD i = 0; i < reactor_clients.size(); i++)
+        {
+            client.post(i, [this, i] {
+                for (auto state : reactor_clients[i])
+                {
+                    if (this->config.pattern == load_pattern::closed_loop)
+                    {
+                        for (DWORD j = 0; j < this->config.depth; j++)
+                            send_request(*state, bench::now());
+                    }
+                    else
+                        state->plan = bench::schedule(this->config, window.start, state->index);
+                }
+            });
+        }
+
+        if (config.pattern == load_pattern::open_loop)
+            pace(client);
+        else
+        {
+            auto now = bench::now();
+            if (now < window.end)
+                Sleep(static_cast<DWORD>((window.end - now) / 1000000));
+        }
+
+        while (in_flight.load() > 0 && bench::now() < window.drain_end)
+            Sleep(1);
+
+        client.stop();
+        server.stop();
+
+        for (auto& state : clients)
+        {
+            result.latency.merge(state->latency);
+            result.unanswered += state->sent_in_window - state->latency.count();
+        }
+        clients.clear();
+        reactor_clients.clear();
+        auto stats = server.stats();
+        result.failed_connections = failed.load();
+        result.server_messages = stats.requests;
+        result.server_send_calls = stats.server.send_calls;
+        return true;
+    }
+
+private:
+    /// <summary>
+    /// 一个客户端连接的状态，只在连接所属的反应器线程中修改
+    /// </summary>
+    struct client_state
+    {
+        DWORD index = 0;
+        mw::net::tcp_connection* connection = nullptr;
+        /// <summary>在途请求的计划发送时间，响应按同样的顺序到达</summary>
+        std::deque<ULONGLONG> pending;
+        mw::latency_histogram latency;
+        bench::schedule plan;
+        ULONGLONG sent_in_window = 0;
+    };
+
+    void send_request(client_state& client, ULONGLONG time)
+    {
+        if (!client.connection)
+            return;
+        if (window.contains(time))
+            client.sent_in_window++;
+        if (client.connection->send(request.data(), request.size()))
+        {
+            client.pending.push_back(time);
+            in_flight.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    /// <summary>
+    /// 所有响应的长度都相同，所以只需要按长度切分，数据本身不需要查看
+    /// </summary>
+    size_t on_response(client_state& client, size_t size)
+    {
+        size_t consumed = 0;
+        for (; size - consumed >= response_size && !client.pending.empty(); consumed += response_size)
+        {
+            auto now = bench::now();
+            auto time = client.pending.front();
+            client.pending.pop_front();
+            if (window.contains(time))
+                client.latency.record(now - time);
+            in_flight.fetch_sub(1, std::memory_order_relaxed);
+            if (config.pattern == load_pattern::closed_loop && now < window.end)
+                send_request(client, now);
+        }
+        return consumed;
+    }
+
+    /// <summary>
+    /// 开环时定期在每个反应器中发送已经到了计划时间的请求，与反应器模式相同
+    /// </summary>
+    void pace(mw::net::tcp_server& client)
+    {
+        std::vector<std::atomic<bool>> posted_calls(reactor_clients.size());
+        for (auto now = bench::now(); now < window.end; now = bench::now())
+        {
+            for (DWORD i = 0; i < reactor_clients.size(); i++)
+            {
+                if (posted_calls[i].exchange(true))
+                    continue;
+                auto posted = client.post(i, [this, i, &posted_calls] {
+                    auto now = bench::now();
+                    for (auto state : reactor_clients[i])
+                    {
+                        ULONGLONG time = 0;
+                        while (now < window.end && state->plan.due(now, time))
+                            send_request(*state, time);
+                    }
+                    posted_calls[i].store(false);
+                });
+                if (!posted)
+                    posted_calls[i].store(false);
+            }
+            auto next = now + 50000;
+            while (bench::now() < next)
+                SwitchToThread();
+        }
+
+        for (auto& flag : posted_calls)
+            while (flag.load())
+                SwitchToThread();
+    }
+
+    bench_config config;
+    bench::window window;
+    std::string request;
+    size_t response_size = 0;
+    std::vector<std::unique_ptr<client_state>> clients;
+    std::vector<std::vector<client_state*>> reactor_clients;
+    std::atomic<DWORD> connected { 0 };
+    std::atomic<ULONGLONG> failed { 0 };
+    std::atomic<LONGLONG> in_flight { 0 };
+};
+
+} // namespace
+
+std::unique_ptr<bench_mode> create_http_mode()
+{
+    return std::make_unique<http_mode>();
+}
@@ -0,0 +1,242 @@
+#include "bench.h"
+#include <atomic>
+#include <vector>
+
+namespace {
+
+/// <summary>
+/// 反应器模式：服务器和客户端都是tcp_server，服务器对收到的每个消息单独调用一次send。
+/// 合并时同一轮完成数据包处理中的send被合并为一次WSASend，不合并时每次send都立即发送
+/// </summary>
+class reactor_mode : public bench_mode
+{
+public:
+    explicit reactor_mode(bool coalescing)
+        : coalescing(coalescing)
+    {
+    }
+
+    const char* name() const override { return coalescing ? "coalescing" : "reactor"; }
+    const char* description() const override
+    {
+        return coalescing ? "tcp_server，发送队列合并同一轮中的小写入" : "tcp_server，每次send立即调用WSASend";
+    }
+
+    bool run(const bench_config& config, USHORT port, bench_result& result) override
+    {
+        this->config = config;
+        server_messages = 0;
+        in_flight = 0;
+
+        mw::net::tcp_server_options options;
+        if (!coalescing)
+            options.send_queue.flush_threshold = 0;
+
+        mw::net::tcp_handler server_handler;
+        server_handler.on_data = [this](mw::net::tcp_connection& connection, const char* data, size_t size) -> size_t {
+            size_t consumed = 0;
+            for (; size - consumed >= this->config.message_size; consumed += this->config.message_size)
+            {
+                if (!connection.send(data + consumed, this->config.message_size))
+                    break;
+                server_messages.fetch_add(1, std::memory_order_relaxed);
+            }
+            return consumed;
+        };
+
+        mw::net::tcp_server server(server_handler, options);
+        if (!server.start() || !server.listen(port))
+            return false;
+
+        mw::net::tcp_handler client_handler;
+        client_handler.on_connect = [this](mw::net::tcp_connection& connection) {
+            auto client = static_cast<client_state*>(connection.user_data);
+            client->connection = &connection;
+            reactor_clients[connection.reactor_index()].push_back(client);
+            connected.fetch_add(1);
+        };
+        client_handler.on_connect_failed = [this](void*, int) {
+            failed.fetch_add(1);
+            connected.fetch_add(1);
+        };
+        client_handler.on_data = [this](mw::net::tcp_connection& connection, const char* data, size_t size) -> size_t {
+            return on_response(*static_cast<client_state*>(connection.user_data), data, size);
+        };
+        client_handler.on_close = [](mw::net::tcp_connection& connection) {
+            static_cast<client_state*>(connection.user_data)->connection = nullptr;
+        };
+
+        mw::net::tcp_server client(client_handler, options);
+        if (!client.start())
+            return false;
+        reactor_clients.assign(client.get_options().reactor_count, {});
+        connected = 0;
+        failed = 0;
+
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        clients.clear();
+        for (DWORD i = 0; i < config.connections; i++)
+        {
+            clients.push_back(std::make_unique<client_state>());
+            clients.back()->index = i;
+            clients.back()->message.resize(config.message_size);
+            if (!client.connect(reinterpret_cast<sockaddr*>(&address), sizeof(address), clients.back().get()))
+            {
+                failed.fetch_add(1);
+                connected.fetch_add(1);
+            }
+        }
+
+        // 所有连接都建立(或失败)后才开始计时
+        auto connect_deadline = mw::get_system_time() + 10000;
+        while (connected.load() < config.connections && mw::get_system_time() < connect_deadline)
+            Sleep(10);
+
+        // 窗口在投递第一个调用之前设置，反应器线程在调用中和之后的回调中读取它
+        window = bench::window(config, bench::now());
+        for (DWORD i = 0; i < reactor_clients.size(); i++)
+        {
+            client.post(i, [this, i] {
+                for (auto state : reactor_clients[i])
+                {
+                    if (this->config.pattern == load_pattern::closed_loop)
+                    {
+                        for (DWORD j = 0; j < this->config.depth; j++)
+                            send_request(*state, bench::now());
+                    }
+                    else
+                        state->plan = bench::schedule(this->config, window.start, state->index);
+                }
+            });
+        }
+
+        if (config.pattern == load_pattern::open_loop)
+            pace(client);
+        else
+        {
+            auto now = bench::now();
+            if (now < window.end)
+                Sleep(static_cast<DWORD>((window.end - now) / 1000000));
+        }
+
+        // 等待在途的响应
+        while (in_flight.load() > 0 && bench::now() < window.drain_end)
+            Sleep(1);
+
+        client.stop();
+        server.stop();
+
+        for (auto& state : clients)
+        {
+            result.latency.merge(state->latency);
+            result.unanswered += state->sent_in_window - state->latency.count();
+        }
+        clients.clear();
+        reactor_clients.clear();
+        result.failed_connections = failed.load();
+        result.server_messages = server_messages.load();
+        result.server_send_calls = server.stats().send_calls;
+        return true;
+    }
+
+private:
+    /// <summary>
+    /// 一个客户端连接的状态，只在连接所属的反应器线程中修改
+    /// </summary>
+    struct client_state
+    {
+        DWORD index = 0;
+        mw::net::tcp_connection* connection = nullptr;
+        /// <summary>发送请求的缓冲区，send会把它复制到发送队列中</summary>
+        std::vector<char> message;
+        mw::latency_histogram latency;
+        bench::schedule plan;
+        ULONGLONG sent_in_window = 0;
+    };
+
+    void send_request(client_state& client, ULONGLONG time)
+    {
+        if (!client.connection)
+            return;
+        // 发送队列已满而无法发送的请求也计入sent_in_window，这样它们会作为没有响应的请求出现在结果中
+        if (window.contains(time))
+            client.sent_in_window++;
+        bench::stamp(client.message.data(), time);
+        if (client.connection->send(client.message.data(), config.message_size))
+            in_flight.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    size_t on_response(client_state& client, const char* data, size_t size)
+    {
+        size_t consumed = 0;
+        for (; size - consumed >= config.message_size; consumed += config.message_size)
+        {
+            auto now = bench::now();
+            auto time = bench::read_stamp(data + consumed);
+            if (window.contains(time))
+                client.latency.record(now - time);
+            in_flight.fetch_sub(1, std::memory_order_relaxed);
+            if (config.pattern == load_pattern::closed_loop && now < window.end)
+                send_request(client, now);
+        }
+        return consumed;
+    }
+
+    /// <summary>
+    /// 开环时定期在每个反应器中发送已经到了计划时间的请求，每个反应器最多只有一个这样的调用在排队
+    /// </summary>
+    void pace(mw::net::tcp_server& client)
+    {
+        std::vector<std::atomic<bool>> pending(reactor_clients.size());
+        for (auto now = bench::now(); now < window.end; now = bench::now())
+        {
+            for (DWORD i = 0; i < reactor_clients.size(); i++)
+            {
+                if (pending[i].exchange(true))
+                    continue;
+                auto posted = client.post(i, [this, i, &pending] {
+                    auto now = bench::now();
+                    for (auto state : reactor_clients[i])
+                    {
+                        ULONGLONG time = 0;
+                        while (now < window.end && state->plan.due(now, time))
+                            send_request(*state, time);
+                    }
+                    pending[i].store(false);
+                });
+                if (!posted)
+                    pending[i].store(false);
+            }
+            // 间隔50微秒，开环的延迟中包括这个发送的误差
+            auto next = now + 50000;
+            while (bench::now() < next)
+                SwitchToThread();
+        }
+
+        // 等待排队的调用完成，之后不会再发送请求
+        for (auto& flag : pending)
+            while (flag.load())
+                SwitchToThread();
+    }
+
+    bool coalescing;
+    bench_config config;
+    bench::window window;
+    std::vector<std::unique_ptr<client_state>> clients;
+    /// <summary>每个反应器上已经建立的客户端连接，只在该反应器线程中修改</summary>
+    std::vector<std::vector<client_state*>> reactor_clients;
+    std::atomic<DWORD> connected { 0 };
+    std::atomic<ULONGLONG> failed { 0 };
+    std::atomic<ULONGLONG> server_messages { 0 };
+    std::atomic<LONGLONG> in_flight { 0 };
+};
+
+} // namespace
+
+std::unique_ptr<bench_mode> create_reactor_mode(bool coalescing)
+{
+    return std::make_unique<reactor_mode>(coalescing);
+}
@@ -0,0 +1,170 @@
+#include "bench.h"
+#include <cstdlib>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+namespace {
+
+void print_usage()
+{
+    std::cout << "用法: my_windows_net_bench [选项]\n"
+                 "  --mode <名字>        blocking, reactor, coalescing, http 或 all(默认)，可以用逗号分隔多个，Linux上没有blocking\n"
+                 "  --connections <n>    连接数(默认64)\n"
+                 "  --pattern <p>        closed(闭环，默认) 或 open(开环，固定速率)\n"
+                 "  --depth <n>          闭环时每个连接在途的请求数(默认1)\n"
+                 "  --rate <n>           开环时所有连接每秒的请求总数(默认100000)\n"
+                 "  --size <n>           请求的字节数，至少为8(默认64)，http模式使用固定的GET请求\n"
+                 "  --warmup <秒>        预热时间(默认1)\n"
+                 "  --duration <秒>      测量时间(默认5)\n"
+                 "  --port <n>           第一个模式的服务器端口，之后的模式依次加1(默认10100)\n";
+}
+
+/// <summary>
+/// 解析命令行参数
+/// </summary>
+/// <returns>若参数不合法，返回false</returns>
+bool parse_arguments(int argc, char* argv[], bench_config& config, std::vector<std::string>& modes)
+{
+    std::string mode_list = "all";
+    for (int i = 1; i < argc; i++)
+    {
+        std::string name = argv[i];
+        if (name == "--help" || i + 1 >= argc)
+            return false;
+        std::string value = argv[++i];
+        auto number = static_cast<DWORD>(std::strtoul(value.c_str(), nullptr, 10));
+        if (name == "--mode")
+            mode_list = value;
+        else if (name == "--connections")
+            config.connections = number;
+        else if (name == "--pattern" && (value == "closed" || value == "open"))
+            config.pattern = value == "open" ? load_pattern::open_loop : load_pattern::closed_loop;
+        else if (name == "--depth")
+            config.depth = number;
+        else if (name == "--rate")
+            config.rate = number;
+        else if (name == "--size")
+            config.message_size = number;
+        else if (name == "--warmup")
+            config.warmup_seconds = number;
+        else if (name == "--duration")
+            config.duration_seconds = number;
+        else if (name == "--port")
+            config.port = static_cast<USHORT>(number);
+        else
+            return false;
+    }
+    if (!config.connections || !config.depth || !config.rate || !config.duration_seconds || config.message_size < sizeof(ULONGLONG))
+        return false;
+
+    if (mode_list == "all")
+#ifdef _WIN32
+        mode_list = "blocking,reactor,coalescing,http";
+#else
+        mode_list = "reactor,coalescing,http";
+#endif
+    for (size_t begin = 0; begin <= mode_list.size();)
+    {
+        auto end = (std::min)(mode_list.find(',', begin), mode_list.size());
+        modes.push_back(mode_list.substr(begin, end - begin));
+        begin = end + 1;
+    }
+    return true;
+}
+
+std::unique_ptr<bench_mode> create_mode(const std::string& name)
+{
+    if (name == "reactor")
+        return create_reactor_mode(false);
+    if (name == "coalescing")
+        return create_reactor_mode(true);
+    if (name == "http")
+        return create_http_mode();
+#ifdef _WIN32
+    if (name == "blocking")
+        return create_blocking_mode();
+#endif
+    return nullptr;
+}
+
+void print_result(const bench_mode& mode, const bench_config& config, const bench_result& result)
+{
+    auto& latency = result.latency;
+    auto microseconds = [&](double percentile) { return static_cast<double>(latency.value_at_percentile(percentile)) / 1000; };
+    std::cout << std::fixed << std::setprecision(1)
+              << std::left << std::setw(12) << mode.name() << std::right
+              << std::setw(12) << static_cast<double>(latency.count()) / config.duration_seconds
+              << std::setw(10) << microseconds(50)
+              << std::setw(10) << microseconds(99)
+              << std::setw(10) << microseconds(99.9)
+              << std::setw(10) << static_cast<double>(latency.max_value()) / 1000
+              << std::setw(12) << result.unanswered
+              << std::setw(10) << std::setprecision(3)
+              << (result.server_messages ? static_cast<double>(result.server_send_calls) / result.server_messages : 0)
+              << "\n";
+    if (result.failed_connections)
+        std::cout << "  " << result.failed_connections << " 个连接失败\n";
+}
+
+} // namespace
+
+/// <summary>
+/// 在回环地址上对几种网络实现进行负载测试，报告吞吐量和延迟的百分位
+/// </summary>
+int main(int argc, char* argv[])
+{
+    bench_config config;
+    std::vector<std::string> modes;
+    if (!parse_arguments(argc, argv, config, modes))
+    {
+        print_usage();
+        return 1;
+    }
+
+    std::vector<std::unique_ptr<bench_mode>> instances;
+    for (auto& name : modes)
+    {
+        auto mode = create_mode(name);
+        if (!mode)
+        {
+            std::cout << "未知的模式: " << name << "\n";
+            print_usage();
+            return 1;
+        }
+        instances.push_back(std::move(mode));
+    }
+
+#ifdef _WIN32
+    WSADATA wsa = { 0 };
+    mw::socket::socket_startup(wsa);
+#endif
+
+    std::cout << "连接数: " << config.connections << ", 消息: " << config.message_size << " 字节, ";
+    if (config.pattern == load_pattern::closed_loop)
+        std::cout << "闭环, 每个连接在途 " << config.depth << " 个请求";
+    else
+        std::cout << "开环, 每秒 " << config.rate << " 个请求";
+    std::cout << ", 预热 " << config.warmup_seconds << " 秒, 测量 " << config.duration_seconds << " 秒\n\n";
+    // 表头使用ASCII，这样setw可以对齐各列。unanswered是没有在规定时间内得到响应的请求数，sends/msg是服务器每个响应的发送调用次数
+    std::cout << std::left << std::setw(12) << "mode" << std::right
+              << std::setw(12) << "req/s" << std::setw(10) << "p50(us)" << std::setw(10) << "p99(us)"
+              << std::setw(10) << "p999(us)" << std::setw(10) << "max(us)" << std::setw(12) << "unanswered"
+              << std::setw(10) << "sends/msg" << "\n";
+
+    for (size_t i = 0; i < instances.size(); i++)
+    {
+        bench_result result;
+        if (!instances[i]->run(config, static_cast<USHORT>(config.port + i), result))
+        {
+            std::cout << instances[i]->name() << ": 服务器启动失败\n";
+            continue;
+        }
+        print_result(*instances[i], config, result);
+    }
+
+#ifdef _WIN32
+    mw::socket::socket_cleanup();
+#endif
+    return 0;
+}
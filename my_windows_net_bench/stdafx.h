@@ -0,0 +1,3 @@
+#pragma once
+#include "my_windows/my_windows.h"
+#include <iostream>
@@ -1,4 +1,5 @@
 #include "example_1.h"
+#include <chrono>
 
 BOOL CALLBACK GG(HWND hwnd, LPARAM lParam)
 {
@@ -211,4 +212,94 @@ void example_1()
         }
     }
     //mw::user::remove_windows_hook(hook_handle);
-}
\ No newline at end of file
+}
+
+
+/// <summary>
+/// 该例子测量UTF-8和UTF-16互相转换的速度，分别使用纯ASCII，中文和中英混合的文本，输出每秒转换的输入字节数(GB/s)。
+/// 输出缓冲区只分配一次，每轮都用transcode_into写入同一个缓冲区，所以测量的只有转码本身。
+/// Linux上的对应基准是my_windows_linux_test/unicode_bench.cpp(make bench)
+/// </summary>
+void example_1_1()
+{
+    auto make_text = [](std::string_view piece) {
+        std::string text;
+        while (text.size() < 4 * 1024 * 1024)
+            text += piece;
+        return text;
+    };
+    struct sample
+    {
+        const char* name;
+        std::string utf8;
+    };
+    // 中文用\u转义，这样无论源文件按哪个代码页编译，文本都是同样的UTF-8
+    sample samples[] = {
+        { "ascii", make_text("The quick brown fox jumps over the lazy dog. 0123456789\n") },
+        { "cjk", make_text(u8"\u654F\u6377\u7684\u68D5\u8272\u72D0\u72F8\u8DF3\u8FC7\u4E86\u90A3\u53EA\u61D2\u72D7\uFF0C\u7136\u540E\u53C8\u8DD1\u56DE\u4E86\u68EE\u6797\u3002") },
+        { "mixed", make_text(u8"HTTP\u8BF7\u6C42\u7684Content-Length\u662F42\uFF0C\u72B6\u6001\u7801200\u8868\u793A\u6210\u529F\uFF1B") },
+    };
+
+    // 每次测量至少运行0.5秒，取每秒处理的输入字节数
+    auto measure = [](size_t bytes, auto&& transcode) {
+        size_t rounds = 0;
+        auto begin_time = std::chrono::steady_clock::now();
+        double seconds = 0;
+        for (; seconds < 0.5; seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin_time).count())
+        {
+            transcode();
+            rounds++;
+        }
+        return static_cast<double>(bytes) * rounds / seconds / 1e9;
+    };
+
+    std::vector<char16_t> utf16_buffer;
+    std::vector<char> utf8_buffer;
+    for (auto& item : samples)
+    {
+        utf16_buffer.resize(item.utf8.size());
+        auto result = mw::transcode_into(std::string_view(item.utf8), utf16_buffer.data(), utf16_buffer.size());
+        std::u16string_view utf16(utf16_buffer.data(), result.written);
+        utf8_buffer.resize(utf16.size() * 3);
+
+        auto to_utf16 = measure(item.utf8.size(), [&] {
+            mw::transcode_into(std::string_view(item.utf8), utf16_buffer.data(), utf16_buffer.size());
+        });
+        auto to_utf8 = measure(utf16.size() * sizeof(char16_t), [&] {
+            mw::transcode_into(utf16, utf8_buffer.data(), utf8_buffer.size());
+        });
+        std::cout << item.name << ": UTF-8 -> UTF-16 " << to_utf16 << " GB/s, UTF-16 -> UTF-8 " << to_utf8 << " GB/s\n";
+    }
+}
+
+
+/// <summary>
+/// 该例子用input_batch打开记事本，再构造一段输入脚本：输入中英文文本，全选，右键单击，然后用一次SendInput发送；
+/// 同时用recording_input_sender预演同一段脚本，输出事件数和构造耗时
+/// </summary>
+void example_1_2()
+{
+    auto script = [](auto& batch) {
+        batch.text(L"input_batch 批量输入\r\nsecond line\t😀")
+            .key_combination({ VK_CONTROL, 'A' })
+            .click_at(100, 100, mw::user::mouse_button::right)
+            .key_press(VK_ESCAPE);
+    };
+
+    mw::user::basic_input_batch<mw::user::recording_input_sender> rehearsal;
+    auto start = std::chrono::steady_clock::now();
+    script(rehearsal);
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+    rehearsal.flush();
+    std::cout << "预演: " << rehearsal.sender().recorded.size() << "个事件，" << rehearsal.sender().send_sizes.size() << "次发送，构造耗时"
+              << elapsed.count() << "us\n";
+
+    mw::user::input_batch batch;
+    batch.key_combination({ VK_LWIN, 'R' }).text(L"notepad\n").flush();
+    // 等待记事本获得焦点
+    Sleep(1000);
+    batch.reserve(rehearsal.sender().recorded.size());
+    script(batch);
+    auto sent = batch.flush();
+    std::cout << "插入了" << sent << "个事件，剩余" << batch.size() << "个\n";
+}
@@ -7,3 +7,7 @@ BOOL CALLBACK HH(HWND hwnd, LPTSTR name, HANDLE data, ULONG_PTR);
 INT_PTR CALLBACK KK(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
 
 void example_1();
+
+void example_1_1();
+
+void example_1_2();
@@ -1,5 +1,12 @@
 #include "example_3.h"
 #include "stdafx.h"
+#include <chrono>
+#include <climits>
+#include <fstream>
+#include <thread>
+#ifdef _DEBUG
+#include <crtdbg.h>
+#endif
 
 DWORD WINAPI ThreadFunc(PVOID param)
 {
@@ -1080,4 +1087,314 @@ void example_3_18()
 
     mw::tls_free(index);
     CloseHandle(thread_handle);
-}
\ No newline at end of file
+}
+
+
+#ifdef _DEBUG
+long allocation_count = 0;
+
+int count_allocation(int type, void*, size_t, int, long, const unsigned char*, int)
+{
+    if (type == _HOOK_ALLOC || type == _HOOK_REALLOC)
+        allocation_count++;
+    return TRUE;
+}
+#endif
+
+/// <summary>
+/// 该例子统计传入字面量时常用wrapper的堆分配次数，用CRT的分配挂钩计数，所以只在Debug下有效。
+/// 字符串参数是tzstring_view，每一行都应该是0次；参数是const std::tstring&时，超过短字符串长度的字面量每个都要分配一次
+/// </summary>
+void example_3_19()
+{
+#ifdef _DEBUG
+    auto check = [](const char* name, auto&& call) {
+        auto before = allocation_count;
+        call();
+        std::cout << name << ": " << allocation_count - before << " 次分配\n";
+    };
+
+    auto previous_hook = _CrtSetAllocHook(count_allocation);
+    check("create_event", [] { CloseHandle(mw::sync::create_event(0, EVENT_ALL_ACCESS, _T("mw_allocation_test_event"))); });
+    check("create_mutex", [] { CloseHandle(mw::sync::create_mutex(_T("mw_allocation_test_mutex"))); });
+    check("create_semaphore", [] {
+        CloseHandle(mw::sync::create_semaphore(1, 0, SEMAPHORE_ALL_ACCESS, nullptr, _T("mw_allocation_test_semaphore")));
+    });
+    check("get_module_handle", [] { mw::get_module_handle(_T("kernel32.dll")); });
+    check("find_window", [] { mw::user::find_window(_T("Shell_TrayWnd")); });
+    check("register_window_message", [] { mw::user::register_window_message(_T("mw_allocation_test_message")); });
+    check("set_envionment_var", [] { mw::set_envionment_var(_T("MW_ALLOCATION_TEST"), _T("tzstring_view")); });
+    _CrtSetAllocHook(previous_hook);
+#else
+    std::cout << "请在Debug下运行该例子\n";
+#endif
+}
+
+
+/// <summary>
+/// 该例子比较各种错误处理策略下set_event和interlocked_increment的每次调用耗时，失败的调用使用无效句柄
+/// </summary>
+void example_3_20()
+{
+    constexpr int iterations = 1000000;
+    auto measure = [](const char* name, auto&& call) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++)
+            call();
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << name << ": " << elapsed.count() / iterations << " ns/次\n";
+    };
+
+    auto event = mw::sync::create_event(mw::unique, CREATE_EVENT_MANUAL_RESET);
+    HANDLE handle = event.get();
+    volatile LONG counter = 0;
+    measure("interlocked_increment", [&] { mw::sync::interlocked_increment(counter); });
+    measure("SetEvent", [&] { SetEvent(handle); });
+    // 以前的wrapper在每次调用后都检查GetLastError
+    measure("SetEvent + GetLastError", [&] {
+        SetEvent(handle);
+        volatile DWORD error = GetLastError();
+        (void)error;
+    });
+    measure("set_event(ignore)", [&] { mw::sync::set_event(handle, mw::error::ignore); });
+    measure("set_event(expected)", [&] { mw::sync::set_event(handle, mw::error::expected); });
+    measure("set_event(logging)", [&] { mw::sync::set_event(handle, mw::error::logging); });
+    measure("set_event(throwing)", [&] { mw::sync::set_event(handle, mw::error::throwing); });
+    measure("set_event(默认)", [&] { mw::sync::set_event(handle); });
+
+    measure("失败的set_event(expected)", [] { mw::sync::set_event(nullptr, mw::error::expected); });
+    measure("失败的set_event(logging)", [] { mw::sync::set_event(nullptr, mw::error::logging); });
+
+    auto result = mw::sync::set_event(nullptr, mw::error::expected);
+    std::cout << "expected: " << result.has_value() << ", 错误代码: " << result.error() << "\n";
+    try
+    {
+        mw::sync::set_event(nullptr, mw::error::throwing);
+    }
+    catch (const std::system_error& e)
+    {
+        std::cout << "throwing: " << e.what() << "\n";
+    }
+
+    mw::error::error_record records[4];
+    auto count = mw::error::error_log::recent(records, 4);
+    std::cout << "logging: 共记录 " << mw::error::error_log::total() << " 次失败\n";
+    for (size_t i = 0; i < count; i++)
+        std::cout << "  " << records[i].where << " 线程 " << records[i].thread_id << " 错误代码 " << records[i].code << "\n";
+}
+
+
+/// <summary>
+/// 该例子比较每次调用FormatMessage与使用缓存格式化错误代码的耗时
+/// </summary>
+void example_3_21()
+{
+    constexpr int iterations = 100000;
+    auto measure = [](const char* name, auto&& call) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++)
+            call();
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << name << ": " << elapsed.count() / iterations << " ns/次\n";
+    };
+
+    measure("FormatMessage(ALLOCATE_BUFFER)", [] {
+        PTSTR error_text = nullptr;
+        FormatMessage(FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS, nullptr,
+            WSAECONNRESET, MAKELANGID(LANG_ENGLISH, SUBLANG_ENGLISH_US), (LPTSTR)&error_text, 0, nullptr);
+        std::tstring error_str(error_text);
+        LocalFree(error_text);
+    });
+    measure("formate_error_code", [] { mw::formate_error_code(WSAECONNRESET); });
+    measure("format_error_into", [] {
+        TCHAR buffer[MW_MAX_TEXT];
+        mw::error::format_error_into(WSAECONNRESET, buffer);
+    });
+    measure("error_message", [] { mw::error::error_message(WSAECONNRESET); });
+
+    TCHAR buffer[MW_MAX_TEXT];
+    mw::error::format_error_into(ERROR_ACCESS_DENIED, buffer);
+    std::tcout << buffer << _T("\n") << mw::error::error_message(WSAECONNRESET).c_str() << _T("\n");
+    mw::error::format_errno_into(ECONNRESET, buffer);
+    std::tcout << buffer << _T("\n");
+}
+
+
+/// <summary>
+/// 该例子比较safe_handle与unique_kernel_handle包装事件的耗时和大小
+/// </summary>
+void example_3_22()
+{
+    constexpr int iterations = 100000;
+    auto measure = [](const char* name, auto&& call) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++)
+            call();
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << name << ": " << elapsed.count() / iterations << " ns/次\n";
+    };
+
+    measure("CreateEvent + CloseHandle", [] { CloseHandle(mw::sync::create_event()); });
+    measure("safe_handle", [] { auto event = mw::safe_handle(mw::sync::create_event()); });
+    measure("unique_kernel_handle", [] { auto event = mw::sync::create_event(mw::unique); });
+
+    auto event = mw::safe_handle(mw::sync::create_event());
+    measure("复制safe_handle", [&] { auto copy = event; });
+    std::vector<mw::unique_kernel_handle> handles;
+    handles.reserve(iterations);
+    measure("移动unique_kernel_handle", [&] { handles.push_back(mw::sync::create_event(mw::unique)); });
+
+    std::cout << "sizeof(safe_handle): " << sizeof(event) << "(另外分配了HANDLE和控制块)\n"
+              << "sizeof(unique_kernel_handle): " << sizeof(mw::unique_kernel_handle) << "\n"
+              << "sizeof(unique_socket): " << sizeof(mw::socket::unique_socket) << "\n";
+
+    auto work = mw::create_threadpool_work(mw::unique, [](PTP_CALLBACK_INSTANCE, PVOID, PTP_WORK) { std::cout << "工作项回调\n"; });
+    mw::submit_threadpool_work(work.get());
+    // work析构时等待回调完成后关闭工作项
+}
+
+
+/// <summary>
+/// 该例子比较启动时反复读取环境变量和命令行的耗时: 每次调用系统API，与从environment_snapshot中查找。
+/// Linux上的对应基准是my_windows_linux_test/environment_bench.cpp(make bench)
+/// </summary>
+void example_3_23()
+{
+    constexpr int iterations = 100000;
+    auto measure = [](const char* name, int count, auto&& call) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < count; i++)
+            call();
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << name << ": " << elapsed.count() / count << " ns/次\n";
+    };
+
+    measure("构造快照", 1000, [] {
+        mw::environment_snapshot::invalidate();
+        mw::environment_snapshot::current();
+    });
+
+    std::tstring value;
+    measure("get_envionment_var", iterations, [&] { mw::get_envionment_var(_T("PATH"), value); });
+    measure("getenv", iterations, [] { std::getenv("PATH"); });
+    auto snapshot = mw::environment_snapshot::current();
+    measure("environment_snapshot::get", iterations, [&] { snapshot->get_or(_T("PATH")); });
+    measure("environment_snapshot::current()->get", iterations, [] { mw::environment_snapshot::current()->get_or(_T("PATH")); });
+
+    measure("CommandLineToArgvW", iterations / 10, [] {
+        int argc = 0;
+        LocalFree(CommandLineToArgvW(GetCommandLineW(), &argc));
+    });
+    measure("environment_snapshot::arguments", iterations, [&] { snapshot->arguments().size(); });
+
+    measure("expand_envionment_str", iterations, [&] { mw::expand_envionment_str(_T("%SystemRoot%\\system32;%PATH%"), value); });
+    measure("environment_snapshot::expand", iterations, [&] { snapshot->expand(_T("%SystemRoot%\\system32;%PATH%"), value); });
+
+    mw::set_envionment_var(_T("MW_ENVIRONMENT_TEST"), _T("1"));
+    std::tcout << _T("设置后快照失效: ") << mw::environment_snapshot::current()->get_or(_T("MW_ENVIRONMENT_TEST"), _T("<不存在>")).data()
+               << _T("，旧快照: ") << snapshot->get_or(_T("MW_ENVIRONMENT_TEST"), _T("<不存在>")).data() << _T("\n");
+    for (auto argument : snapshot->arguments())
+        std::tcout << argument.data() << _T("\n");
+}
+
+
+/// <summary>
+/// 该例子比较各种时钟读取一次的耗时和分辨率，以及作用域计时器的用法
+/// </summary>
+void example_3_24()
+{
+    mw::clock::tsc_clock::calibrate();
+    std::cout << "TSC可用: " << mw::clock::tsc_clock::available() << "，频率: " << mw::clock::tsc_clock::frequency() / 1e6 << "MHz\n";
+
+    constexpr int iterations = 1000000;
+    auto measure = [](const char* name, auto&& read) {
+        mw::clock::basic_stopwatch<mw::clock::monotonic_clock> watch;
+        // 分辨率: 连续读取时两次不同的值之间的最小差
+        auto last = read();
+        long long resolution = LLONG_MAX;
+        for (int i = 0; i < iterations; i++)
+        {
+            auto now = read();
+            if (now != last)
+                resolution = (std::min)(resolution, static_cast<long long>(now - last));
+            last = now;
+        }
+        std::cout << name << ": " << static_cast<double>(watch.elapsed_ns()) / iterations << " ns/次，最小间隔" << resolution << "\n";
+    };
+    measure("get_system_time(毫秒)", [] { return static_cast<long long>(mw::get_system_time()); });
+    measure("std::chrono::steady_clock(纳秒)", [] { return static_cast<long long>(std::chrono::steady_clock::now().time_since_epoch().count()); });
+    measure("monotonic_clock(纳秒)", [] { return static_cast<long long>(mw::clock::monotonic_clock::now().time_since_epoch().count()); });
+    measure("tsc_clock(纳秒)", [] { return static_cast<long long>(mw::clock::tsc_clock::now().time_since_epoch().count()); });
+    measure("read_tsc(周期)", [] { return static_cast<long long>(mw::clock::read_tsc()); });
+
+    std::atomic<std::uint64_t> total_ns { 0 };
+    for (int i = 0; i < 10; i++)
+    {
+        mw::clock::scoped_accumulator<> timer(total_ns);
+        Sleep(1);
+    }
+    {
+        mw::clock::scoped_timer timer([](auto elapsed) { std::cout << "scoped_timer: " << elapsed.count() << "ns\n"; });
+        Sleep(5);
+    }
+    std::cout << "10次Sleep(1)共" << total_ns / 1000000.0 << "ms\n";
+
+    FILETIME creation_time, exit_time, kernel_time, user_time;
+    mw::get_thread_times(GetCurrentThread(), creation_time, exit_time, kernel_time, user_time);
+    auto user = std::chrono::duration_cast<std::chrono::milliseconds>(mw::clock::to_duration(user_time));
+    auto created = mw::clock::file_time_to_unix_ns(mw::clock::to_100ns(creation_time));
+    std::cout << "线程用户时间: " << user.count() << "ms，线程已运行" << (mw::clock::system_time_ns() - created) / 1000000 << "ms\n";
+}
+
+
+/// <summary>
+/// 该例子测量追踪一个调用的开销，并把追踪到的事件写成二进制文件和chrome://tracing可以打开的JSON文件。
+/// wrapper中的追踪需要在项目中定义MW_TRACE_THREAD等宏才会记录，这里直接使用scope&lt;true&gt;和scope&lt;false&gt;比较两种情况
+/// Linux上的对应基准是my_windows_linux_test/trace_bench.cpp(make bench)
+/// </summary>
+void example_3_25()
+{
+    constexpr int iterations = 1000000;
+    mw::clock::tsc_clock::calibrate();
+    auto measure = [](const char* name, auto&& call) {
+        mw::clock::basic_stopwatch<mw::clock::monotonic_clock> watch;
+        for (int i = 0; i < iterations; i++)
+            call(i);
+        std::cout << name << ": " << static_cast<double>(watch.elapsed_ns()) / iterations << " ns/次\n";
+    };
+    measure("未启用", [](int i) {
+        mw::trace::scope<false> mw_trace_scope_(mw::trace::module::thread, __FUNCTION__, i);
+        MW_TRACE_RESULT(i);
+    });
+    measure("启用", [](int i) {
+        mw::trace::scope<true> mw_trace_scope_(mw::trace::module::thread, __FUNCTION__, i);
+        MW_TRACE_RESULT(i);
+    });
+
+    mw::trace::binary_writer writer;
+    std::vector<std::uint8_t> binary;
+    writer.flush(binary);
+    std::cout << "丢弃了" << writer.dropped() << "个事件(每个线程只保留最近的" << mw::trace::recorder::capacity << "个)\n";
+
+    // 多个线程调用被追踪的wrapper(若启用了MW_TRACE_THREAD)，同时记录一些事件
+    auto event = mw::sync::create_event(mw::unique, CREATE_EVENT_MANUAL_RESET);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++)
+        threads.emplace_back([&] {
+            for (int i = 0; i < 100; i++)
+            {
+                mw::trace::scope<true> mw_trace_scope_(mw::trace::module::thread, "example_3_25_worker", event.get());
+                MW_TRACE_RESULT(mw::sync::wait_for_single_object(event.get(), 0));
+            }
+        });
+    mw::sync::set_event(event.get());
+    for (auto& thread : threads)
+        thread.join();
+    auto count = writer.flush(binary);
+
+    std::string json;
+    mw::trace::to_chrome_json(binary.data(), binary.size(), json, mw::get_current_process_id());
+    std::ofstream("example_3_25.mwtrace", std::ios::binary).write(reinterpret_cast<const char*>(binary.data()), binary.size());
+    std::ofstream("example_3_25.json") << json;
+    std::cout << "写出了" << count << "个事件，二进制" << binary.size() << "字节，JSON " << json.size() << "字节\n";
+}
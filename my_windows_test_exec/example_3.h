@@ -38,4 +38,11 @@ void example_3_16();
 
 void example_3_17();
 
-void example_3_18();
\ No newline at end of file
+void example_3_18();
+void example_3_19();
+void example_3_20();
+void example_3_21();
+void example_3_22();
+void example_3_23();
+void example_3_24();
+void example_3_25();
@@ -1,5 +1,7 @@
 #include "example_5.h"
 #include "stdafx.h"
+#include <algorithm>
+#include <chrono>
 
 /// <summary>
 /// 该例子展示使用socket，获取指定服务主机的地址
@@ -124,4 +126,583 @@ void example_5_client()
 
     mw::socket::close_socket(server_socket);
     mw::socket::socket_cleanup();
-}
\ No newline at end of file
+}
+
+/// <summary>
+/// 该例子展示使用tcp_server，在本机上建立10000个连接进行回显压测，统计每秒请求数和p99延迟，
+/// 并通过缓冲区池的统计信息确认稳定状态下收发数据没有分配内存
+/// </summary>
+void example_5_echo_benchmark()
+{
+    WSADATA wsa = { 0 };
+    mw::socket::socket_startup(wsa);
+
+    constexpr USHORT port = 10086;
+    constexpr int connection_count = 10000;
+    constexpr size_t request_size = 64;
+    constexpr size_t max_samples = 1 << 24;
+
+    // 服务器端，把接收缓冲区中的数据原样发回(零复制)，发送队列不够时只消耗能发送的部分，剩余部分会在队列排空后再次交给on_data
+    mw::net::tcp_handler server_handler;
+    server_handler.on_data = [](mw::net::tcp_connection& connection, const char* data, size_t size) -> size_t {
+        size = (std::min)(size, connection.send_capacity_left());
+        auto buffer = connection.receive_buffer();
+        auto offset = data - buffer.data();
+        if (!size || !connection.send(std::move(buffer), offset, size))
+            return 0;
+        return size;
+    };
+
+    // 请求很小，使用4KB的块。每个连接最多同时使用3个块(接收，正在发送，正在填充)，预先分配好，计时期间就不会再分配内存
+    mw::net::tcp_server_options options;
+    options.recv_buffer_size = 4096;
+
+    mw::net::tcp_server server(server_handler, options);
+    server.get_buffer_pool().reserve(connection_count * 3);
+    server.start();
+    if (!server.listen(port))
+    {
+        std::tcout << _T("监听失败\n");
+        mw::socket::socket_cleanup();
+        return;
+    }
+
+    // 客户端，每个连接发送一个带时间戳的请求，收到回显后记录往返时间并发送下一个请求
+    std::unique_ptr<long long[]> samples(new long long[max_samples]);
+    std::atomic<size_t> sample_count = 0;
+    std::atomic<bool> running = true;
+
+    auto send_request = [](mw::net::tcp_connection& connection) {
+        char request[request_size] = { 0 };
+        auto now = std::chrono::steady_clock::now().time_since_epoch().count();
+        memcpy(request, &now, sizeof(now));
+        connection.send(request, request_size);
+    };
+
+    mw::net::tcp_handler client_handler;
+    client_handler.on_connect = send_request;
+    client_handler.on_data = [&](mw::net::tcp_connection& connection, const char* data, size_t size) -> size_t {
+        size_t consumed = 0;
+        for (; size - consumed >= request_size; consumed += request_size)
+        {
+            long long sent_time = 0;
+            memcpy(&sent_time, data + consumed, sizeof(sent_time));
+            auto index = sample_count.fetch_add(1, std::memory_order_relaxed);
+            if (index < max_samples)
+                samples[index] = std::chrono::steady_clock::now().time_since_epoch().count() - sent_time;
+            if (running.load(std::memory_order_relaxed))
+                send_request(connection);
+        }
+        return consumed;
+    };
+
+    mw::net::tcp_server client(client_handler, options);
+    client.get_buffer_pool().reserve(connection_count * 3);
+    client.start();
+
+    sockaddr_in address = { 0 };
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    for (int i = 0; i < connection_count; i++)
+        client.connect(reinterpret_cast<sockaddr*>(&address), sizeof(address));
+
+    // 等待连接建立后开始计时
+    Sleep(2000);
+    auto connections = client.stats().active;
+    auto begin_allocations = server.get_buffer_pool().stats().slab_allocations + client.get_buffer_pool().stats().slab_allocations;
+    auto begin_count = sample_count.load();
+    auto begin_time = std::chrono::steady_clock::now();
+    Sleep(10000);
+    auto end_count = sample_count.load();
+    auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin_time).count();
+    auto end_allocations = server.get_buffer_pool().stats().slab_allocations + client.get_buffer_pool().stats().slab_allocations;
+    running = false;
+
+    client.stop();
+    server.stop();
+
+    end_count = (std::min)(end_count, max_samples);
+    begin_count = (std::min)(begin_count, end_count);
+    std::sort(samples.get() + begin_count, samples.get() + end_count);
+    auto p99 = end_count > begin_count ? samples[begin_count + (end_count - begin_count - 1) * 99 / 100] : 0;
+    auto ticks_per_us = static_cast<double>(std::chrono::steady_clock::period::den) / std::chrono::steady_clock::period::num / 1000000;
+
+    std::cout << "连接数: " << connections << "\n";
+    std::cout << "每秒请求数: " << static_cast<ULONGLONG>((end_count - begin_count) / seconds) << "\n";
+    std::cout << "p99延迟: " << p99 / ticks_per_us << "us\n";
+    std::cout << "计时期间缓冲区池分配内存的次数(应为0): " << end_allocations - begin_allocations << "\n";
+
+    mw::socket::socket_cleanup();
+}
+
+
+/// <summary>
+/// 该例子展示使用分帧编解码器，把多个消息编码到一个WSABUF数组中，再把数据切成小块模拟多次接收，从接收缓冲区链中不复制地解码出消息
+/// </summary>
+void example_5_framing()
+{
+    const char* messages[] = { "hello", "", "一条跨越多个接收缓冲区的比较长的消息", "world" };
+
+    // 编码：长度前缀在send_batch内部，消息本身不复制，batch.data()和batch.size()可以直接传给socket_send_asyn
+    mw::net::length_prefix_codec codec(mw::net::length_prefix::varint);
+    mw::net::send_batch<16> batch;
+    for (auto message : messages)
+        batch.add(codec, message, strlen(message));
+    std::cout << "WSABUF数量: " << batch.size() << ", 总字节数: " << batch.bytes() << "\n";
+
+    // 把编码后的数据每次8字节复制到缓冲区池的块中，模拟WSARecv每次只收到一小段
+    mw::net::buffer_pool pool(4096);
+    mw::net::buffer_chain chain;
+    mw::net::decoded_frame frame;
+    std::string stream;
+    for (DWORD i = 0; i < batch.size(); i++)
+        stream.append(batch.data()[i].buf, batch.data()[i].len);
+
+    for (size_t offset = 0; offset < stream.size(); offset += 8)
+    {
+        auto buffer = pool.acquire();
+        auto size = (std::min)(static_cast<size_t>(8), stream.size() - offset);
+        memcpy(buffer.data(), stream.data() + offset, size);
+        buffer.set_size(size);
+        chain.append(std::move(buffer), 0, size);
+
+        mw::net::decode_status status;
+        while ((status = codec.decode(chain, frame)) == mw::net::decode_status::frame)
+        {
+            std::string message(frame.payload.size, '\0');
+            frame.payload.copy_to(message.data(), message.size());
+            std::cout << "消息(" << chain.piece_count() << "个块中): " << message << "\n";
+            chain.consume(frame.frame_size);
+        }
+        if (status == mw::net::decode_status::error)
+            break;
+    }
+    std::cout << "正在使用的块: " << pool.stats().chunks_in_use << "\n";
+}
+
+
+/// <summary>
+/// 该例子比较合并小写入和不合并时小消息的吞吐量，服务器对每个16字节的消息单独调用一次send回复
+/// </summary>
+void example_5_coalescing_benchmark()
+{
+    WSADATA wsa = { 0 };
+    mw::socket::socket_startup(wsa);
+
+    constexpr int connection_count = 100;
+    constexpr int messages_in_flight = 64;
+    constexpr size_t message_size = 16;
+
+    // 两次测试使用不同的端口，避免受上一次测试残留连接的影响
+    auto run = [&](bool coalescing, USHORT port) {
+        // 服务器端，对收到的每个消息单独调用一次send，发送队列不够时只消耗能发送的部分
+        mw::net::tcp_handler server_handler;
+        server_handler.on_data = [](mw::net::tcp_connection& connection, const char* data, size_t size) -> size_t {
+            size_t consumed = 0;
+            for (; size - consumed >= message_size; consumed += message_size)
+            {
+                if (!connection.send(data + consumed, message_size))
+                    break;
+            }
+            return consumed;
+        };
+
+        mw::net::tcp_server_options options;
+        options.recv_buffer_size = 4096;
+        if (!coalescing)
+            options.send_queue.flush_threshold = 0;
+
+        mw::net::tcp_server server(server_handler, options);
+        server.start();
+        if (!server.listen(port))
+        {
+            std::tcout << _T("监听失败\n");
+            return;
+        }
+
+        // 客户端，每个连接保持messages_in_flight个消息在途，每收到一个回复就发送下一个消息
+        std::atomic<size_t> message_count = 0;
+        std::atomic<bool> running = true;
+
+        mw::net::tcp_handler client_handler;
+        client_handler.on_connect = [](mw::net::tcp_connection& connection) {
+            char message[message_size] = { 0 };
+            for (int i = 0; i < messages_in_flight; i++)
+                connection.send(message, message_size);
+        };
+        client_handler.on_data = [&](mw::net::tcp_connection& connection, const char* data, size_t size) -> size_t {
+            auto consumed = size - size % message_size;
+            message_count.fetch_add(consumed / message_size, std::memory_order_relaxed);
+            if (running.load(std::memory_order_relaxed))
+            {
+                for (size_t offset = 0; offset < consumed; offset += message_size)
+                    connection.send(data + offset, message_size);
+            }
+            return consumed;
+        };
+
+        mw::net::tcp_server client(client_handler, options);
+        client.start();
+
+        sockaddr_in address = { 0 };
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        for (int i = 0; i < connection_count; i++)
+            client.connect(reinterpret_cast<sockaddr*>(&address), sizeof(address));
+
+        // 等待连接建立后开始计时
+        Sleep(1000);
+        auto begin_count = message_count.load();
+        auto begin_sends = server.stats().send_calls;
+        auto begin_time = std::chrono::steady_clock::now();
+        Sleep(5000);
+        auto end_count = message_count.load();
+        auto end_sends = server.stats().send_calls;
+        auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin_time).count();
+        running = false;
+
+        client.stop();
+        server.stop();
+
+        auto messages = end_count - begin_count;
+        std::cout << (coalescing ? "合并小写入" : "不合并") << ": 每秒消息数: " << static_cast<ULONGLONG>(messages / seconds)
+                  << ", 每个消息的WSASend次数: " << (messages ? static_cast<double>(end_sends - begin_sends) / messages : 0) << "\n";
+    };
+
+    run(false, 10086);
+    run(true, 10087);
+
+    mw::socket::socket_cleanup();
+}
+
+
+/// <summary>
+/// 该例子展示使用resolver异步解析主机名，对同一主机名的并发查询只会调用一次get_address_info，之后的查询直接使用缓存
+/// </summary>
+void example_5_resolver()
+{
+    WSADATA wsa = { 0 };
+    mw::socket::socket_startup(wsa);
+
+    mw::net::resolver resolver;
+    const TCHAR* hosts[] = { _T("www.baidu.com"), _T("localhost"), _T("www.baidu.com"), _T("no-such-host.invalid") };
+
+    // 先发起所有查询，再等待结果，查询在线程池中并行执行
+    std::vector<std::shared_future<mw::net::resolve_result>> results;
+    for (auto host : hosts)
+        results.push_back(resolver.resolve(host, _T("80")));
+
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        auto& result = results[i].get();
+        std::tcout << hosts[i] << _T(": ");
+        if (result.error)
+            std::tcout << _T("解析失败，错误代码") << result.error << _T("\n");
+        else
+            std::tcout << result.endpoints.size() << _T("个地址\n");
+    }
+
+    // 再次查询会直接命中缓存(失败的结果也会被缓存negative_ttl毫秒)
+    resolver.resolve(_T("www.baidu.com"), _T("80")).get();
+    resolver.resolve(_T("no-such-host.invalid"), _T("80")).get();
+
+    auto stats = resolver.stats();
+    std::cout << "请求数: " << stats.requests << ", 缓存命中: " << stats.cache_hits << ", 合并的并发查询: " << stats.joined
+              << ", 实际查询次数: " << stats.lookups << "\n";
+
+    mw::socket::socket_cleanup();
+}
+
+
+/// <summary>
+/// 该例子展示使用connection_pool向本机的回显服务器发送请求，连接被复用，只有最初的几次请求需要建立连接
+/// </summary>
+void example_5_connection_pool()
+{
+    WSADATA wsa = { 0 };
+    mw::socket::socket_startup(wsa);
+
+    constexpr USHORT port = 10086;
+    constexpr int request_count = 10000;
+    constexpr size_t request_size = 64;
+
+    mw::net::tcp_handler server_handler;
+    server_handler.on_data = [](mw::net::tcp_connection& connection, const char* data, size_t size) -> size_t {
+        return connection.send(data, size) ? size : 0;
+    };
+    mw::net::tcp_server server(server_handler);
+    server.start();
+    if (!server.listen(port))
+    {
+        std::tcout << _T("监听失败\n");
+        mw::socket::socket_cleanup();
+        return;
+    }
+
+    // 收到完整的回显后归还连接
+    std::atomic<int> completed = 0;
+    std::atomic<int> failed = 0;
+    mw::net::connection_pool* pool_pointer = nullptr;
+    mw::net::connection_pool_handler handler;
+    handler.on_data = [&](mw::net::tcp_connection& connection, const char*, size_t size) -> size_t {
+        if (size < request_size)
+            return 0;
+        completed++;
+        pool_pointer->release(connection);
+        return size;
+    };
+
+    mw::net::connection_pool_options options;
+    options.max_connections = 16;
+    mw::net::connection_pool pool(handler, options);
+    pool_pointer = &pool;
+    pool.start();
+
+    sockaddr_in address = { 0 };
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    auto begin_time = std::chrono::steady_clock::now();
+    for (int i = 0; i < request_count; i++)
+    {
+        pool.checkout(reinterpret_cast<sockaddr*>(&address), sizeof(address), [&](mw::net::tcp_connection* connection, int) {
+            if (!connection)
+            {
+                failed++;
+                return;
+            }
+            char request[request_size] = { 0 };
+            connection->send(request, request_size);
+        });
+    }
+    while (completed + failed < request_count)
+        Sleep(10);
+    auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin_time).count();
+
+    auto stats = pool.stats();
+    std::cout << "请求数: " << completed << ", 失败: " << failed << ", 耗时: " << seconds << "s\n";
+    std::cout << "建立的连接数: " << stats.connects << ", 复用连接的次数: " << stats.reused << ", 空闲连接: " << stats.idle << "\n";
+    std::cout << "checkout等待时间 p50: " << stats.wait_percentile(0.5) << "us, p99: " << stats.wait_percentile(0.99)
+              << "us, 最长: " << stats.max_wait_time << "us\n";
+
+    pool.stop();
+    server.stop();
+    mw::socket::socket_cleanup();
+}
+
+
+/// <summary>
+/// 该例子展示使用udp_endpoint在回环地址上批量收发小数据报，测量每秒接收的数据报数，并输出各种丢弃的计数
+/// </summary>
+void example_5_udp_benchmark()
+{
+    WSADATA wsa = { 0 };
+    mw::socket::socket_startup(wsa);
+
+    constexpr USHORT receiver_port = 10088;
+    constexpr size_t datagram_size = 64;
+
+    // 接收端，每个工作线程一次取出最多batch_size个数据报
+    std::atomic<ULONGLONG> received = 0;
+    mw::net::udp_endpoint receiver([&](mw::net::udp_endpoint&, const mw::net::udp_datagram*, size_t count) {
+        received.fetch_add(count, std::memory_order_relaxed);
+    });
+
+    // 发送端只需要一个工作线程处理发送完成
+    mw::net::udp_endpoint_options sender_options;
+    sender_options.worker_count = 1;
+    sender_options.batch_size = 1;
+    mw::net::udp_endpoint sender([](mw::net::udp_endpoint&, const mw::net::udp_datagram*, size_t) {}, sender_options);
+
+    if (!receiver.start(receiver_port) || !sender.start(0))
+    {
+        std::tcout << _T("启动失败\n");
+        mw::socket::socket_cleanup();
+        return;
+    }
+
+    sockaddr_in address = { 0 };
+    address.sin_family = AF_INET;
+    address.sin_port = htons(receiver_port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    // 发送槽用完时send_to直接返回false，这里让出处理器后重试，所以send_dropped表示发送端追不上自己的发送
+    char datagram[datagram_size] = { 0 };
+    ULONGLONG sent = 0;
+    auto begin_time = std::chrono::steady_clock::now();
+    auto end_time = begin_time + std::chrono::seconds(5);
+    while (std::chrono::steady_clock::now() < end_time)
+    {
+        for (int i = 0; i < 256; i++)
+        {
+            if (sender.send_to(reinterpret_cast<sockaddr*>(&address), sizeof(address), datagram, datagram_size))
+                sent++;
+            else
+                SwitchToThread();
+        }
+    }
+    auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin_time).count();
+
+    // 等待在途的数据报到达
+    Sleep(500);
+    sender.stop();
+    receiver.stop();
+
+    auto sender_stats = sender.stats();
+    auto receiver_stats = receiver.stats();
+    std::cout << "每秒接收数据报数: " << static_cast<ULONGLONG>(receiver_stats.packets_received / seconds)
+              << ", 平均每批数据报数: " << (receiver_stats.batches ? static_cast<double>(receiver_stats.packets_received) / receiver_stats.batches : 0) << "\n";
+    std::cout << "发送: " << sent << ", 发送完成: " << sender_stats.packets_sent << ", 发送槽不足: " << sender_stats.send_dropped
+              << ", 发送失败: " << sender_stats.send_errors << "\n";
+    std::cout << "接收: " << receiver_stats.packets_received << ", 截断: " << receiver_stats.truncated
+              << ", 接收失败: " << receiver_stats.receive_errors
+              << ", 系统丢弃(发送完成 - 接收): " << sender_stats.packets_sent - (std::min)(sender_stats.packets_sent, receiver_stats.packets_received) << "\n";
+
+    mw::socket::socket_cleanup();
+}
+
+
+/// <summary>
+/// 该例子展示使用http_server提供健康检查和指标端点，运行30秒，期间可以用浏览器或curl访问
+/// http://127.0.0.1:8080/health 和 http://127.0.0.1:8080/metrics
+/// </summary>
+void example_5_http_server()
+{
+    WSADATA wsa = { 0 };
+    mw::socket::socket_startup(wsa);
+
+    mw::net::http_server* server_pointer = nullptr;
+    mw::net::http_server server([&](mw::net::tcp_connection&, const mw::net::http_request& request, mw::net::http_response& response) {
+        if (request.method != "GET" && request.method != "HEAD")
+        {
+            response.status(405);
+            response.header("Allow", "GET, HEAD");
+            response.end();
+            return;
+        }
+        if (request.path == "/health")
+        {
+            response.header("Content-Type", "text/plain");
+            response.end(std::string_view("ok"));
+        }
+        else if (request.path == "/metrics")
+        {
+            // 格式化到栈上的缓冲区，end会把它复制到发送队列
+            auto stats = server_pointer->stats();
+            char body[256];
+            auto size = sprintf_s(body, "requests %llu\nbad_requests %llu\nactive_connections %llu\n",
+                stats.requests, stats.bad_requests, stats.server.active);
+            response.header("Content-Type", "text/plain");
+            response.end(body, static_cast<size_t>(size));
+        }
+        else
+        {
+            response.status(404);
+            response.end();
+        }
+    });
+    server_pointer = &server;
+
+    if (!server.start(8080))
+    {
+        std::tcout << _T("启动失败\n");
+        mw::socket::socket_cleanup();
+        return;
+    }
+    Sleep(30000);
+    server.stop();
+
+    auto stats = server.stats();
+    std::cout << "请求数: " << stats.requests << ", 不合法的请求数: " << stats.bad_requests
+              << ", 发送调用数: " << stats.server.send_calls << "\n";
+
+    mw::socket::socket_cleanup();
+}
+
+
+/// <summary>
+/// 该例子展示tcp_server的过载控制：服务器最多接受1000个连接，缓冲区池最多4096个块，客户端却发起10倍的连接并不停地发送请求。
+/// 每5秒输出一次各种过载决定的计数，缓冲区池的块数和进程的工作集，它们在整个过程中都保持有界
+/// </summary>
+void example_5_overload_soak()
+{
+    WSADATA wsa = { 0 };
+    mw::socket::socket_startup(wsa);
+
+    constexpr USHORT server_port = 10089;
+    constexpr DWORD server_connections = 1000;
+    constexpr DWORD client_connections = 10 * server_connections;
+    constexpr size_t message_size = 64;
+
+    mw::net::tcp_handler server_handler;
+    server_handler.on_data = [](mw::net::tcp_connection& connection, const char* data, size_t size) -> size_t {
+        return connection.send(data, size) ? size : 0;
+    };
+    mw::net::tcp_server_options server_options;
+    server_options.max_connections = server_connections;
+    server_options.max_pool_chunks = 4096;
+    server_options.shed_target = 5;
+    mw::net::tcp_server server(server_handler, server_options);
+    if (!server.start() || !server.listen(server_port))
+    {
+        std::tcout << _T("启动服务器失败\n");
+        mw::socket::socket_cleanup();
+        return;
+    }
+
+    // 客户端收到回显后立即发送下一个请求，超出服务器限制的连接停留在积压队列中直到被接受或连接超时
+    std::atomic<ULONGLONG> connect_failed = 0;
+    mw::net::tcp_handler client_handler;
+    client_handler.on_connect = [](mw::net::tcp_connection& connection) {
+        char message[message_size] = { 0 };
+        connection.send(message, message_size);
+    };
+    client_handler.on_data = [](mw::net::tcp_connection& connection, const char* data, size_t size) -> size_t {
+        auto consumed = size - size % message_size;
+        for (size_t offset = 0; offset < consumed; offset += message_size)
+            connection.send(data + offset, message_size);
+        return consumed;
+    };
+    client_handler.on_connect_failed = [&](void*, int) { connect_failed.fetch_add(1); };
+    mw::net::tcp_server client(client_handler);
+    client.start();
+
+    sockaddr_in address = { 0 };
+    address.sin_family = AF_INET;
+    address.sin_port = htons(server_port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    for (DWORD i = 0; i < client_connections; i++)
+        client.connect(reinterpret_cast<sockaddr*>(&address), sizeof(address));
+
+    // 服务器自己的内存：缓冲区池已分配的块和接受的连接对象。工作集还包含客户端的内存，只作参考。
+    // 上限为缓冲区池的上限加上max_connections个连接对象，超过时停止浸泡
+    const size_t chunk_size = server.get_buffer_pool().stats().chunk_size;
+    const size_t memory_bound = server_options.max_pool_chunks * chunk_size + server_connections * sizeof(mw::net::tcp_connection);
+    bool bounded = true;
+    for (int round = 1; round <= 12 && bounded; round++)
+    {
+        Sleep(5000);
+        auto stats = server.stats();
+        auto pool_stats = server.get_buffer_pool().stats();
+        auto server_memory = pool_stats.total_chunks * pool_stats.chunk_size + static_cast<size_t>(stats.inbound) * sizeof(mw::net::tcp_connection);
+        bounded = server_memory <= memory_bound;
+        PROCESS_MEMORY_COUNTERS memory = { 0 };
+        mw::get_process_memory_info(mw::get_current_process(), memory);
+        std::cout << round * 5 << "秒: 接受的连接: " << stats.inbound << ", 暂停的AcceptEx: " << stats.parked_accepts
+                  << ", 因连接数暂停: " << stats.accept_paused_by_limit << ", 因内存暂停: " << stats.accept_paused_by_memory
+                  << ", 暂停接收: " << stats.read_pauses << ", 卸载的连接: " << stats.shed_connections
+                  << ", 最大排队延迟: " << stats.max_queue_delay << "微秒\n"
+                  << "    缓冲区池: " << pool_stats.chunks_in_use << "/" << pool_stats.total_chunks << "块"
+                  << ", 服务器内存: " << server_memory / 1024 << "/" << memory_bound / 1024 << "KB"
+                  << ", 工作集(含客户端): " << memory.WorkingSetSize / (1024 * 1024) << "MB"
+                  << ", 客户端连接失败: " << connect_failed.load() << "\n";
+    }
+    std::cout << (bounded ? "服务器内存没有超过上限\n" : "失败: 服务器内存超过上限\n");
+
+    client.stop();
+    server.stop();
+    mw::socket::socket_cleanup();
+}
@@ -5,3 +5,19 @@ void example_5();
 void example_5_server();
 
 void example_5_client();
+
+void example_5_echo_benchmark();
+
+void example_5_framing();
+
+void example_5_coalescing_benchmark();
+
+void example_5_resolver();
+
+void example_5_connection_pool();
+
+void example_5_udp_benchmark();
+
+void example_5_http_server();
+
+void example_5_overload_soak();
@@ -254,4 +254,165 @@ void example_6_6()
     mw::heap_destroy(heap_handle);
 
     int* a = new int();
-}
\ No newline at end of file
+}
+
+// 共享查找表的类型，键和值都存放在共享段中
+using shared_lookup_table = mw::shared_hash_map<mw::shared_string, mw::shared_vector<int>>;
+
+// 使用offset_ptr和共享容器在进程间共享一个查找表，它不依赖MSVC的__based，并且两个进程可以将共享段映射到不同的基地址
+// 准备数据方
+void example_6_7()
+{
+    // 以页交换文件为后备存储器的共享段，若第三个参数指定一个文件路径，则共享段会被持久化到该文件，进程重启后依然存在
+    mw::shared_segment segment(_T("shared_lookup_segment"), 64 * 1024 * 1024);
+
+    auto table = segment.find_or_construct<shared_lookup_table>("lookup_table",
+        segment.get_allocator<shared_lookup_table::entry>());
+
+    // 写入一些数据，所有的内存都从共享段中分配
+    for (int i = 0; i < 100; i++)
+    {
+        auto key = mw::shared_string(segment.get_allocator<char>(), "key_" + std::to_string(i));
+        auto result = table->emplace(std::move(key), segment.get_allocator<int>());
+        for (int j = 0; j < i; j++)
+            result.first->value.push_back(j);
+    }
+
+    auto finish_event = mw::sync::create_event(0, EVENT_ALL_ACCESS, _T("lookup_finish_event"));
+    mw::sync::set_event(finish_event); // 通知接收数据的进程，数据已经准备完毕
+
+    mw::sleep(10000);
+
+    CloseHandle(finish_event);
+}
+
+// 接收数据方
+void example_6_8()
+{
+    mw::shared_segment segment(_T("shared_lookup_segment"), 64 * 1024 * 1024);
+
+    auto finish_event = mw::sync::open_event(_T("lookup_finish_event"));
+
+    // 等待数据准备完毕
+    mw::sync::wait_for_single_object(finish_event);
+
+    auto table = segment.find<shared_lookup_table>("lookup_table");
+
+    std::cout << "共享段基地址：" << segment.base() << "，查找表大小：" << table->size() << "\n";
+
+    // 直接使用std::string_view查找，不需要在共享段中构造临时字符串
+    if (auto found = table->find(std::string_view("key_42")))
+        std::cout << "key_42有" << found->value.size() << "个元素\n";
+
+    CloseHandle(finish_event);
+}
+
+// 使用memory_map拍摄当前进程的地址空间快照，并周期性地刷新，输出两次快照之间的差异
+void example_6_9()
+{
+    mw::memory_map map(mw::get_current_process());
+
+    auto& summary = map.summary();
+    std::cout << "区域数量：" << map.regions().size() << "\n";
+    std::cout << "已调拨：" << summary.committed_bytes << "，已预订：" << summary.reserved_bytes << "\n";
+    std::cout << "映像：" << summary.bytes_by_type(MEM_IMAGE) << "，私有：" << summary.bytes_by_type(MEM_PRIVATE) << "\n";
+    std::cout << "PAGE_READWRITE：" << summary.bytes_by_protect(PAGE_READWRITE) << "\n";
+
+    // 二分查找某个地址所在的区域，不需要再调用virtual_query
+    auto region = map.find(&map);
+    std::cout << "栈上的对象位于区域：" << (void*)region->base << "，大小：" << region->size << "\n";
+
+    mw::memory_map_diff diff;
+    for (int i = 0; i < 5; i++)
+    {
+        // 分配一些内存，然后刷新快照
+        auto address = mw::virtual_alloc(mw::get_current_process(), 1024 * 1024);
+        map.refresh(mw::get_current_process(), &diff);
+        std::cout << "新增：" << diff.added.size() << "，删除：" << diff.removed.size() << "，改变：" << diff.changed.size() << "\n";
+        mw::virtual_free(mw::get_current_process(), address);
+        mw::sleep(1000);
+    }
+}
+
+// 使用memory_scanner在当前进程中并行搜索带通配符的字节模式
+void example_6_10()
+{
+    // 在堆上放置一些已知的字节序列，用于验证扫描结果
+    std::vector<unsigned char> marker = { 0x48, 0x8B, 0x05, 0x11, 0x22, 0x33, 0x44, 0xC3 };
+
+    mw::memory_scanner scanner;
+    scanner.add_pattern("48 8B 05 ?? ?? ?? ?? C3");
+    scanner.add_pattern("CC CC CC CC CC CC CC CC");
+
+    std::atomic<ULONGLONG> counts[2] = {};
+    mw::clock::stopwatch watch;
+    auto total = scanner.scan(mw::get_current_process(), [&](const mw::scan_match& match) {
+        counts[match.pattern_index]++; // 该回调会在多个工作线程中被同时调用
+        return true;
+    });
+    auto elapsed = watch.elapsed_ms();
+
+    std::cout << "扫描了" << scanner.bytes_scanned() / 1024 / 1024 << "MB，耗时" << elapsed << "毫秒，共" << total << "个匹配\n";
+    std::cout << "模式0：" << counts[0] << "，模式1：" << counts[1] << "，标记位于：" << (void*)marker.data() << "\n";
+}
+
+// 使用memory_pressure_monitor监视内存压力，在压力升高时清理缓存
+void example_6_11()
+{
+    std::vector<std::vector<char>> cache;
+
+    mw::memory_pressure_thresholds thresholds;
+    thresholds.low_process_commit = 512 * 1024 * 1024;
+    thresholds.critical_process_commit = 1024 * 1024 * 1024;
+    mw::memory_pressure_monitor monitor(thresholds);
+
+    mw::sync::critical_section cache_lock;
+    monitor.add_callback(mw::memory_pressure_level::low, [&](const mw::memory_pressure_sample& sample) {
+        std::cout << "内存压力：low，进程提交：" << sample.process_commit << "，增长率：" << sample.process_growth_rate << "字节/秒\n";
+        cache_lock.enter();
+        cache.resize(cache.size() / 2); // 释放一半的缓存
+        cache_lock.leave();
+    });
+    monitor.add_callback(mw::memory_pressure_level::critical, [&](const mw::memory_pressure_sample&) {
+        std::cout << "内存压力：critical\n";
+        cache_lock.enter();
+        cache.clear();
+        cache_lock.leave();
+    });
+    monitor.add_callback(mw::memory_pressure_level::normal, [](const mw::memory_pressure_sample&) {
+        std::cout << "内存压力恢复正常\n";
+    });
+
+    monitor.start(200);
+    for (int i = 0; i < 100; i++)
+    {
+        cache_lock.enter();
+        cache.emplace_back(32 * 1024 * 1024, 'a');
+        cache_lock.leave();
+        mw::sleep(100);
+    }
+    monitor.stop();
+}
+
+// 使用heap_tracker按调用点统计仍未释放的堆内存(需要在包含my_windows.h之前定义MY_WINDOWS_TRACK_HEAP宏)
+void example_6_12()
+{
+    mw::heap_tracker::start(64 * 1024);
+
+    auto heap = mw::get_process_heap();
+    std::vector<LPVOID> leaked;
+    for (int i = 0; i < 100000; i++)
+    {
+        auto block = mw::heap_alloc(heap, 100 + i % 1000);
+        if (i % 10 == 0)
+            leaked.push_back(block); // 模拟泄漏
+        else
+            mw::heap_free(heap, block);
+    }
+
+    mw::heap_tracker::dump(std::cout);
+
+    for (auto block : leaked)
+        mw::heap_free(heap, block);
+    mw::heap_tracker::stop();
+}
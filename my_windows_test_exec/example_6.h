@@ -13,3 +13,15 @@ void example_6_4();
 void example_6_5();
 
 void example_6_6();
+
+void example_6_7();
+
+void example_6_8();
+
+void example_6_9();
+
+void example_6_10();
+
+void example_6_11();
+
+void example_6_12();
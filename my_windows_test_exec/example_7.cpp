@@ -214,4 +214,50 @@ void example_7_8()
 
     // 额外步骤，与上面相同的步骤，创建一个远程线程，但是目标是FreeLibrary
     // 以释放我们注入的DLL
-}
\ No newline at end of file
+}
+
+/// <summary>
+/// 该例子拍摄所有进程，线程和当前进程模块的快照，比较索引查找与tool_help线性查找的耗时，然后每秒报告一次进程和模块的变化
+/// </summary>
+void example_7_9()
+{
+    mw::system_snapshot snapshot;
+    snapshot.capture();
+    std::cout << "进程: " << snapshot.process_records().size() << ", 线程: " << snapshot.thread_records().size()
+              << ", 模块: " << snapshot.module_records().size() << "\n";
+
+    auto process_id = GetCurrentProcessId();
+    auto start = GetTickCount64();
+    size_t found = 0;
+    for (int i = 0; i < 1000; i++)
+        found += snapshot.find_process(process_id) != nullptr;
+    std::cout << "system_snapshot查找1000次: " << GetTickCount64() - start << " ms\n";
+
+    mw::tool_help th(TH32CS_SNAPPROCESS, 0);
+    PROCESSENTRY32 process_entry = { sizeof(process_entry) };
+    start = GetTickCount64();
+    for (int i = 0; i < 1000; i++)
+        found += th.process_find(process_id, process_entry);
+    std::cout << "tool_help查找1000次: " << GetTickCount64() - start << " ms\n";
+
+    if (auto kernel32 = snapshot.find_module(process_id, _T("KERNEL32.DLL")))
+        std::tcout << kernel32->path << _T(" 基址: ") << reinterpret_cast<PVOID>(kernel32->base_address) << _T("\n");
+    auto threads = snapshot.threads_of(process_id);
+    std::cout << "当前进程的线程数: " << threads.second - threads.first << "\n";
+
+    mw::snapshot_diff diff;
+    for (int i = 0; i < 10; i++)
+    {
+        mw::sleep(1000);
+        if (!snapshot.refresh(diff))
+            continue;
+        for (auto& process : diff.started_processes)
+            std::tcout << _T("启动: ") << process.process_id << _T(" ") << process.exe_file << _T("\n");
+        for (auto& process : diff.exited_processes)
+            std::tcout << _T("退出: ") << process.process_id << _T(" ") << process.exe_file << _T("\n");
+        for (auto& module : diff.loaded_modules)
+            std::tcout << _T("载入: ") << module.name << _T("\n");
+        if (i == 2)
+            mw::load_library(_T("winhttp.dll"));
+    }
+}
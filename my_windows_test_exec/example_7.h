@@ -17,3 +17,5 @@ void example_7_6();
 void example_7_7();
 
 void example_7_8();
+
+void example_7_9();
@@ -14,15 +14,15 @@ int main(int argc, char* argv[])
     std::wcout.imbue(std::locale(""));
 #endif // UNICODE    
 
+    //example_1_1();
+    //example_1_2();
     //example_3();   
     //example_4();   
     //example_4_1(); 
     //example_4_2();
-    /*auto bf = mw::get_system_time();
+    /*mw::clock::stopwatch watch;
 	example_4_3();
-	auto af = mw::get_system_time();
-
-	std::cout << af - bf;*/
+	std::cout << watch.elapsed_ms() << "ms\n";*/
     //example_3_1();
     //example_3_2();
     //example_3_3();
@@ -37,6 +37,14 @@ int main(int argc, char* argv[])
     //example_5();
     //example_5_server();
     //example_5_client();
+    //example_5_echo_benchmark();
+    //example_5_framing();
+    //example_5_coalescing_benchmark();
+    //example_5_resolver();
+    //example_5_connection_pool();
+    //example_5_udp_benchmark();
+    //example_5_http_server();
+    //example_5_overload_soak();
     //example_2();
     //example_3_13();
     //example_3_14();
@@ -51,16 +59,30 @@ int main(int argc, char* argv[])
     //example_6_4();
     //example_6_5();
     //example_6_6();
+    //example_6_7();
+    //example_6_8();
+    //example_6_9();
+    //example_6_10();
+    //example_6_11();
+    //example_6_12();
     //example_7();
     //example_7_1();
     //example_7_2();
     //example_3_18();
+    //example_3_19();
+    //example_3_20();
+    //example_3_21();
+    //example_3_22();
+    //example_3_23();
+    //example_3_24();
+    //example_3_25();
     //example_7_3();
     //example_7_4();
     //example_7_5();
     //example_7_6();
     //example_7_7();
     //example_7_8();
+    //example_7_9();
     //example_8();
     //example_8_1();
     //example_8_2();